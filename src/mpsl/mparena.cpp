@@ -0,0 +1,80 @@
+// [MPSL]
+// MathPresso's Shading Language with JIT Engine for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define MPSL_EXPORTS
+
+// [Dependencies - MPSL]
+#include "./mparena_p.h"
+
+// [Api-Begin]
+#include "./mpsl_apibegin.h"
+
+namespace mpsl {
+
+// ============================================================================
+// [mpsl::ArenaPool - Construction / Destruction]
+// ============================================================================
+
+ArenaPool::ArenaPool() noexcept
+  : _lock(),
+    _free(nullptr) {}
+
+ArenaPool::~ArenaPool() noexcept {
+  trim();
+}
+
+// ============================================================================
+// [mpsl::ArenaPool - Interface]
+// ============================================================================
+
+ArenaPool::Arena* ArenaPool::acquire() noexcept {
+  {
+    AutoSpinLock guard(_lock);
+    Arena* arena = _free;
+
+    if (arena != nullptr) {
+      _free = arena->next;
+      arena->next = nullptr;
+      return arena;
+    }
+  }
+
+  void* p = ::malloc(sizeof(Arena));
+  if (p == nullptr)
+    return nullptr;
+  return new(p) Arena();
+}
+
+void ArenaPool::release(Arena* arena) noexcept {
+  // Keep all blocks, the next compilation reuses them.
+  arena->zone.reset(false);
+
+  AutoSpinLock guard(_lock);
+  arena->next = _free;
+  _free = arena;
+}
+
+void ArenaPool::trim() noexcept {
+  Arena* arena;
+  {
+    AutoSpinLock guard(_lock);
+    arena = _free;
+    _free = nullptr;
+  }
+
+  while (arena != nullptr) {
+    Arena* next = arena->next;
+    arena->~Arena();
+    ::free(arena);
+    arena = next;
+  }
+}
+
+} // mpsl namespace
+
+// [Api-End]
+#include "./mpsl_apiend.h"
@@ -0,0 +1,124 @@
+// [MPSL]
+// MathPresso's Shading Language with JIT Engine for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _MPSL_MPARENA_P_H
+#define _MPSL_MPARENA_P_H
+
+// [Dependencies - MPSL]
+#include "./mpatomic_p.h"
+#include "./mpsl_p.h"
+
+// [Api-Begin]
+#include "./mpsl_apibegin.h"
+
+namespace mpsl {
+
+// ============================================================================
+// [mpsl::ArenaPool]
+// ============================================================================
+
+//! \internal
+//!
+//! Pool of zones used by compilations of a `Context::Impl`.
+//!
+//! Each compilation acquires a zone, which is reset and returned to the pool
+//! when the compilation finishes. Resetting a zone doesn't release its blocks,
+//! so a zone keeps the memory of its largest compilation (the high-water mark)
+//! and compiling small programs doesn't allocate at all. There are as many
+//! zones as compilations that ran concurrently, `trim()` releases all of them.
+//!
+//! The pool is thread-safe.
+class ArenaPool {
+public:
+  MPSL_NONCOPYABLE(ArenaPool)
+
+  //! A zone and a link to the next free zone.
+  struct Arena {
+    MPSL_INLINE Arena() noexcept
+      : next(nullptr),
+        zone(kBlockSize) {}
+
+    Arena* next;
+    Zone zone;
+  };
+
+  enum {
+    //! Size of blocks allocated by zones.
+    kBlockSize = 32768 - Zone::kZoneOverhead
+  };
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  ArenaPool() noexcept;
+  ~ArenaPool() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Internal]
+  // --------------------------------------------------------------------------
+
+  MPSL_INLINE void destroy() noexcept {
+    this->~ArenaPool();
+    ::free(this);
+  }
+
+  // --------------------------------------------------------------------------
+  // [Interface]
+  // --------------------------------------------------------------------------
+
+  //! Get a free arena or create a new one, returns null if out of memory.
+  Arena* acquire() noexcept;
+  //! Reset `arena` and return it to the pool.
+  void release(Arena* arena) noexcept;
+  //! Release all free arenas and their memory.
+  void trim() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  SpinLock _lock;                        //!< Guards `_free`.
+  Arena* _free;                          //!< Free arenas.
+};
+
+// ============================================================================
+// [mpsl::ArenaScope]
+// ============================================================================
+
+//! \internal
+//!
+//! Arena acquired from `ArenaPool` for the lifetime of the scope.
+class ArenaScope {
+public:
+  MPSL_NONCOPYABLE(ArenaScope)
+
+  MPSL_INLINE ArenaScope(ArenaPool* pool) noexcept
+    : _pool(pool),
+      _arena(pool->acquire()) {}
+
+  MPSL_INLINE ~ArenaScope() noexcept {
+    if (_arena != nullptr)
+      _pool->release(_arena);
+  }
+
+  //! Get whether the arena was acquired.
+  MPSL_INLINE bool isValid() const noexcept { return _arena != nullptr; }
+  //! Get the zone of the arena, must be valid.
+  MPSL_INLINE Zone& getZone() const noexcept { return _arena->zone; }
+
+  ArenaPool* _pool;
+  ArenaPool::Arena* _arena;
+};
+
+} // mpsl namespace
+
+// [Api-End]
+#include "./mpsl_apiend.h"
+
+// [Guard]
+#endif // _MPSL_MPARENA_P_H
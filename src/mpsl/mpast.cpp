@@ -26,6 +26,14 @@ static MPSL_INLINE bool mpIsVarNodeType(uint32_t nodeType) noexcept {
   return nodeType == AstNode::kTypeVar || nodeType == AstNode::kTypeVarMemb;
 }
 
+// Get whether `node` is an array indexed by its parent, which is the only way
+// an array can be used.
+static MPSL_INLINE bool mpIsIndexedArray(const AstNode* node) noexcept {
+  const AstNode* parent = node->getParent();
+  return parent != nullptr && parent->getNodeType() == AstNode::kTypeIndex &&
+         static_cast<const AstIndex*>(parent)->getLeft() == node;
+}
+
 static MPSL_INLINE uint32_t mpIndexSwizzle(const char* s, uint32_t len, char c) noexcept {
   for (uint32_t i = 0; i < len; i++)
     if (s[i] == c)
@@ -113,6 +121,7 @@ static const AstNodeSize mpAstNodeSize[] = {
   ROW(AstNode::kTypeImm      , sizeof(AstImm)      ),
   ROW(AstNode::kTypeUnaryOp  , sizeof(AstUnaryOp)  ),
   ROW(AstNode::kTypeBinaryOp , sizeof(AstBinaryOp) ),
+  ROW(AstNode::kTypeIndex    , sizeof(AstIndex)    ),
   ROW(AstNode::kTypeCall     , sizeof(AstCall)     )
 };
 #undef ROW
@@ -125,7 +134,12 @@ AstBuilder::AstBuilder(ZoneHeap* heap) noexcept
   : _heap(heap),
     _globalScope(nullptr),
     _programNode(nullptr),
-    _mainFunction(nullptr) {}
+    _mainFunction(nullptr),
+    _nodeCount(0) {
+
+  for (uint32_t i = 0; i < Globals::kMaxArgumentsCount; i++)
+    _boundValues[i] = nullptr;
+}
 AstBuilder::~AstBuilder() noexcept {}
 
 // ============================================================================
@@ -175,6 +189,8 @@ void AstBuilder::deleteNode(AstNode* node) noexcept {
 
   uint32_t nodeType = node->getNodeType();
   MPSL_ASSERT(mpAstNodeSize[nodeType].getNodeType() == nodeType);
+  MPSL_ASSERT(_nodeCount != 0);
+  _nodeCount--;
 
   switch (nodeType) {
     case AstNode::kTypeProgram  : static_cast<AstProgram*  >(node)->destroy(this); break;
@@ -193,6 +209,7 @@ void AstBuilder::deleteNode(AstNode* node) noexcept {
     case AstNode::kTypeImm      : static_cast<AstImm*      >(node)->destroy(this); break;
     case AstNode::kTypeUnaryOp  : static_cast<AstUnaryOp*  >(node)->destroy(this); break;
     case AstNode::kTypeBinaryOp : static_cast<AstBinaryOp* >(node)->destroy(this); break;
+    case AstNode::kTypeIndex    : static_cast<AstIndex*    >(node)->destroy(this); break;
     case AstNode::kTypeCall     : static_cast<AstCall*     >(node)->destroy(this); break;
   }
 
@@ -203,9 +220,9 @@ void AstBuilder::deleteNode(AstNode* node) noexcept {
 // [mpsl::AstBuilder - Initialization]
 // ============================================================================
 
-Error AstBuilder::addProgramScope() noexcept {
+Error AstBuilder::addProgramScope(AstScope* parent) noexcept {
   if (_globalScope == nullptr) {
-    _globalScope = newScope(nullptr, AstScope::kTypeGlobal);
+    _globalScope = newScope(parent, AstScope::kTypeGlobal);
     MPSL_NULLCHECK(_globalScope);
   }
 
@@ -263,7 +280,7 @@ Error AstBuilder::addBuiltInTypes(const TypeInfo* data, size_t count) noexcept {
       symbol->setDeclared();
       symbol->setTypeInfo(typeInfo);
 
-      scope->putSymbol(symbol);
+      MPSL_PROPAGATE(scope->putSymbol(symbol));
     } while (++j <= jMax);
   }
 
@@ -289,7 +306,7 @@ Error AstBuilder::addBuiltInConstants(const ConstInfo* data, size_t count) noexc
     symbol->setAssigned();
     symbol->_value.d[0] = constInfo.value;
 
-    scope->putSymbol(symbol);
+    MPSL_PROPAGATE(scope->putSymbol(symbol));
   }
 
   return kErrorOk;
@@ -316,17 +333,19 @@ Error AstBuilder::addBuiltInIntrinsics() noexcept {
     symbol->setDeclared();
     symbol->setOpType(op.type);
 
-    scope->putSymbol(symbol);
+    MPSL_PROPAGATE(scope->putSymbol(symbol));
   }
 
   return kErrorOk;
 }
 
-Error AstBuilder::addBuiltInObject(uint32_t slot, const Layout* layout, AstSymbol** collidedSymbol) noexcept {
+Error AstBuilder::addBuiltInObject(uint32_t slot, const Layout* layout, const void* values, AstSymbol** collidedSymbol) noexcept {
   AstScope* scope = getGlobalScope();
-  if (scope == nullptr)
+  if (scope == nullptr || slot >= Globals::kMaxArgumentsCount)
     return MPSL_TRACE_ERROR(kErrorInvalidState);
 
+  _boundValues[slot] = values;
+
   StringRef name;
 
   bool isAnonymous = !layout->hasName();
@@ -341,8 +360,9 @@ Error AstBuilder::addBuiltInObject(uint32_t slot, const Layout* layout, AstSymbo
     name.set(layout->getName(), layout->getNameLength());
   }
 
+  // Built-ins can be in a parent scope, see `AstBuiltIns`.
   uint32_t hVal = HashUtils::hashString(name);
-  AstSymbol* symbol = scope->getSymbol(name, hVal);
+  AstSymbol* symbol = scope->resolveSymbol(name, hVal);
 
   if (symbol) {
     *collidedSymbol = symbol;
@@ -357,14 +377,14 @@ Error AstBuilder::addBuiltInObject(uint32_t slot, const Layout* layout, AstSymbo
   symbol->setTypeInfo(kTypePtr);
   symbol->setDataSlot(slot);
   symbol->setLayout(layout);
-  scope->putSymbol(symbol);
+  MPSL_PROPAGATE(scope->putSymbol(symbol));
 
   // Create all members if the root is anonymous or a member has `kTypeDenest`.
   const Layout::Member* members = layout->getMembersArray();
   uint32_t count = layout->getMembersCount();
 
   // Filter to clear these flags as they are only used to define the layout.
-  uint32_t kTypeInfoFilter = ~kTypeDenest;
+  uint32_t kTypeInfoFilter = ~(kTypeDenest | kTypeBind);
 
   for (uint32_t i = 0; i < count; i++) {
     const Layout::Member* m = &members[i];
@@ -375,7 +395,7 @@ Error AstBuilder::addBuiltInObject(uint32_t slot, const Layout* layout, AstSymbo
       name.set(m->name, m->nameLength);
       hVal = HashUtils::hashString(name);
 
-      symbol = scope->getSymbol(name, hVal);
+      symbol = scope->resolveSymbol(name, hVal);
       if (symbol) {
         *collidedSymbol = symbol;
         return MPSL_TRACE_ERROR(kErrorSymbolCollision);
@@ -391,10 +411,190 @@ Error AstBuilder::addBuiltInObject(uint32_t slot, const Layout* layout, AstSymbo
       symbol->setTypeInfo(m->typeInfo & kTypeInfoFilter);
       symbol->setDataSlot(slot);
       symbol->setDataOffset(m->offset);
-      scope->putSymbol(symbol);
+      symbol->setArrayCount(m->count);
+
+      // Bound members are constants, like built-in constants.
+      if (typeInfo & kTypeBind) {
+        getBoundValue(slot, m, symbol->_value);
+        symbol->setAssigned();
+      }
+
+      MPSL_PROPAGATE(scope->putSymbol(symbol));
+    }
+  }
+
+  return kErrorOk;
+}
+
+void AstBuilder::getBoundValue(uint32_t slot, const Layout::Member* m, Value& out) const noexcept {
+  MPSL_ASSERT(slot < Globals::kMaxArgumentsCount && _boundValues[slot] != nullptr);
+
+  const uint8_t* data = static_cast<const uint8_t*>(_boundValues[slot]) + m->offset;
+  out.zero();
+  ::memcpy(&out, data, TypeInfo::widthOf(m->typeInfo));
+}
+
+Error AstBuilder::addPipelineLink(const Pipeline::Link& link, AstSymbol** collidedSymbol) noexcept {
+  AstScope* scope = getGlobalScope();
+  if (scope == nullptr)
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  StringRef name(link.name);
+  uint32_t hVal = HashUtils::hashString(name);
+  AstSymbol* symbol = scope->resolveSymbol(name, hVal);
+
+  if (symbol) {
+    *collidedSymbol = symbol;
+    return MPSL_TRACE_ERROR(kErrorSymbolCollision);
+  }
+
+  // Links don't have a data slot, they live in registers of the fused `main()`.
+  symbol = newSymbol(name, hVal, AstSymbol::kTypeVariable, AstScope::kTypeGlobal);
+  MPSL_NULLCHECK(symbol);
+
+  symbol->setDeclared();
+  symbol->setSymbolFlag(AstSymbol::kFlagIsLink);
+  symbol->setTypeInfo(link.typeInfo | kTypeRead | kTypeWrite);
+  return scope->putSymbol(symbol);
+}
+
+Error AstBuilder::addPipelineMain(const Pipeline& pipeline, AstScope* const* stageScopes) noexcept {
+  AstScope* scope = getGlobalScope();
+  uint32_t stagesCount = pipeline.getStagesCount();
+
+  if (scope == nullptr || stagesCount == 0)
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  StringRef mainName("main", 4);
+  uint32_t mainHVal = HashUtils::hashString(mainName);
+
+  AstFunction* func = newNode<AstFunction>();
+  MPSL_NULLCHECK(func);
+
+  MPSL_PROPAGATE(_programNode->willAdd());
+  _programNode->appendNode(func);
+
+  AstBlock* args = newNode<AstBlock>();
+  MPSL_NULLCHECK(args);
+  func->setArgs(args);
+
+  AstBlock* body = newNode<AstBlock>();
+  MPSL_NULLCHECK(body);
+  func->setBody(body);
+
+  // Declare all links first, zero-initialized, so a stage can read a link no
+  // stage before it has written.
+  uint32_t i;
+  uint32_t linksCount = pipeline.getLinksCount();
+
+  for (i = 0; i < linksCount; i++) {
+    StringRef linkName(pipeline.getLink(i).name);
+    AstSymbol* sym = scope->getSymbol(linkName, HashUtils::hashString(linkName));
+
+    if (sym == nullptr)
+      return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+    Value zero;
+    zero.zero();
+
+    AstImm* imm = newNode<AstImm>(zero, (sym->getTypeInfo() & ~kTypeWrite) | kTypeRead);
+    MPSL_NULLCHECK(imm);
+
+    AstVarDecl* decl = newNode<AstVarDecl>();
+    MPSL_NULLCHECK(decl);
+
+    decl->setSymbol(sym);
+    decl->setChild(imm);
+    sym->setNode(decl);
+
+    MPSL_PROPAGATE(body->willAdd());
+    body->appendNode(decl);
+  }
+
+  // Call `main()` of each stage and pass its result to the stage's link, the
+  // result of the last stage is returned.
+  for (i = 0; i < stagesCount; i++) {
+    const Pipeline::Stage& stage = pipeline.getStage(i);
+    AstSymbol* stageSym = stageScopes[i]->getSymbol(mainName, mainHVal);
+
+    if (stageSym == nullptr || !stageSym->isFunction())
+      return MPSL_TRACE_ERROR(kErrorNoEntryPoint);
+
+    AstFunction* stageFunc = static_cast<AstFunction*>(stageSym->getNode());
+    AstCall* call = newNode<AstCall>();
+    MPSL_NULLCHECK(call);
+
+    call->setSymbol(stageSym);
+    call->setPosition(stageFunc->getPosition());
+
+    AstNode* stmt = call;
+    if (i == stagesCount - 1) {
+      func->setRet(stageFunc->getRet());
+      func->setPosition(stageFunc->getPosition());
+
+      if (stageFunc->getRet()) {
+        AstReturn* ret = newNode<AstReturn>();
+        MPSL_NULLCHECK_(ret, { deleteNode(call); });
+
+        ret->setChild(call);
+        stmt = ret;
+      }
+    }
+    else if (stage.retLink) {
+      StringRef linkName(stage.retLink);
+      AstSymbol* linkSym = scope->getSymbol(linkName, HashUtils::hashString(linkName));
+      if (linkSym == nullptr)
+        return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+      AstVar* var = newNode<AstVar>();
+      MPSL_NULLCHECK_(var, { deleteNode(call); });
+
+      var->setSymbol(linkSym);
+      var->setTypeInfo(linkSym->getTypeInfo());
+
+      AstBinaryOp* assign = newNode<AstBinaryOp>(kOpAssign);
+      MPSL_NULLCHECK_(assign, { deleteNode(call); deleteNode(var); });
+
+      assign->setLeft(var);
+      assign->setRight(call);
+      stmt = assign;
     }
+
+    MPSL_PROPAGATE_(body->willAdd(), { deleteNode(stmt); });
+    body->appendNode(stmt);
   }
 
+  AstSymbol* mainSym = newSymbol(mainName, mainHVal, AstSymbol::kTypeFunction, AstScope::kTypeGlobal);
+  MPSL_NULLCHECK(mainSym);
+  MPSL_PROPAGATE(scope->putSymbol(mainSym));
+
+  func->setFunc(mainSym);
+  mainSym->setNode(func);
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::AstBuiltIns - Construction / Destruction]
+// ============================================================================
+
+AstBuiltIns::AstBuiltIns() noexcept
+  : _zone(8192 - Zone::kZoneOverhead),
+    _heap(&_zone),
+    _ast(&_heap) {}
+
+// Everything is allocated by `_zone`, which releases all memory at once.
+AstBuiltIns::~AstBuiltIns() noexcept {}
+
+// ============================================================================
+// [mpsl::AstBuiltIns - Init]
+// ============================================================================
+
+Error AstBuiltIns::init() noexcept {
+  MPSL_PROPAGATE(_ast.addProgramScope());
+  MPSL_PROPAGATE(_ast.addBuiltInTypes(mpTypeInfo, kTypeCount));
+  MPSL_PROPAGATE(_ast.addBuiltInConstants(mpConstInfo, MPSL_ARRAY_SIZE(mpConstInfo)));
+  MPSL_PROPAGATE(_ast.addBuiltInIntrinsics());
+
   return kErrorOk;
 }
 
@@ -816,6 +1016,18 @@ Error AstDump::onBinaryOp(AstBinaryOp* node) noexcept {
   return denest();
 }
 
+Error AstDump::onIndex(AstIndex* node) noexcept {
+  nest("[] [%{Type}]", node->getTypeInfo());
+
+  if (node->hasLeft())
+    MPSL_PROPAGATE(onNode(node->getLeft()));
+
+  if (node->hasRight())
+    MPSL_PROPAGATE(onNode(node->getRight()));
+
+  return denest();
+}
+
 Error AstDump::onCall(AstCall* node) noexcept {
   AstSymbol* sym = node->getSymbol();
 
@@ -872,6 +1084,7 @@ AstAnalysis::AstAnalysis(AstBuilder* ast, ErrorReporter* errorReporter) noexcept
   : AstVisitor<AstAnalysis>(ast),
     _errorReporter(errorReporter),
     _currentRet(nullptr),
+    _conversions(0),
     _unreachable(false) {}
 AstAnalysis::~AstAnalysis() noexcept {}
 
@@ -880,11 +1093,19 @@ AstAnalysis::~AstAnalysis() noexcept {}
 // ============================================================================
 
 Error AstAnalysis::onProgram(AstProgram* node) noexcept {
-  return onBlock(node);
+  MPSL_PROPAGATE(onBlock(node));
+
+  if (_conversions != 0)
+    _errorReporter->onWarning(0,
+      "Program has %u implicit conversion(s) between 'float' and 'double'.", _conversions);
+
+  return kErrorOk;
 }
 
 Error AstAnalysis::onFunction(AstFunction* node) noexcept {
-  bool isMain = node->getFunc()->eq("main", 4);
+  // Only `main()` of the global scope is the entry point, `main()` of each
+  // stage of a `Pipeline` is an ordinary function called by it.
+  bool isMain = node->getFunc() == _ast->getGlobalScope()->getSymbol(StringRef("main", 4), HashUtils::hashString("main", 4));
 
   // Link to the `_mainFunction` if this is `main()`.
   if (isMain) {
@@ -1063,6 +1284,23 @@ Error AstAnalysis::onVarMemb(AstVarMemb* node) noexcept {
       return _errorReporter->onError(kErrorInvalidProgram, node->getPosition(),
         "Object '%s' doesn't have a member '%s'", sym->getName(), node->getField().getData());
 
+    // Bound members are replaced by their values, see `kTypeBind`.
+    if (m->typeInfo & kTypeBind) {
+      Value value;
+      _ast->getBoundValue(sym->getDataSlot(), m, value);
+
+      AstImm* imm = _ast->newNode<AstImm>(value, (m->typeInfo & ~(kTypeDenest | kTypeBind | kTypeWrite | kTypeStorageAttrMask)) | kTypeRead);
+      MPSL_NULLCHECK(imm);
+
+      node->getParent()->replaceNode(node, imm);
+      _ast->deleteNode(node);
+      return kErrorOk;
+    }
+
+    if (m->count != 0 && !mpIsIndexedArray(node))
+      return _errorReporter->onError(kErrorInvalidProgram, node->getPosition(),
+        "Array '%s.%s' can only be indexed", sym->getName(), node->getField().getData());
+
     node->setTypeInfo(m->typeInfo | kTypeRef | (typeInfo & kTypeRW));
     node->setOffset(m->offset);
   }
@@ -1101,6 +1339,11 @@ Error AstAnalysis::onVar(AstVar* node) noexcept {
   if ((typeInfo & kTypeIdMask) == kTypeVoid)
     return MPSL_TRACE_ERROR(kErrorInvalidState);
 
+  const AstSymbol* sym = node->getSymbol();
+  if (sym->getArrayCount() != 0 && !mpIsIndexedArray(node))
+    return _errorReporter->onError(kErrorInvalidProgram, node->getPosition(),
+      "Array '%s' can only be indexed", sym->getName());
+
   typeInfo |= kTypeRef;
   node->setTypeInfo(typeInfo);
 
@@ -1139,7 +1382,7 @@ Error AstAnalysis::onUnaryOp(AstUnaryOp* node) noexcept {
   }
   else {
     uint32_t srcType = child->getTypeInfo();
-    uint32_t dstType = srcType & ~(kTypeRef | kTypeWrite);
+    uint32_t dstType = srcType & ~(kTypeRef | kTypeWrite | kTypeStorageAttrMask);
 
     uint32_t srcId = srcType & kTypeIdMask;
     uint32_t dstId = srcId;
@@ -1224,6 +1467,14 @@ Error AstAnalysis::onBinaryOp(AstBinaryOp* node) noexcept {
 
     uint32_t dstTypeInfo = lTypeInfo;
 
+    // A number used with a `float` operand becomes `float`, which keeps the
+    // operation in single precision, see `kOptionPreferFloat`.
+    if (lTypeId != rTypeId && !op.isShift() && !op.isBitwise()) {
+      if ((lTypeId == kTypeFloat && preferFloat(right)) ||
+          (rTypeId == kTypeFloat && preferFloat(left)))
+        continue;
+    }
+
     if (op.isShift()) {
       // Bit shift and rotation can only be done on integers.
       if (!TypeInfo::isIntId(lTypeId))
@@ -1266,6 +1517,7 @@ Error AstAnalysis::onBinaryOp(AstBinaryOp* node) noexcept {
           AstUnaryOp* castNode = _ast->newNode<AstUnaryOp>(kOpCast, dstTypeInfo);
           MPSL_NULLCHECK(castNode);
 
+          countConversion(node->getPosition(), rTypeInfo, dstTypeInfo);
           node->injectNode(right, castNode);
           continue;
         }
@@ -1277,6 +1529,7 @@ Error AstAnalysis::onBinaryOp(AstBinaryOp* node) noexcept {
           AstUnaryOp* castNode = _ast->newNode<AstUnaryOp>(kOpCast, dstTypeInfo);
           MPSL_NULLCHECK(castNode);
 
+          countConversion(node->getPosition(), lTypeInfo, dstTypeInfo);
           node->injectNode(left, castNode);
           continue;
         }
@@ -1324,7 +1577,7 @@ Error AstAnalysis::onBinaryOp(AstBinaryOp* node) noexcept {
     }
     else {
       // Results in a new temporary, clear the reference/write flags.
-      dstTypeInfo = (dstTypeInfo | kTypeRead) & ~(kTypeRef | kTypeWrite);
+      dstTypeInfo = (dstTypeInfo | kTypeRead) & ~(kTypeRef | kTypeWrite | kTypeReduceMask | kTypeStorageAttrMask);
 
       // DSP-specific checks.
       if (op.isDSP64() && (TypeInfo::widthOf(dstTypeInfo) % 8) != 0) {
@@ -1340,6 +1593,38 @@ Error AstAnalysis::onBinaryOp(AstBinaryOp* node) noexcept {
   return kErrorOk;
 }
 
+Error AstAnalysis::onIndex(AstIndex* node) noexcept {
+  if (!node->hasLeft() || !node->hasRight())
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  MPSL_PROPAGATE(onNode(node->getLeft()));
+  MPSL_PROPAGATE(onNode(node->getRight()));
+
+  AstNode* left = node->getLeft();
+  uint32_t count = 0;
+
+  if (left->getNodeType() == AstNode::kTypeVar) {
+    count = static_cast<AstVar*>(left)->getSymbol()->getArrayCount();
+  }
+  else if (left->getNodeType() == AstNode::kTypeVarMemb) {
+    // The member of an object, already checked by `onVarMemb()`.
+    AstVarMemb* memb = static_cast<AstVarMemb*>(left);
+    const AstSymbol* sym = static_cast<AstVar*>(memb->getChild())->getSymbol();
+    count = sym->getLayout()->getMember(memb->getField())->count;
+  }
+
+  if (count == 0)
+    return _errorReporter->onError(kErrorInvalidProgram, node->getPosition(),
+      "Type '%{Type}' can't be indexed", left->getTypeInfo());
+
+  // Elements are read-only, the index is clamped by `CodeGen::onIndex()`.
+  MPSL_PROPAGATE(implicitCast(node, node->getRight(), kTypeInt | kTypeRead));
+
+  node->setTypeInfo((left->getTypeInfo() & (kTypeIdMask | kTypeVecMask)) | kTypeRead);
+  node->setElementCount(count);
+  return kErrorOk;
+}
+
 Error AstAnalysis::onCall(AstCall* node) noexcept {
   AstSymbol* sym = node->getSymbol();
   uint32_t count = node->getLength();
@@ -1410,6 +1695,11 @@ Error AstAnalysis::checkAssignment(AstNode* node, uint32_t op) noexcept {
     return _errorReporter->onError(kErrorInvalidProgram, node->getPosition(),
       "Can't assign '%s' to a non-writable variable.", mpOpInfo[op].name);
 
+  // Reductions combine the assigned value with the member, it can't be read.
+  if ((typeInfo & kTypeReduceMask) != 0 && op != kOpAssign)
+    return _errorReporter->onError(kErrorInvalidProgram, node->getPosition(),
+      "Can't assign '%s' to a reduction, only '=' is allowed.", mpOpInfo[op].name);
+
   // Assignment has always a side-effect - used by optimizer to not remove code
   // that has to be executed.
   node->addNodeFlags(AstNode::kFlagSideEffect);
@@ -1422,6 +1712,9 @@ Error AstAnalysis::checkAssignment(AstNode* node, uint32_t op) noexcept {
 // ============================================================================
 
 Error AstAnalysis::implicitCast(AstNode* node, AstNode* child, uint32_t typeInfo) noexcept {
+  if ((typeInfo & kTypeIdMask) == kTypeFloat)
+    preferFloat(child);
+
   uint32_t childInfo = child->getTypeInfo();
 
   // First implicit cast type-id, vector/scalar cast will be checked later on.
@@ -1438,8 +1731,8 @@ Error AstAnalysis::implicitCast(AstNode* node, AstNode* child, uint32_t typeInfo
   }
 
   // Try to cast to vector from scalar.
-  uint32_t aAttr = typeInfo  & (kTypeAttrMask & ~(kTypeRW | kTypeRef));
-  uint32_t bAttr = childInfo & (kTypeAttrMask & ~(kTypeRW | kTypeRef));
+  uint32_t aAttr = typeInfo  & (kTypeAttrMask & ~(kTypeRW | kTypeRef | kTypeReduceMask | kTypeStorageAttrMask));
+  uint32_t bAttr = childInfo & (kTypeAttrMask & ~(kTypeRW | kTypeRef | kTypeReduceMask | kTypeStorageAttrMask));
 
   if (aAttr != bAttr) {
     if ((aAttr & kTypeVecMask) != 0 && (bAttr & kTypeVecMask) <= kTypeVec1)
@@ -1450,6 +1743,9 @@ Error AstAnalysis::implicitCast(AstNode* node, AstNode* child, uint32_t typeInfo
 
   if (implicitCast) {
     AstUnaryOp* castNode = _ast->newNode<AstUnaryOp>(kOpCast, typeInfo);
+    MPSL_NULLCHECK(castNode);
+
+    countConversion(node->getPosition(), childInfo, typeInfo);
     node->injectNode(child, castNode);
   }
 
@@ -1469,6 +1765,69 @@ uint32_t AstAnalysis::boolCast(AstNode* node, AstNode* child) noexcept {
   }
 }
 
+bool AstAnalysis::preferFloat(AstNode* child) noexcept {
+  if (!(_errorReporter->_options & kOptionPreferFloat))
+    return false;
+
+  // Look through a negation, `-0.5` is parsed as `-(0.5)`.
+  if (child->getNodeType() == AstNode::kTypeUnaryOp && child->getOp() == kOpNeg) {
+    AstUnaryOp* unary = static_cast<AstUnaryOp*>(child);
+    if (!unary->hasChild() || !preferFloat(unary->getChild()))
+      return false;
+
+    unary->setTypeInfo(kTypeFloat | (unary->getTypeInfo() & ~kTypeIdMask));
+    return true;
+  }
+
+  if (child->getNodeType() != AstNode::kTypeImm || !child->hasNodeFlag(AstNode::kFlagUntyped))
+    return false;
+
+  AstImm* imm = static_cast<AstImm*>(child);
+  uint32_t typeInfo = imm->getTypeInfo();
+
+  Value value;
+  value.zero();
+
+  switch (typeInfo & kTypeIdMask) {
+    case kTypeInt: {
+      int32_t x = imm->getValue().i[0];
+      if (x < -(1 << 24) || x > (1 << 24))
+        return false;
+
+      value.f[0] = static_cast<float>(x);
+      break;
+    }
+
+    case kTypeDouble: {
+      double x = imm->getValue().d[0];
+      if (!(x >= -3.4028234663852886e+38 && x <= 3.4028234663852886e+38) ||
+          static_cast<double>(static_cast<float>(x)) != x)
+        return false;
+
+      value.f[0] = static_cast<float>(x);
+      break;
+    }
+
+    default:
+      return false;
+  }
+
+  imm->setValue(value);
+  imm->setTypeInfo(kTypeFloat | (typeInfo & ~kTypeIdMask));
+  return true;
+}
+
+void AstAnalysis::countConversion(uint32_t position, uint32_t fromTypeInfo, uint32_t toTypeInfo) noexcept {
+  uint32_t fromId = fromTypeInfo & kTypeIdMask;
+  uint32_t toId = toTypeInfo & kTypeIdMask;
+
+  if ((fromId == kTypeFloat && toId == kTypeDouble) || (fromId == kTypeDouble && toId == kTypeFloat)) {
+    _conversions++;
+    _errorReporter->onWarning(position,
+      "Implicit conversion from '%{Type}' to '%{Type}'.", fromTypeInfo, toTypeInfo);
+  }
+}
+
 Error AstAnalysis::invalidCast(uint32_t position, const char* msg, uint32_t fromTypeInfo, uint32_t toTypeInfo) noexcept {
   return _errorReporter->onError(kErrorInvalidProgram, position,
     "%s from '%{Type}' to '%{Type}'.", msg, fromTypeInfo, toTypeInfo);
@@ -55,6 +55,8 @@ public:
   MPSL_INLINE AstScope* getGlobalScope() const noexcept { return _globalScope; }
   MPSL_INLINE AstProgram* getProgramNode() const noexcept { return _programNode; }
   MPSL_INLINE AstFunction* getMainFunction() const noexcept { return _mainFunction; }
+  //! Get the number of nodes allocated and not deleted.
+  MPSL_INLINE uint32_t getNodeCount() const noexcept { return _nodeCount; }
 
   // --------------------------------------------------------------------------
   // [Factory]
@@ -68,7 +70,8 @@ public:
 
 #define MPSL_ALLOC_AST_OBJECT(_Size_) \
   void* obj = _heap->alloc(_Size_); \
-  if (MPSL_UNLIKELY(obj == nullptr)) return nullptr
+  if (MPSL_UNLIKELY(obj == nullptr)) return nullptr; \
+  _nodeCount++
 
   template<typename T>
   MPSL_INLINE T* newNode() noexcept {
@@ -105,11 +108,23 @@ public:
   // [Initialization]
   // --------------------------------------------------------------------------
 
-  Error addProgramScope() noexcept;
+  //! Create the global scope and the program node. If `parent` is given it's
+  //! used as a read-only parent of the global scope (see `AstBuiltIns`).
+  Error addProgramScope(AstScope* parent = nullptr) noexcept;
   Error addBuiltInTypes(const TypeInfo* data, size_t count) noexcept;
   Error addBuiltInConstants(const ConstInfo* data, size_t count) noexcept;
   Error addBuiltInIntrinsics() noexcept;
-  Error addBuiltInObject(uint32_t slot, const Layout* layout, AstSymbol** collidedSymbol) noexcept;
+  //! Add the data object of `slot`, `values` provides values of members bound
+  //! at compile time (see `kTypeBind`) and can be null if there are none.
+  Error addBuiltInObject(uint32_t slot, const Layout* layout, const void* values, AstSymbol** collidedSymbol) noexcept;
+  //! Add a variable shared by all stages of a pipeline, see `Pipeline::addLink()`.
+  Error addPipelineLink(const Pipeline::Link& link, AstSymbol** collidedSymbol) noexcept;
+  //! Add `main()` that calls `main()` of each stage of `pipeline` parsed into
+  //! the respective `stageScopes[i]` and writes its result to the stage's link.
+  Error addPipelineMain(const Pipeline& pipeline, AstScope* const* stageScopes) noexcept;
+
+  //! Get the value of a member `m` of `slot` bound at compile time.
+  void getBoundValue(uint32_t slot, const Layout::Member* m, Value& out) const noexcept;
 
   // --------------------------------------------------------------------------
   // [Dump]
@@ -126,6 +141,10 @@ public:
   AstScope* _globalScope;                //!< Global scope.
   AstProgram* _programNode;              //!< Root node.
   AstFunction* _mainFunction;            //!< Program `main()` node.
+  uint32_t _nodeCount;                   //!< Number of live nodes.
+
+  //! Values of members bound at compile time, per data slot.
+  const void* _boundValues[Globals::kMaxArgumentsCount];
 };
 
 // ============================================================================
@@ -157,7 +176,10 @@ public:
     //! for parser to make sure that the symbol is declared before it's used.
     kFlagIsDeclared = 0x0002,
 
-    kFlagIsAssigned = 0x0004
+    kFlagIsAssigned = 0x0004,
+
+    //! The symbol is a link of a `Pipeline`, shared by all stages.
+    kFlagIsLink     = 0x0008
   };
 
   // --------------------------------------------------------------------------
@@ -174,6 +196,7 @@ public:
       _dataSlot(kInvalidDataSlot),
       _typeInfo(kTypeVoid),
       _dataOffset(0),
+      _arrayCount(0),
       _node(nullptr),
       _layout(nullptr),
       _value() {}
@@ -245,6 +268,8 @@ public:
   MPSL_INLINE bool isDeclared() const noexcept { return hasSymbolFlag(kFlagIsDeclared); }
   //! Set the symbol to be declared (\ref kFlagIsDeclared).
   MPSL_INLINE void setDeclared() noexcept { setSymbolFlag(kFlagIsDeclared); }
+  //! Check if the symbol is a link of a `Pipeline` (\ref kFlagIsLink).
+  MPSL_INLINE bool isLink() const noexcept { return hasSymbolFlag(kFlagIsLink); }
 
   //! Get whether the variable has assigned a constant value at the moment.
   //!
@@ -274,6 +299,11 @@ public:
   MPSL_INLINE const Layout* getLayout() const noexcept { return _layout; }
   MPSL_INLINE void setLayout(const Layout* layout) noexcept { _layout = layout; }
 
+  //! Get the number of elements if the symbol is an array, zero otherwise.
+  MPSL_INLINE uint32_t getArrayCount() const noexcept { return _arrayCount; }
+  //! Set the number of elements of an array, see `Layout::addArray()`.
+  MPSL_INLINE void setArrayCount(uint32_t count) noexcept { _arrayCount = count; }
+
   // --------------------------------------------------------------------------
   // [Members]
   // --------------------------------------------------------------------------
@@ -288,6 +318,7 @@ public:
 
   uint32_t _typeInfo;                    //!< TypeInfo of the symbol.
   int32_t _dataOffset;                   //!< Data offset (only if the symbol is mapped to a data object).
+  uint32_t _arrayCount;                  //!< Number of elements (only if the symbol is an array).
 
   AstNode* _node;                        //!< Node where the symbol is defined (nullptr if built-in)
   const Layout* _layout;                 //!< Link to the layout, only valid if the symbol is object.
@@ -345,8 +376,10 @@ public:
   //! to call `resolveSymbol()` or `getSymbol()` and then `putSymbol()` based
   //! on the result. You should never call `putSymbol()` without checking if
   //! the symbol is already there.
-  MPSL_INLINE void putSymbol(AstSymbol* symbol) noexcept {
-    _symbols.put(symbol);
+  //!
+  //! The scope owns `symbol` after the call, even if it fails.
+  MPSL_INLINE Error putSymbol(AstSymbol* symbol) noexcept {
+    return _symbols.put(symbol);
   }
 
   //! Resolve the symbol by traversing all parent scopes if not found in this
@@ -362,10 +395,62 @@ public:
   // [Members]
   // --------------------------------------------------------------------------
 
-  AstBuilder* _ast;                      //!< AST builder.
-  AstScope* _parent;                     //!< Parent scope.
-  Hash<StringRef, AstSymbol> _symbols;   //!< Symbols defined within this scope.
-  uint32_t _scopeType;                   //!< Scope type, see \ref Type.
+  AstBuilder* _ast;                         //!< AST builder.
+  AstScope* _parent;                        //!< Parent scope.
+  ProbeHash<StringRef, AstSymbol> _symbols; //!< Symbols defined within this scope.
+  uint32_t _scopeType;                      //!< Scope type, see \ref Type.
+};
+
+// ============================================================================
+// [mpsl::AstBuiltIns]
+// ============================================================================
+
+//! \internal
+//!
+//! Built-in types, constants and intrinsics created once by `Context::freeze()`.
+//!
+//! The scope is never modified after `init()`, which makes it safe to share
+//! it between all compilations (also concurrent ones) as a parent of their
+//! global scope.
+class AstBuiltIns {
+public:
+  MPSL_NONCOPYABLE(AstBuiltIns)
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  AstBuiltIns() noexcept;
+  ~AstBuiltIns() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Internal]
+  // --------------------------------------------------------------------------
+
+  MPSL_INLINE void destroy() noexcept {
+    this->~AstBuiltIns();
+    ::free(this);
+  }
+
+  // --------------------------------------------------------------------------
+  // [Init]
+  // --------------------------------------------------------------------------
+
+  Error init() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  MPSL_INLINE AstScope* getScope() const noexcept { return _ast.getGlobalScope(); }
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  Zone _zone;                            //!< Zone that holds all symbols.
+  ZoneHeap _heap;                        //!< Heap used by `_ast`.
+  AstBuilder _ast;                       //!< Builder used to create the scope.
 };
 
 // ============================================================================
@@ -404,12 +489,15 @@ public:
 
     kTypeUnaryOp,                        //!< Node is `AstUnaryOp`.
     kTypeBinaryOp,                       //!< Node is `AstBinaryOp`.
+    kTypeIndex,                          //!< Node is `AstIndex`.
     kTypeCall                            //!< Node is `AstCall`.
   };
 
   //! AST node flags.
   enum Flags {
-    kFlagSideEffect = 0x01
+    kFlagSideEffect = 0x01,
+    //! Number written without a type suffix, see `kOptionPreferFloat`.
+    kFlagUntyped = 0x02
   };
 
   // --------------------------------------------------------------------------
@@ -1127,6 +1215,39 @@ public:
   }
 };
 
+// ============================================================================
+// [mpsl::AstIndex]
+// ============================================================================
+
+//! \internal
+//!
+//! Element of an array, `left[right]`, see `Layout::addArray()`.
+class AstIndex : public AstBinary {
+public:
+  MPSL_NONCOPYABLE(AstIndex)
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  MPSL_INLINE AstIndex(AstBuilder* ast) noexcept
+    : AstBinary(ast, kTypeIndex),
+      _elementCount(0) {}
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  MPSL_INLINE uint32_t getElementCount() const noexcept { return _elementCount; }
+  MPSL_INLINE void setElementCount(uint32_t count) noexcept { _elementCount = count; }
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  uint32_t _elementCount;                //!< Number of elements of the array.
+};
+
 // ============================================================================
 // [mpsl::AstCall]
 // ============================================================================
@@ -1201,6 +1322,7 @@ public:
       case AstNode::kTypeImm      : return static_cast<Impl*>(this)->onImm      (static_cast<AstImm*      >(node));
       case AstNode::kTypeUnaryOp  : return static_cast<Impl*>(this)->onUnaryOp  (static_cast<AstUnaryOp*  >(node));
       case AstNode::kTypeBinaryOp : return static_cast<Impl*>(this)->onBinaryOp (static_cast<AstBinaryOp* >(node));
+      case AstNode::kTypeIndex    : return static_cast<Impl*>(this)->onIndex    (static_cast<AstIndex*    >(node));
       case AstNode::kTypeCall     : return static_cast<Impl*>(this)->onCall     (static_cast<AstCall*     >(node));
 
       default:
@@ -1259,6 +1381,7 @@ public:
       case AstNode::kTypeImm      : return static_cast<Impl*>(this)->onImm      (static_cast<AstImm*      >(node), args);
       case AstNode::kTypeUnaryOp  : return static_cast<Impl*>(this)->onUnaryOp  (static_cast<AstUnaryOp*  >(node), args);
       case AstNode::kTypeBinaryOp : return static_cast<Impl*>(this)->onBinaryOp (static_cast<AstBinaryOp* >(node), args);
+      case AstNode::kTypeIndex    : return static_cast<Impl*>(this)->onIndex    (static_cast<AstIndex*    >(node), args);
       case AstNode::kTypeCall     : return static_cast<Impl*>(this)->onCall     (static_cast<AstCall*     >(node), args);
 
       default:
@@ -1309,6 +1432,7 @@ public:
   Error onImm(AstImm* node) noexcept;
   Error onUnaryOp(AstUnaryOp* node) noexcept;
   Error onBinaryOp(AstBinaryOp* node) noexcept;
+  Error onIndex(AstIndex* node) noexcept;
   Error onCall(AstCall* node) noexcept;
 
   // --------------------------------------------------------------------------
@@ -1363,6 +1487,7 @@ public:
   Error onImm(AstImm* node) noexcept;
   Error onUnaryOp(AstUnaryOp* node) noexcept;
   Error onBinaryOp(AstBinaryOp* node) noexcept;
+  Error onIndex(AstIndex* node) noexcept;
   Error onCall(AstCall* node) noexcept;
 
   // --------------------------------------------------------------------------
@@ -1388,6 +1513,13 @@ public:
   //! Perform an internal cast to `bool` or `__qbool`.
   uint32_t boolCast(AstNode* node, AstNode* child) noexcept;
 
+  //! Change the type of a number `child` to `float` if `kOptionPreferFloat`
+  //! is set and the number can be represented exactly, returns true if changed.
+  bool preferFloat(AstNode* child) noexcept;
+
+  //! Count a conversion between `float` and `double` added at `position`.
+  void countConversion(uint32_t position, uint32_t fromTypeInfo, uint32_t toTypeInfo) noexcept;
+
   // TODO: Move to `AstBuilder::onInvalidCast()`.
   //! Report an invalid implicit or explicit cast.
   Error invalidCast(uint32_t position, const char* msg, uint32_t fromTypeInfo, uint32_t toTypeInfo) noexcept;
@@ -1399,6 +1531,8 @@ public:
   ErrorReporter* _errorReporter;
   AstSymbol* _currentRet;
 
+  //! Number of conversions between `float` and `double`, see `countConversion()`.
+  uint32_t _conversions;
   bool _unreachable;
 };
 
@@ -34,6 +34,13 @@ AstOptimizer::~AstOptimizer() noexcept {}
 // [mpsl::AstOptimizer - Utilities]
 // ============================================================================
 
+// Members are stored to memory (and reductions combined with it) and links of
+// a `Pipeline` are shared by all stages, an assignment to them can't be
+// replaced by its value.
+static MPSL_INLINE bool mpIsFoldableSymbol(const AstSymbol* sym) noexcept {
+  return sym->getDataSlot() == kInvalidDataSlot && !sym->isLink();
+}
+
 static MPSL_INLINE bool mpGetBooleanValue(const Value* src, uint32_t typeId) noexcept {
   return mpTypeInfo[typeId].size == 4 ? src->u[0] != 0 : src->q[0] != 0;
 }
@@ -242,7 +249,7 @@ Error AstOptimizer::onVarDecl(AstVarDecl* node) noexcept {
     MPSL_PROPAGATE(onNode(node->getChild()));
     AstNode* child = node->getChild();
 
-    if (child->isImm())
+    if (child->isImm() && mpIsFoldableSymbol(sym))
       sym->setValue(static_cast<AstImm*>(child)->getValue());
   }
 
@@ -474,7 +481,8 @@ Error AstOptimizer::onBinaryOp(AstBinaryOp* node) noexcept {
       // Evaluate an assignment.
       if (!isConditional() && op.isAssignment() && left->isVar()) {
         AstSymbol* sym = static_cast<AstVar*>(left)->getSymbol();
-        if (op.type == kOpAssign || sym->isAssigned()) {
+
+        if (mpIsFoldableSymbol(sym) && (op.type == kOpAssign || sym->isAssigned())) {
           MPSL_PROPAGATE(
             Fold::foldBinaryOp(op.type,
               sym->_value,
@@ -509,6 +517,12 @@ Error AstOptimizer::onBinaryOp(AstBinaryOp* node) noexcept {
   return kErrorOk;
 }
 
+Error AstOptimizer::onIndex(AstIndex* node) noexcept {
+  // The array is never replaced, only the index can be folded.
+  MPSL_PROPAGATE(onNode(node->getLeft()));
+  return onNode(node->getRight());
+}
+
 Error AstOptimizer::onCall(AstCall* node) noexcept {
   AstSymbol* sym = node->getSymbol();
   uint32_t i, count = node->getLength();
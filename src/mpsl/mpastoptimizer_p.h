@@ -50,6 +50,7 @@ public:
   Error onImm(AstImm* node) noexcept;
   Error onUnaryOp(AstUnaryOp* node) noexcept;
   Error onBinaryOp(AstBinaryOp* node) noexcept;
+  Error onIndex(AstIndex* node) noexcept;
   Error onCall(AstCall* node) noexcept;
 
   // --------------------------------------------------------------------------
@@ -9,7 +9,7 @@
 #define _MPSL_MPATOMIC_P_H
 
 // [Dependencies - MPSL]
-#include "./mpsl_p.h"
+#include "./mpsl.h"
 
 // [Dependencies - MSC]
 #if defined(_MSC_VER) && _MSC_VER >= 1400
@@ -40,11 +40,17 @@ static MPSL_INLINE void mpAtomicSet(uintptr_t* atomic, size_t value) noexcept {
 #  pragma intrinsic (_InterlockedIncrement64)
 #  pragma intrinsic (_InterlockedDecrement64)
 #  pragma intrinsic (_InterlockedExchange64)
+#  pragma intrinsic (_InterlockedCompareExchange64)
 //! \internal
 static MPSL_INLINE uintptr_t mpAtomicSetXchg(uintptr_t* atomic, uintptr_t value) noexcept {
   return _InterlockedExchange64((__int64 volatile *)atomic, static_cast<__int64>(value));
 };
 //! \internal
+static MPSL_INLINE bool mpAtomicCmpXchg(uintptr_t* atomic, uintptr_t expected, uintptr_t value) noexcept {
+  return _InterlockedCompareExchange64((__int64 volatile *)atomic,
+    static_cast<__int64>(value), static_cast<__int64>(expected)) == static_cast<__int64>(expected);
+};
+//! \internal
 static MPSL_INLINE uintptr_t mpAtomicInc(uintptr_t* atomic) noexcept {
   return _InterlockedIncrement64((__int64 volatile *)atomic);
 };
@@ -56,11 +62,17 @@ static MPSL_INLINE uintptr_t mpAtomicDec(uintptr_t* atomic) noexcept {
 #  pragma intrinsic (_InterlockedIncrement)
 #  pragma intrinsic (_InterlockedDecrement)
 #  pragma intrinsic (_InterlockedExchange)
+#  pragma intrinsic (_InterlockedCompareExchange)
 //! \internal
 static MPSL_INLINE uintptr_t mpAtomicSetXchg(uintptr_t* atomic, uintptr_t value) noexcept {
   return _InterlockedExchange((long volatile *)atomic, static_cast<long>(value));
 };
 //! \internal
+static MPSL_INLINE bool mpAtomicCmpXchg(uintptr_t* atomic, uintptr_t expected, uintptr_t value) noexcept {
+  return _InterlockedCompareExchange((long volatile *)atomic,
+    static_cast<long>(value), static_cast<long>(expected)) == static_cast<long>(expected);
+};
+//! \internal
 static MPSL_INLINE uintptr_t mpAtomicInc(uintptr_t* atomic) noexcept {
   return _InterlockedIncrement((long volatile *)atomic);
 }
@@ -77,6 +89,10 @@ static MPSL_INLINE uintptr_t mpAtomicSetXchg(uintptr_t* atomic, uintptr_t value)
   return __sync_lock_test_and_set(atomic, value);
 };
 //! \internal
+static MPSL_INLINE bool mpAtomicCmpXchg(uintptr_t* atomic, uintptr_t expected, uintptr_t value) noexcept {
+  return __sync_bool_compare_and_swap(atomic, expected, value);
+};
+//! \internal
 static MPSL_INLINE uintptr_t mpAtomicInc(uintptr_t* atomic) noexcept {
   return __sync_add_and_fetch(atomic, 1);
 }
@@ -91,6 +107,47 @@ MPSL_INLINE T mpAtomicSetXchgT(T* atomic, T value) noexcept {
   return (T)mpAtomicSetXchg((uintptr_t *)atomic, (uintptr_t)value);
 }
 
+// ============================================================================
+// [mpsl::SpinLock]
+// ============================================================================
+
+//! \internal
+//!
+//! A minimal spin-lock used to guard very short critical sections shared by
+//! multiple threads (it never sleeps, don't hold it while compiling).
+class SpinLock {
+public:
+  MPSL_NONCOPYABLE(SpinLock)
+
+  MPSL_INLINE SpinLock() noexcept : _locked(0) {}
+
+  MPSL_INLINE void lock() noexcept {
+    while (mpAtomicSetXchg(&_locked, 1) != 0) {
+      while (mpAtomicGet(&_locked) != 0)
+        continue;
+    }
+  }
+
+  MPSL_INLINE void unlock() noexcept {
+    mpAtomicSetXchg(&_locked, 0);
+  }
+
+  uintptr_t _locked;
+};
+
+//! \internal
+//!
+//! Scoped `SpinLock` guard.
+class AutoSpinLock {
+public:
+  MPSL_NONCOPYABLE(AutoSpinLock)
+
+  MPSL_INLINE AutoSpinLock(SpinLock& target) noexcept : _target(target) { _target.lock(); }
+  MPSL_INLINE ~AutoSpinLock() noexcept { _target.unlock(); }
+
+  SpinLock& _target;
+};
+
 } // mpsl namespace
 
 // [Api-End]
@@ -0,0 +1,277 @@
+// [MPSL]
+// MathPresso's Shading Language with JIT Engine for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define MPSL_EXPORTS
+
+// [Dependencies - MPSL]
+#include "./mpcache_p.h"
+
+// [Api-Begin]
+#include "./mpsl_apibegin.h"
+
+namespace mpsl {
+
+// ============================================================================
+// [mpsl::ProgramCache - Construction / Destruction]
+// ============================================================================
+
+ProgramCache::ProgramCache(ReleaseFunc releaseFunc) noexcept
+  : _lock(),
+    _releaseFunc(releaseFunc),
+    _buckets(_embeddedBuckets),
+    _bucketsCount(kInitialBuckets),
+    _count(0),
+    _limit(0),
+    _lruFirst(nullptr),
+    _lruLast(nullptr),
+    _hits(0),
+    _misses(0),
+    _evictions(0) {
+
+  for (uint32_t i = 0; i < kInitialBuckets; i++)
+    _embeddedBuckets[i] = nullptr;
+}
+
+ProgramCache::~ProgramCache() noexcept {
+  _releaseChain(_trim(0));
+
+  if (_buckets != _embeddedBuckets)
+    ::free(_buckets);
+}
+
+// ============================================================================
+// [mpsl::ProgramCache - Accessors]
+// ============================================================================
+
+void ProgramCache::getStats(Context::CacheStats& out) noexcept {
+  AutoSpinLock locked(_lock);
+
+  out.hits = _hits;
+  out.misses = _misses;
+  out.evictions = _evictions;
+  out.count = _count;
+  out.limit = _limit;
+}
+
+// ============================================================================
+// [mpsl::ProgramCache - Interface]
+// ============================================================================
+
+Program::Impl* ProgramCache::get(const void* key, size_t size, uint32_t hVal) noexcept {
+  AutoSpinLock locked(_lock);
+  Entry* entry = _find(key, size, hVal);
+
+  if (entry == nullptr) {
+    _misses++;
+    return nullptr;
+  }
+
+  _hits++;
+  if (entry != _lruFirst) {
+    _unlinkLRU(entry);
+    _linkLRU(entry);
+  }
+
+  // Cached programs are never static, thus their `_refCount` is never zero.
+  Program::Impl* program = entry->program;
+  mpAtomicInc(&program->_refCount);
+  return program;
+}
+
+Error ProgramCache::put(const void* key, size_t size, uint32_t hVal, Program::Impl* program, Program::Impl** existing) noexcept {
+  *existing = nullptr;
+
+  if (size > ~static_cast<uint32_t>(0))
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  Entry* entry = static_cast<Entry*>(::malloc(sizeof(Entry) - sizeof(void*) + size));
+  if (entry == nullptr)
+    return MPSL_TRACE_ERROR(kErrorNoMemory);
+
+  entry->hashNext = nullptr;
+  entry->lruPrev = nullptr;
+  entry->lruNext = nullptr;
+  entry->program = program;
+  entry->hVal = hVal;
+  entry->keySize = static_cast<uint32_t>(size);
+  ::memcpy(entry->key, key, size);
+
+  Entry* evicted;
+  {
+    AutoSpinLock locked(_lock);
+
+    Entry* other = _find(key, size, hVal);
+    if (other != nullptr) {
+      Program::Impl* otherProgram = other->program;
+      mpAtomicInc(&otherProgram->_refCount);
+      *existing = otherProgram;
+      evicted = entry;
+      entry->program = nullptr;
+    }
+    else {
+      mpAtomicInc(&program->_refCount);
+
+      uint32_t hMod = hVal & (_bucketsCount - 1);
+      entry->hashNext = _buckets[hMod];
+      _buckets[hMod] = entry;
+
+      _linkLRU(entry);
+      if (++_count > _bucketsCount)
+        _rehash(_bucketsCount * 2);
+
+      evicted = (_limit != 0 && _count > _limit) ? _trim(_limit) : nullptr;
+    }
+  }
+
+  _releaseChain(evicted);
+  return kErrorOk;
+}
+
+void ProgramCache::setLimit(uint32_t limit) noexcept {
+  Entry* evicted;
+  {
+    AutoSpinLock locked(_lock);
+
+    _limit = limit;
+    evicted = (limit != 0 && _count > limit) ? _trim(limit) : nullptr;
+  }
+  _releaseChain(evicted);
+}
+
+void ProgramCache::clear() noexcept {
+  Entry* evicted;
+  {
+    AutoSpinLock locked(_lock);
+    evicted = _trim(0);
+  }
+  _releaseChain(evicted);
+}
+
+// ============================================================================
+// [mpsl::ProgramCache - Private]
+// ============================================================================
+
+ProgramCache::Entry* ProgramCache::_find(const void* key, size_t size, uint32_t hVal) const noexcept {
+  Entry* entry = _buckets[hVal & (_bucketsCount - 1)];
+
+  while (entry != nullptr) {
+    if (entry->hVal == hVal && entry->keySize == size && ::memcmp(entry->key, key, size) == 0)
+      return entry;
+    entry = entry->hashNext;
+  }
+
+  return nullptr;
+}
+
+void ProgramCache::_unlink(Entry* entry) noexcept {
+  Entry** pPrev = &_buckets[entry->hVal & (_bucketsCount - 1)];
+  Entry* p = *pPrev;
+
+  while (p != entry) {
+    MPSL_ASSERT(p != nullptr);
+    pPrev = &p->hashNext;
+    p = *pPrev;
+  }
+
+  *pPrev = entry->hashNext;
+  _unlinkLRU(entry);
+  _count--;
+}
+
+void ProgramCache::_unlinkLRU(Entry* entry) noexcept {
+  Entry* prev = entry->lruPrev;
+  Entry* next = entry->lruNext;
+
+  if (prev != nullptr)
+    prev->lruNext = next;
+  else
+    _lruFirst = next;
+
+  if (next != nullptr)
+    next->lruPrev = prev;
+  else
+    _lruLast = prev;
+
+  entry->lruPrev = nullptr;
+  entry->lruNext = nullptr;
+}
+
+void ProgramCache::_linkLRU(Entry* entry) noexcept {
+  Entry* first = _lruFirst;
+
+  entry->lruPrev = nullptr;
+  entry->lruNext = first;
+
+  if (first != nullptr)
+    first->lruPrev = entry;
+  else
+    _lruLast = entry;
+
+  _lruFirst = entry;
+}
+
+void ProgramCache::_rehash(uint32_t newCount) noexcept {
+  Entry** newBuckets = static_cast<Entry**>(::calloc(newCount, sizeof(Entry*)));
+
+  // Not fatal, the cache would just be slower.
+  if (newBuckets == nullptr)
+    return;
+
+  Entry** oldBuckets = _buckets;
+  uint32_t oldCount = _bucketsCount;
+
+  for (uint32_t i = 0; i < oldCount; i++) {
+    Entry* entry = oldBuckets[i];
+    while (entry != nullptr) {
+      Entry* next = entry->hashNext;
+      uint32_t hMod = entry->hVal & (newCount - 1);
+
+      entry->hashNext = newBuckets[hMod];
+      newBuckets[hMod] = entry;
+      entry = next;
+    }
+  }
+
+  if (oldBuckets != _embeddedBuckets)
+    ::free(oldBuckets);
+
+  _buckets = newBuckets;
+  _bucketsCount = newCount;
+}
+
+ProgramCache::Entry* ProgramCache::_trim(uint32_t limit) noexcept {
+  Entry* chain = nullptr;
+
+  while (_count > limit) {
+    Entry* entry = _lruLast;
+    _unlink(entry);
+
+    entry->hashNext = chain;
+    chain = entry;
+
+    if (limit != 0)
+      _evictions++;
+  }
+
+  return chain;
+}
+
+void ProgramCache::_releaseChain(Entry* chain) noexcept {
+  while (chain != nullptr) {
+    Entry* next = chain->hashNext;
+    if (chain->program != nullptr)
+      _releaseFunc(chain->program);
+
+    ::free(chain);
+    chain = next;
+  }
+}
+
+} // mpsl namespace
+
+// [Api-End]
+#include "./mpsl_apiend.h"
@@ -0,0 +1,141 @@
+// [MPSL]
+// MathPresso's Shading Language with JIT Engine for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _MPSL_MPCACHE_P_H
+#define _MPSL_MPCACHE_P_H
+
+// [Dependencies - MPSL]
+#include "./mpatomic_p.h"
+#include "./mpsl_p.h"
+
+// [Api-Begin]
+#include "./mpsl_apibegin.h"
+
+namespace mpsl {
+
+// ============================================================================
+// [mpsl::ProgramCache]
+// ============================================================================
+
+//! \internal
+//!
+//! Cache of compiled programs owned by `Context::Impl`.
+//!
+//! Each entry maps a binary key (serialized program body, layouts, number of
+//! arguments and options, see `Context::_compile()`) to a `Program::Impl`. The
+//! cache holds one reference of each stored program and keeps the entries in
+//! a LRU list, which is used to evict the least recently used programs when
+//! the number of entries exceeds the limit set by `setLimit()`.
+//!
+//! The cache is thread-safe. Keys are always compared byte-by-byte, the hash
+//! value (see `HashUtils::hashString()`) is only used to find the bucket.
+class ProgramCache {
+public:
+  MPSL_NONCOPYABLE(ProgramCache)
+
+  //! Function used to release a program that was removed from the cache.
+  typedef void (*ReleaseFunc)(Program::Impl* program);
+
+  struct Entry {
+    Entry* hashNext;                     //!< Next entry in the bucket.
+    Entry* lruPrev;                      //!< Previous (more recently used) entry.
+    Entry* lruNext;                      //!< Next (less recently used) entry.
+
+    Program::Impl* program;              //!< Cached program (holds a reference).
+    uint32_t hVal;                       //!< Hash value of the key.
+    uint32_t keySize;                    //!< Size of the key.
+    uint8_t key[sizeof(void*)];          //!< Key data (variable length).
+  };
+
+  enum {
+    kInitialBuckets = 16
+  };
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  ProgramCache(ReleaseFunc releaseFunc) noexcept;
+  ~ProgramCache() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Internal]
+  // --------------------------------------------------------------------------
+
+  MPSL_INLINE void destroy() noexcept {
+    this->~ProgramCache();
+    ::free(this);
+  }
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  void getStats(Context::CacheStats& out) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Interface]
+  // --------------------------------------------------------------------------
+
+  //! Find a program matching `key`, returns an add-ref'd program or null.
+  Program::Impl* get(const void* key, size_t size, uint32_t hVal) noexcept;
+
+  //! Store `program` under `key` and evict programs that exceed the limit.
+  //!
+  //! If an equal key is already present (compiled concurrently by another
+  //! thread) `program` is not stored and the already cached program is
+  //! returned through `existing` (add-ref'd) instead.
+  Error put(const void* key, size_t size, uint32_t hVal, Program::Impl* program, Program::Impl** existing) noexcept;
+
+  //! Set the maximum number of entries (0 means unlimited).
+  void setLimit(uint32_t limit) noexcept;
+  //! Remove all entries.
+  void clear() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Private]
+  // --------------------------------------------------------------------------
+
+  Entry* _find(const void* key, size_t size, uint32_t hVal) const noexcept;
+  void _unlink(Entry* entry) noexcept;
+  void _unlinkLRU(Entry* entry) noexcept;
+  void _linkLRU(Entry* entry) noexcept;
+  void _rehash(uint32_t newCount) noexcept;
+  //! Unlink all entries that exceed the limit and return them as a chain.
+  Entry* _trim(uint32_t limit) noexcept;
+  //! Release a chain of entries returned by `_trim()` (called without lock).
+  void _releaseChain(Entry* chain) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  SpinLock _lock;                        //!< Guards everything below.
+  ReleaseFunc _releaseFunc;              //!< Function used to release programs.
+
+  Entry** _buckets;                      //!< Hash buckets.
+  uint32_t _bucketsCount;                //!< Number of buckets (power of 2).
+  uint32_t _count;                       //!< Number of entries.
+  uint32_t _limit;                       //!< Maximum number of entries (0 if unlimited).
+
+  Entry* _lruFirst;                      //!< Most recently used entry.
+  Entry* _lruLast;                       //!< Least recently used entry.
+
+  uint64_t _hits;                        //!< Number of cache hits.
+  uint64_t _misses;                      //!< Number of cache misses.
+  uint64_t _evictions;                   //!< Number of evicted entries.
+
+  Entry* _embeddedBuckets[kInitialBuckets];
+};
+
+} // mpsl namespace
+
+// [Api-End]
+#include "./mpsl_apiend.h"
+
+// [Guard]
+#endif // _MPSL_MPCACHE_P_H
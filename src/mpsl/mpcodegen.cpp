@@ -72,6 +72,13 @@ static MPSL_INLINE bool mpIsValueLoHiEqual(const Value& val) noexcept {
   return (val.q[0] == val.q[2]) && (val.q[1] == val.q[3]);
 }
 
+// Get the alignment of an address `offset` bytes after an address aligned to
+// `alignment` (a power of 2).
+static MPSL_INLINE uint32_t mpAlignmentAt(uint32_t alignment, int32_t offset) noexcept {
+  uint32_t low = static_cast<uint32_t>(offset) & (0U - static_cast<uint32_t>(offset));
+  return (low == 0 || low >= alignment) ? alignment : low;
+}
+
 // ============================================================================
 // [mpsl::CodeGen - Construction / Destruction]
 // ============================================================================
@@ -82,9 +89,17 @@ CodeGen::CodeGen(AstBuilder* ast, IRBuilder* ir) noexcept
     _block(nullptr),
     _functionLevel(0),
     _hasV256(false),
+    _canOutline(true),
+    _inlineLimit(Globals::kDefaultInlineLimit),
+    _laneCount(ir->getLaneCount()),
     _hiddenRet(nullptr),
     _currentRet(),
+    _retBlock(nullptr),
+    _breakBlock(nullptr),
+    _continueBlock(nullptr),
     _nestedFunctions(ir->getHeap()),
+    _callCount(ir->getHeap()),
+    _funcMap(ir->getHeap()),
     _varMap(ir->getHeap()),
     _memMap(ir->getHeap()) {
   _hiddenRet = ast->getGlobalScope()->resolveSymbol(StringRef("@ret", 4));
@@ -96,23 +111,26 @@ CodeGen::~CodeGen() noexcept {}
 // ============================================================================
 
 Error CodeGen::onProgram(AstProgram* node, Result& out) noexcept {
-  AstNode** children = node->getChildren();
-  uint32_t i, count = node->getLength();
-
-  // Find the "main()" function and use it as an entry point.
-  for (i = 0; i < count; i++) {
-    AstNode* child = children[i];
-    if (child->getNodeType() == AstNode::kTypeFunction) {
-      AstFunction* func = static_cast<AstFunction*>(child);
-      if (func->getFunc()->eq("main", 4)) {
-        MPSL_PROPAGATE(_ir->initEntry());
-        _block = _ir->getEntry();
-        return onFunction(func, out);
-      }
-    }
+  // The number of calls decides which functions are called out-of-line.
+  MPSL_PROPAGATE(countCalls(node));
+
+  // The entry point is linked by `AstAnalysis`, it's the `main()` of the global
+  // scope (a `Pipeline` has also `main()` of each stage).
+  AstFunction* func = getAst()->getMainFunction();
+  if (func == nullptr)
+    return MPSL_TRACE_ERROR(kErrorNoEntryPoint);
+
+  MPSL_PROPAGATE(_ir->initEntry());
+  _block = _ir->getEntry();
+  MPSL_PROPAGATE(onFunction(func, out));
+
+  // All returns continue in `_retBlock`, which makes it the only exit.
+  if (_retBlock) {
+    MPSL_PROPAGATE(emitJump(_retBlock));
+    _block = _retBlock;
   }
 
-  return MPSL_TRACE_ERROR(kErrorNoEntryPoint);
+  return _ir->getExits().append(_ir->getHeap(), _block);
 }
 
 // NOTE: This is only called once per "main()". Other functions are simply
@@ -139,27 +157,140 @@ Error CodeGen::onBlock(AstBlock* node, Result& out) noexcept {
 }
 
 Error CodeGen::onBranch(AstBranch* node, Result& out) noexcept {
-  // TODO:
-  MPSL_ASSERT(!"Implemented");
+  // Lanes of a single invocation can take different paths, which would require
+  // masking all side effects. Branches are not supported in such case.
+  if (hasLanes())
+    return MPSL_TRACE_ERROR(kErrorInvalidProgram);
+
+  if (MPSL_UNLIKELY(!node->hasCond()))
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  IRReg* cond;
+  MPSL_PROPAGATE(emitCond(cond, node->getCond()));
+
+  IRBuilder* ir = getIR();
+  IRBlock* thenBlock = ir->newBlock();
+  MPSL_NULLCHECK(thenBlock);
+
+  IRBlock* elseBlock = nullptr;
+  if (node->hasElse()) {
+    elseBlock = ir->newBlock();
+    MPSL_NULLCHECK(elseBlock);
+  }
+
+  IRBlock* afterBlock = ir->newBlock();
+  MPSL_NULLCHECK(afterBlock);
+
+  MPSL_PROPAGATE(emitBranch(cond, thenBlock, elseBlock ? elseBlock : afterBlock));
+
+  _block = thenBlock;
+  if (node->hasThen()) {
+    Result noResult(false);
+    MPSL_PROPAGATE(onNode(node->getThen(), noResult));
+  }
+  MPSL_PROPAGATE(emitJump(afterBlock));
+
+  if (elseBlock) {
+    _block = elseBlock;
+
+    Result noResult(false);
+    MPSL_PROPAGATE(onNode(node->getElse(), noResult));
+    MPSL_PROPAGATE(emitJump(afterBlock));
+  }
+
+  _block = afterBlock;
   return kErrorOk;
 }
 
+// Loops are translated to the following blocks (`do-while` enters the body):
+//
+//   [Current] -> init, jmp Cond
+//   [Cond]    -> jnz cond, Body, After
+//   [Body]    -> body, jmp Iter
+//   [Iter]    -> iter, jmp Cond (only if the loop has `iter`, otherwise `Cond`
+//                is used as a target of both `continue` and the end of body)
+//   [After]   -> target of `break`
 Error CodeGen::onLoop(AstLoop* node, Result& out) noexcept {
-  // TODO:
-  MPSL_ASSERT(!"Implemented");
+  // See `onBranch()`.
+  if (hasLanes())
+    return MPSL_TRACE_ERROR(kErrorInvalidProgram);
+
+  if (node->hasInit()) {
+    Result noResult(false);
+    MPSL_PROPAGATE(onNode(node->getInit(), noResult));
+  }
+
+  IRBuilder* ir = getIR();
+  IRBlock* condBlock = ir->newBlock();
+  MPSL_NULLCHECK(condBlock);
+
+  IRBlock* bodyBlock = ir->newBlock();
+  MPSL_NULLCHECK(bodyBlock);
+
+  IRBlock* iterBlock = condBlock;
+  if (node->hasIter()) {
+    iterBlock = ir->newBlock();
+    MPSL_NULLCHECK(iterBlock);
+  }
+
+  IRBlock* afterBlock = ir->newBlock();
+  MPSL_NULLCHECK(afterBlock);
+
+  bool isDoWhile = node->getNodeType() == AstNode::kTypeDoWhile;
+  MPSL_PROPAGATE(emitJump(isDoWhile ? bodyBlock : condBlock));
+
+  _block = condBlock;
+  if (node->hasCond()) {
+    IRReg* cond;
+    MPSL_PROPAGATE(emitCond(cond, node->getCond()));
+    MPSL_PROPAGATE(emitBranch(cond, bodyBlock, afterBlock));
+  }
+  else {
+    MPSL_PROPAGATE(emitJump(bodyBlock));
+  }
+
+  IRBlock* prevBreak = _breakBlock;
+  IRBlock* prevContinue = _continueBlock;
+
+  _breakBlock = afterBlock;
+  _continueBlock = iterBlock;
+
+  _block = bodyBlock;
+  if (node->hasBody()) {
+    Result noResult(false);
+    MPSL_PROPAGATE(onNode(node->getBody(), noResult));
+  }
+  MPSL_PROPAGATE(emitJump(iterBlock));
+
+  if (node->hasIter()) {
+    _block = iterBlock;
+
+    Result noResult(false);
+    MPSL_PROPAGATE(onNode(node->getIter(), noResult));
+    MPSL_PROPAGATE(emitJump(condBlock));
+  }
+
+  _breakBlock = prevBreak;
+  _continueBlock = prevContinue;
+
+  _block = afterBlock;
   return kErrorOk;
 }
 
 Error CodeGen::onBreak(AstBreak* node, Result& out) noexcept {
-  // TODO:
-  MPSL_ASSERT(!"Implemented");
-  return kErrorOk;
+  if (MPSL_UNLIKELY(!_breakBlock))
+    return MPSL_TRACE_ERROR(kErrorInvalidProgram);
+
+  MPSL_PROPAGATE(emitJump(_breakBlock));
+  return newUnreachableBlock();
 }
 
 Error CodeGen::onContinue(AstContinue* node, Result& out) noexcept {
-  // TODO:
-  MPSL_ASSERT(!"Implemented");
-  return kErrorOk;
+  if (MPSL_UNLIKELY(!_continueBlock))
+    return MPSL_TRACE_ERROR(kErrorInvalidProgram);
+
+  MPSL_PROPAGATE(emitJump(_continueBlock));
+  return newUnreachableBlock();
 }
 
 Error CodeGen::onReturn(AstReturn* node, Result& out) noexcept {
@@ -167,33 +298,59 @@ Error CodeGen::onReturn(AstReturn* node, Result& out) noexcept {
     Result val(true);
     MPSL_PROPAGATE(onNode(node->getChild(), val));
 
-    uint32_t typeInfo = _hiddenRet->getTypeInfo();
-    uint32_t width = TypeInfo::widthOf(typeInfo);
+    uint32_t retTypeInfo = _hiddenRet->getTypeInfo();
+    uint32_t typeInfo = retTypeInfo;
+    MPSL_PROPAGATE(toLaneType(typeInfo));
 
     if (_functionLevel == 0) {
+      uint32_t slot = _hiddenRet->getDataSlot();
+
+      // A program that uses lanes can only return into a column.
+      if (hasLanes() && !getIR()->isLaneSlot(slot))
+        return MPSL_TRACE_ERROR(kErrorInvalidProgram);
+
       IRPair<IRReg> var;
       MPSL_PROPAGATE(asVar(var, val.result, typeInfo));
 
       IRPair<IRMem> mem;
-      MPSL_PROPAGATE(addrOfData(mem, DataSlot(_hiddenRet->getDataSlot(), _hiddenRet->getDataOffset()), width));
+      MPSL_PROPAGATE(addrOfMember(mem, DataSlot(slot, _hiddenRet->getDataOffset()), retTypeInfo));
       MPSL_PROPAGATE(emitStore(mem, var, typeInfo));
     }
     else {
-      _currentRet = val.result;
+      // The function is inlined, its return variable is created by `onCall()`.
+      typeInfo = node->getChild()->getTypeInfo();
+      MPSL_PROPAGATE(toLaneType(typeInfo));
+
+      IRPair<IRReg> var;
+      MPSL_PROPAGATE(asVar(var, val.result, typeInfo));
+      MPSL_PROPAGATE(emitMove(_currentRet, var, typeInfo));
     }
   }
 
-  return kErrorOk;
+  IRBlock* retBlock;
+  MPSL_PROPAGATE(getRetBlock(retBlock));
+  MPSL_PROPAGATE(emitJump(retBlock));
+  return newUnreachableBlock();
 }
 
 Error CodeGen::onVarDecl(AstVarDecl* node, Result& out) noexcept {
   uint32_t typeInfo = node->getTypeInfo();
+  MPSL_PROPAGATE(toLaneType(typeInfo));
+
   IRPair<IRReg> var;
 
   if (node->hasChild()) {
     Result exp(true);
     MPSL_PROPAGATE(onNode(node->getChild(), exp));
     MPSL_PROPAGATE(asVar(var, exp.result, typeInfo));
+
+    // Variables are mutable, a copy of another variable cannot share its register.
+    if (node->getChild()->isVar() && exp.result.lo->isReg()) {
+      IRPair<IRReg> copy;
+      MPSL_PROPAGATE(newVar(copy, typeInfo));
+      MPSL_PROPAGATE(emitMove(copy, var, typeInfo));
+      var = copy;
+    }
   }
   else {
     MPSL_PROPAGATE(newVar(var, typeInfo));
@@ -209,18 +366,14 @@ Error CodeGen::onVarMemb(AstVarMemb* node, Result& out) noexcept {
     return MPSL_TRACE_ERROR(kErrorInvalidState);
   AstVar* child = static_cast<AstVar*>(childNode);
 
-  uint32_t typeInfo = node->getTypeInfo();
-  uint32_t width = TypeInfo::widthOf(typeInfo);
-  return addrOfData(out.result, DataSlot(child->getSymbol()->getDataSlot(), node->getOffset()), width);
+  return addrOfMember(out.result, DataSlot(child->getSymbol()->getDataSlot(), node->getOffset()), node->getTypeInfo());
 }
 
 Error CodeGen::onVar(AstVar* node, Result& out) noexcept {
   AstSymbol* symbol = node->getSymbol();
 
   if (symbol->getDataSlot() != kInvalidDataSlot) {
-    uint32_t typeInfo = node->getTypeInfo();
-    uint32_t width = TypeInfo::widthOf(typeInfo);
-    return addrOfData(out.result, DataSlot(symbol->getDataSlot(), symbol->getDataOffset()), width);
+    return addrOfMember(out.result, DataSlot(symbol->getDataSlot(), symbol->getDataOffset()), node->getTypeInfo());
   }
   else {
     out.result.set(_varMap.get(symbol));
@@ -230,7 +383,25 @@ Error CodeGen::onVar(AstVar* node, Result& out) noexcept {
 }
 
 Error CodeGen::onImm(AstImm* node, Result& out) noexcept {
-  return newImm(out.result, node->getValue(), node->getTypeInfo());
+  uint32_t typeInfo = node->getTypeInfo();
+  if (!hasLanes())
+    return newImm(out.result, node->getValue(), typeInfo);
+
+  // Broadcast the scalar to all lanes.
+  Value value = node->getValue();
+  uint32_t i;
+
+  if (TypeInfo::sizeOf(typeInfo & kTypeIdMask) == 4) {
+    for (i = 1; i < _laneCount; i++)
+      value.i[i] = value.i[0];
+  }
+  else {
+    for (i = 1; i < _laneCount; i++)
+      value.q[i] = value.q[0];
+  }
+
+  MPSL_PROPAGATE(toLaneType(typeInfo));
+  return newImm(out.result, value, typeInfo);
 }
 
 #define COMBINE_OP_TYPE(op, typeId) (((op) << 8) | ((typeId) << 4))
@@ -247,6 +418,8 @@ Error CodeGen::onUnaryOp(AstUnaryOp* node, Result& out) noexcept {
   uint32_t typeInfo = node->getTypeInfo();
   const OpInfo& op = OpInfo::get(node->getOp());
 
+  MPSL_PROPAGATE(toLaneType(typeInfo));
+
   IRPair<IRReg> var;
   MPSL_PROPAGATE(asVar(var, tmp.result, typeInfo));
 
@@ -300,11 +473,11 @@ Error CodeGen::onUnaryOp(AstUnaryOp* node, Result& out) noexcept {
 
       switch (COMBINE_OP_CAST(typeInfo & kTypeIdMask, fromId)) {
         case COMBINE_OP_CAST(kTypeFloat , kTypeDouble): instCode = kInstCodeCvtdtof; break;
-        case COMBINE_OP_CAST(kTypeFloat , kTypeInt   ): instCode = kInstCodeCvtdtoi; break;
+        case COMBINE_OP_CAST(kTypeFloat , kTypeInt   ): instCode = kInstCodeCvtitof; break;
         case COMBINE_OP_CAST(kTypeDouble, kTypeFloat ): instCode = kInstCodeCvtftod; break;
-        case COMBINE_OP_CAST(kTypeDouble, kTypeInt   ): instCode = kInstCodeCvtftoi; break;
-        case COMBINE_OP_CAST(kTypeInt   , kTypeFloat ): instCode = kInstCodeCvtitof; break;
-        case COMBINE_OP_CAST(kTypeInt   , kTypeDouble): instCode = kInstCodeCvtitod; break;
+        case COMBINE_OP_CAST(kTypeDouble, kTypeInt   ): instCode = kInstCodeCvtitod; break;
+        case COMBINE_OP_CAST(kTypeInt   , kTypeFloat ): instCode = kInstCodeCvtftoi; break;
+        case COMBINE_OP_CAST(kTypeInt   , kTypeDouble): instCode = kInstCodeCvtdtoi; break;
 
         default:
           return MPSL_TRACE_ERROR(kErrorInvalidState);
@@ -351,12 +524,21 @@ Error CodeGen::onBinaryOp(AstBinaryOp* node, Result& out) noexcept {
   uint32_t typeInfo = node->getTypeInfo();
   const OpInfo& op = OpInfo::get(node->getOp());
 
+  MPSL_PROPAGATE(toLaneType(typeInfo));
+
   IRPair<IRReg> result;
   IRPair<IRReg> lVar;
   IRPair<IRReg> rVar;
   MPSL_PROPAGATE(newVar(result, typeInfo));
 
-  uint32_t instCode = op.getInstByTypeId(typeInfo & kTypeIdMask);
+  // Operands of a comparison keep their type, only the result is a boolean.
+  uint32_t opTypeInfo = typeInfo;
+  if (op.isConditional() && !op.isLogical()) {
+    opTypeInfo = node->getLeft()->getTypeInfo();
+    MPSL_PROPAGATE(toLaneType(opTypeInfo));
+  }
+
+  uint32_t instCode = op.getInstByTypeId(opTypeInfo & kTypeIdMask);
   if (op.isAssignment()) {
     if (op.getType() == kOpAssign) {
       // Pure assignment operator `=`.
@@ -365,7 +547,7 @@ Error CodeGen::onBinaryOp(AstBinaryOp* node, Result& out) noexcept {
       if (lValue.result.lo->isMem())
         MPSL_PROPAGATE(emitStore(lValue.result, rVar, typeInfo));
       else
-        MPSL_PROPAGATE(emitMove(lVar, rVar, typeInfo));
+        MPSL_PROPAGATE(emitMove(reinterpret_cast<IRPair<IRReg>&>(lValue.result), rVar, typeInfo));
 
       if (out.dependsOnResult) {
         MPSL_PROPAGATE(emitMove(result, rVar, typeInfo));
@@ -399,9 +581,9 @@ Error CodeGen::onBinaryOp(AstBinaryOp* node, Result& out) noexcept {
       MPSL_PROPAGATE(emitInst3(instCode, result, lVar, rValue.result, typeInfo));
     }
     else {
-      MPSL_PROPAGATE(asVar(lVar, lValue.result, typeInfo));
-      MPSL_PROPAGATE(asVar(rVar, rValue.result, typeInfo));
-      MPSL_PROPAGATE(emitInst3(instCode, result, lVar, rVar, typeInfo));
+      MPSL_PROPAGATE(asVar(lVar, lValue.result, opTypeInfo));
+      MPSL_PROPAGATE(asVar(rVar, rValue.result, opTypeInfo));
+      MPSL_PROPAGATE(emitInst3(instCode, result, lVar, rVar, opTypeInfo));
     }
 
     out.result.set(result);
@@ -413,6 +595,160 @@ Error CodeGen::onBinaryOp(AstBinaryOp* node, Result& out) noexcept {
 #undef COMBINE_OP_TYPE
 #undef COMBINE_OP_CAST
 
+Error CodeGen::onIndex(AstIndex* node, Result& out) noexcept {
+  AstNode* left = node->getLeft();
+  AstSymbol* sym;
+  int32_t offset;
+
+  if (left->getNodeType() == AstNode::kTypeVarMemb) {
+    AstVarMemb* memb = static_cast<AstVarMemb*>(left);
+    sym = static_cast<AstVar*>(memb->getChild())->getSymbol();
+    offset = memb->getOffset();
+  }
+  else if (left->getNodeType() == AstNode::kTypeVar) {
+    sym = static_cast<AstVar*>(left)->getSymbol();
+    offset = sym->getDataOffset();
+  }
+  else {
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+  }
+
+  Result index(true);
+  MPSL_PROPAGATE(onNode(node->getRight(), index));
+
+  IRBuilder* ir = getIR();
+  IRBlock* block = getBlock();
+
+  uint32_t slot = sym->getDataSlot();
+  uint32_t arrayInfo = left->getTypeInfo();
+  uint32_t typeInfo = node->getTypeInfo();
+  uint32_t stride = mpArrayStride(arrayInfo);
+  int32_t last = static_cast<int32_t>(node->getElementCount() - 1);
+
+  // A constant index addresses the element directly, like a member.
+  if (index.result.lo->isImm() && (arrayInfo & kTypeIndirect) == 0) {
+    int32_t i = index.result.lo->as<IRImm>()->getValue().i[0];
+    i = i < 0 ? 0 : i > last ? last : i;
+    return addrOfMember(out.result, DataSlot(slot, offset + i * static_cast<int32_t>(stride)), typeInfo | (arrayInfo & kTypePadded));
+  }
+
+  IRReg* base = ir->getDataPtr(slot);
+  MPSL_NULLCHECK(base);
+  uint32_t alignment = mpAlignmentAt(mpAlignmentAt(ir->getDataAlignment(slot), offset), static_cast<int32_t>(stride));
+
+  // The pointer of an indirect array is fetched, its alignment is unknown.
+  if (arrayInfo & kTypeIndirect) {
+    IRMem* mem = ir->newMem(base, nullptr, offset);
+    MPSL_NULLCHECK(mem);
+
+    base = ir->newVar(IRReg::kKindGp, kPointerWidth);
+    MPSL_NULLCHECK(base);
+    MPSL_PROPAGATE(ir->emitInst(block, kPointerWidth == 8 ? kInstCodeFetch64 : kInstCodeFetch32, base, mem));
+
+    offset = 0;
+    alignment = 1;
+  }
+
+  // Clamp the index so the program never reads outside of the array.
+  uint32_t indexInfo = kTypeInt;
+  MPSL_PROPAGATE(toLaneType(indexInfo));
+
+  IRPair<IRReg> var;
+  IRPair<IRReg> limits[2];
+  int32_t limitValues[2] = { 0, last };
+
+  MPSL_PROPAGATE(asVar(var, index.result, indexInfo));
+  for (uint32_t i = 0; i < 2; i++) {
+    Value value;
+    value.q.set(0);
+    for (uint32_t j = 0; j < _laneCount; j++)
+      value.i[j] = limitValues[i];
+
+    IRPair<IRObject> imm;
+    MPSL_PROPAGATE(newImm(imm, value, indexInfo));
+    MPSL_PROPAGATE(asVar(limits[i], imm, indexInfo));
+  }
+
+  IRPair<IRReg> clamped;
+  MPSL_PROPAGATE(newVar(clamped, indexInfo));
+  MPSL_PROPAGATE(emitInst3(kInstCodePmaxsd, clamped, var, limits[0], indexInfo));
+  MPSL_PROPAGATE(emitInst3(kInstCodePminsd, clamped, clamped, limits[1], indexInfo));
+
+  if (!hasLanes()) {
+    // Strides above 8 can't be encoded as a scale, the index is shifted by the
+    // rest. It's zero extended to a pointer-sized register as it's positive.
+    uint32_t shift = mpBitCtz(stride);
+    if (shift > 3) {
+      Value value;
+      value.q.set(0);
+      value.i[0] = static_cast<int32_t>(shift - 3);
+
+      IRPair<IRObject> imm;
+      MPSL_PROPAGATE(newImm(imm, value, indexInfo));
+      MPSL_PROPAGATE(emitInst3(kInstCodePslld, clamped, clamped, imm, indexInfo));
+      shift = 3;
+    }
+
+    IRReg* ptrIndex = ir->newVar(IRReg::kKindGp, kPointerWidth);
+    MPSL_NULLCHECK(ptrIndex);
+    MPSL_PROPAGATE(ir->emitInst(block, kInstCodeMov32, ptrIndex, clamped.lo));
+
+    IRMem* lo = ir->newMem(base, ptrIndex, offset, shift);
+    IRMem* hi = nullptr;
+    MPSL_NULLCHECK(lo);
+    lo->setAlignment(alignment);
+
+    if (needSplit(TypeInfo::widthOf(typeInfo))) {
+      hi = ir->newMem(base, ptrIndex, offset + 16, shift);
+      MPSL_NULLCHECK(hi);
+      hi->setAlignment(mpAlignmentAt(alignment, 16));
+    }
+
+    // The padding follows the last element, see `mpPaddedAccess()`.
+    if (arrayInfo & kTypePadded)
+      (hi ? hi : lo)->setPadding(TypeInfo::sizeOf(typeInfo & kTypeIdMask));
+
+    return out.result.set(lo, hi);
+  }
+  else {
+    // Each lane reads its own element, which is gathered. Only arrays of
+    // scalars can be indexed as lanes are scalars, see `toLaneType()`.
+    uint32_t laneInfo = typeInfo;
+    MPSL_PROPAGATE(toLaneType(laneInfo));
+
+    uint32_t size = TypeInfo::sizeOf(typeInfo & kTypeIdMask);
+    uint32_t instCode = size == 4 ? kInstCodeGather32 : kInstCodeGather64;
+    uint32_t shift = size == 4 ? 2 : 3;
+
+    IRPair<IRReg> dst;
+    MPSL_PROPAGATE(newVar(dst, laneInfo));
+
+    IRMem* lo = ir->newMem(base, clamped.lo, offset, shift);
+    MPSL_NULLCHECK(lo);
+    MPSL_PROPAGATE(ir->emitInst(block, instCode, dst.lo, lo));
+
+    // The high half of split lanes is gathered by the high half of indexes.
+    if (dst.hi) {
+      Value shufValue;
+      shufValue.q.set(0);
+      shufValue.i[0] = 0xEE;
+
+      IRImm* msk = ir->newImm(shufValue, IRReg::kKindNone, 4);
+      IRReg* hiIndex = ir->newVar(IRReg::kKindVec, 16);
+
+      MPSL_NULLCHECK(msk);
+      MPSL_NULLCHECK(hiIndex);
+      MPSL_PROPAGATE(ir->emitInst(block, kInstCodePshufd | kInstVec128, hiIndex, clamped.lo, msk));
+
+      IRMem* hi = ir->newMem(base, hiIndex, offset, shift);
+      MPSL_NULLCHECK(hi);
+      MPSL_PROPAGATE(ir->emitInst(block, instCode, dst.hi, hi));
+    }
+
+    return out.result.set(dst);
+  }
+}
+
 Error CodeGen::onCall(AstCall* node, Result& out) noexcept {
   uint32_t i;
 
@@ -437,6 +773,41 @@ Error CodeGen::onCall(AstCall* node, Result& out) noexcept {
   if (MPSL_UNLIKELY(fArgsCount < cArgsCount))
     return MPSL_TRACE_ERROR(kErrorInvalidState);
 
+  IRFunc* irFunc;
+  MPSL_PROPAGATE(getOutlinedFunc(irFunc, func, node));
+
+  if (irFunc) {
+    IRRegs args;
+
+    for (i = 0; i < cArgsCount; i++) {
+      Result value(true);
+      MPSL_PROPAGATE(onNode(node->getAt(i), value));
+
+      uint32_t argTypeInfo = fArgsDecl->getAt(i)->getTypeInfo();
+      MPSL_PROPAGATE(toLaneType(argTypeInfo));
+
+      // The callee never modifies its arguments, no copy is needed.
+      IRPair<IRReg> var;
+      MPSL_PROPAGATE(asVar(var, value.result, argTypeInfo));
+      MPSL_PROPAGATE(args.append(getHeap(), var.lo));
+    }
+
+    uint32_t retTypeInfo = node->getTypeInfo();
+    MPSL_PROPAGATE(toLaneType(retTypeInfo));
+
+    IRPair<IRReg> ret;
+    MPSL_PROPAGATE(newVar(ret, retTypeInfo));
+
+    IRInst* inst = getIR()->newCall(ret.lo, irFunc, args.getData(), cArgsCount);
+    args.release(getHeap());
+
+    MPSL_NULLCHECK(inst);
+    MPSL_PROPAGATE(getBlock()->append(inst));
+
+    out.result.set(ret);
+    return kErrorOk;
+  }
+
   // Translate all function arguments to IR.
   for (i = 0; i < cArgsCount; i++) {
     Result value(argsUsed);
@@ -444,8 +815,19 @@ Error CodeGen::onCall(AstCall* node, Result& out) noexcept {
     AstVarDecl* argDecl = static_cast<AstVarDecl*>(fArgsDecl->getAt(i));
     MPSL_PROPAGATE(onNode(node->getAt(i), value));
 
+    uint32_t argTypeInfo = argDecl->getTypeInfo();
+    MPSL_PROPAGATE(toLaneType(argTypeInfo));
+
     IRPair<IRReg> var;
-    MPSL_PROPAGATE(asVar(var, value.result, argDecl->getTypeInfo()));
+    MPSL_PROPAGATE(asVar(var, value.result, argTypeInfo));
+
+    // Arguments are mutable, see `onVarDecl()`.
+    if (node->getAt(i)->isVar() && value.result.lo && value.result.lo->isReg()) {
+      IRPair<IRReg> copy;
+      MPSL_PROPAGATE(newVar(copy, argTypeInfo));
+      MPSL_PROPAGATE(emitMove(copy, var, argTypeInfo));
+      var = copy;
+    }
 
     mapVarToAst(argDecl->getSymbol(), var);
   }
@@ -457,22 +839,51 @@ Error CodeGen::onCall(AstCall* node, Result& out) noexcept {
     AstVarDecl* argDecl = static_cast<AstVarDecl*>(fArgsDecl->getAt(i));
     MPSL_PROPAGATE(onNode(argDecl, value));
 
+    uint32_t argTypeInfo = argDecl->getTypeInfo();
+    MPSL_PROPAGATE(toLaneType(argTypeInfo));
+
     IRPair<IRReg> var;
-    MPSL_PROPAGATE(asVar(var, value.result, argDecl->getTypeInfo()));
+    MPSL_PROPAGATE(asVar(var, value.result, argTypeInfo));
 
     mapVarToAst(argDecl->getSymbol(), var);
     i++;
   }
 
-  // Emit the function body.
+  // Emit the function body, all its returns continue in a new `_retBlock`.
   if (func->hasBody()) {
+    IRPair<IRReg> prevRet = _currentRet;
+    IRBlock* prevRetBlock = _retBlock;
+    IRBlock* prevBreak = _breakBlock;
+    IRBlock* prevContinue = _continueBlock;
+
+    _currentRet.reset();
+    _retBlock = nullptr;
+    _breakBlock = nullptr;
+    _continueBlock = nullptr;
+
+    uint32_t retTypeInfo = node->getTypeInfo();
+    MPSL_PROPAGATE(toLaneType(retTypeInfo));
+
+    if ((retTypeInfo & kTypeIdMask) != kTypeVoid)
+      MPSL_PROPAGATE(newVar(_currentRet, retTypeInfo));
+
     _functionLevel++;
     MPSL_PROPAGATE(_nestedFunctions.put(func));
     MPSL_PROPAGATE(onNode(func->getBody(), out));
 
     _functionLevel--;
     _nestedFunctions.del(func);
-    out.result = _currentRet;
+
+    if (_retBlock) {
+      MPSL_PROPAGATE(emitJump(_retBlock));
+      _block = _retBlock;
+    }
+    out.result.set(_currentRet);
+
+    _currentRet = prevRet;
+    _retBlock = prevRetBlock;
+    _breakBlock = prevBreak;
+    _continueBlock = prevContinue;
   }
 
   return kErrorOk;
@@ -482,6 +893,167 @@ Error CodeGen::onCall(AstCall* node, Result& out) noexcept {
 // [mpsl::CodeGen - Utilities]
 // ============================================================================
 
+// Maximum depth of nested calls measured by `mpMeasureNode()`, deeper calls are
+// considered too big to be inlined.
+static const uint32_t kMaxMeasureDepth = 8;
+
+// Measure the size of `node` including bodies of all functions it calls and
+// clear `pure` if it accesses anything else than its own variables.
+static void mpMeasureNode(const AstNode* node, uint32_t& size, bool& pure, uint32_t depth) noexcept {
+  if (node == nullptr)
+    return;
+
+  size++;
+  switch (node->getNodeType()) {
+    case AstNode::kTypeVarMemb: {
+      pure = false;
+      break;
+    }
+
+    case AstNode::kTypeVar: {
+      const AstSymbol* sym = static_cast<const AstVar*>(node)->getSymbol();
+      if (sym->getDataSlot() != kInvalidDataSlot || sym->isGlobal())
+        pure = false;
+      break;
+    }
+
+    case AstNode::kTypeCall: {
+      const AstSymbol* sym = static_cast<const AstCall*>(node)->getSymbol();
+      const AstNode* func = sym ? sym->getNode() : nullptr;
+
+      if (func && func->getNodeType() == AstNode::kTypeFunction) {
+        if (depth >= kMaxMeasureDepth)
+          size += 0x10000;
+        else
+          mpMeasureNode(static_cast<const AstFunction*>(func)->getBody(), size, pure, depth + 1);
+      }
+      break;
+    }
+  }
+
+  AstNode** children = node->getChildren();
+  for (uint32_t i = 0, count = node->getLength(); i < count; i++)
+    mpMeasureNode(children[i], size, pure, depth);
+}
+
+Error CodeGen::countCalls(AstNode* node) noexcept {
+  if (node == nullptr)
+    return kErrorOk;
+
+  if (node->getNodeType() == AstNode::kTypeCall) {
+    AstSymbol* sym = static_cast<AstCall*>(node)->getSymbol();
+    AstNode* func = sym ? sym->getNode() : nullptr;
+
+    if (func && func->getNodeType() == AstNode::kTypeFunction) {
+      uint32_t* count;
+      if (_callCount.get(static_cast<AstFunction*>(func), &count))
+        (*count)++;
+      else
+        MPSL_PROPAGATE(_callCount.put(static_cast<AstFunction*>(func), 1));
+    }
+  }
+
+  AstNode** children = node->getChildren();
+  for (uint32_t i = 0, count = node->getLength(); i < count; i++)
+    MPSL_PROPAGATE(countCalls(children[i]));
+
+  return kErrorOk;
+}
+
+// A call is out-of-line only if it saves code, which requires a function that
+// is bigger than `_inlineLimit` and called more than once. The function must
+// not access data (it has no data slots) and its arguments and return value
+// must fit into a single register. Small functions are always inlined so they
+// are optimized together with the code that calls them.
+Error CodeGen::getOutlinedFunc(IRFunc*& dst, AstFunction* func, AstCall* node) noexcept {
+  dst = _funcMap.get(func);
+  if (dst != nullptr || !_canOutline || !func->hasBody())
+    return kErrorOk;
+
+  AstBlock* argsDecl = func->getArgs();
+  uint32_t i, count = argsDecl->getLength();
+
+  if (_callCount.get(func) < 2 || node->getLength() != count)
+    return kErrorOk;
+
+  uint32_t retTypeInfo = node->getTypeInfo();
+  MPSL_PROPAGATE(toLaneType(retTypeInfo));
+
+  if ((retTypeInfo & kTypeIdMask) == kTypeVoid || needSplit(TypeInfo::widthOf(retTypeInfo)))
+    return kErrorOk;
+
+  for (i = 0; i < count; i++) {
+    uint32_t argTypeInfo = argsDecl->getAt(i)->getTypeInfo();
+    MPSL_PROPAGATE(toLaneType(argTypeInfo));
+
+    if (needSplit(TypeInfo::widthOf(argTypeInfo)))
+      return kErrorOk;
+  }
+
+  uint32_t size = 0;
+  bool pure = true;
+
+  mpMeasureNode(func->getBody(), size, pure, 0);
+  if (size <= _inlineLimit || !pure)
+    return kErrorOk;
+
+  IRFunc* irFunc = getIR()->newFunc();
+  MPSL_NULLCHECK(irFunc);
+
+  CodeGen codeGen(getAst(), irFunc->getBody());
+  codeGen._hasV256 = _hasV256;
+  codeGen._canOutline = false;
+
+  MPSL_PROPAGATE(codeGen.emitOutlinedBody(irFunc, func, retTypeInfo));
+  MPSL_PROPAGATE(_funcMap.put(func, irFunc));
+
+  dst = irFunc;
+  return kErrorOk;
+}
+
+Error CodeGen::emitOutlinedBody(IRFunc* irFunc, AstFunction* func, uint32_t retTypeInfo) noexcept {
+  IRBuilder* ir = getIR();
+  MPSL_PROPAGATE(ir->initEntry());
+  _block = ir->getEntry();
+
+  AstBlock* argsDecl = func->getArgs();
+  for (uint32_t i = 0, count = argsDecl->getLength(); i < count; i++) {
+    AstVarDecl* argDecl = static_cast<AstVarDecl*>(argsDecl->getAt(i));
+
+    uint32_t argTypeInfo = argDecl->getTypeInfo();
+    MPSL_PROPAGATE(toLaneType(argTypeInfo));
+
+    IRPair<IRReg> arg;
+    MPSL_PROPAGATE(newVar(arg, argTypeInfo));
+    MPSL_PROPAGATE(irFunc->addArg(arg.lo));
+
+    // Arguments are mutable, the body works with a copy so the argument itself
+    // is only defined by the call.
+    IRPair<IRReg> copy;
+    MPSL_PROPAGATE(newVar(copy, argTypeInfo));
+    MPSL_PROPAGATE(emitMove(copy, arg, argTypeInfo));
+    MPSL_PROPAGATE(mapVarToAst(argDecl->getSymbol(), copy));
+  }
+
+  MPSL_PROPAGATE(newVar(_currentRet, retTypeInfo));
+  irFunc->setRet(_currentRet.lo->getReg(), _currentRet.lo->getWidth());
+
+  _functionLevel++;
+  MPSL_PROPAGATE(_nestedFunctions.put(func));
+
+  Result unused(false);
+  MPSL_PROPAGATE(onNode(func->getBody(), unused));
+
+  if (_retBlock) {
+    MPSL_PROPAGATE(emitJump(_retBlock));
+    _block = _retBlock;
+  }
+
+  // `ret` uses the returned value, so it's kept up to date by all passes.
+  MPSL_PROPAGATE(ir->emitInst(_block, kInstCodeRet, _currentRet.lo));
+  return ir->getExits().append(ir->getHeap(), _block);
+}
+
 Error CodeGen::mapVarToAst(AstSymbol* sym, IRPair<IRReg> var) noexcept {
   IRPair<IRReg>* existing;
 
@@ -492,6 +1064,19 @@ Error CodeGen::mapVarToAst(AstSymbol* sym, IRPair<IRReg> var) noexcept {
   return kErrorOk;
 }
 
+Error CodeGen::toLaneType(uint32_t& typeInfo) noexcept {
+  if (!hasLanes() || (typeInfo & kTypeIdMask) == kTypeVoid)
+    return kErrorOk;
+
+  // Lanes are only supported by programs that use scalars, vectors would
+  // require a transposition which is not implemented.
+  if (TypeInfo::isVectorType(typeInfo))
+    return MPSL_TRACE_ERROR(kErrorInvalidProgram);
+
+  typeInfo = (typeInfo & ~kTypeVecMask) | (_laneCount << kTypeVecShift);
+  return kErrorOk;
+}
+
 Error CodeGen::newVar(IRPair<IRObject>& dst, uint32_t typeInfo) noexcept {
   uint32_t width = TypeInfo::widthOf(typeInfo);
 
@@ -547,11 +1132,13 @@ Error CodeGen::newImm(IRPair<IRObject>& dst, const Value& value, uint32_t typeIn
   }
 }
 
-Error CodeGen::addrOfData(IRPair<IRObject>& dst, DataSlot data, uint32_t width) noexcept {
-  IRReg* base = getIR()->getDataPtr(data.slot);
+Error CodeGen::addrOfData(IRPair<IRObject>& dst, DataSlot data, uint32_t width, uint32_t reduceOp) noexcept {
+  IRReg* base = reduceOp != kReduceNone ? getIR()->getReducePtr(data.slot, reduceOp) : getIR()->getDataPtr(data.slot);
+  MPSL_NULLCHECK(base);
 
   IRMem* lo = nullptr;
   IRMem* hi = nullptr;
+  uint32_t alignment = getIR()->getDataAlignment(data.slot);
 
   if (width > 16 && !hasV256()) {
     lo = getIR()->newMem(base, nullptr, data.offset);
@@ -559,16 +1146,121 @@ Error CodeGen::addrOfData(IRPair<IRObject>& dst, DataSlot data, uint32_t width)
 
     MPSL_NULLCHECK(lo);
     MPSL_NULLCHECK(hi);
+    hi->setAlignment(mpAlignmentAt(alignment, data.offset + 16));
   }
   else {
     lo = getIR()->newMem(base, nullptr, data.offset);
     MPSL_NULLCHECK(lo);
   }
 
+  lo->setAlignment(mpAlignmentAt(alignment, data.offset));
   dst.set(lo, hi);
   return kErrorOk;
 }
 
+// Mark `dst` as write-only if `typeInfo` is, its stores can bypass the cache,
+// see `kOptionStreamStores`.
+static MPSL_INLINE void mpSetWriteOnly(IRPair<IRObject>& dst, uint32_t typeInfo) noexcept {
+  if ((typeInfo & kTypeRW) != kTypeWrite)
+    return;
+
+  dst.lo->as<IRMem>()->setWriteOnly(true);
+  if (dst.hi)
+    dst.hi->as<IRMem>()->setWriteOnly(true);
+}
+
+Error CodeGen::addrOfMember(IRPair<IRObject>& dst, DataSlot data, uint32_t typeInfo) noexcept {
+  // Reductions are accessed through their own pointer, see `emitReduce()`.
+  uint32_t reduceOp = mpReduceOpOf(typeInfo);
+  if (reduceOp != kReduceNone || !hasLanes()) {
+    // A reduction would have to combine lanes and skip padding elements.
+    if (hasLanes())
+      return MPSL_TRACE_ERROR(kErrorInvalidProgram);
+    MPSL_PROPAGATE(addrOfData(dst, data, TypeInfo::widthOf(typeInfo), reduceOp));
+
+    // The padding follows the last element, see `mpPaddedAccess()`.
+    if (typeInfo & kTypePadded) {
+      IRObject* last = dst.hi ? dst.hi : dst.lo;
+      last->as<IRMem>()->setPadding(TypeInfo::sizeOf(typeInfo & kTypeIdMask));
+    }
+
+    // A narrow member is converted by `emitFetchX()` and `emitStoreX()`.
+    if (typeInfo & kTypeStorageMask)
+      dst.lo->as<IRMem>()->setStorage(typeInfo & (kTypeStorageMask | kTypeNormalized));
+
+    if (reduceOp == kReduceNone)
+      mpSetWriteOnly(dst, typeInfo);
+    return kErrorOk;
+  }
+
+  // Lanes are scalars, a narrow member is a vector, see `toLaneType()`.
+  if (typeInfo & kTypeStorageMask)
+    return MPSL_TRACE_ERROR(kErrorInvalidProgram);
+
+  IRBuilder* ir = getIR();
+  IRBlock* block = getBlock();
+
+  IRReg* base = ir->getDataPtr(data.slot);
+  IRMem* mem = ir->newMem(base, nullptr, data.offset);
+  MPSL_NULLCHECK(mem);
+
+  uint32_t size = TypeInfo::sizeOf(typeInfo & kTypeIdMask);
+  uint32_t laneTypeInfo = typeInfo;
+  MPSL_PROPAGATE(toLaneType(laneTypeInfo));
+
+  uint32_t laneWidth = TypeInfo::widthOf(laneTypeInfo);
+  bool split = needSplit(laneWidth);
+
+  if (ir->isLaneSlot(data.slot)) {
+    // Column - fetch its pointer and index it by the lane index.
+    IRReg* column = ir->newVar(IRReg::kKindGp, kPointerWidth);
+    MPSL_NULLCHECK(column);
+    MPSL_PROPAGATE(ir->emitInst(block, kPointerWidth == 8 ? kInstCodeFetch64 : kInstCodeFetch32, column, mem));
+
+    // The lane index is a multiple of the lane count, so all lanes are aligned
+    // as the column if it's aligned to their width.
+    uint32_t shift = size == 4 ? 2 : 3;
+    uint32_t alignment = mpAlignmentAt(ir->getDataAlignment(data.slot), static_cast<int32_t>(ir->getLaneCount() * size));
+
+    IRMem* lo = ir->newMem(column, ir->getLaneIndex(), 0, shift);
+    IRMem* hi = nullptr;
+    MPSL_NULLCHECK(lo);
+    lo->setAlignment(alignment);
+
+    if (split) {
+      hi = ir->newMem(column, ir->getLaneIndex(), 16, shift);
+      MPSL_NULLCHECK(hi);
+      hi->setAlignment(mpAlignmentAt(alignment, 16));
+    }
+
+    dst.set(lo, hi);
+    mpSetWriteOnly(dst, typeInfo);
+    return kErrorOk;
+  }
+  else {
+    // Uniform - fetch the scalar and broadcast it to all lanes. Uniforms are
+    // read-only in a program that uses lanes. A 256-bit `pshufd` of a scalar
+    // broadcasts it to both 128-bit halves.
+    uint32_t vecWidth = split ? 16 : laneWidth;
+    IRReg* scalar = ir->newVar(IRReg::kKindVec, size);
+    IRReg* vec = ir->newVar(IRReg::kKindVec, vecWidth);
+
+    MPSL_NULLCHECK(scalar);
+    MPSL_NULLCHECK(vec);
+    MPSL_PROPAGATE(ir->emitInst(block, size == 4 ? kInstCodeFetch32 : kInstCodeFetch64, scalar, mem));
+
+    Value shufValue;
+    shufValue.q.set(0);
+    shufValue.i[0] = size == 4 ? 0x00 : 0x44;
+
+    IRImm* msk = ir->newImm(shufValue, IRReg::kKindNone, 4);
+    MPSL_NULLCHECK(msk);
+    MPSL_PROPAGATE(ir->emitInst(block, kInstCodePshufd | (vecWidth > 16 ? kInstVec256 : kInstVec128), vec, scalar, msk));
+
+    return dst.set(vec, split ? vec : nullptr);
+  }
+}
+
 Error CodeGen::asVar(IRPair<IRObject>& out, IRPair<IRObject> in, uint32_t typeInfo) noexcept {
   if (in.lo == nullptr && in.hi == nullptr)
     return out.set(nullptr, nullptr);
@@ -596,7 +1288,11 @@ Error CodeGen::asVar(IRPair<IRObject>& out, IRPair<IRObject> in, uint32_t typeIn
       case IRObject::kTypeMem: {
         typeInfo = ti[i];
 
+        // Reductions can only be assigned, see `emitReduce()`.
         IRMem* mem = inObj->as<IRMem>();
+        if (getIR()->getReduceOp(mem->getBase()) != kReduceNone)
+          return MPSL_TRACE_ERROR(kErrorInvalidProgram);
+
         IRReg* var = getIR()->newVarByTypeInfo(typeInfo);
 
         MPSL_NULLCHECK(var);
@@ -623,6 +1319,50 @@ Error CodeGen::asVar(IRPair<IRObject>& out, IRPair<IRObject> in, uint32_t typeIn
   return kErrorOk;
 }
 
+Error CodeGen::emitCond(IRReg*& dst, AstNode* node) noexcept {
+  Result cond(true);
+  MPSL_PROPAGATE(onNode(node, cond));
+
+  IRPair<IRReg> var;
+  MPSL_PROPAGATE(asVar(var, cond.result, node->getTypeInfo()));
+
+  dst = var.lo;
+  return kErrorOk;
+}
+
+Error CodeGen::emitJump(IRBlock* target) noexcept {
+  IRBlock* block = getBlock();
+
+  MPSL_PROPAGATE(getIR()->emitInst(block, kInstCodeJmp, target));
+  return getIR()->connectBlocks(block, target);
+}
+
+Error CodeGen::emitBranch(IRReg* cond, IRBlock* taken, IRBlock* notTaken) noexcept {
+  IRBlock* block = getBlock();
+
+  MPSL_PROPAGATE(getIR()->emitInst(block, kInstCodeJnz, cond, taken, notTaken));
+  MPSL_PROPAGATE(getIR()->connectBlocks(block, taken));
+  return getIR()->connectBlocks(block, notTaken);
+}
+
+Error CodeGen::newUnreachableBlock() noexcept {
+  IRBlock* block = getIR()->newBlock();
+  MPSL_NULLCHECK(block);
+
+  _block = block;
+  return kErrorOk;
+}
+
+Error CodeGen::getRetBlock(IRBlock*& dst) noexcept {
+  if (!_retBlock) {
+    _retBlock = getIR()->newBlock();
+    MPSL_NULLCHECK(_retBlock);
+  }
+
+  dst = _retBlock;
+  return kErrorOk;
+}
+
 Error CodeGen::emitMove(IRPair<IRReg> dst, IRPair<IRReg> src, uint32_t typeInfo) noexcept {
   uint32_t width = TypeInfo::widthOf(typeInfo);
   IRBlock* block = getBlock();
@@ -636,6 +1376,10 @@ Error CodeGen::emitMove(IRPair<IRReg> dst, IRPair<IRReg> src, uint32_t typeInfo)
 Error CodeGen::emitStore(IRPair<IRObject> dst, IRPair<IRReg> src, uint32_t typeInfo) noexcept {
   uint32_t width = TypeInfo::widthOf(typeInfo);
 
+  uint32_t reduceOp = getIR()->getReduceOp(dst.lo->as<IRMem>()->getBase());
+  if (reduceOp != kReduceNone)
+    return emitReduce(dst, src, typeInfo, reduceOp);
+
   if (needSplit(width)) {
     uint32_t loTI, hiTI;
     mpSplitTypeInfo(loTI, hiTI, typeInfo);
@@ -650,6 +1394,35 @@ Error CodeGen::emitStore(IRPair<IRObject> dst, IRPair<IRReg> src, uint32_t typeI
   }
 }
 
+Error CodeGen::emitReduce(IRPair<IRObject> dst, IRPair<IRReg> src, uint32_t typeInfo, uint32_t reduceOp) noexcept {
+  static const uint8_t reduceOpTable[kReduceCount] = { kOpNone, kOpAdd, kOpMin, kOpMax };
+  uint32_t instCode = OpInfo::get(reduceOpTable[reduceOp]).getInstByTypeId(typeInfo & kTypeIdMask);
+
+  if (instCode == kInstCodeNone)
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  uint32_t ti[2] = { typeInfo, kTypeVoid };
+  if (needSplit(TypeInfo::widthOf(typeInfo)))
+    mpSplitTypeInfo(ti[0], ti[1], typeInfo);
+
+  // The member is fetched, combined, and stored back. It's a plain memory
+  // access for IR passes, the backend replaces it by a register in a batch.
+  for (uint32_t i = 0; i < 2; i++) {
+    if (src.obj[i] == nullptr)
+      continue;
+
+    IRMem* mem = dst.obj[i]->as<IRMem>();
+    IRReg* acc = getIR()->newVarByTypeInfo(ti[i]);
+    MPSL_NULLCHECK(acc);
+
+    MPSL_PROPAGATE(emitFetchX(acc, mem, ti[i]));
+    MPSL_PROPAGATE(getIR()->emitInst(getBlock(), instCode | mpGetVecFlags(ti[i]), acc, acc, src.obj[i]));
+    MPSL_PROPAGATE(emitStoreX(mem, acc, ti[i]));
+  }
+
+  return kErrorOk;
+}
+
 Error CodeGen::emitInst2(uint32_t instCode,
   IRPair<IRObject> o0,
   IRPair<IRObject> o1, uint32_t typeInfo) noexcept {
@@ -691,7 +1464,26 @@ Error CodeGen::emitInst3(uint32_t instCode,
   }
 }
 
+// Get the instruction that accesses `mem` by `instCode` including its padding,
+// which replaces 96-bit and 192-bit accesses that need two instructions.
+static MPSL_INLINE uint32_t mpPaddedAccess(uint32_t instCode, const IRMem* mem) noexcept {
+  uint32_t padding = mem->getPadding();
+
+  switch (instCode) {
+    case kInstCodeFetch96 : return padding >= 4 ? static_cast<uint32_t>(kInstCodeFetch128) : instCode;
+    case kInstCodeStore96 : return padding >= 4 ? static_cast<uint32_t>(kInstCodeStore128) : instCode;
+    case kInstCodeFetch192: return padding >= 8 ? static_cast<uint32_t>(kInstCodeFetch256) : instCode;
+    case kInstCodeStore192: return padding >= 8 ? static_cast<uint32_t>(kInstCodeStore256) : instCode;
+
+    default:
+      return instCode;
+  }
+}
+
 Error CodeGen::emitFetchX(IRReg* dst, IRMem* src, uint32_t typeInfo) noexcept {
+  if (src->getStorage() != 0)
+    return emitFetchStorage(dst, src, typeInfo);
+
   uint32_t instCode = kInstCodeNone;
   switch (typeInfo & (kTypeIdMask | kTypeVecMask)) {
     case kTypeBool   : instCode = kInstCodeFetch32; break;
@@ -731,10 +1523,15 @@ Error CodeGen::emitFetchX(IRReg* dst, IRMem* src, uint32_t typeInfo) noexcept {
       return MPSL_TRACE_ERROR(kErrorInvalidState);
   }
 
+  // A padded member is read by a single full-width fetch.
+  instCode = mpPaddedAccess(instCode, src);
   return getIR()->emitInst(getBlock(), instCode, dst, src);
 }
 
 Error CodeGen::emitStoreX(IRMem* dst, IRReg* src, uint32_t typeInfo) noexcept {
+  if (dst->getStorage() != 0)
+    return emitStoreStorage(dst, src, typeInfo);
+
   uint32_t instCode = kInstCodeNone;
   switch (typeInfo & (kTypeIdMask | kTypeVecMask)) {
     case kTypeBool   : instCode = kInstCodeStore32; break;
@@ -774,10 +1571,118 @@ Error CodeGen::emitStoreX(IRMem* dst, IRReg* src, uint32_t typeInfo) noexcept {
       return MPSL_TRACE_ERROR(kErrorInvalidState);
   }
 
+  // A padded member is written by a single full-width store.
+  instCode = mpPaddedAccess(instCode, dst);
   MPSL_PROPAGATE(getIR()->emitInst(getBlock(), instCode, dst, src));
   return kErrorOk;
 }
 
+// Get an immediate `float4` that has all elements set to `x`.
+static MPSL_INLINE IRImm* mpNewFloat4Imm(IRBuilder* ir, float x) noexcept {
+  Value value;
+  value.f.set(x);
+  return ir->newImmByTypeInfo(value, kTypeFloat4);
+}
+
+Error CodeGen::emitFetchStorage(IRReg* dst, IRMem* src, uint32_t typeInfo) noexcept {
+  IRBuilder* ir = getIR();
+  IRBlock* block = getBlock();
+
+  uint32_t storage = src->getStorage();
+  uint32_t format = storage & kTypeStorageMask;
+  bool isFloat = (typeInfo & kTypeIdMask) == kTypeFloat;
+
+  IRReg* raw = ir->newVar(IRReg::kKindVec, 16);
+  MPSL_NULLCHECK(raw);
+  MPSL_PROPAGATE(ir->emitInst(block, format == kTypeStorageU8 ? kInstCodeFetch32 : kInstCodeFetch64, raw, src));
+
+  if (format == kTypeStorageF16)
+    return ir->emitInst(block, kInstCodeCvthtof | kInstVec128, dst, raw);
+
+  // Bytes are widened to words first, `pmovzx` only reads its second source.
+  if (format == kTypeStorageU8) {
+    IRReg* words = ir->newVar(IRReg::kKindVec, 16);
+    MPSL_NULLCHECK(words);
+    MPSL_PROPAGATE(ir->emitInst(block, kInstCodePmovzxbw | kInstVec128, words, raw, raw));
+    raw = words;
+  }
+
+  if (!isFloat)
+    return ir->emitInst(block, kInstCodePmovzxwd | kInstVec128, dst, raw, raw);
+
+  IRReg* ints = ir->newVar(IRReg::kKindVec, 16);
+  MPSL_NULLCHECK(ints);
+  MPSL_PROPAGATE(ir->emitInst(block, kInstCodePmovzxwd | kInstVec128, ints, raw, raw));
+  MPSL_PROPAGATE(ir->emitInst(block, kInstCodeCvtitof | kInstVec128, dst, ints));
+
+  if ((storage & kTypeNormalized) == 0)
+    return kErrorOk;
+
+  IRImm* scale = mpNewFloat4Imm(ir, format == kTypeStorageU8 ? 1.0f / 255.0f : 1.0f / 65535.0f);
+  MPSL_NULLCHECK(scale);
+  return ir->emitInst(block, kInstCodeMulf | kInstVec128, dst, dst, scale);
+}
+
+Error CodeGen::emitStoreStorage(IRMem* dst, IRReg* src, uint32_t typeInfo) noexcept {
+  IRBuilder* ir = getIR();
+  IRBlock* block = getBlock();
+
+  uint32_t storage = dst->getStorage();
+  uint32_t format = storage & kTypeStorageMask;
+  bool isFloat = (typeInfo & kTypeIdMask) == kTypeFloat;
+
+  IRReg* raw = ir->newVar(IRReg::kKindVec, 16);
+  MPSL_NULLCHECK(raw);
+
+  if (format == kTypeStorageF16) {
+    MPSL_PROPAGATE(ir->emitInst(block, kInstCodeCvtftoh | kInstVec128, raw, src));
+    return ir->emitInst(block, kInstCodeStore64, dst, raw);
+  }
+
+  // Floats are clamped to the maximum before they are truncated, a float out
+  // of the range of `int` would be converted to the negative "indefinite"
+  // integer. Negative values saturate to zero by the packs that follow.
+  if (isFloat) {
+    float maxValue = format == kTypeStorageU8 ? 255.0f : 65535.0f;
+
+    IRReg* scaled = ir->newVar(IRReg::kKindVec, 16);
+    IRReg* ints = ir->newVar(IRReg::kKindVec, 16);
+    IRImm* maxImm = mpNewFloat4Imm(ir, maxValue);
+
+    MPSL_NULLCHECK(scaled);
+    MPSL_NULLCHECK(ints);
+    MPSL_NULLCHECK(maxImm);
+
+    if (storage & kTypeNormalized) {
+      IRImm* half = mpNewFloat4Imm(ir, 0.5f);
+      MPSL_NULLCHECK(half);
+
+      MPSL_PROPAGATE(ir->emitInst(block, kInstCodeMulf | kInstVec128, scaled, src, maxImm));
+      MPSL_PROPAGATE(ir->emitInst(block, kInstCodeAddf | kInstVec128, scaled, scaled, half));
+      MPSL_PROPAGATE(ir->emitInst(block, kInstCodeMinf | kInstVec128, scaled, scaled, maxImm));
+    }
+    else {
+      MPSL_PROPAGATE(ir->emitInst(block, kInstCodeMinf | kInstVec128, scaled, src, maxImm));
+    }
+
+    MPSL_PROPAGATE(ir->emitInst(block, kInstCodeCvtftoi | kInstVec128, ints, scaled));
+    src = ints;
+  }
+
+  if (format == kTypeStorageU8) {
+    IRReg* words = ir->newVar(IRReg::kKindVec, 16);
+    MPSL_NULLCHECK(words);
+
+    MPSL_PROPAGATE(ir->emitInst(block, kInstCodePackssdw | kInstVec128, words, src, src));
+    MPSL_PROPAGATE(ir->emitInst(block, kInstCodePackuswb | kInstVec128, raw, words, words));
+    return ir->emitInst(block, kInstCodeStore32, dst, raw);
+  }
+  else {
+    MPSL_PROPAGATE(ir->emitInst(block, kInstCodePackusdw | kInstVec128, raw, src, src));
+    return ir->emitInst(block, kInstCodeStore64, dst, raw);
+  }
+}
+
 } // mpsl namespace
 
 // [Api-End]
@@ -46,6 +46,8 @@ public:
   typedef Set< AstFunction*              > FunctionSet;
   typedef Map< AstSymbol*, IRPair<IRReg> > VarMap;
   typedef Map< AstSymbol*, IRMem*        > MemMap;
+  typedef Map< AstFunction*, IRFunc*     > FuncMap;
+  typedef Map< AstFunction*, uint32_t    > CallCountMap;
 
   struct DataSlot {
     MPSL_INLINE DataSlot(uint32_t slot, int32_t offset) noexcept
@@ -81,6 +83,7 @@ public:
   Error onImm(AstImm* node, Result& out) noexcept;
   Error onUnaryOp(AstUnaryOp* node, Result& out) noexcept;
   Error onBinaryOp(AstBinaryOp* node, Result& out) noexcept;
+  Error onIndex(AstIndex* node, Result& out) noexcept;
   Error onCall(AstCall* node, Result& out) noexcept;
 
   // --------------------------------------------------------------------------
@@ -92,6 +95,7 @@ public:
   MPSL_INLINE IRBlock* getBlock() const noexcept { return _block; }
 
   MPSL_INLINE bool hasV256() const noexcept { return _hasV256; }
+  MPSL_INLINE bool hasLanes() const noexcept { return _laneCount > 1; }
   MPSL_INLINE bool needSplit(uint32_t width) const { return width > 16 && !_hasV256; }
 
   // --------------------------------------------------------------------------
@@ -100,14 +104,45 @@ public:
 
   Error mapVarToAst(AstSymbol* sym, IRPair<IRReg> var) noexcept;
 
+  //! Count calls of all functions reachable from `node` into `_callCount`.
+  Error countCalls(AstNode* node) noexcept;
+  //! Get the out-of-line function that `node` should call or null if the call
+  //! of `func` should be inlined. The function is created by the first call.
+  Error getOutlinedFunc(IRFunc*& dst, AstFunction* func, AstCall* node) noexcept;
+  //! Emit `func` as the body of `irFunc`, used by the `CodeGen` of `irFunc`.
+  Error emitOutlinedBody(IRFunc* irFunc, AstFunction* func, uint32_t retTypeInfo) noexcept;
+
+  //! Widen a scalar `typeInfo` to a vector of `_laneCount` elements. Does nothing
+  //! if lanes are not used and fails if `typeInfo` is already a vector.
+  Error toLaneType(uint32_t& typeInfo) noexcept;
+
   Error newVar(IRPair<IRObject>& dst, uint32_t typeInfo) noexcept;
   Error newImm(IRPair<IRObject>& dst, const Value& value, uint32_t typeInfo) noexcept;
-  Error addrOfData(IRPair<IRObject>& dst, DataSlot data, uint32_t width) noexcept;
+  //! Get the address of `width` bytes of `data`, accessed through the pointer
+  //! used by `reduceOp` if it's a reduction, see `IRBuilder::getReducePtr()`.
+  Error addrOfData(IRPair<IRObject>& dst, DataSlot data, uint32_t width, uint32_t reduceOp = kReduceNone) noexcept;
+  Error addrOfMember(IRPair<IRObject>& dst, DataSlot data, uint32_t typeInfo) noexcept;
 
   Error asVar(IRPair<IRObject>& out, IRPair<IRObject> in, uint32_t typeInfo) noexcept;
 
+  //! Evaluate a condition `node` into a register that can be used by `Jnz`.
+  Error emitCond(IRReg*& dst, AstNode* node) noexcept;
+  //! Terminate the current block by an unconditional jump to `target`.
+  Error emitJump(IRBlock* target) noexcept;
+  //! Terminate the current block by a jump to `taken` if `cond` is true, or
+  //! to `notTaken` otherwise.
+  Error emitBranch(IRReg* cond, IRBlock* taken, IRBlock* notTaken) noexcept;
+  //! Continue in a new block that has no predecessors, used after `return`,
+  //! `break`, and `continue` (the code that follows is unreachable).
+  Error newUnreachableBlock() noexcept;
+  //! Get the block that follows `return` in the current function.
+  Error getRetBlock(IRBlock*& dst) noexcept;
+
   Error emitMove(IRPair<IRReg> dst, IRPair<IRReg> src, uint32_t typeInfo) noexcept;
   Error emitStore(IRPair<IRObject> dst, IRPair<IRReg> src, uint32_t typeInfo) noexcept;
+  //! Combine `src` with a reduction member `dst` by `reduceOp`, called by
+  //! `emitStore()` for members accessed through `IRBuilder::getReducePtr()`.
+  Error emitReduce(IRPair<IRObject> dst, IRPair<IRReg> src, uint32_t typeInfo, uint32_t reduceOp) noexcept;
   Error emitInst2(uint32_t instCode,
     IRPair<IRObject> o0,
     IRPair<IRObject> o1, uint32_t typeInfo) noexcept;
@@ -120,6 +155,11 @@ public:
   // TODO: Rename after API is completed.
   Error emitFetchX(IRReg* dst, IRMem* src, uint32_t typeInfo) noexcept;
   Error emitStoreX(IRMem* dst, IRReg* src, uint32_t typeInfo) noexcept;
+  //! Emit fetching a member stored in a narrow format widened to `typeInfo`,
+  //! see `IRMem::getStorage()`.
+  Error emitFetchStorage(IRReg* dst, IRMem* src, uint32_t typeInfo) noexcept;
+  //! Emit storing `src` of `typeInfo` narrowed to the format of `dst`.
+  Error emitStoreStorage(IRMem* dst, IRReg* src, uint32_t typeInfo) noexcept;
 
   // --------------------------------------------------------------------------
   // [Members]
@@ -130,11 +170,20 @@ public:
 
   int _functionLevel;                    //!< Current function level (0 if main).
   bool _hasV256;                         //!< Use 256-bit SIMD instructions.
+  bool _canOutline;                      //!< Calls can be out-of-line (false in `IRFunc` bodies).
+  uint32_t _inlineLimit;                 //!< Size of functions that are always inlined.
+  uint32_t _laneCount;                   //!< Number of lanes, see `IRBuilder::initLanes()`.
 
   AstSymbol* _hiddenRet;                 //!< A hidden return variable internally named `@ret`.
-  IRPair<IRObject> _currentRet;          //!< Current return, required by \ref onReturn().
+  IRPair<IRReg> _currentRet;             //!< Return variable of the inlined function, see \ref onReturn().
+
+  IRBlock* _retBlock;                    //!< Block that follows `return` (created on demand).
+  IRBlock* _breakBlock;                  //!< Target of `break` (null outside of a loop).
+  IRBlock* _continueBlock;               //!< Target of `continue` (null outside of a loop).
 
   FunctionSet _nestedFunctions;          //!< Hash of all nested functions.
+  CallCountMap _callCount;               //!< Number of calls of each function.
+  FuncMap _funcMap;                      //!< Functions called out-of-line.
   VarMap _varMap;                        //!< Mapping of `AstVar` to `IRPair<IRReg>`.
   MemMap _memMap;                        //!< Mapping of `AstVarMemb` to `IRMem`.
 };
@@ -61,19 +61,16 @@ static MPSL_INLINE T imod(T x, T y) noexcept {
 static MPSL_INLINE uint32_t lzcnt_kernel(uint32_t x) noexcept {
 #if MPSL_CC_MSC_GE(14, 0, 0) && (MPSL_ARCH_X86 || MPSL_ARCH_X64 || MPSL_ARCH_ARM32 || MPSL_ARCH_ARM64)
   DWORD i;
-  return _BitScanForward(&i, x) ? uint32_t(i) : uint32_t(0xFFFFFFFFU);
+  return _BitScanReverse(&i, x) ? uint32_t(31 - i) : uint32_t(32);
 #elif MPSL_CC_GCC_GE(3, 4, 6) || MPSL_CC_CLANG
-  return x ? uint32_t(__builtin_ctz(x)) : uint32_t(0xFFFFFFFFU);
+  return x ? uint32_t(__builtin_clz(x)) : uint32_t(32);
 #else
-  uint32_t i = 1;
-  while (x != 0) {
-    uint32_t two = x & 0x3;
-    if (two != 0x0)
-      return i - (two & 0x1);
-    i += 2;
-    x >>= 2;
+  uint32_t i = 0;
+  while (i < 32 && (x & 0x80000000U) == 0) {
+    x <<= 1;
+    i++;
   }
-  return 0xFFFFFFFFU;
+  return i;
 #endif
 }
 
@@ -88,6 +85,15 @@ static MPSL_INLINE uint32_t popcnt_kernel(uint32_t x) noexcept {
 #endif
 }
 
+//! Truncating conversion to int, out of range values (including NaN) convert
+//! to `INT32_MIN`, which is what `cvtt{ss|sd}2si` returns.
+static MPSL_INLINE int32_t cvttoi_kernel(double x) noexcept {
+  if (x > -2147483649.0 && x < 2147483648.0)
+    return static_cast<int32_t>(x);
+  else
+    return static_cast<int32_t>(0x80000000U);
+}
+
 static MPSL_INLINE uint32_t vmaddwd_kernel(uint32_t x, uint32_t y) noexcept {
   int32_t xLo = static_cast<int32_t>(x & 0xFFFFU);
   int32_t yLo = static_cast<int32_t>(y & 0xFFFFU);
@@ -128,6 +134,25 @@ static MPSL_INLINE void fn(                                                    \
   } while (++i < count);                                                       \
 }
 
+//! Conversions have different source and destination sizes, the number of
+//! elements is given by the wider of them (`width` is the SIMD width).
+#define FOLD_CVT(fn, dsttype, srctype, worktype, ...)                          \
+static MPSL_INLINE void fn(                                                    \
+  void* _pd, const void* _ps, uint32_t width) noexcept {                       \
+                                                                               \
+  uint32_t i = 0;                                                              \
+  uint32_t count = width / static_cast<uint32_t>(                              \
+    sizeof(dsttype) > sizeof(srctype) ? sizeof(dsttype) : sizeof(srctype));    \
+                                                                               \
+  dsttype* pd = static_cast<dsttype*>(_pd);                                    \
+  const srctype* ps = static_cast<const srctype*>(_ps);                        \
+                                                                               \
+  do {                                                                         \
+    worktype s = static_cast<worktype>(ps[i]);                                 \
+    pd[i] = static_cast<dsttype>(__VA_ARGS__);                                 \
+  } while (++i < count);                                                       \
+}
+
 #define FOLD_FN3(fn, dsttype, srctype, worktype, ...)                          \
 static MPSL_INLINE void fn(                                                    \
   void* _pd, const void* _pl, const void* _pr, uint32_t width) noexcept {      \
@@ -166,24 +191,31 @@ static MPSL_INLINE void fn(                                                    \
 FOLD_FN2(pcopy32   , uint32_t, uint32_t, uint32_t, s)
 FOLD_FN2(pcopy64   , uint64_t, uint64_t, uint64_t, s)
 
+FOLD_CVT(cvtitof   , float   , int32_t , int32_t , s)
+FOLD_CVT(cvtitod   , double  , int32_t , int32_t , s)
+FOLD_CVT(cvtftoi   , int32_t , float   , float   , cvttoi_kernel(s))
+FOLD_CVT(cvtftod   , double  , float   , float   , s)
+FOLD_CVT(cvtdtoi   , int32_t , double  , double  , cvttoi_kernel(s))
+FOLD_CVT(cvtdtof   , float   , double  , double  , s)
+
 FOLD_FN2(pinci     , uint32_t, uint32_t, uint32_t, s + 1U  )
 FOLD_FN2(fincf     , float   , float   , float   , s + 1.0f)
 FOLD_FN2(fincd     , double  , double  , double  , s + 1.0 )
 
-FOLD_FN2(pdeci     , uint32_t, uint32_t, uint32_t, s + 1U  )
-FOLD_FN2(fdecf     , float   , float   , float   , s + 1.0f)
-FOLD_FN2(fdecd     , double  , double  , double  , s + 1.0 )
+FOLD_FN2(pdeci     , uint32_t, uint32_t, uint32_t, s - 1U  )
+FOLD_FN2(fdecf     , float   , float   , float   , s - 1.0f)
+FOLD_FN2(fdecd     , double  , double  , double  , s - 1.0 )
 
 FOLD_FN2(pnotd     , uint32_t, uint32_t, uint32_t, ~s)
 FOLD_FN2(pnotq     , uint64_t, uint64_t, uint64_t, ~s)
 FOLD_FN2(pnegd     , uint32_t, uint32_t, uint32_t, (~s) + static_cast<uint32_t>(1U))
 
-FOLD_FN2(fisnanf   , uint32_t, float   , float   , mpIsNanF(s) ? kB32_0 : kB32_1)
-FOLD_FN2(fisnand   , uint64_t, double  , double  , mpIsNanD(s) ? kB64_0 : kB64_1)
-FOLD_FN2(fisinff   , uint32_t, float   , float   , mpIsInfF(s) ? kB32_0 : kB32_1)
-FOLD_FN2(fisinfd   , uint64_t, double  , double  , mpIsInfD(s) ? kB64_0 : kB64_1)
-FOLD_FN2(fisfinitef, uint32_t, float   , float   , mpIsFiniteF(s) ? kB32_0 : kB32_1)
-FOLD_FN2(fisfinited, uint64_t, double  , double  , mpIsFiniteD(s) ? kB64_0 : kB64_1)
+FOLD_FN2(fisnanf   , uint32_t, float   , float   , mpIsNanF(s) ? kB32_1 : kB32_0)
+FOLD_FN2(fisnand   , uint64_t, double  , double  , mpIsNanD(s) ? kB64_1 : kB64_0)
+FOLD_FN2(fisinff   , uint32_t, float   , float   , mpIsInfF(s) ? kB32_1 : kB32_0)
+FOLD_FN2(fisinfd   , uint64_t, double  , double  , mpIsInfD(s) ? kB64_1 : kB64_0)
+FOLD_FN2(fisfinitef, uint32_t, float   , float   , mpIsFiniteF(s) ? kB32_1 : kB32_0)
+FOLD_FN2(fisfinited, uint64_t, double  , double  , mpIsFiniteD(s) ? kB64_1 : kB64_0)
 
 FOLD_FN2(fsignmaskf, int32_t , int32_t , int32_t , s >> 31)
 FOLD_FN2(fsignmaskd, int64_t , int64_t , int64_t , s >> 63)
@@ -259,18 +291,18 @@ FOLD_FN3(fmind     , double  , double  , double  , l < r ? l : r)
 FOLD_FN3(fmaxf     , float   , float   , float   , l > r ? l : r)
 FOLD_FN3(fmaxd     , double  , double  , double  , l > r ? l : r)
 
-FOLD_FN3(fcmpeqf   , uint32_t, float   , float   , l == r ? kB32_0 : kB32_1)
-FOLD_FN3(fcmpeqd   , uint64_t, double  , double  , l == r ? kB64_0 : kB64_1)
-FOLD_FN3(fcmpnef   , uint32_t, float   , float   , l != r ? kB32_0 : kB32_1)
-FOLD_FN3(fcmpned   , uint64_t, double  , double  , l != r ? kB64_0 : kB64_1)
-FOLD_FN3(fcmpltf   , uint32_t, float   , float   , l <  r ? kB32_0 : kB32_1)
-FOLD_FN3(fcmpltd   , uint64_t, double  , double  , l <  r ? kB64_0 : kB64_1)
-FOLD_FN3(fcmplef   , uint32_t, float   , float   , l <= r ? kB32_0 : kB32_1)
-FOLD_FN3(fcmpled   , uint64_t, double  , double  , l <= r ? kB64_0 : kB64_1)
-FOLD_FN3(fcmpgtf   , uint32_t, float   , float   , l >  r ? kB32_0 : kB32_1)
-FOLD_FN3(fcmpgtd   , uint64_t, double  , double  , l >  r ? kB64_0 : kB64_1)
-FOLD_FN3(fcmpgef   , uint32_t, float   , float   , l >= r ? kB32_0 : kB32_1)
-FOLD_FN3(fcmpged   , uint64_t, double  , double  , l >= r ? kB64_0 : kB64_1)
+FOLD_FN3(fcmpeqf   , uint32_t, float   , float   , l == r ? kB32_1 : kB32_0)
+FOLD_FN3(fcmpeqd   , uint64_t, double  , double  , l == r ? kB64_1 : kB64_0)
+FOLD_FN3(fcmpnef   , uint32_t, float   , float   , l != r ? kB32_1 : kB32_0)
+FOLD_FN3(fcmpned   , uint64_t, double  , double  , l != r ? kB64_1 : kB64_0)
+FOLD_FN3(fcmpltf   , uint32_t, float   , float   , l <  r ? kB32_1 : kB32_0)
+FOLD_FN3(fcmpltd   , uint64_t, double  , double  , l <  r ? kB64_1 : kB64_0)
+FOLD_FN3(fcmplef   , uint32_t, float   , float   , l <= r ? kB32_1 : kB32_0)
+FOLD_FN3(fcmpled   , uint64_t, double  , double  , l <= r ? kB64_1 : kB64_0)
+FOLD_FN3(fcmpgtf   , uint32_t, float   , float   , l >  r ? kB32_1 : kB32_0)
+FOLD_FN3(fcmpgtd   , uint64_t, double  , double  , l >  r ? kB64_1 : kB64_0)
+FOLD_FN3(fcmpgef   , uint32_t, float   , float   , l >= r ? kB32_1 : kB32_0)
+FOLD_FN3(fcmpged   , uint64_t, double  , double  , l >= r ? kB64_1 : kB64_0)
 
 FOLD_FN2(pabsb     , int8_t  , int8_t  , int32_t , mpAbsI(s))
 FOLD_FN2(pabsw     , int16_t , int16_t , int32_t , mpAbsI(s))
@@ -299,7 +331,8 @@ FOLD_FN3(psubusw   , uint16_t, uint16_t, uint32_t, (l >= r) ? l - r : static_cas
 FOLD_FN3(pmulw     , uint16_t, uint16_t, uint32_t, (l * r) & 0xFFFFU)
 FOLD_FN3(pmulhsw   , int16_t , int16_t , int32_t , (l * r) >> 16)
 FOLD_FN3(pmulhuw   , uint16_t, uint16_t, uint32_t, (l * r) >> 16)
-FOLD_FN3(pmuld     , uint16_t, uint16_t, uint32_t, l * r)
+FOLD_FN3(pmuld     , uint32_t, uint32_t, uint32_t, l * r)
+FOLD_FN3(pmulhsd   , int32_t , int32_t , int64_t , (l * r) >> 32)
 FOLD_FN3(pdivsd    , int32_t , int32_t , int32_t , idiv(l, r))
 FOLD_FN3(pmodsd    , int32_t , int32_t , int32_t , imod(l, r))
 FOLD_FN3(pminsb    , int8_t  , int8_t  , int32_t , mpMin<int32_t>(l, r))
@@ -347,21 +380,23 @@ FOLD_FN3(pcmpged   , int32_t , int32_t , int32_t , l >= r ? -1 : 0)
 #undef FOLD_IMM
 #undef FOLD_FN3
 #undef FOLD_FN2
+#undef FOLD_CVT
 
 static Error foldInternal(uint32_t instCode, uint32_t width, Value& dVal, const Value& sVal) noexcept {
   // Instruction code without SIMD flags.
   switch (instCode) {
-    case kInstCodeMov32:
-    case kInstCodeMov64:
-    case kInstCodeMov128:
-    case kInstCodeMov256:
-
-    case kInstCodeCvtitof   :
-    case kInstCodeCvtitod   :
-    case kInstCodeCvtftoi   :
-    case kInstCodeCvtftod   :
-    case kInstCodeCvtdtoi   :
-    case kInstCodeCvtdtof   :
+    case kInstCodeMov32     : pcopy32(&dVal, &sVal, 0); break;
+    case kInstCodeMov64     : pcopy64(&dVal, &sVal, 0); break;
+    case kInstCodeMov128    : pcopy64(&dVal, &sVal, 16); break;
+    case kInstCodeMov256    : pcopy64(&dVal, &sVal, 32); break;
+
+    case kInstCodeCvtitof   : cvtitof(&dVal, &sVal, width); break;
+    case kInstCodeCvtitod   : cvtitod(&dVal, &sVal, width); break;
+    case kInstCodeCvtftoi   : cvtftoi(&dVal, &sVal, width); break;
+    case kInstCodeCvtftod   : cvtftod(&dVal, &sVal, width); break;
+    case kInstCodeCvtdtoi   : cvtdtoi(&dVal, &sVal, width); break;
+    case kInstCodeCvtdtof   : cvtdtof(&dVal, &sVal, width); break;
+
 
     case kInstCodeAbsf      : fabsf(&dVal, &sVal, width); break;
     case kInstCodeAbsd      : fabsd(&dVal, &sVal, width); break;
@@ -390,7 +425,7 @@ static Error foldInternal(uint32_t instCode, uint32_t width, Value& dVal, const
     case kInstCodeFloorf    : ffloorf(&dVal, &sVal, width); break;
     case kInstCodeFloord    : ffloord(&dVal, &sVal, width); break;
     case kInstCodeRoundf    : froundf(&dVal, &sVal, width); break;
-    case kInstCodeRoundd    : froundf(&dVal, &sVal, width); break;
+    case kInstCodeRoundd    : froundd(&dVal, &sVal, width); break;
     case kInstCodeRoundevenf: froundevenf(&dVal, &sVal, width); break;
     case kInstCodeRoundevend: froundevend(&dVal, &sVal, width); break;
     case kInstCodeCeilf     : fceilf(&dVal, &sVal, width); break;
@@ -512,6 +547,7 @@ static Error foldInternal(uint32_t instCode, uint32_t width, Value& dVal, const
     case kInstCodePmulhsw   : pmulhsw(&dVal, &lVal, &rVal, width); break;
     case kInstCodePmulhuw   : pmulhuw(&dVal, &lVal, &rVal, width); break;
     case kInstCodePmuld     : pmuld(&dVal, &lVal, &rVal, width); break;
+    case kInstCodePmulhsd   : pmulhsd(&dVal, &lVal, &rVal, width); break;
     case kInstCodePdivsd    : pdivsd(&dVal, &lVal, &rVal, width); break;
     case kInstCodePmodsd    : pmodsd(&dVal, &lVal, &rVal, width); break;
     case kInstCodePminsb    : pminsb(&dVal, &lVal, &rVal, width); break;
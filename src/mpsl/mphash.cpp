@@ -181,6 +181,68 @@ HashNode* HashBase::_del(HashNode* node) noexcept {
   return nullptr;
 }
 
+// ============================================================================
+// [mpsl::ProbeUtils]
+// ============================================================================
+
+const uint8_t ProbeUtils::emptyGroup[ProbeUtils::kGroupSize] = {
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80
+};
+
+// ============================================================================
+// [mpsl::ProbeBase - Storage]
+// ============================================================================
+
+Error ProbeBase::_allocStorage(uint32_t capacity, size_t slotSize, uint8_t** oldTags) noexcept {
+  MPSL_ASSERT(capacity >= ProbeUtils::kGroupSize && (capacity & (capacity - 1)) == 0);
+
+  // Tags are padded to a multiple of `kGroupSize`, which keeps slots aligned.
+  uint8_t* tags = static_cast<uint8_t*>(
+    _heap->alloc(static_cast<size_t>(capacity) * (1 + slotSize)));
+
+  if (tags == nullptr)
+    return MPSL_TRACE_ERROR(kErrorNoMemory);
+
+  ::memset(tags, ProbeUtils::kTagEmpty, capacity);
+  *oldTags = _tags;
+
+  // 87.5% is the maximum occupancy, there is always at least one empty slot
+  // in the table, which terminates all probes.
+  _tags = tags;
+  _slots = tags + capacity;
+  _groupMask = capacity / ProbeUtils::kGroupSize - 1;
+  _length = 0;
+  _grow = capacity - capacity / 8;
+
+  return kErrorOk;
+}
+
+void ProbeBase::_releaseStorage(uint8_t* tags, uint32_t capacity, size_t slotSize) noexcept {
+  if (capacity != 0)
+    _heap->release(tags, static_cast<size_t>(capacity) * (1 + slotSize));
+}
+
+uint32_t ProbeBase::_claimSlot(uint32_t mixed) noexcept {
+  uint32_t group = mixed & _groupMask;
+  uint32_t step = 0;
+
+  for (;;) {
+    uint8_t* groupTags = _tags + group * ProbeUtils::kGroupSize;
+    uint32_t mask = ProbeUtils::matchEmpty(groupTags);
+
+    if (mask) {
+      uint32_t i = mpBitCtz(mask);
+      groupTags[i] = static_cast<uint8_t>(ProbeUtils::tagOf(mixed));
+
+      _length++;
+      return group * ProbeUtils::kGroupSize + i;
+    }
+
+    group = (group + ++step) & _groupMask;
+  }
+}
+
 } // mpsl namespace
 
 // [Api-End]
@@ -150,8 +150,8 @@ public:
 //!    making these symbols visible to the symbol resolver. This feature can be
 //!    completely ignored if not needed.
 //!
-//! Hash is currently used by AST to keep references of global and local
-//! symbols and by AST to IR translator to associate IR specific data with AST.
+//! Hash is currently used by `Set` and by IR passes that need to delete nodes,
+//! AST scopes use `ProbeHash`, which has the same features except deletion.
 template<typename Key, typename Node>
 class Hash : public HashBase {
 public:
@@ -216,107 +216,421 @@ public:
 };
 
 // ============================================================================
-// [mpsl::Map<Key, Value>]
+// [mpsl::ProbeUtils]
 // ============================================================================
 
 //! \internal
-template<typename Key, typename Value>
-class Map {
+//!
+//! Helpers shared by open-addressing tables (`ProbeHash`, `Map`).
+//!
+//! Slots are organized in groups of `kGroupSize`, each slot has a tag byte
+//! that is either `kTagEmpty` or 7 bits of the slot's hash. A lookup compares
+//! all tags of a group at once and only touches slots having a matching tag,
+//! it stops at the first group that has an empty slot. Tables never remove
+//! slots, so there are no tombstones.
+namespace ProbeUtils {
+  enum {
+    kGroupSize = 16,
+    kTagEmpty = 0x80
+  };
+
+  //! \internal
+  //!
+  //! Tags of tables that have no storage yet (one group, all slots empty).
+  extern const uint8_t emptyGroup[kGroupSize];
+
+  // \internal
+  //
+  // Scramble `hVal` so masking by a power of two uses all of its bits, low
+  // bits of `hashString()` only depend on the last few characters.
+  static MPSL_INLINE uint32_t mix(uint32_t hVal) noexcept {
+    hVal ^= hVal >> 16;
+    hVal *= 0x85EBCA6BU;
+    hVal ^= hVal >> 13;
+    return hVal;
+  }
+
+  // \internal
+  static MPSL_INLINE uint32_t tagOf(uint32_t mixed) noexcept {
+    return mixed >> 25;
+  }
+
+  // \internal
+  //
+  // Get a mask of slots in `group` having `tag`, bit `i` represents slot `i`.
+  static MPSL_INLINE uint32_t matchTag(const uint8_t* group, uint32_t tag) noexcept {
+#if MPSL_USE_SSE2
+    __m128i tags = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    __m128i mask = _mm_cmpeq_epi8(tags, _mm_set1_epi8(static_cast<char>(tag)));
+    return static_cast<uint32_t>(_mm_movemask_epi8(mask));
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < kGroupSize; i++)
+      mask |= static_cast<uint32_t>(group[i] == tag) << i;
+    return mask;
+#endif
+  }
+
+  // \internal
+  //
+  // Get a mask of empty slots in `group`, only `kTagEmpty` has the MSB set.
+  static MPSL_INLINE uint32_t matchEmpty(const uint8_t* group) noexcept {
+#if MPSL_USE_SSE2
+    __m128i tags = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return static_cast<uint32_t>(_mm_movemask_epi8(tags));
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < kGroupSize; i++)
+      mask |= static_cast<uint32_t>(group[i] >> 7) << i;
+    return mask;
+#endif
+  }
+};
+
+// ============================================================================
+// [mpsl::ProbeBase]
+// ============================================================================
+
+//! \internal
+//!
+//! Storage of open-addressing tables, the slot type is up to the derived
+//! class. Tags and slots share a single allocation, tags come first.
+class ProbeBase {
 public:
-  MPSL_NONCOPYABLE(Map)
+  MPSL_NONCOPYABLE(ProbeBase)
 
-  struct Node : public HashNode {
-    MPSL_INLINE Node(const Key& key, const Value& value, uint32_t hVal) noexcept
-      : HashNode(hVal),
-        _key(key),
-        _value(value) {}
-    MPSL_INLINE bool eq(const Key& key) noexcept { return _key == key; }
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
 
-    Key _key;
-    Value _value;
-  };
+  MPSL_INLINE ProbeBase(ZoneHeap* heap) noexcept
+    : _heap(heap),
+      _tags(const_cast<uint8_t*>(ProbeUtils::emptyGroup)),
+      _slots(nullptr),
+      _groupMask(0),
+      _length(0),
+      _grow(0) {}
 
-  struct ReleaseHandler {
-    MPSL_INLINE ReleaseHandler(ZoneHeap* heap) noexcept
-      : _heap(heap) {}
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
 
-    MPSL_INLINE void release(Node* node) noexcept {
-      _heap->release(node, sizeof(Node));
-    }
+  MPSL_INLINE ZoneHeap* getHeap() const noexcept { return _heap; }
+  MPSL_INLINE uint32_t getLength() const noexcept { return _length; }
 
-    ZoneHeap* _heap;
+  //! Get the number of slots, zero if there is no storage yet.
+  MPSL_INLINE uint32_t getCapacity() const noexcept {
+    return _slots ? (_groupMask + 1) * ProbeUtils::kGroupSize : uint32_t(0);
+  }
+
+  // --------------------------------------------------------------------------
+  // [Ops]
+  // --------------------------------------------------------------------------
+
+  //! Replace the storage by an empty one of `capacity` slots of `slotSize`,
+  //! the old storage is returned in `oldTags` and not released.
+  Error _allocStorage(uint32_t capacity, size_t slotSize, uint8_t** oldTags) noexcept;
+  //! Release the storage allocated by `_allocStorage()`.
+  void _releaseStorage(uint8_t* tags, uint32_t capacity, size_t slotSize) noexcept;
+
+  //! Claim an empty slot for hash `mixed`, tag it, and return its index.
+  //!
+  //! There must be at least one empty slot.
+  uint32_t _claimSlot(uint32_t mixed) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  ZoneHeap* _heap;
+  uint8_t* _tags;
+  void* _slots;
+
+  uint32_t _groupMask;
+  uint32_t _length;
+  uint32_t _grow;
+};
+
+// ============================================================================
+// [mpsl::ProbeHash<Key, Node>]
+// ============================================================================
+
+//! \internal
+//!
+//! Open-addressing table of nodes, used by `AstScope` instead of `Hash`.
+//!
+//! Slots keep the hash inline with the node pointer, so a lookup only
+//! dereferences nodes whose hash matches. It has the same "special" features
+//! as `Hash` - it allows duplicates and has an invisible chain of nodes that
+//! are released with the table, but never found, see `Hash`.
+template<typename Key, typename Node>
+class ProbeHash : public ProbeBase {
+public:
+  struct Slot {
+    Node* node;
+    uint32_t hVal;
   };
 
   // --------------------------------------------------------------------------
   // [Construction / Destruction]
   // --------------------------------------------------------------------------
 
-  MPSL_INLINE Map(ZoneHeap* heap) noexcept
-    : _hash(heap) {}
+  MPSL_INLINE ProbeHash(ZoneHeap* heap) noexcept
+    : ProbeBase(heap),
+      _invisible(nullptr) {}
 
-  MPSL_INLINE ~Map() noexcept {
-    ReleaseHandler releaseHandler(_hash.getHeap());
-    _hash.reset(releaseHandler);
+  MPSL_INLINE ~ProbeHash() noexcept {
+    _releaseStorage(_tags, getCapacity(), sizeof(Slot));
   }
 
   // --------------------------------------------------------------------------
   // [Ops]
   // --------------------------------------------------------------------------
 
-  MPSL_INLINE bool has(const Key& key) const noexcept {
-    uint32_t hVal = HashUtils::hashPointer(key);
-    uint32_t hMod = hVal % _hash._bucketsCount;
-    Node* node = static_cast<Node*>(_hash._data[hMod]);
+  template<typename ReleaseHandler>
+  void reset(ReleaseHandler& handler) noexcept {
+    uint32_t capacity = getCapacity();
+    Slot* slots = static_cast<Slot*>(_slots);
+
+    for (uint32_t i = 0; i < capacity; i++)
+      if (_tags[i] != ProbeUtils::kTagEmpty)
+        handler.release(slots[i].node);
 
+    HashNode* node = _invisible;
     while (node) {
-      if (node->eq(key))
-        return true;
-      node = static_cast<Node*>(node->_next);
+      HashNode* next = node->_next;
+      handler.release(static_cast<Node*>(node));
+      node = next;
     }
-    return false;
+
+    _releaseStorage(_tags, capacity, sizeof(Slot));
+    _tags = const_cast<uint8_t*>(ProbeUtils::emptyGroup);
+    _slots = nullptr;
+    _groupMask = 0;
+    _length = 0;
+    _grow = 0;
+    _invisible = nullptr;
   }
 
-  MPSL_INLINE Value get(const Key& key) const noexcept {
-    uint32_t hVal = HashUtils::hashPointer(key);
-    uint32_t hMod = hVal % _hash._bucketsCount;
-    Node* node = static_cast<Node*>(_hash._data[hMod]);
+  //! Move all nodes of `other` to the invisible chain of this table and
+  //! release the storage of `other`.
+  void mergeToInvisibleSlot(ProbeHash<Key, Node>& other) noexcept {
+    uint32_t capacity = other.getCapacity();
+    Slot* slots = static_cast<Slot*>(other._slots);
+
+    for (uint32_t i = 0; i < capacity; i++) {
+      if (other._tags[i] != ProbeUtils::kTagEmpty) {
+        Node* node = slots[i].node;
+        node->_next = _invisible;
+        _invisible = node;
+      }
+    }
 
+    HashNode* node = other._invisible;
     while (node) {
-      if (node->eq(key))
-        return node->_value;
-      node = static_cast<Node*>(node->_next);
+      HashNode* next = node->_next;
+      node->_next = _invisible;
+      _invisible = node;
+      node = next;
     }
 
-    return Value();
+    _releaseStorage(other._tags, capacity, sizeof(Slot));
+    other._tags = const_cast<uint8_t*>(ProbeUtils::emptyGroup);
+    other._slots = nullptr;
+    other._groupMask = 0;
+    other._length = 0;
+    other._grow = 0;
+    other._invisible = nullptr;
   }
 
-  MPSL_INLINE bool get(const Key& key, Value** pValue) const noexcept {
-    uint32_t hVal = HashUtils::hashPointer(key);
-    uint32_t hMod = hVal % _hash._bucketsCount;
-    Node* node = static_cast<Node*>(_hash._data[hMod]);
+  MPSL_INLINE Node* get(const Key& key, uint32_t hVal) const noexcept {
+    uint32_t mixed = ProbeUtils::mix(hVal);
+    uint32_t tag = ProbeUtils::tagOf(mixed);
+
+    const Slot* slots = static_cast<const Slot*>(_slots);
+    uint32_t group = mixed & _groupMask;
+    uint32_t step = 0;
+
+    for (;;) {
+      const uint8_t* groupTags = _tags + group * ProbeUtils::kGroupSize;
+      uint32_t mask = ProbeUtils::matchTag(groupTags, tag);
+
+      while (mask) {
+        uint32_t i = group * ProbeUtils::kGroupSize + mpBitCtz(mask);
+        if (slots[i].hVal == hVal && slots[i].node->eq(key))
+          return slots[i].node;
+        mask &= mask - 1;
+      }
 
-    while (node) {
-      if (node->eq(key)) {
-        *pValue = &node->_value;
-        return true;
+      if (ProbeUtils::matchEmpty(groupTags))
+        return nullptr;
+
+      // Triangular probing visits all groups as their count is a power of 2.
+      group = (group + ++step) & _groupMask;
+    }
+  }
+
+  //! Put `node` to the table, the table owns the node even on failure.
+  MPSL_INLINE Error put(Node* node) noexcept {
+    if (_length >= _grow) {
+      Error err = _rehash();
+      if (err != kErrorOk) {
+        node->_next = _invisible;
+        _invisible = node;
+        return err;
       }
-      node = static_cast<Node*>(node->_next);
     }
-    return false;
+
+    uint32_t i = _claimSlot(ProbeUtils::mix(node->_hVal));
+    Slot& slot = static_cast<Slot*>(_slots)[i];
+
+    slot.node = node;
+    slot.hVal = node->_hVal;
+    return kErrorOk;
+  }
+
+  Error _rehash() noexcept {
+    uint32_t oldCapacity = getCapacity();
+    uint32_t newCapacity = oldCapacity ? oldCapacity * 2 : uint32_t(ProbeUtils::kGroupSize);
+
+    uint8_t* oldTags;
+    Slot* oldSlots = static_cast<Slot*>(_slots);
+    MPSL_PROPAGATE(_allocStorage(newCapacity, sizeof(Slot), &oldTags));
+
+    Slot* newSlots = static_cast<Slot*>(_slots);
+    for (uint32_t i = 0; i < oldCapacity; i++) {
+      if (oldTags[i] != ProbeUtils::kTagEmpty)
+        newSlots[_claimSlot(ProbeUtils::mix(oldSlots[i].hVal))] = oldSlots[i];
+    }
+
+    _releaseStorage(oldTags, oldCapacity, sizeof(Slot));
+    return kErrorOk;
+  }
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  //! Nodes merged by `mergeToInvisibleSlot()`, linked by `HashNode::_next`.
+  HashNode* _invisible;
+};
+
+// ============================================================================
+// [mpsl::Map<Key, Value>]
+// ============================================================================
+
+//! \internal
+//!
+//! Open-addressing map of pointer keys, keys and values are stored inline
+//! in slots, see `ProbeUtils`.
+template<typename Key, typename Value>
+class Map : public ProbeBase {
+public:
+  MPSL_NONCOPYABLE(Map)
+
+  struct Slot {
+    Key key;
+    Value value;
+  };
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  MPSL_INLINE Map(ZoneHeap* heap) noexcept
+    : ProbeBase(heap) {}
+
+  MPSL_INLINE ~Map() noexcept {
+    _releaseStorage(_tags, getCapacity(), sizeof(Slot));
+  }
+
+  // --------------------------------------------------------------------------
+  // [Ops]
+  // --------------------------------------------------------------------------
+
+  MPSL_INLINE bool has(const Key& key) const noexcept {
+    return _find(key) != nullptr;
+  }
+
+  MPSL_INLINE Value get(const Key& key) const noexcept {
+    Slot* slot = _find(key);
+    return slot ? slot->value : Value();
+  }
+
+  MPSL_INLINE bool get(const Key& key, Value** pValue) const noexcept {
+    Slot* slot = _find(key);
+    if (slot == nullptr)
+      return false;
+
+    *pValue = &slot->value;
+    return true;
   }
 
+  //! Put `key` with `value` to the map, replaces the value if `key` exists.
   MPSL_INLINE Error put(const Key& key, const Value& value) noexcept {
-    Node* node = static_cast<Node*>(_hash._heap->alloc(sizeof(Node)));
-    if (node == nullptr)
-      return MPSL_TRACE_ERROR(kErrorNoMemory);
+    Slot* slot = _find(key);
+    if (slot) {
+      slot->value = value;
+      return kErrorOk;
+    }
 
-    uint32_t hVal = HashUtils::hashPointer(key);
-    _hash.put(new(node) Node(key, value, hVal));
+    if (_length >= _grow)
+      MPSL_PROPAGATE(_rehash());
+
+    uint32_t i = _claimSlot(ProbeUtils::mix(HashUtils::hashPointer(key)));
+    slot = static_cast<Slot*>(_slots) + i;
 
+    slot->key = key;
+    new(&slot->value) Value(value);
     return kErrorOk;
   }
 
-  Hash<Key, Node> _hash;
+  MPSL_INLINE Slot* _find(const Key& key) const noexcept {
+    uint32_t mixed = ProbeUtils::mix(HashUtils::hashPointer(key));
+    uint32_t tag = ProbeUtils::tagOf(mixed);
+
+    Slot* slots = static_cast<Slot*>(_slots);
+    uint32_t group = mixed & _groupMask;
+    uint32_t step = 0;
+
+    for (;;) {
+      const uint8_t* groupTags = _tags + group * ProbeUtils::kGroupSize;
+      uint32_t mask = ProbeUtils::matchTag(groupTags, tag);
+
+      while (mask) {
+        uint32_t i = group * ProbeUtils::kGroupSize + mpBitCtz(mask);
+        if (slots[i].key == key)
+          return &slots[i];
+        mask &= mask - 1;
+      }
+
+      if (ProbeUtils::matchEmpty(groupTags))
+        return nullptr;
+
+      group = (group + ++step) & _groupMask;
+    }
+  }
+
+  Error _rehash() noexcept {
+    uint32_t oldCapacity = getCapacity();
+    uint32_t newCapacity = oldCapacity ? oldCapacity * 2 : uint32_t(ProbeUtils::kGroupSize);
+
+    uint8_t* oldTags;
+    Slot* oldSlots = static_cast<Slot*>(_slots);
+    MPSL_PROPAGATE(_allocStorage(newCapacity, sizeof(Slot), &oldTags));
+
+    Slot* newSlots = static_cast<Slot*>(_slots);
+    for (uint32_t i = 0; i < oldCapacity; i++) {
+      if (oldTags[i] != ProbeUtils::kTagEmpty) {
+        uint32_t j = _claimSlot(ProbeUtils::mix(HashUtils::hashPointer(oldSlots[i].key)));
+        newSlots[j].key = oldSlots[i].key;
+        new(&newSlots[j].value) Value(oldSlots[i].value);
+      }
+    }
+
+    _releaseStorage(oldTags, oldCapacity, sizeof(Slot));
+    return kErrorOk;
+  }
 };
 
 // ============================================================================
@@ -45,17 +45,42 @@ void IRBlock::_fixupAfterNeutering() noexcept {
 IRBuilder::IRBuilder(ZoneHeap* heap, uint32_t numSlots) noexcept
   : _heap(heap),
     _numSlots(numSlots),
+    _reduceCount(0),
+    _laneIndex(nullptr),
+    _laneCount(1),
+    _laneSlots(0),
     _blockIdGen(0),
     _varIdGen(0) {
 
+  for (uint32_t i = 0; i < MPSL_ARRAY_SIZE(_maxLive); i++)
+    _maxLive[i] = 0;
+
+  // Data slots (and the lane index) are referenced by the builder itself so
+  // they are never released by passes that remove their last use.
   for (uint32_t i = 0; i < Globals::kMaxArgumentsCount; i++) {
-    if (i < numSlots)
-      _dataSlots[i] = newVar(IRReg::kKindGp, kPointerWidth);
-    else
-      _dataSlots[i] = nullptr;
+    IRReg* slot = nullptr;
+    if (i < numSlots) {
+      slot = newVar(IRReg::kKindGp, kPointerWidth);
+      if (slot) slot->addRef();
+    }
+    _dataSlots[i] = slot;
+    _dataAlignment[i] = 1;
+
+    for (uint32_t op = 0; op < kReduceCount; op++)
+      _reducePtrs[i][op] = nullptr;
   }
 }
 IRBuilder::~IRBuilder() noexcept {
+  for (size_t i = 0, count = _funcs.getLength(); i < count; i++) {
+    IRFunc* func = _funcs[i];
+    IRBuilder* body = func->getBody();
+
+    body->~IRBuilder();
+    _heap->release(body, sizeof(IRBuilder));
+    func->_args.release(_heap);
+  }
+
+  _funcs.release(_heap);
   _blocks.release(_heap);
 }
 
@@ -97,8 +122,8 @@ IRReg* IRBuilder::newVarByTypeInfo(uint32_t typeInfo) noexcept {
   return newVar(reg, width);
 }
 
-IRMem* IRBuilder::newMem(IRReg* base, IRReg* index, int32_t offset) noexcept {
-  IRMem* mem = newObject<IRMem>(base, index, offset);
+IRMem* IRBuilder::newMem(IRReg* base, IRReg* index, int32_t offset, uint32_t shift) noexcept {
+  IRMem* mem = newObject<IRMem>(base, index, offset, shift);
   return mem;
 }
 
@@ -129,6 +154,10 @@ IRBlock* IRBuilder::newBlock() noexcept {
   // Assign block ID.
   block->_id = ++_blockIdGen;
 
+  // Blocks are referenced by the builder so removing the last jump to a block
+  // never releases it, passes remove unreachable blocks explicitly.
+  block->addRef();
+
   _blocks.appendUnsafe(block);
   return block;
 }
@@ -147,6 +176,50 @@ Error IRBuilder::connectBlocks(IRBlock* predecessor, IRBlock* successor) noexcep
   return kErrorOk;
 }
 
+IRFunc* IRBuilder::newFunc() noexcept {
+  if (MPSL_UNLIKELY(_funcs.willGrow(_heap, 1) != kErrorOk))
+    return nullptr;
+
+  void* p = _heap->alloc(sizeof(IRBuilder));
+  if (MPSL_UNLIKELY(p == nullptr))
+    return nullptr;
+
+  // The body processes the same number of elements as its callers, but it has
+  // no lane index as it can't access data slots.
+  IRBuilder* body = new(p) IRBuilder(_heap, 0);
+  body->_laneCount = _laneCount;
+
+  IRFunc* func = newObject<IRFunc>(body);
+  if (MPSL_UNLIKELY(func == nullptr)) {
+    body->~IRBuilder();
+    _heap->release(p, sizeof(IRBuilder));
+    return nullptr;
+  }
+
+  // Functions are referenced by the builder, see `newBlock()`.
+  func->_id = static_cast<uint32_t>(_funcs.getLength()) + 1;
+  func->addRef();
+
+  _funcs.appendUnsafe(func);
+  return func;
+}
+
+IRInst* IRBuilder::newCall(IRReg* dst, IRFunc* func, IRReg** args, uint32_t argCount) noexcept {
+  IRInst* inst = _newInst(kInstCodeCall, argCount + 2);
+  if (inst == nullptr) return nullptr;
+
+  inst->_opArray[0] = dst;
+  inst->_opArray[1] = func;
+
+  for (uint32_t i = 0; i < argCount; i++)
+    inst->_opArray[i + 2] = args[i];
+
+  for (uint32_t i = 0; i < argCount + 2; i++)
+    inst->_opArray[i]->addRef();
+
+  return inst;
+}
+
 void IRBuilder::deleteInst(IRInst* inst) noexcept {
   IRObject** opArray = inst->getOpArray();
   uint32_t count = inst->getOpCount();
@@ -154,7 +227,8 @@ void IRBuilder::deleteInst(IRInst* inst) noexcept {
   for (uint32_t i = 0; i < count; i++)
     derefObject(opArray[i]);
 
-  _heap->release(inst, sizeof(IRInst));
+  // Must match the size allocated by `_newInst()`.
+  _heap->release(inst, (sizeof(IRInst) - sizeof(IRObject*)) + sizeof(IRObject*) * count);
 }
 
 void IRBuilder::deleteObject(IRObject* obj) noexcept {
@@ -190,9 +264,10 @@ void IRBuilder::deleteObject(IRObject* obj) noexcept {
         if (inst) deleteInst(inst);
       }
 
-      // TODO: Blocks should not be deleted, just marked as removed.
       block->_body.release(_heap);
-      _blocks[block->getId()] = nullptr;
+      block->_predecessors.release(_heap);
+      block->_successors.release(_heap);
+      _blocks[block->getId() - 1] = nullptr;
 
       objectSize = sizeof(IRBlock);
       break;
@@ -205,6 +280,18 @@ void IRBuilder::deleteObject(IRObject* obj) noexcept {
   _heap->release(obj, objectSize);
 }
 
+// ============================================================================
+// [mpsl::IRFunc - Arguments]
+// ============================================================================
+
+// Arguments are referenced by the function so they are never released by
+// passes that remove their last use.
+Error IRFunc::addArg(IRReg* reg) noexcept {
+  MPSL_PROPAGATE(_args.append(_body->getHeap(), reg));
+  reg->addRef();
+  return kErrorOk;
+}
+
 // ============================================================================
 // [mpsl::IRBuilder - Init]
 // ============================================================================
@@ -216,11 +303,67 @@ Error IRBuilder::initEntry() noexcept {
   MPSL_NULLCHECK(entry);
 
   entry->_blockData._blockType = IRBlock::kKindEntry;
-  entry->_refCount = 1;
 
   return kErrorOk;
 }
 
+Error IRBuilder::initLanes(uint32_t laneCount, uint32_t laneSlots) noexcept {
+  MPSL_ASSERT(_laneIndex == nullptr);
+  MPSL_ASSERT(laneCount > 1);
+
+  _laneIndex = newVar(IRReg::kKindGp, kPointerWidth);
+  MPSL_NULLCHECK(_laneIndex);
+  _laneIndex->addRef();
+
+  _laneCount = laneCount;
+  _laneSlots = laneSlots;
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::IRBuilder - Reductions]
+// ============================================================================
+
+IRReg* IRBuilder::getReducePtr(uint32_t slot, uint32_t op) noexcept {
+  MPSL_ASSERT(slot < _numSlots);
+  MPSL_ASSERT(op != kReduceNone && op < kReduceCount);
+
+  IRReg* reg = _reducePtrs[slot][op];
+  if (reg == nullptr) {
+    // Referenced by the builder like data slots.
+    reg = newVar(IRReg::kKindGp, kPointerWidth);
+    if (reg == nullptr)
+      return nullptr;
+
+    reg->addRef();
+    _reducePtrs[slot][op] = reg;
+    _reduceCount++;
+  }
+
+  return reg;
+}
+
+uint32_t IRBuilder::getReduceOp(const IRReg* reg) const noexcept {
+  if (reg == nullptr || _reduceCount == 0)
+    return kReduceNone;
+
+  for (uint32_t i = 0; i < _numSlots; i++)
+    for (uint32_t op = kReduceSum; op < kReduceCount; op++)
+      if (_reducePtrs[i][op] == reg)
+        return op;
+
+  return kReduceNone;
+}
+
+uint32_t IRBuilder::getReduceSlot(const IRReg* reg) const noexcept {
+  for (uint32_t i = 0; i < _numSlots; i++)
+    for (uint32_t op = kReduceSum; op < kReduceCount; op++)
+      if (_reducePtrs[i][op] == reg)
+        return i;
+
+  return kInvalidDataSlot;
+}
+
 // ============================================================================
 // [mpsl::IRBuilder - Emit]
 // ============================================================================
@@ -277,6 +420,57 @@ Error IRBuilder::emitFetch(IRBlock* block, IRReg* dst, IRObject* src) noexcept {
   return emitInst(block, inst, dst, src);
 }
 
+// ============================================================================
+// [mpsl::IRBuilder - JIT]
+// ============================================================================
+
+static MPSL_INLINE void mpResetJitId(IRReg* reg) noexcept {
+  if (reg) reg->setJitId(kInvalidRegId);
+}
+
+// Functions keep their JIT data, they are compiled once and shared by all
+// entry points.
+void IRBuilder::resetJitState() noexcept {
+  for (uint32_t i = 0; i < _numSlots; i++) {
+    mpResetJitId(_dataSlots[i]);
+    for (uint32_t op = 0; op < kReduceCount; op++)
+      mpResetJitId(_reducePtrs[i][op]);
+  }
+  mpResetJitId(_laneIndex);
+
+  IRBlocks& blocks = getBlocks();
+  size_t count = blocks.getLength();
+
+  for (size_t i = 0; i < count; i++) {
+    IRBlock* block = blocks[i];
+    if (block == nullptr) continue;
+
+    block->_blockData._isAssembled = false;
+    block->_blockData._jitId = kInvalidRegId;
+
+    IRBody& body = block->getBody();
+    for (size_t j = 0, len = body.getLength(); j < len; j++) {
+      IRInst* inst = body[j];
+
+      IRObject** opArray = inst->getOpArray();
+      uint32_t opCount = inst->getOpCount();
+
+      for (uint32_t opIndex = 0; opIndex < opCount; opIndex++) {
+        IRObject* op = opArray[opIndex];
+
+        if (op->isReg()) {
+          mpResetJitId(op->as<IRReg>());
+        }
+        else if (op->isMem()) {
+          IRMem* mem = op->as<IRMem>();
+          mpResetJitId(mem->getBase());
+          mpResetJitId(mem->getIndex());
+        }
+      }
+    }
+  }
+}
+
 // ============================================================================
 // [mpsl::IRBuilder - Dump]
 // ============================================================================
@@ -287,8 +481,9 @@ Error IRBuilder::dump(StringBuilder& sb) noexcept {
 
   for (size_t i = 0; i < count; i++) {
     IRBlock* block = blocks[i];
-    const IRBody& body = block->getBody();
+    if (block == nullptr) continue;
 
+    const IRBody& body = block->getBody();
     sb.appendFormat(".B%u\n", block->getId());
 
     for (size_t i = 0, len = body.getLength(); i < len; i++) {
@@ -322,9 +517,16 @@ Error IRBuilder::dump(StringBuilder& sb) noexcept {
 
           case IRObject::kTypeMem: {
             IRMem* mem = static_cast<IRMem*>(op);
-            sb.appendFormat("[%%%u + %d]",
-              mem->getBase()->getId(),
-              static_cast<int>(mem->getOffset()));
+            if (mem->hasIndex())
+              sb.appendFormat("[%%%u + %%%u << %u + %d]",
+                mem->getBase()->getId(),
+                mem->getIndex()->getId(),
+                mem->getShift(),
+                static_cast<int>(mem->getOffset()));
+            else
+              sb.appendFormat("[%%%u + %d]",
+                mem->getBase()->getId(),
+                static_cast<int>(mem->getOffset()));
             break;
           }
 
@@ -339,6 +541,11 @@ Error IRBuilder::dump(StringBuilder& sb) noexcept {
             sb.appendFormat("B%u", block->getId());
             break;
           }
+
+          case IRObject::kTypeFunc: {
+            sb.appendFormat("F%u", op->getId());
+            break;
+          }
         }
       }
 
@@ -346,6 +553,18 @@ Error IRBuilder::dump(StringBuilder& sb) noexcept {
     }
   }
 
+  for (size_t i = 0, count = _funcs.getLength(); i < count; i++) {
+    IRFunc* func = _funcs[i];
+    const IRRegs& args = func->getArgs();
+
+    sb.appendFormat(".F%u(", func->getId());
+    for (size_t j = 0; j < args.getLength(); j++)
+      sb.appendFormat(j == 0 ? "%%%u" : ", %%%u", args[j]->getId());
+    sb.appendString(")\n");
+
+    MPSL_PROPAGATE(func->getBody()->dump(sb));
+  }
+
   return kErrorOk;
 }
 
@@ -29,9 +29,12 @@ class IRReg;
 class IRMem;
 class IRImm;
 class IRInst;
+class IRFunc;
 
 typedef ZoneVector<IRInst*> IRBody;
 typedef ZoneVector<IRBlock*> IRBlocks;
+typedef ZoneVector<IRReg*> IRRegs;
+typedef ZoneVector<IRFunc*> IRFuncs;
 
 // ============================================================================
 // [mpsl::IRBuilder]
@@ -60,6 +63,10 @@ public:
   MPSL_INLINE IRBlocks& getExits() noexcept { return _exits; }
   MPSL_INLINE const IRBlocks& getExits() const noexcept { return _exits; }
 
+  //! Get functions called out-of-line, see `newFunc()`.
+  MPSL_INLINE IRFuncs& getFuncs() noexcept { return _funcs; }
+  MPSL_INLINE const IRFuncs& getFuncs() const noexcept { return _funcs; }
+
   MPSL_INLINE IRBlock* getEntry() const noexcept {
     MPSL_ASSERT(!_blocks.isEmpty());
     return _blocks[0];
@@ -72,6 +79,49 @@ public:
 
   MPSL_INLINE uint32_t getNumSlots() const noexcept { return _numSlots; }
 
+  //! Get the alignment of the data `slot`, see `Layout::setAlignment()`.
+  MPSL_INLINE uint32_t getDataAlignment(uint32_t slot) const noexcept {
+    MPSL_ASSERT(slot < Globals::kMaxArgumentsCount);
+    return _dataAlignment[slot];
+  }
+  //! Set the alignment of the data `slot`.
+  MPSL_INLINE void setDataAlignment(uint32_t slot, uint32_t alignment) noexcept {
+    MPSL_ASSERT(slot < Globals::kMaxArgumentsCount);
+    _dataAlignment[slot] = alignment;
+  }
+
+  //! Get the pointer to the data `slot` used to access members reduced by
+  //! `op` (see \ref ReduceOp), created by the first use. The backend keeps
+  //! these members in registers during a batch and this pointer is never
+  //! advanced by it. Returns null if out of memory.
+  IRReg* getReducePtr(uint32_t slot, uint32_t op) noexcept;
+  //! Get \ref ReduceOp of members accessed through `reg`, `kReduceNone` if
+  //! `reg` was not returned by `getReducePtr()`.
+  uint32_t getReduceOp(const IRReg* reg) const noexcept;
+  //! Get the data slot of a pointer returned by `getReducePtr()`.
+  uint32_t getReduceSlot(const IRReg* reg) const noexcept;
+  //! Get whether the IR accesses at least one reduction member.
+  MPSL_INLINE bool hasReductions() const noexcept { return _reduceCount != 0; }
+
+  //! Get the maximum number of registers of `kind` live at the same time,
+  //! measured by `mpIRPass()`.
+  MPSL_INLINE uint32_t getMaxLive(uint32_t kind) const noexcept {
+    MPSL_ASSERT(kind < MPSL_ARRAY_SIZE(_maxLive));
+    return _maxLive[kind];
+  }
+
+  //! Get the number of elements processed at once (1 if not using lanes).
+  MPSL_INLINE uint32_t getLaneCount() const noexcept { return _laneCount; }
+  //! Get whether the IR processes more elements at once, see `initLanes()`.
+  MPSL_INLINE bool hasLanes() const noexcept { return _laneIndex != nullptr; }
+  //! Get the lane index register (index of the first element being processed).
+  MPSL_INLINE IRReg* getLaneIndex() const noexcept { return _laneIndex; }
+  //! Get whether the data `slot` is a SoA (its members are columns).
+  MPSL_INLINE bool isLaneSlot(uint32_t slot) const noexcept {
+    MPSL_ASSERT(slot < _numSlots);
+    return (_laneSlots & (1U << slot)) != 0;
+  }
+
   // --------------------------------------------------------------------------
   // [Factory]
   // --------------------------------------------------------------------------
@@ -104,12 +154,18 @@ public:
     MPSL_ALLOC_IR_OBJECT(sizeof(T));
     return new(obj) T(this, p0, p1, p2);
   }
+
+  template<typename T, typename P0, typename P1, typename P2, typename P3>
+  MPSL_INLINE T* newObject(P0 p0, P1 p1, P2 p2, P3 p3) noexcept {
+    MPSL_ALLOC_IR_OBJECT(sizeof(T));
+    return new(obj) T(this, p0, p1, p2, p3);
+  }
 #undef MPSL_ALLOC_IR_OBJECT
 
   IRReg* newVar(uint32_t reg, uint32_t width) noexcept;
   IRReg* newVarByTypeInfo(uint32_t typeInfo) noexcept;
 
-  IRMem* newMem(IRReg* base, IRReg* index, int32_t offset) noexcept;
+  IRMem* newMem(IRReg* base, IRReg* index, int32_t offset, uint32_t shift = 0) noexcept;
 
   IRImm* newImm(const Value& value, uint32_t reg, uint32_t immSize) noexcept;
   IRImm* newImmByTypeInfo(const Value& value, uint32_t typeInfo) noexcept;
@@ -117,10 +173,16 @@ public:
   IRBlock* newBlock() noexcept;
   Error connectBlocks(IRBlock* predecessor, IRBlock* successor) noexcept;
 
+  //! Create a function that has its own IR and is called by `kInstCodeCall`.
+  IRFunc* newFunc() noexcept;
+
   MPSL_INLINE IRInst* _newInst(uint32_t instCode, uint32_t opCount) noexcept;
   MPSL_INLINE IRInst* newInst(uint32_t instCode, IRObject* o0) noexcept;
   MPSL_INLINE IRInst* newInst(uint32_t instCode, IRObject* o0, IRObject* o1) noexcept;
   MPSL_INLINE IRInst* newInst(uint32_t instCode, IRObject* o0, IRObject* o1, IRObject* o2) noexcept;
+  MPSL_INLINE IRInst* newInst(uint32_t instCode, IRObject* o0, IRObject* o1, IRObject* o2, IRObject* o3) noexcept;
+  //! Create `call dst, func, args...`, `dst` receives the value returned.
+  IRInst* newCall(IRReg* dst, IRFunc* func, IRReg** args, uint32_t argCount) noexcept;
 
   void deleteInst(IRInst* obj) noexcept;
   void deleteObject(IRObject* obj) noexcept;
@@ -132,6 +194,10 @@ public:
 
   Error initEntry() noexcept;
 
+  //! Process `laneCount` elements at once. Members of all data slots marked
+  //! in `laneSlots` are columns indexed by `getLaneIndex()`.
+  Error initLanes(uint32_t laneCount, uint32_t laneSlots) noexcept;
+
   // --------------------------------------------------------------------------
   // [Emit]
   // --------------------------------------------------------------------------
@@ -144,6 +210,14 @@ public:
   // TODO: Probably remove.
   Error emitFetch(IRBlock* block, IRReg* dst, IRObject* src) noexcept;
 
+  // --------------------------------------------------------------------------
+  // [JIT]
+  // --------------------------------------------------------------------------
+
+  //! Reset JIT IDs of all registers and the assembled flag of all blocks so
+  //! the IR can be compiled again (for example as another entry-point).
+  void resetJitState() noexcept;
+
   // --------------------------------------------------------------------------
   // [Dump]
   // --------------------------------------------------------------------------
@@ -157,13 +231,27 @@ public:
   ZoneHeap* _heap;                       //!< Memory heap used to allocate IR objects.
   IRBlocks _blocks;                      //!< IR basic blocks.
   IRBlocks _exits;                       //!< IR basic blocks without successors (exits).
+  IRFuncs _funcs;                        //!< Functions called out-of-line.
 
   //! Entry point arguments.
   IRReg* _dataSlots[Globals::kMaxArgumentsCount];
   uint32_t _numSlots;                    //!< Number of entry-point arguments.
+  //! Alignment of data of each slot, see `getDataAlignment()`.
+  uint32_t _dataAlignment[Globals::kMaxArgumentsCount];
+
+  //! Pointers used by reductions (by slot and \ref ReduceOp), see `getReducePtr()`.
+  IRReg* _reducePtrs[Globals::kMaxArgumentsCount][kReduceCount];
+  uint32_t _reduceCount;                 //!< Number of reduction pointers created.
+
+  IRReg* _laneIndex;                     //!< Lane index, only used with lanes.
+  uint32_t _laneCount;                   //!< Number of lanes (elements processed at once).
+  uint32_t _laneSlots;                   //!< Data slots that are SoA (bit-mask).
 
   uint32_t _blockIdGen;                  //!< Block ID generator.
   uint32_t _varIdGen;                    //!< Variable ID generator.
+
+  //! Maximum number of registers live at the same time (by `IRReg::Kind`).
+  uint32_t _maxLive[3];
 };
 
 // ============================================================================
@@ -181,7 +269,8 @@ public:
     kTypeReg   = 1,                      //!< The object is \ref IRReg.
     kTypeMem   = 2,                      //!< The object is \ref IRMem.
     kTypeImm   = 3,                      //!< The object is \ref IRImm.
-    kTypeBlock = 4                       //!< The object is \ref IRBlock.
+    kTypeBlock = 4,                      //!< The object is \ref IRBlock.
+    kTypeFunc  = 5                       //!< The object is \ref IRFunc.
   };
 
   // --------------------------------------------------------------------------
@@ -213,6 +302,8 @@ public:
   MPSL_INLINE bool isImm() const noexcept { return getObjectType() == kTypeImm; }
   //! Get whether the `IRObject` is `IRBlock`.
   MPSL_INLINE bool isBlock() const noexcept { return getObjectType() == kTypeBlock; }
+  //! Get whether the `IRObject` is `IRFunc`.
+  MPSL_INLINE bool isFunc() const noexcept { return getObjectType() == kTypeFunc; }
 
   //! Get the object ID.
   MPSL_INLINE uint32_t getId() const noexcept { return _id; }
@@ -337,11 +428,16 @@ public:
   // [Construction / Destruction]
   // --------------------------------------------------------------------------
 
-  MPSL_INLINE IRMem(IRBuilder* ir, IRReg* base, IRReg* index, int32_t offset) noexcept
+  MPSL_INLINE IRMem(IRBuilder* ir, IRReg* base, IRReg* index, int32_t offset, uint32_t shift) noexcept
     : IRObject(ir, kTypeMem),
       _base(base),
       _index(index),
-      _offset(offset) {
+      _offset(offset),
+      _shift(shift),
+      _alignment(1),
+      _padding(0),
+      _storage(0),
+      _writeOnly(false) {
 
     if (base) base->addRef();
     if (index) index->addRef();
@@ -366,6 +462,25 @@ public:
   //! Get immediate offset.
   MPSL_INLINE int32_t getOffset() const noexcept { return _offset; }
 
+  //! Get index shift (scale), only meaningful if the index is used.
+  MPSL_INLINE uint32_t getShift() const noexcept { return _shift; }
+
+  //! Get the alignment of the address (1 if not known).
+  MPSL_INLINE uint32_t getAlignment() const noexcept { return _alignment; }
+  //! Get the number of bytes that follow the accessed data and can be read
+  //! and overwritten, see `kTypePadded`.
+  MPSL_INLINE uint32_t getPadding() const noexcept { return _padding; }
+  //! Get the format of the accessed data, `kTypeStorageMask` and
+  //! `kTypeNormalized` bits (0 if it's stored as its type).
+  MPSL_INLINE uint32_t getStorage() const noexcept { return _storage; }
+  //! Get if the accessed data is only written by the program, see `kTypeWO`.
+  MPSL_INLINE bool isWriteOnly() const noexcept { return _writeOnly; }
+
+  MPSL_INLINE void setAlignment(uint32_t alignment) noexcept { _alignment = alignment; }
+  MPSL_INLINE void setPadding(uint32_t padding) noexcept { _padding = padding; }
+  MPSL_INLINE void setStorage(uint32_t storage) noexcept { _storage = storage; }
+  MPSL_INLINE void setWriteOnly(bool writeOnly) noexcept { _writeOnly = writeOnly; }
+
   // --------------------------------------------------------------------------
   // [Members]
   // --------------------------------------------------------------------------
@@ -373,6 +488,11 @@ public:
   IRReg* _base;
   IRReg* _index;
   int32_t _offset;
+  uint32_t _shift;
+  uint32_t _alignment;
+  uint32_t _padding;
+  uint32_t _storage;
+  bool _writeOnly;
 };
 
 // ============================================================================
@@ -512,6 +632,23 @@ MPSL_INLINE IRInst* IRBuilder::newInst(uint32_t instCode, IRObject* o0, IRObject
   return inst;
 }
 
+MPSL_INLINE IRInst* IRBuilder::newInst(uint32_t instCode, IRObject* o0, IRObject* o1, IRObject* o2, IRObject* o3) noexcept {
+  IRInst* inst = _newInst(instCode, 4);
+  if (inst == nullptr) return nullptr;
+
+  inst->_opArray[0] = o0;
+  inst->_opArray[1] = o1;
+  inst->_opArray[2] = o2;
+  inst->_opArray[3] = o3;
+
+  o0->addRef();
+  o1->addRef();
+  o2->addRef();
+  o3->addRef();
+
+  return inst;
+}
+
 // ============================================================================
 // [mpsl::IRBlock]
 // ============================================================================
@@ -545,6 +682,7 @@ public:
   // [Accessors]
   // --------------------------------------------------------------------------
 
+  MPSL_INLINE IRBuilder* getIR() const noexcept { return _ir; }
   MPSL_INLINE bool isEmpty() const noexcept { return _body.isEmpty(); }
   MPSL_INLINE uint32_t getBlockType() const noexcept { return _blockData._blockType; }
 
@@ -595,6 +733,70 @@ public:
   bool _requiresFixup;                   //!< Body contains nulls and must be fixed.
 };
 
+// ============================================================================
+// [mpsl::IRFunc]
+// ============================================================================
+
+//! A function called out-of-line.
+//!
+//! The function has its own `IRBuilder` that is optimized and compiled once,
+//! its arguments and return value are single registers. It has no access to
+//! data slots and all its calls are inlined. The exit of its body ends with
+//! `ret`, which uses the returned value.
+class IRFunc : public IRObject {
+public:
+  MPSL_NONCOPYABLE(IRFunc)
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  MPSL_INLINE IRFunc(IRBuilder* ir, IRBuilder* body) noexcept
+    : IRObject(ir, kTypeFunc),
+      _body(body),
+      _args(),
+      _retReg(IRReg::kKindNone),
+      _retWidth(0),
+      _jitData(nullptr) {}
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  //! Get the IR of the function body.
+  MPSL_INLINE IRBuilder* getBody() const noexcept { return _body; }
+
+  //! Get arguments (registers of the body).
+  MPSL_INLINE const IRRegs& getArgs() const noexcept { return _args; }
+  //! Add an argument `reg` (a register of the body).
+  Error addArg(IRReg* reg) noexcept;
+
+  //! Get the register kind of the returned value, see \ref IRReg::Kind.
+  MPSL_INLINE uint32_t getRetReg() const noexcept { return _retReg; }
+  //! Get the width of the returned value.
+  MPSL_INLINE uint32_t getRetWidth() const noexcept { return _retWidth; }
+  //! Set the register kind and width of the returned value.
+  MPSL_INLINE void setRet(uint32_t reg, uint32_t width) noexcept {
+    _retReg = reg;
+    _retWidth = width;
+  }
+
+  //! Get the JIT compiler associated data (shared by all entry points).
+  MPSL_INLINE void* getJitData() const noexcept { return _jitData; }
+  //! Set the JIT compiler associated data.
+  MPSL_INLINE void setJitData(void* data) noexcept { _jitData = data; }
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  IRBuilder* _body;                      //!< IR of the function body.
+  IRRegs _args;                          //!< Arguments.
+  uint32_t _retReg;                      //!< Register kind of the returned value.
+  uint32_t _retWidth;                    //!< Width of the returned value.
+  void* _jitData;                        //!< JIT compiler associated data.
+};
+
 // ============================================================================
 // [mpsl::IRPair]
 // ============================================================================
@@ -615,6 +817,12 @@ public:
     : lo(other.lo),
       hi(other.hi) {}
 
+  MPSL_INLINE IRPair<T>& operator=(const IRPair<T>& other) noexcept {
+    this->lo = other.lo;
+    this->hi = other.hi;
+    return *this;
+  }
+
   MPSL_INLINE Error set(T* lo, T* hi = nullptr) noexcept {
     this->lo = lo;
     this->hi = hi;
@@ -0,0 +1,70 @@
+// [MPSL]
+// MathPresso's Shading Language with JIT Engine for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define MPSL_EXPORTS
+
+// [Dependencies - MPSL]
+#include "./mpirbackend_p.h"
+#include "./mpirtox86_p.h"
+
+// [Api-Begin]
+#include "./mpsl_apibegin.h"
+
+namespace mpsl {
+
+// ============================================================================
+// [mpsl::IRBackend - Construction / Destruction]
+// ============================================================================
+
+IRBackend::IRBackend() noexcept
+  : _counters(nullptr),
+    _countCycles(false),
+    _streamStores(false),
+    _prefetchDistance(0) {}
+
+IRBackend::~IRBackend() {}
+
+// ============================================================================
+// [mpsl::IRTarget - Construction / Destruction]
+// ============================================================================
+
+IRTarget::IRTarget(ZoneHeap* heap, const asmjit::CodeInfo& codeInfo, asmjit::Logger* logger) noexcept
+  : _heap(heap) {
+
+  _code.init(codeInfo);
+  if (logger != nullptr)
+    _code.setLogger(logger);
+}
+
+IRTarget::~IRTarget() {}
+
+// ============================================================================
+// [mpsl::IRTarget - Factory]
+// ============================================================================
+
+Error IRTarget::newTarget(IRTarget** out, ZoneHeap* heap, const asmjit::CodeInfo& codeInfo, asmjit::Logger* logger) noexcept {
+#if MPSL_BUILD_X86
+  void* p = ::malloc(sizeof(X86Target));
+  MPSL_NULLCHECK(p);
+
+  *out = new(p) X86Target(heap, codeInfo, logger);
+  return kErrorOk;
+#else
+  *out = nullptr;
+  return MPSL_TRACE_ERROR(kErrorUnsupportedTarget);
+#endif // MPSL_BUILD_X86
+}
+
+void IRTarget::deleteTarget(IRTarget* target) noexcept {
+  target->~IRTarget();
+  ::free(target);
+}
+
+} // mpsl namespace
+
+// [Api-End]
+#include "./mpsl_apiend.h"
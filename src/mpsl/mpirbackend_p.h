@@ -0,0 +1,155 @@
+// [MPSL]
+// MathPresso's Shading Language with JIT Engine for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _MPSL_MPIRBACKEND_P_H
+#define _MPSL_MPIRBACKEND_P_H
+
+// [Dependencies - MPSL]
+#include "./mpir_p.h"
+
+// [Api-Begin]
+#include "./mpsl_apibegin.h"
+
+namespace mpsl {
+
+// ============================================================================
+// [mpsl::CpuFeatures]
+// ============================================================================
+
+//! \internal
+//!
+//! CPU features used by compiled code, stored in serialized programs.
+enum CpuFeatures {
+  kCpuFeatureSSE4_1 = 0x0001,
+  kCpuFeatureAVX    = 0x0002,
+  kCpuFeatureAVX2   = 0x0004,
+  kCpuFeatureFMA    = 0x0008,
+  kCpuFeatureF16C   = 0x0010
+};
+
+// ============================================================================
+// [mpsl::IRBackend]
+// ============================================================================
+
+//! \internal
+//!
+//! Compiles IR to the code of an `IRTarget`.
+//!
+//! Each entry point and each function called out-of-line is compiled by its
+//! own backend created by `IRTarget::newBackend()`, all of them emit to the
+//! same code.
+class IRBackend {
+public:
+  MPSL_NONCOPYABLE(IRBackend)
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  IRBackend() noexcept;
+  virtual ~IRBackend();
+
+  // --------------------------------------------------------------------------
+  // [Compile]
+  // --------------------------------------------------------------------------
+
+  //! Compile `ir` as `main()` of a program.
+  virtual Error compileIRAsFunc(IRBuilder* ir) = 0;
+  //! Compile `ir` as the batch entry-point of a program.
+  virtual Error compileIRAsBatch(IRBuilder* ir) = 0;
+  //! Compile the body of an out-of-line function `func`, must be called after
+  //! all entry points that call it have been compiled.
+  virtual Error compileIRAsCallee(IRFunc* func) = 0;
+  //! Compile `block` followed by `next` (null if it's the last block).
+  virtual Error compileBasicBlock(IRBlock* block, IRBlock* next) = 0;
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  //! Get CPU features used by the compiled code, see `CpuFeatures`.
+  virtual uint32_t getFeatures() const = 0;
+  //! Get the size of constants embedded in the code by this backend.
+  virtual size_t getConstPoolSize() const = 0;
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  //! Counters updated by entry points (null if runs are not counted).
+  ProgramCounterSlot* _counters;
+  //! Count also cycles spent in entry points.
+  bool _countCycles;
+
+  //! Write aligned 128-bit and 256-bit data by non-temporal stores, batches
+  //! only, see `kOptionStreamStores`.
+  bool _streamStores;
+  //! Number of records a batch prefetches ahead (0 if it doesn't prefetch).
+  uint32_t _prefetchDistance;
+};
+
+// ============================================================================
+// [mpsl::IRTarget]
+// ============================================================================
+
+//! \internal
+//!
+//! Code of a single program variant and the backends that emit to it.
+//!
+//! A target is created by `newTarget()` for the architecture MPSL is built
+//! for, which is the only place that depends on it. Only X86 and X64 have a
+//! target (`X86Target`), supporting another architecture (like AArch64 with
+//! NEON) means implementing `IRTarget` and `IRBackend` for it.
+class IRTarget {
+public:
+  MPSL_NONCOPYABLE(IRTarget)
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  IRTarget(ZoneHeap* heap, const asmjit::CodeInfo& codeInfo, asmjit::Logger* logger) noexcept;
+  virtual ~IRTarget();
+
+  //! Create a target of the host architecture, `logger` logs its code if not
+  //! null. Fails with `kErrorUnsupportedTarget` if MPSL has no backend for
+  //! the host.
+  static Error newTarget(IRTarget** out, ZoneHeap* heap, const asmjit::CodeInfo& codeInfo, asmjit::Logger* logger) noexcept;
+  //! Destroy a target created by `newTarget()` and all its backends.
+  static void deleteTarget(IRTarget* target) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Interface]
+  // --------------------------------------------------------------------------
+
+  //! Create a backend that emits to `_code` restricted by `options`. The
+  //! backend is owned by the target.
+  virtual Error newBackend(IRBackend** out, uint32_t options) = 0;
+  //! Finalize `_code` after all backends have compiled their functions.
+  virtual Error finalize() = 0;
+
+  //! Get the offset of the entry point compiled by `backend` in `_code`.
+  virtual uint32_t getEntryOffset(const IRBackend* backend) const = 0;
+  //! Get the offset of the slot holding the address of `mpGetSharedConsts()`
+  //! embedded by `finalize()` (0 if no backend used shared constants).
+  virtual uint32_t getConstSlot() const = 0;
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  ZoneHeap* _heap;
+  asmjit::CodeHolder _code;
+};
+
+} // mpsl namespace
+
+// [Api-End]
+#include "./mpsl_apiend.h"
+
+// [Guard]
+#endif // _MPSL_MPIRBACKEND_P_H
@@ -0,0 +1,692 @@
+// [MPSL]
+// MathPresso's Shading Language with JIT Engine for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define MPSL_EXPORTS
+
+// [Dependencies - MPSL]
+#include "./mpirlower_p.h"
+
+// [Api-Begin]
+#include "./mpsl_apibegin.h"
+
+namespace mpsl {
+
+// ============================================================================
+// [mpsl::IRLowering - Constants]
+// ============================================================================
+
+// Constants are stored as doubles, float kernels use them rounded to float.
+// Polynomial coefficients are ordered from the highest power.
+
+static const double mpLog2E  = 1.44269504088896340736;
+static const double mpLog10E = 0.43429448190325182765;
+static const double mpSqrtH  = 0.70710678118654752440;
+static const double mp2OverPi = 0.63661977236758134308;
+
+static const double mpExpCoeffF[] = {
+  1.9875691500E-4, 1.3981999507E-3, 8.3334519073E-3, 4.1665795894E-2,
+  1.6666665459E-1, 5.0000001201E-1
+};
+
+static const double mpExpCoeffP[] = {
+  1.26177193074810590878E-4, 3.02994407707441961300E-2, 9.99999999999999999910E-1
+};
+
+static const double mpExpCoeffQ[] = {
+  3.00198505138664455042E-6, 2.52448340349684104192E-3, 2.27265548208155028766E-1,
+  2.00000000000000000009E0
+};
+
+static const double mpLogCoeffF[] = {
+  7.0376836292E-2, -1.1514610310E-1, 1.1676998740E-1, -1.2420140846E-1,
+  1.4249322787E-1, -1.6668057665E-1, 2.0000714765E-1, -2.4999993993E-1,
+  3.3333331174E-1
+};
+
+static const double mpLogCoeffP[] = {
+  1.01875663804580931796E-4, 4.97494994976747001425E-1, 4.70579119878881725854E0,
+  1.44989225341610930846E1, 1.79368678507819816313E1, 7.70838733755885391666E0
+};
+
+static const double mpLogCoeffQ[] = {
+  1.12873587189167450590E1, 4.52279145837532221105E1, 8.29875266912776603211E1,
+  7.11544750618563894466E1, 2.31251620126765340583E1
+};
+
+static const double mpSinCoeffF[] = {
+  -1.9515295891E-4, 8.3321608736E-3, -1.6666654611E-1
+};
+
+static const double mpCosCoeffF[] = {
+  2.443315711809948E-5, -1.388731625493765E-3, 4.166664568298827E-2
+};
+
+static const double mpSinCoeffD[] = {
+  1.58962301576546568060E-10, -2.50507477628578072866E-8, 2.75573136213857245213E-6,
+  -1.98412698295895385996E-4, 8.33333333332211858878E-3, -1.66666666666666307295E-1
+};
+
+static const double mpCosCoeffD[] = {
+  -1.13585365213876817300E-11, 2.08757008419747316778E-9, -2.75573141792967388112E-7,
+  2.48015872888517045348E-5, -1.38888888888730564116E-3, 4.16666666666665929218E-2
+};
+
+// ============================================================================
+// [mpsl::IRLowering - Helpers]
+// ============================================================================
+
+static MPSL_INLINE bool mpIsLowered(uint32_t instCode) noexcept {
+  switch (instCode & kInstCodeMask) {
+    case kInstCodeExpf  : case kInstCodeExpd  :
+    case kInstCodeLogf  : case kInstCodeLogd  :
+    case kInstCodeLog2f : case kInstCodeLog2d :
+    case kInstCodeLog10f: case kInstCodeLog10d:
+    case kInstCodeSinf  : case kInstCodeSind  :
+    case kInstCodeCosf  : case kInstCodeCosd  :
+    case kInstCodeTanf  : case kInstCodeTand  :
+    case kInstCodePowf  : case kInstCodePowd  :
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+static MPSL_INLINE uint32_t mpFetchByWidth(uint32_t width) noexcept {
+  switch (width) {
+    case  4: return kInstCodeFetch32;
+    case  8: return kInstCodeFetch64;
+    case 12: return kInstCodeFetch96;
+    case 16: return kInstCodeFetch128;
+    case 24: return kInstCodeFetch192;
+    case 32: return kInstCodeFetch256;
+
+    default:
+      return kInstCodeNone;
+  }
+}
+
+//! Get the constant value of `obj` used by `body[index]`, which is either an
+//! immediate or a register fetched from an immediate in the same block.
+static bool mpGetConstant(const IRBody& body, size_t index, IRObject* obj, Value& out) noexcept {
+  if (obj->isImm()) {
+    out = obj->as<IRImm>()->getValue();
+    return true;
+  }
+
+  if (!obj->isReg())
+    return false;
+
+  while (index != 0) {
+    IRInst* inst = body[--index];
+    if (inst->getOpCount() == 0 || inst->getOperand(0) != obj)
+      continue;
+
+    const InstInfo& info = mpInstInfo[inst->getInstCode() & kInstCodeMask];
+    if (info.isStore())
+      continue;
+
+    if (!info.isFetch() || !inst->getOperand(1)->isImm())
+      return false;
+
+    out = inst->getOperand(1)->as<IRImm>()->getValue();
+    return true;
+  }
+
+  return false;
+}
+
+//! Get whether all elements of `value` are the same integer `n`.
+static bool mpGetIntExponent(const Value& value, uint32_t width, bool isF64, int32_t& n) noexcept {
+  uint32_t count = width / (isF64 ? 8 : 4);
+  double y = isF64 ? value.d[0] : static_cast<double>(value.f[0]);
+
+  if (!(y >= -2147483648.0 && y <= 2147483647.0) || static_cast<double>(static_cast<int32_t>(y)) != y)
+    return false;
+
+  for (uint32_t i = 1; i < count; i++) {
+    double e = isF64 ? value.d[i] : static_cast<double>(value.f[i]);
+    if (e != y)
+      return false;
+  }
+
+  n = static_cast<int32_t>(y);
+  return true;
+}
+
+// ============================================================================
+// [mpsl::IRLowering - Construction / Destruction]
+// ============================================================================
+
+IRLowering::IRLowering(IRBuilder* ir) noexcept
+  : _ir(ir),
+    _heap(ir->getHeap()),
+    _body(nullptr),
+    _index(0),
+    _width(0),
+    _fpVec(0),
+    _intVec(0),
+    _isF64(false) {}
+IRLowering::~IRLowering() noexcept {}
+
+// ============================================================================
+// [mpsl::IRLowering - Run]
+// ============================================================================
+
+Error IRLowering::run() noexcept {
+  IRBlocks& blocks = _ir->getBlocks();
+
+  for (size_t i = 0, count = blocks.getLength(); i < count; i++) {
+    IRBody& body = blocks[i]->getBody();
+
+    size_t j = 0;
+    while (j < body.getLength()) {
+      if (mpIsLowered(body[j]->getInstCode()))
+        MPSL_PROPAGATE(lowerInst(body, j));
+      else
+        j++;
+    }
+  }
+
+  return kErrorOk;
+}
+
+Error IRLowering::lowerInst(IRBody& body, size_t& index) noexcept {
+  IRInst* inst = body[index];
+  IRReg* dst = inst->getOperand(0)->as<IRReg>();
+
+  uint32_t instCode = inst->getInstCode();
+  uint32_t width = dst->getWidth();
+
+  // Integer instructions have no scalar form that works with SIMD registers,
+  // scalars use the 128-bit form and ignore the remaining elements.
+  _body = &body;
+  _index = index;
+  _fpVec = instCode & kInstVecMask;
+  _intVec = _fpVec != kInstVec0 ? _fpVec : static_cast<uint32_t>(kInstVec128);
+  _width = _fpVec == kInstVec0 ? width : width <= 16 ? 16 : 32;
+  _isF64 = mpInstInfo[instCode & kInstCodeMask].isF64();
+
+  IRReg* x = emitReg(inst->getOperand(1), width);
+  IRReg* result = nullptr;
+
+  switch (instCode & kInstCodeMask) {
+    case kInstCodeExpf  : case kInstCodeExpd  : result = emitExp(dst, x); break;
+    case kInstCodeLogf  : case kInstCodeLogd  : result = emitLog(dst, x, kLogE); break;
+    case kInstCodeLog2f : case kInstCodeLog2d : result = emitLog(dst, x, kLog2); break;
+    case kInstCodeLog10f: case kInstCodeLog10d: result = emitLog(dst, x, kLog10); break;
+    case kInstCodeSinf  : case kInstCodeSind  : result = emitTrig(dst, x, kTrigSin); break;
+    case kInstCodeCosf  : case kInstCodeCosd  : result = emitTrig(dst, x, kTrigCos); break;
+    case kInstCodeTanf  : case kInstCodeTand  : result = emitTrig(dst, x, kTrigTan); break;
+    case kInstCodePowf  : case kInstCodePowd  : {
+      Value y;
+      int32_t n;
+
+      if (mpGetConstant(body, index, inst->getOperand(2), y) &&
+          mpGetIntExponent(y, width, _isF64, n) && n != 0 && n >= -kMaxIntPow && n <= kMaxIntPow)
+        result = emitPowInt(dst, x, n);
+      else
+        result = emitPow(dst, x, emitReg(inst->getOperand(2), width));
+      break;
+    }
+
+    default:
+      return MPSL_TRACE_ERROR(kErrorInvalidState);
+  }
+
+  if (result == nullptr)
+    return MPSL_TRACE_ERROR(kErrorNoMemory);
+
+  // The lowered instruction follows the emitted sequence.
+  body.removeAt(_index);
+  _ir->deleteInst(inst);
+
+  index = _index;
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::IRLowering - Emit]
+// ============================================================================
+
+IRReg* IRLowering::emitInst(uint32_t instCode, IRObject* o1, IRObject* o2, IRReg* dst) noexcept {
+  if (o1 == nullptr || o2 == nullptr)
+    return nullptr;
+
+  if (dst == nullptr) {
+    dst = _ir->newVar(IRReg::kKindVec, _width);
+    if (dst == nullptr)
+      return nullptr;
+  }
+
+  IRInst* inst = _ir->newInst(instCode, dst, o1, o2);
+  if (inst == nullptr)
+    return nullptr;
+
+  if (_body->insert(_heap, _index, inst) != kErrorOk) {
+    _ir->deleteInst(inst);
+    return nullptr;
+  }
+
+  _index++;
+  return dst;
+}
+
+IRReg* IRLowering::emitFP(uint32_t instCode, IRObject* o1, IRObject* o2, IRReg* dst) noexcept {
+  return emitInst((instCode + static_cast<uint32_t>(_isF64)) | _fpVec, o1, o2, dst);
+}
+
+IRReg* IRLowering::emitInt(uint32_t instCode, IRObject* o1, IRObject* o2) noexcept {
+  return emitInst(instCode | _intVec, o1, o2);
+}
+
+IRReg* IRLowering::emitIntImm(uint32_t instCode, IRObject* o1, int32_t imm) noexcept {
+  Value value;
+  value.zero();
+  value.i[0] = imm;
+
+  IRImm* obj = _ir->newImm(value, IRReg::kKindNone, 4);
+  if (obj == nullptr)
+    return nullptr;
+
+  obj->setTypeInfo(kTypeInt);
+  return emitInst(instCode | _intVec, o1, obj);
+}
+
+IRReg* IRLowering::emitConst(double value) noexcept {
+  Value v;
+  v.zero();
+
+  if (_isF64) {
+    for (uint32_t i = 0; i < 4; i++)
+      v.d[i] = value;
+  }
+  else {
+    for (uint32_t i = 0; i < 8; i++)
+      v.f[i] = static_cast<float>(value);
+  }
+
+  return emitValue(v);
+}
+
+IRReg* IRLowering::emitBits(uint64_t bits) noexcept {
+  Value v;
+  v.zero();
+
+  if (_isF64) {
+    for (uint32_t i = 0; i < 4; i++)
+      v.q[i] = bits;
+  }
+  else {
+    for (uint32_t i = 0; i < 8; i++)
+      v.u[i] = static_cast<uint32_t>(bits);
+  }
+
+  return emitValue(v);
+}
+
+IRReg* IRLowering::emitValue(const Value& value) noexcept {
+  IRImm* imm = _ir->newImm(value, IRReg::kKindVec, _width);
+  if (imm == nullptr)
+    return nullptr;
+
+  uint32_t typeId = _isF64 ? kTypeDouble : kTypeFloat;
+  uint32_t count = _width / TypeInfo::sizeOf(typeId);
+  imm->setTypeInfo(count > 1 ? typeId | (count << kTypeVecShift) : typeId);
+
+  IRReg* dst = _ir->newVar(IRReg::kKindVec, _width);
+  if (dst == nullptr)
+    return nullptr;
+
+  IRInst* inst = _ir->newInst(mpFetchByWidth(_width), dst, imm);
+  if (inst == nullptr)
+    return nullptr;
+
+  if (_body->insert(_heap, _index, inst) != kErrorOk) {
+    _ir->deleteInst(inst);
+    return nullptr;
+  }
+
+  _index++;
+  return dst;
+}
+
+IRReg* IRLowering::emitReg(IRObject* x, uint32_t width) noexcept {
+  if (x->isReg())
+    return x->as<IRReg>();
+
+  IRReg* dst = _ir->newVar(IRReg::kKindVec, width);
+  if (dst == nullptr)
+    return nullptr;
+
+  IRInst* inst = _ir->newInst(mpFetchByWidth(width), dst, x);
+  if (inst == nullptr)
+    return nullptr;
+
+  if (_body->insert(_heap, _index, inst) != kErrorOk) {
+    _ir->deleteInst(inst);
+    return nullptr;
+  }
+
+  _index++;
+  return dst;
+}
+
+IRReg* IRLowering::emitSelect(IRReg* mask, IRReg* a, IRReg* b, IRReg* dst) noexcept {
+  // b ^ (mask & (a ^ b)).
+  IRReg* t = emitFP(kInstCodeXorf, a, b);
+  t = emitFP(kInstCodeAndf, mask, t);
+  return emitFP(kInstCodeXorf, b, t, dst);
+}
+
+IRReg* IRLowering::emitMulAdd(IRReg* a, IRReg* b, IRReg* c) noexcept {
+  return emitFP(kInstCodeAddf, emitFP(kInstCodeMulf, a, b), c);
+}
+
+IRReg* IRLowering::emitPoly(IRReg* x, const double* c, uint32_t n, bool monic) noexcept {
+  IRReg* y;
+  uint32_t i = 0;
+
+  if (monic)
+    y = emitFP(kInstCodeAddf, x, emitConst(c[i++]));
+  else
+    y = emitConst(c[i++]);
+
+  while (i < n)
+    y = emitMulAdd(y, x, emitConst(c[i++]));
+  return y;
+}
+
+IRReg* IRLowering::emitBitMask(IRReg* t, uint32_t bit) noexcept {
+  // Move the bit to the sign of each element and broadcast it. There is no
+  // 64-bit arithmetic shift, so the high half of each double is duplicated.
+  if (_isF64) {
+    IRReg* m = emitIntImm(kInstCodePsllq, t, static_cast<int32_t>(63 - bit));
+    m = emitIntImm(kInstCodePsrad, m, 31);
+    return emitIntImm(kInstCodePshufd, m, 0xF5);
+  }
+  else {
+    IRReg* m = emitIntImm(kInstCodePslld, t, static_cast<int32_t>(31 - bit));
+    return emitIntImm(kInstCodePsrad, m, 31);
+  }
+}
+
+IRReg* IRLowering::emitBitSign(IRReg* t, uint32_t bit) noexcept {
+  IRReg* s = _isF64 ? emitIntImm(kInstCodePsllq, t, static_cast<int32_t>(63 - bit))
+                    : emitIntImm(kInstCodePslld, t, static_cast<int32_t>(31 - bit));
+  return emitInt(kInstCodeAndi, s, emitBits(_isF64 ? 0x8000000000000000U : 0x80000000U));
+}
+
+// ============================================================================
+// [mpsl::IRLowering - Kernels]
+// ============================================================================
+
+// Rounding to integer adds and subtracts 1.5 * 2^mantissa bits, the integer is
+// then also present in the low bits of the sum, which is used by all kernels
+// instead of conversions (there is no packed conversion of doubles).
+static MPSL_INLINE double mpRoundMagic(bool isF64) noexcept {
+  return isF64 ? 6755399441055744.0 : 12582912.0;
+}
+
+IRReg* IRLowering::emitExp(IRReg* dst, IRReg* x) noexcept {
+  // exp(x) = 2^n * exp(r), n = round(x / ln2), r = x - n * ln2.
+  //
+  // 2^n is built as 2^(n-1) * 2 to reach the largest finite result (n = 128)
+  // without special cases, which limits the smallest result to 2^-125.
+  double lo = _isF64 ? -707.70327135170420 : -86.643397;
+  double hi = _isF64 ?  709.78271289338397 :  88.722839;
+  double c1 = _isF64 ? 6.93145751953125E-1 : 0.693359375;
+  double c2 = _isF64 ? 1.42860682030941723212E-6 : -2.12194440E-4;
+
+  IRReg* vLo = emitConst(lo);
+  IRReg* vHi = emitConst(hi);
+  IRReg* magic = emitConst(mpRoundMagic(_isF64));
+
+  // The first operand of min/max is returned if any is NaN, keep NaN in `xc`.
+  IRReg* xc = emitFP(kInstCodeMaxf, vLo, x);
+  xc = emitFP(kInstCodeMinf, vHi, xc);
+
+  IRReg* t = emitMulAdd(xc, emitConst(mpLog2E), magic);
+  IRReg* n = emitFP(kInstCodeSubf, t, magic);
+
+  IRReg* r = emitFP(kInstCodeSubf, xc, emitFP(kInstCodeMulf, n, emitConst(c1)));
+  r = emitFP(kInstCodeSubf, r, emitFP(kInstCodeMulf, n, emitConst(c2)));
+
+  IRReg* one = emitConst(1.0);
+  IRReg* p;
+
+  if (_isF64) {
+    // Pade approximation, 1 + 2 * P(r) / (Q(r^2) - P(r)).
+    IRReg* z = emitFP(kInstCodeMulf, r, r);
+    IRReg* px = emitFP(kInstCodeMulf, r, emitPoly(z, mpExpCoeffP, MPSL_ARRAY_SIZE(mpExpCoeffP)));
+    IRReg* qx = emitPoly(z, mpExpCoeffQ, MPSL_ARRAY_SIZE(mpExpCoeffQ));
+
+    p = emitFP(kInstCodeDivf, px, emitFP(kInstCodeSubf, qx, px));
+    p = emitFP(kInstCodeAddf, emitFP(kInstCodeAddf, p, p), one);
+  }
+  else {
+    IRReg* z = emitFP(kInstCodeMulf, r, r);
+    p = emitPoly(r, mpExpCoeffF, MPSL_ARRAY_SIZE(mpExpCoeffF));
+    p = emitFP(kInstCodeAddf, emitMulAdd(p, z, r), one);
+  }
+
+  // The exponent field of 2^(n-1) is the low bits of `t` (n + bias - 1).
+  IRReg* scale;
+  if (_isF64) {
+    scale = emitIntImm(kInstCodePsllq, t, 52);
+    scale = emitInt(kInstCodePaddq, scale, emitBits(uint64_t(1022) << 52));
+  }
+  else {
+    scale = emitIntImm(kInstCodePslld, t, 23);
+    scale = emitInt(kInstCodePaddd, scale, emitBits(uint32_t(126) << 23));
+  }
+
+  IRReg* result = emitFP(kInstCodeMulf, emitFP(kInstCodeAddf, p, p), scale);
+
+  // Flush results below the range to zero and overflow above it.
+  IRReg* underflow = emitFP(kInstCodeCmpltf, x, vLo);
+  result = emitFP(kInstCodeXorf, result, emitFP(kInstCodeAndf, underflow, result));
+
+  IRReg* overflow = emitFP(kInstCodeCmpltf, vHi, x);
+  IRReg* inf = emitBits(_isF64 ? 0x7FF0000000000000U : 0x7F800000U);
+  return emitFP(kInstCodeMaxf, emitFP(kInstCodeAndf, overflow, inf), result, dst);
+}
+
+IRReg* IRLowering::emitLog(IRReg* dst, IRReg* x, uint32_t kind) noexcept {
+  // log(x) = e * ln2 + log(m), x = 2^e * m, m in [sqrt(0.5), sqrt(2)).
+  uint32_t mantBits = _isF64 ? 52 : 23;
+
+  IRReg* one = emitConst(1.0);
+
+  // Scale denormals to normal numbers.
+  IRReg* minNormal = emitBits(_isF64 ? 0x0010000000000000U : 0x00800000U);
+  IRReg* denormal = emitFP(kInstCodeCmpltf, x, minNormal);
+
+  uint32_t denormalShift = _isF64 ? 54 : 24;
+  IRReg* factor = emitConst(_isF64 ? 18014398509481984.0 : 16777216.0);
+  factor = emitSelect(denormal, factor, one);
+
+  IRReg* xs = emitFP(kInstCodeMulf, x, factor);
+
+  // Extract the exponent, it's converted to FP by placing it in the mantissa
+  // of 2^mantBits, which is then subtracted.
+  IRReg* e;
+  if (_isF64) {
+    e = emitIntImm(kInstCodePsrlq, xs, static_cast<int32_t>(mantBits));
+    e = emitInt(kInstCodeOri, e, emitBits(0x4330000000000000U));
+  }
+  else {
+    e = emitIntImm(kInstCodePsrld, xs, static_cast<int32_t>(mantBits));
+    e = emitInt(kInstCodeOri, e, emitBits(0x4B000000U));
+  }
+  e = emitFP(kInstCodeSubf, e, emitConst(_isF64 ? 4503599627370496.0 + 1022.0 : 8388608.0 + 126.0));
+  e = emitFP(kInstCodeSubf, e, emitFP(kInstCodeAndf, denormal, emitConst(double(denormalShift))));
+
+  // Mantissa in [0.5, 1).
+  IRReg* m = emitInt(kInstCodeAndi, xs, emitBits(_isF64 ? 0x000FFFFFFFFFFFFFU : 0x007FFFFFU));
+  m = emitInt(kInstCodeOri, m, emitBits(_isF64 ? 0x3FE0000000000000U : 0x3F000000U));
+
+  // Use 2m - 1 and e - 1 if m < sqrt(0.5), m - 1 otherwise (both exact).
+  IRReg* small = emitFP(kInstCodeCmpltf, m, emitConst(mpSqrtH));
+  e = emitFP(kInstCodeSubf, e, emitFP(kInstCodeAndf, small, one));
+  m = emitFP(kInstCodeAddf, emitFP(kInstCodeSubf, m, one), emitFP(kInstCodeAndf, small, m));
+
+  IRReg* z = emitFP(kInstCodeMulf, m, m);
+  IRReg* y;
+
+  if (_isF64) {
+    IRReg* p = emitPoly(m, mpLogCoeffP, MPSL_ARRAY_SIZE(mpLogCoeffP));
+    IRReg* q = emitPoly(m, mpLogCoeffQ, MPSL_ARRAY_SIZE(mpLogCoeffQ), true);
+    y = emitFP(kInstCodeMulf, m, emitFP(kInstCodeDivf, emitFP(kInstCodeMulf, z, p), q));
+  }
+  else {
+    y = emitPoly(m, mpLogCoeffF, MPSL_ARRAY_SIZE(mpLogCoeffF));
+    y = emitFP(kInstCodeMulf, emitFP(kInstCodeMulf, y, m), z);
+  }
+
+  IRReg* halfZ = emitFP(kInstCodeMulf, z, emitConst(0.5));
+  IRReg* result;
+
+  if (kind == kLog2) {
+    // Adding the exponent last keeps results exact for powers of two.
+    result = emitFP(kInstCodeAddf, m, emitFP(kInstCodeSubf, y, halfZ));
+    result = emitMulAdd(result, emitConst(mpLog2E), e);
+  }
+  else {
+    // ln2 is split to two parts, the first one has a short mantissa.
+    y = emitMulAdd(e, emitConst(_isF64 ? -2.121944400546905827679E-4 : -2.12194440E-4), y);
+    y = emitFP(kInstCodeSubf, y, halfZ);
+
+    result = emitFP(kInstCodeAddf, m, y);
+    result = emitMulAdd(e, emitConst(0.693359375), result);
+
+    if (kind == kLog10)
+      result = emitFP(kInstCodeMulf, result, emitConst(mpLog10E));
+  }
+
+  // log(0) is -inf, log(inf) is inf, and log of negative numbers or NaN is NaN,
+  // infinities are added as the result is finite if `x` isn't NaN.
+  IRReg* inf = emitBits(_isF64 ? 0x7FF0000000000000U : 0x7F800000U);
+  IRReg* special = emitFP(kInstCodeAndf, emitFP(kInstCodeCmpeqf, x, emitConst(0.0)),
+                                         emitBits(_isF64 ? 0xFFF0000000000000U : 0xFF800000U));
+  special = emitFP(kInstCodeOrf, special, emitFP(kInstCodeAndf, emitFP(kInstCodeCmpeqf, x, inf), inf));
+  result = emitFP(kInstCodeAddf, result, special);
+
+  IRReg* nan = emitFP(kInstCodeOrf, emitFP(kInstCodeCmpltf, x, emitConst(0.0)),
+                                    emitFP(kInstCodeCmpnef, x, x));
+  return emitFP(kInstCodeOrf, result, nan, dst);
+}
+
+IRReg* IRLowering::emitTrig(IRReg* dst, IRReg* x, uint32_t kind) noexcept {
+  // x = q * pi/2 + r, |r| <= pi/4, then the quadrant (q mod 4) selects sin or
+  // cos of `r` and the sign. pi/2 is split to three parts, the first two have
+  // short mantissas so `q * part` is exact.
+  double pio2_1 = _isF64 ? 1.57079625129699707031E0  : 1.5703125;
+  double pio2_2 = _isF64 ? 7.54978941586159635335E-8 : 4.837512969970703125E-4;
+  double pio2_3 = _isF64 ? 5.39030285815811905290E-15 : 7.54978995489188216E-8;
+
+  IRReg* signMask = emitBits(_isF64 ? 0x8000000000000000U : 0x80000000U);
+  IRReg* a = emitFP(kInstCodeAndf, x, emitBits(_isF64 ? 0x7FFFFFFFFFFFFFFFU : 0x7FFFFFFFU));
+
+  IRReg* magic = emitConst(mpRoundMagic(_isF64));
+  IRReg* t = emitMulAdd(a, emitConst(mp2OverPi), magic);
+  IRReg* q = emitFP(kInstCodeSubf, t, magic);
+
+  IRReg* r = emitFP(kInstCodeSubf, a, emitFP(kInstCodeMulf, q, emitConst(pio2_1)));
+  r = emitFP(kInstCodeSubf, r, emitFP(kInstCodeMulf, q, emitConst(pio2_2)));
+  r = emitFP(kInstCodeSubf, r, emitFP(kInstCodeMulf, q, emitConst(pio2_3)));
+
+  IRReg* z = emitFP(kInstCodeMulf, r, r);
+
+  // sin(r) = r + r * z * S(z), cos(r) = 1 - z / 2 + z^2 * C(z).
+  const double* sinCoeff = _isF64 ? mpSinCoeffD : mpSinCoeffF;
+  const double* cosCoeff = _isF64 ? mpCosCoeffD : mpCosCoeffF;
+  uint32_t n = _isF64 ? MPSL_ARRAY_SIZE(mpSinCoeffD) : MPSL_ARRAY_SIZE(mpSinCoeffF);
+
+  IRReg* ps = emitFP(kInstCodeMulf, emitPoly(z, sinCoeff, n), z);
+  ps = emitMulAdd(ps, r, r);
+
+  IRReg* pc = emitFP(kInstCodeMulf, emitFP(kInstCodeMulf, emitPoly(z, cosCoeff, n), z), z);
+  IRReg* one = emitConst(1.0);
+  pc = emitFP(kInstCodeAddf, emitFP(kInstCodeSubf, one, emitFP(kInstCodeMulf, z, emitConst(0.5))), pc);
+
+  // Odd quadrants swap sin and cos.
+  IRReg* odd = emitBitMask(t, 0);
+  IRReg* result;
+  IRReg* sign;
+
+  switch (kind) {
+    case kTrigSin:
+      // sin(-x) = -sin(x), quadrants 2 and 3 are negative.
+      result = emitSelect(odd, pc, ps);
+      sign = emitFP(kInstCodeXorf, emitBitSign(t, 1), emitFP(kInstCodeAndf, x, signMask));
+      break;
+
+    case kTrigCos:
+      // cos(-x) = cos(x), quadrants 1 and 2 are negative.
+      result = emitSelect(odd, ps, pc);
+      sign = emitBitSign(emitInt(_isF64 ? kInstCodePaddq : kInstCodePaddd, t, emitBits(1)), 1);
+      break;
+
+    default:
+      // tan(r) in even quadrants, -1 / tan(r) in odd ones, tan(-x) = -tan(x).
+      result = emitFP(kInstCodeDivf, emitSelect(odd, pc, ps), emitSelect(odd, ps, pc));
+      sign = emitFP(kInstCodeXorf, emitFP(kInstCodeAndf, odd, signMask), emitFP(kInstCodeAndf, x, signMask));
+      break;
+  }
+
+  return emitFP(kInstCodeXorf, result, sign, dst);
+}
+
+IRReg* IRLowering::emitPow(IRReg* dst, IRReg* x, IRReg* y) noexcept {
+  // pow(x, y) = exp(y * log(x)), pow(x, 0) is 1 for any `x`, including NaN.
+  IRReg* result = emitExp(nullptr, emitFP(kInstCodeMulf, y, emitLog(nullptr, x, kLogE)));
+  IRReg* isZero = emitFP(kInstCodeCmpeqf, y, emitConst(0.0));
+  return emitSelect(isZero, emitConst(1.0), result, dst);
+}
+
+IRReg* IRLowering::emitPowInt(IRReg* dst, IRReg* x, int32_t n) noexcept {
+  uint32_t m = n < 0 ? 0U - static_cast<uint32_t>(n) : static_cast<uint32_t>(n);
+  IRReg* out = n < 0 ? nullptr : dst;
+
+  if (m == 1) {
+    // Multiplication by one is removed by the optimizer.
+    return n < 0 ? emitFP(kInstCodeDivf, emitConst(1.0), x, dst)
+                 : emitFP(kInstCodeMulf, x, emitConst(1.0), dst);
+  }
+
+  // Square-and-multiply, `p` is `x^(2^i)` and `r` is the product of powers
+  // that correspond to bits of `m` already processed.
+  IRReg* p = x;
+  IRReg* r = nullptr;
+
+  while (m > 1) {
+    if (m & 1)
+      r = r ? emitFP(kInstCodeMulf, r, p) : p;
+
+    // The last squaring is the result if no bit is set except the highest.
+    p = emitFP(kInstCodeMulf, p, p, (m < 4 && r == nullptr) ? out : nullptr);
+    m >>= 1;
+  }
+
+  IRReg* result = r ? emitFP(kInstCodeMulf, r, p, out) : p;
+  return n < 0 ? emitFP(kInstCodeDivf, emitConst(1.0), result, dst) : result;
+}
+
+// ============================================================================
+// [mpsl::mpIRLower]
+// ============================================================================
+
+Error mpIRLower(IRBuilder* ir) noexcept {
+  IRLowering lowering(ir);
+  return lowering.run();
+}
+
+} // mpsl namespace
+
+// [Api-End]
+#include "./mpsl_apiend.h"
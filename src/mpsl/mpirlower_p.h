@@ -0,0 +1,170 @@
+// [MPSL]
+// MathPresso's Shading Language with JIT Engine for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _MPSL_MPIRLOWER_P_H
+#define _MPSL_MPIRLOWER_P_H
+
+// [Dependencies - MPSL]
+#include "./mpir_p.h"
+#include "./mplang_p.h"
+
+// [Api-Begin]
+#include "./mpsl_apibegin.h"
+
+namespace mpsl {
+
+// ============================================================================
+// [mpsl::IRLowering]
+// ============================================================================
+
+//! \internal
+//!
+//! Replaces complex IR instructions that have no machine equivalent by a
+//! sequence of simple ones, which is then optimized and compiled like any
+//! other code, so all vector widths and instruction sets are supported.
+//!
+//! Transcendental functions are computed by range reduction followed by a
+//! minimax polynomial (based on Cephes) in the precision of the operand. The
+//! maximum error measured against correctly rounded results is:
+//!
+//!   - `exp`                 - 2 ULP, results below 2^-125 (float) or 2^-1021
+//!                             (double) flush to zero.
+//!   - `log`, `log2`         - 2 ULP, denormals are handled.
+//!   - `log10`               - 3 ULP.
+//!   - `sin`, `cos`          - 2 ULP if |x| <= 8192 (float) or |x| <= 2^30
+//!                             (double), the range reduction loses precision
+//!                             outside of it.
+//!   - `tan`                 - 4 ULP with the same range as `sin` and `cos`.
+//!   - `pow`                 - 2 + 2 * |y * log(x)| ULP, computed as
+//!                             `exp(y * log(x))`, so a negative `x` gives NaN.
+//!                             A constant integer `y` that is not zero and
+//!                             not greater than `kMaxIntPow` in magnitude is
+//!                             computed by multiplication instead, which has
+//!                             at most |y| ULP and handles a negative `x`.
+//!
+//! The code doesn't depend on the target CPU, results are the same with and
+//! without AVX, only `kOptionFastMath` can change them.
+class IRLowering {
+public:
+  MPSL_NONCOPYABLE(IRLowering)
+
+  //! Logarithm base.
+  enum LogKind {
+    kLogE = 0,
+    kLog2 = 1,
+    kLog10 = 2
+  };
+
+  //! Trigonometric function.
+  enum TrigKind {
+    kTrigSin = 0,
+    kTrigCos = 1,
+    kTrigTan = 2
+  };
+
+  enum Limits {
+    //! Maximum magnitude of a constant integer exponent of `pow` computed by
+    //! multiplication.
+    kMaxIntPow = 16
+  };
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  IRLowering(IRBuilder* ir) noexcept;
+  ~IRLowering() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Run]
+  // --------------------------------------------------------------------------
+
+  Error run() noexcept;
+  //! Lower `body[index]`, `index` is advanced past the emitted sequence.
+  Error lowerInst(IRBody& body, size_t& index) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Emit]
+  // --------------------------------------------------------------------------
+
+  // All `emit...()` functions insert before the instruction being lowered and
+  // return the destination register, or null if out of memory. Null operands
+  // are propagated, so only the final result has to be checked.
+
+  //! Emit `dst = instCode(o1, o2)`, a new register is used if `dst` is null.
+  IRReg* emitInst(uint32_t instCode, IRObject* o1, IRObject* o2, IRReg* dst = nullptr) noexcept;
+  //! Emit a floating point instruction, `instCode` is its F32 form.
+  IRReg* emitFP(uint32_t instCode, IRObject* o1, IRObject* o2, IRReg* dst = nullptr) noexcept;
+  //! Emit an integer instruction that works on the bits of all elements.
+  IRReg* emitInt(uint32_t instCode, IRObject* o1, IRObject* o2) noexcept;
+  //! Emit an integer instruction that has an immediate operand.
+  IRReg* emitIntImm(uint32_t instCode, IRObject* o1, int32_t imm) noexcept;
+
+  //! Emit a register that has all elements set to `value`.
+  IRReg* emitConst(double value) noexcept;
+  //! Emit a register that has all elements set to `bits`, only the low 32
+  //! bits are used if the elements are floats.
+  IRReg* emitBits(uint64_t bits) noexcept;
+  //! Emit a register initialized to `value`.
+  IRReg* emitValue(const Value& value) noexcept;
+  //! Get `x` as a register, an immediate or memory operand is fetched as `width`
+  //! bytes, as memory beyond the operand may not be readable.
+  IRReg* emitReg(IRObject* x, uint32_t width) noexcept;
+
+  //! Emit `mask ? a : b`, each element of `mask` must be all zeros or ones.
+  IRReg* emitSelect(IRReg* mask, IRReg* a, IRReg* b, IRReg* dst = nullptr) noexcept;
+  //! Emit `a * b + c`, as two instructions (so the result doesn't depend on FMA).
+  IRReg* emitMulAdd(IRReg* a, IRReg* b, IRReg* c) noexcept;
+  //! Emit `c[0] * x^(n-1) + c[1] * x^(n-2) + ... + c[n-1]`, if `monic` is true
+  //! the polynomial has an additional leading coefficient equal to one.
+  IRReg* emitPoly(IRReg* x, const double* c, uint32_t n, bool monic = false) noexcept;
+
+  //! Emit a mask of elements of `t` that has bit `bit` set, `t` is the result
+  //! of the round-to-integer trick used by all kernels.
+  IRReg* emitBitMask(IRReg* t, uint32_t bit) noexcept;
+  //! Emit the sign bit of elements of `t` that has bit `bit` set.
+  IRReg* emitBitSign(IRReg* t, uint32_t bit) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Kernels]
+  // --------------------------------------------------------------------------
+
+  IRReg* emitExp(IRReg* dst, IRReg* x) noexcept;
+  IRReg* emitLog(IRReg* dst, IRReg* x, uint32_t kind) noexcept;
+  IRReg* emitTrig(IRReg* dst, IRReg* x, uint32_t kind) noexcept;
+  IRReg* emitPow(IRReg* dst, IRReg* x, IRReg* y) noexcept;
+  //! Emit `x^n` computed by multiplication, `n` must not be zero.
+  IRReg* emitPowInt(IRReg* dst, IRReg* x, int32_t n) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  IRBuilder* _ir;                        //!< IR builder.
+  ZoneHeap* _heap;                       //!< Heap used by bodies of blocks.
+
+  IRBody* _body;                         //!< Body of the block being lowered.
+  size_t _index;                         //!< Position where instructions are inserted.
+
+  uint32_t _width;                       //!< Width of temporary registers.
+  uint32_t _fpVec;                       //!< Vector flags of FP instructions.
+  uint32_t _intVec;                      //!< Vector flags of integer instructions.
+  bool _isF64;                           //!< Elements are doubles.
+};
+
+//! \internal
+//!
+//! Lower complex instructions of `ir`, must run before `mpIRPass()`.
+Error mpIRLower(IRBuilder* ir) noexcept;
+
+} // mpsl namespace
+
+// [Api-End]
+#include "./mpsl_apiend.h"
+
+// [Guard]
+#endif // _MPSL_MPIRLOWER_P_H
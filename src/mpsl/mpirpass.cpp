@@ -8,51 +8,3065 @@
 #define MPSL_EXPORTS
 
 // [Dependencies - MPSL]
+#include "./mpfold_p.h"
 #include "./mpirpass_p.h"
+#include "./mpmath_p.h"
 
 // [Api-Begin]
 #include "./mpsl_apibegin.h"
 
 namespace mpsl {
 
-static Error mpIRPassBlock(IRBuilder* ir, IRBlock* block) noexcept {
+// ============================================================================
+// [mpsl::IRPassManager - Helpers]
+// ============================================================================
+
+static const uint32_t kInvalidRPOIndex = 0xFFFFFFFFU;
+
+template<typename T>
+static Error mpInitVector(ZoneHeap* heap, ZoneVector<T>& vec, size_t length, const T& value) noexcept {
+  vec.truncate(0);
+  MPSL_PROPAGATE(vec.willGrow(heap, length));
+
+  for (size_t i = 0; i < length; i++)
+    vec.appendUnsafe(value);
+  return kErrorOk;
+}
+
+static MPSL_INLINE const InstInfo& mpInstInfoOf(const IRInst* inst) noexcept {
+  return mpInstInfo[inst->getInstCode() & kInstCodeMask];
+}
+
+//! Get the register defined by `inst` (always its first operand) or null.
+static MPSL_INLINE IRReg* mpGetDefReg(const IRInst* inst) noexcept {
+  const InstInfo& info = mpInstInfoOf(inst);
+  if (info.isStore() || info.isJxx() || info.isRet() || inst->getOpCount() == 0)
+    return nullptr;
+
+  IRObject* op = inst->getOperand(0);
+  return op->isReg() ? op->as<IRReg>() : nullptr;
+}
+
+static MPSL_INLINE uint32_t mpMovByWidth(uint32_t width) noexcept {
+  switch (width) {
+    case  4: return kInstCodeMov32;
+    case  8: return kInstCodeMov64;
+    case 16: return kInstCodeMov128;
+    case 32: return kInstCodeMov256;
+
+    default:
+      return kInstCodeNone;
+  }
+}
+
+static MPSL_INLINE uint32_t mpFetchByWidth(uint32_t width) noexcept {
+  switch (width) {
+    case  4: return kInstCodeFetch32;
+    case  8: return kInstCodeFetch64;
+    case 16: return kInstCodeFetch128;
+    case 32: return kInstCodeFetch256;
+
+    default:
+      return kInstCodeNone;
+  }
+}
+
+//! Get the number of bytes read by a fetch instruction (0 if not a fetch).
+static MPSL_INLINE uint32_t mpFetchSize(uint32_t instCode) noexcept {
+  switch (instCode) {
+    case kInstCodeFetch32 : return 4;
+    case kInstCodeFetch64 : return 8;
+    case kInstCodeFetch96 : return 12;
+    case kInstCodeFetch128: return 16;
+    case kInstCodeFetch192: return 24;
+    case kInstCodeFetch256: return 32;
+
+    default:
+      return 0;
+  }
+}
+
+//! Get the type of a constant produced by folding (only used by `dump()`).
+static uint32_t mpGetFoldedTypeInfo(const InstInfo& info, uint32_t width) noexcept {
+  uint32_t typeId = info.isF64() ? kTypeDouble : info.isF32() ? kTypeFloat : kTypeInt;
+  uint32_t count = width / TypeInfo::sizeOf(typeId);
+
+  return count > 1 ? typeId | (count << kTypeVecShift) : typeId;
+}
+
+//! Get whether folding `instCode` with the right operand `r` gives the same
+//! result as the machine instruction (division by zero traps, shifts by more
+//! than the element size are undefined in C++).
+static bool mpIsSafeToFold(uint32_t instCode, uint32_t width, const Value& l, const Value& r) noexcept {
+  uint32_t count = width >= 4 ? width / 4 : 1;
+
+  switch (instCode) {
+    case kInstCodePdivsd:
+    case kInstCodePmodsd:
+      for (uint32_t i = 0; i < count; i++)
+        if (r.i[i] == 0 || (r.i[i] == -1 && l.u[i] == 0x80000000U))
+          return false;
+      return true;
+
+    case kInstCodePsllw:
+    case kInstCodePsrlw:
+    case kInstCodePsraw: return r.u[0] < 16;
+
+    case kInstCodePslld:
+    case kInstCodePsrld:
+    case kInstCodePsrad: return r.u[0] < 32;
+
+    case kInstCodePsllq:
+    case kInstCodePsrlq: return r.u[0] < 64;
+
+    default:
+      return true;
+  }
+}
+
+//! Insert `inst` before the jump that terminates `block` (if any).
+static Error mpInsertBeforeJump(IRBlock* block, IRInst* inst) noexcept {
+  IRBody& body = block->getBody();
+  size_t len = body.getLength();
+
+  MPSL_PROPAGATE(block->append(inst));
+  if (len != 0 && mpInstInfoOf(body[len - 1]).isJxx()) {
+    body[len] = body[len - 1];
+    body[len - 1] = inst;
+  }
+
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::IRPassManager - CSE Helpers]
+// ============================================================================
+
+static uint32_t mpHashObject(const IRObject* obj) noexcept {
+  switch (obj->getObjectType()) {
+    case IRObject::kTypeMem: {
+      const IRMem* mem = obj->as<IRMem>();
+      uint32_t hVal = static_cast<uint32_t>(mem->getOffset()) * 65599 + mem->getShift();
+
+      if (mem->hasBase()) hVal = hVal * 31 + mem->getBase()->getId();
+      if (mem->hasIndex()) hVal = hVal * 31 + mem->getIndex()->getId();
+      return hVal;
+    }
+
+    case IRObject::kTypeImm: {
+      const Value& value = obj->as<IRImm>()->getValue();
+      uint32_t hVal = 0;
+
+      for (uint32_t i = 0; i < 8; i++)
+        hVal = hVal * 65599 + value.u[i];
+      return hVal;
+    }
+
+    default:
+      return obj->getId() * 0x9E3779B1U;
+  }
+}
+
+static bool mpEqObject(const IRObject* a, const IRObject* b) noexcept {
+  if (a == b)
+    return true;
+
+  if (a->getObjectType() != b->getObjectType())
+    return false;
+
+  switch (a->getObjectType()) {
+    case IRObject::kTypeMem: {
+      const IRMem* aMem = a->as<IRMem>();
+      const IRMem* bMem = b->as<IRMem>();
+
+      return aMem->getBase()   == bMem->getBase()   &&
+             aMem->getIndex()  == bMem->getIndex()  &&
+             aMem->getOffset() == bMem->getOffset() &&
+             aMem->getShift()  == bMem->getShift()  ;
+    }
+
+    case IRObject::kTypeImm: {
+      const IRImm* aImm = a->as<IRImm>();
+      const IRImm* bImm = b->as<IRImm>();
+
+      return aImm->getReg()   == bImm->getReg()   &&
+             aImm->getWidth() == bImm->getWidth() &&
+             ::memcmp(&aImm->_value, &bImm->_value, sizeof(Value)) == 0;
+    }
+
+    default:
+      return false;
+  }
+}
+
+static uint32_t mpHashInst(const IRInst* inst) noexcept {
+  uint32_t hVal = inst->getInstCode();
+  uint32_t opCount = inst->getOpCount();
+
+  // The first operand is the destination.
+  for (uint32_t i = 1; i < opCount; i++)
+    hVal = hVal * 31 + mpHashObject(inst->getOperand(i));
+  return hVal;
+}
+
+static bool mpReadsMemory(const IRInst* inst) noexcept {
+  uint32_t opCount = inst->getOpCount();
+
+  for (uint32_t i = 0; i < opCount; i++)
+    if (inst->getOperand(i)->isMem())
+      return true;
+  return false;
+}
+
+bool IRPassManager::CSENode::eq(IRInst* inst) const noexcept {
+  const IRInst* self = _inst;
+  uint32_t opCount = self->getOpCount();
+
+  if (self->getInstCode() != inst->getInstCode() || opCount != inst->getOpCount())
+    return false;
+
+  const IRReg* aDst = self->getOperand(0)->as<IRReg>();
+  const IRReg* bDst = inst->getOperand(0)->as<IRReg>();
+
+  if (aDst->getReg() != bDst->getReg() || aDst->getWidth() != bDst->getWidth())
+    return false;
+
+  for (uint32_t i = 1; i < opCount; i++)
+    if (!mpEqObject(self->getOperand(i), inst->getOperand(i)))
+      return false;
+
+  return true;
+}
+
+// ============================================================================
+// [mpsl::IRPassManager - Construction / Destruction]
+// ============================================================================
+
+IRPassManager::IRPassManager(IRBuilder* ir, uint32_t optLevel, uint32_t unrollLimit, uint32_t flags) noexcept
+  : _ir(ir),
+    _heap(ir->getHeap()),
+    _optLevel(optLevel),
+    _unrollLimit(unrollLimit),
+    _flags(flags),
+    _ssaFirstId(0),
+    _liveWords(0),
+    _cseEpoch(0) {}
+
+IRPassManager::~IRPassManager() noexcept {
+  _rpo.release(_heap);
+  _rpoIndex.release(_heap);
+  _idom.release(_heap);
+  _domStart.release(_heap);
+  _domChildren.release(_heap);
+  _dfStart.release(_heap);
+  _df.release(_heap);
+
+  _regData.release(_heap);
+  _defSites.release(_heap);
+
+  _loop.release(_heap);
+  _loopIndex.release(_heap);
+  _clones.release(_heap);
+
+  _liveBits.release(_heap);
+  _live.release(_heap);
+
+  _work.release(_heap);
+  _insts.release(_heap);
+  _cseScope.release(_heap);
+}
+
+// ============================================================================
+// [mpsl::IRPassManager - Run]
+// ============================================================================
+
+Error IRPassManager::run() noexcept {
+  if (_optLevel == kIROptLevelNone)
+    return kErrorOk;
+
+  MPSL_PROPAGATE(removeUnreachableBlocks());
+  MPSL_PROPAGATE(computeDominators());
+
+  if (_optLevel >= kIROptLevelFull && _unrollLimit != 0) {
+    for (uint32_t i = 0; i < kMaxUnrolledLoops; i++) {
+      bool unrolled;
+      MPSL_PROPAGATE(unrollLoop(unrolled));
+
+      if (!unrolled)
+        break;
+
+      // The original loop is unreachable now.
+      MPSL_PROPAGATE(removeUnreachableBlocks());
+      MPSL_PROPAGATE(computeDominators());
+    }
+  }
+
+  bool converted;
+  MPSL_PROPAGATE(toSSA(converted));
+
+  if (!converted)
+    return kErrorOk;
+
+  bool fastMath = (_flags & kIRPassFastMath) != 0;
+  if (fastMath) {
+    bool replaced = false;
+    MPSL_PROPAGATE(replaceDivisions(replaced));
+  }
+
+  for (uint32_t i = 0; i < kMaxIterations; i++) {
+    bool changed = false;
+
+    MPSL_PROPAGATE(propagateCopies(changed));
+    MPSL_PROPAGATE(foldConstants(changed));
+    MPSL_PROPAGATE(reduceStrength(changed));
+
+    if (_optLevel >= kIROptLevelFull) {
+      MPSL_PROPAGATE(eliminateCommonSubexpressions(changed));
+      MPSL_PROPAGATE(hoistLoopInvariants(changed));
+    }
+
+    MPSL_PROPAGATE(eliminateDeadCode(changed));
+
+    // Branches are converted after the other passes made their arms smaller.
+    bool selected = false;
+    MPSL_PROPAGATE(convertBranches(selected));
+
+    if (selected) {
+      MPSL_PROPAGATE(removeUnreachableBlocks());
+      MPSL_PROPAGATE(computeDominators());
+      changed = true;
+    }
+
+    if (!changed)
+      break;
+  }
+
+  // Reassociation has to see the final expressions and FMA contraction has to
+  // see the reassociated ones.
+  if (fastMath) {
+    bool changed = false;
+    MPSL_PROPAGATE(reassociate(changed));
+
+    if (_flags & kIRPassFMA)
+      MPSL_PROPAGATE(contractMulAdd(changed));
+
+    if (changed)
+      MPSL_PROPAGATE(eliminateDeadCode(changed));
+  }
+
+  MPSL_PROPAGATE(fromSSA());
+
+  // Each round merges a register at most once, chains of moves need more.
+  for (uint32_t i = 0; i < kMaxIterations; i++) {
+    bool changed = false;
+    MPSL_PROPAGATE(coalesceMoves(changed));
+
+    if (!changed)
+      break;
+  }
+
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::IRPassManager - CFG]
+// ============================================================================
+
+Error IRPassManager::removeUnreachableBlocks() noexcept {
+  IRBlocks& blocks = _ir->getBlocks();
+  IRBlock* entry = _ir->getEntry();
+
+  size_t idCount = static_cast<size_t>(_ir->_blockIdGen) + 1;
+  size_t i, j;
+
+  // Iterative depth-first search. While a block is on the stack its RPO index
+  // holds the index of the next successor to visit.
+  MPSL_PROPAGATE(mpInitVector<uint32_t>(_heap, _rpoIndex, idCount, kInvalidRPOIndex));
+  _rpo.truncate(0);
+  _work.truncate(0);
+
+  MPSL_PROPAGATE(_work.append(_heap, entry));
+  _rpoIndex[entry->getId()] = 0;
+
+  while (!_work.isEmpty()) {
+    IRBlock* block = _work.getLast();
+    IRBlocks& successors = block->getSuccessors();
+    uint32_t next = _rpoIndex[block->getId()];
+
+    if (next < successors.getLength()) {
+      IRBlock* succ = successors[next];
+      _rpoIndex[block->getId()] = next + 1;
+
+      if (_rpoIndex[succ->getId()] == kInvalidRPOIndex) {
+        _rpoIndex[succ->getId()] = 0;
+        MPSL_PROPAGATE(_work.append(_heap, succ));
+      }
+    }
+    else {
+      _work.pop();
+      MPSL_PROPAGATE(_rpo.append(_heap, block));
+    }
+  }
+
+  // Post-order to reverse post-order.
+  size_t count = _rpo.getLength();
+  for (i = 0; i < count / 2; i++) {
+    IRBlock* tmp = _rpo[i];
+    _rpo[i] = _rpo[count - 1 - i];
+    _rpo[count - 1 - i] = tmp;
+  }
+
+  for (i = 0; i < count; i++)
+    _rpoIndex[_rpo[i]->getId()] = static_cast<uint32_t>(i);
+
+  if (count == blocks.getLength())
+    return kErrorOk;
+
+  // Unlink unreachable blocks first, then delete their instructions (which
+  // dereferences their jump targets) and the blocks themselves last.
+  for (i = 0; i < blocks.getLength(); i++) {
+    IRBlock* block = blocks[i];
+    if (block == nullptr || _rpoIndex[block->getId()] != kInvalidRPOIndex)
+      continue;
+
+    IRBlocks& successors = block->getSuccessors();
+    for (j = 0; j < successors.getLength(); j++) {
+      IRBlocks& predecessors = successors[j]->getPredecessors();
+      size_t index = predecessors.indexOf(block);
+
+      if (index != Globals::kInvalidIndex)
+        predecessors.removeAt(index);
+    }
+    successors.truncate(0);
+  }
+
+  for (i = 0; i < blocks.getLength(); i++) {
+    IRBlock* block = blocks[i];
+    if (block == nullptr || _rpoIndex[block->getId()] != kInvalidRPOIndex)
+      continue;
+
+    IRBody& body = block->getBody();
+    for (j = 0; j < body.getLength(); j++)
+      _ir->deleteInst(body[j]);
+    body.truncate(0);
+  }
+
+  IRBlocks& exits = _ir->getExits();
+  for (i = 0; i < blocks.getLength(); i++) {
+    IRBlock* block = blocks[i];
+    if (block == nullptr || _rpoIndex[block->getId()] != kInvalidRPOIndex)
+      continue;
+
+    size_t index = exits.indexOf(block);
+    if (index != Globals::kInvalidIndex)
+      exits.removeAt(index);
+
+    _ir->deleteObject(block);
+  }
+
+  return kErrorOk;
+}
+
+IRBlock* IRPassManager::_intersect(IRBlock* a, IRBlock* b) const noexcept {
+  while (a != b) {
+    while (_rpoIndex[a->getId()] > _rpoIndex[b->getId()])
+      a = _idom[a->getId()];
+    while (_rpoIndex[b->getId()] > _rpoIndex[a->getId()])
+      b = _idom[b->getId()];
+  }
+  return a;
+}
+
+bool IRPassManager::_dominates(IRBlock* a, IRBlock* b) const noexcept {
+  for (;;) {
+    if (a == b)
+      return true;
+
+    IRBlock* idom = _idom[b->getId()];
+    if (idom == b)
+      return false;
+    b = idom;
+  }
+}
+
+Error IRPassManager::computeDominators() noexcept {
+  size_t idCount = static_cast<size_t>(_ir->_blockIdGen) + 1;
+  size_t count = _rpo.getLength();
+  size_t i, j;
+
+  // Immediate dominators, see "A Simple, Fast Dominance Algorithm" by Keith D.
+  // Cooper, Timothy J. Harvey, and Ken Kennedy.
+  MPSL_PROPAGATE(mpInitVector<IRBlock*>(_heap, _idom, idCount, nullptr));
+
+  IRBlock* entry = _rpo[0];
+  _idom[entry->getId()] = entry;
+
+  bool changed;
+  do {
+    changed = false;
+
+    for (i = 1; i < count; i++) {
+      IRBlock* block = _rpo[i];
+      IRBlocks& predecessors = block->getPredecessors();
+      IRBlock* idom = nullptr;
+
+      for (j = 0; j < predecessors.getLength(); j++) {
+        IRBlock* pred = predecessors[j];
+        if (_idom[pred->getId()] == nullptr)
+          continue;
+        idom = idom ? _intersect(pred, idom) : pred;
+      }
+
+      if (_idom[block->getId()] != idom) {
+        _idom[block->getId()] = idom;
+        changed = true;
+      }
+    }
+  } while (changed);
+
+  // Dominator tree, children of block `id` are stored in `_domChildren` at
+  // [_domStart[id], _domStart[id + 1]).
+  MPSL_PROPAGATE(mpInitVector<uint32_t>(_heap, _domStart, idCount + 1, 0));
+  MPSL_PROPAGATE(mpInitVector<IRBlock*>(_heap, _domChildren, count, nullptr));
+
+  for (i = 1; i < count; i++)
+    _domStart[_idom[_rpo[i]->getId()]->getId() + 1]++;
+
+  for (i = 1; i <= idCount; i++)
+    _domStart[i] += _domStart[i - 1];
+
+  for (i = 1; i < count; i++)
+    _domChildren[_domStart[_idom[_rpo[i]->getId()]->getId()]++] = _rpo[i];
+
+  for (i = idCount; i > 0; i--)
+    _domStart[i] = _domStart[i - 1];
+  _domStart[0] = 0;
+
+  // Dominance frontiers, stored the same way as the dominator tree. The
+  // first iteration counts the blocks of each frontier, the second fills them.
+  MPSL_PROPAGATE(mpInitVector<uint32_t>(_heap, _dfStart, idCount + 1, 0));
+  MPSL_PROPAGATE(mpInitVector<IRBlock*>(_heap, _work, idCount, nullptr));
+
+  for (uint32_t pass = 0; pass < 2; pass++) {
+    for (i = 0; i < idCount; i++)
+      _work[i] = nullptr;
+
+    for (i = 0; i < count; i++) {
+      IRBlock* block = _rpo[i];
+      IRBlocks& predecessors = block->getPredecessors();
+
+      if (predecessors.getLength() < 2)
+        continue;
+
+      IRBlock* idom = _idom[block->getId()];
+      for (j = 0; j < predecessors.getLength(); j++) {
+        IRBlock* runner = predecessors[j];
+
+        while (runner != idom) {
+          uint32_t id = runner->getId();
+
+          // `_work[id]` is the last block added to the frontier of `runner`.
+          if (_work[id] != block) {
+            _work[id] = block;
+            if (pass == 0)
+              _dfStart[id + 1]++;
+            else
+              _df[_dfStart[id]++] = block;
+          }
+
+          if (runner == entry)
+            break;
+          runner = _idom[id];
+        }
+      }
+    }
+
+    if (pass == 0) {
+      for (i = 1; i <= idCount; i++)
+        _dfStart[i] += _dfStart[i - 1];
+      MPSL_PROPAGATE(mpInitVector<IRBlock*>(_heap, _df, _dfStart[idCount], nullptr));
+    }
+    else {
+      for (i = idCount; i > 0; i--)
+        _dfStart[i] = _dfStart[i - 1];
+      _dfStart[0] = 0;
+    }
+  }
+
+  _work.truncate(0);
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::IRPassManager - SSA]
+// ============================================================================
+
+void IRPassManager::_markUndominatedUses(IRBlock* block) noexcept {
+  IRBody& body = block->getBody();
+  size_t i, len = body.getLength();
+
+  for (i = 0; i < len; i++) {
+    IRInst* inst = body[i];
+    IRObject** opArray = inst->getOpArray();
+    uint32_t opCount = inst->getOpCount();
+
+    IRReg* def = mpGetDefReg(inst);
+    for (uint32_t opIndex = def != nullptr; opIndex < opCount; opIndex++) {
+      IRObject* op = opArray[opIndex];
+      IRReg* regs[2] = { nullptr, nullptr };
+
+      if (op->isReg()) {
+        regs[0] = op->as<IRReg>();
+      }
+      else if (op->isMem()) {
+        regs[0] = op->as<IRMem>()->getBase();
+        regs[1] = op->as<IRMem>()->getIndex();
+      }
+
+      for (uint32_t k = 0; k < 2; k++) {
+        if (regs[k] == nullptr) continue;
+
+        RegData& rd = getRegData(regs[k]);
+        if (rd.defCount != 0 && (rd.flags & kRegDefined) == 0)
+          rd.flags |= kRegCandidate;
+      }
+    }
+
+    if (def)
+      getRegData(def).flags |= kRegDefined;
+  }
+
+  uint32_t id = block->getId();
+  for (uint32_t c = _domStart[id]; c < _domStart[id + 1]; c++)
+    _markUndominatedUses(_domChildren[c]);
+
+  for (i = 0; i < len; i++) {
+    IRReg* def = mpGetDefReg(body[i]);
+    if (def)
+      getRegData(def).flags &= ~kRegDefined;
+  }
+}
+
+Error IRPassManager::toSSA(bool& converted) noexcept {
+  converted = false;
+
+  IRBlock* entry = _ir->getEntry();
+  if (entry->hasPredecessors())
+    return kErrorOk;
+
+  MPSL_PROPAGATE(resetRegData());
+
+  size_t count = _rpo.getLength();
+  size_t idCount = static_cast<size_t>(_ir->_blockIdGen) + 1;
+  size_t i, j;
+
+  // Count definitions of all registers and check whether the IR can be
+  // renamed. Registers used by memory operands are shared by all instructions
+  // that use the same `IRMem`, so they are never renamed.
+  for (i = 0; i < count; i++) {
+    IRBody& body = _rpo[i]->getBody();
+
+    for (j = 0; j < body.getLength(); j++) {
+      IRInst* inst = body[j];
+      uint32_t code = inst->getInstCode() & kInstCodeMask;
+
+      // Inserts only modify a part of their destination.
+      if (code == kInstCodeInsert32 || code == kInstCodeInsert64)
+        return kErrorOk;
+
+      IRObject** opArray = inst->getOpArray();
+      uint32_t opCount = inst->getOpCount();
+
+      for (uint32_t opIndex = 0; opIndex < opCount; opIndex++) {
+        IRObject* op = opArray[opIndex];
+
+        if (op->isReg()) {
+          getRegData(op->as<IRReg>()).reg = op->as<IRReg>();
+        }
+        else if (op->isMem()) {
+          IRMem* mem = op->as<IRMem>();
+          if (mem->hasBase()) getRegData(mem->getBase()).flags |= kRegInMem;
+          if (mem->hasIndex()) getRegData(mem->getIndex()).flags |= kRegInMem;
+        }
+      }
+
+      IRReg* def = mpGetDefReg(inst);
+      if (def)
+        getRegData(def).defCount++;
+    }
+  }
+
+  // Registers defined more than once and registers having a use that is not
+  // dominated by their only definition have to be renamed.
+  _markUndominatedUses(entry);
+
+  size_t regCount = _regData.getLength();
+  uint32_t numSites = 0;
+
+  for (i = 1; i < regCount; i++) {
+    RegData& rd = _regData[i];
+
+    if (rd.defCount > 1)
+      rd.flags |= kRegCandidate;
+
+    if (rd.flags & kRegCandidate) {
+      if (rd.flags & kRegInMem)
+        return kErrorOk;
+
+      rd.defStart = numSites;
+      numSites += rd.defCount;
+      rd.defCount = 0;
+    }
+  }
+
+  // Blocks that define each candidate.
+  MPSL_PROPAGATE(mpInitVector<IRBlock*>(_heap, _defSites, numSites, nullptr));
+
+  for (i = 0; i < count; i++) {
+    IRBlock* block = _rpo[i];
+    IRBody& body = block->getBody();
+
+    for (j = 0; j < body.getLength(); j++) {
+      IRReg* def = mpGetDefReg(body[j]);
+      if (def == nullptr) continue;
+
+      RegData& rd = getRegData(def);
+      if (rd.flags & kRegCandidate)
+        _defSites[rd.defStart + rd.defCount++] = block;
+    }
+  }
+
+  // Place phi nodes at the iterated dominance frontier of all definitions.
+  ZoneVector<uint32_t> phiMark;
+  ZoneVector<uint32_t> workMark;
+
+  Error err = mpInitVector<uint32_t>(_heap, phiMark, idCount, 0);
+  if (err == kErrorOk)
+    err = mpInitVector<uint32_t>(_heap, workMark, idCount, 0);
+
+  for (i = 1; i < regCount && err == kErrorOk; i++) {
+    RegData& rd = _regData[i];
+    if ((rd.flags & kRegCandidate) == 0)
+      continue;
+
+    IRReg* reg = rd.reg;
+    uint32_t stamp = static_cast<uint32_t>(i);
+
+    // Candidates are referenced until renamed, see below.
+    reg->addRef();
+    _work.truncate(0);
+
+    for (j = 0; j < rd.defCount && err == kErrorOk; j++) {
+      IRBlock* block = _defSites[rd.defStart + j];
+      if (workMark[block->getId()] != stamp) {
+        workMark[block->getId()] = stamp;
+        err = _work.append(_heap, block);
+      }
+    }
+
+    while (!_work.isEmpty() && err == kErrorOk) {
+      uint32_t id = _work.pop()->getId();
+
+      for (j = _dfStart[id]; j < _dfStart[id + 1]; j++) {
+        IRBlock* block = _df[j];
+        if (phiMark[block->getId()] == stamp)
+          continue;
+
+        phiMark[block->getId()] = stamp;
+        uint32_t numPreds = static_cast<uint32_t>(block->getPredecessors().getLength());
+
+        IRInst* phi = _ir->_newInst(kInstCodePhi, numPreds + 1);
+        if (phi == nullptr) {
+          err = MPSL_TRACE_ERROR(kErrorNoMemory);
+          break;
+        }
+
+        IRObject** opArray = phi->getOpArray();
+        for (uint32_t k = 0; k <= numPreds; k++) {
+          opArray[k] = reg;
+          reg->addRef();
+        }
+
+        err = block->prepend(phi);
+        if (err != kErrorOk)
+          break;
+
+        if (workMark[block->getId()] != stamp) {
+          workMark[block->getId()] = stamp;
+          err = _work.append(_heap, block);
+          if (err != kErrorOk)
+            break;
+        }
+      }
+    }
+  }
+
+  phiMark.release(_heap);
+  workMark.release(_heap);
+  MPSL_PROPAGATE(err);
+
+  // Rename, each candidate starts as its own (undefined) version.
+  _ssaFirstId = _ir->_varIdGen + 1;
+
+  for (i = 1; i < regCount; i++) {
+    RegData& rd = _regData[i];
+    if (rd.flags & kRegCandidate)
+      rd.link = rd.reg;
+  }
+
+  MPSL_PROPAGATE(_renameBlock(entry));
+
+  for (i = 1; i < regCount; i++) {
+    RegData& rd = _regData[i];
+    if ((rd.flags & kRegCandidate) == 0)
+      continue;
+
+    IRReg* reg = rd.reg;
+    rd.link = nullptr;
+
+    // Only referenced by uses that are never defined (if any).
+    if (reg->getRefCount() == 1)
+      rd.reg = nullptr;
+    _ir->derefObject(reg);
+  }
+
+  converted = true;
+  return kErrorOk;
+}
+
+Error IRPassManager::_renameBlock(IRBlock* block) noexcept {
+  IRBody& body = block->getBody();
+  size_t i, len = body.getLength();
+
+  for (i = 0; i < len; i++) {
+    IRInst* inst = body[i];
+    IRObject** opArray = inst->getOpArray();
+    uint32_t opCount = inst->getOpCount();
+
+    IRReg* def = mpGetDefReg(inst);
+
+    // Phi arguments are renamed by predecessors.
+    if (!mpInstInfoOf(inst).isPhi()) {
+      for (uint32_t opIndex = def != nullptr; opIndex < opCount; opIndex++) {
+        IRObject* op = opArray[opIndex];
+        if (op->isReg() && _isCandidate(op->as<IRReg>()))
+          setOperand(inst, opIndex, getRegData(op->as<IRReg>()).link);
+      }
+    }
+
+    if (def && _isCandidate(def)) {
+      IRReg* version = _ir->newVar(def->getReg(), def->getWidth());
+      MPSL_NULLCHECK(version);
+      MPSL_PROPAGATE(updateRegData());
+
+      RegData& rd = getRegData(def);
+      RegData& vd = getRegData(version);
+
+      vd.reg = version;
+      vd.orig = def;
+      vd.link = rd.link;
+      rd.link = version;
+
+      setOperand(inst, 0, version);
+    }
+  }
+
+  IRBlocks& successors = block->getSuccessors();
+  for (i = 0; i < successors.getLength(); i++) {
+    IRBlock* succ = successors[i];
+    IRBody& succBody = succ->getBody();
+    uint32_t opIndex = static_cast<uint32_t>(succ->getPredecessors().indexOf(block)) + 1;
+
+    for (size_t j = 0; j < succBody.getLength(); j++) {
+      IRInst* phi = succBody[j];
+      if (!mpInstInfoOf(phi).isPhi())
+        break;
+
+      IRReg* arg = phi->getOperand(opIndex)->as<IRReg>();
+      if (_isCandidate(arg))
+        setOperand(phi, opIndex, getRegData(arg).link);
+    }
+  }
+
+  uint32_t id = block->getId();
+  for (uint32_t c = _domStart[id]; c < _domStart[id + 1]; c++)
+    MPSL_PROPAGATE(_renameBlock(_domChildren[c]));
+
+  // Pop versions defined by this block (in reverse order).
+  i = len;
+  while (i != 0) {
+    IRReg* def = mpGetDefReg(body[--i]);
+    if (def == nullptr || def->getId() < _ssaFirstId)
+      continue;
+
+    RegData& vd = getRegData(def);
+    getRegData(vd.orig).link = vd.link;
+  }
+
+  return kErrorOk;
+}
+
+Error IRPassManager::fromSSA() noexcept {
+  MPSL_PROPAGATE(updateDefs());
+  size_t count = _rpo.getLength();
+
+  for (size_t i = 0; i < count; i++) {
+    IRBlock* block = _rpo[i];
+    IRBody& body = block->getBody();
+    IRBlocks& predecessors = block->getPredecessors();
+
+    for (size_t j = 0; j < body.getLength(); j++) {
+      IRInst* phi = body[j];
+      if (!mpInstInfoOf(phi).isPhi())
+        break;
+
+      IRReg* dst = phi->getOperand(0)->as<IRReg>();
+      uint32_t movCode = mpMovByWidth(dst->getWidth());
+
+      if (movCode == kInstCodeNone)
+        return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+      // Each phi uses its own temporary, so phis of the same block that use
+      // each other's results (parallel copies) are always correct.
+      IRReg* tmp = _ir->newVar(dst->getReg(), dst->getWidth());
+      MPSL_NULLCHECK(tmp);
+
+      for (size_t k = 0; k < predecessors.getLength(); k++) {
+        IRReg* arg = phi->getOperand(k + 1)->as<IRReg>();
+        if (_isUndefined(arg))
+          continue;
+
+        IRInst* copy = _ir->newInst(movCode, tmp, arg);
+        MPSL_NULLCHECK(copy);
+        MPSL_PROPAGATE(mpInsertBeforeJump(predecessors[k], copy));
+      }
+
+      IRInst* mov = _ir->newInst(movCode, dst, tmp);
+      MPSL_NULLCHECK(mov);
+
+      body[j] = mov;
+      _ir->deleteInst(phi);
+    }
+  }
+
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::IRPassManager - Loops]
+// ============================================================================
+
+Error IRPassManager::_collectLoop(IRBlock* header, uint32_t& numLatches) noexcept {
+  IRBlocks& predecessors = header->getPredecessors();
+  size_t i;
+
+  numLatches = 0;
+  _loop.truncate(0);
+  _work.truncate(0);
+
+  // Each predecessor dominated by the header is the source of a back edge.
+  for (i = 0; i < predecessors.getLength(); i++) {
+    IRBlock* pred = predecessors[i];
+    if (_dominates(header, pred)) {
+      numLatches++;
+      MPSL_PROPAGATE(_work.append(_heap, pred));
+    }
+  }
+
+  if (numLatches == 0)
+    return kErrorOk;
+
+  _loopIndex[header->getId()] = 0;
+  MPSL_PROPAGATE(_loop.append(_heap, header));
+
+  while (!_work.isEmpty()) {
+    IRBlock* block = _work.pop();
+    if (_isInLoop(block))
+      continue;
+
+    _loopIndex[block->getId()] = static_cast<uint32_t>(_loop.getLength());
+    MPSL_PROPAGATE(_loop.append(_heap, block));
+
+    IRBlocks& blockPreds = block->getPredecessors();
+    for (i = 0; i < blockPreds.getLength(); i++)
+      MPSL_PROPAGATE(_work.append(_heap, blockPreds[i]));
+  }
+
+  return kErrorOk;
+}
+
+void IRPassManager::_clearLoop() noexcept {
+  for (size_t i = 0; i < _loop.getLength(); i++)
+    _loopIndex[_loop[i]->getId()] = kInvalidLoopIndex;
+  _loop.truncate(0);
+}
+
+Error IRPassManager::unrollLoop(bool& unrolled) noexcept {
+  unrolled = false;
+  MPSL_PROPAGATE(scanDefs());
+
+  size_t idCount = static_cast<size_t>(_ir->_blockIdGen) + 1;
+  MPSL_PROPAGATE(mpInitVector<uint32_t>(_heap, _loopIndex, idCount, kInvalidLoopIndex));
+
+  // Inner loops follow outer loops in RPO, visit them first.
+  size_t i = _rpo.getLength();
+  while (i != 0 && !unrolled) {
+    IRBlock* header = _rpo[--i];
+    uint32_t numLatches;
+
+    MPSL_PROPAGATE(_collectLoop(header, numLatches));
+    Error err = numLatches == 1 ? _unrollLoop(header, unrolled) : static_cast<Error>(kErrorOk);
+
+    _clearLoop();
+    MPSL_PROPAGATE(err);
+  }
+
+  return kErrorOk;
+}
+
+Error IRPassManager::_unrollLoop(IRBlock* header, bool& unrolled) noexcept {
+  IRBlocks& predecessors = header->getPredecessors();
+  IRBlock* latch = nullptr;
+  IRBlock* preheader = nullptr;
+
+  size_t i, j, k;
+  size_t loopSize = _loop.getLength();
+  size_t numInsts = 0;
+
+  for (i = 0; i < predecessors.getLength(); i++) {
+    IRBlock* pred = predecessors[i];
+
+    if (_isInLoop(pred)) {
+      latch = pred;
+    }
+    else {
+      if (preheader != nullptr)
+        return kErrorOk;
+      preheader = pred;
+    }
+  }
+
+  if (preheader == nullptr || latch == nullptr)
+    return kErrorOk;
+
+  IRBody& preBody = preheader->getBody();
+  if (preBody.isEmpty() || !mpInstInfoOf(preBody.getLast()).isJxx())
+    return kErrorOk;
+
+  // Only innermost loops are unrolled, an inner loop has a back edge.
+  for (i = 0; i < loopSize; i++) {
+    IRBlock* block = _loop[i];
+    IRBlocks& successors = block->getSuccessors();
+
+    numInsts += block->getBody().getLength();
+    for (j = 0; j < successors.getLength(); j++) {
+      IRBlock* succ = successors[j];
+      if (succ != header && _isInLoop(succ) && _rpoIndex[succ->getId()] <= _rpoIndex[block->getId()])
+        return kErrorOk;
+    }
+  }
+
+  // The header has to decide whether to run the next iteration or leave.
+  IRBody& headerBody = header->getBody();
+  if (headerBody.isEmpty())
+    return kErrorOk;
+
+  IRInst* jnz = headerBody.getLast();
+  if (jnz->getInstCode() != kInstCodeJnz || !jnz->getOperand(0)->isReg())
+    return kErrorOk;
+
+  IRBlock* taken = jnz->getOperand(1)->as<IRBlock>();
+  IRBlock* notTaken = jnz->getOperand(2)->as<IRBlock>();
+
+  bool stayIfTrue = _isInLoop(taken);
+  if (stayIfTrue == _isInLoop(notTaken))
+    return kErrorOk;
+
+  IRBlock* bodyEntry = stayIfTrue ? taken : notTaken;
+  IRBlock* exit = stayIfTrue ? notTaken : taken;
+
+  if (bodyEntry == header)
+    return kErrorOk;
+
+  // The condition compares a counter with a constant.
+  RegData& cd = getRegData(jnz->getOperand(0)->as<IRReg>());
+  if (cd.defCount != 1 || cd.block != header || cd.def->getOpCount() != 3)
+    return kErrorOk;
+
+  IRInst* cmp = cd.def;
+  uint32_t counterIndex;
+  Value bound;
+
+  if (getUniqueConstant(cmp->getOperand(2), bound))
+    counterIndex = 1;
+  else if (getUniqueConstant(cmp->getOperand(1), bound))
+    counterIndex = 2;
+  else
+    return kErrorOk;
+
+  IRObject* counterObj = cmp->getOperand(counterIndex);
+  if (!counterObj->isReg())
+    return kErrorOk;
+
+  IRReg* counter = counterObj->as<IRReg>();
+  if (counter->getWidth() != 4 || (getRegData(counter).flags & kRegInMem))
+    return kErrorOk;
+
+  // The counter is changed exactly once by each iteration that continues.
+  IRInst* stepDef = nullptr;
+  IRBlock* stepBlock = nullptr;
+  size_t stepIndex = 0;
+
+  for (i = 0; i < loopSize; i++) {
+    IRBody& body = _loop[i]->getBody();
+
+    for (j = 0; j < body.getLength(); j++) {
+      if (mpGetDefReg(body[j]) != counter)
+        continue;
+
+      if (stepDef != nullptr)
+        return kErrorOk;
+
+      stepDef = body[j];
+      stepBlock = _loop[i];
+      stepIndex = j;
+    }
+  }
+
+  if (stepDef == nullptr || stepBlock == header || !_dominates(stepBlock, latch))
+    return kErrorOk;
+
+  // Either `counter = op counter, step` or `tmp = op counter, step` followed
+  // by `counter = mov tmp`.
+  IRInst* stepInst = stepDef;
+  if (mpInstInfoOf(stepDef).isMov()) {
+    IRObject* src = stepDef->getOperand(1);
+    if (!src->isReg())
+      return kErrorOk;
+
+    RegData& sd = getRegData(src->as<IRReg>());
+    if (sd.defCount != 1 || sd.block != stepBlock)
+      return kErrorOk;
+
+    IRBody& body = stepBlock->getBody();
+    for (k = 0; k < stepIndex; k++)
+      if (body[k] == sd.def)
+        break;
+
+    if (k == stepIndex)
+      return kErrorOk;
+    stepInst = sd.def;
+  }
+
+  Value step;
+  if (stepInst->getOpCount() != 3 || stepInst->getOperand(1) != counter ||
+      !getUniqueConstant(stepInst->getOperand(2), step))
+    return kErrorOk;
+
+  // The counter is initialized by a constant right before the loop.
+  IRInst* initDef = nullptr;
+  for (i = preBody.getLength(); i != 0; ) {
+    IRInst* inst = preBody[--i];
+    if (mpGetDefReg(inst) == counter) {
+      initDef = inst;
+      break;
+    }
+  }
+
+  if (initDef == nullptr || initDef->getOpCount() != 2)
+    return kErrorOk;
+
+  uint32_t initCode = initDef->getInstCode() & kInstCodeMask;
+  Value value;
+
+  if ((initCode != kInstCodeFetch32 && initCode != kInstCodeMov32) ||
+      !getUniqueConstant(initDef->getOperand(1), value))
+    return kErrorOk;
+
+  // Run the counter to get the trip count.
+  uint32_t stepCode = stepInst->getInstCode();
+  uint32_t tripCount = 0;
+
+  for (;;) {
+    Value cond;
+    Error err = counterIndex == 1 ? Fold::foldInst(cmp->getInstCode(), cond, value, bound)
+                                  : Fold::foldInst(cmp->getInstCode(), cond, bound, value);
+
+    if (err != kErrorOk)
+      return kErrorOk;
+
+    if ((cond.u[0] != 0) != stayIfTrue)
+      break;
+
+    if (++tripCount > _unrollLimit || tripCount * numInsts > kMaxUnrolledSize)
+      return kErrorOk;
+
+    Value next;
+    if (!mpIsSafeToFold(stepCode & kInstCodeMask, InstInfo::widthOf(stepCode), value, step) ||
+        Fold::foldInst(stepCode, next, value, step) != kErrorOk)
+      return kErrorOk;
+    value = next;
+  }
+
+  // Clone the loop `tripCount` times, each copy of the header jumps directly
+  // to its body and the last copy (only the header) leaves the loop.
+  size_t numCopies = static_cast<size_t>(tripCount) + 1;
+  MPSL_PROPAGATE(mpInitVector<IRBlock*>(_heap, _clones, numCopies * loopSize, nullptr));
+
+  for (k = 0; k < numCopies; k++) {
+    size_t n = k < tripCount ? loopSize : 1;
+
+    for (i = 0; i < n; i++) {
+      IRBlock* clone = _ir->newBlock();
+      MPSL_NULLCHECK(clone);
+      _clones[k * loopSize + i] = clone;
+    }
+  }
+
+  for (k = 0; k < numCopies; k++) {
+    size_t n = k < tripCount ? loopSize : 1;
+    IRBlock** copy = &_clones[k * loopSize];
+
+    for (i = 0; i < n; i++) {
+      IRBody& body = _loop[i]->getBody();
+      IRBlock* clone = copy[i];
+      size_t len = body.getLength();
+
+      for (j = 0; j < len; j++) {
+        IRInst* inst = body[j];
+        IRInst* cloneInst;
+
+        if (i == 0 && j == len - 1) {
+          IRBlock* target = k < tripCount ? copy[_loopIndex[bodyEntry->getId()]] : exit;
+          cloneInst = _ir->newInst(kInstCodeJmp, target);
+          MPSL_NULLCHECK(cloneInst);
+        }
+        else {
+          uint32_t opCount = inst->getOpCount();
+          cloneInst = _ir->_newInst(inst->getInstCode(), opCount);
+          MPSL_NULLCHECK(cloneInst);
+
+          IRObject** opArray = cloneInst->getOpArray();
+          for (uint32_t opIndex = 0; opIndex < opCount; opIndex++) {
+            IRObject* op = inst->getOperand(opIndex);
+
+            // Jumps within the loop go to the same copy, back edges to the next one.
+            if (op->isBlock() && _isInLoop(op->as<IRBlock>())) {
+              uint32_t index = _loopIndex[op->getId()];
+              op = index == 0 ? copy[loopSize] : copy[index];
+            }
+
+            op->addRef();
+            opArray[opIndex] = op;
+          }
+        }
+
+        MPSL_PROPAGATE(clone->append(cloneInst));
+
+        if (mpInstInfoOf(cloneInst).isJxx()) {
+          uint32_t opCount = cloneInst->getOpCount();
+          for (uint32_t opIndex = 0; opIndex < opCount; opIndex++) {
+            IRObject* op = cloneInst->getOperand(opIndex);
+            if (op->isBlock() && !clone->getSuccessors().contains(op->as<IRBlock>()))
+              MPSL_PROPAGATE(_ir->connectBlocks(clone, op->as<IRBlock>()));
+          }
+        }
+      }
+    }
+  }
+
+  // Enter the first copy instead of the loop.
+  IRInst* preJump = preBody.getLast();
+  IRBlock* first = _clones[0];
+
+  for (uint32_t opIndex = 0; opIndex < preJump->getOpCount(); opIndex++)
+    if (preJump->getOperand(opIndex) == header)
+      setOperand(preJump, opIndex, first);
+
+  IRBlocks& preSuccessors = preheader->getSuccessors();
+  preSuccessors.removeAt(preSuccessors.indexOf(header));
+  predecessors.removeAt(predecessors.indexOf(preheader));
+  MPSL_PROPAGATE(_ir->connectBlocks(preheader, first));
+
+  unrolled = true;
+  return kErrorOk;
+}
+
+Error IRPassManager::hoistLoopInvariants(bool& changed) noexcept {
+  MPSL_PROPAGATE(updateDefs());
+
+  size_t idCount = static_cast<size_t>(_ir->_blockIdGen) + 1;
+  MPSL_PROPAGATE(mpInitVector<uint32_t>(_heap, _loopIndex, idCount, kInvalidLoopIndex));
+
+  // Inner loops first, what they hoist can be hoisted again by outer loops.
+  size_t i = _rpo.getLength();
+  while (i != 0) {
+    IRBlock* header = _rpo[--i];
+    uint32_t numLatches;
+
+    MPSL_PROPAGATE(_collectLoop(header, numLatches));
+    Error err = numLatches != 0 ? _hoistLoop(header, changed) : static_cast<Error>(kErrorOk);
+
+    _clearLoop();
+    MPSL_PROPAGATE(err);
+  }
+
+  return kErrorOk;
+}
+
+Error IRPassManager::_hoistLoop(IRBlock* header, bool& changed) noexcept {
+  IRBlocks& predecessors = header->getPredecessors();
+  IRBlock* preheader = nullptr;
+
+  size_t i, j;
+  size_t loopSize = _loop.getLength();
+
+  for (i = 0; i < predecessors.getLength(); i++) {
+    IRBlock* pred = predecessors[i];
+    if (_isInLoop(pred))
+      continue;
+
+    if (preheader != nullptr)
+      return kErrorOk;
+    preheader = pred;
+  }
+
+  // Hoisted instructions are executed even if the loop isn't entered, so the
+  // preheader must not branch.
+  if (preheader == nullptr || preheader->getSuccessors().getLength() != 1)
+    return kErrorOk;
+
+  // Memory can be read in advance only if the loop doesn't write to it.
+  bool hasStores = false;
+  for (i = 0; i < loopSize && !hasStores; i++) {
+    IRBody& body = _loop[i]->getBody();
+
+    for (j = 0; j < body.getLength(); j++) {
+      const InstInfo& info = mpInstInfoOf(body[j]);
+      if (info.isStore() || info.isCall()) {
+        hasStores = true;
+        break;
+      }
+    }
+  }
+
+  // Visit blocks in RPO so invariants are hoisted before instructions that
+  // use them (all blocks of the loop follow its header).
+  for (i = _rpoIndex[header->getId()]; i < _rpo.getLength(); i++) {
+    IRBlock* block = _rpo[i];
+    if (!_isInLoop(block))
+      continue;
+
+    IRBody& body = block->getBody();
+    for (j = 0; j < body.getLength(); j++) {
+      IRInst* inst = body[j];
+      const InstInfo& info = mpInstInfoOf(inst);
+
+      IRReg* dst = mpGetDefReg(inst);
+      if (dst == nullptr || info.isPhi() || info.isCall() || info.isRet() ||
+          (getRegData(dst).flags & kRegInMem))
+        continue;
+
+      // Integer division traps, it can't be executed speculatively.
+      uint32_t instCode = inst->getInstCode() & kInstCodeMask;
+      if (instCode == kInstCodePdivsd || instCode == kInstCodePmodsd)
+        continue;
+
+      IRObject** opArray = inst->getOpArray();
+      uint32_t opCount = inst->getOpCount();
+      uint32_t opIndex;
+
+      for (opIndex = 1; opIndex < opCount; opIndex++) {
+        IRObject* op = opArray[opIndex];
+        IRReg* regs[2] = { nullptr, nullptr };
+
+        if (op->isReg()) {
+          regs[0] = op->as<IRReg>();
+        }
+        else if (op->isMem()) {
+          if (hasStores)
+            break;
+          regs[0] = op->as<IRMem>()->getBase();
+          regs[1] = op->as<IRMem>()->getIndex();
+        }
+        else if (!op->isImm()) {
+          break;
+        }
+
+        if ((regs[0] && getRegData(regs[0]).block && _isInLoop(getRegData(regs[0]).block)) ||
+            (regs[1] && getRegData(regs[1]).block && _isInLoop(getRegData(regs[1]).block)))
+          break;
+      }
+
+      if (opIndex != opCount)
+        continue;
+
+      block->neuterAt(j);
+      MPSL_PROPAGATE(mpInsertBeforeJump(preheader, inst));
+
+      getRegData(dst).block = preheader;
+      changed = true;
+    }
+  }
+
+  for (i = 0; i < loopSize; i++)
+    _loop[i]->fixupAfterNeutering();
+
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::IRPassManager - Passes]
+// ============================================================================
+
+Error IRPassManager::propagateCopies(bool& changed) noexcept {
+  MPSL_PROPAGATE(updateDefs());
+
+  size_t i, count = _rpo.getLength();
+  for (i = 1; i < _regData.getLength(); i++)
+    _regData[i].link = nullptr;
+
+  _insts.truncate(0);
+  for (i = 0; i < count; i++) {
+    IRBlock* block = _rpo[i];
+    IRBody& body = block->getBody();
+
+    for (size_t j = 0; j < body.getLength(); j++) {
+      IRInst* inst = body[j];
+      const InstInfo& info = mpInstInfoOf(inst);
+
+      IRReg* dst = mpGetDefReg(inst);
+      IRReg* src = nullptr;
+
+      if (dst == nullptr || (getRegData(dst).flags & kRegInMem))
+        continue;
+
+      if (info.isMov()) {
+        IRObject* op = inst->getOperand(1);
+        if (op->isReg() && op->as<IRReg>()->getReg() == dst->getReg() &&
+                           op->as<IRReg>()->getWidth() == dst->getWidth())
+          src = _resolve(op->as<IRReg>());
+      }
+      else if (info.isPhi()) {
+        // A phi is trivial if all its arguments are the same register, not
+        // counting the phi itself and arguments that are never defined.
+        uint32_t opCount = inst->getOpCount();
+
+        for (uint32_t opIndex = 1; opIndex < opCount; opIndex++) {
+          IRReg* arg = _resolve(inst->getOperand(opIndex)->as<IRReg>());
+          if (arg == dst || _isUndefined(arg))
+            continue;
+
+          if (src == nullptr) {
+            src = arg;
+          }
+          else if (src != arg) {
+            src = nullptr;
+            break;
+          }
+        }
+      }
+
+      if (src == nullptr || src == dst)
+        continue;
+
+      getRegData(dst).link = src;
+      block->neuterAt(j);
+      MPSL_PROPAGATE(_insts.append(_heap, inst));
+    }
+  }
+
+  if (_insts.isEmpty())
+    return kErrorOk;
+
+  applyReplacements();
+
+  for (i = 0; i < _insts.getLength(); i++)
+    _ir->deleteInst(_insts[i]);
+  _insts.truncate(0);
+
+  for (i = 0; i < count; i++)
+    _rpo[i]->fixupAfterNeutering();
+
+  changed = true;
+  return kErrorOk;
+}
+
+Error IRPassManager::foldConstants(bool& changed) noexcept {
+  MPSL_PROPAGATE(updateDefs());
+  size_t count = _rpo.getLength();
+
+  for (size_t i = 0; i < count; i++) {
+    IRBody& body = _rpo[i]->getBody();
+
+    for (size_t j = 0; j < body.getLength(); j++) {
+      IRInst* inst = body[j];
+      const InstInfo& info = mpInstInfoOf(inst);
+
+      if (info.isFetch() || info.isMov() || info.isPhi() || info.isStore() ||
+          info.isJxx()   || info.isCall() || info.isRet())
+        continue;
+
+      IRReg* dst = mpGetDefReg(inst);
+      if (dst == nullptr || (getRegData(dst).flags & kRegInMem))
+        continue;
+
+      uint32_t fetchCode = mpFetchByWidth(dst->getWidth());
+      if (fetchCode == kInstCodeNone)
+        continue;
+
+      uint32_t instCode = inst->getInstCode();
+      uint32_t opCount = inst->getOpCount();
+
+      Value out;
+      Value lVal;
+      Value rVal;
+
+      if (opCount == 2) {
+        if (!getConstant(inst->getOperand(1), lVal) ||
+            Fold::foldInst(instCode, out, lVal) != kErrorOk)
+          continue;
+      }
+      else if (opCount == 3) {
+        if (!getConstant(inst->getOperand(1), lVal) ||
+            !getConstant(inst->getOperand(2), rVal) ||
+            !mpIsSafeToFold(instCode & kInstCodeMask, InstInfo::widthOf(instCode), lVal, rVal) ||
+            Fold::foldInst(instCode, out, lVal, rVal) != kErrorOk)
+          continue;
+      }
+      else {
+        continue;
+      }
+
+      IRImm* imm = _ir->newImm(out, dst->getReg(), dst->getWidth());
+      MPSL_NULLCHECK(imm);
+      imm->setTypeInfo(mpGetFoldedTypeInfo(info, dst->getWidth()));
+
+      IRInst* fetch = _ir->newInst(fetchCode, dst, imm);
+      MPSL_NULLCHECK(fetch);
+
+      body[j] = fetch;
+      _ir->deleteInst(inst);
+
+      // Instructions that follow can use the folded value immediately.
+      getRegData(dst).def = fetch;
+      changed = true;
+    }
+  }
+
+  return kErrorOk;
+}
+
+//! Get whether all elements of `v` that fit into `width` bytes have `bits`,
+//! `size` is the size of a single element (4 or 8).
+static bool mpIsSplat(const Value& v, uint32_t width, uint32_t size, uint64_t bits) noexcept {
+  uint32_t count = width >= size ? width / size : 1;
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint64_t element = size == 4 ? static_cast<uint64_t>(v.u[i]) : v.q[i];
+    if (element != bits)
+      return false;
+  }
+
+  return true;
+}
+
+//! Get `k` of a power of two `2^k`.
+static MPSL_INLINE int32_t mpLog2(uint32_t x) noexcept {
+  int32_t k = 0;
+  while ((1U << k) != x)
+    k++;
+  return k;
+}
+
+//! Compute the magic multiplier `m` and shift `s` of a signed division by `d`
+//! that is not -1, 0, or 1 (Hacker's Delight, 10-1).
+static void mpSignedMagic(int32_t d, int32_t& m, uint32_t& s) noexcept {
+  const uint32_t two31 = 0x80000000U;
+
+  uint32_t ad = d < 0 ? 0U - static_cast<uint32_t>(d) : static_cast<uint32_t>(d);
+  uint32_t t = two31 + (static_cast<uint32_t>(d) >> 31);
+  uint32_t anc = t - 1 - t % ad;
+
+  uint32_t p = 31;
+  uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+  uint32_t q2 = two31 / ad , r2 = two31 - q2 * ad;
+  uint32_t delta;
+
+  do {
+    p++;
+
+    q1 *= 2; r1 *= 2;
+    if (r1 >= anc) { q1++; r1 -= anc; }
+
+    q2 *= 2; r2 *= 2;
+    if (r2 >= ad) { q2++; r2 -= ad; }
+
+    delta = ad - r2;
+  } while (q1 < delta || (q1 == delta && r1 == 0));
+
+  m = static_cast<int32_t>(q2 + 1);
+  if (d < 0)
+    m = -m;
+  s = p - 32;
+}
+
+Error IRPassManager::reduceStrength(bool& changed) noexcept {
+  MPSL_PROPAGATE(updateDefs());
+
+  bool fastMath = (_flags & kIRPassFastMath) != 0;
+  size_t count = _rpo.getLength();
+
+  for (size_t i = 0; i < count; i++) {
+    IRBody& body = _rpo[i]->getBody();
+
+    for (size_t j = 0; j < body.getLength(); j++) {
+      IRInst* inst = body[j];
+      IRReg* dst = mpGetDefReg(inst);
+
+      if (dst == nullptr || inst->getOpCount() != 3 || (getRegData(dst).flags & kRegInMem))
+        continue;
+
+      uint32_t instCode = inst->getInstCode();
+      uint32_t width = dst->getWidth();
+
+      IRObject* o1 = inst->getOperand(1);
+      IRObject* o2 = inst->getOperand(2);
+
+      Value lVal;
+      Value rVal;
+
+      bool lConst = getConstant(o1, lVal);
+      bool rConst = getConstant(o2, rVal);
+
+      // Operand the result is equal to, if any.
+      IRObject* copy = nullptr;
+
+      switch (instCode & kInstCodeMask) {
+        case kInstCodePaddd:
+        case kInstCodeOri:
+        case kInstCodeXori:
+          if (rConst && mpIsSplat(rVal, width, 4, 0))
+            copy = o1;
+          else if (lConst && mpIsSplat(lVal, width, 4, 0))
+            copy = o2;
+          break;
+
+        case kInstCodeAndi:
+          if (rConst && mpIsSplat(rVal, width, 4, 0xFFFFFFFFU))
+            copy = o1;
+          else if (lConst && mpIsSplat(lVal, width, 4, 0xFFFFFFFFU))
+            copy = o2;
+          break;
+
+        case kInstCodePsubd:
+        case kInstCodePslld:
+        case kInstCodePsrld:
+        case kInstCodePsrad:
+          if (rConst && mpIsSplat(rVal, width, 4, 0))
+            copy = o1;
+          break;
+
+        case kInstCodePmuld:
+          if (lConst && !rConst) {
+            IRObject* t = o1; o1 = o2; o2 = t;
+            rVal = lVal;
+            rConst = true;
+          }
+
+          if (rConst && mpIsSplat(rVal, width, 4, rVal.u[0]) && o1->isReg()) {
+            uint32_t v = rVal.u[0];
+
+            if (v == 1) {
+              copy = o1;
+            }
+            else if (v != 0 && (v & (v - 1)) == 0) {
+              IRInst* shift = _ir->newInst(kInstCodePslld | (instCode & kInstVecMask), dst, o1, _newImmInt(mpLog2(v)));
+              MPSL_NULLCHECK(shift);
+
+              body[j] = shift;
+              _ir->deleteInst(inst);
+
+              getRegData(dst).def = shift;
+              changed = true;
+            }
+          }
+          break;
+
+        case kInstCodePdivsd:
+        case kInstCodePmodsd:
+          if (rConst && mpIsSplat(rVal, width, 4, rVal.u[0]) && o1->isReg()) {
+            bool reduced = false;
+            MPSL_PROPAGATE(_reduceDivision(body, j, rVal.i[0], reduced));
+            changed |= reduced;
+          }
+          break;
+
+        case kInstCodeMulf:
+        case kInstCodeMuld: {
+          bool isF64 = (instCode & kInstCodeMask) == kInstCodeMuld;
+          uint32_t size = isF64 ? 8 : 4;
+          uint64_t one = isF64 ? 0x3FF0000000000000U : 0x3F800000U;
+
+          if (rConst && mpIsSplat(rVal, width, size, one)) {
+            copy = o1;
+          }
+          else if (lConst && mpIsSplat(lVal, width, size, one)) {
+            copy = o2;
+          }
+          else if (fastMath && o1->isReg() && o2->isReg()) {
+            // sqrt(x) * sqrt(x) is `x` if `x` is not negative.
+            IRInst* lDef = getRegData(o1->as<IRReg>()).def;
+            IRInst* rDef = getRegData(o2->as<IRReg>()).def;
+            uint32_t sqrtCode = (isF64 ? kInstCodeSqrtd : kInstCodeSqrtf) | (instCode & kInstVecMask);
+
+            if (lDef != nullptr && rDef != nullptr &&
+                lDef->getInstCode() == sqrtCode &&
+                rDef->getInstCode() == sqrtCode &&
+                lDef->getOperand(1) == rDef->getOperand(1))
+              copy = lDef->getOperand(1);
+          }
+          break;
+        }
+
+        case kInstCodeDivf:
+        case kInstCodeDivd: {
+          bool isF64 = (instCode & kInstCodeMask) == kInstCodeDivd;
+          if (rConst && mpIsSplat(rVal, width, isF64 ? 8 : 4, isF64 ? 0x3FF0000000000000U : 0x3F800000U))
+            copy = o1;
+          break;
+        }
+
+        // x + -0 and x - +0 are `x` for any `x`, x + +0 and x - -0 are not
+        // if `x` is -0.
+        case kInstCodeAddf:
+        case kInstCodeAddd: {
+          bool isF64 = (instCode & kInstCodeMask) == kInstCodeAddd;
+          uint32_t size = isF64 ? 8 : 4;
+          uint64_t nzero = isF64 ? 0x8000000000000000U : 0x80000000U;
+
+          if (rConst && (mpIsSplat(rVal, width, size, nzero) || (fastMath && mpIsSplat(rVal, width, size, 0))))
+            copy = o1;
+          else if (lConst && (mpIsSplat(lVal, width, size, nzero) || (fastMath && mpIsSplat(lVal, width, size, 0))))
+            copy = o2;
+          break;
+        }
+
+        case kInstCodeSubf:
+        case kInstCodeSubd: {
+          bool isF64 = (instCode & kInstCodeMask) == kInstCodeSubd;
+          uint32_t size = isF64 ? 8 : 4;
+          uint64_t nzero = isF64 ? 0x8000000000000000U : 0x80000000U;
+
+          if (rConst && (mpIsSplat(rVal, width, size, 0) || (fastMath && mpIsSplat(rVal, width, size, nzero))))
+            copy = o1;
+          break;
+        }
+
+        default:
+          break;
+      }
+
+      // Only a register of the same kind and width can be copied.
+      if (copy == nullptr || !copy->isReg() ||
+          copy->as<IRReg>()->getReg() != dst->getReg() ||
+          copy->as<IRReg>()->getWidth() != width ||
+          mpMovByWidth(width) == kInstCodeNone)
+        continue;
+
+      IRInst* mov = _ir->newInst(mpMovByWidth(width), dst, copy);
+      MPSL_NULLCHECK(mov);
+
+      body[j] = mov;
+      _ir->deleteInst(inst);
+
+      getRegData(dst).def = mov;
+      changed = true;
+    }
+  }
+
+  return updateRegData();
+}
+
+Error IRPassManager::_reduceDivision(IRBody& body, size_t& index, int32_t d, bool& reduced) noexcept {
+  IRInst* inst = body[index];
+  IRReg* dst = mpGetDefReg(inst);
+  IRObject* x = inst->getOperand(1);
+
+  uint32_t instCode = inst->getInstCode();
+  uint32_t vecFlags = instCode & kInstVecMask;
+  bool isMod = (instCode & kInstCodeMask) == kInstCodePmodsd;
+
+  reduced = false;
+  if (d == 0 || d == -1 || d == static_cast<int32_t>(0x80000000U))
+    return kErrorOk;
+
+  if (d == 1) {
+    if (isMod || mpMovByWidth(dst->getWidth()) == kInstCodeNone)
+      return kErrorOk;
+
+    IRInst* mov = _ir->newInst(mpMovByWidth(dst->getWidth()), dst, x);
+    MPSL_NULLCHECK(mov);
+
+    body[index] = mov;
+    _ir->deleteInst(inst);
+
+    getRegData(dst).def = mov;
+    reduced = true;
+    return kErrorOk;
+  }
+
+  uint32_t ad = d < 0 ? 0U - static_cast<uint32_t>(d) : static_cast<uint32_t>(d);
+  bool isPow2 = (ad & (ad - 1)) == 0;
+
+  // Scalars must be held by GP registers, multiplication by a magic number is
+  // only available for them. The negation of a vector quotient needs a zero
+  // constant.
+  bool isScalar = dst->getReg() == IRReg::kKindGp && dst->getWidth() == 4;
+  uint32_t fetchCode = mpFetchByWidth(dst->getWidth());
+
+  if (isScalar ? vecFlags != kInstVec0 : (vecFlags == kInstVec0 || !isPow2))
+    return kErrorOk;
+  if (isPow2 && d < 0 && !isMod && fetchCode == kInstCodeNone)
+    return kErrorOk;
+
+  size_t i = index;
+  IRReg* q;
+
+  if (isPow2) {
+    // The dividend is biased by `ad - 1` if negative, so the arithmetic shift
+    // rounds toward zero like the division does.
+    int32_t k = mpLog2(ad);
+    bool isLast = !isMod && d > 0;
+
+    IRReg* t = x->as<IRReg>();
+    if (k > 1)
+      t = _emitAt(body, i, kInstCodePsrad | vecFlags, t, _newImmInt(k - 1));
+    t = _emitAt(body, i, kInstCodePsrld | vecFlags, t, _newImmInt(32 - k));
+    t = _emitAt(body, i, kInstCodePaddd | vecFlags, x, t);
+    q = _emitAt(body, i, kInstCodePsrad | vecFlags, t, _newImmInt(k), isLast ? dst : nullptr);
+
+    if (isMod) {
+      // The remainder doesn't depend on the sign of the divisor.
+      IRReg* m = _emitAt(body, i, kInstCodePslld | vecFlags, q, _newImmInt(k));
+      q = _emitAt(body, i, kInstCodePsubd | vecFlags, x, m, dst);
+    }
+    else if (!isLast) {
+      Value zero;
+      zero.zero();
+
+      IRImm* imm = _ir->newImm(zero, dst->getReg(), dst->getWidth());
+      MPSL_NULLCHECK(imm);
+      imm->setTypeInfo(mpGetFoldedTypeInfo(mpInstInfoOf(inst), dst->getWidth()));
+
+      IRReg* z = _emitAt(body, i, fetchCode, imm, nullptr);
+      q = _emitAt(body, i, kInstCodePsubd | vecFlags, z, q, dst);
+    }
+  }
+  else {
+    int32_t m;
+    uint32_t s;
+    mpSignedMagic(d, m, s);
+
+    q = _emitAt(body, i, kInstCodePmulhsd, x, _newImmInt(m));
+    if (d > 0 && m < 0)
+      q = _emitAt(body, i, kInstCodePaddd, q, x);
+    if (d < 0 && m > 0)
+      q = _emitAt(body, i, kInstCodePsubd, q, x);
+    if (s != 0)
+      q = _emitAt(body, i, kInstCodePsrad, q, _newImmInt(static_cast<int32_t>(s)));
+
+    // Add one if the quotient is negative to round toward zero.
+    IRReg* t = _emitAt(body, i, kInstCodePsrld, q, _newImmInt(31));
+    q = _emitAt(body, i, kInstCodePaddd, q, t, isMod ? nullptr : dst);
+
+    if (isMod) {
+      IRReg* p = _emitAt(body, i, kInstCodePmuld, q, _newImmInt(d));
+      q = _emitAt(body, i, kInstCodePsubd, x, p, dst);
+    }
+  }
+
+  MPSL_NULLCHECK(q);
+
+  // The division follows the emitted sequence.
+  body.removeAt(i);
+  _ir->deleteInst(inst);
+
+  getRegData(dst).def = body[i - 1];
+  index = i - 1;
+  reduced = true;
+  return kErrorOk;
+}
+
+IRReg* IRPassManager::_emitAt(IRBody& body, size_t& index, uint32_t instCode, IRObject* o1, IRObject* o2, IRReg* dst) noexcept {
+  bool isFetch = mpInstInfo[instCode & kInstCodeMask].isFetch();
+  if (o1 == nullptr || (!isFetch && o2 == nullptr))
+    return nullptr;
+
+  IRReg* like = mpGetDefReg(body[index]);
+  if (dst == nullptr) {
+    dst = _ir->newVar(like->getReg(), like->getWidth());
+    if (dst == nullptr)
+      return nullptr;
+  }
+
+  IRInst* inst = isFetch
+    ? _ir->newInst(instCode, dst, o1)
+    : _ir->newInst(instCode, dst, o1, o2);
+  if (inst == nullptr)
+    return nullptr;
+
+  if (body.insert(_heap, index, inst) != kErrorOk) {
+    _ir->deleteInst(inst);
+    return nullptr;
+  }
+
+  index++;
+  return dst;
+}
+
+IRImm* IRPassManager::_newImmInt(int32_t value) noexcept {
+  Value v;
+  v.zero();
+  v.i[0] = value;
+
+  IRImm* imm = _ir->newImm(v, IRReg::kKindNone, 4);
+  if (imm != nullptr)
+    imm->setTypeInfo(kTypeInt);
+  return imm;
+}
+
+Error IRPassManager::eliminateCommonSubexpressions(bool& changed) noexcept {
+  MPSL_PROPAGATE(updateDefs());
+
+  size_t i;
+  for (i = 1; i < _regData.getLength(); i++)
+    _regData[i].link = nullptr;
+
+  CSETable table(_heap);
+
+  _insts.truncate(0);
+  _cseScope.truncate(0);
+  _cseEpoch = 0;
+
+  Error err = _cseBlock(_rpo[0], table);
+
+  // Release nodes that remain in case of failure.
+  while (!_cseScope.isEmpty()) {
+    CSENode* node = _cseScope.pop();
+    table.del(node);
+    _heap->release(node, sizeof(CSENode));
+  }
+  MPSL_PROPAGATE(err);
+
+  if (_insts.isEmpty())
+    return kErrorOk;
+
+  applyReplacements();
+
+  for (i = 0; i < _insts.getLength(); i++)
+    _ir->deleteInst(_insts[i]);
+  _insts.truncate(0);
+
+  for (i = 0; i < _rpo.getLength(); i++)
+    _rpo[i]->fixupAfterNeutering();
+
+  changed = true;
+  return kErrorOk;
+}
+
+Error IRPassManager::_cseBlock(IRBlock* block, CSETable& table) noexcept {
   IRBody& body = block->getBody();
-  size_t i = body.getLength();
+  size_t scopeStart = _cseScope.getLength();
+
+  for (size_t i = 0; i < body.getLength(); i++) {
+    IRInst* inst = body[i];
+    const InstInfo& info = mpInstInfoOf(inst);
+
+    // Memory fetches are only reused within a block and only if there is no
+    // store in between (data pointers are allowed to alias).
+    if (info.isStore() || info.isCall()) {
+      _cseEpoch++;
+      continue;
+    }
+
+    IRReg* dst = mpGetDefReg(inst);
+    if (dst == nullptr || info.isPhi() || info.isMov() || (getRegData(dst).flags & kRegInMem))
+      continue;
+
+    // Use values that replace already eliminated instructions.
+    uint32_t opCount = inst->getOpCount();
+    for (uint32_t opIndex = 1; opIndex < opCount; opIndex++) {
+      IRObject* op = inst->getOperand(opIndex);
+      if (op->isReg()) {
+        IRReg* reg = _resolve(op->as<IRReg>());
+        if (reg != op)
+          setOperand(inst, opIndex, reg);
+      }
+    }
+
+    uint32_t hVal = mpHashInst(inst);
+    bool readsMemory = mpReadsMemory(inst);
+
+    CSENode* node = table.get(inst, hVal);
+    if (node != nullptr && (!readsMemory || (node->_block == block && node->_epoch == _cseEpoch))) {
+      getRegData(dst).link = mpGetDefReg(node->_inst);
+      block->neuterAt(i);
+      MPSL_PROPAGATE(_insts.append(_heap, inst));
+      continue;
+    }
+
+    void* p = _heap->alloc(sizeof(CSENode));
+    if (p == nullptr)
+      return MPSL_TRACE_ERROR(kErrorNoMemory);
+
+    node = new(p) CSENode(inst, hVal, block, _cseEpoch);
+    Error err = _cseScope.append(_heap, node);
+
+    if (err != kErrorOk) {
+      _heap->release(node, sizeof(CSENode));
+      return err;
+    }
+    table.put(node);
+  }
+
+  uint32_t id = block->getId();
+  for (uint32_t c = _domStart[id]; c < _domStart[id + 1]; c++)
+    MPSL_PROPAGATE(_cseBlock(_domChildren[c], table));
+
+  while (_cseScope.getLength() > scopeStart) {
+    CSENode* node = _cseScope.pop();
+    table.del(node);
+    _heap->release(node, sizeof(CSENode));
+  }
+
+  return kErrorOk;
+}
+
+Error IRPassManager::eliminateDeadCode(bool& changed) noexcept {
+  MPSL_PROPAGATE(updateDefs());
+
+  size_t i, j, count = _rpo.getLength();
+  for (i = 1; i < _regData.getLength(); i++)
+    _regData[i].flags &= ~kRegLive;
+
+  // Instructions that don't define a register (stores, jumps, calls, and
+  // returns) are live, instructions that define live registers are live.
+  _insts.truncate(0);
+  for (i = 0; i < count; i++) {
+    IRBody& body = _rpo[i]->getBody();
+
+    for (j = 0; j < body.getLength(); j++)
+      if (mpGetDefReg(body[j]) == nullptr)
+        MPSL_PROPAGATE(_insts.append(_heap, body[j]));
+  }
+
+  while (!_insts.isEmpty()) {
+    IRInst* inst = _insts.pop();
+    IRObject** opArray = inst->getOpArray();
+    uint32_t opCount = inst->getOpCount();
+
+    for (uint32_t opIndex = mpGetDefReg(inst) != nullptr; opIndex < opCount; opIndex++) {
+      IRObject* op = opArray[opIndex];
+      IRReg* regs[2] = { nullptr, nullptr };
+
+      if (op->isReg()) {
+        regs[0] = op->as<IRReg>();
+      }
+      else if (op->isMem()) {
+        regs[0] = op->as<IRMem>()->getBase();
+        regs[1] = op->as<IRMem>()->getIndex();
+      }
+
+      for (uint32_t k = 0; k < 2; k++) {
+        if (regs[k] == nullptr) continue;
+
+        RegData& rd = getRegData(regs[k]);
+        if (rd.flags & kRegLive) continue;
+
+        rd.flags |= kRegLive;
+        if (rd.def)
+          MPSL_PROPAGATE(_insts.append(_heap, rd.def));
+      }
+    }
+  }
+
+  for (i = 0; i < count; i++) {
+    IRBlock* block = _rpo[i];
+    IRBody& body = block->getBody();
+
+    for (j = 0; j < body.getLength(); j++) {
+      IRInst* inst = body[j];
+      IRReg* def = mpGetDefReg(inst);
+
+      if (def == nullptr || (getRegData(def).flags & kRegLive))
+        continue;
+
+      block->neuterAt(j);
+      _ir->deleteInst(inst);
+      changed = true;
+    }
+
+    block->fixupAfterNeutering();
+  }
+
+  return kErrorOk;
+}
+
+static MPSL_INLINE bool mpIsSpeculatable(const IRInst* inst) noexcept {
+  const InstInfo& info = mpInstInfoOf(inst);
+  if (info.isStore() || info.isJxx() || info.isCall() || info.isRet() || info.isPhi() || info.isComplex())
+    return false;
+
+  // Integer division traps if the divisor is zero, which the branch may guard.
+  uint32_t code = inst->getInstCode() & kInstCodeMask;
+  return code != kInstCodePdivsd && code != kInstCodePmodsd;
+}
+
+//! Get the index of a converted condition mask that `reg` is selected by.
+static MPSL_INLINE uint32_t mpGetMaskIndex(const IRReg* reg) noexcept {
+  if (reg->getReg() == IRReg::kKindGp)
+    return 0;
+
+  switch (reg->getWidth()) {
+    case  4: return 1;
+    case  8: return 2;
+    case 16: return 3;
+
+    default:
+      return 4;
+  }
+}
+
+bool IRPassManager::_isMask(IRReg* reg, uint32_t depth) noexcept {
+  IRInst* def = getRegData(reg).def;
+  if (def == nullptr)
+    return false;
+
+  uint32_t code = def->getInstCode() & kInstCodeMask;
+  if ((code >= kInstCodeCmpeqf  && code <= kInstCodeCmpged) ||
+      (code >= kInstCodePcmpeqb && code <= kInstCodePcmpged))
+    return true;
+
+  if (depth == 0)
+    return false;
+
+  switch (code) {
+    case kInstCodeMov32:
+    case kInstCodeBitnegi:
+    case kInstCodeBitnegf:
+    case kInstCodeBitnegd: {
+      IRObject* op = def->getOperand(1);
+      return op->isReg() && _isMask(op->as<IRReg>(), depth - 1);
+    }
+
+    case kInstCodeAndi: case kInstCodeAndf: case kInstCodeAndd:
+    case kInstCodeOri : case kInstCodeOrf : case kInstCodeOrd :
+    case kInstCodeXori: case kInstCodeXorf: case kInstCodeXord: {
+      IRObject* a = def->getOperand(1);
+      IRObject* b = def->getOperand(2);
+      return a->isReg() && _isMask(a->as<IRReg>(), depth - 1) &&
+             b->isReg() && _isMask(b->as<IRReg>(), depth - 1);
+    }
+
+    default:
+      return false;
+  }
+}
+
+Error IRPassManager::convertBranches(bool& changed) noexcept {
+  MPSL_PROPAGATE(updateDefs());
+
+  // Arms of converted branches are removed from `_rpo`, which is recomputed
+  // by the caller.
+  for (size_t i = 0; i < _rpo.getLength(); i++) {
+    IRBlock* block = _rpo[i];
+    if (block != nullptr)
+      MPSL_PROPAGATE(_convertBranch(block, changed));
+  }
+
+  return kErrorOk;
+}
+
+// Converts the following shapes, `Then` or `Else` can be missing, in which
+// case `Head` jumps directly to `Join`:
+//
+//   [Head] -> jnz cond, Then, Else
+//   [Then] -> jmp Join
+//   [Else] -> jmp Join
+//   [Join] -> phi(a, b), ...
+//
+// Instructions of both arms are moved to `Head`, which then computes each phi
+// as `select cond, a, b` and jumps to `Join`. Arms are executed unconditionally
+// so they can't have side effects.
+Error IRPassManager::_convertBranch(IRBlock* head, bool& changed) noexcept {
+  IRBody& headBody = head->getBody();
+  if (headBody.isEmpty())
+    return kErrorOk;
+
+  IRInst* jnz = headBody.getLast();
+  if (jnz->getInstCode() != kInstCodeJnz || !jnz->getOperand(0)->isReg())
+    return kErrorOk;
+
+  IRReg* cond = jnz->getOperand(0)->as<IRReg>();
+  if (!_isMask(cond, kMaxMaskDepth))
+    return kErrorOk;
+
+  IRBlock* targets[2] = { jnz->getOperand(1)->as<IRBlock>(), jnz->getOperand(2)->as<IRBlock>() };
+  IRBlock* arms[2] = { nullptr, nullptr };
+  IRBlock* join = nullptr;
+
+  // An arm has a single instruction `jmp Join`, its join is the other target
+  // if the other target is not an arm.
+  for (uint32_t k = 0; k < 2; k++) {
+    IRBlock* arm = targets[k];
+    IRBody& body = arm->getBody();
+
+    if (arm == head || arm->getPredecessors().getLength() != 1 || arm->getSuccessors().getLength() != 1 ||
+        body.isEmpty() || body.getLast()->getInstCode() != kInstCodeJmp)
+      continue;
+
+    arms[k] = arm;
+  }
+
+  if (arms[0] && arms[1] && arms[0]->getSuccessors()[0] == arms[1]->getSuccessors()[0])
+    join = arms[0]->getSuccessors()[0];
+  else if (arms[0] && arms[0]->getSuccessors()[0] == targets[1])
+    join = targets[1], arms[1] = nullptr;
+  else if (arms[1] && arms[1]->getSuccessors()[0] == targets[0])
+    join = targets[0], arms[0] = nullptr;
+  else
+    return kErrorOk;
+
+  // The join must only be reached through the branch, each phi then has one
+  // operand for each path.
+  IRBlocks& joinPreds = join->getPredecessors();
+  if (join == head || joinPreds.getLength() != 2)
+    return kErrorOk;
+
+  uint32_t predIndex[2];
+  size_t numInsts = 0;
+
+  for (uint32_t k = 0; k < 2; k++) {
+    IRBlock* pred = arms[k] ? arms[k] : head;
+    size_t index = joinPreds.indexOf(pred);
+
+    if (index == Globals::kInvalidIndex)
+      return kErrorOk;
+    predIndex[k] = static_cast<uint32_t>(index);
+
+    if (arms[k] == nullptr)
+      continue;
+
+    IRBody& body = arms[k]->getBody();
+    numInsts += body.getLength() - 1;
+
+    for (size_t j = 0; j + 1 < body.getLength(); j++)
+      if (!mpIsSpeculatable(body[j]))
+        return kErrorOk;
+  }
+
+  if (predIndex[0] == predIndex[1] || numInsts > kMaxConvertedSize)
+    return kErrorOk;
+
+  // Selects of GP registers use a GP mask and selects of vector registers use
+  // the condition broadcast to all elements, each converted mask is created
+  // once, see `mpGetMaskIndex()`.
+  IRBody& joinBody = join->getBody();
+  size_t numPhis = 0;
+
+  while (numPhis < joinBody.getLength() && mpInstInfoOf(joinBody[numPhis]).isPhi()) {
+    IRReg* dst = joinBody[numPhis]->getOperand(0)->as<IRReg>();
+    uint32_t width = dst->getWidth();
+
+    if (dst->getReg() == IRReg::kKindGp ? width != 4 : (width != 4 && width != 8 && width != 16 && width != 32))
+      return kErrorOk;
+    numPhis++;
+  }
+
+  // The head jumps directly to the join from now on.
+  headBody.pop();
+  _ir->deleteInst(jnz);
+
+  for (uint32_t k = 0; k < 2; k++) {
+    IRBlock* arm = arms[k];
+    if (arm == nullptr)
+      continue;
+
+    IRBody& body = arm->getBody();
+    size_t len = body.getLength();
+
+    MPSL_PROPAGATE(headBody.willGrow(_heap, len - 1));
+    for (size_t j = 0; j + 1 < len; j++)
+      headBody.appendUnsafe(body[j]);
+
+    _ir->deleteInst(body[len - 1]);
+    body.truncate(0);
+  }
+
+  IRReg* masks[5] = { nullptr };
+  for (size_t j = 0; j < numPhis; j++) {
+    IRInst* phi = joinBody[j];
+    IRReg* dst = phi->getOperand(0)->as<IRReg>();
+
+    uint32_t width = dst->getWidth();
+    uint32_t maskIndex = mpGetMaskIndex(dst);
+    IRReg* mask = masks[maskIndex];
 
-  while (i != 0) {
-    IRInst* inst = body[--i];
-    if (inst) {
-      // TODO: Just testing some concepts.
-      const InstInfo& info = mpInstInfo[inst->getInstCode() & kInstCodeMask];
-      if (!info.isStore() && !info.isCall() && !info.isRet()) {
-        IRObject** opArray = inst->getOpArray();
-        uint32_t opCount = inst->getOpCount();
+    if (mask == nullptr) {
+      mask = cond;
+
+      if (mask->getReg() != dst->getReg()) {
+        mask = _ir->newVar(dst->getReg(), 4);
+        MPSL_NULLCHECK(mask);
+        MPSL_PROPAGATE(_ir->emitInst(head, kInstCodeFetch32, mask, cond));
+      }
+
+      // The condition is only defined by its first element.
+      if (width > 4) {
+        Value shufValue;
+        shufValue.q.set(0);
+
+        IRImm* shufImm = _ir->newImm(shufValue, IRReg::kKindNone, 4);
+        MPSL_NULLCHECK(shufImm);
+
+        IRReg* scalar = mask;
+        mask = _ir->newVar(IRReg::kKindVec, width < 16 ? 16 : width);
+        MPSL_NULLCHECK(mask);
+        MPSL_PROPAGATE(_ir->emitInst(head, kInstCodePshufd | (width > 16 ? kInstVec256 : kInstVec128), mask, scalar, shufImm));
+      }
+
+      masks[maskIndex] = mask;
+    }
+
+    uint32_t selectCode = kInstCodeSelecti;
+    if (dst->getReg() == IRReg::kKindVec)
+      selectCode = kInstCodeSelectf | (width > 16 ? kInstVec256 : width > 4 ? kInstVec128 : kInstVec0);
+
+    IRInst* select = _ir->newInst(selectCode, dst, mask,
+      phi->getOperand(predIndex[0] + 1), phi->getOperand(predIndex[1] + 1));
+    MPSL_NULLCHECK(select);
+    MPSL_PROPAGATE(head->append(select));
+
+    join->neuterAt(j);
+    _ir->deleteInst(phi);
+  }
+  join->fixupAfterNeutering();
+
+  MPSL_PROPAGATE(_ir->emitInst(head, kInstCodeJmp, join));
+
+  head->getSuccessors().truncate(0);
+  joinPreds.truncate(0);
+  MPSL_PROPAGATE(_ir->connectBlocks(head, join));
+
+  for (uint32_t k = 0; k < 2; k++) {
+    IRBlock* arm = arms[k];
+    if (arm == nullptr)
+      continue;
+
+    _rpo[_rpoIndex[arm->getId()]] = nullptr;
+    _ir->deleteObject(arm);
+  }
+
+  changed = true;
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::IRPassManager - Liveness]
+// ============================================================================
+
+static MPSL_INLINE bool mpIsMove(const IRInst* inst) noexcept {
+  uint32_t code = inst->getInstCode() & kInstCodeMask;
+  return code == kInstCodeMov32  || code == kInstCodeMov64 ||
+         code == kInstCodeMov128 || code == kInstCodeMov256;
+}
+
+//! Get whether `inst` only modifies a part of its destination (also a use).
+static MPSL_INLINE bool mpIsPartialDef(const IRInst* inst) noexcept {
+  uint32_t code = inst->getInstCode() & kInstCodeMask;
+  return code == kInstCodeInsert32 || code == kInstCodeInsert64;
+}
+
+static MPSL_INLINE bool mpBitTest(const uint32_t* bits, uint32_t index) noexcept {
+  return (bits[index / 32] & (1U << (index % 32))) != 0;
+}
+
+void IRPassManager::_stepBack(IRInst* inst, uint32_t* live, uint32_t* count) noexcept {
+  IRReg* def = mpGetDefReg(inst);
+  bool fullDef = def != nullptr && !mpIsPartialDef(inst);
+
+  if (fullDef) {
+    uint32_t id = def->getId();
+    uint32_t mask = 1U << (id % 32);
+
+    getRegData(def).reg = def;
+    if (live[id / 32] & mask) {
+      live[id / 32] &= ~mask;
+      if (count) count[def->getReg()]--;
+    }
+  }
+
+  IRObject** opArray = inst->getOpArray();
+  uint32_t opCount = inst->getOpCount();
+
+  for (uint32_t opIndex = fullDef; opIndex < opCount; opIndex++) {
+    IRObject* op = opArray[opIndex];
+    IRReg* regs[2] = { nullptr, nullptr };
+
+    if (op->isReg()) {
+      regs[0] = op->as<IRReg>();
+    }
+    else if (op->isMem()) {
+      regs[0] = op->as<IRMem>()->getBase();
+      regs[1] = op->as<IRMem>()->getIndex();
+    }
+
+    for (uint32_t k = 0; k < 2; k++) {
+      IRReg* reg = regs[k];
+      if (reg == nullptr) continue;
+
+      uint32_t id = reg->getId();
+      uint32_t mask = 1U << (id % 32);
+
+      getRegData(reg).reg = reg;
+      if ((live[id / 32] & mask) == 0) {
+        live[id / 32] |= mask;
+        if (count) count[reg->getReg()]++;
+      }
+    }
+  }
+}
+
+Error IRPassManager::computeLiveness() noexcept {
+  MPSL_PROPAGATE(updateRegData());
+
+  size_t i, count = _rpo.getLength();
+  uint32_t numWords = static_cast<uint32_t>((_regData.getLength() + 31) / 32);
+  size_t numBlocks = static_cast<size_t>(_ir->_blockIdGen) + 1;
+
+  _liveWords = numWords;
+  MPSL_PROPAGATE(mpInitVector<uint32_t>(_heap, _liveBits, numBlocks * 4 * numWords, 0));
+  MPSL_PROPAGATE(mpInitVector<uint32_t>(_heap, _live, numWords, 0));
+
+  // Registers used before they are defined (gen) and defined (kill) by each
+  // block, gen is what remains live after walking the block backwards.
+  for (i = 0; i < count; i++) {
+    IRBlock* block = _rpo[i];
+    IRBody& body = block->getBody();
+
+    uint32_t* gen = _liveSet(block, 2);
+    uint32_t* kill = _liveSet(block, 3);
+
+    for (size_t j = body.getLength(); j != 0; j--) {
+      IRInst* inst = body[j - 1];
+      IRReg* def = mpGetDefReg(inst);
+
+      if (def) {
+        uint32_t id = def->getId();
+        kill[id / 32] |= 1U << (id % 32);
+      }
+      _stepBack(inst, gen, nullptr);
+    }
+  }
+
+  // Backward data-flow, visiting blocks in post-order converges quickly.
+  bool changed;
+  do {
+    changed = false;
+
+    for (i = count; i != 0; i--) {
+      IRBlock* block = _rpo[i - 1];
+      IRBlocks& successors = block->getSuccessors();
+
+      uint32_t* in = _liveSet(block, 0);
+      uint32_t* out = _liveSet(block, 1);
+      uint32_t* gen = _liveSet(block, 2);
+      uint32_t* kill = _liveSet(block, 3);
+
+      for (size_t j = 0; j < successors.getLength(); j++) {
+        uint32_t* succIn = _liveSet(successors[j], 0);
+        for (uint32_t w = 0; w < numWords; w++)
+          out[w] |= succIn[w];
+      }
+
+      for (uint32_t w = 0; w < numWords; w++) {
+        uint32_t bits = gen[w] | (out[w] & ~kill[w]);
+        if (bits != in[w]) {
+          in[w] = bits;
+          changed = true;
+        }
+      }
+    }
+  } while (changed);
+
+  return kErrorOk;
+}
+
+Error IRPassManager::coalesceMoves(bool& changed) noexcept {
+  MPSL_PROPAGATE(scanDefs());
+  MPSL_PROPAGATE(computeLiveness());
+
+  size_t i, j, count = _rpo.getLength();
+  uint32_t numWords = _liveWords;
+  uint32_t numMoves = 0;
+
+  // Pick moves between registers of the same kind and width. A register used
+  // by a memory operand must stay a GP register of the pointer width and is
+  // never merged, this also keeps data pointers and the lane index intact.
+  for (i = 0; i < count; i++) {
+    IRBody& body = _rpo[i]->getBody();
+
+    for (j = 0; j < body.getLength(); j++) {
+      IRInst* inst = body[j];
+      if (!mpIsMove(inst) || !inst->getOperand(1)->isReg())
+        continue;
+
+      IRReg* dst = inst->getOperand(0)->as<IRReg>();
+      IRReg* src = inst->getOperand(1)->as<IRReg>();
+
+      if (dst == src || dst->getReg() != src->getReg() || dst->getWidth() != src->getWidth())
+        continue;
+
+      RegData& dstData = getRegData(dst);
+      RegData& srcData = getRegData(src);
+
+      if (((dstData.flags | srcData.flags) & (kRegInMem | kRegMoved)) != 0)
+        continue;
+
+      dstData.flags |= kRegMoved;
+      dstData.move = inst;
+      srcData.flags |= kRegMoved;
+      srcData.move = inst;
+      numMoves++;
+    }
+  }
+
+  if (numMoves == 0)
+    return kErrorOk;
 
-        IRObject* dst = opArray[0];
-        if (dst->isReg() && dst->getRefCount() == 1) {
-          block->neuterAt(i);
-          ir->deleteInst(inst);
+  // Registers of a move interfere if one of them is defined while the other
+  // one is live, except by the move itself.
+  uint32_t* live = _live.getData();
+  for (i = 0; i < count; i++) {
+    IRBlock* block = _rpo[i];
+    IRBody& body = block->getBody();
+
+    ::memcpy(live, _liveSet(block, 1), numWords * sizeof(uint32_t));
+    for (j = body.getLength(); j != 0; j--) {
+      IRInst* inst = body[j - 1];
+      IRReg* def = mpGetDefReg(inst);
+
+      if (def) {
+        RegData& rd = getRegData(def);
+        IRInst* move = rd.move;
+
+        if ((rd.flags & kRegMoved) && move != inst) {
+          IRReg* dst = move->getOperand(0)->as<IRReg>();
+          IRReg* other = def == dst ? move->getOperand(1)->as<IRReg>() : dst;
+
+          if (mpBitTest(live, other->getId()))
+            getRegData(dst).flags |= kRegInterfere;
         }
       }
+
+      _stepBack(inst, live, nullptr);
+    }
+  }
+
+  // Rename destinations of moves that can be coalesced to their sources and
+  // remove the moves, which became `mov src, src`.
+  for (i = 1; i < _regData.getLength(); i++) {
+    RegData& rd = _regData[i];
+    if ((rd.flags & (kRegMoved | kRegInterfere)) != kRegMoved || rd.move->getOperand(0) != rd.reg)
+      continue;
+
+    rd.link = rd.move->getOperand(1)->as<IRReg>();
+  }
+
+  for (i = 0; i < count; i++) {
+    IRBlock* block = _rpo[i];
+    IRBody& body = block->getBody();
+
+    for (j = 0; j < body.getLength(); j++) {
+      IRInst* inst = body[j];
+      IRObject** opArray = inst->getOpArray();
+      uint32_t opCount = inst->getOpCount();
+
+      for (uint32_t opIndex = 0; opIndex < opCount; opIndex++) {
+        IRObject* op = opArray[opIndex];
+        if (!op->isReg()) continue;
+
+        IRReg* link = getRegData(op->as<IRReg>()).link;
+        if (link)
+          setOperand(inst, opIndex, link);
+      }
+
+      if (mpIsMove(inst) && inst->getOperand(0) == inst->getOperand(1)) {
+        block->neuterAt(j);
+        _ir->deleteInst(inst);
+        changed = true;
+      }
+    }
+
+    block->fixupAfterNeutering();
+  }
+
+  return kErrorOk;
+}
+
+Error IRPassManager::measurePressure() noexcept {
+  uint32_t maxLive[IRReg::kKindCount] = { 0 };
+
+  // The CFG is not analyzed without optimizations, all blocks are compiled.
+  if (_rpo.isEmpty()) {
+    IRBlocks& blocks = _ir->getBlocks();
+    for (size_t i = 0; i < blocks.getLength(); i++)
+      if (blocks[i] != nullptr)
+        MPSL_PROPAGATE(_rpo.append(_heap, blocks[i]));
+  }
+
+  MPSL_PROPAGATE(computeLiveness());
+
+  size_t i, count = _rpo.getLength();
+  uint32_t numWords = _liveWords;
+  uint32_t* live = _live.getData();
+
+  for (i = 0; i < count; i++) {
+    IRBlock* block = _rpo[i];
+    IRBody& body = block->getBody();
+    uint32_t liveCount[IRReg::kKindCount] = { 0 };
+
+    ::memcpy(live, _liveSet(block, 1), numWords * sizeof(uint32_t));
+    for (uint32_t id = 0; id < numWords * 32; id++) {
+      if (mpBitTest(live, id))
+        liveCount[_regData[id].reg->getReg()]++;
+    }
+
+    for (size_t j = body.getLength(); j != 0; j--) {
+      for (uint32_t k = 0; k < IRReg::kKindCount; k++)
+        if (liveCount[k] > maxLive[k]) maxLive[k] = liveCount[k];
+      _stepBack(body[j - 1], live, liveCount);
     }
+
+    for (uint32_t k = 0; k < IRReg::kKindCount; k++)
+      if (liveCount[k] > maxLive[k]) maxLive[k] = liveCount[k];
   }
 
-  block->fixupAfterNeutering();
+  for (uint32_t k = 0; k < IRReg::kKindCount; k++)
+    _ir->_maxLive[k] = maxLive[k];
   return kErrorOk;
 }
 
-Error mpIRPass(IRBuilder* ir) noexcept {
-  IRBlocks& blocks = ir->getBlocks();
-  size_t count = blocks.getLength();
+// ============================================================================
+// [mpsl::IRPassManager - Fast Math]
+// ============================================================================
+
+Error IRPassManager::replaceDivisions(bool& changed) noexcept {
+  MPSL_PROPAGATE(updateDefs());
+  size_t count = _rpo.getLength();
 
   for (size_t i = 0; i < count; i++) {
-    IRBlock* block = blocks[i];
-    MPSL_PROPAGATE(mpIRPassBlock(ir, block));
+    IRBody& body = _rpo[i]->getBody();
+
+    for (size_t j = 0; j < body.getLength(); j++) {
+      IRInst* inst = body[j];
+      uint32_t instCode = inst->getInstCode();
+      uint32_t code = instCode & kInstCodeMask;
+
+      if (code != kInstCodeDivf && code != kInstCodeDivd)
+        continue;
+
+      IRReg* dst = mpGetDefReg(inst);
+      uint32_t fetchCode = mpFetchByWidth(dst->getWidth());
+
+      Value value;
+      if (fetchCode == kInstCodeNone || !getConstant(inst->getOperand(2), value))
+        continue;
+
+      // Keep the division if the reciprocal of any element is not finite.
+      Value rcp;
+      bool isFinite = true;
+
+      rcp.zero();
+      if (code == kInstCodeDivf) {
+        for (uint32_t k = 0, n = dst->getWidth() / 4; k < n; k++) {
+          rcp.f[k] = 1.0f / value.f[k];
+          isFinite &= mpIsFiniteF(rcp.f[k]);
+        }
+      }
+      else {
+        for (uint32_t k = 0, n = dst->getWidth() / 8; k < n; k++) {
+          rcp.d[k] = 1.0 / value.d[k];
+          isFinite &= mpIsFiniteD(rcp.d[k]);
+        }
+      }
+
+      if (!isFinite)
+        continue;
+
+      IRImm* imm = _ir->newImm(rcp, dst->getReg(), dst->getWidth());
+      MPSL_NULLCHECK(imm);
+      imm->setTypeInfo(mpGetFoldedTypeInfo(mpInstInfoOf(inst), dst->getWidth()));
+
+      IRReg* tmp = _ir->newVar(dst->getReg(), dst->getWidth());
+      MPSL_NULLCHECK(tmp);
+
+      IRInst* fetch = _ir->newInst(fetchCode, tmp, imm);
+      MPSL_NULLCHECK(fetch);
+
+      uint32_t mulCode = (code == kInstCodeDivf ? kInstCodeMulf : kInstCodeMuld) | (instCode & kInstVecMask);
+      IRInst* mul = _ir->newInst(mulCode, dst, inst->getOperand(1), tmp);
+
+      if (mul == nullptr) {
+        _ir->deleteInst(fetch);
+        return MPSL_TRACE_ERROR(kErrorNoMemory);
+      }
+
+      body[j] = mul;
+      _ir->deleteInst(inst);
+      MPSL_PROPAGATE(body.insert(_heap, j++, fetch));
+      changed = true;
+    }
+  }
+
+  return updateRegData();
+}
+
+static MPSL_INLINE bool mpIsReassociable(uint32_t code) noexcept {
+  return code == kInstCodeAddf || code == kInstCodeAddd ||
+         code == kInstCodeMulf || code == kInstCodeMuld ;
+}
+
+bool IRPassManager::_collectLeaves(IRInst* inst, IRBlock* block, IRObject** leaves, uint32_t& count, uint32_t& depth) noexcept {
+  uint32_t maxDepth = 0;
+
+  for (uint32_t opIndex = 1; opIndex < 3; opIndex++) {
+    IRObject* op = inst->getOperand(opIndex);
+    uint32_t opDepth = 0;
+
+    // Memory can be clobbered by a store that precedes the root.
+    if (op->isMem())
+      return false;
+
+    if (op->isReg() && op->getRefCount() == 2 && count + 2 <= kMaxReassociatedLeaves) {
+      RegData& rd = getRegData(op->as<IRReg>());
+
+      if (rd.def != nullptr && rd.block == block && rd.def->getInstCode() == inst->getInstCode()) {
+        if (!_collectLeaves(rd.def, block, leaves, count, opDepth))
+          return false;
+
+        rd.flags |= kRegVisited;
+        maxDepth = mpMax(maxDepth, opDepth);
+        continue;
+      }
+    }
+
+    if (count >= kMaxReassociatedLeaves)
+      return false;
+    leaves[count++] = op;
+  }
+
+  depth = maxDepth + 1;
+  return true;
+}
+
+Error IRPassManager::reassociate(bool& changed) noexcept {
+  MPSL_PROPAGATE(updateDefs());
+
+  size_t i, count = _rpo.getLength();
+  for (i = 1; i < _regData.getLength(); i++)
+    _regData[i].flags &= ~kRegVisited;
+
+  for (i = 0; i < count; i++) {
+    IRBlock* block = _rpo[i];
+    IRBody& body = block->getBody();
+
+    // Roots are visited before the instructions that compute their operands,
+    // these are marked as visited by `_collectLeaves()`.
+    size_t j = body.getLength();
+    while (j != 0) {
+      IRInst* inst = body[--j];
+      uint32_t instCode = inst->getInstCode();
+
+      if (!mpIsReassociable(instCode & kInstCodeMask))
+        continue;
+
+      IRReg* dst = mpGetDefReg(inst);
+      if (getRegData(dst).flags & kRegVisited)
+        continue;
+
+      IRObject* leaves[kMaxReassociatedLeaves];
+      uint32_t numLeaves = 0;
+      uint32_t depth = 0;
+
+      if (!_collectLeaves(inst, block, leaves, numLeaves, depth))
+        continue;
+
+      // Nothing to gain if the tree is already balanced.
+      uint32_t minDepth = 0;
+      while ((1U << minDepth) < numLeaves)
+        minDepth++;
+
+      if (depth <= minDepth)
+        continue;
+
+      // Combine adjacent pairs until two operands remain, these are used by
+      // the root, which keeps its destination. The old tree becomes dead.
+      size_t index = j;
+      while (numLeaves > 2) {
+        uint32_t k = 0, n = 0;
+
+        for (; k + 1 < numLeaves; k += 2) {
+          IRReg* tmp = _ir->newVar(dst->getReg(), dst->getWidth());
+          MPSL_NULLCHECK(tmp);
+
+          IRInst* pair = _ir->newInst(instCode, tmp, leaves[k], leaves[k + 1]);
+          MPSL_NULLCHECK(pair);
+
+          MPSL_PROPAGATE(body.insert(_heap, index++, pair));
+          leaves[n++] = tmp;
+        }
+
+        if (k < numLeaves)
+          leaves[n++] = leaves[k];
+        numLeaves = n;
+      }
+
+      setOperand(inst, 1, leaves[0]);
+      setOperand(inst, 2, leaves[1]);
+      changed = true;
+    }
+  }
+
+  return updateRegData();
+}
+
+Error IRPassManager::contractMulAdd(bool& changed) noexcept {
+  MPSL_PROPAGATE(updateDefs());
+  size_t count = _rpo.getLength();
+
+  for (size_t i = 0; i < count; i++) {
+    IRBody& body = _rpo[i]->getBody();
+
+    for (size_t j = 0; j < body.getLength(); j++) {
+      IRInst* inst = body[j];
+      uint32_t instCode = inst->getInstCode();
+      uint32_t vecFlags = instCode & kInstVecMask;
+
+      uint32_t mulCode, fmaCode;
+      switch (instCode & kInstCodeMask) {
+        case kInstCodeAddf: mulCode = kInstCodeMulf; fmaCode = kInstCodeFmaddf; break;
+        case kInstCodeAddd: mulCode = kInstCodeMuld; fmaCode = kInstCodeFmaddd; break;
+
+        default:
+          continue;
+      }
+
+      for (uint32_t opIndex = 1; opIndex < 3; opIndex++) {
+        IRObject* op = inst->getOperand(opIndex);
+        IRObject* addend = inst->getOperand(3 - opIndex);
+
+        // The multiplication must become dead, its operands are read by the
+        // FMA instead, which is only safe if they are not in memory.
+        if (!op->isReg() || op->getRefCount() != 2 || addend->isMem())
+          continue;
+
+        IRInst* mul = getRegData(op->as<IRReg>()).def;
+        if (mul == nullptr || mul->getInstCode() != (mulCode | vecFlags) ||
+            mul->getOperand(1)->isMem() || mul->getOperand(2)->isMem())
+          continue;
+
+        IRReg* dst = mpGetDefReg(inst);
+        IRInst* fma = _ir->newInst(fmaCode | vecFlags, dst, mul->getOperand(1), mul->getOperand(2), addend);
+        MPSL_NULLCHECK(fma);
+
+        body[j] = fma;
+        _ir->deleteInst(inst);
+
+        getRegData(dst).def = fma;
+        changed = true;
+        break;
+      }
+    }
+  }
+
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::IRPassManager - Utilities]
+// ============================================================================
+
+Error IRPassManager::updateRegData() noexcept {
+  size_t count = static_cast<size_t>(_ir->_varIdGen) + 1;
+  size_t length = _regData.getLength();
+
+  if (length >= count)
+    return kErrorOk;
+
+  MPSL_PROPAGATE(_regData.willGrow(_heap, count - length));
+
+  RegData rd;
+  ::memset(&rd, 0, sizeof(RegData));
+
+  while (length < count) {
+    _regData.appendUnsafe(rd);
+    length++;
+  }
+
+  return kErrorOk;
+}
+
+Error IRPassManager::updateDefs() noexcept {
+  MPSL_PROPAGATE(updateRegData());
+
+  size_t i, count = _rpo.getLength();
+  for (i = 1; i < _regData.getLength(); i++) {
+    _regData[i].def = nullptr;
+    _regData[i].block = nullptr;
+  }
+
+  for (i = 0; i < count; i++) {
+    IRBlock* block = _rpo[i];
+    IRBody& body = block->getBody();
+
+    for (size_t j = 0; j < body.getLength(); j++) {
+      IRReg* def = mpGetDefReg(body[j]);
+      if (def) {
+        RegData& rd = getRegData(def);
+        rd.reg = def;
+        rd.def = body[j];
+        rd.block = block;
+      }
+    }
+  }
+
+  return kErrorOk;
+}
+
+Error IRPassManager::resetRegData() noexcept {
+  MPSL_PROPAGATE(updateRegData());
+
+  size_t count = _regData.getLength();
+  if (count != 0)
+    ::memset(_regData.getData(), 0, count * sizeof(RegData));
+
+  return kErrorOk;
+}
+
+Error IRPassManager::scanDefs() noexcept {
+  MPSL_PROPAGATE(resetRegData());
+  size_t count = _rpo.getLength();
+
+  for (size_t i = 0; i < count; i++) {
+    IRBlock* block = _rpo[i];
+    IRBody& body = block->getBody();
+
+    for (size_t j = 0; j < body.getLength(); j++) {
+      IRInst* inst = body[j];
+      IRObject** opArray = inst->getOpArray();
+      uint32_t opCount = inst->getOpCount();
+
+      for (uint32_t opIndex = 0; opIndex < opCount; opIndex++) {
+        IRObject* op = opArray[opIndex];
+        if (!op->isMem()) continue;
+
+        IRMem* mem = op->as<IRMem>();
+        if (mem->hasBase()) getRegData(mem->getBase()).flags |= kRegInMem;
+        if (mem->hasIndex()) getRegData(mem->getIndex()).flags |= kRegInMem;
+      }
+
+      IRReg* def = mpGetDefReg(inst);
+      if (def) {
+        RegData& rd = getRegData(def);
+        rd.reg = def;
+        rd.def = inst;
+        rd.block = block;
+        rd.defCount++;
+      }
+    }
   }
 
   return kErrorOk;
 }
 
+void IRPassManager::applyReplacements() noexcept {
+  size_t count = _rpo.getLength();
+
+  for (size_t i = 0; i < count; i++) {
+    IRBody& body = _rpo[i]->getBody();
+
+    for (size_t j = 0; j < body.getLength(); j++) {
+      IRInst* inst = body[j];
+      if (inst == nullptr) continue;
+
+      IRObject** opArray = inst->getOpArray();
+      uint32_t opCount = inst->getOpCount();
+
+      for (uint32_t opIndex = mpGetDefReg(inst) != nullptr; opIndex < opCount; opIndex++) {
+        IRObject* op = opArray[opIndex];
+        if (!op->isReg()) continue;
+
+        IRReg* reg = _resolve(op->as<IRReg>());
+        if (reg != op)
+          setOperand(inst, opIndex, reg);
+      }
+    }
+  }
+}
+
+bool IRPassManager::getConstant(IRObject* obj, Value& out) noexcept {
+  out.zero();
+
+  if (obj->isImm()) {
+    out = obj->as<IRImm>()->getValue();
+    return true;
+  }
+
+  if (!obj->isReg())
+    return false;
+
+  IRInst* def = getRegData(obj->as<IRReg>()).def;
+  if (def == nullptr)
+    return false;
+
+  uint32_t size = mpFetchSize(def->getInstCode() & kInstCodeMask);
+  IRObject* src = def->getOperand(1);
+
+  if (size == 0 || !src->isImm())
+    return false;
+
+  // Fetch zero extends, bytes it doesn't read are zero.
+  ::memcpy(&out, &src->as<IRImm>()->getValue(), size);
+  return true;
+}
+
+bool IRPassManager::getUniqueConstant(IRObject* obj, Value& out) noexcept {
+  if (obj->isReg() && getRegData(obj->as<IRReg>()).defCount != 1)
+    return false;
+  return getConstant(obj, out);
+}
+
+void IRPassManager::setOperand(IRInst* inst, uint32_t index, IRObject* obj) noexcept {
+  IRObject** opArray = inst->getOpArray();
+  IRObject* old = opArray[index];
+
+  obj->addRef();
+  opArray[index] = obj;
+  _ir->derefObject(old);
+}
+
+// ============================================================================
+// [mpsl::mpIRPass]
+// ============================================================================
+
+Error mpIRPass(IRBuilder* ir, uint32_t optLevel, uint32_t unrollLimit, uint32_t flags) noexcept {
+  IRPassManager pm(ir, optLevel, unrollLimit, flags);
+  MPSL_PROPAGATE(pm.run());
+  return pm.measurePressure();
+}
+
 } // mpsl namespace
 
 // [Api-End]
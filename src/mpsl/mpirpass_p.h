@@ -17,7 +17,360 @@
 
 namespace mpsl {
 
-Error mpIRPass(IRBuilder* ir) noexcept;
+// ============================================================================
+// [mpsl::IROptLevel]
+// ============================================================================
+
+//! \internal
+//!
+//! Optimization level of IR passes, selected by `kOptionOpt...` options.
+enum IROptLevel {
+  //! No IR optimizations, the IR is compiled as generated.
+  kIROptLevelNone = 0,
+  //! SSA form, copy propagation, constant folding, strength reduction, dead
+  //! code elimination, and conversion of small branches to selects.
+  kIROptLevelBasic = 1,
+  //! Everything in `kIROptLevelBasic`, common subexpression elimination, loop
+  //! unrolling, and loop-invariant code motion.
+  kIROptLevelFull = 2
+};
+
+//! \internal
+//!
+//! Get the IR optimization level from compilation `options`.
+static MPSL_INLINE uint32_t mpIROptLevelFromOptions(uint32_t options) noexcept {
+  switch (options & kOptionOptLevelMask) {
+    case kOptionOptFull : return kIROptLevelFull;
+    case kOptionOptBasic: return kIROptLevelBasic;
+    default:
+      return kIROptLevelNone;
+  }
+}
+
+//! \internal
+//!
+//! Flags of IR passes.
+enum IRPassFlags {
+  //! Allow optimizations that don't preserve IEEE results, see `kOptionFastMath`.
+  kIRPassFastMath = 0x01,
+  //! The backend has fused multiply-add (\ref kInstCodeFmaddf and \ref kInstCodeFmaddd).
+  kIRPassFMA = 0x02
+};
+
+// ============================================================================
+// [mpsl::IRPassManager]
+// ============================================================================
+
+//! \internal
+//!
+//! Runs IR analyses and optimization passes.
+//!
+//! The IR is translated to SSA form first (phi nodes are placed by using
+//! dominance frontiers), then all passes enabled by the optimization level
+//! run until none of them changes the IR, and the IR is translated back by
+//! replacing each phi by moves at the end of its predecessors. Loops with a
+//! trip count known at compile time are unrolled before the translation.
+//! Moves are coalesced last, registers connected by a move share a single
+//! register if their live ranges don't overlap, so the backend's register
+//! allocator sees fewer (but longer) live ranges and less copies.
+//! Floating-point passes enabled by `kIRPassFastMath` run on the optimized
+//! SSA form, before it's translated back.
+//!
+//! All per-block data is indexed by block ID and all per-register data by
+//! register ID, see `IRObject::getId()`.
+class IRPassManager {
+public:
+  MPSL_NONCOPYABLE(IRPassManager)
+
+  enum {
+    //! Maximum number of iterations of all passes.
+    kMaxIterations = 4,
+    //! Maximum number of loops unrolled by one `run()`.
+    kMaxUnrolledLoops = 8,
+    //! Maximum number of instructions a loop can have after unrolling.
+    kMaxUnrolledSize = 512,
+    //! Maximum number of operands of a reassociated expression.
+    kMaxReassociatedLeaves = 16,
+    //! Maximum number of instructions of both arms of a converted branch.
+    kMaxConvertedSize = 16,
+    //! Maximum depth of logical operations that combine condition masks.
+    kMaxMaskDepth = 4
+  };
+
+  //! Register flags.
+  enum RegFlags {
+    kRegCandidate = 0x01,                //!< Defined more than once, needs renaming.
+    kRegInMem     = 0x02,                //!< Used by a memory operand.
+    kRegLive      = 0x04,                //!< Marked live by DCE.
+    kRegDefined   = 0x08,                //!< Defined by a dominating block.
+    kRegVisited   = 0x10,                //!< Already a part of a reassociated expression.
+    kRegMoved     = 0x20,                //!< Operand of a move picked for coalescing.
+    kRegInterfere = 0x40                 //!< Destination of a move that cannot be coalesced.
+  };
+
+  //! Block isn't part of the current loop.
+  static const uint32_t kInvalidLoopIndex = 0xFFFFFFFFU;
+
+  //! Data associated with a register.
+  struct RegData {
+    IRReg* reg;                          //!< Register (null if not used).
+    IRInst* def;                         //!< Defining instruction (SSA only).
+    IRBlock* block;                      //!< Block of the defining instruction.
+    IRReg* orig;                         //!< Register renamed to this version.
+    IRReg* link;                         //!< Rename stack or replacement.
+    IRInst* move;                        //!< Move picked for coalescing.
+    uint32_t defCount;                   //!< Number of definitions (before SSA).
+    uint32_t defStart;                   //!< First definition site in `_defSites`.
+    uint32_t flags;                      //!< Register flags, see \ref RegFlags.
+  };
+
+  //! Expression available to CSE (an instruction that defines a register).
+  struct CSENode : public HashNode {
+    MPSL_INLINE CSENode(IRInst* inst, uint32_t hVal, IRBlock* block, uint32_t epoch) noexcept
+      : HashNode(hVal),
+        _inst(inst),
+        _block(block),
+        _epoch(epoch) {}
+
+    bool eq(IRInst* inst) const noexcept;
+
+    IRInst* _inst;                       //!< Instruction.
+    IRBlock* _block;                     //!< Block of the instruction.
+    uint32_t _epoch;                     //!< Number of stores that precede it.
+  };
+  typedef Hash<IRInst*, CSENode> CSETable;
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  IRPassManager(IRBuilder* ir, uint32_t optLevel, uint32_t unrollLimit, uint32_t flags) noexcept;
+  ~IRPassManager() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Run]
+  // --------------------------------------------------------------------------
+
+  //! Run all passes enabled by the optimization level.
+  Error run() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [CFG]
+  // --------------------------------------------------------------------------
+
+  //! Remove blocks not reachable from the entry and compute the reverse
+  //! post-order of the remaining ones.
+  Error removeUnreachableBlocks() noexcept;
+  //! Compute immediate dominators, the dominator tree and dominance frontiers.
+  Error computeDominators() noexcept;
+
+  //! Get whether block `a` dominates block `b`.
+  bool _dominates(IRBlock* a, IRBlock* b) const noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Loops]
+  // --------------------------------------------------------------------------
+
+  //! Unroll completely one innermost loop that has a known trip count, must
+  //! run before `toSSA()` and invalidates all CFG data if `unrolled` is true.
+  Error unrollLoop(bool& unrolled) noexcept;
+  //! Move instructions that compute the same value in each iteration of a
+  //! loop to its preheader (SSA only).
+  Error hoistLoopInvariants(bool& changed) noexcept;
+
+  //! Collect blocks of the natural loop of `header` to `_loop`, `numLatches`
+  //! is the number of back edges (zero if `header` is not a loop header).
+  Error _collectLoop(IRBlock* header, uint32_t& numLatches) noexcept;
+  //! Clear the loop collected by `_collectLoop()`.
+  void _clearLoop() noexcept;
+
+  Error _unrollLoop(IRBlock* header, bool& unrolled) noexcept;
+  Error _hoistLoop(IRBlock* header, bool& changed) noexcept;
+
+  //! Get whether `block` belongs to the loop collected by `_collectLoop()`.
+  MPSL_INLINE bool _isInLoop(IRBlock* block) const noexcept {
+    uint32_t id = block->getId();
+    return id < _loopIndex.getLength() && _loopIndex[id] != kInvalidLoopIndex;
+  }
+
+  // --------------------------------------------------------------------------
+  // [SSA]
+  // --------------------------------------------------------------------------
+
+  //! Translate the IR to SSA form, `converted` is false if the IR contains a
+  //! construct that cannot be renamed (the IR is not modified in that case).
+  Error toSSA(bool& converted) noexcept;
+  //! Replace all phi nodes by moves.
+  Error fromSSA() noexcept;
+
+  void _markUndominatedUses(IRBlock* block) noexcept;
+  Error _renameBlock(IRBlock* block) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Passes]
+  // --------------------------------------------------------------------------
+
+  //! Replace registers defined by a move (or a trivial phi) by its source.
+  Error propagateCopies(bool& changed) noexcept;
+  //! Fold instructions that have only constant operands into fetches.
+  Error foldConstants(bool& changed) noexcept;
+  //! Replace instructions that have a constant operand by cheaper ones (SSA
+  //! only), like an integer division by a shift or a multiplication.
+  Error reduceStrength(bool& changed) noexcept;
+  //! Remove instructions that compute a value already available.
+  Error eliminateCommonSubexpressions(bool& changed) noexcept;
+  //! Remove instructions that don't contribute to stores, jumps, and calls.
+  Error eliminateDeadCode(bool& changed) noexcept;
+  //! Replace small if-then and if-then-else diamonds by selects (SSA only),
+  //! invalidates all CFG data if `changed` is true.
+  Error convertBranches(bool& changed) noexcept;
+
+  Error _cseBlock(IRBlock* block, CSETable& table) noexcept;
+  Error _convertBranch(IRBlock* block, bool& changed) noexcept;
+  //! Reduce the integer division or remainder `body[index]` by a constant `d`,
+  //! `index` is moved to the last instruction of the emitted sequence.
+  Error _reduceDivision(IRBody& body, size_t& index, int32_t d, bool& reduced) noexcept;
+
+  //! Insert `dst = instCode(o1, o2)` before `body[index]` and advance `index`,
+  //! a new register like the one defined by `body[index]` is used if `dst` is
+  //! null. Returns null if out of memory, null operands are propagated.
+  IRReg* _emitAt(IRBody& body, size_t& index, uint32_t instCode, IRObject* o1, IRObject* o2, IRReg* dst = nullptr) noexcept;
+  //! Create an immediate integer operand.
+  IRImm* _newImmInt(int32_t value) noexcept;
+
+  //! Get whether `reg` is a condition mask (all bits of each element are set
+  //! if the condition is true), `depth` limits logical operations followed.
+  bool _isMask(IRReg* reg, uint32_t depth) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Liveness]
+  // --------------------------------------------------------------------------
+
+  //! Compute registers live at the beginning and end of each block.
+  Error computeLiveness() noexcept;
+  //! Merge registers connected by a move that are never live at the same time
+  //! and remove the move (non-SSA), each register is merged once per call.
+  Error coalesceMoves(bool& changed) noexcept;
+  //! Store the maximum number of registers of each kind live at the same
+  //! time to the IR, see `IRBuilder::getMaxLive()`.
+  Error measurePressure() noexcept;
+
+  //! Update `live` (registers live after `inst`) to registers live before it,
+  //! `count` (by register kind) is updated accordingly if not null.
+  void _stepBack(IRInst* inst, uint32_t* live, uint32_t* count) noexcept;
+
+  //! Get bit set `index` of `block`, see `_liveBits`.
+  MPSL_INLINE uint32_t* _liveSet(IRBlock* block, uint32_t index) noexcept {
+    return _liveBits.getData() + (block->getId() * 4 + index) * _liveWords;
+  }
+
+  // --------------------------------------------------------------------------
+  // [Fast Math]
+  // --------------------------------------------------------------------------
+
+  //! Replace divisions by a constant by multiplications by its reciprocal.
+  Error replaceDivisions(bool& changed) noexcept;
+  //! Rebalance chains of additions and multiplications to shorten their
+  //! dependency chains, for example `((a + b) + c) + d` to `(a + b) + (c + d)`.
+  Error reassociate(bool& changed) noexcept;
+  //! Fuse multiplications used only by an addition into FMA.
+  Error contractMulAdd(bool& changed) noexcept;
+
+  //! Collect operands of the expression tree of `inst` that are not computed
+  //! by `instCode` in the same block to `leaves`, `depth` is the tree depth.
+  bool _collectLeaves(IRInst* inst, IRBlock* block, IRObject** leaves, uint32_t& count, uint32_t& depth) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Utilities]
+  // --------------------------------------------------------------------------
+
+  //! Make `_regData` large enough for all registers created so far.
+  Error updateRegData() noexcept;
+  //! Clear data of all registers.
+  Error resetRegData() noexcept;
+  //! Count definitions of all registers and remember the last one (non-SSA).
+  Error scanDefs() noexcept;
+  //! Update `RegData::def` of all registers.
+  Error updateDefs() noexcept;
+  //! Replace uses of all registers that have `RegData::link` set.
+  void applyReplacements() noexcept;
+
+  //! Get the value of `obj` if it's a constant, see `foldConstants()`.
+  bool getConstant(IRObject* obj, Value& out) noexcept;
+  //! Like `getConstant()`, but for non-SSA IR, see `scanDefs()`.
+  bool getUniqueConstant(IRObject* obj, Value& out) noexcept;
+  //! Replace operand `index` of `inst` by `obj`.
+  void setOperand(IRInst* inst, uint32_t index, IRObject* obj) noexcept;
+
+  MPSL_INLINE RegData& getRegData(IRReg* reg) noexcept { return _regData[reg->getId()]; }
+
+  //! Get whether `reg` is an original register renamed by `toSSA()`.
+  MPSL_INLINE bool _isCandidate(IRReg* reg) noexcept {
+    return (getRegData(reg).flags & kRegCandidate) != 0;
+  }
+
+  //! Get whether `reg` is an original register used before it's defined.
+  MPSL_INLINE bool _isUndefined(IRReg* reg) noexcept {
+    RegData& rd = getRegData(reg);
+    return rd.def == nullptr && (rd.flags & kRegCandidate) != 0;
+  }
+
+  //! Follow `RegData::link` of `reg` to its final replacement.
+  MPSL_INLINE IRReg* _resolve(IRReg* reg) noexcept {
+    IRReg* link;
+    while ((link = getRegData(reg).link) != nullptr)
+      reg = link;
+    return reg;
+  }
+
+  //! Get the nearest common dominator of `a` and `b`.
+  IRBlock* _intersect(IRBlock* a, IRBlock* b) const noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  IRBuilder* _ir;                        //!< IR builder.
+  ZoneHeap* _heap;                       //!< Heap used by all containers.
+  uint32_t _optLevel;                    //!< Optimization level.
+  uint32_t _unrollLimit;                 //!< Maximum trip count of unrolled loops.
+  uint32_t _flags;                       //!< Pass flags, see \ref IRPassFlags.
+
+  IRBlocks _rpo;                         //!< Reachable blocks in reverse post-order.
+  ZoneVector<uint32_t> _rpoIndex;        //!< RPO index of each block (by block ID).
+  IRBlocks _idom;                        //!< Immediate dominator (by block ID).
+  ZoneVector<uint32_t> _domStart;        //!< First child in `_domChildren` (by block ID).
+  IRBlocks _domChildren;                 //!< Dominator tree children.
+  ZoneVector<uint32_t> _dfStart;         //!< First block in `_df` (by block ID).
+  IRBlocks _df;                          //!< Dominance frontiers.
+
+  ZoneVector<RegData> _regData;          //!< Register data (by register ID).
+  IRBlocks _defSites;                    //!< Blocks that define each candidate.
+  uint32_t _ssaFirstId;                  //!< First ID of registers created by SSA.
+
+  IRBlocks _loop;                        //!< Blocks of the current loop, header first.
+  ZoneVector<uint32_t> _loopIndex;       //!< Index of each block in `_loop` (by block ID).
+  IRBlocks _clones;                      //!< Blocks created by unrolling.
+
+  //! Live-in, live-out, used before defined, and defined registers of each
+  //! block (four bit sets by block ID, indexed by register ID).
+  ZoneVector<uint32_t> _liveBits;
+  ZoneVector<uint32_t> _live;            //!< Registers live at the current instruction.
+  uint32_t _liveWords;                   //!< Number of words of each bit set.
+
+  IRBlocks _work;                        //!< Temporary block list.
+  IRBody _insts;                         //!< Temporary instruction list.
+  ZoneVector<CSENode*> _cseScope;        //!< CSE nodes by dominator tree scope.
+  uint32_t _cseEpoch;                    //!< Number of stores seen by CSE.
+};
+
+//! \internal
+//!
+//! Run IR passes enabled by `optLevel`, see \ref IROptLevel, loops that run
+//! at most `unrollLimit` times are unrolled. `flags` enable additional passes,
+//! see \ref IRPassFlags. Register pressure of the resulting IR is measured
+//! at every optimization level.
+Error mpIRPass(IRBuilder* ir, uint32_t optLevel, uint32_t unrollLimit, uint32_t flags) noexcept;
 
 } // mpsl namespace
 
@@ -14,10 +14,207 @@
 // [Api-Begin]
 #include "./mpsl_apibegin.h"
 
+#if MPSL_BUILD_X86
 namespace mpsl {
 
 using namespace asmjit;
 
+// ============================================================================
+// [mpsl::IRToX86 - Helpers]
+// ============================================================================
+
+// Get the VEX encoded form of the SSE instruction `instId` or `instId` itself
+// if it has none (GP instructions).
+static uint32_t mpGetAvxInstId(uint32_t instId) noexcept {
+#define V(sse, avx) case X86Inst::kId##sse: return X86Inst::kId##avx
+  switch (instId) {
+    V(Addpd     , Vaddpd     ); V(Addps     , Vaddps     );
+    V(Addsd     , Vaddsd     ); V(Addss     , Vaddss     );
+    V(Andpd     , Vandpd     ); V(Andps     , Vandps     );
+    V(Cmppd     , Vcmppd     ); V(Cmpps     , Vcmpps     );
+    V(Cmpsd     , Vcmpsd     ); V(Cmpss     , Vcmpss     );
+    V(Cvtdq2ps  , Vcvtdq2ps  ); V(Cvttps2dq , Vcvttps2dq );
+    V(Cvtsd2ss  , Vcvtsd2ss  ); V(Cvtss2sd  , Vcvtss2sd  );
+    V(Cvtsi2sd  , Vcvtsi2sd  ); V(Cvtsi2ss  , Vcvtsi2ss  );
+    V(Cvttsd2si , Vcvttsd2si ); V(Cvttss2si , Vcvttss2si );
+    V(Divpd     , Vdivpd     ); V(Divps     , Vdivps     );
+    V(Divsd     , Vdivsd     ); V(Divss     , Vdivss     );
+    V(Ldmxcsr   , Vldmxcsr   ); V(Stmxcsr   , Vstmxcsr   );
+    V(Maxpd     , Vmaxpd     ); V(Maxps     , Vmaxps     );
+    V(Maxsd     , Vmaxsd     ); V(Maxss     , Vmaxss     );
+    V(Minpd     , Vminpd     ); V(Minps     , Vminps     );
+    V(Minsd     , Vminsd     ); V(Minss     , Vminss     );
+    V(Movapd    , Vmovapd    ); V(Movaps    , Vmovaps    );
+    V(Movd      , Vmovd      ); V(Movq      , Vmovq      );
+    V(Movsd     , Vmovsd     ); V(Movss     , Vmovss     );
+    V(Movntps   , Vmovntps   ); V(Movups    , Vmovups    );
+    V(Mulpd     , Vmulpd     ); V(Mulps     , Vmulps     );
+    V(Mulsd     , Vmulsd     ); V(Mulss     , Vmulss     );
+    V(Orpd      , Vorpd      ); V(Orps      , Vorps      );
+    V(Packssdw  , Vpackssdw  ); V(Packsswb  , Vpacksswb  );
+    V(Packusdw  , Vpackusdw  ); V(Packuswb  , Vpackuswb  );
+    V(Paddb     , Vpaddb     ); V(Paddw     , Vpaddw     );
+    V(Paddd     , Vpaddd     ); V(Paddq     , Vpaddq     );
+    V(Paddsb    , Vpaddsb    ); V(Paddsw    , Vpaddsw    );
+    V(Paddusb   , Vpaddusb   ); V(Paddusw   , Vpaddusw   );
+    V(Pand      , Vpand      ); V(Pandn     , Vpandn     );
+    V(Por       , Vpor       ); V(Pxor      , Vpxor      );
+    V(Pcmpeqb   , Vpcmpeqb   ); V(Pcmpeqw   , Vpcmpeqw   );
+    V(Pcmpeqd   , Vpcmpeqd   ); V(Pcmpgtb   , Vpcmpgtb   );
+    V(Pcmpgtw   , Vpcmpgtw   ); V(Pcmpgtd   , Vpcmpgtd   );
+    V(Pmaddwd   , Vpmaddwd   );
+    V(Pmaxsb    , Vpmaxsb    ); V(Pmaxub    , Vpmaxub    );
+    V(Pmaxsw    , Vpmaxsw    ); V(Pmaxuw    , Vpmaxuw    );
+    V(Pmaxsd    , Vpmaxsd    ); V(Pmaxud    , Vpmaxud    );
+    V(Pminsb    , Vpminsb    ); V(Pminub    , Vpminub    );
+    V(Pminsw    , Vpminsw    ); V(Pminuw    , Vpminuw    );
+    V(Pminsd    , Vpminsd    ); V(Pminud    , Vpminud    );
+    V(Pmovsxbw  , Vpmovsxbw  ); V(Pmovzxbw  , Vpmovzxbw  );
+    V(Pmovsxwd  , Vpmovsxwd  ); V(Pmovzxwd  , Vpmovzxwd  );
+    V(Pmulhuw   , Vpmulhuw   ); V(Pmulhw    , Vpmulhw    );
+    V(Pmulld    , Vpmulld    ); V(Pmullw    , Vpmullw    );
+    V(Pmuludq   , Vpmuludq   ); V(Pshufd    , Vpshufd    );
+    V(Psllw     , Vpsllw     ); V(Pslld     , Vpslld     );
+    V(Psllq     , Vpsllq     ); V(Psraw     , Vpsraw     );
+    V(Psrad     , Vpsrad     ); V(Psrlw     , Vpsrlw     );
+    V(Psrld     , Vpsrld     ); V(Psrlq     , Vpsrlq     );
+    V(Psubb     , Vpsubb     ); V(Psubw     , Vpsubw     );
+    V(Psubd     , Vpsubd     ); V(Psubq     , Vpsubq     );
+    V(Psubsb    , Vpsubsb    ); V(Psubsw    , Vpsubsw    );
+    V(Psubusb   , Vpsubusb   ); V(Psubusw   , Vpsubusw   );
+    V(Punpckldq , Vpunpckldq ); V(Punpcklqdq, Vpunpcklqdq);
+    V(Shufps    , Vshufps    );
+    V(Sqrtpd    , Vsqrtpd    ); V(Sqrtps    , Vsqrtps    );
+    V(Sqrtsd    , Vsqrtsd    ); V(Sqrtss    , Vsqrtss    );
+    V(Subpd     , Vsubpd     ); V(Subps     , Vsubps     );
+    V(Subsd     , Vsubsd     ); V(Subss     , Vsubss     );
+    V(Xorpd     , Vxorpd     ); V(Xorps     , Vxorps     );
+
+    default:
+      return instId;
+  }
+#undef V
+}
+
+// Scalar SSE instructions that keep the upper part of their destination, their
+// VEX forms take it from an additional source operand.
+static MPSL_INLINE bool mpIsMergeInst(uint32_t instId) noexcept {
+  switch (instId) {
+    case X86Inst::kIdCvtsd2ss:
+    case X86Inst::kIdCvtss2sd:
+    case X86Inst::kIdCvtsi2sd:
+    case X86Inst::kIdCvtsi2ss:
+    case X86Inst::kIdSqrtsd:
+    case X86Inst::kIdSqrtss:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// Scalar FMA forms only read a single element from memory.
+static MPSL_INLINE bool mpIsScalarFmaInst(uint32_t instId) noexcept {
+  return instId == X86Inst::kIdVfmadd213ss || instId == X86Inst::kIdVfmadd213sd;
+}
+
+// `pmovsx` and `pmovzx` widen the low half of their source, a 256-bit form
+// would read the whole low 128-bit lane instead of the low half of each lane.
+static MPSL_INLINE bool mpIsUnpackInst(uint32_t instId) noexcept {
+  switch (instId) {
+    case X86Inst::kIdPmovsxbw:
+    case X86Inst::kIdPmovzxbw:
+    case X86Inst::kIdPmovsxwd:
+    case X86Inst::kIdPmovzxwd:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+static MPSL_INLINE bool mpIsShiftInst(uint32_t instId) noexcept {
+  switch (instId) {
+    case X86Inst::kIdPsllw:
+    case X86Inst::kIdPslld:
+    case X86Inst::kIdPsllq:
+    case X86Inst::kIdPsraw:
+    case X86Inst::kIdPsrad:
+    case X86Inst::kIdPsrlw:
+    case X86Inst::kIdPsrld:
+    case X86Inst::kIdPsrlq:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// Commutative instructions can swap their sources to avoid a copy.
+static MPSL_INLINE bool mpIsCommutativeInst(uint32_t instId) noexcept {
+  switch (instId) {
+    case X86Inst::kIdAdd:
+    case X86Inst::kIdAnd:
+    case X86Inst::kIdImul:
+    case X86Inst::kIdOr:
+    case X86Inst::kIdXor:
+    case X86Inst::kIdAddpd:
+    case X86Inst::kIdAddps:
+    case X86Inst::kIdAddsd:
+    case X86Inst::kIdAddss:
+    case X86Inst::kIdAndpd:
+    case X86Inst::kIdAndps:
+    case X86Inst::kIdMulpd:
+    case X86Inst::kIdMulps:
+    case X86Inst::kIdMulsd:
+    case X86Inst::kIdMulss:
+    case X86Inst::kIdOrpd:
+    case X86Inst::kIdOrps:
+    case X86Inst::kIdXorpd:
+    case X86Inst::kIdXorps:
+    case X86Inst::kIdPaddb:
+    case X86Inst::kIdPaddw:
+    case X86Inst::kIdPaddd:
+    case X86Inst::kIdPaddq:
+    case X86Inst::kIdPand:
+    case X86Inst::kIdPor:
+    case X86Inst::kIdPxor:
+    case X86Inst::kIdPcmpeqb:
+    case X86Inst::kIdPcmpeqw:
+    case X86Inst::kIdPcmpeqd:
+    case X86Inst::kIdPmulld:
+    case X86Inst::kIdPmullw:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// Get the type of a register of `reg` kind and `width` passed to a function.
+// Vectors are always passed whole, so moves done by the call never change them.
+static MPSL_INLINE uint32_t mpTypeIdOf(uint32_t reg, uint32_t width) noexcept {
+  if (reg == IRReg::kKindGp)
+    return width > 4 ? TypeId::kUIntPtr : TypeId::kI32;
+  else
+    return width > 16 ? TypeId::kI32x8 : TypeId::kI32x4;
+}
+
+static void mpInitFuncSignature(FuncSignatureX& sign, const IRFunc* func) noexcept {
+  const IRRegs& args = func->getArgs();
+  sign.setRet(mpTypeIdOf(func->getRetReg(), func->getRetWidth()));
+
+  for (size_t i = 0, count = args.getLength(); i < count; i++)
+    sign.addArg(mpTypeIdOf(args[i]->getReg(), args[i]->getWidth()));
+}
+
+// Get the low 128-bit half of a 256-bit operand.
+static MPSL_INLINE Operand mpLoHalf(const Operand& op) noexcept {
+  if (X86Reg::isYmm(op))
+    return x86::xmm(op.getId());
+  return op;
+}
+
 // ============================================================================
 // [mpsl::IRToX86 - Construction / Destruction]
 // ============================================================================
@@ -25,17 +222,124 @@ using namespace asmjit;
 IRToX86::IRToX86(ZoneHeap* heap, X86Compiler* cc)
   : _heap(heap),
     _cc(cc),
+    _func(nullptr),
     _functionBody(nullptr),
-    _constPool(&cc->_cbDataZone) {
+    _constPool(&cc->_cbDataZone),
+    _sharedUsed(false),
+    _enableFpEnv(false),
+    _mxcsr(0) {
 
   _tmpXmm0 = _cc->newXmm("tmpXmm0");
   _tmpXmm1 = _cc->newXmm("tmpXmm1");
 
   const CpuInfo& cpu = CpuInfo::getHost();
   _enableSSE4_1 = cpu.hasFeature(CpuInfo::kX86FeatureSSE4_1);
+  _enableAVX = cpu.hasFeature(CpuInfo::kX86FeatureAVX);
+  _enableAVX2 = _enableAVX && cpu.hasFeature(CpuInfo::kX86FeatureAVX2);
+  _enableFMA = _enableAVX && cpu.hasFeature(CpuInfo::kX86FeatureFMA);
+  _enableF16C = _enableAVX && cpu.hasFeature(CpuInfo::kX86FeatureF16C);
 }
 
-IRToX86::~IRToX86() {}
+IRToX86::~IRToX86() {
+  _accumulators.release(_heap);
+}
+
+// ============================================================================
+// [mpsl::IRToX86 - Accessors]
+// ============================================================================
+
+uint32_t IRToX86::getFeatures() const {
+  uint32_t features = 0;
+
+  if (_enableSSE4_1) features |= kCpuFeatureSSE4_1;
+  if (_enableAVX   ) features |= kCpuFeatureAVX;
+  if (_enableAVX2  ) features |= kCpuFeatureAVX2;
+  if (_enableFMA   ) features |= kCpuFeatureFMA;
+  if (_enableF16C  ) features |= kCpuFeatureF16C;
+
+  return features;
+}
+
+size_t IRToX86::getConstPoolSize() const {
+  return _constPool.getSize();
+}
+
+// ============================================================================
+// [mpsl::IRToX86 - Shared Consts]
+// ============================================================================
+
+#define MPSL_SHARED_B32(x) { x, x, x, x, x, x, x, x }
+#define MPSL_SHARED_B64(hi, lo) { lo, hi, lo, hi, lo, hi, lo, hi }
+
+// Constants used by most programs, each element is repeated to fill 256 bits
+// so they match constants of any width. Programs reference them instead of
+// duplicating them in their own constant pools.
+MPSL_ALIGN_VAR(static const uint32_t, mpSharedConsts[][8], 32) = {
+  MPSL_SHARED_B32(0x80000000U),               // -0.0f (sign mask).
+  MPSL_SHARED_B32(0x7FFFFFFFU),               // Abs mask.
+  MPSL_SHARED_B32(0x3F800000U),               // 1.0f.
+  MPSL_SHARED_B32(0x3F000000U),               // 0.5f.
+  MPSL_SHARED_B32(0xBF800000U),               // -1.0f.
+  MPSL_SHARED_B32(0x40000000U),               // 2.0f.
+  MPSL_SHARED_B32(0x7F800000U),               // Infinity.
+  MPSL_SHARED_B32(0x00800000U),               // Minimum normal.
+  MPSL_SHARED_B32(0x007FFFFFU),               // Mantissa mask.
+  MPSL_SHARED_B32(0x4B000000U),               // 2^23.
+  MPSL_SHARED_B32(0x4B400000U),               // Round magic (2^23 + 2^22).
+  MPSL_SHARED_B32(0x00000001U),               // 1.
+  MPSL_SHARED_B32(0xFFFFFFFFU),               // All ones.
+
+  MPSL_SHARED_B64(0x80000000U, 0x00000000U),  // -0.0 (sign mask).
+  MPSL_SHARED_B64(0x7FFFFFFFU, 0xFFFFFFFFU),  // Abs mask.
+  MPSL_SHARED_B64(0x3FF00000U, 0x00000000U),  // 1.0.
+  MPSL_SHARED_B64(0x3FE00000U, 0x00000000U),  // 0.5.
+  MPSL_SHARED_B64(0xBFF00000U, 0x00000000U),  // -1.0.
+  MPSL_SHARED_B64(0x40000000U, 0x00000000U),  // 2.0.
+  MPSL_SHARED_B64(0x7FF00000U, 0x00000000U),  // Infinity.
+  MPSL_SHARED_B64(0x00100000U, 0x00000000U),  // Minimum normal.
+  MPSL_SHARED_B64(0x000FFFFFU, 0xFFFFFFFFU),  // Mantissa mask.
+  MPSL_SHARED_B64(0x43300000U, 0x00000000U),  // 2^52.
+  MPSL_SHARED_B64(0x43380000U, 0x00000000U)   // Round magic (2^52 + 2^51).
+};
+
+#undef MPSL_SHARED_B64
+#undef MPSL_SHARED_B32
+
+enum { kSharedConstsCount = MPSL_ARRAY_SIZE(mpSharedConsts) };
+
+const void* mpGetSharedConsts() noexcept {
+  return mpSharedConsts;
+}
+
+// Get the offset of a constant matching `width` bytes of `data` in the table
+// of shared constants, -1 if there is none.
+static int32_t mpFindSharedConst(const void* data, uint32_t width) noexcept {
+  if (width > sizeof(mpSharedConsts[0]))
+    return -1;
+
+  for (uint32_t i = 0; i < kSharedConstsCount; i++) {
+    if (::memcmp(mpSharedConsts[i], data, width) == 0)
+      return static_cast<int32_t>(i * sizeof(mpSharedConsts[0]));
+  }
+
+  return -1;
+}
+
+void IRToX86::prepareSharedConsts() {
+  if (!_sharedUsed) {
+    _sharedUsed = true;
+    _sharedPtr = _cc->newIntPtr("sharedConsts");
+
+    CBNode* prev = _cc->setCursor(_functionBody);
+    _cc->mov(_sharedPtr, x86::ptr(_sharedLabel));
+    if (prev != _functionBody) _cc->setCursor(prev);
+  }
+}
+
+X86Mem IRToX86::getSharedConstant(uint32_t offset) {
+  prepareSharedConsts();
+  return x86::ptr(_sharedPtr, static_cast<int>(offset));
+}
 
 // ============================================================================
 // [mpsl::IRToX86 - Const Pool]
@@ -53,6 +357,10 @@ void IRToX86::prepareConstPool() {
 }
 
 X86Mem IRToX86::getConstantU64(uint64_t value) {
+  int32_t shared = _sharedLabel.isValid() ? mpFindSharedConst(&value, sizeof(uint64_t)) : -1;
+  if (shared >= 0)
+    return getSharedConstant(static_cast<uint32_t>(shared));
+
   prepareConstPool();
 
   size_t offset;
@@ -85,7 +393,17 @@ X86Mem IRToX86::getConstantD64AsPD(double value) {
   return getConstantU64AsPD(bits.u);
 }
 
+X86Mem IRToX86::getConstantU32x4(uint32_t value) {
+  Value v;
+  v.i.set(static_cast<int32_t>(value));
+  return getConstantByValue(v, 16);
+}
+
 X86Mem IRToX86::getConstantByValue(const Value& value, uint32_t width) {
+  int32_t shared = _sharedLabel.isValid() ? mpFindSharedConst(&value, width) : -1;
+  if (shared >= 0)
+    return getSharedConstant(static_cast<uint32_t>(shared));
+
   prepareConstPool();
 
   size_t offset;
@@ -95,10 +413,529 @@ X86Mem IRToX86::getConstantByValue(const Value& value, uint32_t width) {
   return x86::ptr(_constPtr, static_cast<int>(offset));
 }
 
+// ============================================================================
+// [mpsl::IRToX86 - Peephole]
+// ============================================================================
+
+// Get the number of bytes read by a fetch instruction (0 if not a fetch).
+static MPSL_INLINE uint32_t mpFetchSize(uint32_t instCode) noexcept {
+  switch (instCode) {
+    case kInstCodeFetch32 : return 4;
+    case kInstCodeFetch64 : return 8;
+    case kInstCodeFetch96 : return 12;
+    case kInstCodeFetch128: return 16;
+    case kInstCodeFetch192: return 24;
+    case kInstCodeFetch256: return 32;
+
+    default:
+      return 0;
+  }
+}
+
+// Get if `mem` written by `instCode` can be written by a non-temporal store,
+// which only writes 128-bit and 256-bit data aligned to its size. Data that is
+// also read is already in the cache, a non-temporal store would evict it.
+static MPSL_INLINE bool mpCanStreamStore(uint32_t instCode, const IRMem* mem) noexcept {
+  uint32_t size = instCode == kInstCodeStore128 ? 16 : instCode == kInstCodeStore256 ? 32 : 0;
+  return size != 0 && mem->getAlignment() >= size && mem->isWriteOnly();
+}
+
+// Get the number of bytes `instCode` reads from a memory operand that replaces
+// its second source, zero if it can't have one. Scalar logical operations use
+// packed instructions, which read the whole XMM register.
+static uint32_t mpMemReadSize(uint32_t instCode) noexcept {
+  uint32_t size;
+
+  switch (instCode & kInstCodeMask) {
+    case kInstCodeAddf: case kInstCodeSubf: case kInstCodeMulf:
+    case kInstCodeDivf: case kInstCodeMinf: case kInstCodeMaxf:
+      size = 4;
+      break;
+
+    case kInstCodeAddd: case kInstCodeSubd: case kInstCodeMuld:
+    case kInstCodeDivd: case kInstCodeMind: case kInstCodeMaxd:
+      size = 8;
+      break;
+
+    case kInstCodeAndf: case kInstCodeOrf: case kInstCodeXorf:
+    case kInstCodeAndd: case kInstCodeOrd: case kInstCodeXord:
+      size = 16;
+      break;
+
+    default:
+      return 0;
+  }
+
+  switch (instCode & kInstVecMask) {
+    case kInstVec128: return 16;
+    case kInstVec256: return 32;
+    default:
+      return size;
+  }
+}
+
+static MPSL_INLINE bool mpIsCommutativeCode(uint32_t instCode) noexcept {
+  switch (instCode & kInstCodeMask) {
+    case kInstCodeAddf: case kInstCodeMulf: case kInstCodeAndf: case kInstCodeOrf: case kInstCodeXorf:
+    case kInstCodeAddd: case kInstCodeMuld: case kInstCodeAndd: case kInstCodeOrd: case kInstCodeXord:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// Get whether `inst` uses `obj` as a source or as a part of a memory operand.
+static bool mpReads(const IRInst* inst, const IRObject* obj) noexcept {
+  const InstInfo& info = mpInstInfo[inst->getInstCode() & kInstCodeMask];
+  uint32_t first = info.isStore() || info.isJxx() || info.isRet() || info.isCall() ? 0 : 1;
+
+  for (uint32_t i = 0, count = inst->getOpCount(); i < count; i++) {
+    const IRObject* op = inst->getOperand(i);
+    if (op == obj && i >= first)
+      return true;
+
+    if (op->isMem()) {
+      const IRMem* mem = op->as<IRMem>();
+      if (mem->getBase() == obj || mem->getIndex() == obj)
+        return true;
+    }
+  }
+
+  return false;
+}
+
+// Get whether `inst` writes all of `reg` without reading it.
+static bool mpOverwrites(const IRInst* inst, const IRReg* reg) noexcept {
+  const InstInfo& info = mpInstInfo[inst->getInstCode() & kInstCodeMask];
+  uint32_t code = inst->getInstCode() & kInstCodeMask;
+
+  if (info.isStore() || info.isJxx() || info.isRet() || info.isCall() ||
+      code == kInstCodeInsert32 || code == kInstCodeInsert64)
+    return false;
+
+  return inst->getOpCount() != 0 && inst->getOperand(0) == reg && !mpReads(inst, reg);
+}
+
+Error IRToX86::optimizeBlock(IRBlock* block) {
+  IRBuilder* ir = block->getIR();
+  IRBody& body = block->getBody();
+  size_t len = body.getLength();
+
+  for (size_t i = 0; i + 1 < len; i++) {
+    IRInst* inst = body[i];
+    uint32_t instCode = inst->getInstCode();
+    const InstInfo& info = mpInstInfo[instCode & kInstCodeMask];
+
+    if (!info.isMov() && !(info.isFetch() && inst->getOpCount() == 2))
+      continue;
+
+    IRObject* dst = inst->getOperand(0);
+    if (!dst->isReg())
+      continue;
+
+    IRReg* reg = dst->as<IRReg>();
+
+    // A copy or load overwritten by the next instruction is never read.
+    if (mpOverwrites(body[i + 1], reg)) {
+      block->neuterAt(i);
+      ir->deleteInst(inst);
+      continue;
+    }
+
+    // A constant or memory fetched to a register that has a single use, which
+    // follows in the same block, is read directly by the instruction that uses
+    // it. Packed SSE instructions can only read aligned memory, which is the
+    // constant pool and data aligned by its `Layout`.
+    IRObject* src = inst->getOperand(1);
+    uint32_t size = mpFetchSize(instCode);
+
+    if (reg->getReg() != IRReg::kKindVec || reg->getRefCount() != 2 ||
+        (!src->isImm() && !src->isMem()) ||
+        (src->isImm() && src->as<IRImm>()->getWidth() < size))
+      continue;
+
+    IRReg* base = src->isMem() ? src->as<IRMem>()->getBase() : nullptr;
+    IRReg* index = src->isMem() ? src->as<IRMem>()->getIndex() : nullptr;
+
+    // Reductions are replaced by registers in a batch, see `initAccumulators()`.
+    if (ir->getReduceOp(base) != kReduceNone)
+      continue;
+
+    for (size_t j = i + 1; j < len; j++) {
+      IRInst* use = body[j];
+      const InstInfo& useInfo = mpInstInfo[use->getInstCode() & kInstCodeMask];
+
+      if (!mpReads(use, reg)) {
+        // The memory must not change before it's read.
+        if (src->isMem() && (useInfo.isStore() || useInfo.isCall() ||
+            (use->getOpCount() != 0 && (use->getOperand(0) == base || use->getOperand(0) == index))))
+          break;
+        continue;
+      }
+
+      uint32_t readSize = mpMemReadSize(use->getInstCode());
+      if (readSize == 0 || readSize != size || use->getOpCount() != 3)
+        break;
+
+      if (src->isMem() && readSize > 8 && !_enableAVX && src->as<IRMem>()->getAlignment() < readSize)
+        break;
+
+      IRObject** opArray = use->getOpArray();
+      if (opArray[1] == reg && opArray[2]->isReg() && mpIsCommutativeCode(use->getInstCode())) {
+        opArray[1] = opArray[2];
+        opArray[2] = reg;
+      }
+
+      if (opArray[2] != reg || !opArray[1]->isReg())
+        break;
+
+      src->addRef();
+      opArray[2] = src;
+      ir->derefObject(reg);
+
+      block->neuterAt(i);
+      ir->deleteInst(inst);
+      break;
+    }
+  }
+
+  block->fixupAfterNeutering();
+  return kErrorOk;
+}
+
+void IRToX86::emitZero(const Operand& o0) {
+  if (X86Reg::isGp(o0))
+    _cc->emit(X86Inst::kIdXor, o0, o0);
+  else if (_enableAVX)
+    _cc->emit(X86Inst::kIdVxorps, o0, o0, o0);
+  else
+    _cc->emit(X86Inst::kIdXorps, o0, o0);
+}
+
 // ============================================================================
 // [mpsl::IRToX86 - Compile]
 // ============================================================================
 
+void IRToX86::emitFpEnvEnter(const X86Mem& saved) {
+  X86Mem env = _cc->newStack(4, 4, "mxcsr");
+  X86Gp tmp = _cc->newInt32("mxcsr");
+
+  _cc->emit(getVecInstId(X86Inst::kIdStmxcsr), saved);
+  _cc->mov(tmp, saved);
+  _cc->and_(tmp, ~static_cast<uint32_t>(kMxcsrEnvMask));
+  _cc->or_(tmp, _mxcsr);
+  _cc->mov(env, tmp);
+  _cc->emit(getVecInstId(X86Inst::kIdLdmxcsr), env);
+}
+
+void IRToX86::emitFpEnvLeave(const X86Mem& saved) {
+  _cc->emit(getVecInstId(X86Inst::kIdLdmxcsr), saved);
+}
+
+void IRToX86::emitCountersEnter(CounterRegs& regs, const Operand& records) {
+  X86Gp slot = _cc->newIntPtr("counterSlot");
+  X86Gp base = _cc->newIntPtr("counters");
+
+  // Threads don't share stacks, hash the stack address to pick the slot.
+  _cc->mov(slot, _cc->zsp());
+  _cc->shr(slot, 12);
+  _cc->imul(slot.r32(), slot.r32(), static_cast<int32_t>(0x9E3779B1U));
+  _cc->shr(slot.r32(), 32 - kProgramCountersBits);
+  _cc->shl(slot, static_cast<int>(kProgramCounterSlotShift));
+  _cc->mov(base, imm_ptr(_counters));
+  _cc->add(slot, base);
+
+  emitCounterAdd(slot, MPSL_OFFSET_OF(ProgramCounterSlot, calls), imm(1), Operand());
+  emitCounterAdd(slot, MPSL_OFFSET_OF(ProgramCounterSlot, records), records, Operand());
+  regs.slot = slot;
+
+  if (_countCycles) {
+    regs.tscLo = _cc->newIntPtr("tscLo");
+    regs.tscHi = _cc->newIntPtr("tscHi");
+    _cc->rdtsc(regs.tscHi.r32(), regs.tscLo.r32());
+
+    if (kPointerWidth == 8) {
+      _cc->shl(regs.tscHi, 32);
+      _cc->or_(regs.tscLo, regs.tscHi);
+    }
+  }
+}
+
+void IRToX86::emitCountersLeave(const CounterRegs& regs) {
+  if (!_countCycles)
+    return;
+
+  X86Gp lo = _cc->newIntPtr("tscLo");
+  X86Gp hi = _cc->newIntPtr("tscHi");
+  _cc->rdtsc(hi.r32(), lo.r32());
+
+  if (kPointerWidth == 8) {
+    _cc->shl(hi, 32);
+    _cc->or_(lo, hi);
+    _cc->sub(lo, regs.tscLo);
+    emitCounterAdd(regs.slot, MPSL_OFFSET_OF(ProgramCounterSlot, cycles), lo, Operand());
+  }
+  else {
+    _cc->sub(lo, regs.tscLo);
+    _cc->sbb(hi, regs.tscHi);
+    emitCounterAdd(regs.slot, MPSL_OFFSET_OF(ProgramCounterSlot, cycles), lo, hi);
+  }
+}
+
+void IRToX86::emitCounterAdd(const X86Gp& slot, int32_t offset, const Operand& value, const Operand& valueHi) {
+  if (kPointerWidth == 8) {
+    _cc->lock().add(x86::qword_ptr(slot, offset), value);
+    return;
+  }
+
+  // X86 - the carry is added by a second locked instruction, readers can see
+  // a torn value, which is fine for statistics.
+  _cc->lock().add(x86::dword_ptr(slot, offset), value);
+  if (valueHi.isNone())
+    _cc->lock().adc(x86::dword_ptr(slot, offset + 4), imm(0));
+  else
+    _cc->lock().adc(x86::dword_ptr(slot, offset + 4), valueHi);
+}
+
+void IRToX86::emitLoadStore(uint32_t instCode, const Operand& o0, const Operand& o1) {
+  switch (instCode & kInstCodeMask) {
+    case kInstCodeFetch32:
+    case kInstCodeStore32:
+      if ((X86Reg::isGp(o0) && (o1.isMem() || X86Reg::isGp(o1))) ||
+          (X86Reg::isGp(o1) && (o0.isMem())))
+        _cc->emit(X86Inst::kIdMov, o0, o1);
+      else
+        emit2x(X86Inst::kIdMovd, o0, o1);
+      break;
+
+    case kInstCodeFetch64:
+    case kInstCodeStore64:
+      // A pointer-sized GP register is fetched when accessing SoA columns.
+      if (X86Reg::isGp(o0) || X86Reg::isGp(o1))
+        _cc->emit(X86Inst::kIdMov, o0, o1);
+      else
+        emit2x(X86Inst::kIdMovq, o0, o1);
+      break;
+
+    case kInstCodeFetch96: {
+      X86Mem mem = o1.as<X86Mem>();
+      emit2x(X86Inst::kIdMovq, o0, mem);
+      mem.addOffsetLo32(8);
+      emit2x(X86Inst::kIdMovd, _tmpXmm0, mem);
+      emit3i(X86Inst::kIdPunpcklqdq, o0, o0, _tmpXmm0);
+      break;
+    }
+
+    case kInstCodeStore96: {
+      X86Mem mem = o0.as<X86Mem>();
+      emit2x(X86Inst::kIdMovq, mem, o1);
+      _cc->emit(getVecInstId(X86Inst::kIdPshufd), _tmpXmm0, o1, x86::shufImm(1, 0, 3, 2));
+      mem.addOffsetLo32(8);
+      emit2x(X86Inst::kIdMovd, mem, _tmpXmm0);
+      break;
+    }
+
+    case kInstCodeFetch128:
+    case kInstCodeStore128:
+      emit2x(X86Inst::kIdMovups, o0, o1);
+      break;
+
+    // 192-bit and 256-bit data only exist if AVX is enabled, see `CodeGen::hasV256()`.
+    case kInstCodeFetch192: {
+      X86Mem mem = o1.as<X86Mem>();
+      emit2x(X86Inst::kIdMovups, mpLoHalf(o0), mem);
+      mem.addOffsetLo32(16);
+      emit2x(X86Inst::kIdMovsd, _tmpXmm0, mem);
+      _cc->emit(X86Inst::kIdVinsertf128, o0, o0, _tmpXmm0, 1);
+      break;
+    }
+
+    case kInstCodeStore192: {
+      X86Mem mem = o0.as<X86Mem>();
+      emit2x(X86Inst::kIdMovups, mem, mpLoHalf(o1));
+      _cc->emit(X86Inst::kIdVextractf128, _tmpXmm0, o1, 1);
+      mem.addOffsetLo32(16);
+      emit2x(X86Inst::kIdMovsd, mem, _tmpXmm0);
+      break;
+    }
+
+    case kInstCodeFetch256:
+    case kInstCodeStore256:
+      _cc->emit(X86Inst::kIdVmovups, o0, o1);
+      break;
+  }
+}
+
+void IRToX86::emitCopy(uint32_t size, const Operand& o0, const Operand& o1) {
+  if (X86Reg::isGp(o0) && X86Reg::isGp(o1))
+    _cc->emit(X86Inst::kIdMov, o0, o1);
+  else if (X86Reg::isGp(o0) || X86Reg::isGp(o1))
+    emit2x(size <= 4 ? X86Inst::kIdMovd : X86Inst::kIdMovq, o0, o1);
+  else if (X86Reg::isYmm(o0) || X86Reg::isYmm(o1))
+    _cc->emit(X86Inst::kIdVmovaps, o0, o1);
+  else
+    emit2x(X86Inst::kIdMovaps, o0, o1);
+}
+
+void IRToX86::emitMinMaxi(uint32_t cmovId, const Operand& o0, const Operand& o1, const Operand& o2) {
+  // `o1` is moved to `o0` first, which would destroy `o2`, min/max commutes.
+  if (o2.isReg() && o2.getId() == o0.getId()) {
+    emitMinMaxi(cmovId, o0, o2, o1);
+    return;
+  }
+
+  Operand src = o2;
+  if (src.isImm()) {
+    src = _cc->newI32("tmp");
+    _cc->emit(X86Inst::kIdMov, src, o2);
+  }
+
+  if (!o1.isReg() || o1.getId() != o0.getId())
+    _cc->emit(X86Inst::kIdMov, o0, o1);
+  _cc->emit(X86Inst::kIdCmp, o0, src);
+  _cc->emit(cmovId, o0, src);
+}
+
+void IRToX86::emitGather(uint32_t instCode, const Operand& o0, IRMem* mem) {
+  uint32_t size = (instCode & kInstCodeMask) == kInstCodeGather32 ? 4 : 8;
+  uint32_t count = (X86Reg::isYmm(o0) ? 32 : 16) / size;
+  uint32_t i;
+
+  X86Gp base = varAsPtr(mem->getBase());
+  X86Xmm index = varAsXmm(mem->getIndex());
+  uint32_t shift = mem->getShift();
+  int32_t offset = mem->getOffset();
+
+  if (_enableAVX2) {
+    // The destination, the index, and the mask of a gather must be distinct,
+    // the destination is cleared first so it's live together with the mask.
+    Operand out = X86Reg::isYmm(o0) ? Operand(_cc->newYmm("gather")) : Operand(_cc->newXmm("gather"));
+    Operand msk = X86Reg::isYmm(o0) ? Operand(_cc->newYmm("mask")) : Operand(_cc->newXmm("mask"));
+
+    _cc->emit(X86Inst::kIdVpxor, out, out, out);
+    _cc->emit(X86Inst::kIdVpcmpeqd, msk, msk, msk);
+    _cc->emit(size == 4 ? X86Inst::kIdVpgatherdd : X86Inst::kIdVpgatherdq, out, x86::ptr(base, index, shift, offset), msk);
+    _cc->emit(X86Inst::kIdVmovaps, o0, out);
+    return;
+  }
+
+  // Each element is fetched by its index moved to a GP register. All indexes
+  // are moved first, the destination can share its register with the index.
+  X86Gp gp[4];
+  X86Xmm element[4];
+
+  for (i = 0; i < count; i++) {
+    gp[i] = _cc->newIntPtr("index");
+    if (i == 0) {
+      emit2x(X86Inst::kIdMovd, gp[i].r32(), index);
+    }
+    else {
+      _cc->emit(getVecInstId(X86Inst::kIdPshufd), _tmpXmm0, index, x86::shufImm(i, i, i, i));
+      emit2x(X86Inst::kIdMovd, gp[i].r32(), _tmpXmm0);
+    }
+  }
+
+  for (i = 0; i < count; i++) {
+    element[i] = i == 0 ? x86::xmm(o0.getId()) : _cc->newXmm("element");
+    emit2x(size == 4 ? X86Inst::kIdMovd : X86Inst::kIdMovq, element[i], x86::ptr(base, gp[i], shift, offset));
+  }
+
+  if (size == 4) {
+    emit3i(X86Inst::kIdPunpckldq, element[0], element[0], element[1]);
+    emit3i(X86Inst::kIdPunpckldq, element[2], element[2], element[3]);
+    emit3i(X86Inst::kIdPunpcklqdq, element[0], element[0], element[2]);
+  }
+  else {
+    emit3i(X86Inst::kIdPunpcklqdq, element[0], element[0], element[1]);
+    if (count == 4) {
+      emit3i(X86Inst::kIdPunpcklqdq, element[2], element[2], element[3]);
+      _cc->emit(X86Inst::kIdVinsertf128, o0, o0, element[2], 1);
+    }
+  }
+}
+
+void IRToX86::emitCvthtof(const Operand& o0, const Operand& o1) {
+  if (_enableF16C) {
+    _cc->emit(X86Inst::kIdVcvtph2ps, o0, o1);
+    return;
+  }
+
+  // Moving the exponent and mantissa of a half to the position of a float and
+  // scaling it by 2^112 rebiases the exponent, which converts subnormals too.
+  // Infinities and NaNs get the maximum exponent and the sign is merged last.
+  X86Xmm h = _cc->newXmm("half");
+  X86Xmm m = _cc->newXmm("expMant");
+  X86Xmm t = _cc->newXmm("infNan");
+
+  emit3i(X86Inst::kIdPmovzxwd, h, o1, o1);
+  emit3i(X86Inst::kIdPand, m, h, getConstantU32x4(0x7FFF));
+  emit3i(X86Inst::kIdPxor, h, h, m);
+  emit3i(X86Inst::kIdPslld, h, h, imm(16));
+
+  emit3i(X86Inst::kIdPcmpgtd, t, m, getConstantU32x4(0x7BFF));
+  emit3i(X86Inst::kIdPand, t, t, getConstantU32x4(0x7F800000));
+  emit3i(X86Inst::kIdPor, h, h, t);
+
+  emit3i(X86Inst::kIdPslld, m, m, imm(13));
+  emit3f(X86Inst::kIdMulps, o0, m, getConstantU32x4(0x77800000));
+  emit3f(X86Inst::kIdOrps, o0, o0, h);
+}
+
+void IRToX86::emitCvtftoh(const Operand& o0, const Operand& o1) {
+  if (_enableF16C) {
+    _cc->emit(X86Inst::kIdVcvtps2ph, o0, o1, 0);
+    return;
+  }
+
+  // Floats that are normal halves are rounded to the nearest even by adding a
+  // bias to their bits, smaller ones by adding a magic float that leaves the
+  // mantissa of the subnormal half in low bits. Floats that overflow become
+  // infinities and NaNs are kept quiet. Results are 32-bit, the sign extended
+  // by `psrad` goes through the signed saturation of `packssdw`.
+  X86Xmm sign = _cc->newXmm("sign");
+  X86Xmm a = _cc->newXmm("abs");
+  X86Xmm special = _cc->newXmm("special");
+  X86Xmm isRegular = _cc->newXmm("isRegular");
+  X86Xmm isSubnormal = _cc->newXmm("isSubnormal");
+  X86Xmm sub = _cc->newXmm("subnormal");
+  X86Xmm odd = _cc->newXmm("odd");
+  X86Xmm normal = _cc->newXmm("normal");
+
+  X86Mem magic = getConstantU32x4(0x3F000000);
+
+  emit3i(X86Inst::kIdPand, sign, o1, getConstantU32x4(0x80000000));
+  emit3i(X86Inst::kIdPxor, a, o1, sign);
+
+  emit3f(X86Inst::kIdCmpps, special, a, a, 3);
+  emit3i(X86Inst::kIdPand, special, special, getConstantU32x4(0x0200));
+  emit3i(X86Inst::kIdPor, special, special, getConstantU32x4(0x7C00));
+
+  emit3i(X86Inst::kIdPcmpgtd, isRegular, getConstantU32x4(0x47800000), a);
+  emit3i(X86Inst::kIdPcmpgtd, isSubnormal, getConstantU32x4(0x38800000), a);
+
+  emit3f(X86Inst::kIdAddps, sub, a, magic);
+  emit3i(X86Inst::kIdPsubd, sub, sub, magic);
+
+  emit3i(X86Inst::kIdPslld, odd, a, imm(18));
+  emit3i(X86Inst::kIdPsrad, odd, odd, imm(31));
+  emit3i(X86Inst::kIdPaddd, normal, a, getConstantU32x4(0xC8000FFF));
+  emit3i(X86Inst::kIdPsubd, normal, normal, odd);
+  emit3i(X86Inst::kIdPsrld, normal, normal, imm(13));
+
+  emit3i(X86Inst::kIdPand, sub, sub, isSubnormal);
+  emit3i(X86Inst::kIdPandn, isSubnormal, isSubnormal, normal);
+  emit3i(X86Inst::kIdPor, sub, sub, isSubnormal);
+
+  emit3i(X86Inst::kIdPand, sub, sub, isRegular);
+  emit3i(X86Inst::kIdPandn, isRegular, isRegular, special);
+  emit3i(X86Inst::kIdPor, sub, sub, isRegular);
+
+  emit3i(X86Inst::kIdPsrad, sign, sign, imm(16));
+  emit3i(X86Inst::kIdPor, sub, sub, sign);
+  emit3i(X86Inst::kIdPackssdw, o0, sub, sub);
+}
+
 Error IRToX86::compileIRAsFunc(IRBuilder* ir) {
   uint32_t i;
   uint32_t numSlots = ir->getNumSlots();
@@ -112,14 +949,256 @@ Error IRToX86::compileIRAsFunc(IRBuilder* ir) {
     proto.addArgT<void*>();
   }
 
-  _cc->addFunc(proto);
+  _func = _cc->addFunc(proto);
   _functionBody = _cc->getCursor();
 
   for (i = 0; i < numSlots; i++) {
     _cc->setArg(i, _data[i]);
+
+    // A single call combines reductions with the data directly.
+    for (uint32_t op = kReduceSum; op < kReduceCount; op++) {
+      IRReg* reducePtr = ir->_reducePtrs[i][op];
+      if (reducePtr) reducePtr->setJitId(_data[i].getId());
+    }
+  }
+
+  // A single call processes the first `laneCount` elements of all columns.
+  if (ir->hasLanes()) {
+    X86Gp laneIndex = varAsPtr(ir->getLaneIndex());
+    _cc->xor_(laneIndex, laneIndex);
+  }
+
+  X86Mem savedMxcsr;
+  if (_enableFpEnv) {
+    savedMxcsr = _cc->newStack(4, 4, "savedMxcsr");
+    emitFpEnvEnter(savedMxcsr);
+  }
+
+  CounterRegs counterRegs;
+  if (_counters != nullptr)
+    emitCountersEnter(counterRegs, imm(1));
+
+  MPSL_PROPAGATE(compileIRAsPart(ir));
+
+  if (_counters != nullptr)
+    emitCountersLeave(counterRegs);
+
+  // Clear the upper halves of YMM registers, SSE code that follows would pay
+  // for the state transition otherwise.
+  if (_enableAVX)
+    _cc->emit(X86Inst::kIdVzeroupper);
+
+  if (_enableFpEnv)
+    emitFpEnvLeave(savedMxcsr);
+
+  X86Gp errCode = _cc->newInt32("err");
+  _cc->xor_(errCode, errCode);
+  _cc->ret(errCode);
+
+  _cc->endFunc();
+
+  if (_constLabel.isValid())
+    _cc->embedConstPool(_constLabel, _constPool);
+
+  return kErrorOk;
+}
+
+Error IRToX86::compileIRAsCallee(IRFunc* func) {
+  CCFunc* node = funcAsNode(func);
+  if (node == nullptr)
+    return MPSL_TRACE_ERROR(kErrorNoMemory);
+
+  _func = _cc->addFunc(node);
+  _functionBody = _cc->getCursor();
+
+  const IRRegs& args = func->getArgs();
+  for (size_t i = 0, count = args.getLength(); i < count; i++)
+    _cc->setArg(static_cast<uint32_t>(i), varAsReg(args[i]));
+
+  // The exit ends with `ret`, the upper halves of YMM registers are cleared
+  // by the caller.
+  MPSL_PROPAGATE(compileIRAsPart(func->getBody()));
+  _cc->endFunc();
+
+  if (_constLabel.isValid())
+    _cc->embedConstPool(_constLabel, _constPool);
+
+  return kErrorOk;
+}
+
+// Collect cache lines of each slot read by fetches of `ir`, each bit of `lines`
+// is a 64-byte line at the offset of the record. Only offsets within the first
+// 32 lines are prefetched.
+static void mpCollectPrefetchLines(IRBuilder* ir, uint32_t* lines) noexcept {
+  IRBlocks& blocks = ir->getBlocks();
+  uint32_t numSlots = ir->getNumSlots();
+
+  for (size_t i = 0, count = blocks.getLength(); i < count; i++) {
+    IRBlock* block = blocks[i];
+    if (block == nullptr)
+      continue;
+
+    IRBody& body = block->getBody();
+    for (size_t j = 0, len = body.getLength(); j < len; j++) {
+      IRInst* inst = body[j];
+      uint32_t instCode = inst->getInstCode() & kInstCodeMask;
+
+      if (!mpInstInfo[instCode].isFetch() || inst->getOpCount() != 2 || !inst->getOperand(1)->isMem())
+        continue;
+
+      const IRMem* mem = inst->getOperand(1)->as<IRMem>();
+      int32_t offset = mem->getOffset();
+      uint32_t size = mpFetchSize(instCode);
+
+      if (mem->hasIndex() || offset < 0 || offset + static_cast<int32_t>(size) > 32 * 64)
+        continue;
+
+      for (uint32_t slot = 0; slot < numSlots; slot++) {
+        if (mem->getBase() != ir->getDataPtr(slot))
+          continue;
+
+        lines[slot] |= 1U << (static_cast<uint32_t>(offset) / 64);
+        lines[slot] |= 1U << ((static_cast<uint32_t>(offset) + size - 1) / 64);
+      }
+    }
+  }
+}
+
+Error IRToX86::compileIRAsBatch(IRBuilder* ir) {
+  uint32_t i;
+  uint32_t numSlots = ir->getNumSlots();
+
+  FuncSignatureX proto;
+  proto.setRetT<unsigned int>();
+  proto.addArgT<void*>();
+  proto.addArgT<void*>();
+  proto.addArgT<size_t>();
+  proto.addArgT<size_t>();
+
+  X86Gp args = _cc->newIntPtr("args");
+  X86Gp strides = _cc->newIntPtr("strides");
+  X86Gp start = _cc->newIntPtr("start");
+  X86Gp count = _cc->newIntPtr("count");
+
+  for (i = 0; i < numSlots; i++) {
+    _data[i] = _cc->newIntPtr("ptr%u", i);
+    _stride[i] = _cc->newIntPtr("stride%u", i);
+    ir->getDataPtr(i)->setJitId(_data[i].getId());
+  }
+
+  _func = _cc->addFunc(proto);
+  _functionBody = _cc->getCursor();
+
+  _cc->setArg(0, args);
+  _cc->setArg(1, strides);
+  _cc->setArg(2, start);
+  _cc->setArg(3, count);
+
+  Label L_Loop = _cc->newLabel();
+  Label L_Done = _cc->newLabel();
+
+  // Everything emitted before `L_Loop` (including the constant pool pointer
+  // that is inserted at `_functionBody`) runs only once per batch.
+  for (i = 0; i < numSlots; i++) {
+    int32_t disp = static_cast<int32_t>(i * sizeof(void*));
+    _cc->mov(_data[i], x86::ptr(args, disp));
+    _cc->mov(_stride[i], x86::ptr(strides, disp));
+  }
+
+  if (ir->hasReductions())
+    MPSL_PROPAGATE(initAccumulators(ir));
+
+  // The environment is set once per batch, not per record.
+  X86Mem savedMxcsr;
+  if (_enableFpEnv) {
+    savedMxcsr = _cc->newStack(4, 4, "savedMxcsr");
+    emitFpEnvEnter(savedMxcsr);
+  }
+
+  // A batch is counted as a single call of `count` records.
+  CounterRegs counterRegs;
+  if (_counters != nullptr)
+    emitCountersEnter(counterRegs, count);
+
+  _cc->test(count, count);
+  _cc->jz(L_Done);
+
+  if (ir->hasLanes()) {
+    // SoA - `start` and `count` describe elements and every iteration processes
+    // `laneCount` of them. Data pointers stay and strides are ignored, the
+    // columns are indexed by the lane index instead.
+    uint32_t laneCount = ir->getLaneCount();
+    X86Gp laneIndex = varAsPtr(ir->getLaneIndex());
+
+    _cc->mov(laneIndex, start);
+    _cc->add(count, start);
+
+    _cc->bind(L_Loop);
+    MPSL_PROPAGATE(compileIRAsPart(ir));
+
+    _cc->add(laneIndex, laneCount);
+    _cc->cmp(laneIndex, count);
+    _cc->jb(L_Loop);
+  }
+  else {
+    // AoS - advance all data pointers to the `start` record.
+    for (i = 0; i < numSlots; i++) {
+      X86Gp offset = _cc->newIntPtr("offset%u", i);
+      _cc->mov(offset, _stride[i]);
+      _cc->imul(offset, start);
+      _cc->add(_data[i], offset);
+    }
+
+    // The distance of prefetched records in bytes is kept in a register by
+    // each slot that is read, the distance is a power of 2.
+    uint32_t lines[Globals::kMaxArgumentsCount] = { 0 };
+    X86Gp ahead[Globals::kMaxArgumentsCount];
+
+    if (_prefetchDistance != 0) {
+      mpCollectPrefetchLines(ir, lines);
+
+      for (i = 0; i < numSlots; i++) {
+        if (lines[i] == 0)
+          continue;
+
+        ahead[i] = _cc->newIntPtr("ahead%u", i);
+        _cc->mov(ahead[i], _stride[i]);
+        _cc->shl(ahead[i], static_cast<int>(mpBitCtz(_prefetchDistance)));
+      }
+    }
+
+    _cc->bind(L_Loop);
+    if (_prefetchDistance != 0)
+      emitPrefetches(ir, lines, ahead);
+    MPSL_PROPAGATE(compileIRAsPart(ir));
+
+    for (i = 0; i < numSlots; i++)
+      _cc->add(_data[i], _stride[i]);
+
+    _cc->sub(count, 1);
+    _cc->jnz(L_Loop);
   }
+  _cc->bind(L_Done);
+
+  // Reductions are stored once per batch.
+  if (!_accumulators.isEmpty())
+    storeAccumulators(args);
+
+  // Non-temporal stores are weakly ordered, the fence orders them before the
+  // stores that follow the batch (e.g. a flag telling other threads it's done).
+  if (_streamStores)
+    _cc->emit(X86Inst::kIdSfence);
 
-  compileIRAsPart(ir);
+  if (_counters != nullptr)
+    emitCountersLeave(counterRegs);
+
+  // Clear the upper halves of YMM registers, SSE code that follows would pay
+  // for the state transition otherwise.
+  if (_enableAVX)
+    _cc->emit(X86Inst::kIdVzeroupper);
+
+  if (_enableFpEnv)
+    emitFpEnvLeave(savedMxcsr);
 
   X86Gp errCode = _cc->newInt32("err");
   _cc->xor_(errCode, errCode);
@@ -133,25 +1212,147 @@ Error IRToX86::compileIRAsFunc(IRBuilder* ir) {
   return kErrorOk;
 }
 
+void IRToX86::emitPrefetches(IRBuilder* ir, const uint32_t* lines, const X86Gp* ahead) {
+  for (uint32_t slot = 0, numSlots = ir->getNumSlots(); slot < numSlots; slot++) {
+    uint32_t mask = lines[slot];
+
+    while (mask != 0) {
+      uint32_t line = mpBitCtz(mask);
+      mask &= mask - 1;
+      _cc->emit(X86Inst::kIdPrefetcht0, x86::ptr(_data[slot], ahead[slot], 0, static_cast<int32_t>(line * 64)));
+    }
+  }
+}
+
+Error IRToX86::initAccumulators(IRBuilder* ir) {
+  IRBlocks& blocks = ir->getBlocks();
+
+  for (size_t i = 0, count = blocks.getLength(); i < count; i++) {
+    IRBlock* block = blocks[i];
+    if (block == nullptr)
+      continue;
+
+    IRBody& body = block->getBody();
+    for (size_t j = 0, len = body.getLength(); j < len; j++) {
+      IRInst* inst = body[j];
+      const InstInfo& info = mpInstInfo[inst->getInstCode() & kInstCodeMask];
+
+      if (!info.isFetch() && !info.isStore())
+        continue;
+
+      // Fetch is `reg, mem` and store is `mem, reg`.
+      uint32_t memIndex = info.isStore() ? 0 : 1;
+      if (inst->getOpCount() != 2 || !inst->getOperand(memIndex)->isMem())
+        continue;
+
+      const IRMem* mem = inst->getOperand(memIndex)->as<IRMem>();
+      if (ir->getReduceOp(mem->getBase()) == kReduceNone || getAccumulator(ir, mem) != nullptr)
+        continue;
+
+      uint32_t fetchCode = inst->getInstCode() & kInstCodeMask;
+      if (info.isStore())
+        fetchCode = fetchCode - kInstCodeStore32 + kInstCodeFetch32;
+
+      uint32_t size = mpFetchSize(fetchCode);
+      if (size == 0)
+        return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+      // Scalar integers live in GP registers.
+      IRObject* other = inst->getOperand(memIndex ^ 1);
+      bool isGp = other->isReg() && other->as<IRReg>()->getReg() == IRReg::kKindGp;
+
+      // The pointer is never dereferenced, but operands are still built from it.
+      mem->getBase()->setJitId(_data[ir->getReduceSlot(mem->getBase())].getId());
+
+      Accumulator acc;
+      acc.slot = ir->getReduceSlot(mem->getBase());
+      acc.offset = mem->getOffset();
+      acc.fetchCode = fetchCode;
+
+      if (isGp && size == 4)
+        acc.reg = _cc->newI32("acc%u", acc.slot);
+      else if (size > 16)
+        acc.reg = _cc->newYmm("acc%u", acc.slot);
+      else
+        acc.reg = _cc->newXmm("acc%u", acc.slot);
+
+      // Data pointers are not advanced yet.
+      emitLoadStore(fetchCode, acc.reg, x86::ptr(_data[acc.slot], acc.offset));
+      MPSL_PROPAGATE(_accumulators.append(_heap, acc));
+    }
+  }
+
+  return kErrorOk;
+}
+
+void IRToX86::storeAccumulators(const X86Gp& args) {
+  X86Gp base = _cc->newIntPtr("reduce");
+  uint32_t baseSlot = kInvalidDataSlot;
+
+  for (size_t i = 0, count = _accumulators.getLength(); i < count; i++) {
+    const Accumulator& acc = _accumulators[i];
+
+    if (acc.slot != baseSlot) {
+      _cc->mov(base, x86::ptr(args, static_cast<int32_t>(acc.slot * sizeof(void*))));
+      baseSlot = acc.slot;
+    }
+
+    uint32_t storeCode = acc.fetchCode - kInstCodeFetch32 + kInstCodeStore32;
+    emitLoadStore(storeCode, x86::ptr(base, acc.offset), acc.reg);
+  }
+}
+
+IRToX86::Accumulator* IRToX86::getAccumulator(IRBuilder* ir, const IRMem* mem) {
+  uint32_t slot = ir->getReduceSlot(mem->getBase());
+
+  for (size_t i = 0, count = _accumulators.getLength(); i < count; i++) {
+    Accumulator& acc = _accumulators[i];
+    if (acc.slot == slot && acc.offset == mem->getOffset())
+      return &acc;
+  }
+
+  return nullptr;
+}
+
+// A block is pending if it's reachable and was not assembled yet. Blocks that
+// have no predecessors (except the entry) follow `return`, `break`, etc...
+static MPSL_INLINE bool mpIsPendingBlock(IRBuilder* ir, IRBlock* block) noexcept {
+  return block != nullptr && !block->isAssembled() &&
+         (block->hasPredecessors() || block == ir->getEntry());
+}
+
+static MPSL_INLINE bool mpIsExitBlock(IRBuilder* ir, IRBlock* block) noexcept {
+  return ir->getExits().contains(block);
+}
+
 Error IRToX86::compileIRAsPart(IRBuilder* ir) {
   // Compile the entry block and all other reacheable blocks.
   IRBlock* block = ir->getEntry();
-  MPSL_PROPAGATE(compileConsecutiveBlocks(block));
+  MPSL_PROPAGATE(compileConsecutiveBlocks(ir, block));
 
   // Compile all remaining, reacheable, and non-assembled blocks.
   IRBlocks& blocks = ir->getBlocks();
-  size_t count = blocks.getLength();
+  size_t i, count = blocks.getLength();
 
-  for (size_t i = 0; i < count; i++) {
+  for (i = 0; i < count; i++) {
     block = blocks[i];
+    if (mpIsPendingBlock(ir, block) && !mpIsExitBlock(ir, block))
+      MPSL_PROPAGATE(compileConsecutiveBlocks(ir, block));
+  }
+
+  // Exits are always compiled last, the code that follows the IR (the end of
+  // the function or the next iteration of a batch) is their fall-through.
+  IRBlocks& exits = ir->getExits();
+  for (i = 0, count = exits.getLength(); i < count; i++) {
+    block = exits[i];
     if (!block->isAssembled())
-      compileConsecutiveBlocks(block);
+      MPSL_PROPAGATE(compileBasicBlock(block, nullptr));
   }
 
   return kErrorOk;
 }
 
-Error IRToX86::compileConsecutiveBlocks(IRBlock* block) {
+Error IRToX86::compileConsecutiveBlocks(IRBuilder* ir, IRBlock* block) {
   while (block) {
     const IRBody& body = block->getBody();
     IRBlock* next = nullptr;
@@ -171,7 +1372,19 @@ Error IRToX86::compileConsecutiveBlocks(IRBlock* block) {
       }
     }
 
-    compileBasicBlock(block, next);
+    // An exit can only be placed here if nothing else has to be compiled.
+    if (next && mpIsExitBlock(ir, next)) {
+      IRBlocks& blocks = ir->getBlocks();
+      for (size_t i = 0, count = blocks.getLength(); i < count; i++) {
+        IRBlock* other = blocks[i];
+        if (other != block && mpIsPendingBlock(ir, other) && !mpIsExitBlock(ir, other)) {
+          next = nullptr;
+          break;
+        }
+      }
+    }
+
+    MPSL_PROPAGATE(compileBasicBlock(block, next));
     block = next;
   }
 
@@ -180,7 +1393,12 @@ Error IRToX86::compileConsecutiveBlocks(IRBlock* block) {
 
 Error IRToX86::compileBasicBlock(IRBlock* block, IRBlock* next) {
   IRBody& body = block->getBody();
-  Operand asmOp[3];
+  Operand asmOp[IRInst::kMaxOperands];
+
+  if (block->hasPredecessors())
+    _cc->bind(blockAsLabel(block));
+
+  MPSL_PROPAGATE(optimizeBlock(block));
 
   for (size_t i = 0, len = body.getLength(); i < len; i++) {
     IRInst* inst = body[i];
@@ -190,14 +1408,20 @@ Error IRToX86::compileBasicBlock(IRBlock* block, IRBlock* next) {
 
     const InstInfo& info = mpInstInfo[inst->getInstCode() & kInstCodeMask];
 
+    // Calls have a variable number of operands.
+    if (info.isCall()) {
+      MPSL_PROPAGATE(emitCall(inst));
+      continue;
+    }
+
     for (uint32_t opIndex = 0; opIndex < opCount; opIndex++) {
       IRObject* irOp = irOpArray[opIndex];
 
       switch (irOp->getObjectType()) {
         case IRObject::kTypeReg: {
           IRReg* var = static_cast<IRReg*>(irOp);
-          if (var->getReg() == IRReg::kKindGp ) asmOp[opIndex] = varAsI32(var);
-          if (var->getReg() == IRReg::kKindVec) asmOp[opIndex] = varAsXmm(var);
+          if (var->getReg() == IRReg::kKindGp ) asmOp[opIndex] = var->getWidth() > 4 ? varAsPtr(var) : varAsI32(var);
+          if (var->getReg() == IRReg::kKindVec) asmOp[opIndex] = var->getWidth() > 16 ? Operand(varAsYmm(var)) : Operand(varAsXmm(var));
           break;
         }
 
@@ -206,8 +1430,13 @@ Error IRToX86::compileBasicBlock(IRBlock* block, IRBlock* next) {
           IRReg* base = mem->getBase();
           IRReg* index = mem->getIndex();
 
-          // TODO: index.
-          asmOp[opIndex] = x86::ptr(varAsPtr(base), mem->getOffset());
+          // Gathers are indexed by XMM registers, see `emitGather()`.
+          if (index && index->getReg() == IRReg::kKindVec)
+            asmOp[opIndex] = x86::ptr(varAsPtr(base), varAsXmm(index), mem->getShift(), mem->getOffset());
+          else if (index)
+            asmOp[opIndex] = x86::ptr(varAsPtr(base), varAsPtr(index), mem->getShift(), mem->getOffset());
+          else
+            asmOp[opIndex] = x86::ptr(varAsPtr(base), mem->getOffset());
           break;
         }
 
@@ -224,56 +1453,121 @@ Error IRToX86::compileBasicBlock(IRBlock* block, IRBlock* next) {
         }
 
         case IRObject::kTypeBlock: {
-          // TODO:
+          asmOp[opIndex] = blockAsLabel(static_cast<IRBlock*>(irOp));
           break;
         }
       }
     }
 
+    // Reductions are kept in registers by a batch, see `initAccumulators()`.
+    if (!_accumulators.isEmpty() && (info.isFetch() || info.isStore()) && opCount == 2) {
+      uint32_t memIndex = info.isStore() ? 0 : 1;
+      Accumulator* acc = irOpArray[memIndex]->isMem()
+        ? getAccumulator(block->getIR(), irOpArray[memIndex]->as<IRMem>()) : nullptr;
+
+      if (acc != nullptr) {
+        uint32_t size = mpFetchSize(acc->fetchCode);
+        if (info.isStore())
+          emitCopy(size, acc->reg, asmOp[1]);
+        else
+          emitCopy(size, asmOp[0], acc->reg);
+        continue;
+      }
+    }
+
+    // Zero constants are materialized by a zero idiom instead of a load.
+    if (info.isFetch() && opCount == 2 && irOpArray[1]->isImm()) {
+      const Value& value = static_cast<IRImm*>(irOpArray[1])->getValue();
+      uint32_t size = mpFetchSize(inst->getInstCode());
+      bool isZero = size != 0;
+
+      for (uint32_t k = 0; k < (size + 3) / 4; k++)
+        isZero &= value.u[k] == 0;
+
+      if (isZero) {
+        emitZero(asmOp[0]);
+        continue;
+      }
+    }
+
 #define OP_1(id) (kInstCode##id | kInstVec0)
 #define OP_X(id) (kInstCode##id | kInstVec128)
 #define OP_Y(id) (kInstCode##id | kInstVec256)
     switch (inst->getInstCode()) {
-      case OP_1(Fetch32):
-      case OP_1(Store32):
-        if ((X86Reg::isGp(asmOp[0]) && (asmOp[1].isMem() || X86Reg::isGp(asmOp[1]))) ||
-            (X86Reg::isGp(asmOp[1]) && (asmOp[0].isMem())))
-          _cc->emit(X86Inst::kIdMov, asmOp[0], asmOp[1]);
-        else
-          _cc->emit(X86Inst::kIdMovd, asmOp[0], asmOp[1]);
+      case OP_1(Jmp):
+        if (irOpArray[0] != next)
+          _cc->jmp(asmOp[0].as<Label>());
         break;
 
-      case OP_1(Fetch64):
-      case OP_1(Store64):
-        _cc->emit(X86Inst::kIdMovq, asmOp[0], asmOp[1]);
+      case OP_1(Ret):
+        _cc->ret(asmOp[0].as<X86Reg>());
         break;
 
-      case OP_1(Fetch96): {
-        X86Mem mem = asmOp[1].as<X86Mem>();
-        _cc->emit(X86Inst::kIdMovq, asmOp[0], mem);
-        mem.addOffsetLo32(8);
-        _cc->emit(X86Inst::kIdMovd, _tmpXmm0, mem);
-        _cc->emit(X86Inst::kIdPunpcklqdq, asmOp[0], _tmpXmm0);
-        break;
-      }
+      case OP_1(Jnz): {
+        // Conditions are either GP registers or masks held by XMM registers.
+        X86Gp cond;
+        if (X86Reg::isGp(asmOp[0])) {
+          cond = asmOp[0].as<X86Gp>();
+        }
+        else {
+          cond = _cc->newI32("cond");
+          emit2x(X86Inst::kIdMovd, cond, x86::xmm(asmOp[0].getId()));
+        }
+        _cc->test(cond, cond);
 
-      case OP_1(Store96): {
-        X86Mem mem = asmOp[0].as<X86Mem>();
-        _cc->emit(X86Inst::kIdMovq, mem, asmOp[1]);
-        _cc->emit(X86Inst::kIdPshufd, _tmpXmm0, asmOp[1], x86::shufImm(1, 0, 3, 2));
-        mem.addOffsetLo32(8);
-        _cc->emit(X86Inst::kIdMovd, mem, _tmpXmm0);
+        if (irOpArray[1] == next) {
+          _cc->jz(asmOp[2].as<Label>());
+        }
+        else {
+          _cc->jnz(asmOp[1].as<Label>());
+          if (irOpArray[2] != next)
+            _cc->jmp(asmOp[2].as<Label>());
+        }
         break;
       }
 
+      case OP_1(Fetch32):
+      case OP_1(Store32):
+      case OP_1(Fetch64):
+      case OP_1(Store64):
+      case OP_1(Fetch96):
+      case OP_1(Store96):
       case OP_1(Fetch128):
       case OP_1(Store128):
-        _cc->emit(X86Inst::kIdMovups, asmOp[0], asmOp[1]);
+      case OP_1(Fetch192):
+      case OP_1(Store192):
+      case OP_1(Fetch256):
+      case OP_1(Store256):
+        // Aligned vectors written by a streaming batch bypass the cache.
+        if (_streamStores && asmOp[1].isReg() && mpCanStreamStore(inst->getInstCode() & kInstCodeMask, irOpArray[0]->as<IRMem>()))
+          emit2x(X86Inst::kIdMovntps, asmOp[0], asmOp[1]);
+        else
+          emitLoadStore(inst->getInstCode(), asmOp[0], asmOp[1]);
+        break;
+
+      // Scalar integers live in GP registers, `movd/movq` only works with XMM.
+      // A copy to a pointer-sized register zero extends it, see `CodeGen::onIndex()`.
+      case OP_1(Mov32):
+        if (X86Reg::isGp(asmOp[0]) && X86Reg::isGp(asmOp[1]))
+          _cc->emit(X86Inst::kIdMov, asmOp[0].as<X86Gp>().r32(), asmOp[1].as<X86Gp>().r32());
+        else
+          emit2x(X86Inst::kIdMovd, asmOp[0], asmOp[1]);
+        break;
+
+      case OP_1(Mov64):
+        if (X86Reg::isGp(asmOp[0]) && X86Reg::isGp(asmOp[1]))
+          _cc->emit(X86Inst::kIdMov, asmOp[0], asmOp[1]);
+        else
+          emit2x(X86Inst::kIdMovq, asmOp[0], asmOp[1]);
+        break;
+
+      case OP_1(Gather32):
+      case OP_1(Gather64):
+        emitGather(inst->getInstCode(), asmOp[0], irOpArray[1]->as<IRMem>());
         break;
 
-      case OP_1(Mov32): emit2x(X86Inst::kIdMovd, asmOp[0], asmOp[1]); break;
-      case OP_1(Mov64): emit2x(X86Inst::kIdMovq, asmOp[0], asmOp[1]); break;
       case OP_1(Mov128): emit2x(X86Inst::kIdMovaps, asmOp[0], asmOp[1]); break;
+      case OP_1(Mov256): _cc->emit(X86Inst::kIdVmovaps, asmOp[0], asmOp[1]); break;
 
       case OP_1(Cvtitof): emit2x(X86Inst::kIdCvtsi2ss, asmOp[0], asmOp[1]); break;
       case OP_1(Cvtitod): emit2x(X86Inst::kIdCvtsi2sd, asmOp[0], asmOp[1]); break;
@@ -284,217 +1578,371 @@ Error IRToX86::compileBasicBlock(IRBlock* block, IRBlock* next) {
       case OP_1(Cvtdtoi): emit2x(X86Inst::kIdCvttsd2si, asmOp[0], asmOp[1]); break;
       case OP_1(Cvtdtof): emit2x(X86Inst::kIdCvtsd2ss, asmOp[0], asmOp[1]); break;
 
+      case OP_X(Cvtitof):
+      case OP_Y(Cvtitof): emit2x(X86Inst::kIdCvtdq2ps, asmOp[0], asmOp[1]); break;
+      case OP_X(Cvtftoi):
+      case OP_Y(Cvtftoi): emit2x(X86Inst::kIdCvttps2dq, asmOp[0], asmOp[1]); break;
+
+      case OP_X(Cvthtof): emitCvthtof(asmOp[0], asmOp[1]); break;
+      case OP_X(Cvtftoh): emitCvtftoh(asmOp[0], asmOp[1]); break;
+
       case OP_1(Addf): emit3f(X86Inst::kIdAddss, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Addf): emit3f(X86Inst::kIdAddps, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Addf):
+      case OP_Y(Addf): emit3f(X86Inst::kIdAddps, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Addd): emit3d(X86Inst::kIdAddsd, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Addd): emit3d(X86Inst::kIdAddpd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Addd):
+      case OP_Y(Addd): emit3d(X86Inst::kIdAddpd, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Subf): emit3f(X86Inst::kIdSubss, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Subf): emit3f(X86Inst::kIdSubps, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Subf):
+      case OP_Y(Subf): emit3f(X86Inst::kIdSubps, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Subd): emit3d(X86Inst::kIdSubsd, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Subd): emit3d(X86Inst::kIdSubpd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Subd):
+      case OP_Y(Subd): emit3d(X86Inst::kIdSubpd, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Mulf): emit3f(X86Inst::kIdMulss, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Mulf): emit3f(X86Inst::kIdMulps, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Mulf):
+      case OP_Y(Mulf): emit3f(X86Inst::kIdMulps, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Muld): emit3d(X86Inst::kIdMulsd, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Muld): emit3d(X86Inst::kIdMulpd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Muld):
+      case OP_Y(Muld): emit3d(X86Inst::kIdMulpd, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Divf): emit3f(X86Inst::kIdDivss, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Divf): emit3f(X86Inst::kIdDivps, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Divf):
+      case OP_Y(Divf): emit3f(X86Inst::kIdDivps, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Divd): emit3d(X86Inst::kIdDivsd, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Divd): emit3d(X86Inst::kIdDivpd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Divd):
+      case OP_Y(Divd): emit3d(X86Inst::kIdDivpd, asmOp[0], asmOp[1], asmOp[2]); break;
+
+      case OP_1(Fmaddf): emitFmadd(X86Inst::kIdVfmadd213ss, X86Inst::kIdVfmadd231ss, X86Inst::kIdMulss, X86Inst::kIdAddss, false, asmOp[0], asmOp[1], asmOp[2], asmOp[3]); break;
+      case OP_X(Fmaddf):
+      case OP_Y(Fmaddf): emitFmadd(X86Inst::kIdVfmadd213ps, X86Inst::kIdVfmadd231ps, X86Inst::kIdMulps, X86Inst::kIdAddps, false, asmOp[0], asmOp[1], asmOp[2], asmOp[3]); break;
+      case OP_1(Fmaddd): emitFmadd(X86Inst::kIdVfmadd213sd, X86Inst::kIdVfmadd231sd, X86Inst::kIdMulsd, X86Inst::kIdAddsd, true, asmOp[0], asmOp[1], asmOp[2], asmOp[3]); break;
+      case OP_X(Fmaddd):
+      case OP_Y(Fmaddd): emitFmadd(X86Inst::kIdVfmadd213pd, X86Inst::kIdVfmadd231pd, X86Inst::kIdMulpd, X86Inst::kIdAddpd, true, asmOp[0], asmOp[1], asmOp[2], asmOp[3]); break;
+
+      case OP_1(Selecti):
+      case OP_1(Selectf):
+      case OP_X(Selectf):
+      case OP_Y(Selectf): emitSelect(asmOp[0], asmOp[1], asmOp[2], asmOp[3]); break;
 
       case OP_1(Andi): emit3i(X86Inst::kIdAnd, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Andi): emit3i(X86Inst::kIdPand, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Andi):
+      case OP_Y(Andi): emit3i(X86Inst::kIdPand, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Andf):
-      case OP_X(Andf): emit3f(X86Inst::kIdAndps, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Andf):
+      case OP_Y(Andf): emit3f(X86Inst::kIdAndps, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Andd):
-      case OP_X(Andd): emit3d(X86Inst::kIdAndpd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Andd):
+      case OP_Y(Andd): emit3d(X86Inst::kIdAndpd, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Ori): emit3i(X86Inst::kIdOr, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Ori): emit3i(X86Inst::kIdPor, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Ori):
+      case OP_Y(Ori): emit3i(X86Inst::kIdPor, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Orf):
-      case OP_X(Orf): emit3f(X86Inst::kIdOrps, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Orf):
+      case OP_Y(Orf): emit3f(X86Inst::kIdOrps, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Ord):
-      case OP_X(Ord): emit3d(X86Inst::kIdOrpd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Ord):
+      case OP_Y(Ord): emit3d(X86Inst::kIdOrpd, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Xori): emit3i(X86Inst::kIdXor, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Xori): emit3i(X86Inst::kIdPxor, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Xori):
+      case OP_Y(Xori): emit3i(X86Inst::kIdPxor, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Xorf):
-      case OP_X(Xorf): emit3f(X86Inst::kIdXorps, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Xorf):
+      case OP_Y(Xorf): emit3f(X86Inst::kIdXorps, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Xord):
-      case OP_X(Xord): emit3d(X86Inst::kIdXorpd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Xord):
+      case OP_Y(Xord): emit3d(X86Inst::kIdXorpd, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Minf): emit3f(X86Inst::kIdMinss, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Minf): emit3f(X86Inst::kIdMinps, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Minf):
+      case OP_Y(Minf): emit3f(X86Inst::kIdMinps, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Mind): emit3d(X86Inst::kIdMinsd, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Mind): emit3d(X86Inst::kIdMinpd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Mind):
+      case OP_Y(Mind): emit3d(X86Inst::kIdMinpd, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Maxf): emit3f(X86Inst::kIdMaxss, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Maxf): emit3f(X86Inst::kIdMaxps, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Maxf):
+      case OP_Y(Maxf): emit3f(X86Inst::kIdMaxps, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Maxd): emit3d(X86Inst::kIdMaxsd, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Maxd): emit3d(X86Inst::kIdMaxpd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Maxd):
+      case OP_Y(Maxd): emit3d(X86Inst::kIdMaxpd, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Sqrtf): emit2x(X86Inst::kIdSqrtss, asmOp[0], asmOp[1]); break;
-      case OP_X(Sqrtf): emit2x(X86Inst::kIdSqrtps, asmOp[0], asmOp[1]); break;
+      case OP_X(Sqrtf):
+      case OP_Y(Sqrtf): emit2x(X86Inst::kIdSqrtps, asmOp[0], asmOp[1]); break;
       case OP_1(Sqrtd): emit2x(X86Inst::kIdSqrtsd, asmOp[0], asmOp[1]); break;
-      case OP_X(Sqrtd): emit2x(X86Inst::kIdSqrtpd, asmOp[0], asmOp[1]); break;
+      case OP_X(Sqrtd):
+      case OP_Y(Sqrtd): emit2x(X86Inst::kIdSqrtpd, asmOp[0], asmOp[1]); break;
 
       case OP_1(Cmpeqf): emit3f(X86Inst::kIdCmpss, asmOp[0], asmOp[1], asmOp[2], x86::kCmpEQ); break;
-      case OP_X(Cmpeqf): emit3f(X86Inst::kIdCmpps, asmOp[0], asmOp[1], asmOp[2], x86::kCmpEQ); break;
+      case OP_X(Cmpeqf):
+      case OP_Y(Cmpeqf): emit3f(X86Inst::kIdCmpps, asmOp[0], asmOp[1], asmOp[2], x86::kCmpEQ); break;
       case OP_1(Cmpeqd): emit3d(X86Inst::kIdCmpsd, asmOp[0], asmOp[1], asmOp[2], x86::kCmpEQ); break;
-      case OP_X(Cmpeqd): emit3d(X86Inst::kIdCmppd, asmOp[0], asmOp[1], asmOp[2], x86::kCmpEQ); break;
+      case OP_X(Cmpeqd):
+      case OP_Y(Cmpeqd): emit3d(X86Inst::kIdCmppd, asmOp[0], asmOp[1], asmOp[2], x86::kCmpEQ); break;
 
       case OP_1(Cmpnef): emit3f(X86Inst::kIdCmpss, asmOp[0], asmOp[1], asmOp[2], x86::kCmpNEQ); break;
-      case OP_X(Cmpnef): emit3f(X86Inst::kIdCmpps, asmOp[0], asmOp[1], asmOp[2], x86::kCmpNEQ); break;
+      case OP_X(Cmpnef):
+      case OP_Y(Cmpnef): emit3f(X86Inst::kIdCmpps, asmOp[0], asmOp[1], asmOp[2], x86::kCmpNEQ); break;
       case OP_1(Cmpned): emit3d(X86Inst::kIdCmpsd, asmOp[0], asmOp[1], asmOp[2], x86::kCmpNEQ); break;
-      case OP_X(Cmpned): emit3d(X86Inst::kIdCmppd, asmOp[0], asmOp[1], asmOp[2], x86::kCmpNEQ); break;
+      case OP_X(Cmpned):
+      case OP_Y(Cmpned): emit3d(X86Inst::kIdCmppd, asmOp[0], asmOp[1], asmOp[2], x86::kCmpNEQ); break;
 
       case OP_1(Cmpltf): emit3f(X86Inst::kIdCmpss, asmOp[0], asmOp[1], asmOp[2], x86::kCmpLT); break;
-      case OP_X(Cmpltf): emit3f(X86Inst::kIdCmpps, asmOp[0], asmOp[1], asmOp[2], x86::kCmpLT); break;
+      case OP_X(Cmpltf):
+      case OP_Y(Cmpltf): emit3f(X86Inst::kIdCmpps, asmOp[0], asmOp[1], asmOp[2], x86::kCmpLT); break;
       case OP_1(Cmpltd): emit3d(X86Inst::kIdCmpsd, asmOp[0], asmOp[1], asmOp[2], x86::kCmpLT); break;
-      case OP_X(Cmpltd): emit3d(X86Inst::kIdCmppd, asmOp[0], asmOp[1], asmOp[2], x86::kCmpLT); break;
+      case OP_X(Cmpltd):
+      case OP_Y(Cmpltd): emit3d(X86Inst::kIdCmppd, asmOp[0], asmOp[1], asmOp[2], x86::kCmpLT); break;
 
       case OP_1(Cmplef): emit3f(X86Inst::kIdCmpss, asmOp[0], asmOp[1], asmOp[2], x86::kCmpLE); break;
-      case OP_X(Cmplef): emit3f(X86Inst::kIdCmpps, asmOp[0], asmOp[1], asmOp[2], x86::kCmpLE); break;
+      case OP_X(Cmplef):
+      case OP_Y(Cmplef): emit3f(X86Inst::kIdCmpps, asmOp[0], asmOp[1], asmOp[2], x86::kCmpLE); break;
       case OP_1(Cmpled): emit3d(X86Inst::kIdCmpsd, asmOp[0], asmOp[1], asmOp[2], x86::kCmpLE); break;
-      case OP_X(Cmpled): emit3d(X86Inst::kIdCmppd, asmOp[0], asmOp[1], asmOp[2], x86::kCmpLE); break;
+      case OP_X(Cmpled):
+      case OP_Y(Cmpled): emit3d(X86Inst::kIdCmppd, asmOp[0], asmOp[1], asmOp[2], x86::kCmpLE); break;
 
       case OP_1(Cmpgtf): emit3f(X86Inst::kIdCmpss, asmOp[0], asmOp[2], asmOp[1], x86::kCmpLE); break;
-      case OP_X(Cmpgtf): emit3f(X86Inst::kIdCmpps, asmOp[0], asmOp[2], asmOp[1], x86::kCmpLE); break;
+      case OP_X(Cmpgtf):
+      case OP_Y(Cmpgtf): emit3f(X86Inst::kIdCmpps, asmOp[0], asmOp[2], asmOp[1], x86::kCmpLE); break;
       case OP_1(Cmpgtd): emit3d(X86Inst::kIdCmpsd, asmOp[0], asmOp[2], asmOp[1], x86::kCmpLE); break;
-      case OP_X(Cmpgtd): emit3d(X86Inst::kIdCmppd, asmOp[0], asmOp[2], asmOp[1], x86::kCmpLE); break;
+      case OP_X(Cmpgtd):
+      case OP_Y(Cmpgtd): emit3d(X86Inst::kIdCmppd, asmOp[0], asmOp[2], asmOp[1], x86::kCmpLE); break;
 
       case OP_1(Cmpgef): emit3f(X86Inst::kIdCmpss, asmOp[0], asmOp[2], asmOp[1], x86::kCmpLT); break;
-      case OP_X(Cmpgef): emit3f(X86Inst::kIdCmpps, asmOp[0], asmOp[2], asmOp[1], x86::kCmpLT); break;
+      case OP_X(Cmpgef):
+      case OP_Y(Cmpgef): emit3f(X86Inst::kIdCmpps, asmOp[0], asmOp[2], asmOp[1], x86::kCmpLT); break;
       case OP_1(Cmpged): emit3d(X86Inst::kIdCmpsd, asmOp[0], asmOp[2], asmOp[1], x86::kCmpLT); break;
-      case OP_X(Cmpged): emit3d(X86Inst::kIdCmppd, asmOp[0], asmOp[2], asmOp[1], x86::kCmpLT); break;
+      case OP_X(Cmpged):
+      case OP_Y(Cmpged): emit3d(X86Inst::kIdCmppd, asmOp[0], asmOp[2], asmOp[1], x86::kCmpLT); break;
 
       case OP_1(Pshufd):
-      case OP_X(Pshufd): emit3d(X86Inst::kIdPshufd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pshufd): _cc->emit(getVecInstId(X86Inst::kIdPshufd), asmOp[0], asmOp[1], asmOp[2]); break;
+
+      // A 128-bit source is shuffled to both halves (lanes broadcast uniforms
+      // this way), a 256-bit source is shuffled within each half.
+      case OP_Y(Pshufd): {
+        X86Xmm lo = x86::xmm(asmOp[0].getId());
+        if (!X86Reg::isYmm(asmOp[1])) {
+          _cc->emit(X86Inst::kIdVpshufd, lo, asmOp[1], asmOp[2]);
+          _cc->emit(X86Inst::kIdVinsertf128, asmOp[0], asmOp[0], lo, 1);
+        }
+        else if (_enableAVX2) {
+          _cc->emit(X86Inst::kIdVpshufd, asmOp[0], asmOp[1], asmOp[2]);
+        }
+        else {
+          _cc->emit(X86Inst::kIdVextractf128, _tmpXmm0, asmOp[1], 1);
+          _cc->emit(X86Inst::kIdVpshufd, _tmpXmm0, _tmpXmm0, asmOp[2]);
+          _cc->emit(X86Inst::kIdVpshufd, lo, mpLoHalf(asmOp[1]), asmOp[2]);
+          _cc->emit(X86Inst::kIdVinsertf128, asmOp[0], asmOp[0], _tmpXmm0, 1);
+        }
+        break;
+      }
 
       case OP_1(Pmovsxbw):
-      case OP_X(Pmovsxbw): emit3i(X86Inst::kIdPmovsxbw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pmovsxbw):
+      case OP_Y(Pmovsxbw): emit3i(X86Inst::kIdPmovsxbw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pmovzxbw):
-      case OP_X(Pmovzxbw): emit3i(X86Inst::kIdPmovzxbw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pmovzxbw):
+      case OP_Y(Pmovzxbw): emit3i(X86Inst::kIdPmovzxbw, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Pmovsxwd):
-      case OP_X(Pmovsxwd): emit3i(X86Inst::kIdPmovsxwd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pmovsxwd):
+      case OP_Y(Pmovsxwd): emit3i(X86Inst::kIdPmovsxwd, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pmovzxwd):
-      case OP_X(Pmovzxwd): emit3i(X86Inst::kIdPmovzxwd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pmovzxwd):
+      case OP_Y(Pmovzxwd): emit3i(X86Inst::kIdPmovzxwd, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Packsswb):
-      case OP_X(Packsswb): emit3i(X86Inst::kIdPacksswb, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Packsswb):
+      case OP_Y(Packsswb): emit3i(X86Inst::kIdPacksswb, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Packuswb):
-      case OP_X(Packuswb): emit3i(X86Inst::kIdPackuswb, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Packuswb):
+      case OP_Y(Packuswb): emit3i(X86Inst::kIdPackuswb, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Packssdw):
-      case OP_X(Packssdw): emit3i(X86Inst::kIdPackssdw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Packssdw):
+      case OP_Y(Packssdw): emit3i(X86Inst::kIdPackssdw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Packusdw):
-      case OP_X(Packusdw): emit3i(X86Inst::kIdPackusdw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Packusdw):
+      case OP_Y(Packusdw): emit3i(X86Inst::kIdPackusdw, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Paddb):
-      case OP_X(Paddb): emit3i(X86Inst::kIdPaddb, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Paddb):
+      case OP_Y(Paddb): emit3i(X86Inst::kIdPaddb, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Paddw):
-      case OP_X(Paddw): emit3i(X86Inst::kIdPaddw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Paddw):
+      case OP_Y(Paddw): emit3i(X86Inst::kIdPaddw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Paddd): emit3i(X86Inst::kIdAdd, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Paddd): emit3i(X86Inst::kIdPaddd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Paddd):
+      case OP_Y(Paddd): emit3i(X86Inst::kIdPaddd, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Paddq):
-      case OP_X(Paddq): emit3i(X86Inst::kIdPaddq, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Paddq):
+      case OP_Y(Paddq): emit3i(X86Inst::kIdPaddq, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Paddssb):
-      case OP_X(Paddssb): emit3i(X86Inst::kIdPaddsb, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Paddssb):
+      case OP_Y(Paddssb): emit3i(X86Inst::kIdPaddsb, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Paddusb):
-      case OP_X(Paddusb): emit3i(X86Inst::kIdPaddusb, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Paddusb):
+      case OP_Y(Paddusb): emit3i(X86Inst::kIdPaddusb, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Paddssw):
-      case OP_X(Paddssw): emit3i(X86Inst::kIdPaddsw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Paddssw):
+      case OP_Y(Paddssw): emit3i(X86Inst::kIdPaddsw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Paddusw):
-      case OP_X(Paddusw): emit3i(X86Inst::kIdPaddusw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Paddusw):
+      case OP_Y(Paddusw): emit3i(X86Inst::kIdPaddusw, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Psubb):
-      case OP_X(Psubb): emit3i(X86Inst::kIdPsubb, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Psubb):
+      case OP_Y(Psubb): emit3i(X86Inst::kIdPsubb, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Psubw):
-      case OP_X(Psubw): emit3i(X86Inst::kIdPsubw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Psubw):
+      case OP_Y(Psubw): emit3i(X86Inst::kIdPsubw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Psubd): emit3i(X86Inst::kIdSub, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Psubd): emit3i(X86Inst::kIdPsubd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Psubd):
+      case OP_Y(Psubd): emit3i(X86Inst::kIdPsubd, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Psubq):
-      case OP_X(Psubq): emit3i(X86Inst::kIdPsubq, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Psubq):
+      case OP_Y(Psubq): emit3i(X86Inst::kIdPsubq, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Psubssb):
-      case OP_X(Psubssb): emit3i(X86Inst::kIdPsubsb, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Psubssb):
+      case OP_Y(Psubssb): emit3i(X86Inst::kIdPsubsb, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Psubusb):
-      case OP_X(Psubusb): emit3i(X86Inst::kIdPsubusb, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Psubusb):
+      case OP_Y(Psubusb): emit3i(X86Inst::kIdPsubusb, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Psubssw):
-      case OP_X(Psubssw): emit3i(X86Inst::kIdPsubsw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Psubssw):
+      case OP_Y(Psubssw): emit3i(X86Inst::kIdPsubsw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Psubusw):
-      case OP_X(Psubusw): emit3i(X86Inst::kIdPsubusw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Psubusw):
+      case OP_Y(Psubusw): emit3i(X86Inst::kIdPsubusw, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Pmulw):
-      case OP_X(Pmulw): emit3i(X86Inst::kIdPmullw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pmulw):
+      case OP_Y(Pmulw): emit3i(X86Inst::kIdPmullw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pmulhsw):
-      case OP_X(Pmulhsw): emit3i(X86Inst::kIdPmulhw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pmulhsw):
+      case OP_Y(Pmulhsw): emit3i(X86Inst::kIdPmulhw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pmulhuw):
-      case OP_X(Pmulhuw): emit3i(X86Inst::kIdPmulhuw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pmulhuw):
+      case OP_Y(Pmulhuw): emit3i(X86Inst::kIdPmulhuw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pmuld): emit3i(X86Inst::kIdImul, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_X(Pmuld): emit3i(X86Inst::kIdPmulld, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pmuld):
+      case OP_Y(Pmuld): emit3i(X86Inst::kIdPmulld, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_1(Pmulhsd): emitMulhsd(asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Pminsb):
-      case OP_X(Pminsb): emit3i(X86Inst::kIdPminsb, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pminsb):
+      case OP_Y(Pminsb): emit3i(X86Inst::kIdPminsb, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pminub):
-      case OP_X(Pminub): emit3i(X86Inst::kIdPminub, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pminub):
+      case OP_Y(Pminub): emit3i(X86Inst::kIdPminub, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pminsw):
-      case OP_X(Pminsw): emit3i(X86Inst::kIdPminsw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pminsw):
+      case OP_Y(Pminsw): emit3i(X86Inst::kIdPminsw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pminuw):
-      case OP_X(Pminuw): emit3i(X86Inst::kIdPminuw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pminuw):
+      case OP_Y(Pminuw): emit3i(X86Inst::kIdPminuw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pminsd):
-      case OP_X(Pminsd): emit3i(X86Inst::kIdPminsd, asmOp[0], asmOp[1], asmOp[2]); break;
+        // Scalar integers live in GP registers, which SSE4.1 can't work with.
+        if (X86Reg::isGp(asmOp[0])) {
+          emitMinMaxi(X86Inst::kIdCmovg, asmOp[0], asmOp[1], asmOp[2]);
+          break;
+        }
+        MPSL_FALLTHROUGH;
+      case OP_X(Pminsd):
+      case OP_Y(Pminsd): emit3i(X86Inst::kIdPminsd, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pminud):
-      case OP_X(Pminud): emit3i(X86Inst::kIdPminud, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pminud):
+      case OP_Y(Pminud): emit3i(X86Inst::kIdPminud, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Pmaxsb):
-      case OP_X(Pmaxsb): emit3i(X86Inst::kIdPmaxsb, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pmaxsb):
+      case OP_Y(Pmaxsb): emit3i(X86Inst::kIdPmaxsb, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pmaxub):
-      case OP_X(Pmaxub): emit3i(X86Inst::kIdPmaxub, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pmaxub):
+      case OP_Y(Pmaxub): emit3i(X86Inst::kIdPmaxub, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pmaxsw):
-      case OP_X(Pmaxsw): emit3i(X86Inst::kIdPmaxsw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pmaxsw):
+      case OP_Y(Pmaxsw): emit3i(X86Inst::kIdPmaxsw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pmaxuw):
-      case OP_X(Pmaxuw): emit3i(X86Inst::kIdPmaxuw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pmaxuw):
+      case OP_Y(Pmaxuw): emit3i(X86Inst::kIdPmaxuw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pmaxsd):
-      case OP_X(Pmaxsd): emit3i(X86Inst::kIdPmaxsd, asmOp[0], asmOp[1], asmOp[2]); break;
+        if (X86Reg::isGp(asmOp[0])) {
+          emitMinMaxi(X86Inst::kIdCmovl, asmOp[0], asmOp[1], asmOp[2]);
+          break;
+        }
+        MPSL_FALLTHROUGH;
+      case OP_X(Pmaxsd):
+      case OP_Y(Pmaxsd): emit3i(X86Inst::kIdPmaxsd, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pmaxud):
-      case OP_X(Pmaxud): emit3i(X86Inst::kIdPmaxud, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pmaxud):
+      case OP_Y(Pmaxud): emit3i(X86Inst::kIdPmaxud, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Psllw):
-      case OP_X(Psllw): emit3i(X86Inst::kIdPsllw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Psllw):
+      case OP_Y(Psllw): emit3i(X86Inst::kIdPsllw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Psrlw):
-      case OP_X(Psrlw): emit3i(X86Inst::kIdPsrlw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Psrlw):
+      case OP_Y(Psrlw): emit3i(X86Inst::kIdPsrlw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Psraw):
-      case OP_X(Psraw): emit3i(X86Inst::kIdPsraw, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_1(Pslld):
-      case OP_X(Pslld): emit3i(X86Inst::kIdPslld, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_1(Psrld):
-      case OP_X(Psrld): emit3i(X86Inst::kIdPsrld, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_1(Psrad):
-      case OP_X(Psrad): emit3i(X86Inst::kIdPsrad, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Psraw):
+      case OP_Y(Psraw): emit3i(X86Inst::kIdPsraw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_1(Pslld): emit3i(X86Inst::kIdShl, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pslld):
+      case OP_Y(Pslld): emit3i(X86Inst::kIdPslld, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_1(Psrld): emit3i(X86Inst::kIdShr, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Psrld):
+      case OP_Y(Psrld): emit3i(X86Inst::kIdPsrld, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_1(Psrad): emit3i(X86Inst::kIdSar, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Psrad):
+      case OP_Y(Psrad): emit3i(X86Inst::kIdPsrad, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Psllq):
-      case OP_X(Psllq): emit3i(X86Inst::kIdPsllq, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Psllq):
+      case OP_Y(Psllq): emit3i(X86Inst::kIdPsllq, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Psrlq):
-      case OP_X(Psrlq): emit3i(X86Inst::kIdPsrlq, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Psrlq):
+      case OP_Y(Psrlq): emit3i(X86Inst::kIdPsrlq, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Pmaddwd):
-      case OP_X(Pmaddwd): emit3i(X86Inst::kIdPmaddwd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pmaddwd):
+      case OP_Y(Pmaddwd): emit3i(X86Inst::kIdPmaddwd, asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Pcmpeqb):
-      case OP_X(Pcmpeqb): emit3i(X86Inst::kIdPcmpeqb, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pcmpeqb):
+      case OP_Y(Pcmpeqb): emit3i(X86Inst::kIdPcmpeqb, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pcmpeqw):
-      case OP_X(Pcmpeqw): emit3i(X86Inst::kIdPcmpeqw, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pcmpeqw):
+      case OP_Y(Pcmpeqw): emit3i(X86Inst::kIdPcmpeqw, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pcmpeqd):
-      case OP_X(Pcmpeqd): emit3i(X86Inst::kIdPcmpeqd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pcmpeqd):
+      case OP_Y(Pcmpeqd): emitCmpi(X86Inst::kIdSete , X86Inst::kIdPcmpeqd, false, false, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_1(Pcmpned):
+      case OP_X(Pcmpned):
+      case OP_Y(Pcmpned): emitCmpi(X86Inst::kIdSetne, X86Inst::kIdPcmpeqd, false, true , asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_1(Pcmpltd):
+      case OP_X(Pcmpltd):
+      case OP_Y(Pcmpltd): emitCmpi(X86Inst::kIdSetl , X86Inst::kIdPcmpgtd, true , false, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_1(Pcmpled):
+      case OP_X(Pcmpled):
+      case OP_Y(Pcmpled): emitCmpi(X86Inst::kIdSetle, X86Inst::kIdPcmpgtd, false, true , asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_1(Pcmpgtd):
+      case OP_X(Pcmpgtd):
+      case OP_Y(Pcmpgtd): emitCmpi(X86Inst::kIdSetg , X86Inst::kIdPcmpgtd, false, false, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_1(Pcmpged):
+      case OP_X(Pcmpged):
+      case OP_Y(Pcmpged): emitCmpi(X86Inst::kIdSetge, X86Inst::kIdPcmpgtd, true , true , asmOp[0], asmOp[1], asmOp[2]); break;
 
       case OP_1(Pcmpgtb):
-      case OP_X(Pcmpgtb): emit3i(X86Inst::kIdPcmpgtb, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pcmpgtb):
+      case OP_Y(Pcmpgtb): emit3i(X86Inst::kIdPcmpgtb, asmOp[0], asmOp[1], asmOp[2]); break;
       case OP_1(Pcmpgtw):
-      case OP_X(Pcmpgtw): emit3i(X86Inst::kIdPcmpgtw, asmOp[0], asmOp[1], asmOp[2]); break;
-      case OP_1(Pcmpgtd):
-      case OP_X(Pcmpgtd): emit3i(X86Inst::kIdPcmpgtd, asmOp[0], asmOp[1], asmOp[2]); break;
+      case OP_X(Pcmpgtw):
+      case OP_Y(Pcmpgtw): emit3i(X86Inst::kIdPcmpgtw, asmOp[0], asmOp[1], asmOp[2]); break;
 
       default:
         // TODO:
@@ -509,7 +1957,54 @@ Error IRToX86::compileBasicBlock(IRBlock* block, IRBlock* next) {
   return kErrorOk;
 }
 
+uint32_t IRToX86::getVecInstId(uint32_t instId) const {
+  return _enableAVX ? mpGetAvxInstId(instId) : instId;
+}
+
+void IRToX86::emit2x(uint32_t instId, const Operand& o0, const Operand& o1) {
+  if (_enableAVX && mpIsMergeInst(instId))
+    _cc->emit(mpGetAvxInstId(instId), o0, o0, o1);
+  else
+    _cc->emit(getVecInstId(instId), o0, o1);
+}
+
 void IRToX86::emit3i(uint32_t instId, const Operand& o0, const Operand& o1, const Operand& o2) {
+  if (_enableAVX && !X86Reg::isGp(o0)) {
+    // 256-bit integer instructions require AVX2.
+    if (X86Reg::isYmm(o0) && (!_enableAVX2 || mpIsUnpackInst(instId))) {
+      emitSplit3i(instId, o0, o1, o2);
+      return;
+    }
+
+    if (mpIsUnpackInst(instId)) {
+      _cc->emit(mpGetAvxInstId(instId), o0, o2);
+      return;
+    }
+
+    // The shift count is always taken from the low 64 bits of an XMM register.
+    if (mpIsShiftInst(instId) && X86Reg::isYmm(o2)) {
+      emit3v(instId, X86Inst::kIdMovups, o0, o1, mpLoHalf(o2));
+      return;
+    }
+
+    emit3v(instId, X86Inst::kIdMovups, o0, o1, o2);
+    return;
+  }
+
+  // Two-operand forms overwrite `o0` by `o1` first, which would destroy `o2`
+  // if it's the same register.
+  if (o2.isReg() && o2.getId() == o0.getId() && o1.getId() != o0.getId()) {
+    if (mpIsCommutativeInst(instId)) {
+      emit3i(instId, o0, o2, o1);
+    }
+    else {
+      Operand tmp = X86Reg::isGp(o0) ? Operand(_cc->newI32("tmp")) : Operand(_cc->newXmm("tmp"));
+      _cc->emit(X86Reg::isGp(o0) ? X86Inst::kIdMov : X86Inst::kIdMovaps, tmp, o2);
+      emit3i(instId, o0, o1, tmp);
+    }
+    return;
+  }
+
   // Intercept instructions that are disabled for the current target and
   // substitute them with a sequential code that is compatible. It's easier
   // to deal with it here than dealing with it in `compileBasicBlock()`.
@@ -530,8 +2025,64 @@ void IRToX86::emit3i(uint32_t instId, const Operand& o0, const Operand& o1, cons
       return;
     }
 
+    // Signed minimum and maximum of 32-bit elements select by a comparison.
+    case X86Inst::kIdPminsd:
+    case X86Inst::kIdPmaxsd: {
+      if (_enableSSE4_1)
+        break;
+
+      // The mask selects `o2` for minimum and `o1` for maximum where `o1 > o2`.
+      const Operand& a = instId == X86Inst::kIdPminsd ? o2 : o1;
+      const Operand& b = instId == X86Inst::kIdPminsd ? o1 : o2;
+
+      _cc->emit(X86Inst::kIdMovaps, _tmpXmm0, o1);
+      _cc->emit(X86Inst::kIdPcmpgtd, _tmpXmm0, o2);
+      _cc->emit(X86Inst::kIdMovaps, _tmpXmm1, _tmpXmm0);
+      _cc->emit(X86Inst::kIdPand, _tmpXmm0, a);
+      _cc->emit(X86Inst::kIdPandn, _tmpXmm1, b);
+      _cc->emit(X86Inst::kIdPor, _tmpXmm0, _tmpXmm1);
+      _cc->emit(X86Inst::kIdMovaps, o0, _tmpXmm0);
+      return;
+    }
+
+    // `pmovzx` widens the low half of its second source, which is the same as
+    // interleaving it with zeros.
+    case X86Inst::kIdPmovzxbw:
+    case X86Inst::kIdPmovzxwd: {
+      if (_enableSSE4_1)
+        break;
+
+      if (!o2.isReg() || o0.getId() != o2.getId())
+        _cc->emit(o2.isReg() ? X86Inst::kIdMovaps : X86Inst::kIdMovq, o0, o2);
+
+      _cc->emit(X86Inst::kIdPxor, _tmpXmm0, _tmpXmm0);
+      _cc->emit(instId == X86Inst::kIdPmovzxbw ? X86Inst::kIdPunpcklbw : X86Inst::kIdPunpcklwd, o0, _tmpXmm0);
+      return;
+    }
+
+    // Unsigned saturation to words is the signed one of integers that have
+    // negatives cleared and are biased by -0x8000, the bias is removed after.
     case X86Inst::kIdPackusdw: {
-      // TODO:
+      if (_enableSSE4_1)
+        break;
+
+      const Operand* src[2] = { &o1, &o2 };
+      X86Xmm biased[2];
+      X86Mem bias = getConstantU32x4(0x8000);
+
+      for (uint32_t i = 0; i < 2; i++) {
+        biased[i] = _cc->newXmm("biased");
+        _cc->emit(src[i]->isReg() ? X86Inst::kIdMovaps : X86Inst::kIdMovups, _tmpXmm0, *src[i]);
+        _cc->emit(X86Inst::kIdMovaps, biased[i], _tmpXmm0);
+        _cc->emit(X86Inst::kIdPsrad, biased[i], 31);
+        _cc->emit(X86Inst::kIdPandn, biased[i], _tmpXmm0);
+        _cc->emit(X86Inst::kIdPsubd, biased[i], bias);
+      }
+
+      _cc->emit(X86Inst::kIdPackssdw, biased[0], biased[1]);
+      _cc->emit(X86Inst::kIdPxor, biased[0], getConstantU32x4(0x80008000));
+      _cc->emit(X86Inst::kIdMovaps, o0, biased[0]);
+      return;
     }
   }
 
@@ -545,35 +2096,368 @@ void IRToX86::emit3i(uint32_t instId, const Operand& o0, const Operand& o1, cons
   _cc->emit(instId, o0, o2);
 }
 
+void IRToX86::emitCmpi(uint32_t setId, uint32_t pcmpId, bool swap, bool negate, const Operand& o0, const Operand& o1, const Operand& o2) {
+  // Scalar integers live in GP registers, the result is a mask like the one
+  // produced by `pcmp` (all ones if true).
+  if (X86Reg::isGp(o1)) {
+    X86Gp tmp = _cc->newI32("cmp");
+
+    _cc->xor_(tmp, tmp);
+    _cc->cmp(o1.as<X86Gp>(), o2);
+    _cc->emit(setId, tmp.r8());
+    _cc->neg(tmp);
+
+    if (X86Reg::isGp(o0))
+      _cc->mov(o0.as<X86Gp>(), tmp);
+    else
+      emit2x(X86Inst::kIdMovd, o0, tmp);
+    return;
+  }
+
+  // SSE2 only provides `pcmpeq` and `pcmpgt`, the rest is emulated by swapping
+  // the operands and/or negating the result.
+  if (swap)
+    emit3i(pcmpId, o0, o2, o1);
+  else
+    emit3i(pcmpId, o0, o1, o2);
+
+  if (negate) {
+    if (X86Reg::isYmm(o0)) {
+      // `vxorps` doesn't require AVX2 like `vpcmpeqd` and `vpxor` do.
+      Value ones;
+      ones.q.set(~static_cast<uint64_t>(0));
+      _cc->emit(X86Inst::kIdVxorps, o0, o0, getConstantByValue(ones, 32));
+    }
+    else {
+      emit3i(X86Inst::kIdPcmpeqd, _tmpXmm0, _tmpXmm0, _tmpXmm0);
+      emit3i(X86Inst::kIdPxor, o0, o0, _tmpXmm0);
+    }
+  }
+}
+
 void IRToX86::emit3f(uint32_t instId, const Operand& o0, const Operand& o1, const Operand& o2) {
+  if (_enableAVX) {
+    emit3v(instId, X86Inst::kIdMovss, o0, o1, o2);
+    return;
+  }
+
+  // The copy of `o1` would destroy `o2`, see `emit3i()`.
+  if (o2.isReg() && o2.getId() == o0.getId() && o1.getId() != o0.getId()) {
+    if (mpIsCommutativeInst(instId)) {
+      _cc->emit(instId, o0, o1);
+    }
+    else {
+      X86Xmm tmp = _cc->newXmm("tmp");
+      _cc->emit(X86Inst::kIdMovaps, tmp, o2);
+      emit3f(instId, o0, o1, tmp);
+    }
+    return;
+  }
+
   if (o0.getId() != o1.getId())
     _cc->emit(o1.isReg() ? X86Inst::kIdMovaps : X86Inst::kIdMovss, o0, o1);
   _cc->emit(instId, o0, o2);
 }
 
 void IRToX86::emit3f(uint32_t instId, const Operand& o0, const Operand& o1, const Operand& o2, int imm) {
+  if (_enableAVX) {
+    emit3v(instId, X86Inst::kIdMovss, o0, o1, o2, imm);
+    return;
+  }
+
+  if (o2.isReg() && o2.getId() == o0.getId() && o1.getId() != o0.getId()) {
+    X86Xmm tmp = _cc->newXmm("tmp");
+    _cc->emit(X86Inst::kIdMovaps, tmp, o2);
+    emit3f(instId, o0, o1, tmp, imm);
+    return;
+  }
+
   if (o0.getId() != o1.getId())
     _cc->emit(o1.isReg() ? X86Inst::kIdMovaps : X86Inst::kIdMovss, o0, o1);
   _cc->emit(instId, o0, o2, imm);
 }
 
 void IRToX86::emit3d(uint32_t instId, const Operand& o0, const Operand& o1, const Operand& o2) {
+  if (_enableAVX) {
+    emit3v(instId, X86Inst::kIdMovsd, o0, o1, o2);
+    return;
+  }
+
+  // The copy of `o1` would destroy `o2`, see `emit3i()`.
+  if (o2.isReg() && o2.getId() == o0.getId() && o1.getId() != o0.getId()) {
+    if (mpIsCommutativeInst(instId)) {
+      _cc->emit(instId, o0, o1);
+    }
+    else {
+      X86Xmm tmp = _cc->newXmm("tmp");
+      _cc->emit(X86Inst::kIdMovapd, tmp, o2);
+      emit3d(instId, o0, o1, tmp);
+    }
+    return;
+  }
+
   if (o0.getId() != o1.getId())
     _cc->emit(o1.isReg() ? X86Inst::kIdMovapd : X86Inst::kIdMovsd, o0, o1);
   _cc->emit(instId, o0, o2);
 }
 
 void IRToX86::emit3d(uint32_t instId, const Operand& o0, const Operand& o1, const Operand& o2, int imm) {
+  if (_enableAVX) {
+    emit3v(instId, X86Inst::kIdMovsd, o0, o1, o2, imm);
+    return;
+  }
+
+  if (o2.isReg() && o2.getId() == o0.getId() && o1.getId() != o0.getId()) {
+    X86Xmm tmp = _cc->newXmm("tmp");
+    _cc->emit(X86Inst::kIdMovapd, tmp, o2);
+    emit3d(instId, o0, o1, tmp, imm);
+    return;
+  }
+
   if (o0.getId() != o1.getId())
     _cc->emit(o1.isReg() ? X86Inst::kIdMovapd : X86Inst::kIdMovsd, o0, o1);
   _cc->emit(instId, o0, o2, imm);
 }
 
+void IRToX86::emit3v(uint32_t instId, uint32_t loadId, const Operand& o0, const Operand& o1, const Operand& o2) {
+  // VEX forms don't overwrite their first source, so no move is needed unless
+  // the first source is in memory (only the second source can be).
+  if (!o1.isReg()) {
+    emit2x(X86Reg::isYmm(o0) ? static_cast<uint32_t>(X86Inst::kIdMovups) : loadId, o0, o1);
+    _cc->emit(mpGetAvxInstId(instId), o0, o0, o2);
+  }
+  else {
+    _cc->emit(mpGetAvxInstId(instId), o0, o1, o2);
+  }
+}
+
+void IRToX86::emit3v(uint32_t instId, uint32_t loadId, const Operand& o0, const Operand& o1, const Operand& o2, int imm) {
+  if (!o1.isReg()) {
+    emit2x(X86Reg::isYmm(o0) ? static_cast<uint32_t>(X86Inst::kIdMovups) : loadId, o0, o1);
+    _cc->emit(mpGetAvxInstId(instId), o0, o0, o2, imm);
+  }
+  else {
+    _cc->emit(mpGetAvxInstId(instId), o0, o1, o2, imm);
+  }
+}
+
+void IRToX86::emitFmadd(uint32_t id213, uint32_t id231, uint32_t mulId, uint32_t addId, bool isF64,
+  const Operand& o0, const Operand& o1, const Operand& o2, const Operand& o3) {
+
+  bool isYmm = X86Reg::isYmm(o0);
+
+  if (!_enableFMA) {
+    Operand tmp = isYmm ? Operand(_cc->newYmm()) : Operand(_cc->newXmm());
+    if (isF64) {
+      emit3d(mulId, tmp, o1, o2);
+      emit3d(addId, o0, tmp, o3);
+    }
+    else {
+      emit3f(mulId, tmp, o1, o2);
+      emit3f(addId, o0, tmp, o3);
+    }
+    return;
+  }
+
+  // FMA encodes a single memory operand, which must be the last one. Only the
+  // multiplication is commutative, so `a` is kept in a register and `b` or `c`
+  // can be read from memory depending on which form is used.
+  uint32_t scalarLoadId = isF64 ? X86Inst::kIdVmovsd : X86Inst::kIdVmovss;
+  uint32_t loadId = mpIsScalarFmaInst(id213) ? scalarLoadId : static_cast<uint32_t>(X86Inst::kIdVmovups);
+
+  Operand a = o1;
+  Operand b = o2;
+
+  if (!a.isReg() || (b.isReg() && b.getId() == o0.getId())) {
+    a = o2;
+    b = o1;
+  }
+
+  if (!a.isReg()) {
+    Operand tmp = isYmm ? Operand(_cc->newYmm()) : Operand(_cc->newXmm());
+    _cc->emit(loadId, tmp, a);
+    a = tmp;
+  }
+
+  if (o3.isReg() && o3.getId() == o0.getId()) {
+    // d = a * b + d.
+    _cc->emit(id231, o0, a, b);
+  }
+  else if (a.getId() == o0.getId()) {
+    // d = d * b + c.
+    if (!b.isReg()) {
+      Operand tmp = isYmm ? Operand(_cc->newYmm()) : Operand(_cc->newXmm());
+      _cc->emit(loadId, tmp, b);
+      b = tmp;
+    }
+    _cc->emit(id213, o0, b, o3);
+  }
+  else {
+    // `o0` is not used by the sources, so `c` can be moved into it.
+    _cc->emit(o3.isReg() ? static_cast<uint32_t>(X86Inst::kIdVmovaps) : loadId, o0, o3);
+    _cc->emit(id231, o0, a, b);
+  }
+}
+
+void IRToX86::emitSelect(const Operand& o0, const Operand& o1, const Operand& o2, const Operand& o3) {
+  // GP masks are either all ones or zero, so a conditional move is enough. The
+  // flags are set first as `o0` can be the same register as the mask.
+  if (X86Reg::isGp(o0)) {
+    X86Gp dst = o0.as<X86Gp>();
+    X86Gp msk = o1.as<X86Gp>();
+
+    _cc->test(msk, msk);
+    if (o2.getId() == o0.getId()) {
+      _cc->emit(X86Inst::kIdCmovz, dst, o3);
+    }
+    else {
+      if (o3.getId() != o0.getId())
+        _cc->mov(dst, o3.as<X86Gp>());
+      _cc->emit(X86Inst::kIdCmovnz, dst, o2);
+    }
+    return;
+  }
+
+  if (_enableAVX) {
+    _cc->emit(X86Inst::kIdVblendvps, o0, o3, o2, o1);
+    return;
+  }
+
+  // The mask of the SSE4.1 form is implicitly `xmm0`, which the compiler
+  // allocates, the destination is the value selected by zero bits.
+  if (_enableSSE4_1) {
+    if (o0.getId() != o1.getId() && o0.getId() != o2.getId()) {
+      if (o0.getId() != o3.getId())
+        _cc->emit(X86Inst::kIdMovaps, o0, o3);
+      _cc->emit(X86Inst::kIdBlendvps, o0, o2, o1);
+    }
+    else {
+      X86Xmm tmp = _cc->newXmm("select");
+      _cc->emit(X86Inst::kIdMovaps, tmp, o3);
+      _cc->emit(X86Inst::kIdBlendvps, tmp, o2, o1);
+      _cc->emit(X86Inst::kIdMovaps, o0, tmp);
+    }
+    return;
+  }
+
+  // (mask & a) | (~mask & b).
+  X86Xmm a = _cc->newXmm("selectA");
+  X86Xmm b = _cc->newXmm("selectB");
+
+  emit3f(X86Inst::kIdAndps, a, o1, o2);
+  emit3f(X86Inst::kIdAndnps, b, o1, o3);
+  emit3f(X86Inst::kIdOrps, o0, a, b);
+}
+
+void IRToX86::emitMulhsd(const Operand& o0, const Operand& o1, const Operand& o2) {
+  // The single operand `imul` multiplies by EAX and writes the high half of
+  // the product to EDX, the compiler allocates both of them.
+  X86Gp lo = _cc->newI32("mulLo");
+  _cc->emit(X86Inst::kIdMov, lo, o1);
+
+  if (o2.isImm()) {
+    X86Gp src = _cc->newI32("mulSrc");
+    _cc->emit(X86Inst::kIdMov, src, o2);
+    _cc->emit(X86Inst::kIdImul, o0, lo, src);
+  }
+  else {
+    _cc->emit(X86Inst::kIdImul, o0, lo, o2);
+  }
+}
+
+void IRToX86::emitSplit3i(uint32_t instId, const Operand& o0, const Operand& o1, const Operand& o2) {
+  // The high half is processed first as `o0` can be the same register as `o1`
+  // or `o2`. Immediates are used by both halves as is.
+  Operand hi[2] = { o1, o2 };
+  X86Xmm tmp[2] = { _tmpXmm0, _tmpXmm1 };
+
+  for (uint32_t i = 0; i < 2; i++) {
+    if (X86Reg::isYmm(hi[i])) {
+      _cc->emit(X86Inst::kIdVextractf128, tmp[i], hi[i], 1);
+      hi[i] = tmp[i];
+    }
+    else if (hi[i].isMem()) {
+      X86Mem mem = hi[i].as<X86Mem>();
+      mem.addOffsetLo32(16);
+      hi[i] = mem;
+    }
+  }
+
+  emit3i(instId, _tmpXmm0, hi[0], hi[1]);
+  emit3i(instId, mpLoHalf(o0), mpLoHalf(o1), mpLoHalf(o2));
+  _cc->emit(X86Inst::kIdVinsertf128, o0, o0, _tmpXmm0, 1);
+}
+
+Error IRToX86::emitCall(IRInst* inst) {
+  IRFunc* func = inst->getOperand(1)->as<IRFunc>();
+  CCFunc* node = funcAsNode(func);
+
+  if (node == nullptr)
+    return MPSL_TRACE_ERROR(kErrorNoMemory);
+
+  FuncSignatureX sign;
+  mpInitFuncSignature(sign, func);
+
+  CCFuncCall* call = _cc->call(node->getLabel(), sign);
+  if (call == nullptr)
+    return MPSL_TRACE_ERROR(kErrorNoMemory);
+
+  for (uint32_t i = 2, count = inst->getOpCount(); i < count; i++) {
+    IRObject* arg = inst->getOperand(i);
+    if (!arg->isReg())
+      return MPSL_TRACE_ERROR(kErrorInvalidState);
+    call->setArg(i - 2, varAsReg(arg->as<IRReg>()));
+  }
+
+  call->setRet(0, varAsReg(inst->getOperand(0)->as<IRReg>()));
+  return kErrorOk;
+}
+
+Label IRToX86::blockAsLabel(IRBlock* irBlock) {
+  uint32_t id = irBlock->getJitId();
+
+  if (id == kInvalidRegId) {
+    Label label = _cc->newLabel();
+    irBlock->setJitId(label.getId());
+    return label;
+  }
+  else {
+    return Label(id);
+  }
+}
+
+CCFunc* IRToX86::funcAsNode(IRFunc* func) {
+  CCFunc* node = static_cast<CCFunc*>(func->getJitData());
+
+  if (node == nullptr) {
+    FuncSignatureX sign;
+    mpInitFuncSignature(sign, func);
+
+    node = _cc->newFunc(sign);
+    func->setJitData(node);
+  }
+
+  return node;
+}
+
+X86Reg IRToX86::varAsReg(IRReg* irVar) {
+  if (irVar->getReg() == IRReg::kKindGp)
+    return irVar->getWidth() > 4 ? X86Reg(varAsPtr(irVar)) : X86Reg(varAsI32(irVar));
+  else
+    return irVar->getWidth() > 16 ? X86Reg(varAsYmm(irVar)) : X86Reg(varAsXmm(irVar));
+}
+
 X86Gp IRToX86::varAsPtr(IRReg* irVar) {
   uint32_t id = irVar->getJitId();
-  MPSL_ASSERT(id != kInvalidRegId);
 
-  return _cc->gpz(id);
+  if (id == kInvalidRegId) {
+    X86Gp gp = _cc->newIntPtr("%%%u", irVar->getId());
+    irVar->setJitId(gp.getId());
+    return gp;
+  }
+  else {
+    return _cc->gpz(id);
+  }
 }
 
 X86Gp IRToX86::varAsI32(IRReg* irVar) {
@@ -602,7 +2486,111 @@ X86Xmm IRToX86::varAsXmm(IRReg* irVar) {
   }
 }
 
+X86Ymm IRToX86::varAsYmm(IRReg* irVar) {
+  uint32_t id = irVar->getJitId();
+
+  if (id == kInvalidRegId) {
+    X86Ymm ymm = _cc->newYmm("%%%u", irVar->getId());
+    irVar->setJitId(ymm.getId());
+    return ymm;
+  }
+  else {
+    return x86::ymm(id);
+  }
+}
+
+// ============================================================================
+// [mpsl::X86Target - Helpers]
+// ============================================================================
+
+// Disable instruction set extensions of `compiler` excluded by `options` and
+// select the floating-point environment of compiled code.
+static void mpApplyCpuOptions(IRToX86& compiler, uint32_t options) noexcept {
+  compiler._enableFpEnv = mpHasFpEnv(options);
+  compiler._mxcsr = mpMxcsrFromOptions(options);
+
+  if (options & kOptionDisableSSE4_1)
+    compiler._enableSSE4_1 = false;
+
+  if (!mpIsAVXAllowed(options))
+    compiler._enableAVX = false;
+
+  if (!compiler._enableAVX || (options & kOptionDisableAVX2))
+    compiler._enableAVX2 = false;
+
+  if (!compiler._enableAVX) {
+    compiler._enableFMA = false;
+    compiler._enableF16C = false;
+  }
+}
+
+// ============================================================================
+// [mpsl::X86Target - Construction / Destruction]
+// ============================================================================
+
+X86Target::X86Target(ZoneHeap* heap, const CodeInfo& codeInfo, Logger* logger) noexcept
+  : IRTarget(heap, codeInfo, logger),
+    _cc(&_code),
+    _sharedUsed(false) {
+  _sharedLabel = _cc.newLabel();
+}
+
+X86Target::~X86Target() {
+  for (size_t i = 0, count = _backends.getLength(); i < count; i++) {
+    IRToX86* backend = _backends[i];
+    backend->~IRToX86();
+    _heap->release(backend, sizeof(IRToX86));
+  }
+  _backends.release(_heap);
+}
+
+// ============================================================================
+// [mpsl::X86Target - Interface]
+// ============================================================================
+
+Error X86Target::newBackend(IRBackend** out, uint32_t options) {
+  MPSL_PROPAGATE(_backends.willGrow(_heap));
+
+  void* p = _heap->alloc(sizeof(IRToX86));
+  MPSL_NULLCHECK(p);
+
+  IRToX86* backend = new(p) IRToX86(_heap, &_cc);
+  backend->_sharedLabel = _sharedLabel;
+  mpApplyCpuOptions(*backend, options);
+
+  _backends.appendUnsafe(backend);
+  *out = backend;
+  return kErrorOk;
+}
+
+Error X86Target::finalize() {
+  for (size_t i = 0, count = _backends.getLength(); i < count; i++)
+    _sharedUsed |= _backends[i]->_sharedUsed;
+
+  if (_sharedUsed) {
+    const void* sharedConsts = mpGetSharedConsts();
+    _cc.align(kAlignData, kPointerWidth);
+    _cc.bind(_sharedLabel);
+    _cc.embed(&sharedConsts, kPointerWidth);
+  }
+
+  if (_cc.finalize() != kErrorOk)
+    return MPSL_TRACE_ERROR(kErrorJITFailed);
+
+  return kErrorOk;
+}
+
+uint32_t X86Target::getEntryOffset(const IRBackend* backend) const {
+  const IRToX86* compiler = static_cast<const IRToX86*>(backend);
+  return static_cast<uint32_t>(_code.getLabelOffset(compiler->_func->getLabel()));
+}
+
+uint32_t X86Target::getConstSlot() const {
+  return _sharedUsed ? static_cast<uint32_t>(_code.getLabelOffset(_sharedLabel)) : uint32_t(0);
+}
+
 } // mpsl namespace
+#endif // MPSL_BUILD_X86
 
 // [Api-End]
 #include "./mpsl_apiend.h"
@@ -12,10 +12,12 @@
 #include "./mpast_p.h"
 #include "./mphash_p.h"
 #include "./mpir_p.h"
+#include "./mpirbackend_p.h"
 
 // [Api-Begin]
 #include "./mpsl_apibegin.h"
 
+#if MPSL_BUILD_X86
 namespace mpsl {
 
 using asmjit::Label;
@@ -26,57 +28,185 @@ using asmjit::X86Reg;
 using asmjit::X86Gp;
 using asmjit::X86Mm;
 using asmjit::X86Xmm;
+using asmjit::X86Ymm;
 using asmjit::X86Mem;
 
 using asmjit::kConstScopeLocal;
 using asmjit::kConstScopeGlobal;
 
+// ============================================================================
+// [mpsl::SharedConsts]
+// ============================================================================
+
+//! \internal
+//!
+//! Get the read-only table of constants shared by all programs of all contexts,
+//! see `IRToX86::getSharedConstant()`.
+const void* mpGetSharedConsts() noexcept;
+
 // ============================================================================
 // [mpsl::IRToX86]
 // ============================================================================
 
-class IRToX86 {
+class IRToX86 : public IRBackend {
 public:
   MPSL_NONCOPYABLE(IRToX86)
 
+  //! Register that holds a reduction member during a batch.
+  struct Accumulator {
+    //! Data slot of the member.
+    uint32_t slot;
+    //! Offset of the member (or its half) in the data.
+    int32_t offset;
+    //! Fetch instruction that reads the member (its width).
+    uint32_t fetchCode;
+    //! Register that holds the member.
+    Operand reg;
+  };
+
+  //! Registers of an entry point that counts its runs, see `_counters`.
+  struct CounterRegs {
+    //! Counter slot of the calling thread.
+    X86Gp slot;
+    //! Time-stamp counter read on entry (low and high 32 bits on X86, only
+    //! `tscLo` is used on X64).
+    X86Gp tscLo;
+    X86Gp tscHi;
+  };
+
   // --------------------------------------------------------------------------
   // [Construction / Destruction]
   // --------------------------------------------------------------------------
 
   IRToX86(ZoneHeap* heap, X86Compiler* cc);
-  ~IRToX86();
+  virtual ~IRToX86();
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  virtual uint32_t getFeatures() const override;
+  virtual size_t getConstPoolSize() const override;
 
   // --------------------------------------------------------------------------
   // [Const Pool]
   // --------------------------------------------------------------------------
 
   void prepareConstPool();
+  void prepareSharedConsts();
+
+  //! Get a constant at `offset` of the table of shared constants.
+  X86Mem getSharedConstant(uint32_t offset);
 
   X86Mem getConstantU64(uint64_t value);
   X86Mem getConstantU64AsPD(uint64_t value);
   X86Mem getConstantD64(double value);
   X86Mem getConstantD64AsPD(double value);
   X86Mem getConstantByValue(const Value& value, uint32_t width);
+  //! Get a 128-bit constant that has all 32-bit elements set to `value`.
+  X86Mem getConstantU32x4(uint32_t value);
 
   // --------------------------------------------------------------------------
   // [Compile]
   // --------------------------------------------------------------------------
 
-  Error compileIRAsFunc(IRBuilder* ir);
+  virtual Error compileIRAsFunc(IRBuilder* ir) override;
+  virtual Error compileIRAsBatch(IRBuilder* ir) override;
+  virtual Error compileIRAsCallee(IRFunc* func) override;
   Error compileIRAsPart(IRBuilder* ir);
-  Error compileConsecutiveBlocks(IRBlock* block);
-  Error compileBasicBlock(IRBlock* block, IRBlock* next);
+  Error compileConsecutiveBlocks(IRBuilder* ir, IRBlock* block);
+  virtual Error compileBasicBlock(IRBlock* block, IRBlock* next) override;
 
-  MPSL_INLINE void emit2x(uint32_t instId, const Operand& o0, const Operand& o1) { _cc->emit(instId, o0, o1); }
+  //! Create an accumulator of each reduction member accessed by `ir` and load
+  //! it from the data passed to a batch, see `IRBuilder::getReducePtr()`.
+  Error initAccumulators(IRBuilder* ir);
+  //! Store all accumulators to the data passed to a batch.
+  void storeAccumulators(const X86Gp& args);
+  //! Get the accumulator that replaces `mem` (null if there is none).
+  Accumulator* getAccumulator(IRBuilder* ir, const IRMem* mem);
+  //! Emit prefetching cache lines of records `_prefetchDistance` records ahead,
+  //! `lines` has a bit of each line read by `ir` from a record of each slot and
+  //! `ahead` holds the distance in bytes of each slot that has any.
+  void emitPrefetches(IRBuilder* ir, const uint32_t* lines, const X86Gp* ahead);
+
+  //! Peephole optimization of `block` done right before it's compiled, removes
+  //! copies and loads that are overwritten before being read and replaces
+  //! registers loaded from a constant or memory and used once by a memory
+  //! operand of their use.
+  Error optimizeBlock(IRBlock* block);
+
+  //! Get the instruction that should be emitted instead of the SSE instruction
+  //! `instId`, which is its VEX encoded form if AVX is enabled.
+  uint32_t getVecInstId(uint32_t instId) const;
+
+  //! Emit saving MXCSR of the caller to `saved` and setting the floating-point
+  //! environment of the program, see `_mxcsr`.
+  void emitFpEnvEnter(const X86Mem& saved);
+  //! Emit restoring MXCSR of the caller saved by `emitFpEnvEnter()`.
+  void emitFpEnvLeave(const X86Mem& saved);
+  //! Emit counting a call that processes `records` and reading the time-stamp
+  //! counter if cycles are counted.
+  void emitCountersEnter(CounterRegs& regs, const Operand& records);
+  //! Emit counting cycles spent since `emitCountersEnter()`.
+  void emitCountersLeave(const CounterRegs& regs);
+  //! Emit a locked addition of `value` to the 64-bit counter at `offset` of
+  //! the slot `slot`, `valueHi` holds the high 32 bits of `value` on X86 (none
+  //! if they are zero).
+  void emitCounterAdd(const X86Gp& slot, int32_t offset, const Operand& value, const Operand& valueHi);
+
+  //! Emit `o0 = 0` by a zero idiom.
+  void emitZero(const Operand& o0);
+  //! Emit `fetch` or `store` of `instCode` that moves `o1` to `o0`.
+  void emitLoadStore(uint32_t instCode, const Operand& o0, const Operand& o1);
+  //! Emit a copy of `size` bytes of a register `o1` to a register `o0`, which
+  //! can be of a different kind.
+  void emitCopy(uint32_t size, const Operand& o0, const Operand& o1);
+  //! Emit `o0 = min(o1, o2)` or `o0 = max(o1, o2)` of scalars held by GP
+  //! registers, `cmovId` selects `o2` if the comparison of `o1` and `o2` holds.
+  void emitMinMaxi(uint32_t cmovId, const Operand& o0, const Operand& o1, const Operand& o2);
+  //! Emit `gather32` or `gather64` of `instCode` that reads an element of `mem`
+  //! by each 32-bit index held by the XMM index of `mem` to `o0`.
+  void emitGather(uint32_t instCode, const Operand& o0, IRMem* mem);
+  //! Emit converting 4 half-precision floats held by the low 64 bits of `o1`
+  //! to floats, by F16C if it's enabled.
+  void emitCvthtof(const Operand& o0, const Operand& o1);
+  //! Emit converting 4 floats of `o1` to half-precision floats held by the low
+  //! 64 bits of `o0`, rounded to the nearest, by F16C if it's enabled.
+  void emitCvtftoh(const Operand& o0, const Operand& o1);
+  void emit2x(uint32_t instId, const Operand& o0, const Operand& o1);
   void emit3i(uint32_t instId, const Operand& o0, const Operand& o1, const Operand& o2);
+  void emitCmpi(uint32_t setId, uint32_t pcmpId, bool swap, bool negate, const Operand& o0, const Operand& o1, const Operand& o2);
   void emit3f(uint32_t instId, const Operand& o0, const Operand& o1, const Operand& o2);
   void emit3f(uint32_t instId, const Operand& o0, const Operand& o1, const Operand& o2, int imm);
   void emit3d(uint32_t instId, const Operand& o0, const Operand& o1, const Operand& o2);
   void emit3d(uint32_t instId, const Operand& o0, const Operand& o1, const Operand& o2, int imm);
 
+  //! Emit a VEX three-operand form of `instId`, `loadId` loads `o1` to `o0`
+  //! if it's not a register.
+  void emit3v(uint32_t instId, uint32_t loadId, const Operand& o0, const Operand& o1, const Operand& o2);
+  void emit3v(uint32_t instId, uint32_t loadId, const Operand& o0, const Operand& o1, const Operand& o2, int imm);
+  //! Emit `o0 = o1 * o2 + o3` as a single FMA instruction if FMA is enabled,
+  //! as a multiplication followed by an addition otherwise.
+  void emitFmadd(uint32_t id213, uint32_t id231, uint32_t mulId, uint32_t addId, bool isF64,
+    const Operand& o0, const Operand& o1, const Operand& o2, const Operand& o3);
+  //! Emit `o0 = o1 ? o2 : o3`, the mask `o1` has all bits of each element
+  //! either set or clear.
+  void emitSelect(const Operand& o0, const Operand& o1, const Operand& o2, const Operand& o3);
+  //! Emit `o0 = (o1 * o2) >> 32` of signed scalars held by GP registers.
+  void emitMulhsd(const Operand& o0, const Operand& o1, const Operand& o2);
+  //! Emit a 256-bit integer instruction as two 128-bit ones (AVX without AVX2).
+  void emitSplit3i(uint32_t instId, const Operand& o0, const Operand& o1, const Operand& o2);
+  //! Emit `call dst, func, args...`.
+  Error emitCall(IRInst* inst);
+
+  Label blockAsLabel(IRBlock* irBlock);
+  //! Get the function node of `func`, created by its first use.
+  asmjit::CCFunc* funcAsNode(IRFunc* func);
+  X86Reg varAsReg(IRReg* irVar);
   X86Gp varAsPtr(IRReg* irVar);
   X86Gp varAsI32(IRReg* irVar);
   X86Xmm varAsXmm(IRReg* irVar);
+  X86Ymm varAsYmm(IRReg* irVar);
 
   // --------------------------------------------------------------------------
   // [Members]
@@ -86,20 +216,84 @@ public:
   X86Compiler* _cc;
 
   X86Gp _data[Globals::kMaxArgumentsCount];
+  X86Gp _stride[Globals::kMaxArgumentsCount];
   X86Gp _ret;
 
+  asmjit::CCFunc* _func;
   asmjit::CBNode* _functionBody;
   asmjit::ConstPool _constPool;
   Label _constLabel;
   X86Gp _constPtr;
 
+  //! Slot holding the address of shared constants, embedded once per code by
+  //! `X86Target::finalize()` if `_sharedUsed` is set.
+  Label _sharedLabel;
+  X86Gp _sharedPtr;
+  bool _sharedUsed;
+
   X86Xmm _tmpXmm0;
   X86Xmm _tmpXmm1;
 
+  //! Reductions kept in registers by a batch, see `initAccumulators()`.
+  ZoneVector<Accumulator> _accumulators;
+
   bool _enableSSE4_1;
+  bool _enableAVX;
+  bool _enableAVX2;
+  bool _enableFMA;
+  bool _enableF16C;
+
+  //! Set the floating-point environment on entry of the compiled function and
+  //! restore it on return, entry points only (callees run in it).
+  bool _enableFpEnv;
+  //! Bits of MXCSR in `kMxcsrEnvMask` set by the compiled function.
+  uint32_t _mxcsr;
+};
+
+// ============================================================================
+// [mpsl::X86Target]
+// ============================================================================
+
+//! \internal
+//!
+//! Target of X86 and X64 code, all its backends share a single `X86Compiler`.
+class X86Target : public IRTarget {
+public:
+  MPSL_NONCOPYABLE(X86Target)
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  X86Target(ZoneHeap* heap, const asmjit::CodeInfo& codeInfo, asmjit::Logger* logger) noexcept;
+  virtual ~X86Target();
+
+  // --------------------------------------------------------------------------
+  // [Interface]
+  // --------------------------------------------------------------------------
+
+  virtual Error newBackend(IRBackend** out, uint32_t options) override;
+  virtual Error finalize() override;
+
+  virtual uint32_t getEntryOffset(const IRBackend* backend) const override;
+  virtual uint32_t getConstSlot() const override;
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  X86Compiler _cc;
+  //! Backends created by `newBackend()`.
+  ZoneVector<IRToX86*> _backends;
+
+  //! Slot holding the address of shared constants, see `IRToX86::_sharedLabel`.
+  Label _sharedLabel;
+  //! Set by `finalize()` if any backend used shared constants.
+  bool _sharedUsed;
 };
 
 } // mpsl namespace
+#endif // MPSL_BUILD_X86
 
 // [Api-End]
 #include "./mpsl_apiend.h"
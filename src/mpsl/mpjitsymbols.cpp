@@ -0,0 +1,307 @@
+// [MPSL]
+// MathPresso's Shading Language with JIT Engine for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define MPSL_EXPORTS
+
+// [Dependencies - MPSL]
+#include "./mpjitsymbols_p.h"
+
+// [Dependencies - Linux]
+#if defined(__linux__)
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <time.h>
+# include <unistd.h>
+#endif
+
+// [Api-Begin]
+#include "./mpsl_apibegin.h"
+
+namespace mpsl {
+
+#if defined(__linux__)
+
+// ============================================================================
+// [mpsl::JitSymbols - Internal]
+// ============================================================================
+
+//! \internal
+//!
+//! Code registered in the perf map.
+struct JitSymbolEntry {
+  const void* code;
+  size_t size;
+  char* name;
+};
+
+//! \internal
+//!
+//! Jitdump file header, see `tools/perf/Documentation/jitdump-specification.txt`
+//! in the Linux kernel.
+struct JitDumpHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t totalSize;
+  uint32_t elfMach;
+  uint32_t pad1;
+  uint32_t pid;
+  uint64_t timestamp;
+  uint64_t flags;
+};
+
+//! \internal
+//!
+//! Jitdump `JIT_CODE_LOAD` record, followed by the name and the code.
+struct JitDumpCodeLoad {
+  uint32_t id;
+  uint32_t totalSize;
+  uint64_t timestamp;
+
+  uint32_t pid;
+  uint32_t tid;
+  uint64_t vma;
+  uint64_t codeAddr;
+  uint64_t codeSize;
+  uint64_t codeIndex;
+};
+
+enum JitDumpConstants {
+  kJitDumpMagic = 0x4A695444,
+  kJitDumpVersion = 1,
+  kJitDumpCodeLoad = 0
+};
+
+//! \internal
+//!
+//! Profiler files shared by all contexts, guarded by `lock`.
+struct JitSymbolsState {
+  SpinLock lock;
+
+  JitSymbolEntry* entries;
+  size_t count;
+  size_t capacity;
+
+  int dumpFd;
+  void* dumpMarker;
+  bool dumpFailed;
+  uint64_t codeIndex;
+};
+
+static JitSymbolsState mpJitSymbolsState;
+
+// `perf` uses CLOCK_MONOTONIC to order jitdump records if recorded by `-k mono`.
+static uint64_t mpJitDumpTimestamp() noexcept {
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// Get the length of `name` up to the first new-line, which would break the
+// perf map.
+static size_t mpJitSymbolNameLength(const char* name) noexcept {
+  return ::strcspn(name, "\r\n");
+}
+
+static bool mpJitDumpWrite(int fd, const void* data, size_t size) noexcept {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  while (size != 0) {
+    ssize_t n = ::write(fd, p, size);
+    if (n <= 0)
+      return false;
+
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+static void mpPerfMapPath(char* dst, size_t size) noexcept {
+  ::snprintf(dst, size, "/tmp/perf-%d.map", static_cast<int>(::getpid()));
+}
+
+static void mpPerfMapWrite(FILE* f, const JitSymbolEntry& entry) noexcept {
+  ::fprintf(f, "%llx %llx %.*s\n",
+    static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(entry.code)),
+    static_cast<unsigned long long>(entry.size),
+    static_cast<int>(mpJitSymbolNameLength(entry.name)), entry.name);
+}
+
+static void mpPerfMapAdd(JitSymbolsState& state, const void* code, size_t size, const char* name) noexcept {
+  if (state.count == state.capacity) {
+    size_t capacity = state.capacity ? state.capacity * 2 : size_t(64);
+    JitSymbolEntry* entries = static_cast<JitSymbolEntry*>(
+      ::realloc(state.entries, capacity * sizeof(JitSymbolEntry)));
+
+    if (entries == nullptr)
+      return;
+
+    state.entries = entries;
+    state.capacity = capacity;
+  }
+
+  size_t nameLength = ::strlen(name);
+  char* nameCopy = static_cast<char*>(::malloc(nameLength + 1));
+  if (nameCopy == nullptr)
+    return;
+  ::memcpy(nameCopy, name, nameLength + 1);
+
+  JitSymbolEntry& entry = state.entries[state.count++];
+  entry.code = code;
+  entry.size = size;
+  entry.name = nameCopy;
+
+  char path[64];
+  mpPerfMapPath(path, sizeof(path));
+
+  FILE* f = ::fopen(path, "a");
+  if (f == nullptr)
+    return;
+
+  mpPerfMapWrite(f, entry);
+  ::fclose(f);
+}
+
+static void mpPerfMapRemove(JitSymbolsState& state, const void* code) noexcept {
+  size_t i = 0;
+  while (i < state.count && state.entries[i].code != code)
+    i++;
+
+  if (i == state.count)
+    return;
+
+  ::free(state.entries[i].name);
+  state.entries[i] = state.entries[--state.count];
+
+  char path[64];
+  mpPerfMapPath(path, sizeof(path));
+
+  FILE* f = ::fopen(path, "w");
+  if (f == nullptr)
+    return;
+
+  for (i = 0; i < state.count; i++)
+    mpPerfMapWrite(f, state.entries[i]);
+  ::fclose(f);
+}
+
+static bool mpJitDumpOpen(JitSymbolsState& state) noexcept {
+  if (state.dumpMarker != nullptr)
+    return true;
+
+  if (state.dumpFailed)
+    return false;
+
+  char path[64];
+  ::snprintf(path, sizeof(path), "jit-%d.dump", static_cast<int>(::getpid()));
+
+  int fd = ::open(path, O_CREAT | O_TRUNC | O_RDWR, 0666);
+  if (fd < 0) {
+    state.dumpFailed = true;
+    return false;
+  }
+
+  // `perf record` finds the file by this executable mapping.
+  long pageSize = ::sysconf(_SC_PAGESIZE);
+  void* marker = ::mmap(nullptr, static_cast<size_t>(pageSize), PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+
+  JitDumpHeader header;
+  header.magic = kJitDumpMagic;
+  header.version = kJitDumpVersion;
+  header.totalSize = static_cast<uint32_t>(sizeof(JitDumpHeader));
+  header.elfMach = MPSL_ARCH_X64 ? 62 : 3; // EM_X86_64 or EM_386.
+  header.pad1 = 0;
+  header.pid = static_cast<uint32_t>(::getpid());
+  header.timestamp = mpJitDumpTimestamp();
+  header.flags = 0;
+
+  if (marker == MAP_FAILED || !mpJitDumpWrite(fd, &header, sizeof(header))) {
+    if (marker != MAP_FAILED)
+      ::munmap(marker, static_cast<size_t>(pageSize));
+    ::close(fd);
+    state.dumpFailed = true;
+    return false;
+  }
+
+  state.dumpFd = fd;
+  state.dumpMarker = marker;
+  return true;
+}
+
+static void mpJitDumpAdd(JitSymbolsState& state, const void* code, size_t size, const char* name) noexcept {
+  if (!mpJitDumpOpen(state))
+    return;
+
+  size_t nameLength = ::strlen(name);
+
+  JitDumpCodeLoad record;
+  record.id = kJitDumpCodeLoad;
+  record.totalSize = static_cast<uint32_t>(sizeof(JitDumpCodeLoad) + nameLength + 1 + size);
+  record.timestamp = mpJitDumpTimestamp();
+  record.pid = static_cast<uint32_t>(::getpid());
+  record.tid = static_cast<uint32_t>(::syscall(SYS_gettid));
+  record.vma = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(code));
+  record.codeAddr = record.vma;
+  record.codeSize = size;
+  record.codeIndex = state.codeIndex++;
+
+  // A partially written record would corrupt all records after it.
+  if (!mpJitDumpWrite(state.dumpFd, &record, sizeof(record)) ||
+      !mpJitDumpWrite(state.dumpFd, name, nameLength + 1) ||
+      !mpJitDumpWrite(state.dumpFd, code, size)) {
+    state.dumpFailed = true;
+    state.dumpMarker = nullptr;
+    ::close(state.dumpFd);
+  }
+}
+
+// ============================================================================
+// [mpsl::JitSymbols - Interface]
+// ============================================================================
+
+uint32_t mpJitSymbolsSupported() noexcept {
+  return kJitSymbolsPerfMap | kJitSymbolsJitDump;
+}
+
+void mpJitSymbolsAdd(uint32_t flags, const void* code, size_t size, const char* name) noexcept {
+  JitSymbolsState& state = mpJitSymbolsState;
+  AutoSpinLock guard(state.lock);
+
+  if (flags & kJitSymbolsPerfMap)
+    mpPerfMapAdd(state, code, size, name);
+
+  if (flags & kJitSymbolsJitDump)
+    mpJitDumpAdd(state, code, size, name);
+}
+
+void mpJitSymbolsRemove(uint32_t flags, const void* code) noexcept {
+  JitSymbolsState& state = mpJitSymbolsState;
+  AutoSpinLock guard(state.lock);
+
+  if (flags & kJitSymbolsPerfMap)
+    mpPerfMapRemove(state, code);
+}
+
+#else
+
+// ============================================================================
+// [mpsl::JitSymbols - Interface]
+// ============================================================================
+
+uint32_t mpJitSymbolsSupported() noexcept {
+  return 0;
+}
+
+void mpJitSymbolsAdd(uint32_t flags, const void* code, size_t size, const char* name) noexcept {}
+void mpJitSymbolsRemove(uint32_t flags, const void* code) noexcept {}
+
+#endif
+
+} // mpsl namespace
+
+// [Api-End]
+#include "./mpsl_apiend.h"
@@ -0,0 +1,53 @@
+// [MPSL]
+// MathPresso's Shading Language with JIT Engine for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _MPSL_MPJITSYMBOLS_P_H
+#define _MPSL_MPJITSYMBOLS_P_H
+
+// [Dependencies - MPSL]
+#include "./mpsl_p.h"
+
+// [Api-Begin]
+#include "./mpsl_apibegin.h"
+
+namespace mpsl {
+
+// ============================================================================
+// [mpsl::JitSymbols]
+// ============================================================================
+
+//! \internal
+//!
+//! Get \ref JitSymbols supported by the platform.
+uint32_t mpJitSymbolsSupported() noexcept;
+
+//! \internal
+//!
+//! Register `size` bytes of code at `code` named `name` with profiler
+//! interfaces selected by `flags`, see \ref JitSymbols.
+//!
+//! Files are shared by all contexts of the process and are created when the
+//! first program is registered. Failing to write them is not an error, the
+//! program is just not visible to the profiler.
+void mpJitSymbolsAdd(uint32_t flags, const void* code, size_t size, const char* name) noexcept;
+
+//! \internal
+//!
+//! Remove code at `code` registered by `mpJitSymbolsAdd()` before it's released.
+//!
+//! The perf map is rewritten without the entry, so programs compiled later at
+//! the same address are not attributed to it. The jitdump is append only, its
+//! records are ordered by timestamps, so nothing is written to it.
+void mpJitSymbolsRemove(uint32_t flags, const void* code) noexcept;
+
+} // mpsl namespace
+
+// [Api-End]
+#include "./mpsl_apiend.h"
+
+// [Guard]
+#endif // _MPSL_MPJITSYMBOLS_P_H
@@ -281,9 +281,10 @@ const InstInfo mpInstInfo[kInstCodeCount] = {
   // +----------+---------------+-----------------------------------------+
   ROW(None      , "<none>"      , 0, 0                                    ),
   ROW(Jmp       , "jmp"         , 1, I(Jxx)                               ),
-  ROW(Jnz       , "jnz"         , 2, I(Jxx)                               ),
+  ROW(Jnz       , "jnz"         , 3, I(Jxx)                               ),
   ROW(Call      , "call"        , 0, I(Call)                              ),
   ROW(Ret       , "ret"         , 0, I(Ret)                               ),
+  ROW(Phi       , "phi"         , 0, I(Phi)                               ),
 
   ROW(Fetch32   , "fetch32"     , 2, I(Fetch)                             ),
   ROW(Fetch64   , "fetch64"     , 2, I(Fetch)                             ),
@@ -293,6 +294,8 @@ const InstInfo mpInstInfo[kInstCodeCount] = {
   ROW(Fetch256  , "fetch256"    , 2, I(Fetch)                             ),
   ROW(Insert32  , "insert32"    , 3, I(Fetch)                             ),
   ROW(Insert64  , "insert64"    , 3, I(Fetch)                             ),
+  ROW(Gather32  , "gather32"    , 2, 0                                    ),
+  ROW(Gather64  , "gather64"    , 2, 0                                    ),
   ROW(Store32   , "store32"     , 2, I(Store)                             ),
   ROW(Store64   , "store64"     , 2, I(Store)                             ),
   ROW(Store96   , "store96"     , 2, I(Store)                             ),
@@ -312,6 +315,8 @@ const InstInfo mpInstInfo[kInstCodeCount] = {
   ROW(Cvtftod   , "cvtftod"     , 2, I(F32) | I(F64) | I(Cvt)             ),
   ROW(Cvtdtoi   , "cvtdtoi"     , 2, I(I32) | I(F64) | I(Cvt)             ),
   ROW(Cvtdtof   , "cvtdtof"     , 2, I(F32) | I(F64) | I(Cvt)             ),
+  ROW(Cvthtof   , "cvthtof"     , 2, I(F32) | I(Cvt)                      ),
+  ROW(Cvtftoh   , "cvtftoh"     , 2, I(F32) | I(Cvt)                      ),
 
   ROW(Absf      , "absf"        , 2, I(F32)                               ),
   ROW(Absd      , "absd"        , 2, I(F64)                               ),
@@ -425,6 +430,12 @@ const InstInfo mpInstInfo[kInstCodeCount] = {
   ROW(Atan2f    , "atan2f"      , 3, I(F32) | I(Complex)                  ),
   ROW(Atan2d    , "atan2d"      , 3, I(F64) | I(Complex)                  ),
 
+  ROW(Fmaddf    , "fmaddf"      , 4, I(F32)                               ),
+  ROW(Fmaddd    , "fmaddd"      , 4, I(F64)                               ),
+
+  ROW(Selecti   , "selecti"     , 4, I(I32)                               ),
+  ROW(Selectf   , "selectf"     , 4, I(F32)                               ),
+
   ROW(Pshufd    , "pshufd"      , 3, I(I32) | I(F32) | I(F64)     | I(Imm)),
 
   ROW(Pmovsxbw  , "pmovsxbw"    , 3, I(I32)                               ),
@@ -455,6 +466,7 @@ const InstInfo mpInstInfo[kInstCodeCount] = {
   ROW(Pmulhsw   , "pmulhsw"     , 3, I(I32)                               ),
   ROW(Pmulhuw   , "pmulhuw"     , 3, I(I32)                               ),
   ROW(Pmuld     , "pmuld"       , 3, I(I32)                               ),
+  ROW(Pmulhsd   , "pmulhsd"     , 3, I(I32)                               ),
   ROW(Pdivsd    , "pdivsd"      , 3, I(I32)                               ),
   ROW(Pmodsd    , "pmodsd"      , 3, I(I32)                               ),
   ROW(Pminsb    , "pminsb"      , 3, I(I32)                               ),
@@ -481,9 +493,21 @@ const InstInfo mpInstInfo[kInstCodeCount] = {
   ROW(Pcmpeqb   , "pcmpeqb"     , 3, I(I32)                               ),
   ROW(Pcmpeqw   , "pcmpeqw"     , 3, I(I32)                               ),
   ROW(Pcmpeqd   , "pcmpeqd"     , 3, I(I32)                               ),
+  ROW(Pcmpneb   , "pcmpneb"     , 3, I(I32)                               ),
+  ROW(Pcmpnew   , "pcmpnew"     , 3, I(I32)                               ),
+  ROW(Pcmpned   , "pcmpned"     , 3, I(I32)                               ),
+  ROW(Pcmpltb   , "pcmpltb"     , 3, I(I32)                               ),
+  ROW(Pcmpltw   , "pcmpltw"     , 3, I(I32)                               ),
+  ROW(Pcmpltd   , "pcmpltd"     , 3, I(I32)                               ),
+  ROW(Pcmpleb   , "pcmpleb"     , 3, I(I32)                               ),
+  ROW(Pcmplew   , "pcmplew"     , 3, I(I32)                               ),
+  ROW(Pcmpled   , "pcmpled"     , 3, I(I32)                               ),
   ROW(Pcmpgtb   , "pcmpgtb"     , 3, I(I32)                               ),
   ROW(Pcmpgtw   , "pcmpgtw"     , 3, I(I32)                               ),
-  ROW(Pcmpgtd   , "pcmpgtd"     , 3, I(I32)                               )
+  ROW(Pcmpgtd   , "pcmpgtd"     , 3, I(I32)                               ),
+  ROW(Pcmpgeb   , "pcmpgeb"     , 3, I(I32)                               ),
+  ROW(Pcmpgew   , "pcmpgew"     , 3, I(I32)                               ),
+  ROW(Pcmpged   , "pcmpged"     , 3, I(I32)                               )
 };
 #undef I
 #undef ROW
@@ -292,6 +292,7 @@ enum InstCode {
   kInstCodeJnz,
   kInstCodeCall,
   kInstCodeRet,
+  kInstCodePhi,
 
   kInstCodeFetch32,
   kInstCodeFetch64,
@@ -301,6 +302,8 @@ enum InstCode {
   kInstCodeFetch256,
   kInstCodeInsert32,
   kInstCodeInsert64,
+  kInstCodeGather32,
+  kInstCodeGather64,
 
   kInstCodeStore32,
   kInstCodeStore64,
@@ -322,6 +325,8 @@ enum InstCode {
   kInstCodeCvtftod,
   kInstCodeCvtdtoi,
   kInstCodeCvtdtof,
+  kInstCodeCvthtof,
+  kInstCodeCvtftoh,
 
   kInstCodeAbsf,
   kInstCodeAbsd,
@@ -435,6 +440,12 @@ enum InstCode {
   kInstCodeAtan2f,
   kInstCodeAtan2d,
 
+  kInstCodeFmaddf,
+  kInstCodeFmaddd,
+
+  kInstCodeSelecti,
+  kInstCodeSelectf,
+
   kInstCodePshufd,
 
   kInstCodePmovsxbw,
@@ -465,6 +476,7 @@ enum InstCode {
   kInstCodePmulhsw,
   kInstCodePmulhuw,
   kInstCodePmuld,
+  kInstCodePmulhsd,
   kInstCodePdivsd,
   kInstCodePmodsd,
   kInstCodePminsb,
@@ -542,6 +554,7 @@ enum InstFlags {
   kInstInfoRet     = 0x0200,
   kInstInfoCall    = 0x0400,
   kInstInfoImm     = 0x0800,
+  kInstInfoPhi     = 0x1000, //!< SSA phi, has one operand per predecessor (+ dst).
   kInstInfoComplex = 0x8000
 };
 
@@ -759,11 +772,13 @@ struct InstInfo {
 
   MPSL_INLINE bool isFetch() const noexcept { return (flags & kInstInfoFetch) != 0; }
   MPSL_INLINE bool isStore() const noexcept { return (flags & kInstInfoStore) != 0; }
+  MPSL_INLINE bool isMov() const noexcept { return (flags & kInstInfoMov) != 0; }
 
   MPSL_INLINE bool isJxx() const noexcept { return (flags & kInstInfoJxx) != 0; }
   MPSL_INLINE bool isRet() const noexcept { return (flags & kInstInfoRet) != 0; }
   MPSL_INLINE bool isCall() const noexcept { return (flags & kInstInfoCall) != 0; }
   MPSL_INLINE bool isComplex() const noexcept { return (flags & kInstInfoComplex) != 0; }
+  MPSL_INLINE bool isPhi() const noexcept { return (flags & kInstInfoPhi) != 0; }
 
   MPSL_INLINE bool hasImm() const noexcept { return (flags & kInstInfoImm) != 0; }
 
@@ -814,6 +829,21 @@ static MPSL_INLINE bool mpCanImplicitCast(uint32_t dTypeId, uint32_t sTypeId) no
   return (mpImplicitCast[dTypeId] & (1 << sTypeId)) != 0;
 }
 
+//! \internal
+//!
+//! Get the distance between elements of an array of `typeInfo`, see
+//! `Layout::addArray()`.
+static MPSL_INLINE uint32_t mpArrayStride(uint32_t typeInfo) noexcept {
+  uint32_t size = TypeInfo::sizeOf(typeInfo & kTypeIdMask);
+  return TypeInfo::widthOf(typeInfo) + ((typeInfo & kTypePadded) ? size : 0);
+}
+
+//! \internal
+//!
+//! Attributes that describe how a `Layout` member is stored, they don't apply
+//! to values of the member read by the program.
+enum { kTypeStorageAttrMask = kTypePadded | kTypeStorageMask | kTypeNormalized };
+
 } // mpsl namespace
 
 // [Api-End]
@@ -0,0 +1,422 @@
+// [MPSL]
+// MathPresso's Shading Language with JIT Engine for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define MPSL_EXPORTS
+
+// [Dependencies - MPSL]
+#include "./mpatomic_p.h"
+#include "./mplang_p.h"
+#include "./mpmath_p.h"
+#include "./mpparallel_p.h"
+
+// [Api-Begin]
+#include "./mpsl_apibegin.h"
+
+namespace mpsl {
+
+// ============================================================================
+// [mpsl::ThreadPool - Construction / Destruction]
+// ============================================================================
+
+ThreadPool::ThreadPool() noexcept {}
+ThreadPool::~ThreadPool() noexcept {}
+
+// ============================================================================
+// [mpsl::ThreadPool - Interface]
+// ============================================================================
+
+void ThreadPool::post(WorkFunc func, void* data) noexcept {
+  func(data, 0);
+}
+
+// ============================================================================
+// [mpsl::Parallel - Internal]
+// ============================================================================
+
+// A range of chunks `[begin, end)` owned by a worker is packed into a single
+// `uintptr_t` (begin in the low half, end in the high half), so it can be
+// popped by its owner and stolen by other workers by a single CAS.
+static const uint32_t kParallelRangeShift = static_cast<uint32_t>(sizeof(uintptr_t) * 4);
+static const uintptr_t kParallelRangeMask = (static_cast<uintptr_t>(1) << kParallelRangeShift) - 1;
+
+//! \internal
+//!
+//! Range of chunks, padded to a cache line to prevent false sharing.
+struct ParallelRange {
+  uintptr_t range;
+  uint8_t padding[64 - sizeof(uintptr_t)];
+};
+
+//! \internal
+struct ParallelTask {
+  Program::Impl::BatchFunc func;
+  void** args;
+  const intptr_t* strides;
+
+  //! Arguments of each worker (`Globals::kMaxArgumentsCount` per worker) that
+  //! point to private copies of reduced records, null if there are none.
+  void** workerArgs;
+
+  size_t count;
+  size_t chunkSize;
+
+  ParallelRange* ranges;
+  uint32_t workersCount;
+
+  uintptr_t error;
+};
+
+static MPSL_INLINE uintptr_t mpParallelPack(uintptr_t begin, uintptr_t end) noexcept {
+  return begin | (end << kParallelRangeShift);
+}
+
+static MPSL_INLINE uintptr_t mpParallelBegin(uintptr_t range) noexcept { return range & kParallelRangeMask; }
+static MPSL_INLINE uintptr_t mpParallelEnd(uintptr_t range) noexcept { return range >> kParallelRangeShift; }
+
+// Pop a chunk from the front of the worker's own range.
+static bool mpParallelPop(ParallelRange* own, uintptr_t& chunk) noexcept {
+  for (;;) {
+    uintptr_t range = mpAtomicGet(&own->range);
+    uintptr_t begin = mpParallelBegin(range);
+    uintptr_t end = mpParallelEnd(range);
+
+    if (begin >= end)
+      return false;
+
+    if (mpAtomicCmpXchg(&own->range, range, mpParallelPack(begin + 1, end))) {
+      chunk = begin;
+      return true;
+    }
+  }
+}
+
+// Steal the upper half of a range of another worker. The first stolen chunk
+// is returned and the rest becomes the new range of the worker.
+static bool mpParallelSteal(ParallelTask* task, uint32_t workerId, uintptr_t& chunk) noexcept {
+  uint32_t workersCount = task->workersCount;
+  ParallelRange* own = &task->ranges[workerId];
+
+  for (uint32_t i = 1; i < workersCount; i++) {
+    ParallelRange* victim = &task->ranges[(workerId + i) % workersCount];
+
+    for (;;) {
+      uintptr_t range = mpAtomicGet(&victim->range);
+      uintptr_t begin = mpParallelBegin(range);
+      uintptr_t end = mpParallelEnd(range);
+
+      if (begin >= end)
+        break;
+
+      uintptr_t split = end - (end - begin + 1) / 2;
+      if (mpAtomicCmpXchg(&victim->range, range, mpParallelPack(begin, split))) {
+        mpAtomicSet(&own->range, mpParallelPack(split + 1, end));
+        chunk = split;
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+static void MPSL_CDECL mpParallelWorker(void* data, uint32_t workerId) {
+  ParallelTask* task = static_cast<ParallelTask*>(data);
+  if (workerId >= task->workersCount)
+    return;
+
+  ParallelRange* own = &task->ranges[workerId];
+  uintptr_t chunk;
+
+  void** args = task->args;
+  if (task->workerArgs != nullptr)
+    args = task->workerArgs + static_cast<size_t>(workerId) * Globals::kMaxArgumentsCount;
+
+  while (mpParallelPop(own, chunk) || mpParallelSteal(task, workerId, chunk)) {
+    size_t start = static_cast<size_t>(chunk) * task->chunkSize;
+    size_t count = mpMin<size_t>(task->chunkSize, task->count - start);
+
+    Error err = task->func(args, task->strides, start, count);
+    if (err != kErrorOk)
+      mpAtomicSet(&task->error, err);
+  }
+}
+
+// ============================================================================
+// [mpsl::Parallel - Reduce]
+// ============================================================================
+
+Error mpParallelReduceCreate(ParallelReduce** out, uint32_t numArgs, const Layout* const* layouts) noexcept {
+  *out = nullptr;
+
+  uint32_t membersCount = 0;
+  for (uint32_t slot = 0; slot < numArgs; slot++) {
+    const Layout::Member* m = layouts[slot]->getMembersArray();
+    for (uint32_t i = 0, count = layouts[slot]->getMembersCount(); i < count; i++)
+      membersCount += (m[i].typeInfo & kTypeReduceMask) != 0;
+  }
+
+  if (membersCount == 0)
+    return kErrorOk;
+
+  ParallelReduce* reduce = static_cast<ParallelReduce*>(
+    ::malloc(sizeof(ParallelReduce) + membersCount * sizeof(ParallelReduce::Member)));
+  MPSL_NULLCHECK(reduce);
+
+  reduce->totalSize = 0;
+  reduce->membersCount = membersCount;
+  reduce->members = reinterpret_cast<ParallelReduce::Member*>(reduce + 1);
+
+  uint32_t n = 0;
+  for (uint32_t slot = 0; slot < Globals::kMaxArgumentsCount; slot++) {
+    reduce->recordOffset[slot] = 0;
+    reduce->recordSize[slot] = 0;
+
+    if (slot >= numArgs)
+      continue;
+
+    const Layout::Member* m = layouts[slot]->getMembersArray();
+    uint32_t count = layouts[slot]->getMembersCount();
+
+    // The copy covers all members as the program can read other members of
+    // the record as well.
+    int64_t lo = 0;
+    int64_t hi = 0;
+    bool hasReduce = false;
+
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t typeInfo = m[i].typeInfo;
+      int64_t offset = m[i].offset;
+
+      lo = mpMin<int64_t>(lo, offset);
+      hi = mpMax<int64_t>(hi, offset + TypeInfo::widthOf(typeInfo));
+
+      if (typeInfo & kTypeReduceMask) {
+        ParallelReduce::Member& member = reduce->members[n++];
+        member.slot = slot;
+        member.typeInfo = typeInfo;
+        member.offset = m[i].offset;
+        hasReduce = true;
+      }
+    }
+
+    if (hasReduce) {
+      // Keep each copy 8-byte aligned, doubles are accessed directly.
+      uint32_t size = static_cast<uint32_t>((hi - lo + 7) & ~static_cast<int64_t>(7));
+      reduce->recordOffset[slot] = static_cast<int32_t>(lo);
+      reduce->recordSize[slot] = size;
+      reduce->totalSize += size;
+    }
+  }
+
+  *out = reduce;
+  return kErrorOk;
+}
+
+// Set all reduction members of records in `args` to their identities.
+static void mpParallelReduceInit(const ParallelReduce* reduce, void** args) noexcept {
+  for (uint32_t i = 0; i < reduce->membersCount; i++) {
+    const ParallelReduce::Member& member = reduce->members[i];
+    uint8_t* p = static_cast<uint8_t*>(args[member.slot]) + member.offset;
+
+    uint32_t op = mpReduceOpOf(member.typeInfo);
+    uint32_t typeId = member.typeInfo & kTypeIdMask;
+
+    for (uint32_t j = 0, count = TypeInfo::elementsOf(member.typeInfo); j < count; j++) {
+      switch (typeId) {
+        case kTypeInt: {
+          int32_t value = 0;
+          if (op == kReduceMin) value = 0x7FFFFFFF;
+          if (op == kReduceMax) value = -0x7FFFFFFF - 1;
+          ::memcpy(p + j * sizeof(int32_t), &value, sizeof(int32_t));
+          break;
+        }
+
+        case kTypeFloat: {
+          float value = op == kReduceSum ? 0.0f : op == kReduceMin ? mpGetInfF() : -mpGetInfF();
+          ::memcpy(p + j * sizeof(float), &value, sizeof(float));
+          break;
+        }
+
+        case kTypeDouble: {
+          double value = op == kReduceSum ? 0.0 : op == kReduceMin ? mpGetInfD() : -mpGetInfD();
+          ::memcpy(p + j * sizeof(double), &value, sizeof(double));
+          break;
+        }
+      }
+    }
+  }
+}
+
+template<typename T>
+static MPSL_INLINE void mpParallelCombine(uint32_t op, uint8_t* dst, const uint8_t* src) noexcept {
+  T a, b;
+  ::memcpy(&a, dst, sizeof(T));
+  ::memcpy(&b, src, sizeof(T));
+
+  // Min and max match `minss` and `maxss`, which return the second operand
+  // if the comparison is false.
+  if (op == kReduceSum)
+    a = static_cast<T>(a + b);
+  else if (op == kReduceMin)
+    a = a < b ? a : b;
+  else
+    a = a > b ? a : b;
+
+  ::memcpy(dst, &a, sizeof(T));
+}
+
+// Combine reduction members of records in `src` into records in `dst`.
+static void mpParallelReduceCombine(const ParallelReduce* reduce, void** dst, void* const* src) noexcept {
+  for (uint32_t i = 0; i < reduce->membersCount; i++) {
+    const ParallelReduce::Member& member = reduce->members[i];
+    uint8_t* d = static_cast<uint8_t*>(dst[member.slot]) + member.offset;
+    const uint8_t* s = static_cast<const uint8_t*>(src[member.slot]) + member.offset;
+
+    uint32_t op = mpReduceOpOf(member.typeInfo);
+    uint32_t typeId = member.typeInfo & kTypeIdMask;
+
+    for (uint32_t j = 0, count = TypeInfo::elementsOf(member.typeInfo); j < count; j++) {
+      switch (typeId) {
+        case kTypeInt   : mpParallelCombine<int32_t>(op, d + j * sizeof(int32_t), s + j * sizeof(int32_t)); break;
+        case kTypeFloat : mpParallelCombine<float  >(op, d + j * sizeof(float  ), s + j * sizeof(float  )); break;
+        case kTypeDouble: mpParallelCombine<double >(op, d + j * sizeof(double ), s + j * sizeof(double )); break;
+      }
+    }
+  }
+}
+
+// ============================================================================
+// [mpsl::Parallel - Run]
+// ============================================================================
+
+Error mpRunParallel(
+  Program::Impl::BatchFunc func,
+  void** args, const intptr_t* strides, uint32_t argsCount,
+  size_t count, ThreadPool* pool, const ParallelReduce* reduce) noexcept {
+
+  if (count == 0)
+    return kErrorOk;
+
+  uint32_t workersCount = pool ? pool->getWorkersCount() : 1;
+  if (workersCount <= 1)
+    return func(args, strides, 0, count);
+
+  // Reductions of records that are not shared can't be privatized.
+  if (reduce != nullptr) {
+    for (uint32_t i = 0; i < argsCount; i++) {
+      if (reduce->recordSize[i] != 0 && strides[i] != 0)
+        return func(args, strides, 0, count);
+    }
+  }
+
+  // Size chunks to roughly `kParallelChunkBytes` of the biggest record, but
+  // create at least `kParallelChunksPerWorker` chunks per worker. SoA programs
+  // ignore strides, their records are column elements (assumed 4 bytes).
+  size_t recordSize = sizeof(float);
+  for (uint32_t i = 0; i < argsCount; i++) {
+    intptr_t stride = strides[i];
+    recordSize = mpMax<size_t>(recordSize, static_cast<size_t>(stride < 0 ? -stride : stride));
+  }
+
+  size_t chunkSize = mpMin<size_t>(
+    static_cast<size_t>(kParallelChunkBytes) / recordSize,
+    count / (static_cast<size_t>(workersCount) * kParallelChunksPerWorker));
+  chunkSize = (chunkSize + kParallelChunkAlign - 1) & ~static_cast<size_t>(kParallelChunkAlign - 1);
+  if (chunkSize == 0)
+    chunkSize = kParallelChunkAlign;
+
+  size_t chunksCount = (count + chunkSize - 1) / chunkSize;
+  while (chunksCount > kParallelRangeMask) {
+    chunkSize *= 2;
+    chunksCount = (count + chunkSize - 1) / chunkSize;
+  }
+
+  if (chunksCount <= 1)
+    return func(args, strides, 0, count);
+
+  if (workersCount > chunksCount)
+    workersCount = static_cast<uint32_t>(chunksCount);
+
+  ParallelRange rangesTmp[kParallelMaxStackWorkers];
+  ParallelRange* ranges = rangesTmp;
+
+  if (workersCount > kParallelMaxStackWorkers) {
+    ranges = static_cast<ParallelRange*>(::malloc(workersCount * sizeof(ParallelRange)));
+    if (ranges == nullptr)
+      return MPSL_TRACE_ERROR(kErrorNoMemory);
+  }
+
+  // Distribute chunks evenly, stealing takes care of the rest.
+  for (uint32_t i = 0; i < workersCount; i++) {
+    uintptr_t begin = static_cast<uintptr_t>((chunksCount * i) / workersCount);
+    uintptr_t end = static_cast<uintptr_t>((chunksCount * (i + 1)) / workersCount);
+    ranges[i].range = mpParallelPack(begin, end);
+  }
+
+  // Each worker gets arguments that point to its private copies of records
+  // that have reduction members, stored after the arguments of all workers.
+  void** workerArgs = nullptr;
+  if (reduce != nullptr) {
+    size_t argsSize = static_cast<size_t>(workersCount) * Globals::kMaxArgumentsCount * sizeof(void*);
+    workerArgs = static_cast<void**>(::malloc(argsSize + static_cast<size_t>(workersCount) * reduce->totalSize));
+
+    if (workerArgs == nullptr) {
+      if (ranges != rangesTmp)
+        ::free(ranges);
+      return MPSL_TRACE_ERROR(kErrorNoMemory);
+    }
+
+    uint8_t* records = reinterpret_cast<uint8_t*>(workerArgs) + argsSize;
+    for (uint32_t w = 0; w < workersCount; w++) {
+      void** wArgs = workerArgs + static_cast<size_t>(w) * Globals::kMaxArgumentsCount;
+
+      for (uint32_t i = 0; i < argsCount; i++) {
+        uint32_t size = reduce->recordSize[i];
+        wArgs[i] = args[i];
+
+        if (size != 0) {
+          int32_t offset = reduce->recordOffset[i];
+          ::memcpy(records, static_cast<uint8_t*>(args[i]) + offset, size);
+
+          wArgs[i] = records - offset;
+          records += size;
+        }
+      }
+
+      mpParallelReduceInit(reduce, wArgs);
+    }
+  }
+
+  ParallelTask task;
+  task.func = func;
+  task.args = args;
+  task.strides = strides;
+  task.workerArgs = workerArgs;
+  task.count = count;
+  task.chunkSize = chunkSize;
+  task.ranges = ranges;
+  task.workersCount = workersCount;
+  task.error = kErrorOk;
+
+  pool->run(mpParallelWorker, &task, workersCount);
+
+  if (workerArgs != nullptr) {
+    for (uint32_t w = 0; w < workersCount; w++)
+      mpParallelReduceCombine(reduce, args, workerArgs + static_cast<size_t>(w) * Globals::kMaxArgumentsCount);
+    ::free(workerArgs);
+  }
+
+  if (ranges != rangesTmp)
+    ::free(ranges);
+
+  return static_cast<Error>(task.error);
+}
+
+} // mpsl namespace
+
+// [Api-End]
+#include "./mpsl_apiend.h"
@@ -0,0 +1,99 @@
+// [MPSL]
+// MathPresso's Shading Language with JIT Engine for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _MPSL_MPPARALLEL_P_H
+#define _MPSL_MPPARALLEL_P_H
+
+// [Dependencies - MPSL]
+#include "./mpsl_p.h"
+
+// [Api-Begin]
+#include "./mpsl_apibegin.h"
+
+namespace mpsl {
+
+// ============================================================================
+// [mpsl::Parallel]
+// ============================================================================
+
+//! \internal
+//!
+//! Parallel scheduler limits.
+enum ParallelLimits {
+  //! Number of bytes a chunk should roughly touch (fits L1 with some room).
+  kParallelChunkBytes = 16384,
+  //! Chunks are aligned to this number of records (or SoA elements), so two
+  //! workers never share a cache line of a 64-byte aligned output.
+  kParallelChunkAlign = 64,
+  //! Number of chunks per worker that we try to create for load balancing.
+  kParallelChunksPerWorker = 4,
+  //! Maximum number of workers that use the stack, more workers use the heap.
+  kParallelMaxStackWorkers = 32
+};
+
+//! \internal
+//!
+//! Reduction members of a program, see `kTypeReduceSum`.
+//!
+//! Each worker of `mpRunParallel()` reduces into a private copy of records
+//! that have reduction members, the copies are combined after all workers
+//! finish. It's kept by `Program::Impl::_reduce`.
+struct ParallelReduce {
+  struct Member {
+    //! Data slot of the member.
+    uint32_t slot;
+    //! Member type information.
+    uint32_t typeInfo;
+    //! Member offset.
+    int32_t offset;
+  };
+
+  //! Offset of a private copy of a record relative to the data (by slot),
+  //! only non-zero if the layout has members at negative offsets.
+  int32_t recordOffset[Globals::kMaxArgumentsCount];
+  //! Size of a private copy of a record (by slot), zero if the slot has no
+  //! reduction members.
+  uint32_t recordSize[Globals::kMaxArgumentsCount];
+  //! Sum of all `recordSize` values.
+  uint32_t totalSize;
+  //! Number of reduction members.
+  uint32_t membersCount;
+  //! Reduction members, stored right after the `ParallelReduce`.
+  Member* members;
+};
+
+//! \internal
+//!
+//! Create `ParallelReduce` from `numArgs` layouts. The result is null if
+//! layouts have no reduction members.
+Error mpParallelReduceCreate(ParallelReduce** out, uint32_t numArgs, const Layout* const* layouts) noexcept;
+
+//! \internal
+static MPSL_INLINE void mpParallelReduceDestroy(ParallelReduce* reduce) noexcept {
+  ::free(reduce);
+}
+
+//! \internal
+//!
+//! Run `func` over `count` records by all workers of `pool`. Records are split
+//! into chunks, each worker starts with a contiguous range of chunks and steals
+//! half of a range of another worker when its own range is exhausted.
+//!
+//! The batch runs on the calling thread if `reduce` is not null and a record
+//! that has reduction members is not shared by all records (has a stride).
+Error mpRunParallel(
+  Program::Impl::BatchFunc func,
+  void** args, const intptr_t* strides, uint32_t argsCount,
+  size_t count, ThreadPool* pool, const ParallelReduce* reduce) noexcept;
+
+} // mpsl namespace
+
+// [Api-End]
+#include "./mpsl_apiend.h"
+
+// [Guard]
+#endif // _MPSL_MPPARALLEL_P_H
@@ -104,7 +104,7 @@ Error Parser::parseFunction(AstProgram* block) noexcept {
   uint32_t uToken;
   StringRef str;
 
-  AstScope* globalScope = _ast->getGlobalScope();
+  AstScope* globalScope = _programScope;
   AstScope* localScope;
 
   MPSL_PROPAGATE(block->willAdd());
@@ -155,7 +155,7 @@ Error Parser::parseFunction(AstProgram* block) noexcept {
 
   // Function name has to be put into the parent scope, otherwise the symbol
   // will not be visible.
-  globalScope->putSymbol(funcSym);
+  MPSL_PROPAGATE(globalScope->putSymbol(funcSym));
 
   // Link.
   func->setFunc(funcSym);
@@ -205,7 +205,7 @@ Error Parser::parseFunction(AstProgram* block) noexcept {
 
       argSym->setDeclared();
       argSym->setTypeInfo(argType->getTypeInfo());
-      localScope->putSymbol(argSym);
+      MPSL_PROPAGATE(localScope->putSymbol(argSym));
 
       // Create/Append the argument node.
       MPSL_PROPAGATE(args->willAdd());
@@ -407,7 +407,7 @@ Error Parser::parseTypedef(AstBlock* block) noexcept {
 
   synonym->setDeclared();
   synonym->setTypeInfo(typeSym->getTypeInfo());
-  scope->putSymbol(synonym);
+  MPSL_PROPAGATE(scope->putSymbol(synonym));
 
   // Parse the ';' token.
   if (_tokenizer.next(&token) != kTokenSemicolon)
@@ -486,7 +486,7 @@ Error Parser::parseVarDecl(AstBlock* block) noexcept {
       typeInfo |= kTypeRead | kTypeWrite;
 
     vSym->setTypeInfo(typeInfo);
-    scope->putSymbol(vSym);
+    MPSL_PROPAGATE(scope->putSymbol(vSym));
 
     AstVarDecl* decl = _ast->newNode<AstVarDecl>();
     MPSL_NULLCHECK_(decl, { _ast->deleteSymbol(vSym); });
@@ -985,6 +985,11 @@ _Repeat1:
         zNode->setPosition(token.getPosAsUInt());
         zNode->setTypeInfo(token.nType | kTypeRead);
 
+        // Numbers without a suffix can take the type of the other operand.
+        char suffix = _tokenizer._start[token.position + token.length - 1];
+        if (token.nType == kTypeInt || (token.nType == kTypeDouble && suffix != 'd' && suffix != 'D'))
+          zNode->addNodeFlags(AstNode::kFlagUntyped);
+
         switch (token.nType) {
           case kTypeInt   : zNode->_value.i[0] = static_cast<int>(token.value); break;
           case kTypeFloat : zNode->_value.f[0] = static_cast<float>(token.value); break;
@@ -1001,11 +1006,12 @@ _Repeat1:
         break;
       }
 
-      // Parse expression terminators - ',' or ':', or ';' or ')'.
+      // Parse expression terminators - ',' or ':', or ';' or ')' or ']'.
       case kTokenComma:
       case kTokenColon:
       case kTokenSemicolon:
-      case kTokenRParen: {
+      case kTokenRParen:
+      case kTokenRBracket: {
         MPSL_PARSER_ERROR(token, "Expected an expression.");
       }
 
@@ -1087,11 +1093,12 @@ _Unary: {
 
 _Repeat2:
     switch (_tokenizer.next(&token)) {
-      // Parse the expression terminators - ',' or ':', or ';' or ')'.
+      // Parse the expression terminators - ',' or ':', or ';' or ')' or ']'.
       case kTokenComma:
       case kTokenColon:
       case kTokenSemicolon:
-      case kTokenRParen: {
+      case kTokenRParen:
+      case kTokenRBracket: {
         _tokenizer.set(&token);
 
         if (oNode) {
@@ -1134,11 +1141,13 @@ _UnaryPostfixOp: {
 
       // Parse '.' object's accessor.
       case kTokenDot: {
-        // Fail if the current node is not a variable.
+        // Fail if the current node is not a variable or an array element.
         uint32_t position = token.getPosAsUInt();
         AstNode* aNode = unary ? unary->getChild() : tNode;
 
-        if (aNode == nullptr || (aNode->getNodeType() != AstNode::kTypeVar && aNode->getNodeType() != AstNode::kTypeVarMemb))
+        if (aNode == nullptr || (aNode->getNodeType() != AstNode::kTypeVar &&
+                                 aNode->getNodeType() != AstNode::kTypeVarMemb &&
+                                 aNode->getNodeType() != AstNode::kTypeIndex))
           MPSL_PARSER_ERROR(token, "Unexpected member access.");
 
         if (_tokenizer.next(&token) != kTokenSymbol)
@@ -1154,6 +1163,8 @@ _UnaryPostfixOp: {
         zNode->setPosition(position);
         zNode->setField(zMemb, token.length);
 
+        // The accessor replaces the node it accesses, `unary` is kept so the
+        // next postfix operator applies to the accessor, like `obj.memb.xy`.
         if (unary == nullptr) {
           zNode->setChild(aNode);
           tNode = zNode;
@@ -1163,7 +1174,38 @@ _UnaryPostfixOp: {
           zNode->setChild(aNode);
         }
 
-        unary = zNode;
+        goto _Repeat2;
+      }
+
+      // Parse '[' array's element.
+      case kTokenLBracket: {
+        // Fail if the current node is not a variable.
+        uint32_t position = token.getPosAsUInt();
+        AstNode* aNode = unary ? unary->getChild() : tNode;
+
+        if (aNode == nullptr || (aNode->getNodeType() != AstNode::kTypeVar && aNode->getNodeType() != AstNode::kTypeVarMemb))
+          MPSL_PARSER_ERROR(token, "Unexpected array index.");
+
+        AstNode* iNode;
+        MPSL_PROPAGATE(parseExpression(&iNode));
+
+        AstIndex* zNode = _ast->newNode<AstIndex>();
+        MPSL_NULLCHECK_(zNode, { _ast->deleteNode(iNode); });
+        zNode->setPosition(position);
+
+        if (unary == nullptr) {
+          zNode->setLeft(aNode);
+          tNode = zNode;
+        }
+        else {
+          unary->setChild(zNode);
+          zNode->setLeft(aNode);
+        }
+        zNode->setRight(iNode);
+
+        if (_tokenizer.next(&token) != kTokenRBracket)
+          MPSL_PARSER_ERROR(token, "Expected ']' token.");
+
         goto _Repeat2;
       }
 
@@ -48,8 +48,19 @@ public:
   MPSL_INLINE Parser(AstBuilder* ast, ErrorReporter* errorReporter, const char* body, size_t len) noexcept
     : _ast(ast),
       _errorReporter(errorReporter),
+      _programScope(ast->getGlobalScope()),
       _currentScope(ast->getGlobalScope()),
-      _tokenizer(body, len) {}
+      _tokenizer(body, 0, len) {}
+
+  //! Create a parser of `[start, end)` range of `body` that puts functions and
+  //! global declarations into `scope`, used to parse stages of a `Pipeline`.
+  //! Token positions are relative to `body`.
+  MPSL_INLINE Parser(AstBuilder* ast, ErrorReporter* errorReporter, const char* body, size_t start, size_t end, AstScope* scope) noexcept
+    : _ast(ast),
+      _errorReporter(errorReporter),
+      _programScope(scope),
+      _currentScope(scope),
+      _tokenizer(body, start, end) {}
   MPSL_INLINE ~Parser() noexcept {}
 
   // --------------------------------------------------------------------------
@@ -91,6 +102,7 @@ public:
   AstBuilder* _ast;
   ErrorReporter* _errorReporter;
 
+  AstScope* _programScope;               //!< Scope of functions and global declarations.
   AstScope* _currentScope;
   Tokenizer _tokenizer;
 };
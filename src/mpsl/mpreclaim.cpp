@@ -0,0 +1,218 @@
+// [MPSL]
+// MathPresso's Shading Language with JIT Engine for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define MPSL_EXPORTS
+
+// [Dependencies - MPSL]
+#include "./mpreclaim_p.h"
+
+// [Dependencies - C]
+#if defined(_WIN32)
+# include <windows.h>
+#else
+# include <sched.h>
+#endif
+
+// [Api-Begin]
+#include "./mpsl_apibegin.h"
+
+namespace mpsl {
+
+// ============================================================================
+// [mpsl::Reclaim - Internal]
+// ============================================================================
+
+enum { kReclaimSlotsCount = 16 };
+
+//! \internal
+//!
+//! Readers of both epochs, each slot has its own cache line so readers of
+//! different threads don't share it.
+struct ReclaimSlot {
+  uintptr_t readers[2];
+  uint8_t padding[64 - 2 * sizeof(uintptr_t)];
+};
+
+//! \internal
+struct ReclaimItem {
+  ReclaimFunc func;
+  void* p;
+};
+
+//! \internal
+struct ReclaimList {
+  ReclaimItem* items;
+  size_t count;
+  size_t capacity;
+};
+
+//! \internal
+//!
+//! Reclamation state shared by all contexts, lists are guarded by `lock`.
+struct ReclaimState {
+  ReclaimSlot slots[kReclaimSlotsCount];
+  uintptr_t epoch;
+
+  SpinLock lock;
+  //! Objects retired since the last flip of `epoch`.
+  ReclaimList pending;
+  //! Objects retired before the last flip, wait for readers of the previous
+  //! epoch to leave.
+  ReclaimList waiting;
+};
+
+static ReclaimState mpReclaimState;
+
+static MPSL_INLINE void mpReclaimYield() noexcept {
+#if defined(_WIN32)
+  ::SwitchToThread();
+#else
+  ::sched_yield();
+#endif
+}
+
+static MPSL_INLINE void mpReclaimSwap(ReclaimList& a, ReclaimList& b) noexcept {
+  ReclaimList tmp = a;
+  a = b;
+  b = tmp;
+}
+
+static bool mpReclaimAppend(ReclaimList& list, ReclaimFunc func, void* p) noexcept {
+  if (list.count == list.capacity) {
+    size_t capacity = list.capacity ? list.capacity * 2 : size_t(16);
+    ReclaimItem* items = static_cast<ReclaimItem*>(
+      ::realloc(list.items, capacity * sizeof(ReclaimItem)));
+
+    if (items == nullptr)
+      return false;
+
+    list.items = items;
+    list.capacity = capacity;
+  }
+
+  ReclaimItem& item = list.items[list.count++];
+  item.func = func;
+  item.p = p;
+  return true;
+}
+
+static bool mpReclaimHasReaders(ReclaimState& state, uintptr_t parity) noexcept {
+  for (uint32_t i = 0; i < kReclaimSlotsCount; i++) {
+    if (mpAtomicGet(&state.slots[i].readers[parity]) != 0)
+      return true;
+  }
+  return false;
+}
+
+// Move objects whose grace period has ended to `out`, which must be empty, and
+// start a new grace period for objects retired since the last one. Must be
+// called with `state.lock` held.
+static void mpReclaimAdvance(ReclaimState& state, ReclaimList& out) noexcept {
+  if (state.waiting.count != 0) {
+    if (mpReclaimHasReaders(state, (mpAtomicGet(&state.epoch) - 1) & 1))
+      return;
+    mpReclaimSwap(out, state.waiting);
+  }
+
+  if (state.pending.count != 0) {
+    mpReclaimSwap(state.waiting, state.pending);
+    uintptr_t parity = (mpAtomicInc(&state.epoch) - 1) & 1;
+
+    // Readers are usually short, the grace period can end right away.
+    if (out.count == 0 && !mpReclaimHasReaders(state, parity))
+      mpReclaimSwap(out, state.waiting);
+  }
+}
+
+// Free objects moved out of the state, called without the lock as freeing
+// machine code takes other locks.
+static void mpReclaimRun(ReclaimList& list) noexcept {
+  for (size_t i = 0; i < list.count; i++)
+    list.items[i].func(list.items[i].p);
+  ::free(list.items);
+}
+
+// ============================================================================
+// [mpsl::Reclaim - Interface]
+// ============================================================================
+
+uintptr_t* mpReclaimEnter() noexcept {
+  ReclaimState& state = mpReclaimState;
+
+  // Threads don't share stacks, which spreads them over slots without having
+  // to get a thread id.
+  int local;
+  uintptr_t h = static_cast<uintptr_t>(reinterpret_cast<uintptr_t>(&local) >> 12);
+  ReclaimSlot& slot = state.slots[static_cast<uint32_t>(h * 0x9E3779B1U) >> 28];
+
+  for (;;) {
+    uintptr_t epoch = mpAtomicGet(&state.epoch);
+    uintptr_t* counter = &slot.readers[epoch & 1];
+
+    mpAtomicInc(counter);
+
+    // If the epoch has been flipped meanwhile the grace period may have missed
+    // this reader, enter again in the new epoch.
+    if (mpAtomicGet(&state.epoch) == epoch)
+      return counter;
+
+    mpAtomicDec(counter);
+  }
+}
+
+void mpReclaimLeave(uintptr_t* counter) noexcept {
+  mpAtomicDec(counter);
+}
+
+void mpReclaimRetire(ReclaimFunc func, void* p) noexcept {
+  ReclaimState& state = mpReclaimState;
+  ReclaimList out = { nullptr, 0, 0 };
+  bool deferred;
+
+  {
+    AutoSpinLock guard(state.lock);
+    deferred = mpReclaimAppend(state.pending, func, p);
+
+    if (deferred) {
+      mpReclaimAdvance(state, out);
+    }
+    else {
+      // There is no memory to defer `p`, wait until readers of both epochs
+      // have left, which ends the grace period of waiting objects as well.
+      for (uint32_t i = 0; i < 2; i++) {
+        uintptr_t parity = (mpAtomicInc(&state.epoch) - 1) & 1;
+        while (mpReclaimHasReaders(state, parity))
+          mpReclaimYield();
+      }
+      mpReclaimSwap(out, state.waiting);
+    }
+  }
+
+  if (!deferred)
+    func(p);
+  mpReclaimRun(out);
+}
+
+size_t mpReclaimPoll() noexcept {
+  ReclaimState& state = mpReclaimState;
+  ReclaimList out = { nullptr, 0, 0 };
+  size_t remaining;
+
+  {
+    AutoSpinLock guard(state.lock);
+    mpReclaimAdvance(state, out);
+    remaining = state.pending.count + state.waiting.count;
+  }
+
+  mpReclaimRun(out);
+  return remaining;
+}
+
+} // mpsl namespace
+
+// [Api-End]
+#include "./mpsl_apiend.h"
@@ -0,0 +1,67 @@
+// [MPSL]
+// MathPresso's Shading Language with JIT Engine for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _MPSL_MPRECLAIM_P_H
+#define _MPSL_MPRECLAIM_P_H
+
+// [Dependencies - MPSL]
+#include "./mpsl_p.h"
+
+// [Api-Begin]
+#include "./mpsl_apibegin.h"
+
+namespace mpsl {
+
+// ============================================================================
+// [mpsl::Reclaim]
+// ============================================================================
+
+//! \internal
+//!
+//! Function that frees an object passed to `mpReclaimRetire()`.
+typedef void (*ReclaimFunc)(void* p);
+
+//! \internal
+//!
+//! Enter a read section, objects retired after it's entered are not freed
+//! until it's left by `mpReclaimLeave()`, which must be passed the returned
+//! counter.
+//!
+//! Readers never block. They are spread over counters of separate cache lines
+//! and only retry if a grace period started while they were entering.
+uintptr_t* mpReclaimEnter() noexcept;
+
+//! \internal
+//!
+//! Leave a read section entered by `mpReclaimEnter()`.
+void mpReclaimLeave(uintptr_t* counter) noexcept;
+
+//! \internal
+//!
+//! Free `p` by `func` once no thread is in a read section that could have
+//! seen it. `p` must already be unreachable for new readers.
+//!
+//! Reclamation is shared by all contexts of the process. Objects are grouped
+//! by grace periods, each starts by flipping the epoch and ends once readers
+//! of the previous epoch have left. Nothing waits for readers, a grace period
+//! that hasn't ended is checked again when another object is retired or by
+//! `mpReclaimPoll()`.
+void mpReclaimRetire(ReclaimFunc func, void* p) noexcept;
+
+//! \internal
+//!
+//! Free objects whose grace period has ended, returns the number of objects
+//! that still wait.
+size_t mpReclaimPoll() noexcept;
+
+} // mpsl namespace
+
+// [Api-End]
+#include "./mpsl_apiend.h"
+
+// [Guard]
+#endif // _MPSL_MPRECLAIM_P_H
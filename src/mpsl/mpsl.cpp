@@ -7,17 +7,33 @@
 // [Export]
 #define MPSL_EXPORTS
 
+// [Dependencies - C]
+#if defined(_WIN32)
+# include <windows.h>
+#else
+# include <sched.h>
+# include <time.h>
+#endif
+
 // [Dependencies - MPSL]
 #include "./mpast_p.h"
 #include "./mpastoptimizer_p.h"
 #include "./mpcodegen_p.h"
 #include "./mpatomic_p.h"
+#include "./mparena_p.h"
+#include "./mpcache_p.h"
 #include "./mpformatutils_p.h"
+#include "./mphash_p.h"
 #include "./mpir_p.h"
+#include "./mpirbackend_p.h"
+#include "./mpirlower_p.h"
 #include "./mpirpass_p.h"
 #include "./mpirtox86_p.h"
+#include "./mpjitsymbols_p.h"
 #include "./mplang_p.h"
+#include "./mpparallel_p.h"
 #include "./mpparser_p.h"
+#include "./mpreclaim_p.h"
 
 // [Api-Begin]
 #include "./mpsl_apibegin.h"
@@ -60,20 +76,215 @@ MPSL_INLINE void mpObjectRelease(T* self) noexcept {
     self->destroy();
 }
 
+// ============================================================================
+// [mpsl::ProgramSpec]
+// ============================================================================
+
+//! \internal
+//!
+//! Copy of the source and layouts of a program that has members bound at
+//! compile time (see `kTypeBind`), kept by `Program::Impl` so the program can
+//! be compiled again by `Program::_respecialize()` with different values. It's
+//! also kept by `CompileJob::Impl` until the job compiles the program.
+struct ProgramSpec {
+  //! Options passed to `Context::_compile()`.
+  uint32_t options;
+  //! Number of arguments.
+  uint32_t numArgs;
+  //! Program body, stored right after the `ProgramSpec`.
+  const char* body;
+  //! Program body length.
+  size_t bodyLength;
+  //! Copies of all layouts.
+  Layout layout[Globals::kMaxArgumentsCount];
+};
+
+static void mpProgramSpecDestroy(ProgramSpec* spec) noexcept {
+  if (spec == nullptr)
+    return;
+
+  for (uint32_t i = 0; i < Globals::kMaxArgumentsCount; i++)
+    spec->layout[i].~Layout();
+  ::free(spec);
+}
+
+static Error mpLayoutCopy(Layout& dst, const Layout& src) noexcept {
+  if (src.hasName())
+    MPSL_PROPAGATE(dst._configure(src.getName(), src.getNameLength()));
+  MPSL_PROPAGATE(dst.setFlags(src.getFlags()));
+  MPSL_PROPAGATE(dst.setAlignment(src.getAlignment()));
+
+  const Layout::Member* m = src.getMembersArray();
+  for (uint32_t i = 0, count = src.getMembersCount(); i < count; i++)
+    MPSL_PROPAGATE(dst._add(m[i].name, m[i].nameLength, m[i].typeInfo, m[i].offset, m[i].count));
+
+  return kErrorOk;
+}
+
+static ProgramSpec* mpProgramSpecCreate(const Context::CompileArgs& ca, const char* body, size_t len) noexcept {
+  ProgramSpec* spec = static_cast<ProgramSpec*>(::malloc(sizeof(ProgramSpec) + len + 1));
+  if (spec == nullptr)
+    return nullptr;
+
+  char* specBody = reinterpret_cast<char*>(spec + 1);
+  ::memcpy(specBody, body, len);
+  specBody[len] = '\0';
+
+  spec->options = ca.options;
+  spec->numArgs = ca.numArgs;
+  spec->body = specBody;
+  spec->bodyLength = len;
+
+  for (uint32_t i = 0; i < Globals::kMaxArgumentsCount; i++)
+    new(&spec->layout[i]) Layout();
+
+  for (uint32_t i = 0; i < ca.numArgs; i++) {
+    if (mpLayoutCopy(spec->layout[i], *ca.layout[i]) != kErrorOk) {
+      mpProgramSpecDestroy(spec);
+      return nullptr;
+    }
+  }
+
+  return spec;
+}
+
+// ============================================================================
+// [mpsl::ProgramBlob]
+// ============================================================================
+
+//! \internal
+//!
+//! Header of a serialized program, followed by `codeSize` bytes of code.
+struct ProgramBlob {
+  enum {
+    //! "MPSL" in little-endian.
+    kMagic = 0x4C53504D,
+    //! Incremented each time the format or generated code changes incompatibly.
+    kVersion = 2
+  };
+
+  uint32_t magic;                        //!< Magic, must be `kMagic`.
+  uint32_t version;                      //!< Version, must be `kVersion`.
+  uint32_t pointerWidth;                 //!< Pointer width of the target.
+  uint32_t features;                     //!< CPU features used by the code.
+  uint32_t options;                      //!< Options the program was compiled with.
+  uint32_t layoutHash;                   //!< Hash of layouts.
+  uint32_t argsCount;                    //!< Number of arguments.
+  uint32_t variant;                      //!< Variant of the code.
+  uint32_t regPressure;                  //!< See `Program::getRegPressure()`.
+  uint32_t spillCount;                   //!< See `Program::getSpillCount()`.
+  uint32_t codeSize;                     //!< Size of the code.
+  uint32_t batchOffset;                  //!< Offset of the batch entry-point.
+  uint32_t codeHash;                     //!< Hash of the code (its `constSlot` zeroed).
+  uint32_t constSlot;                    //!< Offset of the address of shared constants, zero if none.
+  uint32_t reserved;                     //!< Reserved, must be zero.
+};
+
+// The code references its constant pool and functions it calls relative to
+// RIP, so it can be moved. The only absolute address is the one of constants
+// shared by all programs, which is patched when loaded. X86 code uses absolute
+// addresses of constants. Counters are referenced by an absolute address too
+// and exist only in this process.
+static MPSL_INLINE bool mpIsSerializable(const Program::Impl* d) noexcept {
+  return kPointerWidth == 8 && d->_main != nullptr && d->_counters == nullptr;
+}
+
+// ============================================================================
+// [mpsl::Impl - Destroy]
+// ============================================================================
+
 // Declared in public "mpsl.h" header.
 MPSL_INLINE void Context::Impl::destroy() noexcept {
   RuntimeData* rt = static_cast<RuntimeData*>(_runtimeData);
+  ProgramCache* cache = static_cast<ProgramCache*>(_programCache);
+  AstBuiltIns* builtIns = static_cast<AstBuiltIns*>(_builtIns);
+  ArenaPool* arenaPool = static_cast<ArenaPool*>(_arenaPool);
+
+  // Cached programs reference the runtime, release them first.
+  if (cache != nullptr)
+    cache->destroy();
+
+  if (builtIns != nullptr)
+    builtIns->destroy();
+
+  if (arenaPool != nullptr)
+    arenaPool->destroy();
 
   mpObjectRelease(rt);
   ::free(this);
 }
 
-MPSL_INLINE void Program::Impl::destroy() noexcept {
-  RuntimeData* rt = static_cast<RuntimeData*>(_runtimeData);
-  rt->_runtime.release(_main);
+// Register code of all variants of `d` with profilers selected by `flags`.
+static void mpProgramAddSymbols(Program::Impl* d, uint32_t flags) noexcept {
+  static const char kVariantNames[kVariantCount][8] = { "sse2", "sse4_1", "avx2" };
+
+  d->_jitSymbols = flags;
+  if (flags == 0)
+    return;
+
+  uint32_t variantsCount = 0;
+  for (uint32_t v = 0; v < kVariantCount; v++)
+    variantsCount += d->_variantMain[v] != nullptr;
+
+  StringBuilderTmp<128> name;
+  for (uint32_t v = 0; v < kVariantCount; v++) {
+    if (d->_variantMain[v] == nullptr)
+      continue;
+
+    if (d->_name != nullptr)
+      name.setString(d->_name);
+    else
+      name.setFormat("mpsl_%08X", d->_sourceHash);
+
+    if (variantsCount > 1)
+      name.appendFormat(".%s", kVariantNames[v]);
+
+    mpJitSymbolsAdd(flags, d->_variantMain[v], d->_variantSize[v], name.getData());
+  }
+}
+
+// Remove code of all variants of `d` from profilers, must be called before
+// the code is released.
+static void mpProgramRemoveSymbols(Program::Impl* d) noexcept {
+  if (d->_jitSymbols == 0)
+    return;
 
+  for (uint32_t v = 0; v < kVariantCount; v++) {
+    if (d->_variantMain[v] != nullptr)
+      mpJitSymbolsRemove(d->_jitSymbols, d->_variantMain[v]);
+  }
+  d->_jitSymbols = 0;
+}
+
+// Free a program retired by `Program::Impl::destroy()`. The program keeps its
+// runtime alive, so the code is released after all runs of it have finished
+// even if the context has been destroyed meanwhile.
+static void mpProgramFree(void* p) noexcept {
+  Program::Impl* d = static_cast<Program::Impl*>(p);
+  RuntimeData* rt = static_cast<RuntimeData*>(d->_runtimeData);
+  mpProgramRemoveSymbols(d);
+
+  for (uint32_t v = 0; v < kVariantCount; v++) {
+    if (d->_variantMain[v] != nullptr)
+      rt->release(d->_variantMain[v], d->_variantConstPool[v]);
+  }
+
+  rt->detachProgram();
+  mpProgramSpecDestroy(static_cast<ProgramSpec*>(d->_spec));
+  mpParallelReduceDestroy(static_cast<ParallelReduce*>(d->_reduce));
+  ::free(d->_counters);
+  ::free(d->_name);
   mpObjectRelease(rt);
-  ::free(this);
+  ::free(d);
+}
+
+// Other threads may still run the program, see `Program::swap()`.
+MPSL_INLINE void Program::Impl::destroy() noexcept {
+  mpReclaimRetire(mpProgramFree, this);
+}
+
+static void mpProgramCacheRelease(Program::Impl* d) noexcept {
+  mpObjectRelease(d);
 }
 
 // ============================================================================
@@ -134,6 +345,7 @@ static MPSL_NOINLINE Error mpLayoutResize(Layout* self, uint32_t dataSize) noexc
     newMember->name = reinterpret_cast<char*>(newData + dataIndex);
     newMember->typeInfo = oldMember->typeInfo;
     newMember->offset = oldMember->offset;
+    newMember->count = oldMember->count;
   }
 
   self->_data = newData;
@@ -168,6 +380,8 @@ Layout::Layout() noexcept
   : _data(nullptr),
     _name(nullptr),
     _nameLength(0),
+    _flags(0),
+    _alignment(1),
     _membersCount(0),
     _dataSize(0),
     _dataIndex(0) {}
@@ -176,6 +390,8 @@ Layout::Layout(uint8_t* data, uint32_t dataSize) noexcept
   : _data(data),
     _name(nullptr),
     _nameLength(0),
+    _flags(0),
+    _alignment(1),
     _membersCount(0),
     _dataSize(dataSize),
     _dataIndex(dataSize) {}
@@ -216,6 +432,25 @@ Error Layout::_configure(const char* name, size_t len) noexcept {
   return kErrorOk;
 }
 
+Error Layout::setFlags(uint32_t flags) noexcept {
+  if (flags & ~static_cast<uint32_t>(kFlagSoA))
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  if (_membersCount != 0)
+    return MPSL_TRACE_ERROR(kErrorAlreadyConfigured);
+
+  _flags = flags;
+  return kErrorOk;
+}
+
+Error Layout::setAlignment(uint32_t alignment) noexcept {
+  if (alignment == 0 || alignment > Globals::kMaxLayoutAlignment || (alignment & (alignment - 1)) != 0)
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  _alignment = alignment;
+  return kErrorOk;
+}
+
 const Layout::Member* Layout::_get(const char* name, size_t len) const noexcept {
   if (name == nullptr)
     return nullptr;
@@ -226,7 +461,7 @@ const Layout::Member* Layout::_get(const char* name, size_t len) const noexcept
   return mpLayoutFind(this, name, len);
 }
 
-Error Layout::_add(const char* name, size_t len, uint32_t typeInfo, int32_t offset) noexcept {
+Error Layout::_add(const char* name, size_t len, uint32_t typeInfo, int32_t offset, uint32_t count) noexcept {
   if (name == nullptr)
     return MPSL_TRACE_ERROR(kErrorInvalidArgument);
 
@@ -236,8 +471,53 @@ Error Layout::_add(const char* name, size_t len, uint32_t typeInfo, int32_t offs
   if (len > Globals::kMaxIdentifierLength)
     return MPSL_TRACE_ERROR(kErrorInvalidArgument);
 
-  uint32_t count = _membersCount;
-  if (count >= Globals::kMaxMembersCount)
+  // Columns of a SoA layout can only hold scalars.
+  if (isSoA() && TypeInfo::isVectorType(typeInfo))
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  // Only 3-element vectors have padding, columns are dense.
+  if ((typeInfo & kTypePadded) != 0 && ((typeInfo & kTypeVecMask) != kTypeVec3 || isSoA()))
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  // Narrow formats only store 4-element vectors, normalized ones are floats.
+  if ((typeInfo & (kTypeStorageMask | kTypeNormalized)) != 0) {
+    uint32_t storage = typeInfo & kTypeStorageMask;
+    uint32_t typeId = typeInfo & kTypeIdMask;
+
+    if (storage == 0 || (typeInfo & kTypeVecMask) != kTypeVec4 || isSoA() || count != 0 ||
+        (typeInfo & (kTypeBind | kTypeReduceMask | kTypePadded)) != 0 ||
+        (typeId != kTypeInt && typeId != kTypeFloat) ||
+        (typeId != kTypeFloat && (storage == kTypeStorageF16 || (typeInfo & kTypeNormalized) != 0)) ||
+        (storage == kTypeStorageF16 && (typeInfo & kTypeNormalized) != 0))
+      return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+  }
+
+  // Bound members are constants and are not read from columns.
+  if ((typeInfo & kTypeBind) != 0 && ((typeInfo & kTypeWrite) != 0 || isSoA()))
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  // Reductions are combined with the data by a batch, they are write-only.
+  if ((typeInfo & kTypeReduceMask) != 0) {
+    uint32_t typeId = typeInfo & kTypeIdMask;
+    if ((typeInfo & (kTypeRW | kTypeBind)) != kTypeWrite || isSoA() ||
+        (typeId != kTypeInt && typeId != kTypeFloat && typeId != kTypeDouble))
+      return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+  }
+
+  // Arrays are read-only tables indexed by an `int`, elements are addressed
+  // by scaling the index so their size must be a power of 2.
+  if (count != 0) {
+    uint32_t size = mpArrayStride(typeInfo);
+    if ((typeInfo & (kTypeRW | kTypeBind | kTypeReduceMask)) != kTypeRead || isSoA() ||
+        (size & (size - 1)) != 0 || count > static_cast<uint32_t>(0x7FFFFFFF) / size)
+      return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+  }
+  else if ((typeInfo & kTypeIndirect) != 0) {
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+  }
+
+  uint32_t index = _membersCount;
+  if (index >= Globals::kMaxMembersCount)
     return MPSL_TRACE_ERROR(kErrorTooManyMembers);
 
   Member* member = mpLayoutFind(this, name, len);
@@ -245,7 +525,7 @@ Error Layout::_add(const char* name, size_t len, uint32_t typeInfo, int32_t offs
     return MPSL_TRACE_ERROR(kErrorAlreadyExists);
 
   MPSL_PROPAGATE(mpLayoutPrepareAdd(this, len + 1 + static_cast<uint32_t>(sizeof(Member))));
-  member = _members + count;
+  member = _members + index;
   uint32_t dataIndex = _dataIndex - (static_cast<uint32_t>(len) + 1);
 
   ::memcpy(_data + dataIndex, name, len + 1);
@@ -253,17 +533,124 @@ Error Layout::_add(const char* name, size_t len, uint32_t typeInfo, int32_t offs
   member->nameLength = static_cast<uint32_t>(len);
   member->typeInfo = typeInfo;
   member->offset = offset;
+  member->count = count;
 
   _membersCount++;
   _dataIndex = dataIndex;
   return kErrorOk;
 }
 
+// ============================================================================
+// [mpsl::Pipeline - Interface]
+// ============================================================================
+
+Error Pipeline::addStage(const StringRef& body, const char* retLink) noexcept {
+  if (body.getData() == nullptr || _stagesCount >= Globals::kMaxPipelineStages)
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  Stage& stage = _stages[_stagesCount++];
+  stage.body = body;
+  stage.retLink = retLink;
+  return kErrorOk;
+}
+
+Error Pipeline::addLink(const char* name, uint32_t typeInfo) noexcept {
+  if (name == nullptr || _linksCount >= Globals::kMaxPipelineLinks)
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  size_t len = ::strlen(name);
+  if (len == 0 || len > Globals::kMaxIdentifierLength)
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  // Links are registers, they can't be pointers or have qualifiers.
+  uint32_t typeId = typeInfo & kTypeIdMask;
+  if (typeId == kTypeVoid || typeId >= kTypePtr || (typeInfo & ~(kTypeIdMask | kTypeVecMask)) != 0)
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  Link& link = _links[_linksCount++];
+  link.name = name;
+  link.typeInfo = typeInfo;
+  return kErrorOk;
+}
+
+//! \internal
+//!
+//! Check that `pipeline` has stages and all links its stages return to.
+static Error mpPipelineValidate(const Pipeline& pipeline) noexcept {
+  uint32_t stagesCount = pipeline.getStagesCount();
+  uint32_t linksCount = pipeline.getLinksCount();
+
+  if (stagesCount == 0)
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  for (uint32_t i = 0; i < stagesCount; i++) {
+    const char* retLink = pipeline.getStage(i).retLink;
+    if (retLink == nullptr)
+      continue;
+
+    uint32_t j = 0;
+    while (j < linksCount && ::strcmp(pipeline.getLink(j).name, retLink) != 0)
+      j++;
+
+    if (j == linksCount)
+      return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+  }
+
+  return kErrorOk;
+}
+
+//! \internal
+//!
+//! Concatenate stages of `pipeline` into a single source allocated by `heap`,
+//! each stage is followed by a new-line. The i-th stage ends at `stageEnd[i]`.
+static Error mpPipelineConcat(ZoneHeap* heap, const Pipeline& pipeline,
+  const char*& body, size_t& len, size_t* stageEnd) noexcept {
+
+  uint32_t i, stagesCount = pipeline.getStagesCount();
+  size_t size = 0;
+
+  for (i = 0; i < stagesCount; i++)
+    size += pipeline.getStage(i).body.getLength() + 1;
+
+  char* p = static_cast<char*>(heap->alloc(size + 1));
+  MPSL_NULLCHECK(p);
+
+  size_t offset = 0;
+  for (i = 0; i < stagesCount; i++) {
+    const StringRef& stageBody = pipeline.getStage(i).body;
+
+    ::memcpy(p + offset, stageBody.getData(), stageBody.getLength());
+    offset += stageBody.getLength();
+
+    stageEnd[i] = offset;
+    p[offset++] = '\n';
+  }
+
+  p[offset] = '\0';
+  body = p;
+  len = offset;
+  return kErrorOk;
+}
+
 // ============================================================================
 // [mpsl::Context - Construction / Destruction]
 // ============================================================================
 
-static const Context::Impl mpContextNull = { 0, nullptr };
+static const Context::Impl mpContextNull = { 0, nullptr, nullptr, nullptr, nullptr, 0, 0, kVariantSSE2 };
+
+// Get the best variant supported by the host CPU.
+static uint32_t mpDetectCpuVariant() noexcept {
+  const asmjit::CpuInfo& cpu = asmjit::CpuInfo::getHost();
+
+  if (cpu.hasFeature(asmjit::CpuInfo::kX86FeatureAVX) &&
+      cpu.hasFeature(asmjit::CpuInfo::kX86FeatureAVX2))
+    return kVariantAVX2;
+
+  if (cpu.hasFeature(asmjit::CpuInfo::kX86FeatureSSE4_1))
+    return kVariantSSE4_1;
+
+  return kVariantSSE2;
+}
 
 Context::Context() noexcept
   : _d(const_cast<Impl*>(&mpContextNull)) {}
@@ -284,14 +671,26 @@ Context Context::create() noexcept {
   }
   else {
     RuntimeData* rt = static_cast<RuntimeData*>(::malloc(sizeof(RuntimeData)));
-    if (rt == nullptr) {
+    ProgramCache* cache = static_cast<ProgramCache*>(::malloc(sizeof(ProgramCache)));
+    ArenaPool* arenaPool = static_cast<ArenaPool*>(::malloc(sizeof(ArenaPool)));
+
+    if (rt == nullptr || cache == nullptr || arenaPool == nullptr) {
       // Allocation failure.
+      ::free(arenaPool);
+      ::free(cache);
+      ::free(rt);
       ::free(d);
       d = const_cast<Impl*>(&mpContextNull);
     }
     else {
       d->_refCount = 1;
       d->_runtimeData = new(rt) RuntimeData();
+      d->_programCache = new(cache) ProgramCache(mpProgramCacheRelease);
+      d->_builtIns = nullptr;
+      d->_arenaPool = new(arenaPool) ArenaPool();
+      d->_unrollLimit = Globals::kDefaultUnrollLimit;
+      d->_inlineLimit = Globals::kDefaultInlineLimit;
+      d->_cpuVariant = mpDetectCpuVariant();
     }
   }
 
@@ -314,142 +713,827 @@ Error Context::reset() noexcept {
 // ============================================================================
 
 Error Context::clone() noexcept {
+  if (!isValid())
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  Context copy = create();
+  if (!copy.isValid())
+    return MPSL_TRACE_ERROR(kErrorNoMemory);
+
+  // Programs are not copied, the clone starts with an empty program cache.
+  CacheStats stats;
+  MPSL_PROPAGATE(getCacheStats(stats));
+  MPSL_PROPAGATE(copy.setCacheLimit(stats.limit));
+  MPSL_PROPAGATE(copy.setUnrollLimit(getUnrollLimit()));
+  MPSL_PROPAGATE(copy.setInlineLimit(getInlineLimit()));
+  MPSL_PROPAGATE(copy.setJitSymbols(getJitSymbols()));
+
+  // The code of programs stays with this context, only its limit is copied.
+  MemoryStats memoryStats;
+  MPSL_PROPAGATE(getMemoryStats(memoryStats));
+  MPSL_PROPAGATE(copy.setCodeLimit(memoryStats.limit));
+
+  mpObjectRelease(
+    mpAtomicSetXchgT<Impl*>(
+      &_d, mpObjectAddRef(copy._d)));
 
-  // TODO:
   return kErrorOk;
 }
 
 Error Context::freeze() noexcept {
+  if (!isValid())
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
 
-  // TODO:
-  return kErrorOk;
+  if (isFrozen())
+    return kErrorOk;
+
+  AstBuiltIns* builtIns = static_cast<AstBuiltIns*>(::malloc(sizeof(AstBuiltIns)));
+  if (builtIns == nullptr)
+    return MPSL_TRACE_ERROR(kErrorNoMemory);
+
+  new(builtIns) AstBuiltIns();
+  Error err = builtIns->init();
+
+  // Another thread could freeze the context at the same time, keep the first.
+  if (err != kErrorOk || !mpAtomicCmpXchg(reinterpret_cast<uintptr_t*>(&_d->_builtIns),
+      0, reinterpret_cast<uintptr_t>(builtIns))) {
+    builtIns->destroy();
+  }
+
+  return err;
 }
 
 // ============================================================================
-// [mpsl::Context - Compile]
+// [mpsl::Context - Program Cache]
 // ============================================================================
 
-#define MPSL_PROPAGATE_AND_HANDLE_COLLISION(...)                              \
-  do {                                                                        \
-    AstSymbol* collidedSymbol = nullptr;                                      \
-    Error _errorValue = __VA_ARGS__;                                          \
-                                                                              \
-    if (MPSL_UNLIKELY(_errorValue)) {                                         \
-      if (_errorValue == kErrorSymbolCollision && log) {                      \
-        sbTmp.setFormat("Built-in symbol collision: '%s' already defined",    \
-          collidedSymbol->getName());                                         \
-        log->log(OutputLog::Message(                                          \
-          OutputLog::kMessageError, 0, 0,                                     \
-          StringRef("ERROR", 5),                                              \
-          StringRef(sbTmp.getData(), sbTmp.getLength())));                    \
-      }                                                                       \
-      return _errorValue;                                                     \
-    }                                                                         \
-  } while (0)
-
-Error Context::_compile(Program& program, const CompileArgs& ca, OutputLog* log) noexcept {
-  const char* body = ca.body.getData();
-  size_t len = ca.body.getLength();
+Error Context::setCacheLimit(uint32_t limit) noexcept {
+  ProgramCache* cache = static_cast<ProgramCache*>(_d->_programCache);
+  if (cache == nullptr)
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
 
-  uint32_t options = ca.options;
-  uint32_t numArgs = ca.numArgs;
+  cache->setLimit(limit);
+  return kErrorOk;
+}
 
-  if (numArgs == 0 || numArgs > Globals::kMaxArgumentsCount)
-    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+Error Context::getCacheStats(CacheStats& out) const noexcept {
+  ProgramCache* cache = static_cast<ProgramCache*>(_d->_programCache);
+  if (cache == nullptr) {
+    ::memset(&out, 0, sizeof(CacheStats));
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+  }
 
-  // --------------------------------------------------------------------------
-  // [Debug Strings]
-  // --------------------------------------------------------------------------
+  cache->getStats(out);
+  return kErrorOk;
+}
 
-  static const char kDebugHeadingAST[] = "AST";
-  static const char kDebugHeadingIR[]  = "IR";
-  static const char kDebugHeadingASM[] = "ASM";
+Error Context::clearCache() noexcept {
+  ProgramCache* cache = static_cast<ProgramCache*>(_d->_programCache);
+  if (cache == nullptr)
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
 
-  // --------------------------------------------------------------------------
-  // [Init]
-  // --------------------------------------------------------------------------
+  cache->clear();
+  return kErrorOk;
+}
 
-  // Init options first.
-  options &= _kOptionsMask;
+static MPSL_INLINE Error mpProgramKeyAppend(StringBuilder& sb, const void* data, size_t size) noexcept {
+  if (sb.appendString(static_cast<const char*>(data), size))
+    return MPSL_TRACE_ERROR(kErrorNoMemory);
+  return kErrorOk;
+}
 
-  if (log)
-    options |= kInternalOptionLog;
-  else
-    options &= ~(kOptionVerbose | kOptionDebugAst | kOptionDebugIR | kOptionDebugASM);
+//! \internal
+//!
+//! Serialize `layouts` into `sb`, values of bound members are included only if
+//! `values` is not null.
+static Error mpLayoutKeyBuild(StringBuilder& sb,
+  uint32_t numArgs, const Layout* const* layouts, const void* const* values) noexcept {
 
-  if (len == Globals::kInvalidIndex)
-    len = ::strlen(body);
+  for (uint32_t slot = 0; slot < numArgs; slot++) {
+    const Layout* layout = layouts[slot];
+    uint32_t layoutInfo[4] = { layout->_flags, layout->_alignment, layout->_nameLength, layout->_membersCount };
 
-  Zone zone(32768 - Zone::kZoneOverhead);
-  ZoneHeap heap(&zone);
-  StringBuilderTmp<512> sbTmp;
+    MPSL_PROPAGATE(mpProgramKeyAppend(sb, layoutInfo, sizeof(layoutInfo)));
+    MPSL_PROPAGATE(mpProgramKeyAppend(sb, layout->_name, layout->_nameLength));
 
-  AstBuilder ast(&heap);
-  IRBuilder ir(&heap, numArgs);
+    const Layout::Member* m = layout->_members;
+    for (uint32_t i = 0, count = layout->_membersCount; i < count; i++) {
+      uint32_t memberInfo[4] = { m[i].nameLength, m[i].typeInfo, static_cast<uint32_t>(m[i].offset), m[i].count };
 
-  MPSL_PROPAGATE(ast.addProgramScope());
-  MPSL_PROPAGATE(ast.addBuiltInTypes(mpTypeInfo, kTypeCount));
-  MPSL_PROPAGATE(ast.addBuiltInConstants(mpConstInfo, MPSL_ARRAY_SIZE(mpConstInfo)));
-  MPSL_PROPAGATE(ast.addBuiltInIntrinsics());
+      MPSL_PROPAGATE(mpProgramKeyAppend(sb, memberInfo, sizeof(memberInfo)));
+      MPSL_PROPAGATE(mpProgramKeyAppend(sb, m[i].name, m[i].nameLength));
 
-  for (uint32_t slot = 0; slot < numArgs; slot++) {
-    MPSL_PROPAGATE_AND_HANDLE_COLLISION(ast.addBuiltInObject(slot, ca.layout[slot], &collidedSymbol));
+      // Values of bound members are part of the program.
+      if ((m[i].typeInfo & kTypeBind) && values != nullptr) {
+        const uint8_t* value = static_cast<const uint8_t*>(values[slot]) + m[i].offset;
+        MPSL_PROPAGATE(mpProgramKeyAppend(sb, value, TypeInfo::widthOf(m[i].typeInfo)));
+      }
+    }
   }
 
-  // Setup basic data structures used during parsing and compilation.
-  ErrorReporter errorReporter(body, len, options, log);
+  return kErrorOk;
+}
 
-  // --------------------------------------------------------------------------
-  // [AST]
-  // --------------------------------------------------------------------------
+//! \internal
+//!
+//! Get a hash of `layouts`, which is stored in serialized programs.
+static Error mpLayoutHash(uint32_t& hVal, uint32_t numArgs, const Layout* const* layouts) noexcept {
+  StringBuilderTmp<512> sb;
+  MPSL_PROPAGATE(mpLayoutKeyBuild(sb, numArgs, layouts, nullptr));
 
-  // Parse the source code into AST.
-  { MPSL_PROPAGATE(Parser(&ast, &errorReporter, body, len).parseProgram(ast.getProgramNode())); }
+  hVal = HashUtils::hashString(sb.getData(), sb.getLength());
+  return kErrorOk;
+}
 
-  // Perform a semantic analysis of the parsed AST.
-  //
-  // It can add some nodes required by implicit casts and fail if the code is
-  // semantically incorrect - for example invalid implicit cast, explicit-cast,
-  // or function call. This pass doesn't do constant folding or optimizations.
-  { MPSL_PROPAGATE(AstAnalysis(&ast, &errorReporter).onProgram(ast.getProgramNode())); }
+//! \internal
+//!
+//! Serialize everything that affects the generated code into `sb`, which is
+//! then used as a key of `ProgramCache`. Names are prefixed by their lengths
+//! so different inputs can't serialize into the same key.
+static Error mpProgramKeyBuild(StringBuilder& sb,
+  const Context::CompileArgs& ca, const char* body, size_t len, uint32_t options, uint32_t unrollLimit, uint32_t inlineLimit) noexcept {
 
-  if (options & kOptionDebugAst) {
-    ast.dump(sbTmp);
-    log->log(
-      OutputLog::Message(
-        OutputLog::kMessageDump, 0, 0,
-        StringRef(kDebugHeadingAST, MPSL_ARRAY_SIZE(kDebugHeadingAST) - 1),
-        StringRef(sbTmp.getData(), sbTmp.getLength())));
-    sbTmp.clear();
-  }
+  uint64_t header[5] = { options, ca.numArgs, len, unrollLimit, inlineLimit };
+  MPSL_PROPAGATE(mpProgramKeyAppend(sb, header, sizeof(header)));
+  MPSL_PROPAGATE(mpProgramKeyAppend(sb, body, len));
 
-  // Perform basic optimizations at AST level (dead code removal and constant
-  // folding). This pass shouldn't do any unsafe optimizations and it's a bit
-  // limited, but it's faster to do them now than doing these optimizations at
-  // IR level.
-  { MPSL_PROPAGATE(AstOptimizer(&ast, &errorReporter).onProgram(ast.getProgramNode())); }
+  return mpLayoutKeyBuild(sb, ca.numArgs, ca.layout, ca.values);
+}
 
-  if (options & kOptionDebugAst) {
-    ast.dump(sbTmp);
-    log->log(
-      OutputLog::Message(
-        OutputLog::kMessageDump, 0, 0,
-        StringRef(kDebugHeadingAST, MPSL_ARRAY_SIZE(kDebugHeadingAST) - 1),
-        StringRef(sbTmp.getData(), sbTmp.getLength())));
-    sbTmp.clear();
-  }
+// ============================================================================
+// [mpsl::Context - Arenas]
+// ============================================================================
 
-  // --------------------------------------------------------------------------
-  // [IR]
-  // --------------------------------------------------------------------------
+Error Context::trimArenas() noexcept {
+  if (!isValid())
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
 
-  // Translate AST to IR.
-  {
-    CodeGen::Result unused(false);
-    MPSL_PROPAGATE(CodeGen(&ast, &ir).onProgram(ast.getProgramNode(), unused));
+  static_cast<ArenaPool*>(_d->_arenaPool)->trim();
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::Context - Memory]
+// ============================================================================
+
+Error Context::getMemoryStats(MemoryStats& out) const noexcept {
+  RuntimeData* rt = static_cast<RuntimeData*>(_d->_runtimeData);
+  if (rt == nullptr) {
+    ::memset(&out, 0, sizeof(MemoryStats));
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
   }
 
-  if (options & kOptionDebugIR) {
+  AutoSpinLock guard(rt->_runtimeLock);
+  asmjit::VMemMgr* memMgr = rt->_runtime.getMemMgr();
+
+  out.committedBytes = memMgr->getAllocatedBytes();
+  out.usedBytes = memMgr->getUsedBytes();
+  out.constPoolBytes = rt->_constPoolBytes;
+  out.limit = rt->_codeLimit;
+  out.programCount = rt->_programCount;
+  return kErrorOk;
+}
+
+Error Context::setCodeLimit(size_t limit) noexcept {
+  if (!isValid())
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  RuntimeData* rt = static_cast<RuntimeData*>(_d->_runtimeData);
+  AutoSpinLock guard(rt->_runtimeLock);
+
+  rt->_codeLimit = limit;
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::Context - Optimization]
+// ============================================================================
+
+Error Context::setUnrollLimit(uint32_t limit) noexcept {
+  if (!isValid())
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  _d->_unrollLimit = limit;
+  return kErrorOk;
+}
+
+Error Context::setInlineLimit(uint32_t limit) noexcept {
+  if (!isValid())
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  _d->_inlineLimit = limit;
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::Context - Profile]
+// ============================================================================
+
+// Get a monotonic time in nanoseconds.
+static uint64_t mpGetTime() noexcept {
+#if defined(_WIN32)
+  LARGE_INTEGER freq, now;
+  ::QueryPerformanceFrequency(&freq);
+  ::QueryPerformanceCounter(&now);
+
+  uint64_t f = static_cast<uint64_t>(freq.QuadPart);
+  uint64_t t = static_cast<uint64_t>(now.QuadPart);
+  return (t / f) * 1000000000 + ((t % f) * 1000000000) / f;
+#else
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+// Get the number of bytes allocated by `zone`, blocks before the current one
+// are counted whole.
+static uint64_t mpZoneUsed(const Zone& zone) noexcept {
+  const Zone::Block* block = zone._block;
+  uint64_t used = static_cast<uint64_t>(zone._ptr - block->data);
+
+  while ((block = block->prev) != nullptr)
+    used += block->size;
+  return used;
+}
+
+// Add the number of instructions and blocks of `ir` to `insts` and `blocks`.
+static void mpCountIR(const IRBuilder* ir, uint32_t& insts, uint32_t& blocks) noexcept {
+  const IRBlocks& irBlocks = ir->getBlocks();
+  size_t count = irBlocks.getLength();
+
+  for (size_t i = 0; i < count; i++)
+    insts += static_cast<uint32_t>(irBlocks[i]->getBody().getLength());
+  blocks += static_cast<uint32_t>(count);
+}
+
+//! \internal
+//!
+//! Statistics of the backend collected by `mpCompileVariant()`.
+struct VariantProfile {
+  uint64_t emitTime;
+  uint64_t finalizeTime;
+  uint32_t constPoolSize;
+};
+
+//! \internal
+//!
+//! Measures stages of `Context::_compile()` and sends their statistics to the
+//! log, does nothing if `kOptionProfile` is not used.
+struct CompileProfiler {
+  MPSL_INLINE CompileProfiler(OutputLog* log, const Zone* zone, const AstBuilder* ast, const IRBuilder* ir, uint32_t variant) noexcept
+    : _log(log),
+      _zone(zone),
+      _ast(ast),
+      _ir(ir),
+      _variant(variant),
+      _startTime(0),
+      _stageTime(0) {
+    if (_log)
+      _startTime = _stageTime = mpGetTime();
+  }
+
+  MPSL_INLINE bool isEnabled() const noexcept { return _log != nullptr; }
+
+  //! Send `stage`, which ran since the previous stage ended.
+  MPSL_INLINE void end(uint32_t stage) noexcept {
+    if (!_log)
+      return;
+
+    send(stage, mpGetTime() - _stageTime, _variant, 0, 0);
+    _stageTime = mpGetTime();
+  }
+
+  //! Send `kProfileTotal`.
+  MPSL_INLINE void endTotal(uint32_t codeSize, uint32_t constPoolSize) noexcept {
+    if (!_log)
+      return;
+
+    send(OutputLog::kProfileTotal, mpGetTime() - _startTime, _variant, codeSize, constPoolSize);
+  }
+
+  //! Send the backend stages of `variant`.
+  MPSL_INLINE void sendVariant(uint32_t variant, const VariantProfile& vp, uint32_t codeSize) noexcept {
+    if (!_log)
+      return;
+
+    send(OutputLog::kProfileX86, vp.emitTime, variant, 0, vp.constPoolSize);
+    send(OutputLog::kProfileFinalize, vp.finalizeTime, variant, codeSize, vp.constPoolSize);
+    _stageTime = mpGetTime();
+  }
+
+  void send(uint32_t stage, uint64_t time, uint32_t variant, uint32_t codeSize, uint32_t constPoolSize) noexcept;
+
+  OutputLog* _log;
+  const Zone* _zone;
+  const AstBuilder* _ast;
+  const IRBuilder* _ir;
+
+  uint32_t _variant;
+  uint64_t _startTime;
+  uint64_t _stageTime;
+};
+
+void CompileProfiler::send(uint32_t stage, uint64_t time, uint32_t variant, uint32_t codeSize, uint32_t constPoolSize) noexcept {
+  static const char kStageNames[] =
+    "Parse\0"
+    "Analysis\0"
+    "AstOptimizer\0"
+    "CodeGen\0"
+    "IRPass\0"
+    "X86\0"
+    "Finalize\0"
+    "Total\0";
+
+  OutputLog::Profile profile;
+  profile.stage = stage;
+  profile.variant = variant;
+  profile.time = time;
+  profile.zoneUsed = mpZoneUsed(*_zone);
+  profile.astNodeCount = _ast->getNodeCount();
+  profile.irInstCount = 0;
+  profile.irBlockCount = 0;
+  profile.codeSize = codeSize;
+  profile.constPoolSize = constPoolSize;
+
+  mpCountIR(_ir, profile.irInstCount, profile.irBlockCount);
+  const IRFuncs& funcs = _ir->getFuncs();
+  for (size_t i = 0; i < funcs.getLength(); i++)
+    mpCountIR(funcs[i]->getBody(), profile.irInstCount, profile.irBlockCount);
+
+  const char* name = kStageNames;
+  for (uint32_t i = 0; i < stage; i++)
+    name += ::strlen(name) + 1;
+
+  StringBuilderTmp<256> sb;
+  sb.setFormat("time=%.3fms zone=%llu ast=%u ir=%u/%u code=%u pool=%u",
+    static_cast<double>(time) / 1e6,
+    static_cast<unsigned long long>(profile.zoneUsed),
+    profile.astNodeCount,
+    profile.irInstCount,
+    profile.irBlockCount,
+    profile.codeSize,
+    profile.constPoolSize);
+
+  _log->log(
+    OutputLog::Message(
+      OutputLog::kMessageProfile, 0, 0,
+      StringRef(name, ::strlen(name)),
+      StringRef(sb.getData(), sb.getLength()),
+      &profile));
+}
+
+// ============================================================================
+// [mpsl::Context - Profiling]
+// ============================================================================
+
+uint32_t Context::getJitSymbols() const noexcept {
+  const RuntimeData* rt = static_cast<const RuntimeData*>(_d->_runtimeData);
+  return rt != nullptr ? rt->_jitSymbols : uint32_t(kJitSymbolsNone);
+}
+
+Error Context::setJitSymbols(uint32_t flags) noexcept {
+  if (!isValid())
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  if ((flags & ~mpJitSymbolsSupported()) != 0)
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  static_cast<RuntimeData*>(_d->_runtimeData)->_jitSymbols = flags;
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::Context - Compile]
+// ============================================================================
+
+// Get the number of records prefetched ahead by a batch, see `kOptionPrefetchMask`.
+static MPSL_INLINE uint32_t mpPrefetchDistance(uint32_t options) noexcept {
+  static const uint8_t distanceTable[4] = { 0, 4, 16, 64 };
+  return distanceTable[(options & kOptionPrefetchMask) >> 22];
+}
+
+// Get CPU features supported by the host.
+static uint32_t mpHostFeatures() noexcept {
+  const asmjit::CpuInfo& cpu = asmjit::CpuInfo::getHost();
+  uint32_t features = 0;
+
+  if (cpu.hasFeature(asmjit::CpuInfo::kX86FeatureSSE4_1)) features |= kCpuFeatureSSE4_1;
+  if (cpu.hasFeature(asmjit::CpuInfo::kX86FeatureAVX   )) features |= kCpuFeatureAVX;
+  if (cpu.hasFeature(asmjit::CpuInfo::kX86FeatureAVX2  )) features |= kCpuFeatureAVX2;
+  if (cpu.hasFeature(asmjit::CpuInfo::kX86FeatureFMA   )) features |= kCpuFeatureFMA;
+  if (cpu.hasFeature(asmjit::CpuInfo::kX86FeatureF16C  )) features |= kCpuFeatureF16C;
+
+  return features;
+}
+
+// Options that restrict the backend to instruction sets of `variant`.
+static uint32_t mpVariantOptions(uint32_t variant) noexcept {
+  switch (variant) {
+    case kVariantSSE2:
+      return kOptionDisableSSE3   | kOptionDisableSSSE3  |
+             kOptionDisableSSE4_1 | kOptionDisableSSE4_2 |
+             kOptionDisableAVX    | kOptionDisableAVX2   ;
+
+    case kVariantSSE4_1:
+      return kOptionDisableAVX | kOptionDisableAVX2;
+
+    default:
+      return 0;
+  }
+}
+
+// Get the best variant supported by `cpuVariant` and not excluded by `options`.
+static uint32_t mpMaxVariant(uint32_t cpuVariant, uint32_t options) noexcept {
+  uint32_t variant = cpuVariant;
+
+  if (variant == kVariantAVX2 && (!mpIsAVXAllowed(options) || (options & kOptionDisableAVX2)))
+    variant = kVariantSSE4_1;
+
+  if (variant == kVariantSSE4_1 && (options & kOptionDisableSSE4_1))
+    variant = kVariantSSE2;
+
+  return variant;
+}
+
+// Release entry-points of all variants in `variantMain`.
+static void mpReleaseVariants(RuntimeData* rt, void** variantMain, const uint32_t* variantConstPool) noexcept {
+  for (uint32_t v = 0; v < kVariantCount; v++) {
+    if (variantMain[v] != nullptr)
+      rt->release(variantMain[v], variantConstPool[v]);
+    variantMain[v] = nullptr;
+  }
+}
+
+// Compile `ir` and functions it calls out-of-line by backends of `target`
+// restricted by `options`. See `mpCompileVariant()`.
+static Error mpCompileTarget(IRTarget* target, IRBuilder* ir, uint32_t options,
+  ProgramCounters* counters, IRBackend** mainOut, IRBackend** batchOut, size_t* constPoolOut) noexcept {
+
+  // The IR may have been compiled by a previous variant.
+  IRFuncs& funcs = ir->getFuncs();
+  ir->resetJitState();
+
+  for (size_t i = 0; i < funcs.getLength(); i++) {
+    funcs[i]->setJitData(nullptr);
+    funcs[i]->getBody()->resetJitState();
+  }
+
+  ProgramCounterSlot* counterSlots = counters ? counters->getSlots() : nullptr;
+  bool countCycles = (options & kOptionCountCycles) != 0;
+  size_t constPoolSize = 0;
+
+  IRBackend* backend;
+  MPSL_PROPAGATE(target->newBackend(&backend, options));
+  backend->_counters = counterSlots;
+  backend->_countCycles = countCycles;
+  MPSL_PROPAGATE(backend->compileIRAsFunc(ir));
+  constPoolSize += backend->getConstPoolSize();
+  *mainOut = backend;
+
+  // The batch entry-point is compiled from the same IR.
+  ir->resetJitState();
+
+  MPSL_PROPAGATE(target->newBackend(&backend, options));
+  backend->_counters = counterSlots;
+  backend->_countCycles = countCycles;
+  backend->_streamStores = (options & kOptionStreamStores) != 0;
+  backend->_prefetchDistance = mpPrefetchDistance(options);
+  MPSL_PROPAGATE(backend->compileIRAsBatch(ir));
+  constPoolSize += backend->getConstPoolSize();
+  *batchOut = backend;
+
+  // Functions called out-of-line are shared by both entry points, functions
+  // that are not called anymore (their calls were removed) are skipped.
+  for (size_t i = 0; i < funcs.getLength(); i++) {
+    if (funcs[i]->getJitData() == nullptr)
+      continue;
+
+    MPSL_PROPAGATE(target->newBackend(&backend, options));
+    MPSL_PROPAGATE(backend->compileIRAsCallee(funcs[i]));
+    constPoolSize += backend->getConstPoolSize();
+  }
+
+  *constPoolOut = constPoolSize;
+  return target->finalize();
+}
+
+// Compile `ir` and functions it calls out-of-line into a single code buffer
+// restricted by `options`. The batch entry-point shares the buffer with
+// `main()`, so it's released together with it. Statistics of the backend are
+// stored to `profile` if not null. Entry points update `counters` if not null.
+//
+// Constants used by most programs are not duplicated in the code, see
+// `mpGetSharedConsts()`. All functions load their address from a single slot
+// embedded at the end of the code, its offset is stored to `constSlotOut`.
+// The size of constants the code embeds is stored to `constPoolOut`.
+//
+// This is the only function that generates native code, it's independent of
+// the target, see `IRTarget`. A target without a backend fails here after the
+// program has been checked and lowered to IR.
+static Error mpCompileVariant(RuntimeData* rt, ZoneHeap* heap, IRBuilder* ir,
+  uint32_t options, ProgramCounters* counters, asmjit::StringLogger* asmlog, VariantProfile* profile,
+  void** mainOut, void** batchOut, uint32_t* sizeOut, uint32_t* featuresOut, uint32_t* constSlotOut, uint32_t* constPoolOut) noexcept {
+
+  uint64_t startTime = profile ? mpGetTime() : uint64_t(0);
+
+  IRTarget* target;
+  MPSL_PROPAGATE(IRTarget::newTarget(&target, heap, rt->_runtime.getCodeInfo(), asmlog));
+
+  IRBackend* mainBackend = nullptr;
+  IRBackend* batchBackend = nullptr;
+  size_t constPoolSize = 0;
+
+  MPSL_PROPAGATE_(mpCompileTarget(target, ir, options, counters, &mainBackend, &batchBackend, &constPoolSize),
+    { IRTarget::deleteTarget(target); });
+
+  uint64_t finalizeTime = profile ? mpGetTime() : uint64_t(0);
+
+  void* func;
+  MPSL_PROPAGATE_(rt->add(&func, &target->_code, constPoolSize),
+    { IRTarget::deleteTarget(target); });
+
+  if (profile) {
+    profile->emitTime = finalizeTime - startTime;
+    profile->finalizeTime = mpGetTime() - finalizeTime;
+    profile->constPoolSize = static_cast<uint32_t>(constPoolSize);
+  }
+
+  *mainOut = func;
+  *batchOut = static_cast<uint8_t*>(func) + target->getEntryOffset(batchBackend);
+  *sizeOut = static_cast<uint32_t>(target->_code.getCodeSize());
+  *featuresOut = mainBackend->getFeatures();
+  *constSlotOut = target->getConstSlot();
+  *constPoolOut = static_cast<uint32_t>(constPoolSize);
+
+  IRTarget::deleteTarget(target);
+  return kErrorOk;
+}
+
+// Add the register pressure of `ir` to `pressure` (maximum) and the number of
+// registers it's expected to spill to `spills`. The stack pointer and one
+// register reserved by the compiler are never allocable. The backend doesn't
+// report spills, so this is computed from live ranges of the IR.
+static void mpMeasureSpills(const IRBuilder* ir, uint32_t& pressure, uint32_t& spills) noexcept {
+  uint32_t numGp = kPointerWidth == 8 ? 14 : 6;
+  uint32_t numVec = kPointerWidth == 8 ? 16 : 8;
+
+  uint32_t maxGp = ir->getMaxLive(IRReg::kKindGp);
+  uint32_t maxVec = ir->getMaxLive(IRReg::kKindVec);
+
+  if (maxVec > pressure) pressure = maxVec;
+  if (maxGp > numGp) spills += maxGp - numGp;
+  if (maxVec > numVec) spills += maxVec - numVec;
+}
+
+#define MPSL_PROPAGATE_AND_HANDLE_COLLISION(...)                              \
+  do {                                                                        \
+    AstSymbol* collidedSymbol = nullptr;                                      \
+    Error _errorValue = __VA_ARGS__;                                          \
+                                                                              \
+    if (MPSL_UNLIKELY(_errorValue)) {                                         \
+      if (_errorValue == kErrorSymbolCollision && log) {                      \
+        sbTmp.setFormat("Built-in symbol collision: '%s' already defined",    \
+          collidedSymbol->getName());                                         \
+        log->log(OutputLog::Message(                                          \
+          OutputLog::kMessageError, 0, 0,                                     \
+          StringRef("ERROR", 5),                                              \
+          StringRef(sbTmp.getData(), sbTmp.getLength())));                    \
+      }                                                                       \
+      return _errorValue;                                                     \
+    }                                                                         \
+  } while (0)
+
+Error Context::_compile(Program& program, const CompileArgs& ca, OutputLog* log) noexcept {
+  const char* body = ca.body.getData();
+  size_t len = ca.body.getLength();
+
+  uint32_t options = ca.options;
+  uint32_t numArgs = ca.numArgs;
+
+  if (numArgs == 0 || numArgs > Globals::kMaxArgumentsCount)
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  const Pipeline* pipeline = ca.pipeline;
+  if (pipeline != nullptr)
+    MPSL_PROPAGATE(mpPipelineValidate(*pipeline));
+
+  // Layouts that have bound members require values to bind them to.
+  bool hasBoundMembers = false;
+  for (uint32_t slot = 0; slot < numArgs; slot++) {
+    const Layout* layout = ca.layout[slot];
+    const Layout::Member* m = layout->getMembersArray();
+
+    for (uint32_t i = 0, count = layout->getMembersCount(); i < count; i++) {
+      if ((m[i].typeInfo & kTypeBind) == 0)
+        continue;
+
+      if (ca.values[slot] == nullptr)
+        return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+      hasBoundMembers = true;
+      break;
+    }
+  }
+
+  // --------------------------------------------------------------------------
+  // [Debug Strings]
+  // --------------------------------------------------------------------------
+
+  static const char kDebugHeadingAST[] = "AST";
+  static const char kDebugHeadingIR[]  = "IR";
+  static const char kDebugHeadingASM[] = "ASM";
+
+  // --------------------------------------------------------------------------
+  // [Init]
+  // --------------------------------------------------------------------------
+
+  // Init options first.
+  options &= _kOptionsMask;
+
+  if (log)
+    options |= kInternalOptionLog;
+  else
+    options &= ~(kOptionVerbose | kOptionDebugAst | kOptionDebugIR | kOptionDebugASM | kOptionProfile);
+
+  if (len == Globals::kInvalidIndex)
+    len = ::strlen(body);
+
+  // --------------------------------------------------------------------------
+  // [Program Cache]
+  // --------------------------------------------------------------------------
+
+  // Debug and profile options are only kept if there is a log, and in that case
+  // the whole compiler has to run to produce the output, so such programs are
+  // not cached.
+  ProgramCache* cache = static_cast<ProgramCache*>(_d->_programCache);
+  StringBuilderTmp<512> cacheKey;
+  uint32_t cacheHVal = 0;
+
+  if (options & (kOptionDisableCache | kOptionVerbose | kOptionDebugAst | kOptionDebugIR | kOptionDebugASM | kOptionProfile))
+    cache = nullptr;
+
+  // The key of a pipeline would have to contain all of its stages and links.
+  if (pipeline != nullptr)
+    cache = nullptr;
+
+  if (cache != nullptr) {
+    MPSL_PROPAGATE(mpProgramKeyBuild(cacheKey, ca, body, len, options & ~kInternalOptionLog, _d->_unrollLimit, _d->_inlineLimit));
+    cacheHVal = HashUtils::hashString(cacheKey.getData(), cacheKey.getLength());
+
+    Program::Impl* cached = cache->get(cacheKey.getData(), cacheKey.getLength(), cacheHVal);
+    if (cached != nullptr) {
+      mpObjectRelease(
+        mpAtomicSetXchgT<Program::Impl*>(
+          &program._d, cached));
+      return kErrorOk;
+    }
+  }
+
+  // Zones are reused by all compilations of the context, see `ArenaPool`.
+  ArenaScope arena(static_cast<ArenaPool*>(_d->_arenaPool));
+  if (!arena.isValid())
+    return MPSL_TRACE_ERROR(kErrorNoMemory);
+
+  Zone& zone = arena.getZone();
+  ZoneHeap heap(&zone);
+  StringBuilderTmp<512> sbTmp;
+
+  AstBuilder ast(&heap);
+  IRBuilder ir(&heap, numArgs);
+
+  // The backend rewrites the IR by its peephole stage, memory operands folded
+  // for a lower variant are valid for higher variants as well (but not the
+  // other way around), so variants are compiled from the lowest one.
+  uint32_t variant = mpMaxVariant(_d->_cpuVariant, options);
+  uint32_t firstVariant = (options & kOptionMultiVersion) ? uint32_t(kVariantSSE2) : variant;
+
+  // Setting up built-in symbols is measured as a part of `kProfileParse`.
+  CompileProfiler profiler((options & kOptionProfile) ? log : nullptr, &zone, &ast, &ir, variant);
+
+  // Frozen contexts provide built-ins as a shared parent of the global scope.
+  AstBuiltIns* builtIns = static_cast<AstBuiltIns*>(_d->_builtIns);
+  if (builtIns != nullptr) {
+    MPSL_PROPAGATE(ast.addProgramScope(builtIns->getScope()));
+  }
+  else {
+    MPSL_PROPAGATE(ast.addProgramScope());
+    MPSL_PROPAGATE(ast.addBuiltInTypes(mpTypeInfo, kTypeCount));
+    MPSL_PROPAGATE(ast.addBuiltInConstants(mpConstInfo, MPSL_ARRAY_SIZE(mpConstInfo)));
+    MPSL_PROPAGATE(ast.addBuiltInIntrinsics());
+  }
+
+  uint32_t laneSlots = 0;
+  for (uint32_t slot = 0; slot < numArgs; slot++) {
+    MPSL_PROPAGATE_AND_HANDLE_COLLISION(ast.addBuiltInObject(slot, ca.layout[slot], ca.values[slot], &collidedSymbol));
+    if (ca.layout[slot]->isSoA())
+      laneSlots |= 1U << slot;
+    ir.setDataAlignment(slot, ca.layout[slot]->getAlignment());
+  }
+
+  // Programs that use at least one SoA layout process more elements at once.
+  if (laneSlots != 0)
+    MPSL_PROPAGATE(ir.initLanes(Globals::kLaneCount, laneSlots));
+
+  // Stages of a pipeline are parsed from a single source, so positions of all
+  // stages are unique and errors report lines of the concatenated source.
+  size_t stageEnd[Globals::kMaxPipelineStages];
+  if (pipeline != nullptr) {
+    MPSL_PROPAGATE(mpPipelineConcat(&heap, *pipeline, body, len, stageEnd));
+    for (uint32_t i = 0; i < pipeline->getLinksCount(); i++)
+      MPSL_PROPAGATE_AND_HANDLE_COLLISION(ast.addPipelineLink(pipeline->getLink(i), &collidedSymbol));
+  }
+
+  // Setup basic data structures used during parsing and compilation.
+  ErrorReporter errorReporter(body, len, options, log);
+
+  // --------------------------------------------------------------------------
+  // [AST]
+  // --------------------------------------------------------------------------
+
+  // Parse the source code into AST.
+  if (pipeline == nullptr) {
+    MPSL_PROPAGATE(Parser(&ast, &errorReporter, body, len).parseProgram(ast.getProgramNode()));
+  }
+  else {
+    // Each stage has its own scope, so stages can use the same names (each
+    // has its own `main()`), and the fused `main()` calls them in order.
+    AstScope* stageScopes[Globals::kMaxPipelineStages];
+    size_t start = 0;
+
+    for (uint32_t i = 0; i < pipeline->getStagesCount(); i++) {
+      stageScopes[i] = ast.newScope(ast.getGlobalScope(), AstScope::kTypeGlobal);
+      MPSL_NULLCHECK(stageScopes[i]);
+
+      MPSL_PROPAGATE(Parser(&ast, &errorReporter, body, start, stageEnd[i], stageScopes[i]).parseProgram(ast.getProgramNode()));
+      start = stageEnd[i] + 1;
+    }
+
+    MPSL_PROPAGATE(ast.addPipelineMain(*pipeline, stageScopes));
+  }
+  profiler.end(OutputLog::kProfileParse);
+
+  // Perform a semantic analysis of the parsed AST.
+  //
+  // It can add some nodes required by implicit casts and fail if the code is
+  // semantically incorrect - for example invalid implicit cast, explicit-cast,
+  // or function call. This pass doesn't do constant folding or optimizations.
+  { MPSL_PROPAGATE(AstAnalysis(&ast, &errorReporter).onProgram(ast.getProgramNode())); }
+  profiler.end(OutputLog::kProfileAnalysis);
+
+  if (options & kOptionDebugAst) {
+    ast.dump(sbTmp);
+    log->log(
+      OutputLog::Message(
+        OutputLog::kMessageDump, 0, 0,
+        StringRef(kDebugHeadingAST, MPSL_ARRAY_SIZE(kDebugHeadingAST) - 1),
+        StringRef(sbTmp.getData(), sbTmp.getLength())));
+    sbTmp.clear();
+  }
+
+  // Perform basic optimizations at AST level (dead code removal and constant
+  // folding). This pass shouldn't do any unsafe optimizations and it's a bit
+  // limited, but it's faster to do them now than doing these optimizations at
+  // IR level. Constants are folded in the floating-point environment of the
+  // program.
+  {
+    FpEnvScope fpEnv(options);
+    MPSL_PROPAGATE(AstOptimizer(&ast, &errorReporter).onProgram(ast.getProgramNode()));
+  }
+  profiler.end(OutputLog::kProfileAstOptimizer);
+
+  if (options & kOptionDebugAst) {
+    ast.dump(sbTmp);
+    log->log(
+      OutputLog::Message(
+        OutputLog::kMessageDump, 0, 0,
+        StringRef(kDebugHeadingAST, MPSL_ARRAY_SIZE(kDebugHeadingAST) - 1),
+        StringRef(sbTmp.getData(), sbTmp.getLength())));
+    sbTmp.clear();
+  }
+
+  // --------------------------------------------------------------------------
+  // [IR]
+  // --------------------------------------------------------------------------
+
+  // Translate AST to IR.
+  {
+    CodeGen codeGen(&ast, &ir);
+    CodeGen::Result unused(false);
+
+    // 256-bit vectors are only kept in a single register if AVX is used by the
+    // backend, otherwise they are split into two 128-bit halves. All variants
+    // of a multi-versioned program are compiled from the same IR.
+    const asmjit::CpuInfo& cpu = asmjit::CpuInfo::getHost();
+    codeGen._hasV256 = mpIsAVXAllowed(options) && cpu.hasFeature(asmjit::CpuInfo::kX86FeatureAVX) &&
+                       (options & kOptionMultiVersion) == 0;
+    codeGen._inlineLimit = _d->_inlineLimit;
+
+    MPSL_PROPAGATE(codeGen.onProgram(ast.getProgramNode(), unused));
+  }
+  profiler.end(OutputLog::kProfileCodeGen);
+
+  if (options & kOptionDebugIR) {
     ir.dump(sbTmp);
     log->log(
       OutputLog::Message(
@@ -459,7 +1543,42 @@ Error Context::_compile(Program& program, const CompileArgs& ca, OutputLog* log)
     sbTmp.clear();
   }
 
-  MPSL_PROPAGATE(mpIRPass(&ir));
+  // Transcendental functions are expanded before the IR passes optimize them.
+  MPSL_PROPAGATE(mpIRLower(&ir));
+
+  // Fast-math passes change results, only run them if requested. FMA is only
+  // formed if the backend would use it, a separate multiply and add would make
+  // contraction a pessimization.
+  uint32_t irFlags = 0;
+  if (options & kOptionFastMath) {
+    const asmjit::CpuInfo& cpu = asmjit::CpuInfo::getHost();
+    irFlags |= kIRPassFastMath;
+    if (mpIsAVXAllowed(options) &&
+        cpu.hasFeature(asmjit::CpuInfo::kX86FeatureAVX) &&
+        cpu.hasFeature(asmjit::CpuInfo::kX86FeatureFMA))
+      irFlags |= kIRPassFMA;
+  }
+
+  // Functions called out-of-line have their own IR.
+  IRFuncs& funcs = ir.getFuncs();
+  {
+    FpEnvScope fpEnv(options);
+    MPSL_PROPAGATE(mpIRPass(&ir, mpIROptLevelFromOptions(options), _d->_unrollLimit, irFlags));
+
+    for (size_t i = 0; i < funcs.getLength(); i++) {
+      IRBuilder* body = funcs[i]->getBody();
+      MPSL_PROPAGATE(mpIRLower(body));
+      MPSL_PROPAGATE(mpIRPass(body, mpIROptLevelFromOptions(options), _d->_unrollLimit, irFlags));
+    }
+  }
+  profiler.end(OutputLog::kProfileIRPass);
+
+  uint32_t regPressure = 0;
+  uint32_t spillCount = 0;
+
+  mpMeasureSpills(&ir, regPressure, spillCount);
+  for (size_t i = 0; i < funcs.getLength(); i++)
+    mpMeasureSpills(funcs[i]->getBody(), regPressure, spillCount);
 
   if (options & kOptionDebugIR) {
     ir.dump(sbTmp);
@@ -477,29 +1596,45 @@ Error Context::_compile(Program& program, const CompileArgs& ca, OutputLog* log)
 
   // Compile and store the reference to the `main()` function.
   RuntimeData* rt = static_cast<RuntimeData*>(_d->_runtimeData);
-  Program::Impl* programD = program._d;
 
-  void* func = nullptr;
-  {
-    asmjit::StringLogger asmlog;
-    asmjit::CodeHolder code;
-
-    code.init(rt->_runtime.getCodeInfo());
-    asmjit::X86Compiler c(&code);
-
-    if (options & kOptionDebugASM)
-      code.setLogger(&asmlog);
+  void* variantMain[kVariantCount] = { nullptr };
+  void* variantBatch[kVariantCount] = { nullptr };
+  uint32_t variantSize[kVariantCount] = { 0 };
+  uint32_t variantFeatures[kVariantCount] = { 0 };
+  uint32_t variantConstSlot[kVariantCount] = { 0 };
+  uint32_t variantConstPool[kVariantCount] = { 0 };
+  VariantProfile variantProfile[kVariantCount] = {};
+
+  uint32_t layoutHash;
+  MPSL_PROPAGATE(mpLayoutHash(layoutHash, numArgs, ca.layout));
+
+  // Counters are referenced by the code of all variants, so they're allocated
+  // before it's compiled.
+  ProgramCounters* counters = nullptr;
+  if (options & (kOptionCountRuns | kOptionCountCycles)) {
+    counters = static_cast<ProgramCounters*>(::calloc(1, sizeof(ProgramCounters)));
+    if (counters == nullptr)
+      return MPSL_TRACE_ERROR(kErrorNoMemory);
+  }
 
-    IRToX86 compiler(&heap, &c);
-    if (options & kOptionDisableSSE4_1)
-      compiler._enableSSE4_1 = false;
-    MPSL_PROPAGATE(compiler.compileIRAsFunc(&ir));
+  for (uint32_t v = firstVariant; v <= variant; v++) {
+    uint32_t variantOptions = options;
+    if (options & kOptionMultiVersion)
+      variantOptions |= mpVariantOptions(v);
 
-    asmjit::Error err = c.finalize();
-    if (err) return MPSL_TRACE_ERROR(kErrorJITFailed);
+    asmjit::StringLogger asmlog;
+    Error err = mpCompileVariant(rt, &heap, &ir, variantOptions, counters,
+      (options & kOptionDebugASM) ? &asmlog : nullptr,
+      profiler.isEnabled() ? &variantProfile[v] : nullptr,
+      &variantMain[v], &variantBatch[v], &variantSize[v], &variantFeatures[v], &variantConstSlot[v], &variantConstPool[v]);
+
+    if (err != kErrorOk) {
+      mpReleaseVariants(rt, variantMain, variantConstPool);
+      ::free(counters);
+      return err;
+    }
 
-    err = rt->_runtime.add(&func, &code);
-    if (err) return MPSL_TRACE_ERROR(kErrorJITFailed);
+    profiler.sendVariant(v, variantProfile[v], variantSize[v]);
 
     if (options & kOptionDebugASM)
       log->log(
@@ -509,26 +1644,322 @@ Error Context::_compile(Program& program, const CompileArgs& ca, OutputLog* log)
           StringRef(asmlog.getString(), asmlog.getLength())));
   }
 
-  if (programD->_refCount == 1 && static_cast<RuntimeData*>(programD->_runtimeData) == rt) {
-    rt->_runtime.release(programD->_main);
-    programD->_main = func;
+  // Programs with bound members keep everything required to compile them
+  // again with different values, see `Program::_respecialize()`. Pipelines
+  // would have to keep all stages, so they can't be respecialized.
+  ProgramSpec* spec = nullptr;
+  if (hasBoundMembers && pipeline == nullptr) {
+    spec = mpProgramSpecCreate(ca, body, len);
+    if (spec == nullptr) {
+      mpReleaseVariants(rt, variantMain, variantConstPool);
+      ::free(counters);
+      return MPSL_TRACE_ERROR(kErrorNoMemory);
+    }
   }
-  else {
-    programD = static_cast<Program::Impl*>(::malloc(sizeof(Program::Impl)));
-    if (programD == nullptr) {
-      rt->_runtime.release(func);
+
+  // Reductions are privatized per worker by `Program::runParallel()`.
+  ParallelReduce* reduce;
+  {
+    Error err = mpParallelReduceCreate(&reduce, numArgs, ca.layout);
+    if (err != kErrorOk) {
+      mpProgramSpecDestroy(spec);
+      mpReleaseVariants(rt, variantMain, variantConstPool);
+      ::free(counters);
+      return err;
+    }
+  }
+
+  // The program is never updated in place, other threads may still run it.
+  // It's replaced by a new one and its code is freed once they finish.
+  Program::Impl* programD = static_cast<Program::Impl*>(::malloc(sizeof(Program::Impl)));
+  if (programD == nullptr) {
+    mpParallelReduceDestroy(reduce);
+    mpProgramSpecDestroy(spec);
+    mpReleaseVariants(rt, variantMain, variantConstPool);
+    ::free(counters);
+    return MPSL_TRACE_ERROR(kErrorNoMemory);
+  }
+
+  programD->_refCount = 1;
+  programD->_runtimeData = mpObjectAddRef(rt);
+  rt->attachProgram();
+
+  programD->_main = variantMain[variant];
+  programD->_batch = reinterpret_cast<Program::Impl::BatchFunc>(variantBatch[variant]);
+  programD->_argsCount = numArgs;
+  programD->_programSize = variantSize[variant];
+  programD->_regPressure = regPressure;
+  programD->_spillCount = spillCount;
+  programD->_spec = spec;
+  programD->_reduce = reduce;
+  programD->_variant = variant;
+
+  for (uint32_t v = 0; v < kVariantCount; v++) {
+    programD->_variantMain[v] = variantMain[v];
+    programD->_variantBatch[v] = reinterpret_cast<Program::Impl::BatchFunc>(variantBatch[v]);
+    programD->_variantSize[v] = variantSize[v];
+    programD->_variantFeatures[v] = variantFeatures[v];
+    programD->_variantConstSlot[v] = variantConstSlot[v];
+    programD->_variantConstPool[v] = variantConstPool[v];
+  }
+
+  programD->_options = options & ~kInternalOptionLog;
+  programD->_layoutHash = layoutHash;
+  programD->_name = nullptr;
+  programD->_sourceHash = HashUtils::hashString(body, len);
+  programD->_counters = counters;
+  mpProgramAddSymbols(programD, rt->_jitSymbols);
+
+  profiler.endTotal(variantSize[variant], variantProfile[variant].constPoolSize);
+
+  mpObjectRelease(
+    mpAtomicSetXchgT<Program::Impl*>(
+      &program._d, programD));
+
+  // Failing to cache the program is not an error. If the same program has been
+  // cached concurrently the cached one is used so all copies share the code.
+  if (cache != nullptr) {
+    Program::Impl* existing;
+    if (cache->put(cacheKey.getData(), cacheKey.getLength(), cacheHVal, programD, &existing) == kErrorOk && existing != nullptr) {
+      mpObjectRelease(
+        mpAtomicSetXchgT<Program::Impl*>(
+          &program._d, existing));
+    }
+  }
+
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::CompileJob - Internal]
+// ============================================================================
+
+//! \internal
+//!
+//! Data of a job started by `Context::_compileAsync()`, referenced by all
+//! `CompileJob` handles and by the worker until it compiles the program.
+struct CompileJob::Impl {
+  MPSL_INLINE void destroy() noexcept {
+    mpProgramSpecDestroy(_spec);
+    this->~Impl();
+    ::free(this);
+  }
+
+  //! Reference count.
+  uintptr_t _refCount;
+  //! Non-zero after the worker stored `_error` and `_program`.
+  uintptr_t _isReady;
+  //! Result of `Context::_compile()`.
+  Error _error;
+
+  //! Copy of the source and layouts.
+  ProgramSpec* _spec;
+  //! Log passed to `Context::_compile()`.
+  OutputLog* _log;
+
+  //! Context the job compiles by, kept alive by the job.
+  Context _context;
+  //! Compiled program.
+  Program _program;
+};
+
+// Unlike other handles a job that has not been started has null data, as the
+// `Impl` has members that can't be shared by a constant like `mpProgramNull`.
+static MPSL_INLINE CompileJob::Impl* mpCompileJobAddRef(CompileJob::Impl* d) noexcept {
+  return d != nullptr ? mpObjectAddRef(d) : d;
+}
+
+static MPSL_INLINE void mpCompileJobRelease(CompileJob::Impl* d) noexcept {
+  if (d != nullptr)
+    mpObjectRelease(d);
+}
+
+static MPSL_INLINE void mpThreadYield() noexcept {
+#if defined(_WIN32)
+  ::SwitchToThread();
+#else
+  ::sched_yield();
+#endif
+}
+
+static void MPSL_CDECL mpCompileJobRun(void* data, uint32_t) {
+  CompileJob::Impl* d = static_cast<CompileJob::Impl*>(data);
+  ProgramSpec* spec = d->_spec;
+
+  Context::CompileArgs ca(spec->body, spec->bodyLength, spec->options, spec->numArgs);
+  for (uint32_t slot = 0; slot < spec->numArgs; slot++)
+    ca.layout[slot] = &spec->layout[slot];
+
+  d->_error = d->_context._compile(d->_program, ca, d->_log);
+
+  // Publish the result, `mpAtomicSetXchg()` is a full barrier.
+  mpAtomicSetXchg(&d->_isReady, 1);
+  mpObjectRelease(d);
+}
+
+// ============================================================================
+// [mpsl::Context - Compile Async]
+// ============================================================================
+
+Error Context::_compileAsync(CompileJob& job, const CompileArgs& ca, ThreadPool* pool, OutputLog* log) noexcept {
+  if (_d->_refCount == 0)
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  if (ca.numArgs == 0 || ca.numArgs > Globals::kMaxArgumentsCount)
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  const char* body = ca.body.getData();
+  size_t len = ca.body.getLength();
+
+  if (len == Globals::kInvalidIndex)
+    len = ::strlen(body);
+
+  CompileJob::Impl* d = static_cast<CompileJob::Impl*>(::malloc(sizeof(CompileJob::Impl)));
+  if (d == nullptr)
+    return MPSL_TRACE_ERROR(kErrorNoMemory);
+
+  ProgramSpec* spec = mpProgramSpecCreate(ca, body, len);
+  if (spec == nullptr) {
+    ::free(d);
+    return MPSL_TRACE_ERROR(kErrorNoMemory);
+  }
+
+  new(d) CompileJob::Impl();
+  // One reference is owned by `job`, the other by the worker.
+  d->_refCount = 2;
+  d->_isReady = 0;
+  d->_error = kErrorOk;
+  d->_spec = spec;
+  d->_log = log;
+  d->_context = *this;
+
+  mpCompileJobRelease(
+    mpAtomicSetXchgT<CompileJob::Impl*>(&job._d, d));
+
+  if (pool != nullptr)
+    pool->post(mpCompileJobRun, d);
+  else
+    mpCompileJobRun(d, 0);
+
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::Context - Load]
+// ============================================================================
+
+Error Context::_loadProgram(Program& program, const void* blob, size_t size, uint32_t numArgs, const Layout* const* layouts) noexcept {
+  if (!isValid())
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  if (blob == nullptr || numArgs == 0 || numArgs > Globals::kMaxArgumentsCount)
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  // The blob doesn't have to be aligned.
+  ProgramBlob header;
+  if (size < sizeof(ProgramBlob))
+    return MPSL_TRACE_ERROR(kErrorInvalidBlob);
+  ::memcpy(&header, blob, sizeof(ProgramBlob));
+
+  const uint8_t* code = static_cast<const uint8_t*>(blob) + sizeof(ProgramBlob);
+  uint32_t layoutHash;
+  MPSL_PROPAGATE(mpLayoutHash(layoutHash, numArgs, layouts));
+
+  // Reject everything that doesn't match exactly, the code would crash or
+  // compute garbage otherwise.
+  if (header.magic        != ProgramBlob::kMagic   ||
+      header.version      != ProgramBlob::kVersion ||
+      header.pointerWidth != kPointerWidth         ||
+      header.reserved     != 0                     ||
+      header.argsCount    != numArgs               ||
+      header.layoutHash   != layoutHash            ||
+      header.variant      >= kVariantCount         ||
+      header.codeSize     == 0                     ||
+      header.codeSize     != size - sizeof(ProgramBlob) ||
+      header.batchOffset  >= header.codeSize       ||
+      header.constSlot    >= header.codeSize       ||
+      header.codeSize - header.constSlot < uint32_t(kPointerWidth) ||
+      (header.features & ~mpHostFeatures()) != 0   ||
+      header.codeHash     != HashUtils::hashString(reinterpret_cast<const char*>(code), header.codeSize))
+    return MPSL_TRACE_ERROR(kErrorInvalidBlob);
+
+  // The code is position independent except the address of shared constants,
+  // it's embedded with the address of this process and the runtime copies it
+  // into executable memory.
+  ParallelReduce* reduce;
+  MPSL_PROPAGATE(mpParallelReduceCreate(&reduce, numArgs, layouts));
+
+  RuntimeData* rt = static_cast<RuntimeData*>(_d->_runtimeData);
+  void* func = nullptr;
+  {
+#if MPSL_BUILD_X86
+    asmjit::CodeHolder holder;
+    holder.init(rt->_runtime.getCodeInfo());
+
+    asmjit::X86Assembler a(&holder);
+    asmjit::Error err;
+
+    if (header.constSlot != 0) {
+      const void* sharedConsts = mpGetSharedConsts();
+      uint32_t tail = header.constSlot + kPointerWidth;
+
+      err = a.embed(code, header.constSlot);
+      if (!err) err = a.embed(&sharedConsts, kPointerWidth);
+      if (!err) err = a.embed(code + tail, header.codeSize - tail);
+    }
+    else {
+      err = a.embed(code, header.codeSize);
+    }
+
+    if (err != asmjit::kErrorOk) {
+      mpParallelReduceDestroy(reduce);
       return MPSL_TRACE_ERROR(kErrorNoMemory);
     }
 
-    programD->_refCount = 1;
-    programD->_runtimeData = mpObjectAddRef(rt);
-    programD->_main = func;
+    // The blob doesn't record the size of constants embedded in the code.
+    Error addErr = rt->add(&func, &holder, 0);
+    if (addErr != kErrorOk) {
+      mpParallelReduceDestroy(reduce);
+      return addErr;
+    }
+#else
+    mpParallelReduceDestroy(reduce);
+    return MPSL_TRACE_ERROR(kErrorUnsupportedTarget);
+#endif // MPSL_BUILD_X86
+  }
 
-    mpObjectRelease(
-      mpAtomicSetXchgT<Program::Impl*>(
-        &program._d, programD));
+  Program::Impl* programD = static_cast<Program::Impl*>(::malloc(sizeof(Program::Impl)));
+  if (programD == nullptr) {
+    mpParallelReduceDestroy(reduce);
+    rt->release(func, 0);
+    return MPSL_TRACE_ERROR(kErrorNoMemory);
   }
 
+  ::memset(programD, 0, sizeof(Program::Impl));
+  programD->_refCount = 1;
+  programD->_runtimeData = mpObjectAddRef(rt);
+  rt->attachProgram();
+  programD->_main = func;
+  programD->_batch = reinterpret_cast<Program::Impl::BatchFunc>(static_cast<uint8_t*>(func) + header.batchOffset);
+  programD->_argsCount = numArgs;
+  programD->_programSize = header.codeSize;
+  programD->_regPressure = header.regPressure;
+  programD->_spillCount = header.spillCount;
+  programD->_reduce = reduce;
+  programD->_variant = header.variant;
+  programD->_variantMain[header.variant] = programD->_main;
+  programD->_variantBatch[header.variant] = programD->_batch;
+  programD->_variantSize[header.variant] = header.codeSize;
+  programD->_variantFeatures[header.variant] = header.features;
+  programD->_variantConstSlot[header.variant] = header.constSlot;
+  programD->_options = header.options;
+  programD->_layoutHash = layoutHash;
+  programD->_sourceHash = header.codeHash;
+  mpProgramAddSymbols(programD, rt->_jitSymbols);
+
+  mpObjectRelease(
+    mpAtomicSetXchgT<Program::Impl*>(
+      &program._d, programD));
   return kErrorOk;
 }
 
@@ -548,13 +1979,32 @@ Context& Context::operator=(const Context& other) noexcept {
 // [mpsl::Program - Construction / Destruction]
 // ============================================================================
 
-static const Program::Impl mpProgramNull = { 0, nullptr, nullptr };
+// All members are zero, a zero `_refCount` keeps it from being reference counted.
+static const Program::Impl mpProgramNull = {};
 
 Program::Program() noexcept
   : _d(const_cast<Program::Impl*>(&mpProgramNull)) {}
 
+// Get a new reference of `*src`, which other threads can replace and release
+// meanwhile. A program released to zero references is only freed when this
+// thread leaves its `RunScope`, it's then found replaced in `*src`.
+static Program::Impl* mpProgramAcquire(Program::Impl* const* src) noexcept {
+  Program::RunScope scope;
+
+  for (;;) {
+    Program::Impl* d = *static_cast<Program::Impl* const volatile*>(src);
+    uintptr_t refCount = mpAtomicGet(&d->_refCount);
+
+    if (d == &mpProgramNull)
+      return d;
+
+    if (refCount != 0 && mpAtomicCmpXchg(&d->_refCount, refCount, refCount + 1))
+      return d;
+  }
+}
+
 Program::Program(const Program& other) noexcept
-  : _d(mpObjectAddRef(other._d)) {}
+  : _d(mpProgramAcquire(&other._d)) {}
 
 Program::~Program() noexcept {
   mpObjectRelease(_d);
@@ -570,6 +2020,185 @@ Error Program::reset() noexcept {
   return kErrorOk;
 }
 
+// ============================================================================
+// [mpsl::Program - Variants]
+// ============================================================================
+
+Error Program::selectVariant(uint32_t variant) noexcept {
+  Impl* d = _d;
+
+  if (variant >= kVariantCount || d->_variantMain[variant] == nullptr)
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  d->_main = d->_variantMain[variant];
+  d->_batch = d->_variantBatch[variant];
+  d->_programSize = d->_variantSize[variant];
+  d->_variant = variant;
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::Program - Name]
+// ============================================================================
+
+Error Program::setName(const char* name) noexcept {
+  Impl* d = _d;
+  if (d->_main == nullptr)
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  char* nameCopy = nullptr;
+  if (name != nullptr) {
+    size_t len = ::strlen(name);
+    nameCopy = static_cast<char*>(::malloc(len + 1));
+
+    if (nameCopy == nullptr)
+      return MPSL_TRACE_ERROR(kErrorNoMemory);
+    ::memcpy(nameCopy, name, len + 1);
+  }
+
+  // Register the code again, profilers use the most recent name.
+  uint32_t flags = d->_jitSymbols;
+  mpProgramRemoveSymbols(d);
+
+  ::free(d->_name);
+  d->_name = nameCopy;
+
+  mpProgramAddSymbols(d, flags);
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::Program - Stats]
+// ============================================================================
+
+Error Program::getStats(Stats& out) const noexcept {
+  ProgramCounters* counters = static_cast<ProgramCounters*>(_d->_counters);
+  ::memset(&out, 0, sizeof(Stats));
+
+  if (counters == nullptr)
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  const ProgramCounterSlot* slots = counters->getSlots();
+  for (uint32_t i = 0; i < kProgramCountersSlots; i++) {
+    const volatile ProgramCounterSlot& slot = slots[i];
+    out.calls += slot.calls;
+    out.records += slot.records;
+    out.cycles += slot.cycles;
+  }
+
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::Program - Serialize]
+// ============================================================================
+
+size_t Program::getSerializedSize() const noexcept {
+  const Impl* d = _d;
+  if (!mpIsSerializable(d))
+    return 0;
+
+  return sizeof(ProgramBlob) + d->_variantSize[d->_variant];
+}
+
+Error Program::serialize(void* dst, size_t dstSize) const noexcept {
+  const Impl* d = _d;
+  if (!mpIsSerializable(d))
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  uint32_t variant = d->_variant;
+  uint32_t codeSize = d->_variantSize[variant];
+
+  if (dst == nullptr || dstSize < sizeof(ProgramBlob) + codeSize)
+    return MPSL_TRACE_ERROR(kErrorInvalidArgument);
+
+  const uint8_t* code = static_cast<const uint8_t*>(d->_main);
+
+  ProgramBlob blob;
+  blob.magic = ProgramBlob::kMagic;
+  blob.version = ProgramBlob::kVersion;
+  blob.pointerWidth = kPointerWidth;
+  blob.features = d->_variantFeatures[variant];
+  blob.options = d->_options;
+  blob.layoutHash = d->_layoutHash;
+  blob.argsCount = d->_argsCount;
+  blob.variant = variant;
+  blob.regPressure = d->_regPressure;
+  blob.spillCount = d->_spillCount;
+  blob.codeSize = codeSize;
+  blob.batchOffset = static_cast<uint32_t>(reinterpret_cast<const uint8_t*>(d->_batch) - code);
+  blob.constSlot = d->_variantConstSlot[variant];
+  blob.reserved = 0;
+
+  // The address of shared constants differs per process, it's not stored.
+  uint8_t* dstCode = static_cast<uint8_t*>(dst) + sizeof(ProgramBlob);
+  ::memcpy(dstCode, code, codeSize);
+  if (blob.constSlot != 0)
+    ::memset(dstCode + blob.constSlot, 0, kPointerWidth);
+
+  blob.codeHash = HashUtils::hashString(reinterpret_cast<const char*>(dstCode), codeSize);
+  ::memcpy(dst, &blob, sizeof(ProgramBlob));
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::Program - Respecialize]
+// ============================================================================
+
+Error Program::_respecialize(Context& context, const void* const* values, OutputLog* log) noexcept {
+  Impl* d = _d;
+  ProgramSpec* spec = static_cast<ProgramSpec*>(d->_spec);
+
+  if (spec == nullptr)
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  Context::CompileArgs ca(spec->body, spec->bodyLength, spec->options, spec->numArgs);
+  for (uint32_t slot = 0; slot < spec->numArgs; slot++) {
+    ca.layout[slot] = &spec->layout[slot];
+    ca.values[slot] = values[slot];
+  }
+
+  // The spec is owned by the program being replaced, keep it alive until the
+  // compilation finishes.
+  mpObjectAddRef(d);
+  Error err = context._compile(*this, ca, log);
+  mpObjectRelease(d);
+
+  return err;
+}
+
+// ============================================================================
+// [mpsl::Program - Run]
+// ============================================================================
+
+Error Program::_runParallel(void** args, const intptr_t* strides, size_t count, ThreadPool* pool) const noexcept {
+  // Workers finish before `mpRunParallel()` returns, the scope covers them.
+  RunScope scope;
+
+  Impl* d = _d;
+  if (d->_batch == nullptr)
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  return mpRunParallel(d->_batch, args, strides, d->_argsCount, count, pool,
+    static_cast<const ParallelReduce*>(d->_reduce));
+}
+
+void* Program::_enterRun() noexcept {
+  return mpReclaimEnter();
+}
+
+void Program::_leaveRun(void* counter) noexcept {
+  mpReclaimLeave(static_cast<uintptr_t*>(counter));
+}
+
+// ============================================================================
+// [mpsl::Program - Reclaim]
+// ============================================================================
+
+size_t Program::reclaim() noexcept {
+  return mpReclaimPoll();
+}
+
 // ============================================================================
 // [mpsl::Program - Operator Overload]
 // ============================================================================
@@ -577,7 +2206,81 @@ Error Program::reset() noexcept {
 Program& Program::operator=(const Program& other) noexcept {
   mpObjectRelease(
     mpAtomicSetXchgT<Impl*>(
-      &_d, mpObjectAddRef(other._d)));
+      &_d, mpProgramAcquire(&other._d)));
+
+  return *this;
+}
+
+void Program::swap(Program& other) noexcept {
+  other._d = mpAtomicSetXchgT<Impl*>(&_d, other._d);
+}
+
+// ============================================================================
+// [mpsl::CompileJob - Construction / Destruction]
+// ============================================================================
+
+CompileJob::CompileJob() noexcept
+  : _d(nullptr) {}
+
+CompileJob::CompileJob(const CompileJob& other) noexcept
+  : _d(mpCompileJobAddRef(other._d)) {}
+
+CompileJob::~CompileJob() noexcept {
+  mpCompileJobRelease(_d);
+}
+
+// ============================================================================
+// [mpsl::CompileJob - Reset]
+// ============================================================================
+
+Error CompileJob::reset() noexcept {
+  mpCompileJobRelease(mpAtomicSetXchgT<Impl*>(&_d, nullptr));
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::CompileJob - Accessors]
+// ============================================================================
+
+bool CompileJob::isValid() const noexcept {
+  return _d != nullptr;
+}
+
+bool CompileJob::isReady() const noexcept {
+  return _d != nullptr && mpAtomicGet(&_d->_isReady) != 0;
+}
+
+// ============================================================================
+// [mpsl::CompileJob - Wait]
+// ============================================================================
+
+Error CompileJob::wait(Program& program) const noexcept {
+  Impl* d = _d;
+  if (d == nullptr)
+    return MPSL_TRACE_ERROR(kErrorInvalidState);
+
+  // Compiling takes from microseconds to milliseconds, which is too short to
+  // justify a condition variable that every `ThreadPool` would have to signal.
+  while (mpAtomicGet(&d->_isReady) == 0)
+    mpThreadYield();
+
+  if (d->_error != kErrorOk)
+    return d->_error;
+
+  mpObjectRelease(
+    mpAtomicSetXchgT<Program::Impl*>(
+      &program._d, mpObjectAddRef(d->_program._d)));
+  return kErrorOk;
+}
+
+// ============================================================================
+// [mpsl::CompileJob - Operator Overload]
+// ============================================================================
+
+CompileJob& CompileJob::operator=(const CompileJob& other) noexcept {
+  mpCompileJobRelease(
+    mpAtomicSetXchgT<Impl*>(
+      &_d, mpCompileJobAddRef(other._d)));
 
   return *this;
 }
@@ -24,11 +24,14 @@ namespace mpsl {
 // [Forward Declarations]
 // ============================================================================
 
+struct CompileJob;
 struct Context;
 struct Program;
 
 struct Layout;
 struct OutputLog;
+struct Pipeline;
+struct ThreadPool;
 
 // ============================================================================
 // [mpsl::ErrorCode]
@@ -118,7 +121,18 @@ enum ErrorCode {
   kErrorTooManyMembers,
 
   //! Context is frozen and can't be modified anymore.
-  kErrorFrozenContext
+  kErrorFrozenContext,
+
+  //! Returned by `Context::_loadProgram()` if the blob was not created by
+  //! `Program::serialize()`, is damaged, or doesn't match the MPSL version,
+  //! layouts of the program, or the host CPU.
+  kErrorInvalidBlob,
+
+  //! There is no backend that generates code for the host architecture.
+  //!
+  //! Returned by `Context::compile()` after the program has been checked, so
+  //! programs can be validated on any host, and by `Context::_loadProgram()`.
+  kErrorUnsupportedTarget
 };
 
 // ============================================================================
@@ -212,6 +226,15 @@ enum TypeIdFlags {
   //! `kTypeDenest`.
   kTypeDenest = 0x00040000,
 
+  //! Member is bound at compile time (only used to define a `Layout`).
+  //!
+  //! The value of the member is read when the program is compiled from the
+  //! data passed to `compileBound()` (or `respecialize()`) instead of the data
+  //! passed to `run()`, and the member becomes a constant of the program, so it
+  //! takes part in constant folding and removal of dead branches. A bound member
+  //! must be read-only and can't be a member of a SoA `Layout`.
+  kTypeBind = 0x00080000,
+
   // --------------------------------------------------------------------------
   // [Type-RW]
   // --------------------------------------------------------------------------
@@ -226,7 +249,91 @@ enum TypeIdFlags {
   //! Convenience - used in `Layout::add()` to define write-only variable/member.
   kTypeWO = kTypeWrite,
   //! Convenience - used in `Layout::add()` to define read/write variable/member.
-  kTypeRW = kTypeRead | kTypeWrite
+  kTypeRW = kTypeRead | kTypeWrite,
+
+  // --------------------------------------------------------------------------
+  // [Type-Reduce]
+  // --------------------------------------------------------------------------
+
+  //! Member is a reduction output (only used to define a `Layout`).
+  //!
+  //! An assignment to the member combines the assigned value with the member
+  //! instead of replacing it - `kTypeReduceSum` adds it, `kTypeReduceMin` and
+  //! `kTypeReduceMax` keep the smaller or the bigger one (vectors per element).
+  //! A count is a sum of `1` assigned to an `int` member. The value of the
+  //! member is never cleared by MPSL, it must be initialized by the embedder
+  //! (for example to zero for a sum).
+  //!
+  //! A batch keeps reductions in registers and accesses the member only once,
+  //! reductions always combine into the data passed to `runBatch()`, which
+  //! isn't advanced for them. `runParallel()` reduces into a private copy of
+  //! the data per worker and combines the copies when all workers finish,
+  //! which requires the stride of the data to be zero (the data is shared by
+  //! all records), otherwise the batch runs on the calling thread.
+  //!
+  //! A reduction member must be write-only and `int`, `float`, or `double`
+  //! (or their vector). It can't be bound, be a member of a SoA `Layout`, or
+  //! be used by a program that uses a SoA `Layout`.
+  kTypeReduceSum = 0x00400000,
+  //! Member keeps the minimum of all assigned values, see `kTypeReduceSum`.
+  kTypeReduceMin = 0x00800000,
+  //! Member keeps the maximum of all assigned values, see `kTypeReduceSum`.
+  kTypeReduceMax = 0x00C00000,
+  //! Mask of all reduction flags.
+  kTypeReduceMask = 0x00C00000,
+
+  // --------------------------------------------------------------------------
+  // [Type-Padding]
+  // --------------------------------------------------------------------------
+
+  //! Member is padded to the size of a 4-element vector (only used to define
+  //! a `Layout`).
+  //!
+  //! Only 3-element vectors can be padded, `float3` is then followed by 4 bytes
+  //! and `double3` by 8 bytes that belong to the member. The program reads
+  //! and writes the member by a single full-width access and the content of
+  //! the padding is unspecified after the member is written. A padded member
+  //! can't be a member of a SoA `Layout`.
+  kTypePadded = 0x01000000,
+
+  // --------------------------------------------------------------------------
+  // [Type-Array]
+  // --------------------------------------------------------------------------
+
+  //! Array is accessed through a pointer (only used to define an array by
+  //! `Layout::addArray()`).
+  //!
+  //! The offset of the array points to a pointer to its elements (`T*`)
+  //! instead of the elements themselves, so a table can be shared by all
+  //! records passed to `runBatch()` and replaced without recompiling the
+  //! program. The pointer must point to all elements of the array.
+  kTypeIndirect = 0x02000000,
+
+  // --------------------------------------------------------------------------
+  // [Type-Storage]
+  // --------------------------------------------------------------------------
+
+  //! Member is stored as 4 unsigned 8-bit integers (only used to define a
+  //! `Layout`).
+  //!
+  //! A member stored in a narrow format has `int4` or `float4` type in the
+  //! program. Elements are widened when the member is read and converted
+  //! with unsigned saturation when it's written, a `float4` element is then
+  //! truncated towards zero unless it's `kTypeNormalized`. A stored member
+  //! can't be a member of a SoA `Layout`, an array, a reduction, or bound.
+  kTypeStorageU8 = 0x04000000,
+  //! Member is stored as 4 unsigned 16-bit integers, see `kTypeStorageU8`.
+  kTypeStorageU16 = 0x08000000,
+  //! Member is stored as 4 half-precision floats, it must be `float4`, see
+  //! `kTypeStorageU8`. Values written are rounded to the nearest.
+  kTypeStorageF16 = 0x0C000000,
+  //! Mask of all storage formats.
+  kTypeStorageMask = 0x0C000000,
+
+  //! Integers of a `kTypeStorageU8` or `kTypeStorageU16` member map to the
+  //! `[0, 1]` range of a `float4` member, values written are clamped to it
+  //! and rounded to the nearest integer.
+  kTypeNormalized = 0x10000000
 };
 
 // ============================================================================
@@ -246,6 +353,25 @@ enum Options {
   //! Debug assembly generated.
   kOptionDebugASM = 0x0008,
 
+  //! Do not use the context's program cache, always compile from scratch.
+  kOptionDisableCache = 0x0010,
+
+  //! Run all IR optimizations (default).
+  kOptionOptFull = 0x0000,
+  //! Run only copy propagation, constant folding, strength reduction, dead
+  //! code elimination, and conversion of small branches to selects.
+  kOptionOptBasic = 0x0020,
+  //! Don't optimize the IR, fastest compilation at the cost of slower code.
+  kOptionOptNone = 0x0040,
+  //! Mask of the optimization level, see `kOptionOpt...`.
+  kOptionOptLevelMask = 0x0060,
+
+  //! Allow floating-point optimizations that don't preserve IEEE results
+  //! bit-exact - fusing multiply and add into FMA (if the CPU supports it),
+  //! reassociating additions and multiplications, and replacing a division
+  //! by a constant by a multiplication by its reciprocal.
+  kOptionFastMath = 0x0080,
+
   //! Do not use SSE3 (and higher) even if the CPU supports it (X86/X64 only).
   kOptionDisableSSE3 = 0x0100,
   //! Do not use SSSE3 (and higher) even if the CPU supports it (X86/X64 only).
@@ -259,11 +385,128 @@ enum Options {
   //! Do not use AVX2 (and higher) even if the CPU supports it (X86/X64 only).
   kOptionDisableAVX2 = 0x2000,
 
+  //! Compile a variant of the program for each instruction set supported by
+  //! the CPU and not disabled by other options, see \ref Variant, and run the
+  //! best one (X86/X64 only). All variants are compiled from the same IR, which
+  //! doesn't keep 256-bit vectors in a single register, so this option doesn't
+  //! make sense if the program is only run by one variant.
+  kOptionMultiVersion = 0x4000,
+
+  //! Measure each stage of the compiler and send its statistics to the log as
+  //! a `OutputLog::kMessageProfile` message, see `OutputLog::Profile`. It's
+  //! ignored without a log, and like debug options it bypasses the program
+  //! cache, as a cached program has no stages to measure.
+  kOptionProfile = 0x8000,
+
+  //! Flush denormal results of floating-point operations to zero and treat
+  //! denormal inputs as zero (FTZ and DAZ on X86/X64). Most CPUs process
+  //! denormals many times slower, which hurts code like audio filters where
+  //! signals decay to them.
+  kOptionFlushDenormals = 0x00010000,
+
+  //! Round to nearest even (default).
+  kOptionRoundNearest = 0x00000000,
+  //! Round toward negative infinity.
+  kOptionRoundDown = 0x00020000,
+  //! Round toward positive infinity.
+  kOptionRoundUp = 0x00040000,
+  //! Round toward zero.
+  kOptionRoundZero = 0x00060000,
+  //! Mask of the rounding mode, see `kOptionRound...`.
+  //!
+  //! A program compiled with `kOptionFlushDenormals` or a rounding mode other
+  //! than the default sets its floating-point environment on entry and restores
+  //! the caller's one on return (once per `runBatch()` call), otherwise it runs
+  //! in the environment of the caller. Constant folding uses the same mode, so
+  //! folded expressions give the same results as they would at runtime.
+  kOptionRoundMask = 0x00060000,
+
+  //! Count calls of entry points of the program and records they process, see
+  //! `Program::getStats()`. Counters are kept per thread by the compiled code,
+  //! so threads running the same program don't contend. Programs compiled
+  //! with counters can't be serialized.
+  kOptionCountRuns = 0x00080000,
+  //! Count also cycles spent in entry points of the program, measured by the
+  //! time-stamp counter (`rdtsc` on X86/X64), implies `kOptionCountRuns`.
+  kOptionCountCycles = 0x00100000,
+
+  //! Write members of records processed by `runBatch()` by non-temporal stores,
+  //! which don't keep the written data in the cache.
+  //!
+  //! Only write-only 128-bit and 256-bit members (see `kTypeWO`) aligned to
+  //! their size are written this way (see `Layout::setAlignment()`), members
+  //! that are also read are already in the cache. The batch ends by a store
+  //! fence so the data is visible to other threads when it returns. It helps
+  //! when batches are larger than the cache and the records are not read
+  //! again soon.
+  kOptionStreamStores = 0x00200000,
+
+  //! Don't prefetch records processed by `runBatch()` (default).
+  kOptionPrefetchNone = 0x00000000,
+  //! Prefetch members read from records 4 records ahead.
+  kOptionPrefetch4 = 0x00400000,
+  //! Prefetch members read from records 16 records ahead.
+  kOptionPrefetch16 = 0x00800000,
+  //! Prefetch members read from records 64 records ahead.
+  kOptionPrefetch64 = 0x00C00000,
+  //! Mask of the prefetch distance, see `kOptionPrefetch...`.
+  //!
+  //! Each iteration of a batch prefetches cache lines of members it reads from
+  //! the record that is processed the distance later, which hides latency of
+  //! memory when records are processed faster than they are fetched. Records
+  //! of a SoA `Layout` are not prefetched.
+  kOptionPrefetchMask = 0x00C00000,
+
+  //! Numbers written without a type suffix take the type of a `float` operand.
+  //!
+  //! Numbers like `0.5` or `2` are `double` or `int`, so `x * 0.5` converts a
+  //! `float` `x` to `double` and computes in double precision. With this option
+  //! such a number becomes `float` if it's used with a `float` operand (or is
+  //! assigned, passed, or returned as `float`) and it can be represented by
+  //! `float` exactly. Numbers with the `d` suffix are never changed. Remaining
+  //! conversions between `float` and `double` are reported as warnings by
+  //! `kOptionVerbose`.
+  kOptionPreferFloat = 0x01000000,
+
   //! \internal
   //!
   //! Mask of all accessible options, MPSL uses also \ref InternalOptions that
   //! should not collide with \ref Options.
-  _kOptionsMask = 0xFFFF
+  _kOptionsMask = 0x01FFFFFF
+};
+
+// ============================================================================
+// [mpsl::Variant]
+// ============================================================================
+
+//! Instruction set a program was compiled for (X86/X64 only), see
+//! `Program::getVariant()` and `kOptionMultiVersion`.
+enum Variant {
+  //! Baseline, SSE2 only.
+  kVariantSSE2 = 0,
+  //! SSE4.1, SSE3 and SSSE3 are not used.
+  kVariantSSE4_1 = 1,
+  //! AVX and AVX2, including FMA if the CPU supports it.
+  kVariantAVX2 = 2,
+
+  //! Count of variants.
+  kVariantCount = 3
+};
+
+// ============================================================================
+// [mpsl::JitSymbols]
+// ============================================================================
+
+//! Profiler interfaces compiled programs are registered with, so profilers
+//! can attribute samples to programs, see `Context::setJitSymbols()`.
+enum JitSymbols {
+  //! Don't register programs (default).
+  kJitSymbolsNone = 0x0000,
+  //! Write `/tmp/perf-<pid>.map` used by `perf report` (Linux only).
+  kJitSymbolsPerfMap = 0x0001,
+  //! Write `jit-<pid>.dump` in the working directory, which is merged into
+  //! the profile by `perf inject --jit` (Linux only).
+  kJitSymbolsJitDump = 0x0002
 };
 
 // ============================================================================
@@ -282,7 +525,22 @@ enum Limits {
   //! Maximum length of an identifier.
   kMaxIdentifierLength = 64,
   //! Maximum number of members of one data `Layout`.
-  kMaxMembersCount = 512
+  kMaxMembersCount = 512,
+  //! Number of elements processed at once by a program that uses a SoA
+  //! `Layout`, see `Layout::kFlagSoA`.
+  kLaneCount = 4,
+  //! Default maximum trip count of loops unrolled by the compiler, see
+  //! `Context::setUnrollLimit()`.
+  kDefaultUnrollLimit = 8,
+  //! Default maximum size of functions that are always inlined, see
+  //! `Context::setInlineLimit()`.
+  kDefaultInlineLimit = 64,
+  //! Maximum number of stages of a `Pipeline`.
+  kMaxPipelineStages = 8,
+  //! Maximum number of links of a `Pipeline`.
+  kMaxPipelineLinks = 16,
+  //! Maximum alignment of data described by a `Layout`, see `Layout::setAlignment()`.
+  kMaxLayoutAlignment = 32
 };
 
 } // Globals namespace
@@ -542,7 +800,26 @@ struct Layout {
     //! Member type information.
     uint32_t typeInfo;
     //! Member offset in the passed data (negative offset is allowed).
+    //!
+    //! If the layout has `kFlagSoA` the offset points to a column pointer
+    //! instead of the member itself.
     int32_t offset;
+    //! Number of elements if the member is an array added by `addArray()`,
+    //! zero otherwise.
+    uint32_t count;
+  };
+
+  //! Layout flags.
+  enum Flags {
+    //! Structure-of-arrays layout.
+    //!
+    //! Each member is described by an offset of a column pointer (`T*`) in the
+    //! passed data instead of the member itself. Columns are dense arrays of
+    //! scalar elements that are processed `Globals::kLaneCount` at a time, a
+    //! scalar shader is compiled to use full 128-bit SIMD registers in this
+    //! mode. Only scalar members can be added into a SoA layout and columns
+    //! must be padded to a multiple of `Globals::kLaneCount` elements.
+    kFlagSoA = 0x00000001
   };
 
   // --------------------------------------------------------------------------
@@ -578,10 +855,26 @@ public:
     return _configure(name.getData(), name.getLength());
   }
 
+  //! Set layout flags, see \ref Flags.
+  //!
+  //! Flags have to be set before any member is added, `kErrorAlreadyConfigured`
+  //! is returned otherwise.
+  MPSL_API Error setFlags(uint32_t flags) noexcept;
+
+  //! Set the alignment of data described by this `Layout`, a power of 2 up to
+  //! `Globals::kMaxLayoutAlignment` (1 by default, no alignment guaranteed).
+  //!
+  //! The data passed to the program must be aligned to `alignment`, including
+  //! every record passed to `runBatch()`, so strides must be multiples of it.
+  //! Columns of a SoA layout must be aligned instead. Members that are aligned
+  //! by their offsets are then read by aligned accesses, which SSE can combine
+  //! with arithmetic without AVX.
+  MPSL_API Error setAlignment(uint32_t alignment) noexcept;
+
   //! \internal
   MPSL_API const Member* _get(const char* name, size_t len) const noexcept;
   //! \internal
-  MPSL_API Error _add(const char* name, size_t len, uint32_t typeInfo, int32_t offset) noexcept;
+  MPSL_API Error _add(const char* name, size_t len, uint32_t typeInfo, int32_t offset, uint32_t count) noexcept;
 
   //! Get whether the layout has a name. Name is an identifier that is used
   //! in a shader program to access the data and its members. Name has to be
@@ -592,6 +885,13 @@ public:
   MPSL_INLINE const char* getName() const noexcept { return _name; }
   MPSL_INLINE uint32_t getNameLength() const noexcept { return _nameLength; }
 
+  //! Get layout flags, see \ref Flags.
+  MPSL_INLINE uint32_t getFlags() const noexcept { return _flags; }
+  //! Get whether the layout is a structure-of-arrays, see \ref kFlagSoA.
+  MPSL_INLINE bool isSoA() const noexcept { return (_flags & kFlagSoA) != 0; }
+  //! Get the alignment of data described by the layout, see `setAlignment()`.
+  MPSL_INLINE uint32_t getAlignment() const noexcept { return _alignment; }
+
   MPSL_INLINE const Member* getMembersArray() const noexcept { return _members; }
   MPSL_INLINE uint32_t getMembersCount() const noexcept { return _membersCount; }
 
@@ -620,12 +920,31 @@ public:
 
   //! Add a new member to the arguments object.
   MPSL_INLINE Error addMember(const char* name, uint32_t typeInfo, int32_t offset) noexcept {
-    return _add(name, Globals::kInvalidIndex, typeInfo, offset);
+    return _add(name, Globals::kInvalidIndex, typeInfo, offset, 0);
   }
 
   //! \overload
   MPSL_INLINE Error addMember(const StringRef& name, uint32_t typeInfo, int32_t offset) noexcept {
-    return _add(name.getData(), name.getLength(), typeInfo, offset);
+    return _add(name.getData(), name.getLength(), typeInfo, offset, 0);
+  }
+
+  //! Add a read-only array of `count` elements of `typeInfo` at `offset`, a
+  //! lookup table that the program reads by `name[index]`.
+  //!
+  //! The index is an `int` clamped to `[0, count - 1]`, so the program never
+  //! reads outside of the array. Elements follow each other without a gap, a
+  //! 3-element vector has to be `kTypePadded`, and the elements are accessed
+  //! through a pointer if `typeInfo` has `kTypeIndirect`. An array can't be a
+  //! member of a SoA `Layout`, but it can be indexed by a program that uses
+  //! lanes, each lane then reads its own element (gathered by AVX2 if it's
+  //! available).
+  MPSL_INLINE Error addArray(const char* name, uint32_t typeInfo, int32_t offset, uint32_t count) noexcept {
+    return _add(name, Globals::kInvalidIndex, typeInfo, offset, count);
+  }
+
+  //! \overload
+  MPSL_INLINE Error addArray(const StringRef& name, uint32_t typeInfo, int32_t offset, uint32_t count) noexcept {
+    return _add(name.getData(), name.getLength(), typeInfo, offset, count);
   }
 
   // --------------------------------------------------------------------------
@@ -643,6 +962,10 @@ public:
   const char* _name;
   //! Object name length;
   uint32_t _nameLength;
+  //! Layout flags.
+  uint32_t _flags;
+  //! Alignment of the data, see `setAlignment()`.
+  uint32_t _alignment;
 
   //! Count of members.
   uint32_t _membersCount;
@@ -664,6 +987,102 @@ struct LayoutTmp : public Layout {
   uint8_t _embeddedDataTmp[N - 8];
 };
 
+// ============================================================================
+// [mpsl::Pipeline]
+// ============================================================================
+
+//! Pipeline of programs compiled into a single function.
+//!
+//! Each stage is a source of a program that has its own `main()` and its own
+//! functions and constants, all stages share the layouts the pipeline is
+//! compiled with. The compiled function runs `main()` of each stage in order,
+//! so the data loaded by one stage is reused by the next one and a value that
+//! is passed between stages stays in registers instead of memory.
+//!
+//! Values are passed by links, which are variables visible to all stages.
+//! Links are zero-initialized when the function starts, a stage writes a link
+//! either by an assignment or by returning a value if it's added with a link
+//! name. The value returned by the last stage is the result of the program
+//! (`@ret`).
+//!
+//! Only links are forwarded between stages, members are not. All stages access
+//! members by types of the shared layouts, so a write-only member written by a
+//! stage can't be read by a later one. A stage passes any value to the stages
+//! that follow it, not only the value it returns, by assigning it to a link.
+//!
+//! Line numbers in errors count lines of all stages, each stage starts on a
+//! new line. Stage sources and names are not copied and must stay alive until
+//! the pipeline is compiled. Compiled pipelines are not cached and can't be
+//! respecialized.
+struct Pipeline {
+  //! \internal
+  struct Stage {
+    //! Source of the stage.
+    StringRef body;
+    //! Link the value returned by the stage's `main()` is assigned to, or null.
+    const char* retLink;
+  };
+
+  //! \internal
+  struct Link {
+    //! Link name.
+    const char* name;
+    //! Link type, see \ref TypeInfo.
+    uint32_t typeInfo;
+  };
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  MPSL_INLINE Pipeline() noexcept
+    : _stagesCount(0),
+      _linksCount(0) {}
+  MPSL_INLINE ~Pipeline() noexcept {}
+
+  // --------------------------------------------------------------------------
+  // [Interface]
+  // --------------------------------------------------------------------------
+
+  //! Add a stage of the pipeline, the value returned by its `main()` is
+  //! assigned to `retLink`, if given (the last stage returns it instead).
+  MPSL_API Error addStage(const StringRef& body, const char* retLink = nullptr) noexcept;
+  //! \overload
+  MPSL_INLINE Error addStage(const char* body, const char* retLink = nullptr) noexcept {
+    return addStage(StringRef(body), retLink);
+  }
+
+  //! Add a link `name` of `typeInfo` type, which has to be a scalar or a vector
+  //! type without qualifiers.
+  MPSL_API Error addLink(const char* name, uint32_t typeInfo) noexcept;
+
+  //! Remove all stages and links.
+  MPSL_INLINE void reset() noexcept {
+    _stagesCount = 0;
+    _linksCount = 0;
+  }
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  MPSL_INLINE uint32_t getStagesCount() const noexcept { return _stagesCount; }
+  MPSL_INLINE const Stage& getStage(uint32_t index) const noexcept { return _stages[index]; }
+
+  MPSL_INLINE uint32_t getLinksCount() const noexcept { return _linksCount; }
+  MPSL_INLINE const Link& getLink(uint32_t index) const noexcept { return _links[index]; }
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  Stage _stages[Globals::kMaxPipelineStages];
+  Link _links[Globals::kMaxPipelineLinks];
+
+  uint32_t _stagesCount;
+  uint32_t _linksCount;
+};
+
 // ============================================================================
 // [mpsl::Context]
 // ============================================================================
@@ -686,6 +1105,46 @@ struct Context {
     uintptr_t _refCount;
     //! Runtime data.
     void* _runtimeData;
+    //! Program cache.
+    void* _programCache;
+    //! Built-in scope shared by all compilations, created by `freeze()`.
+    void* _builtIns;
+    //! Zones reused by compilations, see `trimArenas()`.
+    void* _arenaPool;
+    //! Maximum trip count of unrolled loops, see `setUnrollLimit()`.
+    uint32_t _unrollLimit;
+    //! Maximum size of functions that are always inlined, see `setInlineLimit()`.
+    uint32_t _inlineLimit;
+    //! Best variant supported by the host CPU, see `getCpuVariant()`.
+    uint32_t _cpuVariant;
+  };
+
+  //! Program cache statistics, see `getCacheStats()`.
+  struct CacheStats {
+    //! Number of compilations satisfied by the cache.
+    uint64_t hits;
+    //! Number of compilations not found in the cache.
+    uint64_t misses;
+    //! Number of programs evicted because of the cache limit.
+    uint64_t evictions;
+    //! Number of programs currently in the cache.
+    uint32_t count;
+    //! Maximum number of programs in the cache (0 if unlimited).
+    uint32_t limit;
+  };
+
+  //! Memory used by compiled code, see `getMemoryStats()`.
+  struct MemoryStats {
+    //! Bytes of executable memory allocated by the context.
+    size_t committedBytes;
+    //! Bytes of executable memory used by the code of programs.
+    size_t usedBytes;
+    //! Bytes of constants embedded in the code (included in `usedBytes`).
+    size_t constPoolBytes;
+    //! Maximum `usedBytes`, see `setCodeLimit()` (0 if unlimited).
+    size_t limit;
+    //! Number of programs that have not been freed yet.
+    uint32_t programCount;
   };
 
   // --------------------------------------------------------------------------
@@ -721,6 +1180,15 @@ struct Context {
     return _d->_runtimeData != nullptr;
   }
 
+  //! Get whether the context has been frozen, see `freeze()`.
+  MPSL_INLINE bool isFrozen() const noexcept {
+    return _d->_builtIns != nullptr;
+  }
+
+  //! Get the best \ref Variant supported by the host CPU, detected when the
+  //! context was created.
+  MPSL_INLINE uint32_t getCpuVariant() const noexcept { return _d->_cpuVariant; }
+
   // --------------------------------------------------------------------------
   // [Clone / Freeze]
   // --------------------------------------------------------------------------
@@ -737,8 +1205,121 @@ struct Context {
   //! No modifications are allowed after the context is frozen. This is useful
   //! when building a fixed environment for your programs that can't be modified
   //! after it has been created (it becomes immutable).
+  //!
+  //! Freezing builds all built-in types, constants and intrinsics once, all
+  //! compilations then share them instead of creating them again, which makes
+  //! compiling small programs noticeably faster. Freezing a frozen context
+  //! does nothing.
   MPSL_API Error freeze() noexcept;
 
+  // --------------------------------------------------------------------------
+  // [Program Cache]
+  // --------------------------------------------------------------------------
+
+  //! Set the maximum number of programs kept by the program cache.
+  //!
+  //! Every context caches the programs it compiles, keyed by the program body,
+  //! all layouts (names, flags and members), number of arguments, options, and
+  //! the unroll limit. Compiling the same program again returns the already
+  //! compiled program instead of running the whole compiler. Setting `limit`
+  //! evicts the least recently used programs when the cache grows beyond
+  //! `limit` programs, the default 0 means unlimited.
+  //!
+  //! Programs are never cached if compiled with `kOptionDisableCache` or with
+  //! any debug option and a log.
+  MPSL_API Error setCacheLimit(uint32_t limit) noexcept;
+
+  //! Get statistics of the program cache.
+  MPSL_API Error getCacheStats(CacheStats& out) const noexcept;
+
+  //! Remove all programs from the program cache.
+  //!
+  //! Programs that are still referenced elsewhere stay valid.
+  MPSL_API Error clearCache() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Arenas]
+  // --------------------------------------------------------------------------
+
+  //! Release memory kept for compilations.
+  //!
+  //! Memory used by the compiler is not released after a compilation, the
+  //! next one reuses it. Each compilation that runs concurrently has its own
+  //! memory, which grows to the largest program compiled. This releases the
+  //! memory of all compilations that are not running, for example after many
+  //! programs have been compiled at startup.
+  MPSL_API Error trimArenas() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Memory]
+  // --------------------------------------------------------------------------
+
+  //! Get memory used by the code of programs compiled or loaded by the context.
+  //!
+  //! The code of all programs is allocated from blocks of executable memory
+  //! shared by the context, `committedBytes` includes the free space of these
+  //! blocks. The code of a program is released after the program is freed,
+  //! which includes the programs kept by the program cache.
+  MPSL_API Error getMemoryStats(MemoryStats& out) const noexcept;
+
+  //! Set the maximum size of the code of all programs, in bytes.
+  //!
+  //! Compiling or loading a program fails with `kErrorNoMemory` instead of
+  //! allocating more memory if its code doesn't fit into `limit`. Programs
+  //! that have already been compiled are not affected. The default 0 means
+  //! unlimited.
+  MPSL_API Error setCodeLimit(size_t limit) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Optimization]
+  // --------------------------------------------------------------------------
+
+  //! Get the maximum trip count of loops unrolled by the compiler.
+  MPSL_INLINE uint32_t getUnrollLimit() const noexcept { return _d->_unrollLimit; }
+
+  //! Set the maximum trip count of loops unrolled by the compiler.
+  //!
+  //! Loops that have a trip count known at compile time (a counter initialized
+  //! and stepped by constants and compared against a constant) are unrolled
+  //! completely if the trip count doesn't exceed `limit` and the unrolled code
+  //! stays reasonably small. Setting `limit` to 0 disables unrolling, the
+  //! default is `Globals::kDefaultUnrollLimit`. Unrolling is only performed
+  //! with `kOptionOptFull`.
+  MPSL_API Error setUnrollLimit(uint32_t limit) noexcept;
+
+  //! Get the maximum size of functions that are always inlined.
+  MPSL_INLINE uint32_t getInlineLimit() const noexcept { return _d->_inlineLimit; }
+
+  //! Set the maximum size of functions that are always inlined.
+  //!
+  //! The size of a function is the number of nodes of its body, including the
+  //! bodies of functions it calls. A function that is larger than `limit` and
+  //! is called from more than one place is compiled once and called instead,
+  //! if it only works with its arguments (it doesn't access data objects) and
+  //! its arguments and return value fit into a single register. All other
+  //! calls are inlined. The default is `Globals::kDefaultInlineLimit`.
+  MPSL_API Error setInlineLimit(uint32_t limit) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Profiling]
+  // --------------------------------------------------------------------------
+
+  //! Get profiler interfaces programs are registered with, see \ref JitSymbols.
+  MPSL_API uint32_t getJitSymbols() const noexcept;
+
+  //! Register programs compiled or loaded from now on with profiler interfaces
+  //! selected by `flags`, see \ref JitSymbols.
+  //!
+  //! Each variant of a program is registered under the name of the program,
+  //! see `Program::setName()`, or `mpsl_<hash of the source>` if it has none,
+  //! followed by the variant (`.sse2`, `.sse4_1`, `.avx2`) if the program has
+  //! more of them. A program is
+  //! removed from the perf map when its code is released. The jitdump has no
+  //! record for released code, `perf` uses timestamps of records instead, so
+  //! code loaded later at the same address is attributed correctly. Returns
+  //! `kErrorInvalidArgument` if `flags` is not supported by the platform.
+  MPSL_API Error setJitSymbols(uint32_t flags) noexcept;
+
   // --------------------------------------------------------------------------
   // [Compile]
   // --------------------------------------------------------------------------
@@ -748,7 +1329,11 @@ struct Context {
     MPSL_INLINE CompileArgs(const char* s, size_t len, uint32_t options, uint32_t numArgs) noexcept :
       body(s, len),
       options(options),
-      numArgs(numArgs) {}
+      numArgs(numArgs),
+      pipeline(nullptr) {
+      for (uint32_t i = 0; i < Globals::kMaxArgumentsCount; i++)
+        values[i] = nullptr;
+    }
 
     //! Body of the function to compile.
     StringRef body;
@@ -759,11 +1344,30 @@ struct Context {
     uint32_t numArgs;
     //! Layout of arguments passed to the program.
     const Layout* layout[Globals::kMaxArgumentsCount];
+    //! Data of arguments that provide values of members bound at compile time
+    //! (see `kTypeBind`), can be null if the layout has no such member.
+    const void* values[Globals::kMaxArgumentsCount];
+    //! Pipeline to compile instead of `body`, can be null.
+    const Pipeline* pipeline;
   };
 
   //! \internal
   MPSL_API Error _compile(Program& program, const CompileArgs& ca, OutputLog* log) noexcept;
 
+  //! \internal
+  //!
+  //! Start compiling a program by `pool`, see `Program1::compileAsync()`.
+  MPSL_API Error _compileAsync(CompileJob& job, const CompileArgs& ca, ThreadPool* pool, OutputLog* log) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Load]
+  // --------------------------------------------------------------------------
+
+  //! \internal
+  //!
+  //! Load a program serialized by `Program::serialize()`, see `Program1::load()`.
+  MPSL_API Error _loadProgram(Program& program, const void* blob, size_t size, uint32_t numArgs, const Layout* const* layouts) noexcept;
+
   // --------------------------------------------------------------------------
   // [Operator Overload]
   // --------------------------------------------------------------------------
@@ -805,6 +1409,13 @@ struct Program {
     //! Prototype of `main()` that accepts four arguments.
     typedef Error (MPSL_CDECL *MainFunc4)(void* arg1, void* arg2, void* arg3, void* arg4);
 
+    //! Prototype of the batch entry-point that calls `main()` `count` times.
+    //!
+    //! Each data pointer `args[i]` is first advanced to the `start` record and
+    //! then by `strides[i]` bytes after each iteration (the stride can be zero
+    //! if the argument is shared).
+    typedef Error (MPSL_CDECL *BatchFunc)(void** args, const intptr_t* strides, size_t start, size_t count);
+
     // Implemented in `mpsl.cpp`.
     MPSL_INLINE void destroy() noexcept;
 
@@ -822,10 +1433,66 @@ struct Program {
       MainFunc4 _main4;
     };
 
+    //! Compiled batch entry-point (shares the code-buffer with `_main`).
+    BatchFunc _batch;
+
     //! Number of arguments that is passed to the entry-point.
     uint32_t _argsCount;
     //! Size of the compiled function (in bytes).
     uint32_t _programSize;
+    //! Maximum number of vector registers live at the same time.
+    uint32_t _regPressure;
+    //! Estimated number of registers spilled, see `getSpillCount()`.
+    uint32_t _spillCount;
+
+    //! Source and layouts of a program that has members bound at compile time,
+    //! used by `respecialize()` (null if the program has no bound members).
+    void* _spec;
+    //! Members reduced by the program, see `kTypeReduceSum` (null if none).
+    void* _reduce;
+
+    //! Variant `_main` and `_batch` point to, see \ref Variant.
+    uint32_t _variant;
+    //! Entry-points of all compiled variants (null if not compiled).
+    void* _variantMain[kVariantCount];
+    //! Batch entry-points of all compiled variants (null if not compiled).
+    BatchFunc _variantBatch[kVariantCount];
+    //! Code sizes of all compiled variants.
+    uint32_t _variantSize[kVariantCount];
+    //! CPU features used by all compiled variants (internal).
+    uint32_t _variantFeatures[kVariantCount];
+    //! Offsets of the address of constants shared by all programs in the code
+    //! of all compiled variants, zero if the code doesn't use them (internal).
+    uint32_t _variantConstSlot[kVariantCount];
+    //! Bytes of constants embedded in the code of all compiled variants
+    //! (internal, see `Context::getMemoryStats()`).
+    uint32_t _variantConstPool[kVariantCount];
+
+    //! Options the program was compiled with.
+    uint32_t _options;
+    //! Hash of layouts the program was compiled with.
+    uint32_t _layoutHash;
+
+    //! Name of the program, see `setName()`.
+    char* _name;
+    //! Hash of the source (or the code of a loaded program), used to name
+    //! programs that have no name.
+    uint32_t _sourceHash;
+    //! Profiler interfaces the program is registered with, see \ref JitSymbols.
+    uint32_t _jitSymbols;
+    //! Counters updated by the compiled code, see `kOptionCountRuns` (null if
+    //! the program doesn't count).
+    void* _counters;
+  };
+
+  //! Execution statistics of a program, see `getStats()`.
+  struct Stats {
+    //! Number of calls of entry points, a batch is a single call.
+    uint64_t calls;
+    //! Number of records processed (elements if the layout is SoA).
+    uint64_t records;
+    //! Number of cycles spent in entry points (only `kOptionCountCycles`).
+    uint64_t cycles;
   };
 
   // --------------------------------------------------------------------------
@@ -852,6 +1519,142 @@ struct Program {
   //! Get whether the program has been compiled and is valid.
   MPSL_INLINE bool isValid() const noexcept { return _d->_main != nullptr; }
 
+  //! Get the size of the machine code of the variant the program runs (in
+  //! bytes), including functions it calls out-of-line and constant pools.
+  MPSL_INLINE uint32_t getProgramSize() const noexcept { return _d->_programSize; }
+
+  //! Get the maximum number of vector registers live at the same time in the
+  //! optimized program (or any function it calls out-of-line).
+  MPSL_INLINE uint32_t getRegPressure() const noexcept { return _d->_regPressure; }
+
+  //! Get the number of registers the program is expected to spill.
+  //!
+  //! The estimate is computed from live ranges of the optimized IR, it's the
+  //! number of registers live at the same time that exceed the registers
+  //! available to the target, summed over all register kinds. A program that
+  //! doesn't spill has zero; a non-zero value means the program is limited by
+  //! registers, and usually runs faster with fewer lanes or without AVX.
+  MPSL_INLINE uint32_t getSpillCount() const noexcept { return _d->_spillCount; }
+
+  //! Get the \ref Variant the program runs.
+  //!
+  //! A program compiled with `kOptionMultiVersion` runs the best variant
+  //! supported by the CPU, unless changed by `selectVariant()`.
+  MPSL_INLINE uint32_t getVariant() const noexcept { return _d->_variant; }
+
+  //! Get whether the program has been compiled for `variant`.
+  MPSL_INLINE bool hasVariant(uint32_t variant) const noexcept {
+    return variant < kVariantCount && _d->_variantMain[variant] != nullptr;
+  }
+
+  //! Run `variant` of the program instead of the default one, for example to
+  //! compare variants. The variant must have been compiled, see `hasVariant()`.
+  //!
+  //! Copies of the program and programs found in the program cache share it,
+  //! so the variant changes for all of them. It must not be changed while the
+  //! program is running.
+  MPSL_API Error selectVariant(uint32_t variant) noexcept;
+
+  //! Get whether the program has members bound at compile time and can be
+  //! recompiled by `respecialize()`, see `kTypeBind`.
+  MPSL_INLINE bool isSpecialized() const noexcept { return _d->_spec != nullptr; }
+
+  //! Get the name of the program, null if it has no name.
+  MPSL_INLINE const char* getName() const noexcept { return _d->_name; }
+
+  //! Set the name of the program (null clears it), used by profilers that the
+  //! program is registered with, see `Context::setJitSymbols()`.
+  //!
+  //! The name belongs to the compiled program, so copies and programs found in
+  //! the program cache share it. Compiling the program again clears it.
+  MPSL_API Error setName(const char* name) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Stats]
+  // --------------------------------------------------------------------------
+
+  //! Get execution statistics of the program compiled with `kOptionCountRuns`
+  //! or `kOptionCountCycles`, `kErrorInvalidState` is returned otherwise.
+  //!
+  //! Counters of all threads are summed, a run that is in progress may or may
+  //! not be included. Like the name, counters belong to the compiled program,
+  //! so copies and programs found in the program cache share them.
+  MPSL_API Error getStats(Stats& out) const noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Serialize]
+  // --------------------------------------------------------------------------
+
+  //! Get the size of the blob created by `serialize()`, zero if the program
+  //! can't be serialized.
+  MPSL_API size_t getSerializedSize() const noexcept;
+
+  //! Serialize the machine code of the variant the program runs into `dst`,
+  //! which must have at least `getSerializedSize()` bytes.
+  //!
+  //! The blob records the MPSL version, options, a hash of layouts, and CPU
+  //! features the code uses, and can be loaded by `Program1::load()` (and
+  //! others) instead of compiling the program again. Programs are only
+  //! serializable on X64, where the code (including its constant pool) is
+  //! position independent, `kErrorInvalidState` is returned otherwise. Loaded
+  //! programs can't be respecialized.
+  MPSL_API Error serialize(void* dst, size_t dstSize) const noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Respecialize]
+  // --------------------------------------------------------------------------
+
+  //! \internal
+  //!
+  //! Compile the program again with new values of members bound at compile
+  //! time, see `Program1::respecialize()`.
+  MPSL_API Error _respecialize(Context& context, const void* const* values, OutputLog* log) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Run]
+  // --------------------------------------------------------------------------
+
+  //! \internal
+  //!
+  //! Split `count` records into chunks and run them by the batch entry-point
+  //! on all workers of `pool`, see `Program1::runParallel()`.
+  MPSL_API Error _runParallel(void** args, const intptr_t* strides, size_t count, ThreadPool* pool) const noexcept;
+
+  //! \internal
+  //!
+  //! Enter a run of the program, see `RunScope`.
+  MPSL_API static void* _enterRun() noexcept;
+  //! \internal
+  //!
+  //! Leave a run of the program entered by `_enterRun()`.
+  MPSL_API static void _leaveRun(void* counter) noexcept;
+
+  //! \internal
+  //!
+  //! Scope of a run of the program. Code of programs released while any scope
+  //! is active is only freed after the scope ends, so a program can be swapped
+  //! or compiled again while other threads run it, see `swap()`.
+  struct RunScope {
+    MPSL_NONCOPYABLE(RunScope)
+
+    MPSL_INLINE RunScope() noexcept : _counter(Program::_enterRun()) {}
+    MPSL_INLINE ~RunScope() noexcept { Program::_leaveRun(_counter); }
+
+    void* _counter;
+  };
+
+  // --------------------------------------------------------------------------
+  // [Reclaim]
+  // --------------------------------------------------------------------------
+
+  //! Free code of released programs that no thread runs anymore and return
+  //! the number of programs that are still waiting.
+  //!
+  //! Code of a released program is freed after all runs that started before
+  //! it was released have finished. This is checked when another program is
+  //! released, calling `reclaim()` frees the code without waiting for it.
+  MPSL_API static size_t reclaim() noexcept;
+
   // --------------------------------------------------------------------------
   // [Operator Overload]
   // --------------------------------------------------------------------------
@@ -859,6 +1662,14 @@ struct Program {
 protected:
   MPSL_API Program& operator=(const Program& other) noexcept;
 
+  //! Replace the program by `other` and pass the replaced program to `other`.
+  //!
+  //! The program is replaced by a single atomic exchange, so other threads can
+  //! run it meanwhile - a run uses either the replaced or the new program and
+  //! the code of the replaced one is freed after all runs that use it have
+  //! finished. `other` must not be used by other threads.
+  MPSL_API void swap(Program& other) noexcept;
+
 public:
   //! Equality, only true if `other` is the same weak-copy of the program.
   MPSL_INLINE bool operator==(const Program& other) const noexcept { return _d == other._d; }
@@ -903,58 +1714,288 @@ struct Program1 : public Program {
     return context._compile(*this, args, log);
   }
 
-  MPSL_INLINE Error run(T0* a0) const noexcept {
-    return _d->_main1((void*)a0);
-  }
+  //! Compile stages of `pipeline` into a single function, see `Pipeline`.
+  MPSL_INLINE Error compile(Context& context, const Pipeline& pipeline, uint32_t options,
+    const Layout& layout0,
+    OutputLog* log = nullptr) noexcept {
 
-  MPSL_INLINE Program1& operator=(const Program1& other) noexcept {
-    Program::operator=(other);
-    return *this;
+    Context::CompileArgs args(nullptr, 0, options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.pipeline = &pipeline;
+    return context._compile(*this, args, log);
   }
-};
 
-// ============================================================================
-// [mpsl::Program2<T1, T2>]
-// ============================================================================
+  //! Start compiling the program by `pool` and return immediately, the result
+  //! is retrieved by `job.wait()`, which assigns the compiled program.
+  //!
+  //! The program is compiled by a single `ThreadPool::post()` call, so it is
+  //! compiled synchronously if `pool` is null or doesn't override `post()`.
+  //! `log` is called from the thread that compiles the program and must stay
+  //! alive until the job is ready. Programs that have members bound at compile
+  //! time can't be compiled asynchronously (the job fails with
+  //! `kErrorInvalidArgument`). Errors that prevent the job from starting are
+  //! returned immediately.
+  static MPSL_INLINE Error compileAsync(CompileJob& job, Context& context, const char* body, uint32_t options,
+    const Layout& layout0,
+    ThreadPool* pool,
+    OutputLog* log = nullptr) noexcept {
 
-template<typename T0 = void, typename T1 = void>
-struct Program2 : public Program {
-  enum { kNumArgs = 2 };
+    Context::CompileArgs args(body, Globals::kInvalidIndex, options, kNumArgs);
+    args.layout[0] = &layout0;
+    return context._compileAsync(job, args, pool, log);
+  }
 
-  MPSL_INLINE Program2() noexcept : Program() {}
-  MPSL_INLINE Program2(const Program2& other) noexcept : Program(other) {}
-  MPSL_INLINE ~Program2() noexcept {}
+  //! \overload
+  static MPSL_INLINE Error compileAsync(CompileJob& job, Context& context, const StringRef& body, uint32_t options,
+    const Layout& layout0,
+    ThreadPool* pool,
+    OutputLog* log = nullptr) noexcept {
 
-  MPSL_INLINE Error compile(Context& context, const char* body, uint32_t options,
+    Context::CompileArgs args(body.getData(), body.getLength(), options, kNumArgs);
+    args.layout[0] = &layout0;
+    return context._compileAsync(job, args, pool, log);
+  }
+
+  //! Compile the program and bind members marked as `kTypeBind` to values
+  //! read from `values0`, which has the same layout as the data passed to
+  //! `run()`. Bound members become constants of the compiled program.
+  MPSL_INLINE Error compileBound(Context& context, const char* body, uint32_t options,
     const Layout& layout0,
-    const Layout& layout1,
+    const T0* values0,
     OutputLog* log = nullptr) noexcept {
 
     Context::CompileArgs args(body, Globals::kInvalidIndex, options, kNumArgs);
     args.layout[0] = &layout0;
-    args.layout[1] = &layout1;
+    args.values[0] = values0;
     return context._compile(*this, args, log);
   }
 
-  MPSL_INLINE Error compile(Context& context, const StringRef& body, uint32_t options,
+  //! \overload
+  MPSL_INLINE Error compileBound(Context& context, const StringRef& body, uint32_t options,
     const Layout& layout0,
-    const Layout& layout1,
+    const T0* values0,
     OutputLog* log = nullptr) noexcept {
 
     Context::CompileArgs args(body.getData(), body.getLength(), options, kNumArgs);
     args.layout[0] = &layout0;
-    args.layout[1] = &layout1;
+    args.values[0] = values0;
     return context._compile(*this, args, log);
   }
 
-  MPSL_INLINE Error run(T0* a0, T1* a1) const noexcept {
-    return _d->_main2((void*)a0, (void*)a1);
+  //! Compile the program again with new values of its bound members.
+  //!
+  //! The program keeps its source and layouts after it has been compiled with
+  //! bound members, so neither has to be passed again. Values that have been
+  //! compiled before are found in the program cache instead of compiling the
+  //! program again, so calling `respecialize()` each frame is cheap if values
+  //! don't change often. Returns `kErrorInvalidState` if the program has no
+  //! bound members, see `isSpecialized()`.
+  MPSL_INLINE Error respecialize(Context& context, const T0* values0, OutputLog* log = nullptr) noexcept {
+    const void* values[kNumArgs] = { (const void*)values0 };
+    return _respecialize(context, values, log);
   }
 
-  MPSL_INLINE Program2& operator=(const Program2& other) noexcept {
+  //! Load a program serialized by `Program::serialize()`.
+  //!
+  //! Layouts must be equal to layouts the program was compiled with (except
+  //! values of bound members, which are part of the code). A blob that doesn't
+  //! match them, the MPSL version, or the host CPU is rejected by returning
+  //! `kErrorInvalidBlob`, it never runs.
+  MPSL_INLINE Error load(Context& context, const void* blob, size_t size,
+    const Layout& layout0) noexcept {
+
+    const Layout* layouts[kNumArgs] = { &layout0 };
+    return context._loadProgram(*this, blob, size, kNumArgs, layouts);
+  }
+
+  MPSL_INLINE Error run(T0* a0) const noexcept {
+    RunScope scope;
+    return _d->_main1((void*)a0);
+  }
+
+  //! Run the program `count` times, advancing `a0` by `stride0` bytes after
+  //! each run. The loop is part of the compiled code so the setup required by
+  //! the program (like loading the constant pool) is done only once.
+  //!
+  //! If the program uses a SoA `Layout` then `count` is the number of column
+  //! elements to process (rounded up to `Globals::kLaneCount`), the passed
+  //! data is not advanced and strides are ignored.
+  MPSL_INLINE Error runBatch(T0* a0, size_t count, intptr_t stride0) const noexcept {
+    void* args[kNumArgs] = { (void*)a0 };
+    intptr_t strides[kNumArgs] = { stride0 };
+    RunScope scope;
+    return _d->_batch(args, strides, 0, count);
+  }
+
+  //! Run the program over `count` records like `runBatch()`, but split the
+  //! records into chunks that are executed in parallel by all workers of
+  //! `pool`. Chunks are aligned to 64 records so two workers never write into
+  //! the same cache line if the data is aligned. Workers that finish their
+  //! chunks steal chunks of others. If `pool` is null or the batch is small
+  //! the program runs on the calling thread.
+  MPSL_INLINE Error runParallel(T0* a0, size_t count, intptr_t stride0, ThreadPool* pool) const noexcept {
+    void* args[kNumArgs] = { (void*)a0 };
+    intptr_t strides[kNumArgs] = { stride0 };
+    return _runParallel(args, strides, count, pool);
+  }
+
+  MPSL_INLINE Program1& operator=(const Program1& other) noexcept {
     Program::operator=(other);
     return *this;
   }
+
+  //! Replace the program by `other` while other threads run it, see `Program::swap()`.
+  MPSL_INLINE void swap(Program1& other) noexcept { Program::swap(other); }
+};
+
+// ============================================================================
+// [mpsl::Program2<T1, T2>]
+// ============================================================================
+
+template<typename T0 = void, typename T1 = void>
+struct Program2 : public Program {
+  enum { kNumArgs = 2 };
+
+  MPSL_INLINE Program2() noexcept : Program() {}
+  MPSL_INLINE Program2(const Program2& other) noexcept : Program(other) {}
+  MPSL_INLINE ~Program2() noexcept {}
+
+  MPSL_INLINE Error compile(Context& context, const char* body, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(body, Globals::kInvalidIndex, options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    return context._compile(*this, args, log);
+  }
+
+  MPSL_INLINE Error compile(Context& context, const StringRef& body, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(body.getData(), body.getLength(), options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    return context._compile(*this, args, log);
+  }
+
+  //! Compile stages of `pipeline` into a single function, see `Pipeline`.
+  MPSL_INLINE Error compile(Context& context, const Pipeline& pipeline, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(nullptr, 0, options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    args.pipeline = &pipeline;
+    return context._compile(*this, args, log);
+  }
+
+  //! Start compiling the program by `pool`, see `Program1::compileAsync()`.
+  static MPSL_INLINE Error compileAsync(CompileJob& job, Context& context, const char* body, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    ThreadPool* pool,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(body, Globals::kInvalidIndex, options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    return context._compileAsync(job, args, pool, log);
+  }
+
+  //! \overload
+  static MPSL_INLINE Error compileAsync(CompileJob& job, Context& context, const StringRef& body, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    ThreadPool* pool,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(body.getData(), body.getLength(), options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    return context._compileAsync(job, args, pool, log);
+  }
+
+  //! Compile the program and bind members marked as `kTypeBind`, see
+  //! `Program1::compileBound()`.
+  MPSL_INLINE Error compileBound(Context& context, const char* body, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    const T0* values0,
+    const T1* values1,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(body, Globals::kInvalidIndex, options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    args.values[0] = values0;
+    args.values[1] = values1;
+    return context._compile(*this, args, log);
+  }
+
+  //! \overload
+  MPSL_INLINE Error compileBound(Context& context, const StringRef& body, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    const T0* values0,
+    const T1* values1,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(body.getData(), body.getLength(), options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    args.values[0] = values0;
+    args.values[1] = values1;
+    return context._compile(*this, args, log);
+  }
+
+  //! \overload
+  MPSL_INLINE Error respecialize(Context& context, const T0* values0, const T1* values1, OutputLog* log = nullptr) noexcept {
+    const void* values[kNumArgs] = { (const void*)values0, (const void*)values1 };
+    return _respecialize(context, values, log);
+  }
+
+  //! \overload
+  MPSL_INLINE Error load(Context& context, const void* blob, size_t size,
+    const Layout& layout0,
+    const Layout& layout1) noexcept {
+
+    const Layout* layouts[kNumArgs] = { &layout0, &layout1 };
+    return context._loadProgram(*this, blob, size, kNumArgs, layouts);
+  }
+
+  MPSL_INLINE Error run(T0* a0, T1* a1) const noexcept {
+    RunScope scope;
+    return _d->_main2((void*)a0, (void*)a1);
+  }
+
+  //! \overload
+  MPSL_INLINE Error runBatch(T0* a0, T1* a1, size_t count, intptr_t stride0, intptr_t stride1) const noexcept {
+    void* args[kNumArgs] = { (void*)a0, (void*)a1 };
+    intptr_t strides[kNumArgs] = { stride0, stride1 };
+    RunScope scope;
+    return _d->_batch(args, strides, 0, count);
+  }
+
+  //! \overload
+  MPSL_INLINE Error runParallel(T0* a0, T1* a1, size_t count, intptr_t stride0, intptr_t stride1, ThreadPool* pool) const noexcept {
+    void* args[kNumArgs] = { (void*)a0, (void*)a1 };
+    intptr_t strides[kNumArgs] = { stride0, stride1 };
+    return _runParallel(args, strides, count, pool);
+  }
+
+  MPSL_INLINE Program2& operator=(const Program2& other) noexcept {
+    Program::operator=(other);
+    return *this;
+  }
+
+  //! Replace the program by `other` while other threads run it, see `Program::swap()`.
+  MPSL_INLINE void swap(Program2& other) noexcept { Program::swap(other); }
 };
 
 // ============================================================================
@@ -995,14 +2036,135 @@ struct Program3 : public Program {
     return context._compile(*this, args, log);
   }
 
+  //! Compile stages of `pipeline` into a single function, see `Pipeline`.
+  MPSL_INLINE Error compile(Context& context, const Pipeline& pipeline, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    const Layout& layout2,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(nullptr, 0, options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    args.layout[2] = &layout2;
+    args.pipeline = &pipeline;
+    return context._compile(*this, args, log);
+  }
+
+  //! Start compiling the program by `pool`, see `Program1::compileAsync()`.
+  static MPSL_INLINE Error compileAsync(CompileJob& job, Context& context, const char* body, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    const Layout& layout2,
+    ThreadPool* pool,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(body, Globals::kInvalidIndex, options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    args.layout[2] = &layout2;
+    return context._compileAsync(job, args, pool, log);
+  }
+
+  //! \overload
+  static MPSL_INLINE Error compileAsync(CompileJob& job, Context& context, const StringRef& body, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    const Layout& layout2,
+    ThreadPool* pool,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(body.getData(), body.getLength(), options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    args.layout[2] = &layout2;
+    return context._compileAsync(job, args, pool, log);
+  }
+
+  //! Compile the program and bind members marked as `kTypeBind`, see
+  //! `Program1::compileBound()`.
+  MPSL_INLINE Error compileBound(Context& context, const char* body, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    const Layout& layout2,
+    const T1* values0,
+    const T2* values1,
+    const T3* values2,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(body, Globals::kInvalidIndex, options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    args.layout[2] = &layout2;
+    args.values[0] = values0;
+    args.values[1] = values1;
+    args.values[2] = values2;
+    return context._compile(*this, args, log);
+  }
+
+  //! \overload
+  MPSL_INLINE Error compileBound(Context& context, const StringRef& body, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    const Layout& layout2,
+    const T1* values0,
+    const T2* values1,
+    const T3* values2,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(body.getData(), body.getLength(), options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    args.layout[2] = &layout2;
+    args.values[0] = values0;
+    args.values[1] = values1;
+    args.values[2] = values2;
+    return context._compile(*this, args, log);
+  }
+
+  //! \overload
+  MPSL_INLINE Error respecialize(Context& context, const T1* values0, const T2* values1, const T3* values2, OutputLog* log = nullptr) noexcept {
+    const void* values[kNumArgs] = { (const void*)values0, (const void*)values1, (const void*)values2 };
+    return _respecialize(context, values, log);
+  }
+
+  //! \overload
+  MPSL_INLINE Error load(Context& context, const void* blob, size_t size,
+    const Layout& layout0,
+    const Layout& layout1,
+    const Layout& layout2) noexcept {
+
+    const Layout* layouts[kNumArgs] = { &layout0, &layout1, &layout2 };
+    return context._loadProgram(*this, blob, size, kNumArgs, layouts);
+  }
+
   MPSL_INLINE Error run(T1* a1, T2* a2, T3* a3) const noexcept {
+    RunScope scope;
     return _d->_main3((void*)a1, (void*)a2, (void*)a3);
   }
 
+  //! \overload
+  MPSL_INLINE Error runBatch(T1* a1, T2* a2, T3* a3, size_t count, intptr_t stride1, intptr_t stride2, intptr_t stride3) const noexcept {
+    void* args[kNumArgs] = { (void*)a1, (void*)a2, (void*)a3 };
+    intptr_t strides[kNumArgs] = { stride1, stride2, stride3 };
+    RunScope scope;
+    return _d->_batch(args, strides, 0, count);
+  }
+
+  //! \overload
+  MPSL_INLINE Error runParallel(T1* a1, T2* a2, T3* a3, size_t count, intptr_t stride1, intptr_t stride2, intptr_t stride3, ThreadPool* pool) const noexcept {
+    void* args[kNumArgs] = { (void*)a1, (void*)a2, (void*)a3 };
+    intptr_t strides[kNumArgs] = { stride1, stride2, stride3 };
+    return _runParallel(args, strides, count, pool);
+  }
+
   MPSL_INLINE Program3& operator=(const Program3& other) noexcept {
     Program::operator=(other);
     return *this;
   }
+
+  //! Replace the program by `other` while other threads run it, see `Program::swap()`.
+  MPSL_INLINE void swap(Program3& other) noexcept { Program::swap(other); }
 };
 
 // ============================================================================
@@ -1047,14 +2209,261 @@ struct Program4 : public Program {
     return context._compile(*this, args, log);
   }
 
+  //! Compile stages of `pipeline` into a single function, see `Pipeline`.
+  MPSL_INLINE Error compile(Context& context, const Pipeline& pipeline, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    const Layout& layout2,
+    const Layout& layout3,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(nullptr, 0, options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    args.layout[2] = &layout2;
+    args.layout[3] = &layout3;
+    args.pipeline = &pipeline;
+    return context._compile(*this, args, log);
+  }
+
+  //! Start compiling the program by `pool`, see `Program1::compileAsync()`.
+  static MPSL_INLINE Error compileAsync(CompileJob& job, Context& context, const char* body, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    const Layout& layout2,
+    const Layout& layout3,
+    ThreadPool* pool,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(body, Globals::kInvalidIndex, options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    args.layout[2] = &layout2;
+    args.layout[3] = &layout3;
+    return context._compileAsync(job, args, pool, log);
+  }
+
+  //! \overload
+  static MPSL_INLINE Error compileAsync(CompileJob& job, Context& context, const StringRef& body, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    const Layout& layout2,
+    const Layout& layout3,
+    ThreadPool* pool,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(body.getData(), body.getLength(), options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    args.layout[2] = &layout2;
+    args.layout[3] = &layout3;
+    return context._compileAsync(job, args, pool, log);
+  }
+
+  //! Compile the program and bind members marked as `kTypeBind`, see
+  //! `Program1::compileBound()`.
+  MPSL_INLINE Error compileBound(Context& context, const char* body, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    const Layout& layout2,
+    const Layout& layout3,
+    const T1* values0,
+    const T2* values1,
+    const T3* values2,
+    const T4* values3,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(body, Globals::kInvalidIndex, options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    args.layout[2] = &layout2;
+    args.layout[3] = &layout3;
+    args.values[0] = values0;
+    args.values[1] = values1;
+    args.values[2] = values2;
+    args.values[3] = values3;
+    return context._compile(*this, args, log);
+  }
+
+  //! \overload
+  MPSL_INLINE Error compileBound(Context& context, const StringRef& body, uint32_t options,
+    const Layout& layout0,
+    const Layout& layout1,
+    const Layout& layout2,
+    const Layout& layout3,
+    const T1* values0,
+    const T2* values1,
+    const T3* values2,
+    const T4* values3,
+    OutputLog* log = nullptr) noexcept {
+
+    Context::CompileArgs args(body.getData(), body.getLength(), options, kNumArgs);
+    args.layout[0] = &layout0;
+    args.layout[1] = &layout1;
+    args.layout[2] = &layout2;
+    args.layout[3] = &layout3;
+    args.values[0] = values0;
+    args.values[1] = values1;
+    args.values[2] = values2;
+    args.values[3] = values3;
+    return context._compile(*this, args, log);
+  }
+
+  //! \overload
+  MPSL_INLINE Error respecialize(Context& context, const T1* values0, const T2* values1, const T3* values2, const T4* values3, OutputLog* log = nullptr) noexcept {
+    const void* values[kNumArgs] = { (const void*)values0, (const void*)values1, (const void*)values2, (const void*)values3 };
+    return _respecialize(context, values, log);
+  }
+
+  //! \overload
+  MPSL_INLINE Error load(Context& context, const void* blob, size_t size,
+    const Layout& layout0,
+    const Layout& layout1,
+    const Layout& layout2,
+    const Layout& layout3) noexcept {
+
+    const Layout* layouts[kNumArgs] = { &layout0, &layout1, &layout2, &layout3 };
+    return context._loadProgram(*this, blob, size, kNumArgs, layouts);
+  }
+
   MPSL_INLINE Error run(T1* a1, T2* a2, T3* a3, T4* a4) const noexcept {
+    RunScope scope;
     return _d->_main4((void*)a1, (void*)a2, (void*)a3, (void*)a4);
   }
 
+  //! \overload
+  MPSL_INLINE Error runBatch(T1* a1, T2* a2, T3* a3, T4* a4, size_t count, intptr_t stride1, intptr_t stride2, intptr_t stride3, intptr_t stride4) const noexcept {
+    void* args[kNumArgs] = { (void*)a1, (void*)a2, (void*)a3, (void*)a4 };
+    intptr_t strides[kNumArgs] = { stride1, stride2, stride3, stride4 };
+    RunScope scope;
+    return _d->_batch(args, strides, 0, count);
+  }
+
+  //! \overload
+  MPSL_INLINE Error runParallel(T1* a1, T2* a2, T3* a3, T4* a4, size_t count, intptr_t stride1, intptr_t stride2, intptr_t stride3, intptr_t stride4, ThreadPool* pool) const noexcept {
+    void* args[kNumArgs] = { (void*)a1, (void*)a2, (void*)a3, (void*)a4 };
+    intptr_t strides[kNumArgs] = { stride1, stride2, stride3, stride4 };
+    return _runParallel(args, strides, count, pool);
+  }
+
   MPSL_INLINE Program4& operator=(const Program4& other) noexcept {
     Program::operator=(other);
     return *this;
   }
+
+  //! Replace the program by `other` while other threads run it, see `Program::swap()`.
+  MPSL_INLINE void swap(Program4& other) noexcept { Program::swap(other); }
+};
+
+// ============================================================================
+// [mpsl::CompileJob]
+// ============================================================================
+
+//! A handle of a program compiled in the background, see `Program1::compileAsync()`.
+//!
+//! The job keeps its own copy of the source and layouts, so neither has to
+//! outlive it. It also keeps the context alive, so the job can outlive the
+//! handle of the context it was started by.
+struct CompileJob {
+  // --------------------------------------------------------------------------
+  // [Impl]
+  // --------------------------------------------------------------------------
+
+  //! \internal
+  //!
+  //! Implemented in `mpsl.cpp`.
+  struct Impl;
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  //! Create a job that has not been started.
+  MPSL_API CompileJob() noexcept;
+  //! Create a weak-copy of `other` job.
+  MPSL_API CompileJob(const CompileJob& other) noexcept;
+  //! Destroy the job handle, the compilation continues if it's still running.
+  MPSL_API ~CompileJob() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Reset]
+  // --------------------------------------------------------------------------
+
+  MPSL_API Error reset() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  //! Get whether the job has been started.
+  MPSL_API bool isValid() const noexcept;
+  //! Get whether the compilation finished, `wait()` doesn't block if true.
+  MPSL_API bool isReady() const noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Wait]
+  // --------------------------------------------------------------------------
+
+  //! Wait for the compilation to finish and return its result. The compiled
+  //! program is assigned to `program` on success, which must have the same
+  //! prototype as the program the job was started by. Can be called multiple
+  //! times, the result doesn't change. Returns `kErrorInvalidState` if the job
+  //! has not been started.
+  MPSL_API Error wait(Program& program) const noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Operator Overload]
+  // --------------------------------------------------------------------------
+
+  //! Assign a weak-copy of `other` job.
+  MPSL_API CompileJob& operator=(const CompileJob& other) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  //! Job data (private).
+  Impl* _d;
+};
+
+// ============================================================================
+// [mpsl::ThreadPool]
+// ============================================================================
+
+//! Interface of a thread pool used by `Program::runParallel()`.
+//!
+//! MPSL doesn't create threads, the embedder implements this interface on top
+//! of its own thread pool (or creates threads on demand).
+struct MPSL_VIRTAPI ThreadPool {
+  //! Work function called by \ref ThreadPool::run().
+  typedef void (MPSL_CDECL *WorkFunc)(void* data, uint32_t workerId);
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  MPSL_API ThreadPool() noexcept;
+  MPSL_API virtual ~ThreadPool() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Interface]
+  // --------------------------------------------------------------------------
+
+  //! Get the number of workers that can run concurrently (including the
+  //! calling thread if it participates in `run()`).
+  virtual uint32_t getWorkersCount() const noexcept = 0;
+
+  //! Call `func(data, workerId)` once for each `workerId` in `[0, count)` and
+  //! return after all calls returned. The calls should run concurrently, but
+  //! the scheduler doesn't depend on it.
+  virtual void run(WorkFunc func, void* data, uint32_t count) noexcept = 0;
+
+  //! Call `func(data, workerId)` once, used by `compileAsync()` to compile a
+  //! program in the background. The call should run on a worker and `post()`
+  //! should return without waiting for it. The default implementation calls
+  //! `func(data, 0)` on the calling thread, so a pool that doesn't override it
+  //! compiles synchronously.
+  virtual void post(WorkFunc func, void* data) noexcept;
 };
 
 // ============================================================================
@@ -1068,7 +2477,38 @@ struct MPSL_VIRTAPI OutputLog {
     kMessageError   = 0,                 //!< Error message.
     kMessageWarning = 1,                 //!< Warning message.
     kMessageDebug   = 2,                 //!< Debug message.
-    kMessageDump    = 3                  //!< MPSL dump (AST, IR, or ASM).
+    kMessageDump    = 3,                 //!< MPSL dump (AST, IR, or ASM).
+    kMessageProfile = 4                  //!< Statistics of a compiler stage.
+  };
+
+  //! Compiler stage measured by `kOptionProfile`, see \ref Profile.
+  enum ProfileStage {
+    kProfileParse        = 0,            //!< Parser (and setup of built-in symbols).
+    kProfileAnalysis     = 1,            //!< AST semantic analysis.
+    kProfileAstOptimizer = 2,            //!< AST optimizer.
+    kProfileCodeGen      = 3,            //!< Translation of AST to IR.
+    kProfileIRPass       = 4,            //!< IR lowering and optimization passes.
+    kProfileX86          = 5,            //!< Translation of IR to machine code.
+    kProfileFinalize     = 6,            //!< Register allocation and relocation.
+    kProfileTotal        = 7,            //!< The whole compilation.
+    kProfileCount        = 8             //!< Count of profiled stages.
+  };
+
+  //! Statistics of a compiler stage, sent by `kOptionProfile`.
+  //!
+  //! Counts are measured at the end of the stage. Stages after `kProfileIRPass`
+  //! run once per compiled variant (see `kOptionMultiVersion`), and only they
+  //! provide code sizes.
+  struct Profile {
+    uint32_t stage;                      //!< Compiler stage, see \ref ProfileStage.
+    uint32_t variant;                    //!< Variant compiled or run, see \ref Variant.
+    uint64_t time;                       //!< Wall time of the stage (in nanoseconds).
+    uint64_t zoneUsed;                   //!< Bytes allocated by the compiler's zone.
+    uint32_t astNodeCount;               //!< Number of AST nodes.
+    uint32_t irInstCount;                //!< Number of IR instructions (all functions).
+    uint32_t irBlockCount;               //!< Number of IR blocks (all functions).
+    uint32_t codeSize;                   //!< Size of the machine code (in bytes).
+    uint32_t constPoolSize;              //!< Size of constant pools (in bytes).
   };
 
   //! Output message data.
@@ -1078,18 +2518,21 @@ struct MPSL_VIRTAPI OutputLog {
       uint32_t line,
       uint32_t column,
       const StringRef& header,
-      const StringRef& content) noexcept
+      const StringRef& content,
+      const Profile* profile = nullptr) noexcept
       : _type(type),
         _line(line),
         _column(column),
         _reserved(0),
         _header(header),
-        _content(content) {}
+        _content(content),
+        _profile(profile) {}
 
     MPSL_INLINE bool isError() const noexcept { return _type == kMessageError; }
     MPSL_INLINE bool isWarning() const noexcept { return _type == kMessageWarning; }
     MPSL_INLINE bool isDebug() const noexcept { return _type == kMessageDebug; }
     MPSL_INLINE bool isDump() const noexcept { return _type == kMessageDump; }
+    MPSL_INLINE bool isProfile() const noexcept { return _type == kMessageProfile; }
 
     //! Get if the message contains a source code position (line and column).
     MPSL_INLINE bool hasPosition() const noexcept { return _line != 0; }
@@ -1103,6 +2546,9 @@ struct MPSL_VIRTAPI OutputLog {
 
     MPSL_INLINE const StringRef& getHeader() const noexcept { return _header; }
     MPSL_INLINE const StringRef& getContent() const noexcept { return _content; }
+    //! Get statistics of a `kMessageProfile` message, null otherwise. The
+    //! content contains the same statistics formatted as text.
+    MPSL_INLINE const Profile* getProfile() const noexcept { return _profile; }
 
     uint32_t _type;
     uint32_t _line;
@@ -1111,6 +2557,7 @@ struct MPSL_VIRTAPI OutputLog {
 
     StringRef _header;
     StringRef _content;
+    const Profile* _profile;
   };
 
   // --------------------------------------------------------------------------
@@ -10,6 +10,7 @@
 
 // [Dependencies - MPSL]
 #include "./mpsl.h"
+#include "./mpatomic_p.h"
 
 // [Dependencies - C]
 #include <math.h>
@@ -36,6 +37,18 @@
 # include <emmintrin.h>
 #endif
 
+// [Dependencies - Backend]
+//
+// Native code is only generated for X86/X64 by `IRToX86`, which requires the
+// X86 compiler of asmjit, see `kErrorUnsupportedTarget`.
+#if !defined(MPSL_BUILD_X86)
+# if MPSL_ARCH_X86 || MPSL_ARCH_X64
+#  define MPSL_BUILD_X86 1
+# else
+#  define MPSL_BUILD_X86 0
+# endif
+#endif
+
 // [Api-Begin]
 #include "./mpsl_apibegin.h"
 
@@ -135,6 +148,26 @@ static const uint32_t kB32_1 = 0xFFFFFFFFU;
 static const uint64_t kB64_0 = ASMJIT_UINT64_C(0x0000000000000000);
 static const uint64_t kB64_1 = ASMJIT_UINT64_C(0xFFFFFFFFFFFFFFFF);
 
+//! \internal
+//!
+//! Get index of the first bit set in `x`, which must not be zero.
+static MPSL_INLINE uint32_t mpBitCtz(uint32_t x) noexcept {
+#if MPSL_CC_MSC_GE(14, 0, 0) && (MPSL_ARCH_X86 || MPSL_ARCH_X64 || MPSL_ARCH_ARM32 || MPSL_ARCH_ARM64)
+  unsigned long i;
+  _BitScanForward(&i, x);
+  return static_cast<uint32_t>(i);
+#elif MPSL_CC_GCC_GE(3, 4, 6) || MPSL_CC_CLANG
+  return static_cast<uint32_t>(__builtin_ctz(x));
+#else
+  uint32_t i = 0;
+  while ((x & 1) == 0) {
+    x >>= 1;
+    i++;
+  }
+  return i;
+#endif
+}
+
 // ============================================================================
 // [mpsl::InternalOptions]
 // ============================================================================
@@ -147,6 +180,144 @@ enum InternalOptions {
   kInternalOptionLog = 0x10000000
 };
 
+// ============================================================================
+// [mpsl::ReduceOp]
+// ============================================================================
+
+//! \internal
+//!
+//! Reduction of a member, see `kTypeReduceSum`.
+enum ReduceOp {
+  kReduceNone = 0,
+  kReduceSum = 1,
+  kReduceMin = 2,
+  kReduceMax = 3,
+  kReduceCount = 4
+};
+
+//! \internal
+//!
+//! Get \ref ReduceOp of a member described by `typeInfo`.
+static MPSL_INLINE uint32_t mpReduceOpOf(uint32_t typeInfo) noexcept {
+  return (typeInfo & kTypeReduceMask) >> 22;
+}
+
+// ============================================================================
+// [mpsl::FpEnv]
+// ============================================================================
+
+//! \internal
+//!
+//! Bits of MXCSR (X86/X64) that describe the floating-point environment of a
+//! program, `kOptionRound...` follow the encoding of its rounding control.
+enum MxcsrBits {
+  kMxcsrDAZ = 0x0040,
+  kMxcsrRoundShift = 13,
+  kMxcsrRoundMask = 0x6000,
+  kMxcsrFTZ = 0x8000,
+
+  //! Bits set from options, other bits are kept as set by the caller.
+  kMxcsrEnvMask = kMxcsrDAZ | kMxcsrRoundMask | kMxcsrFTZ
+};
+
+//! \internal
+//!
+//! Get whether `options` change the floating-point environment of a program.
+static MPSL_INLINE bool mpHasFpEnv(uint32_t options) noexcept {
+  return (options & (kOptionFlushDenormals | kOptionRoundMask)) != 0;
+}
+
+//! \internal
+//!
+//! Get whether `options` allow AVX. AVX implies all SSE extensions, disabling
+//! any of them disables AVX as well.
+static MPSL_INLINE bool mpIsAVXAllowed(uint32_t options) noexcept {
+  return (options & (kOptionDisableSSE3   | kOptionDisableSSSE3  |
+                     kOptionDisableSSE4_1 | kOptionDisableSSE4_2 |
+                     kOptionDisableAVX)) == 0;
+}
+
+//! \internal
+//!
+//! Get bits of MXCSR (in `kMxcsrEnvMask`) selected by `options`.
+static MPSL_INLINE uint32_t mpMxcsrFromOptions(uint32_t options) noexcept {
+  uint32_t mxcsr = ((options & kOptionRoundMask) >> 17) << kMxcsrRoundShift;
+  if (options & kOptionFlushDenormals)
+    mxcsr |= kMxcsrDAZ | kMxcsrFTZ;
+  return mxcsr;
+}
+
+//! \internal
+//!
+//! Sets the floating-point environment selected by options for the lifetime
+//! of the scope, used by constant folding. Without SSE2 the host computes
+//! in the default environment.
+class FpEnvScope {
+public:
+  MPSL_NONCOPYABLE(FpEnvScope)
+
+  MPSL_INLINE explicit FpEnvScope(uint32_t options) noexcept
+    : _saved(0),
+      _active(mpHasFpEnv(options)) {
+#if MPSL_USE_SSE2
+    if (_active) {
+      _saved = _mm_getcsr();
+      _mm_setcsr((_saved & ~static_cast<uint32_t>(kMxcsrEnvMask)) | mpMxcsrFromOptions(options));
+    }
+#endif
+  }
+
+  MPSL_INLINE ~FpEnvScope() noexcept {
+#if MPSL_USE_SSE2
+    if (_active)
+      _mm_setcsr(_saved);
+#endif
+  }
+
+  uint32_t _saved;
+  bool _active;
+};
+
+// ============================================================================
+// [mpsl::ProgramCounters]
+// ============================================================================
+
+enum {
+  //! Log2 of the number of counter slots of a program.
+  kProgramCountersBits = 4,
+  //! Number of counter slots of a program.
+  kProgramCountersSlots = 1 << kProgramCountersBits,
+  //! Log2 of the size of `ProgramCounterSlot`.
+  kProgramCounterSlotShift = 6
+};
+
+//! \internal
+//!
+//! Counters of threads that share a slot, each slot has its own cache line.
+//! The compiled code picks the slot of a thread by its stack address (like
+//! `mpReclaimEnter()`) and updates it by locked instructions, as two threads
+//! can share a slot.
+struct ProgramCounterSlot {
+  uint64_t calls;
+  uint64_t records;
+  uint64_t cycles;
+  uint8_t padding[64 - 3 * sizeof(uint64_t)];
+};
+
+//! \internal
+//!
+//! Counters of a program compiled with `kOptionCountRuns`, see
+//! `Program::getStats()`.
+struct ProgramCounters {
+  //! Get the first slot, aligned to a cache line.
+  MPSL_INLINE ProgramCounterSlot* getSlots() noexcept {
+    uintptr_t p = (reinterpret_cast<uintptr_t>(_data) + 63) & ~static_cast<uintptr_t>(63);
+    return reinterpret_cast<ProgramCounterSlot*>(p);
+  }
+
+  uint8_t _data[(kProgramCountersSlots + 1) * sizeof(ProgramCounterSlot)];
+};
+
 // ============================================================================
 // [mpsl::mpAssertionFailed]
 // ============================================================================
@@ -181,7 +352,11 @@ public:
 
   MPSL_INLINE RuntimeData() noexcept
     : _refCount(1),
-      _runtime() {}
+      _runtime(),
+      _codeLimit(0),
+      _constPoolBytes(0),
+      _programCount(0),
+      _jitSymbols(0) {}
   MPSL_INLINE ~RuntimeData() noexcept {}
 
   // --------------------------------------------------------------------------
@@ -201,12 +376,60 @@ public:
     return const_cast<asmjit::JitRuntime*>(&_runtime);
   }
 
+  // --------------------------------------------------------------------------
+  // [Code]
+  // --------------------------------------------------------------------------
+
+  //! Add the code of `code` to the runtime, synchronized as `JitRuntime`
+  //! isn't thread-safe and programs can be compiled by multiple threads.
+  //! `constPoolSize` is the size of constants embedded in the code, only used
+  //! by `getMemoryStats()`.
+  //!
+  //! Fails with `kErrorNoMemory` if the code would exceed `_codeLimit`.
+  MPSL_INLINE Error add(void** dst, asmjit::CodeHolder* code, size_t constPoolSize) noexcept {
+    AutoSpinLock guard(_runtimeLock);
+
+    size_t used = _runtime.getMemMgr()->getUsedBytes();
+    if (_codeLimit != 0 && (used > _codeLimit || code->getCodeSize() > _codeLimit - used))
+      return MPSL_TRACE_ERROR(kErrorNoMemory);
+
+    if (_runtime.add(dst, code) != asmjit::kErrorOk)
+      return MPSL_TRACE_ERROR(kErrorJITFailed);
+
+    _constPoolBytes += constPoolSize;
+    return kErrorOk;
+  }
+
+  //! Release code added by `add()`.
+  MPSL_INLINE void release(void* p, size_t constPoolSize) noexcept {
+    AutoSpinLock guard(_runtimeLock);
+    _runtime.release(p);
+    _constPoolBytes -= constPoolSize;
+  }
+
+  //! Account a program created with code of this runtime.
+  MPSL_INLINE void attachProgram() noexcept {
+    AutoSpinLock guard(_runtimeLock);
+    _programCount++;
+  }
+
+  //! Account a program freed by `mpProgramFree()`.
+  MPSL_INLINE void detachProgram() noexcept {
+    AutoSpinLock guard(_runtimeLock);
+    _programCount--;
+  }
+
   // --------------------------------------------------------------------------
   // [Members]
   // --------------------------------------------------------------------------
 
   uintptr_t _refCount;                   //!< Reference count.
   asmjit::JitRuntime _runtime;           //!< JIT runtime.
+  SpinLock _runtimeLock;                 //!< Guards `_runtime` and all counters below.
+  size_t _codeLimit;                     //!< Maximum bytes of code used (0 if unlimited).
+  size_t _constPoolBytes;                //!< Bytes of constants embedded in the code.
+  uint32_t _programCount;                //!< Number of programs referencing the code.
+  uint32_t _jitSymbols;                  //!< Profilers new programs are registered with.
 };
 
 // ============================================================================
@@ -120,83 +120,371 @@ static const uint8_t mpCharClass[] = {
 static MPSL_INLINE uint32_t mpGetLower(uint32_t c) noexcept { return c | 0x20; }
 
 //! \internal
+//!
+//! Powers of 10 that are exactly representable by `double`.
 static const double mpPow10Table[] = {
   1e+0 , 1e+1 , 1e+2 , 1e+3 , 1e+4 , 1e+5 , 1e+6 , 1e+7 ,
-  1e+8 , 1e+9 , 1e+10, 1e+11, 1e+12, 1e+13, 1e+14, 1e+15
+  1e+8 , 1e+9 , 1e+10, 1e+11, 1e+12, 1e+13, 1e+14, 1e+15,
+  1e+16, 1e+17, 1e+18, 1e+19, 1e+20, 1e+21, 1e+22
 };
 
 //! \internal
-enum {
-  kSafeDigits = 15,
-  kPow10TableSize = static_cast<int>(MPSL_ARRAY_SIZE(mpPow10Table))
+//!
+//! 128-bit approximations of 5^q for `kPow5Min <= q <= kPow5Max`, normalized
+//! so the MSB is set, stored as pairs of high and low 64-bit words. Values of
+//! negative powers are rounded up, values of positive powers are truncated.
+static const uint64_t mpPow5Table[] = {
+  ASMJIT_UINT64_C(0xA87FEA27A539E9A5), ASMJIT_UINT64_C(0x3F2398D747B36224), // 5^-64
+  ASMJIT_UINT64_C(0xD29FE4B18E88640E), ASMJIT_UINT64_C(0x8EEC7F0D19A03AAD), // 5^-63
+  ASMJIT_UINT64_C(0x83A3EEEEF9153E89), ASMJIT_UINT64_C(0x1953CF68300424AC), // 5^-62
+  ASMJIT_UINT64_C(0xA48CEAAAB75A8E2B), ASMJIT_UINT64_C(0x5FA8C3423C052DD7), // 5^-61
+  ASMJIT_UINT64_C(0xCDB02555653131B6), ASMJIT_UINT64_C(0x3792F412CB06794D), // 5^-60
+  ASMJIT_UINT64_C(0x808E17555F3EBF11), ASMJIT_UINT64_C(0xE2BBD88BBEE40BD0), // 5^-59
+  ASMJIT_UINT64_C(0xA0B19D2AB70E6ED6), ASMJIT_UINT64_C(0x5B6ACEAEAE9D0EC4), // 5^-58
+  ASMJIT_UINT64_C(0xC8DE047564D20A8B), ASMJIT_UINT64_C(0xF245825A5A445275), // 5^-57
+  ASMJIT_UINT64_C(0xFB158592BE068D2E), ASMJIT_UINT64_C(0xEED6E2F0F0D56712), // 5^-56
+  ASMJIT_UINT64_C(0x9CED737BB6C4183D), ASMJIT_UINT64_C(0x55464DD69685606B), // 5^-55
+  ASMJIT_UINT64_C(0xC428D05AA4751E4C), ASMJIT_UINT64_C(0xAA97E14C3C26B886), // 5^-54
+  ASMJIT_UINT64_C(0xF53304714D9265DF), ASMJIT_UINT64_C(0xD53DD99F4B3066A8), // 5^-53
+  ASMJIT_UINT64_C(0x993FE2C6D07B7FAB), ASMJIT_UINT64_C(0xE546A8038EFE4029), // 5^-52
+  ASMJIT_UINT64_C(0xBF8FDB78849A5F96), ASMJIT_UINT64_C(0xDE98520472BDD033), // 5^-51
+  ASMJIT_UINT64_C(0xEF73D256A5C0F77C), ASMJIT_UINT64_C(0x963E66858F6D4440), // 5^-50
+  ASMJIT_UINT64_C(0x95A8637627989AAD), ASMJIT_UINT64_C(0xDDE7001379A44AA8), // 5^-49
+  ASMJIT_UINT64_C(0xBB127C53B17EC159), ASMJIT_UINT64_C(0x5560C018580D5D52), // 5^-48
+  ASMJIT_UINT64_C(0xE9D71B689DDE71AF), ASMJIT_UINT64_C(0xAAB8F01E6E10B4A6), // 5^-47
+  ASMJIT_UINT64_C(0x9226712162AB070D), ASMJIT_UINT64_C(0xCAB3961304CA70E8), // 5^-46
+  ASMJIT_UINT64_C(0xB6B00D69BB55C8D1), ASMJIT_UINT64_C(0x3D607B97C5FD0D22), // 5^-45
+  ASMJIT_UINT64_C(0xE45C10C42A2B3B05), ASMJIT_UINT64_C(0x8CB89A7DB77C506A), // 5^-44
+  ASMJIT_UINT64_C(0x8EB98A7A9A5B04E3), ASMJIT_UINT64_C(0x77F3608E92ADB242), // 5^-43
+  ASMJIT_UINT64_C(0xB267ED1940F1C61C), ASMJIT_UINT64_C(0x55F038B237591ED3), // 5^-42
+  ASMJIT_UINT64_C(0xDF01E85F912E37A3), ASMJIT_UINT64_C(0x6B6C46DEC52F6688), // 5^-41
+  ASMJIT_UINT64_C(0x8B61313BBABCE2C6), ASMJIT_UINT64_C(0x2323AC4B3B3DA015), // 5^-40
+  ASMJIT_UINT64_C(0xAE397D8AA96C1B77), ASMJIT_UINT64_C(0xABEC975E0A0D081A), // 5^-39
+  ASMJIT_UINT64_C(0xD9C7DCED53C72255), ASMJIT_UINT64_C(0x96E7BD358C904A21), // 5^-38
+  ASMJIT_UINT64_C(0x881CEA14545C7575), ASMJIT_UINT64_C(0x7E50D64177DA2E54), // 5^-37
+  ASMJIT_UINT64_C(0xAA242499697392D2), ASMJIT_UINT64_C(0xDDE50BD1D5D0B9E9), // 5^-36
+  ASMJIT_UINT64_C(0xD4AD2DBFC3D07787), ASMJIT_UINT64_C(0x955E4EC64B44E864), // 5^-35
+  ASMJIT_UINT64_C(0x84EC3C97DA624AB4), ASMJIT_UINT64_C(0xBD5AF13BEF0B113E), // 5^-34
+  ASMJIT_UINT64_C(0xA6274BBDD0FADD61), ASMJIT_UINT64_C(0xECB1AD8AEACDD58E), // 5^-33
+  ASMJIT_UINT64_C(0xCFB11EAD453994BA), ASMJIT_UINT64_C(0x67DE18EDA5814AF2), // 5^-32
+  ASMJIT_UINT64_C(0x81CEB32C4B43FCF4), ASMJIT_UINT64_C(0x80EACF948770CED7), // 5^-31
+  ASMJIT_UINT64_C(0xA2425FF75E14FC31), ASMJIT_UINT64_C(0xA1258379A94D028D), // 5^-30
+  ASMJIT_UINT64_C(0xCAD2F7F5359A3B3E), ASMJIT_UINT64_C(0x096EE45813A04330), // 5^-29
+  ASMJIT_UINT64_C(0xFD87B5F28300CA0D), ASMJIT_UINT64_C(0x8BCA9D6E188853FC), // 5^-28
+  ASMJIT_UINT64_C(0x9E74D1B791E07E48), ASMJIT_UINT64_C(0x775EA264CF55347E), // 5^-27
+  ASMJIT_UINT64_C(0xC612062576589DDA), ASMJIT_UINT64_C(0x95364AFE032A819E), // 5^-26
+  ASMJIT_UINT64_C(0xF79687AED3EEC551), ASMJIT_UINT64_C(0x3A83DDBD83F52205), // 5^-25
+  ASMJIT_UINT64_C(0x9ABE14CD44753B52), ASMJIT_UINT64_C(0xC4926A9672793543), // 5^-24
+  ASMJIT_UINT64_C(0xC16D9A0095928A27), ASMJIT_UINT64_C(0x75B7053C0F178294), // 5^-23
+  ASMJIT_UINT64_C(0xF1C90080BAF72CB1), ASMJIT_UINT64_C(0x5324C68B12DD6339), // 5^-22
+  ASMJIT_UINT64_C(0x971DA05074DA7BEE), ASMJIT_UINT64_C(0xD3F6FC16EBCA5E04), // 5^-21
+  ASMJIT_UINT64_C(0xBCE5086492111AEA), ASMJIT_UINT64_C(0x88F4BB1CA6BCF585), // 5^-20
+  ASMJIT_UINT64_C(0xEC1E4A7DB69561A5), ASMJIT_UINT64_C(0x2B31E9E3D06C32E6), // 5^-19
+  ASMJIT_UINT64_C(0x9392EE8E921D5D07), ASMJIT_UINT64_C(0x3AFF322E62439FD0), // 5^-18
+  ASMJIT_UINT64_C(0xB877AA3236A4B449), ASMJIT_UINT64_C(0x09BEFEB9FAD487C3), // 5^-17
+  ASMJIT_UINT64_C(0xE69594BEC44DE15B), ASMJIT_UINT64_C(0x4C2EBE687989A9B4), // 5^-16
+  ASMJIT_UINT64_C(0x901D7CF73AB0ACD9), ASMJIT_UINT64_C(0x0F9D37014BF60A11), // 5^-15
+  ASMJIT_UINT64_C(0xB424DC35095CD80F), ASMJIT_UINT64_C(0x538484C19EF38C95), // 5^-14
+  ASMJIT_UINT64_C(0xE12E13424BB40E13), ASMJIT_UINT64_C(0x2865A5F206B06FBA), // 5^-13
+  ASMJIT_UINT64_C(0x8CBCCC096F5088CB), ASMJIT_UINT64_C(0xF93F87B7442E45D4), // 5^-12
+  ASMJIT_UINT64_C(0xAFEBFF0BCB24AAFE), ASMJIT_UINT64_C(0xF78F69A51539D749), // 5^-11
+  ASMJIT_UINT64_C(0xDBE6FECEBDEDD5BE), ASMJIT_UINT64_C(0xB573440E5A884D1C), // 5^-10
+  ASMJIT_UINT64_C(0x89705F4136B4A597), ASMJIT_UINT64_C(0x31680A88F8953031), // 5^-9
+  ASMJIT_UINT64_C(0xABCC77118461CEFC), ASMJIT_UINT64_C(0xFDC20D2B36BA7C3E), // 5^-8
+  ASMJIT_UINT64_C(0xD6BF94D5E57A42BC), ASMJIT_UINT64_C(0x3D32907604691B4D), // 5^-7
+  ASMJIT_UINT64_C(0x8637BD05AF6C69B5), ASMJIT_UINT64_C(0xA63F9A49C2C1B110), // 5^-6
+  ASMJIT_UINT64_C(0xA7C5AC471B478423), ASMJIT_UINT64_C(0x0FCF80DC33721D54), // 5^-5
+  ASMJIT_UINT64_C(0xD1B71758E219652B), ASMJIT_UINT64_C(0xD3C36113404EA4A9), // 5^-4
+  ASMJIT_UINT64_C(0x83126E978D4FDF3B), ASMJIT_UINT64_C(0x645A1CAC083126EA), // 5^-3
+  ASMJIT_UINT64_C(0xA3D70A3D70A3D70A), ASMJIT_UINT64_C(0x3D70A3D70A3D70A4), // 5^-2
+  ASMJIT_UINT64_C(0xCCCCCCCCCCCCCCCC), ASMJIT_UINT64_C(0xCCCCCCCCCCCCCCCD), // 5^-1
+  ASMJIT_UINT64_C(0x8000000000000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^0
+  ASMJIT_UINT64_C(0xA000000000000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^1
+  ASMJIT_UINT64_C(0xC800000000000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^2
+  ASMJIT_UINT64_C(0xFA00000000000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^3
+  ASMJIT_UINT64_C(0x9C40000000000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^4
+  ASMJIT_UINT64_C(0xC350000000000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^5
+  ASMJIT_UINT64_C(0xF424000000000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^6
+  ASMJIT_UINT64_C(0x9896800000000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^7
+  ASMJIT_UINT64_C(0xBEBC200000000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^8
+  ASMJIT_UINT64_C(0xEE6B280000000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^9
+  ASMJIT_UINT64_C(0x9502F90000000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^10
+  ASMJIT_UINT64_C(0xBA43B74000000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^11
+  ASMJIT_UINT64_C(0xE8D4A51000000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^12
+  ASMJIT_UINT64_C(0x9184E72A00000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^13
+  ASMJIT_UINT64_C(0xB5E620F480000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^14
+  ASMJIT_UINT64_C(0xE35FA931A0000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^15
+  ASMJIT_UINT64_C(0x8E1BC9BF04000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^16
+  ASMJIT_UINT64_C(0xB1A2BC2EC5000000), ASMJIT_UINT64_C(0x0000000000000000), // 5^17
+  ASMJIT_UINT64_C(0xDE0B6B3A76400000), ASMJIT_UINT64_C(0x0000000000000000), // 5^18
+  ASMJIT_UINT64_C(0x8AC7230489E80000), ASMJIT_UINT64_C(0x0000000000000000), // 5^19
+  ASMJIT_UINT64_C(0xAD78EBC5AC620000), ASMJIT_UINT64_C(0x0000000000000000), // 5^20
+  ASMJIT_UINT64_C(0xD8D726B7177A8000), ASMJIT_UINT64_C(0x0000000000000000), // 5^21
+  ASMJIT_UINT64_C(0x878678326EAC9000), ASMJIT_UINT64_C(0x0000000000000000), // 5^22
+  ASMJIT_UINT64_C(0xA968163F0A57B400), ASMJIT_UINT64_C(0x0000000000000000), // 5^23
+  ASMJIT_UINT64_C(0xD3C21BCECCEDA100), ASMJIT_UINT64_C(0x0000000000000000), // 5^24
+  ASMJIT_UINT64_C(0x84595161401484A0), ASMJIT_UINT64_C(0x0000000000000000), // 5^25
+  ASMJIT_UINT64_C(0xA56FA5B99019A5C8), ASMJIT_UINT64_C(0x0000000000000000), // 5^26
+  ASMJIT_UINT64_C(0xCECB8F27F4200F3A), ASMJIT_UINT64_C(0x0000000000000000), // 5^27
+  ASMJIT_UINT64_C(0x813F3978F8940984), ASMJIT_UINT64_C(0x4000000000000000), // 5^28
+  ASMJIT_UINT64_C(0xA18F07D736B90BE5), ASMJIT_UINT64_C(0x5000000000000000), // 5^29
+  ASMJIT_UINT64_C(0xC9F2C9CD04674EDE), ASMJIT_UINT64_C(0xA400000000000000), // 5^30
+  ASMJIT_UINT64_C(0xFC6F7C4045812296), ASMJIT_UINT64_C(0x4D00000000000000), // 5^31
+  ASMJIT_UINT64_C(0x9DC5ADA82B70B59D), ASMJIT_UINT64_C(0xF020000000000000), // 5^32
+  ASMJIT_UINT64_C(0xC5371912364CE305), ASMJIT_UINT64_C(0x6C28000000000000), // 5^33
+  ASMJIT_UINT64_C(0xF684DF56C3E01BC6), ASMJIT_UINT64_C(0xC732000000000000), // 5^34
+  ASMJIT_UINT64_C(0x9A130B963A6C115C), ASMJIT_UINT64_C(0x3C7F400000000000), // 5^35
+  ASMJIT_UINT64_C(0xC097CE7BC90715B3), ASMJIT_UINT64_C(0x4B9F100000000000), // 5^36
+  ASMJIT_UINT64_C(0xF0BDC21ABB48DB20), ASMJIT_UINT64_C(0x1E86D40000000000), // 5^37
+  ASMJIT_UINT64_C(0x96769950B50D88F4), ASMJIT_UINT64_C(0x1314448000000000), // 5^38
+  ASMJIT_UINT64_C(0xBC143FA4E250EB31), ASMJIT_UINT64_C(0x17D955A000000000), // 5^39
+  ASMJIT_UINT64_C(0xEB194F8E1AE525FD), ASMJIT_UINT64_C(0x5DCFAB0800000000), // 5^40
+  ASMJIT_UINT64_C(0x92EFD1B8D0CF37BE), ASMJIT_UINT64_C(0x5AA1CAE500000000), // 5^41
+  ASMJIT_UINT64_C(0xB7ABC627050305AD), ASMJIT_UINT64_C(0xF14A3D9E40000000), // 5^42
+  ASMJIT_UINT64_C(0xE596B7B0C643C719), ASMJIT_UINT64_C(0x6D9CCD05D0000000), // 5^43
+  ASMJIT_UINT64_C(0x8F7E32CE7BEA5C6F), ASMJIT_UINT64_C(0xE4820023A2000000), // 5^44
+  ASMJIT_UINT64_C(0xB35DBF821AE4F38B), ASMJIT_UINT64_C(0xDDA2802C8A800000), // 5^45
+  ASMJIT_UINT64_C(0xE0352F62A19E306E), ASMJIT_UINT64_C(0xD50B2037AD200000), // 5^46
+  ASMJIT_UINT64_C(0x8C213D9DA502DE45), ASMJIT_UINT64_C(0x4526F422CC340000), // 5^47
+  ASMJIT_UINT64_C(0xAF298D050E4395D6), ASMJIT_UINT64_C(0x9670B12B7F410000), // 5^48
+  ASMJIT_UINT64_C(0xDAF3F04651D47B4C), ASMJIT_UINT64_C(0x3C0CDD765F114000), // 5^49
+  ASMJIT_UINT64_C(0x88D8762BF324CD0F), ASMJIT_UINT64_C(0xA5880A69FB6AC800), // 5^50
+  ASMJIT_UINT64_C(0xAB0E93B6EFEE0053), ASMJIT_UINT64_C(0x8EEA0D047A457A00), // 5^51
+  ASMJIT_UINT64_C(0xD5D238A4ABE98068), ASMJIT_UINT64_C(0x72A4904598D6D880), // 5^52
+  ASMJIT_UINT64_C(0x85A36366EB71F041), ASMJIT_UINT64_C(0x47A6DA2B7F864750), // 5^53
+  ASMJIT_UINT64_C(0xA70C3C40A64E6C51), ASMJIT_UINT64_C(0x999090B65F67D924), // 5^54
+  ASMJIT_UINT64_C(0xD0CF4B50CFE20765), ASMJIT_UINT64_C(0xFFF4B4E3F741CF6D), // 5^55
+  ASMJIT_UINT64_C(0x82818F1281ED449F), ASMJIT_UINT64_C(0xBFF8F10E7A8921A4), // 5^56
+  ASMJIT_UINT64_C(0xA321F2D7226895C7), ASMJIT_UINT64_C(0xAFF72D52192B6A0D), // 5^57
+  ASMJIT_UINT64_C(0xCBEA6F8CEB02BB39), ASMJIT_UINT64_C(0x9BF4F8A69F764490), // 5^58
+  ASMJIT_UINT64_C(0xFEE50B7025C36A08), ASMJIT_UINT64_C(0x02F236D04753D5B4), // 5^59
+  ASMJIT_UINT64_C(0x9F4F2726179A2245), ASMJIT_UINT64_C(0x01D762422C946590), // 5^60
+  ASMJIT_UINT64_C(0xC722F0EF9D80AAD6), ASMJIT_UINT64_C(0x424D3AD2B7B97EF5), // 5^61
+  ASMJIT_UINT64_C(0xF8EBAD2B84E0D58B), ASMJIT_UINT64_C(0xD2E0898765A7DEB2), // 5^62
+  ASMJIT_UINT64_C(0x9B934C3B330C8577), ASMJIT_UINT64_C(0x63CC55F49F88EB2F), // 5^63
+  ASMJIT_UINT64_C(0xC2781F49FFCFA6D5), ASMJIT_UINT64_C(0x3CBF6B71C76B25FB)  // 5^64
 };
 
-#define CHAR4X(C0, C1, C2, C3) \
-  ( (static_cast<uint32_t>(C0)      ) + \
-    (static_cast<uint32_t>(C1) <<  8) + \
-    (static_cast<uint32_t>(C2) << 16) + \
-    (static_cast<uint32_t>(C3) << 24) )
+//! \internal
+enum {
+  kMaxMantissaDigits = 19,
+  kPow10TableSize = static_cast<int>(MPSL_ARRAY_SIZE(mpPow10Table)),
+  kPow5Min = -64,
+  kPow5Max = 64
+};
 
 //! \internal
 //!
-//! Converts a given symbol `s` of `sLen` to a keyword token.
-static uint32_t mpGetKeyword(const uint8_t* s, size_t sLen) noexcept {
-  if (sLen < 2)
-    return kTokenSymbol;
-
-  uint32_t s0 = (static_cast<uint32_t>(s[0])     ) +
-                (static_cast<uint32_t>(s[1]) << 8) ;
-
-  if (sLen == 2) {
-    if (s0 == CHAR4X('d', 'o',  0 ,  0 )) return kTokenDo;
-    if (s0 == CHAR4X('i', 'f',  0 ,  0 )) return kTokenIf;
-    return kTokenSymbol;
+//! Multiply `a` by `b` and return the low 64 bits, store the high 64 bits to `hi`.
+static MPSL_INLINE uint64_t mpMul64x64(uint64_t a, uint64_t b, uint64_t* hi) noexcept {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+  *hi = static_cast<uint64_t>(r >> 64);
+  return static_cast<uint64_t>(r);
+#elif MPSL_CC_MSC_GE(14, 0, 0) && MPSL_ARCH_X64
+  return _umul128(a, b, hi);
+#else
+  uint64_t aLo = a & 0xFFFFFFFFU, aHi = a >> 32;
+  uint64_t bLo = b & 0xFFFFFFFFU, bHi = b >> 32;
+
+  uint64_t ll = aLo * bLo;
+  uint64_t lh = aLo * bHi;
+  uint64_t hl = aHi * bLo;
+  uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFFU) + (hl & 0xFFFFFFFFU);
+
+  *hi = aHi * bHi + (lh >> 32) + (hl >> 32) + (mid >> 32);
+  return (mid << 32) | (ll & 0xFFFFFFFFU);
+#endif
+}
+
+//! \internal
+static MPSL_INLINE uint32_t mpClz64(uint64_t x) noexcept {
+#if MPSL_CC_MSC_GE(14, 0, 0) && MPSL_ARCH_X64
+  unsigned long i;
+  _BitScanReverse64(&i, x);
+  return static_cast<uint32_t>(63 - i);
+#elif MPSL_CC_GCC_GE(3, 4, 6) || MPSL_CC_CLANG
+  return static_cast<uint32_t>(__builtin_clzll(x));
+#else
+  uint32_t i = 0;
+  while ((x & ASMJIT_UINT64_C(0x8000000000000000)) == 0) {
+    x <<= 1;
+    i++;
   }
+  return i;
+#endif
+}
 
-  s0 += (static_cast<uint32_t>(s[2]) << 16);
-  if (sLen == 3) {
-    if (s0 == CHAR4X('f', 'o', 'r',  0 )) return kTokenFor;
-    return kTokenSymbol;
+//! \internal
+//!
+//! Convert `w * 10^q` to the nearest `double` and store it to `out`.
+//!
+//! Uses the Clinger's fast path if both `w` and `10^q` are exact doubles and
+//! the Eisel-Lemire algorithm if `q` is within the `mpPow5Table[]`. Returns
+//! false if neither applies, the caller should then fall back to `strtod()`.
+//!
+//! https://arxiv.org/abs/2101.11408
+static bool mpDecimalToDouble(uint64_t w, int q, double* out) noexcept {
+  if (w == 0) {
+    *out = 0.0;
+    return true;
   }
 
-  s0 += (static_cast<uint32_t>(s[3]) << 24);
-  if (sLen == 4) {
-    if (s0 == CHAR4X('e', 'l', 's', 'e')) return kTokenElse;
-    if (s0 == CHAR4X('v', 'o', 'i', 'd')) return kTokenVoid;
-    return kTokenSymbol;
+  if (w <= (ASMJIT_UINT64_C(1) << 53) && q > -kPow10TableSize && q < kPow10TableSize) {
+    double d = static_cast<double>(w);
+    *out = q < 0 ? d / mpPow10Table[-q] : d * mpPow10Table[q];
+    return true;
   }
 
-  uint32_t s1 = static_cast<uint32_t>(s[4]);
+  if (q < kPow5Min || q > kPow5Max)
+    return false;
 
-  if (sLen == 5) {
-    if (s0 == CHAR4X('b', 'r', 'e', 'a') && s1 == CHAR4X('k',  0 ,  0 ,  0 )) return kTokenBreak;
-    if (s0 == CHAR4X('c', 'o', 'n', 's') && s1 == CHAR4X('t',  0 ,  0 ,  0 )) return kTokenConst;
-    if (s0 == CHAR4X('w', 'h', 'i', 'l') && s1 == CHAR4X('e',  0 ,  0 ,  0 )) return kTokenWhile;
-    return kTokenSymbol;
-  }
+  uint32_t lz = mpClz64(w);
+  w <<= lz;
 
-  s1 += (static_cast<uint32_t>(s[5]) << 8);
-  if (sLen == 6) {
-    if (s0 == CHAR4X('r', 'e', 't', 'u') && s1 == CHAR4X('r', 'n',  0 ,  0 )) return kTokenReturn;
-    if (s0 == CHAR4X('s', 't', 'r', 'u') && s1 == CHAR4X('c', 't',  0 ,  0 )) return kTokenReserved;
-    return kTokenSymbol;
-  }
+  const uint64_t* pow5 = mpPow5Table + (q - kPow5Min) * 2;
+  uint64_t hi;
+  uint64_t lo = mpMul64x64(w, pow5[0], &hi);
+
+  // Refine by the low word of 5^q if the bits below the result are all ones.
+  // The product is then always precise enough for a 64-bit `w`.
+  if ((hi & 0x1FF) == 0x1FF) {
+    uint64_t hi2;
+    mpMul64x64(w, pow5[1], &hi2);
 
-  s1 += (static_cast<uint32_t>(s[6]) << 16);
-  if (sLen == 7) {
-    if (s0 == CHAR4X('t', 'y', 'p', 'e') && s1 == CHAR4X('d', 'e', 'f',  0 )) return kTokenTypeDef;
-    return kTokenSymbol;
+    lo += hi2;
+    if (hi2 > lo)
+      hi++;
   }
 
-  s1 += (static_cast<uint32_t>(s[7]) << 24);
-  if (sLen == 8) {
-    if (s0 == CHAR4X('c', 'o', 'n', 't') && s1 == CHAR4X('i', 'n', 'u', 'e')) return kTokenContinue;
-    return kTokenSymbol;
+  uint32_t upperBit = static_cast<uint32_t>(hi >> 63);
+  uint32_t shift = upperBit + 64 - 52 - 3;
+
+  uint64_t mantissa = hi >> shift;
+  int32_t power2 = ((217706 * q) >> 16) + 63 + static_cast<int32_t>(upperBit) - static_cast<int32_t>(lz) + 1023;
+
+  // The table only covers normal numbers, but keep the check to not depend
+  // on its range.
+  if (power2 <= 0 || power2 >= 0x7FF)
+    return false;
+
+  // Round to even if `w * 5^q` is exactly halfway, only possible for small `q`.
+  if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == hi)
+    mantissa &= ~static_cast<uint64_t>(1);
+
+  mantissa += mantissa & 1;
+  mantissa >>= 1;
+
+  if (mantissa >= (ASMJIT_UINT64_C(2) << 52)) {
+    mantissa = ASMJIT_UINT64_C(1) << 52;
+    power2++;
   }
 
+  union { uint64_t u; double d; } bits;
+  bits.u = (mantissa & ~(ASMJIT_UINT64_C(1) << 52)) | (static_cast<uint64_t>(power2) << 52);
+
+  *out = bits.d;
+  return true;
+}
+
+//! \internal
+//!
+//! Keyword of `mpKeywordTable[]`.
+struct KeywordInfo {
+  char name[9];
+  uint8_t length;
+  uint8_t token;
+};
+
+//! \internal
+//!
+//! Keywords indexed by `mpKeywordIndex()` of their `HashUtils::hashString()`.
+//!
+//! The multiplier `kKeywordHashMul` has been chosen so that each keyword maps
+//! to a unique index - the table has to be regenerated if a keyword is added.
+static const KeywordInfo mpKeywordTable[] = {
+  { "for"     , 3, kTokenFor      }, // #0
+  { ""        , 0, kTokenSymbol   }, // #1
+  { "continue", 8, kTokenContinue }, // #2
+  { "typedef" , 7, kTokenTypeDef  }, // #3
+  { "do"      , 2, kTokenDo       }, // #4
+  { "struct"  , 6, kTokenReserved }, // #5
+  { "if"      , 2, kTokenIf       }, // #6
+  { "return"  , 6, kTokenReturn   }, // #7
+  { "const"   , 5, kTokenConst    }, // #8
+  { ""        , 0, kTokenSymbol   }, // #9
+  { "while"   , 5, kTokenWhile    }, // #10
+  { "void"    , 4, kTokenVoid     }, // #11
+  { "else"    , 4, kTokenElse     }, // #12
+  { ""        , 0, kTokenSymbol   }, // #13
+  { "break"   , 5, kTokenBreak    }, // #14
+  { ""        , 0, kTokenSymbol   }  // #15
+};
+
+//! \internal
+enum { kKeywordHashMul = 0x5E7 };
+
+//! \internal
+static MPSL_INLINE uint32_t mpKeywordIndex(uint32_t hVal) noexcept {
+  return (hVal * static_cast<uint32_t>(kKeywordHashMul)) >> 28;
+}
+
+//! \internal
+//!
+//! Converts a given symbol `s` of `sLen` and hash `hVal` to a keyword token.
+static MPSL_INLINE uint32_t mpGetKeyword(const uint8_t* s, size_t sLen, uint32_t hVal) noexcept {
+  const KeywordInfo& info = mpKeywordTable[mpKeywordIndex(hVal)];
+  if (info.length == sLen && ::memcmp(info.name, s, sLen) == 0)
+    return info.token;
   return kTokenSymbol;
 }
 
+#if MPSL_USE_SSE2
+//! \internal
+//!
+//! Get a mask of bytes `x == c`.
+static MPSL_INLINE __m128i mpSimdEq(__m128i x, char c) noexcept {
+  return _mm_cmpeq_epi8(x, _mm_set1_epi8(c));
+}
+
+//! \internal
+//!
+//! Get a mask of bytes `lo <= x <= lo + n` (unsigned).
+static MPSL_INLINE __m128i mpSimdInRange(__m128i x, char lo, char n) noexcept {
+  __m128i d = _mm_subs_epu8(_mm_sub_epi8(x, _mm_set1_epi8(lo)), _mm_set1_epi8(n));
+  return _mm_cmpeq_epi8(d, _mm_setzero_si128());
+}
+
+//! \internal
+//!
+//! Get a bit-mask of 16 bytes at `p` that are not spaces (`kTokenCharSpc`).
+static MPSL_INLINE uint32_t mpSimdNonSpaceMask(const uint8_t* p) noexcept {
+  __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  __m128i m = _mm_or_si128(mpSimdInRange(x, 0x09, 0x0D - 0x09), mpSimdEq(x, 0x20));
+  return static_cast<uint32_t>(_mm_movemask_epi8(m)) ^ 0xFFFFU;
+}
+
+//! \internal
+//!
+//! Get a bit-mask of 16 bytes at `p` that are not `[0-9A-Za-z_]` (chars up to
+//! `kTokenCharSym`).
+static MPSL_INLINE uint32_t mpSimdNonSymbolMask(const uint8_t* p) noexcept {
+  __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  __m128i m = _mm_or_si128(
+    _mm_or_si128(mpSimdInRange(x, '0', 9), mpSimdEq(x, '_')),
+    mpSimdInRange(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 25));
+  return static_cast<uint32_t>(_mm_movemask_epi8(m)) ^ 0xFFFFU;
+}
+
+//! \internal
+//!
+//! Get a bit-mask of 16 bytes at `p` that are new-lines.
+static MPSL_INLINE uint32_t mpSimdNewLineMask(const uint8_t* p) noexcept {
+  __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  return static_cast<uint32_t>(_mm_movemask_epi8(mpSimdEq(x, '\n')));
+}
+#endif // MPSL_USE_SSE2
+
 uint32_t Tokenizer::peek(Token* token) noexcept {
   uint32_t uToken = _token.token;
   if (uToken != kTokenInvalid || (uToken = next(&_token)) != kTokenInvalid)
@@ -227,6 +515,17 @@ uint32_t Tokenizer::next(Token* token) noexcept {
   // --------------------------------------------------------------------------
 
 _Repeat:
+#if MPSL_USE_SSE2
+  while ((size_t)(pEnd - p) >= 16) {
+    uint32_t mask = mpSimdNonSpaceMask(p);
+    if (mask) {
+      p += mpBitCtz(mask);
+      break;
+    }
+    p += 16;
+  }
+#endif
+
   for (;;) {
     if (p == pEnd)
       goto _EndOfInput;
@@ -292,13 +591,15 @@ _Repeat:
       // Integer or double precision floating point.
       uint32_t nType = kTypeVoid;
 
-      // Parsing floating point is not that simple as it looks. To simplify the
-      // most common cases we parse floating points up to `kSafeDigits` and then
-      // use libc `strtod()` function to parse numbers that are more complicated.
-      //
-      // http://www.exploringbinary.com/fast-path-decimal-to-floating-point-conversion/
-      double val = 0.0;
+      // The number is parsed as an exact integer `mantissa` of up to
+      // `kMaxMantissaDigits` significant digits scaled by 10^`exponent`, which
+      // `mpDecimalToDouble()` converts without rounding errors. The libc's
+      // `strtod()` is only used for numbers it can't convert or numbers that
+      // have non-zero digits that don't fit into the mantissa.
+      uint64_t mantissa = 0;
       size_t digits = 0;
+      int exponent = 0;
+      bool safe = true;
 
       // Skip leading zeros.
       while (p[0] == '0') {
@@ -307,42 +608,47 @@ _Repeat:
       }
 
       // Parse significand or integer part.
-      size_t scale = 0;
       while (p != pEnd) {
         c = static_cast<uint32_t>(p[0]) - static_cast<uint32_t>('0');
         if (c > 9)
           break;
-        scale++;
 
-        if (c != 0) {
-          if (scale < kPow10TableSize)
-            val = val * mpPow10Table[scale] + static_cast<double>(static_cast<int>(c));
-          digits += scale;
-          scale = 0;
-        }
+        if (digits < kMaxMantissaDigits)
+          mantissa = mantissa * 10 + c;
+        else if (c != 0)
+          safe = false;
+        else
+          exponent++;
 
+        digits++;
         p++;
       }
-      size_t significantDigits = digits + scale;
 
       // Parse fraction.
       if (p != pEnd && p[0] == '.') {
         // Fraction, even if it's just '.' promotes the number to `double`.
         nType = kTypeDouble;
 
-        size_t scale = 0;
         while (++p != pEnd) {
           c = static_cast<uint32_t>(p[0]) - static_cast<uint32_t>('0');
           if (c > 9)
             break;
-          scale++;
 
-          if (c != 0) {
-            if (scale < kPow10TableSize)
-              val = val * mpPow10Table[scale] + static_cast<double>(static_cast<int>(c));
-            digits += scale;
-            scale = 0;
+          // Leading zeros of the fraction only scale the number.
+          if (digits == 0 && c == 0) {
+            exponent--;
+            continue;
+          }
+
+          if (digits < kMaxMantissaDigits) {
+            mantissa = mantissa * 10 + c;
+            exponent--;
           }
+          else if (c != 0) {
+            safe = false;
+          }
+
+          digits++;
         }
 
         // Token is '.'.
@@ -352,9 +658,6 @@ _Repeat:
         }
       }
 
-      bool safe = digits <= kSafeDigits && significantDigits < 999999;
-      int exponent = safe ? static_cast<int>(significantDigits) - static_cast<int>(digits) : 0;
-
       // Parse an optional exponent.
       if (p != pEnd && mpGetLower(p[0]) == 'e') {
         // Exponent promotes the number to `double`.
@@ -415,11 +718,13 @@ _Repeat:
         goto _Invalid;
       }
 
-      // Limit a range of safe values from Xe-15 to Xe15.
-      safe = safe && exponent >= -kPow10TableSize && exponent <= kPow10TableSize;
+      double val;
       size_t len = (size_t)(p - pToken);
 
-      if (safe) {
+      // Don't let extremely long inputs overflow the exponent.
+      safe = safe && digits < 999999 && exponent > -999999 && exponent < 999999;
+
+      if (safe && mpDecimalToDouble(mantissa, exponent, &val)) {
         // Now decide whether to report `int` or `double` if there was no type specifier.
         if (nType == kTypeVoid) {
           if (val >= -2147483648.0 && val <= 2147483647.0)
@@ -427,9 +732,6 @@ _Repeat:
           else
             nType = kTypeDouble;
         }
-
-        if (exponent != 0)
-          val = exponent < 0 ? val / mpPow10Table[-exponent] : val * mpPow10Table[exponent];
       }
       else {
         // If the number is not safe and there was no specifier then it's `double`.
@@ -465,18 +767,34 @@ _Repeat:
   // --------------------------------------------------------------------------
 
   else if (c <= kTokenCharSym) {
-    // We always generate the hVal during tokenization to improve performance.
-    while (++p != pEnd) {
-      uint32_t ord = static_cast<uint8_t>(p[0]);
-      c = mpCharClass[ord];
-      if (c > kTokenCharSym)
-        break;
-      hVal = HashUtils::hashChar(hVal, ord);
+    // Find the end of the symbol first, the hash is calculated by a separate
+    // loop that doesn't have to check the input end and character classes.
+    const uint8_t* pSymEnd = p + 1;
+
+#if MPSL_USE_SSE2
+    while ((size_t)(pEnd - pSymEnd) >= 16) {
+      uint32_t mask = mpSimdNonSymbolMask(pSymEnd);
+      if (mask) {
+        pSymEnd += mpBitCtz(mask);
+        goto _SymbolEnd;
+      }
+      pSymEnd += 16;
     }
+#endif
+
+    while (pSymEnd != pEnd && mpCharClass[pSymEnd[0]] <= kTokenCharSym)
+      pSymEnd++;
+
+#if MPSL_USE_SSE2
+_SymbolEnd:
+#endif
+    // We always generate the hVal during tokenization to improve performance.
+    while (++p != pSymEnd)
+      hVal = HashUtils::hashChar(hVal, p[0]);
 
     size_t len = (size_t)(p - pToken);
     _p = reinterpret_cast<const char*>(p);
-    return token->setData((size_t)(pToken - pStart), len, hVal, mpGetKeyword(pToken, len));
+    return token->setData((size_t)(pToken - pStart), len, hVal, mpGetKeyword(pToken, len, hVal));
   }
 
   // --------------------------------------------------------------------------
@@ -592,6 +910,17 @@ _Invalid:
   return token->setData((size_t)(pToken - pStart), (size_t)(p - pToken), 0, kTokenInvalid);
 
 _Comment:
+#if MPSL_USE_SSE2
+  while ((size_t)(pEnd - p) >= 16) {
+    uint32_t mask = mpSimdNewLineMask(p);
+    if (mask) {
+      p += mpBitCtz(mask) + 1;
+      goto _Repeat;
+    }
+    p += 16;
+  }
+#endif
+
   for (;;) {
     if (p == pEnd)
       goto _EndOfInput;
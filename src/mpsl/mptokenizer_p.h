@@ -178,10 +178,12 @@ struct Tokenizer {
   // [Construction / Destruction]
   // --------------------------------------------------------------------------
 
-  MPSL_INLINE Tokenizer(const char* s, size_t sLen) noexcept
-    : _p(s),
+  //! Create a tokenizer of `[start, end)` range of `s`, token positions are
+  //! relative to `s`.
+  MPSL_INLINE Tokenizer(const char* s, size_t start, size_t end) noexcept
+    : _p(s + start),
       _start(s),
-      _end(s + sLen),
+      _end(s + end),
       _strtod() {
     _token.reset();
   }
@@ -0,0 +1,432 @@
+// [MPSL-Test]
+// MathPresso's Shading Language with JIT Engine for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Dependencies]
+#include "./mpsl.h"
+#include "./mp_utils.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// The output is CSV - `shader,metric,value,unit` - one row per measurement,
+// lines starting with '#' are comments. Times are the best of all repetitions,
+// which is the least sensitive to noise:
+//
+//   compile   - Time to compile the shader, the program cache is disabled.
+//   run       - Time per record of `Program::run()` called for each record.
+//   batch     - Time per record of `Program::runBatch()`.
+//   parallel  - Time per record of `Program::runParallel()` on all CPUs.
+//   native    - Time per record of equivalent hand-written C++ code.
+
+// ============================================================================
+// [CmdLine]
+// ============================================================================
+
+class CmdLine {
+public:
+  CmdLine(int argc, const char* const* argv)
+    : argc(argc),
+      argv(argv) {}
+
+  bool hasKey(const char* key) const {
+    for (int i = 0; i < argc; i++)
+      if (::strcmp(argv[i], key) == 0)
+        return true;
+    return false;
+  }
+
+  int argc;
+  const char* const* argv;
+};
+
+// ============================================================================
+// [BenchTimer]
+// ============================================================================
+
+struct BenchTimer {
+  typedef std::chrono::steady_clock Clock;
+
+  void start() { _start = Clock::now(); }
+
+  //! Get nanoseconds elapsed since `start()`.
+  double elapsed() const {
+    return std::chrono::duration<double, std::nano>(Clock::now() - _start).count();
+  }
+
+  Clock::time_point _start;
+};
+
+// ============================================================================
+// [BenchPool]
+// ============================================================================
+
+// Runs workers by threads created for each `run()`, the calling thread runs
+// the first worker.
+struct BenchPool : public mpsl::ThreadPool {
+  BenchPool() noexcept {
+    _workersCount = std::thread::hardware_concurrency();
+    if (_workersCount == 0)
+      _workersCount = 1;
+  }
+
+  virtual uint32_t getWorkersCount() const noexcept { return _workersCount; }
+
+  virtual void run(WorkFunc func, void* data, uint32_t count) noexcept {
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < count; i++)
+      threads.push_back(std::thread(func, data, i));
+
+    func(data, 0);
+    for (size_t i = 0; i < threads.size(); i++)
+      threads[i].join();
+  }
+
+  uint32_t _workersCount;
+};
+
+// ============================================================================
+// [BenchArgs]
+// ============================================================================
+
+struct BenchArgs {
+  float fa, fb, fc;
+  mpsl::Float4 f4a, f4b;
+  mpsl::Double4 d4a, d4b;
+  mpsl::Int4 bg, fg, alpha;
+
+  mpsl::Value ret;
+};
+
+static void initLayout(mpsl::Layout& layout, uint32_t retType) {
+  layout.addMember("fa"   , mpsl::kTypeFloat   | mpsl::kTypeRO, MPSL_OFFSET_OF(BenchArgs, fa));
+  layout.addMember("fb"   , mpsl::kTypeFloat   | mpsl::kTypeRO, MPSL_OFFSET_OF(BenchArgs, fb));
+  layout.addMember("fc"   , mpsl::kTypeFloat   | mpsl::kTypeRO, MPSL_OFFSET_OF(BenchArgs, fc));
+  layout.addMember("f4a"  , mpsl::kTypeFloat4  | mpsl::kTypeRO, MPSL_OFFSET_OF(BenchArgs, f4a));
+  layout.addMember("f4b"  , mpsl::kTypeFloat4  | mpsl::kTypeRO, MPSL_OFFSET_OF(BenchArgs, f4b));
+  layout.addMember("d4a"  , mpsl::kTypeDouble4 | mpsl::kTypeRO, MPSL_OFFSET_OF(BenchArgs, d4a));
+  layout.addMember("d4b"  , mpsl::kTypeDouble4 | mpsl::kTypeRO, MPSL_OFFSET_OF(BenchArgs, d4b));
+  layout.addMember("bg"   , mpsl::kTypeInt4    | mpsl::kTypeRO, MPSL_OFFSET_OF(BenchArgs, bg));
+  layout.addMember("fg"   , mpsl::kTypeInt4    | mpsl::kTypeRO, MPSL_OFFSET_OF(BenchArgs, fg));
+  layout.addMember("alpha", mpsl::kTypeInt4    | mpsl::kTypeRO, MPSL_OFFSET_OF(BenchArgs, alpha));
+  layout.addMember("@ret" , retType            | mpsl::kTypeWO, MPSL_OFFSET_OF(BenchArgs, ret));
+}
+
+static void initArgs(BenchArgs* args, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    BenchArgs& a = args[i];
+    float x = static_cast<float>(i % 97);
+
+    a.fa = x + 1.0f;
+    a.fb = 48.0f - x * 0.5f;
+    a.fc = 3.0f;
+    a.f4a.set(x + 1.0f, x + 2.0f, x + 3.0f, x + 4.0f);
+    a.f4b.set(4.0f, 3.0f, 2.0f, x + 1.0f);
+    a.d4a.set(x + 1.0, x + 2.0, x + 3.0, x + 4.0);
+    a.d4b.set(0.5, 2.0, 4.0, x + 8.0);
+    a.bg.set(0x00200030, 0x00400050, 0x00600070, 0x008000FF);
+    a.fg.set(static_cast<int>(i & 0xFF) * 0x00010001);
+    a.alpha.set(static_cast<int>((i * 7) & 0xFF) * 0x00010001);
+
+    ::memset(&a.ret, 0, sizeof(mpsl::Value));
+  }
+}
+
+// ============================================================================
+// [Native]
+// ============================================================================
+
+// Hand-written equivalents of shaders, compiled by the C++ compiler.
+typedef void (*NativeFunc)(BenchArgs* args, size_t count);
+
+static void nativeScalar(BenchArgs* args, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    BenchArgs& a = args[i];
+    a.ret.f[0] = a.fa * a.fb + a.fc * 0.5f;
+  }
+}
+
+static void nativeFloat4(BenchArgs* args, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    BenchArgs& a = args[i];
+    for (size_t j = 0; j < 4; j++)
+      a.ret.f[j] = sqrtf(a.f4a[j] * a.f4b[j]) + a.f4a[j];
+  }
+}
+
+static void nativeDouble4(BenchArgs* args, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    BenchArgs& a = args[i];
+    for (size_t j = 0; j < 4; j++)
+      a.ret.d[j] = a.d4a[j] * a.d4b[j] - a.d4a[j] / a.d4b[j];
+  }
+}
+
+static void nativeDSP(BenchArgs* args, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    BenchArgs& a = args[i];
+    for (size_t j = 0; j < 4; j++) {
+      uint32_t result = 0;
+      for (uint32_t shift = 0; shift < 32; shift += 16) {
+        uint16_t bg = static_cast<uint16_t>(static_cast<uint32_t>(a.bg[j]) >> shift);
+        uint16_t fg = static_cast<uint16_t>(static_cast<uint32_t>(a.fg[j]) >> shift);
+        uint16_t alpha = static_cast<uint16_t>(static_cast<uint32_t>(a.alpha[j]) >> shift);
+
+        uint16_t x = static_cast<uint16_t>(bg * static_cast<uint16_t>(0x0100 - alpha));
+        uint16_t y = static_cast<uint16_t>(fg * alpha);
+        result |= static_cast<uint32_t>(static_cast<uint16_t>(x + y) >> 8) << shift;
+      }
+      a.ret.i[j] = static_cast<int>(result);
+    }
+  }
+}
+
+static void nativeControl(BenchArgs* args, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    BenchArgs& a = args[i];
+    float x = a.fa;
+
+    for (int k = 0; k < 8; k++) {
+      if (x > a.fb)
+        x = x * 0.5f;
+      else
+        x = x + a.fc;
+    }
+
+    a.ret.f[0] = x;
+  }
+}
+
+// ============================================================================
+// [Shaders]
+// ============================================================================
+
+struct BenchShader {
+  const char* name;
+  uint32_t retType;
+  const char* body;
+  NativeFunc native;
+};
+
+static const BenchShader benchShaders[] = {
+  {
+    "scalar", mpsl::kTypeFloat,
+    "float main() {\n"
+    "  return fa * fb + fc * 0.5f;\n"
+    "}\n",
+    nativeScalar
+  },
+  {
+    "float4", mpsl::kTypeFloat4,
+    "float4 main() {\n"
+    "  return sqrt(f4a * f4b) + f4a;\n"
+    "}\n",
+    nativeFloat4
+  },
+  {
+    "double4", mpsl::kTypeDouble4,
+    "double4 main() {\n"
+    "  return d4a * d4b - d4a / d4b;\n"
+    "}\n",
+    nativeDouble4
+  },
+  {
+    "dsp", mpsl::kTypeInt4,
+    "int4 main() {\n"
+    "  const int inv = 0x01000100;\n"
+    "  int4 x = pmulw(bg, psubw(inv, alpha));\n"
+    "  int4 y = pmulw(fg, alpha);\n"
+    "  return psrlw(paddw(x, y), 8);\n"
+    "}\n",
+    nativeDSP
+  },
+  {
+    "control", mpsl::kTypeFloat,
+    "float main() {\n"
+    "  float x = fa;\n"
+    "  for (int i = 0; i < 8; i++) {\n"
+    "    if (x > fb)\n"
+    "      x = x * 0.5f;\n"
+    "    else\n"
+    "      x = x + fc;\n"
+    "  }\n"
+    "  return x;\n"
+    "}\n",
+    nativeControl
+  }
+};
+
+// ============================================================================
+// [Bench]
+// ============================================================================
+
+struct Bench {
+  enum { kRecordsCount = 16384 };
+
+  Bench(uint32_t options, uint32_t repeat)
+    : _ctx(mpsl::Context::create()),
+      _options(options),
+      _repeat(repeat),
+      _succeeded(true) {}
+
+  // Fast-math doesn't preserve results of the native code.
+  bool canVerify() const { return (_options & mpsl::kOptionFastMath) == 0; }
+
+  void report(const char* shader, const char* metric, double value, const char* unit) {
+    printf("%s,%s,%.3f,%s\n", shader, metric, value, unit);
+  }
+
+  // Verify that the program computes the same results as the native code.
+  void verify(const BenchShader& shader, const BenchArgs* args, const BenchArgs* expected) {
+    if (!canVerify())
+      return;
+
+    for (size_t i = 0; i < kRecordsCount; i++) {
+      if (::memcmp(&args[i].ret, &expected[i].ret, sizeof(mpsl::Value)) != 0) {
+        printf("# [FAIL] %s: result of record %u differs from the native code\n",
+          shader.name, static_cast<unsigned int>(i));
+        _succeeded = false;
+        return;
+      }
+    }
+  }
+
+  void run(const BenchShader& shader) {
+    mpsl::LayoutTmp<1024> layout;
+    initLayout(layout, shader.retType);
+
+    TestLog log;
+    BenchTimer timer;
+    double best;
+
+    // Compile.
+    mpsl::Program1<BenchArgs> program;
+    best = 0.0;
+
+    for (uint32_t r = 0; r < _repeat; r++) {
+      timer.start();
+      mpsl::Error err = program.compile(_ctx, shader.body, _options | mpsl::kOptionDisableCache, layout, &log);
+      double t = timer.elapsed();
+
+      if (err != mpsl::kErrorOk) {
+        printf("# [FAIL] %s: compilation failed (0x%08X)\n", shader.name, static_cast<unsigned int>(err));
+        _succeeded = false;
+        return;
+      }
+
+      if (r == 0 || t < best)
+        best = t;
+    }
+    report(shader.name, "compile", best / 1000.0, "us");
+    report(shader.name, "code_size", program.getProgramSize(), "bytes");
+
+    BenchArgs* args = static_cast<BenchArgs*>(::malloc(kRecordsCount * sizeof(BenchArgs)));
+    BenchArgs* expected = static_cast<BenchArgs*>(::malloc(kRecordsCount * sizeof(BenchArgs)));
+
+    if (args == nullptr || expected == nullptr) {
+      printf("# [FAIL] %s: out of memory\n", shader.name);
+      ::free(args);
+      ::free(expected);
+      _succeeded = false;
+      return;
+    }
+
+    initArgs(expected, kRecordsCount);
+    initArgs(args, kRecordsCount);
+
+    // Native.
+    for (uint32_t r = 0; r < _repeat; r++) {
+      timer.start();
+      shader.native(expected, kRecordsCount);
+      double t = timer.elapsed();
+
+      if (r == 0 || t < best)
+        best = t;
+    }
+    report(shader.name, "native", best / kRecordsCount, "ns");
+
+    // Run.
+    for (uint32_t r = 0; r < _repeat; r++) {
+      timer.start();
+      for (size_t i = 0; i < kRecordsCount; i++)
+        program.run(&args[i]);
+      double t = timer.elapsed();
+
+      if (r == 0 || t < best)
+        best = t;
+    }
+    report(shader.name, "run", best / kRecordsCount, "ns");
+    verify(shader, args, expected);
+
+    // Batch.
+    initArgs(args, kRecordsCount);
+    for (uint32_t r = 0; r < _repeat; r++) {
+      timer.start();
+      program.runBatch(args, kRecordsCount, sizeof(BenchArgs));
+      double t = timer.elapsed();
+
+      if (r == 0 || t < best)
+        best = t;
+    }
+    report(shader.name, "batch", best / kRecordsCount, "ns");
+    verify(shader, args, expected);
+
+    // Parallel.
+    initArgs(args, kRecordsCount);
+    for (uint32_t r = 0; r < _repeat; r++) {
+      timer.start();
+      program.runParallel(args, kRecordsCount, sizeof(BenchArgs), &_pool);
+      double t = timer.elapsed();
+
+      if (r == 0 || t < best)
+        best = t;
+    }
+    report(shader.name, "parallel", best / kRecordsCount, "ns");
+    verify(shader, args, expected);
+
+    ::free(args);
+    ::free(expected);
+  }
+
+  mpsl::Context _ctx;
+  BenchPool _pool;
+
+  uint32_t _options;
+  uint32_t _repeat;
+  bool _succeeded;
+};
+
+// ============================================================================
+// [Main]
+// ============================================================================
+
+int main(int argc, char* argv[]) {
+  CmdLine cmd(argc, argv);
+  uint32_t options = 0;
+  uint32_t repeat = cmd.hasKey("--quick") ? 3 : 20;
+
+  if (cmd.hasKey("--opt-basic")) options |= mpsl::kOptionOptBasic;
+  if (cmd.hasKey("--opt-none" )) options |= mpsl::kOptionOptNone;
+  if (cmd.hasKey("--fast-math")) options |= mpsl::kOptionFastMath;
+
+  Bench bench(options, repeat);
+
+  printf("# MPSL benchmark, %u workers, %u records, best of %u\n",
+    bench._pool.getWorkersCount(),
+    static_cast<unsigned int>(Bench::kRecordsCount),
+    repeat);
+  printf("shader,metric,value,unit\n");
+
+  for (size_t i = 0; i < MPSL_ARRAY_SIZE(benchShaders); i++)
+    bench.run(benchShaders[i]);
+
+  return bench._succeeded ? 0 : 1;
+}
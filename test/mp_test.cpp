@@ -89,6 +89,72 @@ static mpsl::Value makeDVal(double x, double y = 0.0, double z = 0.0, double w =
   mpsl::Value v; v.d.set(x, y, z, w); return v;
 }
 
+// ============================================================================
+// [TestPool]
+// ============================================================================
+
+// Runs all workers sequentially, used to verify chunking and stealing.
+struct TestPool : public mpsl::ThreadPool {
+  TestPool(uint32_t workersCount) noexcept
+    : _workersCount(workersCount) {}
+
+  virtual uint32_t getWorkersCount() const noexcept { return _workersCount; }
+
+  virtual void run(WorkFunc func, void* data, uint32_t count) noexcept {
+    for (uint32_t i = 0; i < count; i++)
+      func(data, i);
+  }
+
+  uint32_t _workersCount;
+};
+
+// Keeps a posted job until `flush()` is called, used to verify that a job
+// compiled asynchronously isn't ready before the pool runs it.
+struct DeferredPool : public TestPool {
+  DeferredPool() noexcept
+    : TestPool(1),
+      _func(nullptr),
+      _data(nullptr) {}
+
+  virtual void post(WorkFunc func, void* data) noexcept {
+    _func = func;
+    _data = data;
+  }
+
+  void flush() noexcept {
+    if (_func != nullptr)
+      _func(_data, 0);
+    _func = nullptr;
+  }
+
+  WorkFunc _func;
+  void* _data;
+};
+
+// ============================================================================
+// [ProfileLog]
+// ============================================================================
+
+// Records which stages have been reported by `kOptionProfile`.
+struct ProfileLog : public mpsl::OutputLog {
+  ProfileLog() noexcept
+    : _stages(0),
+      _totalCodeSize(0) {}
+
+  virtual void log(const Message& msg) noexcept {
+    const Profile* profile = msg.getProfile();
+    if (!msg.isProfile() || profile == nullptr)
+      return;
+
+    _stages |= 1U << profile->stage;
+    if (profile->stage == kProfileTotal)
+      _totalCodeSize = profile->codeSize;
+  }
+
+  uint32_t _stages;
+  uint32_t _totalCodeSize;
+};
+
 // ============================================================================
 // [Test]
 // ============================================================================
@@ -132,7 +198,40 @@ public:
   void printPass(const char* body);
   void printFail(const char* body, const char* fmt, ...);
 
+  //! Compile `body` into `program` by `ctx` with the layout of `Args`, see
+  //! `initLayout()`, messages go to a `TestLog` if `log` is null.
+  mpsl::Error compileArgs(mpsl::Program1<Args>& program, mpsl::Context& ctx, const char* body,
+    uint32_t retType, uint32_t options, mpsl::OutputLog* log = nullptr);
+  //! Print a failure of `what` (compilation or execution) of `body` if `err`
+  //! is an error, returns true if it's not.
+  bool checkError(const char* body, const char* what, mpsl::Error err);
+  //! Check that `ret` holds `retValue` of `retType`, prints each mismatch.
+  bool checkValue(const mpsl::Value& ret, uint32_t retType, const mpsl::Value& retValue);
+  //! Print the result of a test of `body` and return `isOk`, a failure is
+  //! described by `fmt` (nothing is printed if it's null).
+  bool checkResult(const char* body, bool isOk, const char* fmt, ...);
+
   bool basicTest(const char* body, uint32_t retType, const mpsl::Value& retValue);
+  bool batchTest(const char* body, uint32_t retType, const mpsl::Value& retValue);
+  bool soaTest(const char* body, float retScale);
+  bool paddedTest(const char* body, float retSum);
+  bool indexTest(const char* body, float retInRange, float retClamped, unsigned int fillers = 0);
+  bool storageTest(const char* body);
+  bool parallelTest(const char* body, uint32_t retType, const mpsl::Value& retValue);
+  bool reduceTest(const char* body);
+  bool cacheTest(const char* body, const char* otherBody, uint32_t retType);
+  bool bindTest(const char* body);
+  bool variantTest(const char* body, const mpsl::Value& retValue);
+  bool serializeTest(const char* body, float retValue);
+  bool asyncTest(const char* body, float retValue);
+  bool swapTest(const char* body, const char* otherBody, float retValue);
+  bool profileTest(const char* body);
+  bool nameTest(const char* body);
+  bool statsTest(const char* body);
+  bool arenaTest(const char* body, float retValue);
+  bool memoryTest(const char* body);
+  bool preferFloatTest(const char* body, float retValue);
+  bool pipelineTest(const char* stage0, const char* stage1, const char* retLink, float retValue);
   bool failureTest(const char* body);
 
   mpsl::Context _ctx;
@@ -264,29 +363,23 @@ void Test::printFail(const char* body, const char* fmt, ...) {
   va_end(ap);
 }
 
-bool Test::basicTest(const char* body, uint32_t retType, const mpsl::Value& retValue) {
+mpsl::Error Test::compileArgs(mpsl::Program1<Args>& program, mpsl::Context& ctx, const char* body, uint32_t retType, uint32_t options, mpsl::OutputLog* log) {
   mpsl::LayoutTmp<1024> layout;
-  Args args;
-
   initLayout(layout, retType);
-  initArgs(args);
-  printTest(body);
 
-  TestLog log;
-  mpsl::Program1<Args> program;
-  mpsl::Error err = program.compile(_ctx, body, _options, layout, &log);
+  TestLog testLog;
+  return program.compile(ctx, body, options, layout, log ? log : &testLog);
+}
 
-  if (err != mpsl::kErrorOk) {
-    printFail(body, "COMPILATION ERROR 0x%08X.\n", static_cast<unsigned int>(err));
-    return false;
-  }
+bool Test::checkError(const char* body, const char* what, mpsl::Error err) {
+  if (err == mpsl::kErrorOk)
+    return true;
 
-  err = program.run(&args);
-  if (err != mpsl::kErrorOk) {
-    printFail(body, "EXECUTION ERROR 0x%08X.\n", static_cast<unsigned int>(err));
-    return false;
-  }
+  printFail(body, "%s ERROR 0x%08X.\n", what, static_cast<unsigned int>(err));
+  return false;
+}
 
+bool Test::checkValue(const mpsl::Value& ret, uint32_t retType, const mpsl::Value& retValue) {
   bool isOk = true;
   unsigned int i, n;
 
@@ -297,7 +390,7 @@ bool Test::basicTest(const char* body, uint32_t retType, const mpsl::Value& retV
     case mpsl::kTypeInt4: n = 4; goto checkInt;
 checkInt:
       for (i = 0; i < n; i++) {
-        int x = args.ret.i[i];
+        int x = ret.i[i];
         int y = retValue.i[i];
 
         if (x != y) {
@@ -313,7 +406,7 @@ checkInt:
     case mpsl::kTypeFloat4: n = 4; goto checkFloat;
 checkFloat:
       for (i = 0; i < n; i++) {
-        float x = args.ret.f[i];
+        float x = ret.f[i];
         float y = retValue.f[i];
 
         if (x != y) {
@@ -329,7 +422,7 @@ checkFloat:
     case mpsl::kTypeDouble4: n = 4; goto checkDouble;
 checkDouble:
       for (i = 0; i < n; i++) {
-        double x = args.ret.d[i];
+        double x = ret.d[i];
         double y = retValue.d[i];
 
         if (x != y) {
@@ -340,13 +433,734 @@ checkDouble:
       break;
   }
 
-  if (isOk)
-    printPass(body);
-  else
-    _succeeded = false;
   return isOk;
 }
 
+bool Test::checkResult(const char* body, bool isOk, const char* fmt, ...) {
+  if (isOk) {
+    printPass(body);
+    return true;
+  }
+
+  if (fmt != nullptr) {
+    printf("[FAIL] ");
+
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+  }
+
+  _succeeded = false;
+  return false;
+}
+
+bool Test::basicTest(const char* body, uint32_t retType, const mpsl::Value& retValue) {
+  Args args;
+  initArgs(args);
+  printTest(body);
+
+  mpsl::Program1<Args> program;
+  if (!checkError(body, "COMPILATION", compileArgs(program, _ctx, body, retType, _options)) ||
+      !checkError(body, "EXECUTION", program.run(&args)))
+    return false;
+
+  return checkResult(body, checkValue(args.ret, retType, retValue), nullptr);
+}
+
+bool Test::batchTest(const char* body, uint32_t retType, const mpsl::Value& retValue) {
+  enum { kBatchSize = 7 };
+
+  Args args[kBatchSize];
+  for (unsigned int i = 0; i < kBatchSize; i++) {
+    initArgs(args[i]);
+    ::memset(&args[i].ret, 0, sizeof(mpsl::Value));
+  }
+  printTest(body);
+
+  mpsl::Program1<Args> program;
+  if (!checkError(body, "COMPILATION", compileArgs(program, _ctx, body, retType, _options)) ||
+      !checkError(body, "EXECUTION", program.runBatch(args, kBatchSize, sizeof(Args))))
+    return false;
+
+  // Every record must match `retValue`.
+  bool isOk = true;
+  for (unsigned int i = 0; i < kBatchSize; i++) {
+    if (!checkValue(args[i].ret, retType, retValue)) {
+      printf("[FAIL] Record #%u doesn't match the expected value\n", i);
+      isOk = false;
+    }
+  }
+
+  return checkResult(body, isOk, nullptr);
+}
+
+bool Test::soaTest(const char* body, float retScale) {
+  enum { kColumnSize = 12 };
+
+  struct Columns {
+    float* x;
+    float* y;
+    float* ret;
+  };
+
+  float x[kColumnSize];
+  float y[kColumnSize];
+  float ret[kColumnSize];
+
+  for (unsigned int i = 0; i < kColumnSize; i++) {
+    x[i] = static_cast<float>(i);
+    y[i] = static_cast<float>(i * 2);
+    ret[i] = 0.0f;
+  }
+
+  Columns columns = { x, y, ret };
+
+  mpsl::LayoutTmp<> layout;
+  layout.setFlags(mpsl::Layout::kFlagSoA);
+  layout.addMember("x"   , mpsl::kTypeFloat | mpsl::kTypeRO, MPSL_OFFSET_OF(Columns, x));
+  layout.addMember("y"   , mpsl::kTypeFloat | mpsl::kTypeRO, MPSL_OFFSET_OF(Columns, y));
+  layout.addMember("@ret", mpsl::kTypeFloat | mpsl::kTypeWO, MPSL_OFFSET_OF(Columns, ret));
+  printTest(body);
+
+  TestLog log;
+  mpsl::Program1<Columns> program;
+  if (!checkError(body, "COMPILATION", program.compile(_ctx, body, _options, layout, &log)) ||
+      !checkError(body, "EXECUTION", program.runBatch(&columns, kColumnSize, 0)))
+    return false;
+
+  // Element `i` of the result column must be `i * retScale`.
+  bool isOk = true;
+  for (unsigned int i = 0; i < kColumnSize; i++) {
+    if (ret[i] != static_cast<float>(i) * retScale) {
+      printf("[FAIL] Element #%u doesn't match the expected value\n", i);
+      isOk = false;
+    }
+  }
+
+  return checkResult(body, isOk, nullptr);
+}
+
+bool Test::paddedTest(const char* body, float retSum) {
+  struct Padded {
+    mpsl::Float4 a;
+    mpsl::Float4 b;
+    mpsl::Float4 ret;
+  };
+
+  // Records are aligned, `float3` members are padded to `float4`.
+  MPSL_ALIGN_VAR(Padded, records[2], 16);
+  for (unsigned int i = 0; i < 2; i++) {
+    records[i].a.set(1.0f, 2.0f, 3.0f, 100.0f);
+    records[i].b.set(4.0f, 5.0f, 6.0f, 200.0f);
+    records[i].ret.set(0.0f);
+  }
+
+  mpsl::LayoutTmp<> layout;
+  layout.setAlignment(16);
+  layout.addMember("a"   , mpsl::kTypeFloat3 | mpsl::kTypeRO | mpsl::kTypePadded, MPSL_OFFSET_OF(Padded, a));
+  layout.addMember("b"   , mpsl::kTypeFloat3 | mpsl::kTypeRO | mpsl::kTypePadded, MPSL_OFFSET_OF(Padded, b));
+  layout.addMember("@ret", mpsl::kTypeFloat3 | mpsl::kTypeWO | mpsl::kTypePadded, MPSL_OFFSET_OF(Padded, ret));
+  printTest(body);
+
+  TestLog log;
+  mpsl::Program1<Padded> program;
+  if (!checkError(body, "COMPILATION", program.compile(_ctx, body, _options, layout, &log)) ||
+      !checkError(body, "EXECUTION", program.runBatch(records, 2, sizeof(Padded))))
+    return false;
+
+  // The padding of the result is unspecified, the padding of inputs is kept.
+  bool isOk = true;
+  for (unsigned int i = 0; i < 2; i++) {
+    const mpsl::Float4& ret = records[i].ret;
+    if (ret.x + ret.y + ret.z != retSum || records[i].a.w != 100.0f) {
+      printf("[FAIL] Record #%u doesn't match the expected value\n", i);
+      isOk = false;
+    }
+  }
+
+  return checkResult(body, isOk, nullptr);
+}
+
+bool Test::indexTest(const char* body, float retInRange, float retClamped, unsigned int fillers) {
+  struct Indexed {
+    float lut[4];
+    const float* table;
+    int i;
+    float ret;
+  };
+
+  static const float table[8] = { 10.0f, 20.0f, 30.0f, 40.0f, 50.0f, 60.0f, 70.0f, 80.0f };
+
+  // The second record indexes out of range, indices are clamped to the array.
+  Indexed records[2];
+  for (unsigned int i = 0; i < 2; i++) {
+    records[i].lut[0] = 1.0f;
+    records[i].lut[1] = 2.0f;
+    records[i].lut[2] = 3.0f;
+    records[i].lut[3] = 4.0f;
+    records[i].table = table;
+    records[i].ret = 0.0f;
+  }
+  records[0].i = 1;
+  records[1].i = 7;
+
+  // Unused members added before and after arrays grow the layout's buffer, so
+  // arrays are moved by a resize.
+  char name[16];
+  mpsl::LayoutTmp<> layout;
+
+  for (unsigned int i = 0; i < fillers; i++) {
+    ::snprintf(name, sizeof(name), "pre%u", i);
+    layout.addMember(name, mpsl::kTypeInt | mpsl::kTypeRO, MPSL_OFFSET_OF(Indexed, i));
+  }
+
+  layout.addArray ("lut"  , mpsl::kTypeFloat | mpsl::kTypeRO, MPSL_OFFSET_OF(Indexed, lut), 4);
+  layout.addArray ("table", mpsl::kTypeFloat | mpsl::kTypeRO | mpsl::kTypeIndirect, MPSL_OFFSET_OF(Indexed, table), 8);
+  layout.addMember("i"    , mpsl::kTypeInt   | mpsl::kTypeRO, MPSL_OFFSET_OF(Indexed, i));
+  layout.addMember("@ret" , mpsl::kTypeFloat | mpsl::kTypeWO, MPSL_OFFSET_OF(Indexed, ret));
+
+  for (unsigned int i = 0; i < fillers; i++) {
+    ::snprintf(name, sizeof(name), "post%u", i);
+    layout.addMember(name, mpsl::kTypeInt | mpsl::kTypeRO, MPSL_OFFSET_OF(Indexed, i));
+  }
+  printTest(body);
+
+  TestLog log;
+  mpsl::Program1<Indexed> program;
+  if (!checkError(body, "COMPILATION", program.compile(_ctx, body, _options, layout, &log)) ||
+      !checkError(body, "EXECUTION", program.runBatch(records, 2, sizeof(Indexed))))
+    return false;
+
+  return checkResult(body, records[0].ret == retInRange && records[1].ret == retClamped,
+    "RETURNED %f %f (EXPECTED %f %f).\n", records[0].ret, records[1].ret, retInRange, retClamped);
+}
+
+bool Test::storageTest(const char* body) {
+  struct Pixel {
+    uint8_t px[4];
+    uint16_t h[4];
+    uint16_t w[4];
+    uint16_t h2[4];
+    uint16_t w2[4];
+    uint8_t ret[4];
+  };
+
+  // Halves of 1.0, -2.5, 0.5, and 65504 (the maximum).
+  Pixel pixel = {
+    { 0, 64, 200, 255 },
+    { 0x3C00, 0xC100, 0x3800, 0x7BFF },
+    { 0, 1000, 65535, 7 },
+    { 0 }, { 0 }, { 0 }
+  };
+
+  // Results of the body, narrowed with saturation (65504 * 2 is infinity).
+  static const uint8_t retPx[4] = { 0, 128, 255, 255 };
+  static const uint16_t retH[4] = { 0x4000, 0xC500, 0x3C00, 0x7C00 };
+  static const uint16_t retW[4] = { 0, 1999, 65535, 13 };
+
+  mpsl::LayoutTmp<> layout;
+  layout.addMember("px"  , mpsl::kTypeFloat4 | mpsl::kTypeRO | mpsl::kTypeStorageU8 | mpsl::kTypeNormalized, MPSL_OFFSET_OF(Pixel, px));
+  layout.addMember("h"   , mpsl::kTypeFloat4 | mpsl::kTypeRO | mpsl::kTypeStorageF16, MPSL_OFFSET_OF(Pixel, h));
+  layout.addMember("w"   , mpsl::kTypeInt4   | mpsl::kTypeRO | mpsl::kTypeStorageU16, MPSL_OFFSET_OF(Pixel, w));
+  layout.addMember("h2"  , mpsl::kTypeFloat4 | mpsl::kTypeWO | mpsl::kTypeStorageF16, MPSL_OFFSET_OF(Pixel, h2));
+  layout.addMember("w2"  , mpsl::kTypeInt4   | mpsl::kTypeWO | mpsl::kTypeStorageU16, MPSL_OFFSET_OF(Pixel, w2));
+  layout.addMember("@ret", mpsl::kTypeFloat4 | mpsl::kTypeWO | mpsl::kTypeStorageU8 | mpsl::kTypeNormalized, MPSL_OFFSET_OF(Pixel, ret));
+  printTest(body);
+
+  TestLog log;
+  mpsl::Program1<Pixel> program;
+  if (!checkError(body, "COMPILATION", program.compile(_ctx, body, _options, layout, &log)) ||
+      !checkError(body, "EXECUTION", program.run(&pixel)))
+    return false;
+
+  bool isOk = ::memcmp(pixel.ret, retPx, sizeof(retPx)) == 0 &&
+              ::memcmp(pixel.h2, retH, sizeof(retH)) == 0 &&
+              ::memcmp(pixel.w2, retW, sizeof(retW)) == 0;
+
+  return checkResult(body, isOk, "RETURNED %d %d %d %d (EXPECTED %d %d %d %d).\n",
+    pixel.ret[0], pixel.ret[1], pixel.ret[2], pixel.ret[3],
+    retPx[0], retPx[1], retPx[2], retPx[3]);
+}
+
+bool Test::parallelTest(const char* body, uint32_t retType, const mpsl::Value& retValue) {
+  enum { kRecordsCount = 1000, kWorkersCount = 4 };
+
+  Args* args = static_cast<Args*>(::malloc(kRecordsCount * sizeof(Args)));
+  if (args == NULL) {
+    printFail(body, "OUT OF MEMORY.\n");
+    return false;
+  }
+
+  for (unsigned int i = 0; i < kRecordsCount; i++) {
+    initArgs(args[i]);
+    ::memset(&args[i].ret, 0, sizeof(mpsl::Value));
+  }
+  printTest(body);
+
+  TestPool pool(kWorkersCount);
+  mpsl::Program1<Args> program;
+
+  if (!checkError(body, "COMPILATION", compileArgs(program, _ctx, body, retType, _options)) ||
+      !checkError(body, "EXECUTION", program.runParallel(args, kRecordsCount, sizeof(Args), &pool))) {
+    ::free(args);
+    return false;
+  }
+
+  // Every record must be processed exactly once and match `retValue`.
+  bool isOk = true;
+  for (unsigned int i = 0; i < kRecordsCount; i++) {
+    if (!checkValue(args[i].ret, retType, retValue)) {
+      printf("[FAIL] Record #%u doesn't match the expected value\n", i);
+      isOk = false;
+      break;
+    }
+  }
+
+  ::free(args);
+  return checkResult(body, isOk, nullptr);
+}
+
+bool Test::reduceTest(const char* body) {
+  enum { kRecordsCount = 1000, kWorkersCount = 4 };
+
+  struct Record {
+    float x;
+  };
+
+  struct Totals {
+    float sum;
+    float top;
+    int count;
+  };
+
+  mpsl::LayoutTmp<> recordLayout;
+  recordLayout.addMember("x", mpsl::kTypeFloat | mpsl::kTypeRO, MPSL_OFFSET_OF(Record, x));
+
+  mpsl::LayoutTmp<> totalsLayout;
+  totalsLayout.addMember("sum"  , mpsl::kTypeFloat | mpsl::kTypeWO | mpsl::kTypeReduceSum, MPSL_OFFSET_OF(Totals, sum));
+  totalsLayout.addMember("top"  , mpsl::kTypeFloat | mpsl::kTypeWO | mpsl::kTypeReduceMax, MPSL_OFFSET_OF(Totals, top));
+  totalsLayout.addMember("count", mpsl::kTypeInt   | mpsl::kTypeWO | mpsl::kTypeReduceSum, MPSL_OFFSET_OF(Totals, count));
+  printTest(body);
+
+  // The body must reduce `x` to `sum` and `top` and count records by `count`.
+  Record records[kRecordsCount];
+  for (unsigned int i = 0; i < kRecordsCount; i++)
+    records[i].x = static_cast<float>(i % 10);
+
+  TestLog log;
+  TestPool pool(kWorkersCount);
+  mpsl::Program2<Record, Totals> program;
+
+  if (!checkError(body, "COMPILATION", program.compile(_ctx, body, _options, recordLayout, totalsLayout, &log)))
+    return false;
+
+  // Reduce by `runBatch()` first, then by `runParallel()`.
+  bool isOk = true;
+  for (unsigned int i = 0; i < 2 && isOk; i++) {
+    Totals totals = { 0.0f, -1.0f, 0 };
+    mpsl::Error err = i == 0 ? program.runBatch(records, &totals, kRecordsCount, sizeof(Record), 0)
+                             : program.runParallel(records, &totals, kRecordsCount, sizeof(Record), 0, &pool);
+
+    if (!checkError(body, "EXECUTION", err))
+      return false;
+
+    if (totals.sum != 4500.0f || totals.top != 9.0f || totals.count != kRecordsCount) {
+      printf("[FAIL] Reduction #%u returned (%f, %f, %d) != Expected(4500, 9, %d)\n",
+        i, totals.sum, totals.top, totals.count, static_cast<int>(kRecordsCount));
+      isOk = false;
+    }
+  }
+
+  return checkResult(body, isOk, nullptr);
+}
+
+bool Test::cacheTest(const char* body, const char* otherBody, uint32_t retType) {
+  printTest(body);
+
+  // Use a separate context so the statistics only reflect this test.
+  mpsl::Context ctx = mpsl::Context::create();
+  mpsl::Program1<Args> p0, p1, p2;
+
+  ctx.setCacheLimit(1);
+  mpsl::Error err = compileArgs(p0, ctx, body, retType, _options);
+  if (err == mpsl::kErrorOk) err = compileArgs(p1, ctx, body, retType, _options);
+  if (err == mpsl::kErrorOk) err = compileArgs(p2, ctx, otherBody, retType, _options);
+
+  if (!checkError(body, "COMPILATION", err))
+    return false;
+
+  // Programs are not cached when debugging as the output would be lost.
+  mpsl::Context::CacheStats stats;
+  ctx.getCacheStats(stats);
+
+  bool isOk = isVerbose() ? stats.hits == 0 && stats.count == 0
+                          : stats.hits == 1 && stats.misses == 2 && stats.evictions == 1 && stats.count == 1 && p0 == p1 && p0 != p2;
+
+  return checkResult(body, isOk, "Unexpected cache state (hits=%u misses=%u evictions=%u count=%u)\n",
+    static_cast<unsigned int>(stats.hits),
+    static_cast<unsigned int>(stats.misses),
+    static_cast<unsigned int>(stats.evictions),
+    stats.count);
+}
+
+bool Test::bindTest(const char* body) {
+  struct Uniforms {
+    float x;
+    float gain;
+    int mode;
+    float ret;
+  };
+
+  mpsl::LayoutTmp<> layout;
+  layout.addMember("x"   , mpsl::kTypeFloat | mpsl::kTypeRO, MPSL_OFFSET_OF(Uniforms, x));
+  layout.addMember("gain", mpsl::kTypeFloat | mpsl::kTypeRO | mpsl::kTypeBind, MPSL_OFFSET_OF(Uniforms, gain));
+  layout.addMember("mode", mpsl::kTypeInt   | mpsl::kTypeRO | mpsl::kTypeBind, MPSL_OFFSET_OF(Uniforms, mode));
+  layout.addMember("@ret", mpsl::kTypeFloat | mpsl::kTypeWO, MPSL_OFFSET_OF(Uniforms, ret));
+  printTest(body);
+
+  // The body must return `x * gain` if `mode` is 1 and `x` otherwise. Bound
+  // members are zero in the data passed to `run()`, as they must not be read.
+  Uniforms values[3] = {
+    { 0.0f, 2.0f, 1, 0.0f },
+    { 0.0f, 3.0f, 1, 0.0f },
+    { 0.0f, 3.0f, 0, 0.0f }
+  };
+  float expected[3] = { 8.0f, 12.0f, 4.0f };
+
+  TestLog log;
+  mpsl::Program1<Uniforms> program;
+  mpsl::Error err = program.compileBound(_ctx, body, _options, layout, &values[0], &log);
+
+  bool isOk = true;
+  for (unsigned int i = 0; i < 3 && isOk; i++) {
+    if (i != 0 && err == mpsl::kErrorOk)
+      err = program.respecialize(_ctx, &values[i], &log);
+
+    if (!checkError(body, "COMPILATION", err))
+      return false;
+
+    Uniforms args = { 4.0f, 0.0f, 0, 0.0f };
+    program.run(&args);
+
+    if (args.ret != expected[i] || !program.isSpecialized()) {
+      printf("[FAIL] Specialization #%u returned %f != Expected(%f)\n", i, args.ret, expected[i]);
+      isOk = false;
+    }
+  }
+
+  return checkResult(body, isOk, nullptr);
+}
+
+bool Test::variantTest(const char* body, const mpsl::Value& retValue) {
+  Args args;
+  printTest(body);
+
+  mpsl::Program1<Args> program;
+  if (!checkError(body, "COMPILATION", compileArgs(program, _ctx, body, mpsl::kTypeFloat4, _options | mpsl::kOptionMultiVersion)))
+    return false;
+
+  // The best variant supported by the CPU runs by default, and all compiled
+  // variants must return the same result.
+  bool isOk = program.getVariant() == _ctx.getCpuVariant();
+  if (!isOk)
+    printf("[FAIL] Variant %u != Expected(%u)\n", program.getVariant(), _ctx.getCpuVariant());
+
+  for (uint32_t v = 0; v < mpsl::kVariantCount; v++) {
+    if (!program.hasVariant(v))
+      continue;
+
+    initArgs(args);
+    program.selectVariant(v);
+    program.run(&args);
+
+    if (!checkValue(args.ret, mpsl::kTypeFloat4, retValue)) {
+      printf("[FAIL] Variant %u doesn't match the expected value\n", v);
+      isOk = false;
+    }
+  }
+
+  return checkResult(body, isOk, nullptr);
+}
+
+bool Test::serializeTest(const char* body, float retValue) {
+  mpsl::LayoutTmp<1024> layout;
+  mpsl::LayoutTmp<1024> otherLayout;
+  Args args;
+
+  initLayout(layout, mpsl::kTypeFloat);
+  initLayout(otherLayout, mpsl::kTypeDouble);
+  printTest(body);
+
+  mpsl::Program1<Args> program;
+  if (!checkError(body, "COMPILATION", compileArgs(program, _ctx, body, mpsl::kTypeFloat, _options)))
+    return false;
+
+  // Programs can't be serialized on targets that don't generate position
+  // independent code.
+  size_t size = program.getSerializedSize();
+  if (size == 0)
+    return checkResult(body, true, nullptr);
+
+  uint8_t* blob = static_cast<uint8_t*>(::malloc(size));
+  if (blob == nullptr) {
+    printFail(body, "OUT OF MEMORY.\n");
+    return false;
+  }
+
+  // Load into a different context, the blob must not depend on the original
+  // one. A blob that doesn't match layouts or is damaged must be rejected.
+  mpsl::Context ctx = mpsl::Context::create();
+  mpsl::Program1<Args> loaded;
+  mpsl::Program1<Args> rejected;
+
+  bool isOk = program.serialize(blob, size) == mpsl::kErrorOk &&
+              loaded.load(ctx, blob, size, layout) == mpsl::kErrorOk &&
+              rejected.load(ctx, blob, size, otherLayout) == mpsl::kErrorInvalidBlob;
+
+  blob[size - 1] ^= 0x01;
+  isOk &= rejected.load(ctx, blob, size, layout) == mpsl::kErrorInvalidBlob && !rejected.isValid();
+  ::free(blob);
+
+  if (!isOk)
+    return checkResult(body, false, "Serialized program wasn't loaded or rejected as expected\n");
+
+  initArgs(args);
+  loaded.run(&args);
+
+  return checkResult(body, args.ret.f[0] == retValue,
+    "Loaded program returned %f != Expected(%f)\n", args.ret.f[0], retValue);
+}
+
+bool Test::asyncTest(const char* body, float retValue) {
+  mpsl::LayoutTmp<1024> layout;
+  Args args;
+
+  initLayout(layout, mpsl::kTypeFloat);
+  printTest(body);
+
+  TestLog log;
+  DeferredPool pool;
+  mpsl::CompileJob job;
+  mpsl::Program1<Args> program;
+
+  // The job must keep its own copy of the source.
+  char source[256];
+  ::snprintf(source, sizeof(source), "%s", body);
+
+  mpsl::Error err = mpsl::Program1<Args>::compileAsync(job, _ctx, source, _options, layout, &pool, &log);
+  ::memset(source, 0, sizeof(source));
+
+  bool isOk = err == mpsl::kErrorOk && job.isValid() && !job.isReady();
+  if (isOk) {
+    pool.flush();
+    err = job.wait(program);
+    isOk = err == mpsl::kErrorOk && job.isReady() && program.isValid();
+  }
+
+  if (!isOk)
+    return checkResult(body, false, "Asynchronous compilation failed (0x%08X)\n", static_cast<unsigned int>(err));
+
+  initArgs(args);
+  program.run(&args);
+
+  return checkResult(body, args.ret.f[0] == retValue,
+    "Program compiled asynchronously returned %f != Expected(%f)\n", args.ret.f[0], retValue);
+}
+
+bool Test::swapTest(const char* body, const char* otherBody, float retValue) {
+  Args args;
+  printTest(body);
+
+  // Cached programs would keep the replaced program alive.
+  uint32_t options = _options | mpsl::kOptionDisableCache;
+  mpsl::Program1<Args> program, other;
+
+  bool isOk = compileArgs(program, _ctx, otherBody, mpsl::kTypeFloat, options) == mpsl::kErrorOk &&
+              compileArgs(other, _ctx, body, mpsl::kTypeFloat, options) == mpsl::kErrorOk;
+
+  // The replaced program must not be freed while it may still run.
+  size_t waiting = 0;
+  if (isOk) {
+    mpsl::Program::RunScope scope;
+    program.swap(other);
+    other.reset();
+    waiting = mpsl::Program::reclaim();
+  }
+
+  size_t remaining = mpsl::Program::reclaim();
+  if (remaining != 0)
+    remaining = mpsl::Program::reclaim();
+
+  initArgs(args);
+  if (isOk) {
+    program.run(&args);
+    isOk = args.ret.f[0] == retValue && waiting != 0 && remaining == 0;
+  }
+
+  return checkResult(body, isOk, "Swapped program returned %f != Expected(%f) (waiting=%u remaining=%u)\n",
+    args.ret.f[0], retValue, static_cast<unsigned int>(waiting), static_cast<unsigned int>(remaining));
+}
+
+bool Test::profileTest(const char* body) {
+  printTest(body);
+
+  ProfileLog log;
+  mpsl::Program1<Args> program;
+  if (!checkError(body, "COMPILATION", compileArgs(program, _ctx, body, mpsl::kTypeFloat, _options | mpsl::kOptionProfile, &log)))
+    return false;
+
+  uint32_t allStages = (1U << mpsl::OutputLog::kProfileCount) - 1;
+  return checkResult(body, log._stages == allStages && log._totalCodeSize != 0,
+    "Reported stages 0x%02X != Expected(0x%02X)\n", log._stages, allStages);
+}
+
+bool Test::nameTest(const char* body) {
+  printTest(body);
+
+  mpsl::Program1<Args> program;
+  uint32_t options = _options | mpsl::kOptionDisableCache;
+
+  // The name is copied and cleared by compiling the program again.
+  char name[16];
+  ::snprintf(name, sizeof(name), "shader");
+
+  bool isOk = compileArgs(program, _ctx, body, mpsl::kTypeFloat, options) == mpsl::kErrorOk &&
+              program.getName() == nullptr &&
+              program.setName(name) == mpsl::kErrorOk;
+
+  name[0] = '\0';
+  isOk = isOk && program.getName() != nullptr && ::strcmp(program.getName(), "shader") == 0;
+  isOk = isOk && compileArgs(program, _ctx, body, mpsl::kTypeFloat, options) == mpsl::kErrorOk &&
+                 program.getName() == nullptr;
+
+  return checkResult(body, isOk, "Program name wasn't set or cleared as expected\n");
+}
+
+bool Test::statsTest(const char* body) {
+  enum { kBatchSize = 5 };
+
+  Args args[kBatchSize];
+  for (unsigned int i = 0; i < kBatchSize; i++)
+    initArgs(args[i]);
+  printTest(body);
+
+  mpsl::Program1<Args> program;
+  mpsl::Program1<Args> uncounted;
+  mpsl::Program::Stats stats;
+
+  // A single run and a batch are two calls, a program compiled without
+  // counters has no statistics and can't be mistaken for an idle one.
+  bool isOk = compileArgs(program, _ctx, body, mpsl::kTypeFloat, _options | mpsl::kOptionCountCycles) == mpsl::kErrorOk &&
+              compileArgs(uncounted, _ctx, body, mpsl::kTypeFloat, _options) == mpsl::kErrorOk &&
+              program.run(&args[0]) == mpsl::kErrorOk &&
+              program.runBatch(args, kBatchSize, sizeof(Args)) == mpsl::kErrorOk &&
+              program.getStats(stats) == mpsl::kErrorOk;
+
+  isOk = isOk && stats.calls == 2 && stats.records == kBatchSize + 1 &&
+                 program.getSerializedSize() == 0;
+  isOk = isOk && uncounted.getStats(stats) == mpsl::kErrorInvalidState;
+
+  return checkResult(body, isOk, "Program statistics don't match the runs\n");
+}
+
+bool Test::arenaTest(const char* body, float retValue) {
+  Args args;
+  printTest(body);
+
+  mpsl::Program1<Args> program;
+  uint32_t options = _options | mpsl::kOptionDisableCache;
+
+  // Compile with reused memory, then with memory allocated again.
+  bool isOk = true;
+  for (uint32_t i = 0; i < 3 && isOk; i++) {
+    if (i == 2)
+      isOk = _ctx.trimArenas() == mpsl::kErrorOk;
+
+    isOk = isOk && compileArgs(program, _ctx, body, mpsl::kTypeFloat, options) == mpsl::kErrorOk;
+    if (isOk) {
+      initArgs(args);
+      program.run(&args);
+      isOk = args.ret.f[0] == retValue;
+    }
+  }
+
+  return checkResult(body, isOk, "Program compiled by a reused arena failed\n");
+}
+
+bool Test::memoryTest(const char* body) {
+  printTest(body);
+
+  mpsl::Context ctx = mpsl::Context::create();
+  mpsl::Program1<Args> p0, p1;
+  mpsl::Context::MemoryStats stats;
+  uint32_t options = _options | mpsl::kOptionDisableCache;
+
+  bool isOk = compileArgs(p0, ctx, body, mpsl::kTypeFloat, options) == mpsl::kErrorOk &&
+              ctx.getMemoryStats(stats) == mpsl::kErrorOk &&
+              stats.programCount == 1 &&
+              stats.usedBytes >= p0.getProgramSize() &&
+              stats.committedBytes >= stats.usedBytes;
+
+  // The limit is reached, the next program fails and the previous stays valid.
+  isOk = isOk && ctx.setCodeLimit(stats.usedBytes) == mpsl::kErrorOk &&
+                 compileArgs(p1, ctx, body, mpsl::kTypeFloat, options) == mpsl::kErrorNoMemory &&
+                 ctx.setCodeLimit(0) == mpsl::kErrorOk &&
+                 compileArgs(p1, ctx, body, mpsl::kTypeFloat, options) == mpsl::kErrorOk &&
+                 ctx.getMemoryStats(stats) == mpsl::kErrorOk &&
+                 stats.programCount == 2 &&
+                 stats.limit == 0;
+
+  return checkResult(body, isOk, "Memory statistics or the code limit don't match\n");
+}
+
+bool Test::preferFloatTest(const char* body, float retValue) {
+  Args args;
+  printTest(body);
+
+  mpsl::Program1<Args> program;
+  uint32_t options = _options | mpsl::kOptionDisableCache;
+
+  // Numbers are `double` without the option, which can't be returned as `float`.
+  bool isOk = compileArgs(program, _ctx, body, mpsl::kTypeFloat, options) != mpsl::kErrorOk &&
+              compileArgs(program, _ctx, body, mpsl::kTypeFloat, options | mpsl::kOptionPreferFloat) == mpsl::kErrorOk;
+
+  if (isOk) {
+    initArgs(args);
+    program.run(&args);
+    isOk = args.ret.f[0] == retValue;
+  }
+
+  return checkResult(body, isOk, "Numbers didn't take the type of float operands\n");
+}
+
+bool Test::pipelineTest(const char* stage0, const char* stage1, const char* retLink, float retValue) {
+  mpsl::LayoutTmp<1024> layout;
+  Args args;
+
+  initLayout(layout, mpsl::kTypeFloat);
+  printTest(stage0);
+  printTest(stage1);
+
+  // The first stage passes a value to the second one by the link `x`, either
+  // by returning it to `retLink` or by assigning it to `x`.
+  mpsl::Pipeline pipeline;
+  pipeline.addLink("x", mpsl::kTypeFloat);
+  pipeline.addStage(stage0, retLink);
+  pipeline.addStage(stage1);
+
+  TestLog log;
+  mpsl::Program1<Args> program;
+  if (!checkError(stage1, "COMPILATION", program.compile(_ctx, pipeline, _options, layout, &log)))
+    return false;
+
+  initArgs(args);
+  program.run(&args);
+
+  return checkResult(stage1, args.ret.f[0] == retValue,
+    "Pipeline returned (%f) != Expected(%f)\n", args.ret.f[0], retValue);
+}
+
 bool Test::failureTest(const char* body) {
   return true;
 }
@@ -421,6 +1235,176 @@ int main(int argc, char* argv[]) {
   test.basicTest("int main() { if (ia <= 1) return ib; else return ic; }", mpsl::kTypeInt, makeIVal( 9));
   test.basicTest("int main() { if (ia <  1) return ib; else return ic; }", mpsl::kTypeInt, makeIVal(-2));
 
+  // Test branches converted to selects (with and without SSE4.1 blends).
+  test.basicTest("int main() { int x; if (ia > ib) x = ia; else x = ib; return x; }", mpsl::kTypeInt, makeIVal(9));
+  test.basicTest("double main() { double x = da; if (ia < ib) x = db; return x; }", mpsl::kTypeDouble, makeDVal(9.0));
+  test.basicTest("float4 main() { float4 x = f4b; if (fa < fb) x = f4a; return x; }", mpsl::kTypeFloat4, makeFVal(1, 2, 3, 4));
+
+  Test noSSE4_1(options | mpsl::kOptionDisableSSE4_1);
+  noSSE4_1.basicTest("float4 main() { float4 x = f4b; if (fa < fb) x = f4a; return x; }", mpsl::kTypeFloat4, makeFVal(1, 2, 3, 4));
+  test._succeeded &= noSSE4_1._succeeded;
+
+  // Test control flow - loops.
+  test.basicTest("int main() { int x = 0; for (int i = 0; i < 4; i++) x += ib; return x; }", mpsl::kTypeInt, makeIVal(36));
+  test.basicTest("int main() { int x = ia; while (x < 100) x = x * 2; return x; }", mpsl::kTypeInt, makeIVal(128));
+  test.basicTest("int main() { int x = 0; for (int i = 0; i < 10; i++) { if (i == 2) continue; if (i == 5) break; x += i; } return x; }", mpsl::kTypeInt, makeIVal(8));
+
+  // Test IR optimizations (folding, CSE) and their opt-out.
+  test.basicTest("int main() { int x = 3; return x * 4 + ia; }", mpsl::kTypeInt, makeIVal(13));
+  test.basicTest("float main() { return (fa + fb) * (fa + fb); }", mpsl::kTypeFloat, makeFVal(100.0f));
+  test.basicTest("float main() { return (fb - fa) * 0.25f + fc * 0.0f; }", mpsl::kTypeFloat, makeFVal(2.0f));
+
+  Test unoptimized(options | mpsl::kOptionOptNone);
+  unoptimized.basicTest("int main() { int x = ia; while (x < 100) x = x * 2; return x; }", mpsl::kTypeInt, makeIVal(128));
+  unoptimized.basicTest("int main() { int x = 3; return x * 4 + ia; }", mpsl::kTypeInt, makeIVal(13));
+  test._succeeded &= unoptimized._succeeded;
+
+  // Test loop-invariant code motion (the loop runs too many times to unroll)
+  // and loops compiled without unrolling, the swap checks that moves of phis
+  // that use each other's results are not coalesced.
+  test.basicTest("int main() { int x = 0; for (int i = 0; i < 16; i++) x += ia * ib; return x; }", mpsl::kTypeInt, makeIVal(144));
+
+  Test notUnrolled(options);
+  notUnrolled._ctx.setUnrollLimit(0);
+  notUnrolled.basicTest("int main() { int x = 0; for (int i = 0; i < 4; i++) x += ib; return x; }", mpsl::kTypeInt, makeIVal(36));
+  notUnrolled.basicTest("int main() { int x = ia; int y = ib; for (int i = 0; i < 3; i++) { int t = x; x = y; y = t; } return x * 10 + y; }", mpsl::kTypeInt, makeIVal(91));
+  notUnrolled.basicTest("float main() { float x = fa; for (int i = 0; i < 3; i++) x = fb - x; return x; }", mpsl::kTypeFloat, makeFVal(8.0f));
+  test._succeeded &= notUnrolled._succeeded;
+
+  // Test calls of user functions, inlined by default and compiled once and
+  // called out-of-line if they are bigger than the inline limit.
+  test.basicTest("float sq(float x) { return x * x; }\n"
+                 "float main() { return sq(fa + fb) + sq(fb); }\n", mpsl::kTypeFloat, makeFVal(181.0f));
+
+  Test outlined(options);
+  outlined._ctx.setInlineLimit(0);
+  outlined.basicTest("float sq(float x) { return x * x; }\n"
+                     "float main() { return sq(fa + fb) + sq(fb); }\n", mpsl::kTypeFloat, makeFVal(181.0f));
+  outlined.basicTest("int sum(int n) { int x = 0; for (int i = 0; i < n; i++) x += i; return x; }\n"
+                     "int main() { return sum(ib) - sum(ia); }\n", mpsl::kTypeInt, makeIVal(36));
+  test._succeeded &= outlined._succeeded;
+
+  // Test 256-bit vectors, held by YMM registers if AVX is available and split
+  // into two XMM registers otherwise.
+  test.basicTest("double4 main() { return (d4a + d4b) * d4c - d4a; }", mpsl::kTypeDouble4, makeDVal(-21.0, -32.0, -43.0, -54.0));
+
+  Test noAVX(options | mpsl::kOptionDisableAVX);
+  noAVX.basicTest("double4 main() { return (d4a + d4b) * d4c - d4a; }", mpsl::kTypeDouble4, makeDVal(-21.0, -32.0, -43.0, -54.0));
+  test._succeeded &= noAVX._succeeded;
+
+  // Test lowered transcendental functions, inputs have exact results.
+  test.basicTest("float   main() { return log2(fb - fa); }", mpsl::kTypeFloat  , makeFVal(3.0f));
+  test.basicTest("double  main() { return log2(db - da); }", mpsl::kTypeDouble , makeDVal(3.0));
+  test.basicTest("float   main() { return exp(fa - fa); }", mpsl::kTypeFloat  , makeFVal(1.0f));
+  test.basicTest("double  main() { return sin(da - da); }", mpsl::kTypeDouble , makeDVal(0.0));
+
+  // Test strength reduction, divisions by constants are replaced by shifts and
+  // multiplications and `pow` of integer exponents by multiplications.
+  test.basicTest("int     main() { return ib / 3; }", mpsl::kTypeInt    , makeIVal(3));
+  test.basicTest("int     main() { return ic / 2 + ib % 4; }", mpsl::kTypeInt, makeIVal(0));
+  test.basicTest("int     main() { return (ic - ib) / -7; }", mpsl::kTypeInt, makeIVal(1));
+  test.basicTest("float   main() { return pow(fc, 3.0f); }", mpsl::kTypeFloat  , makeFVal(-8.0f));
+  test.basicTest("double  main() { return pow(db, -2.0); }", mpsl::kTypeDouble , makeDVal(1.0 / 81.0));
+
+  // Test fast-math, the expressions are chosen to have exact results.
+  Test fastMath(options | mpsl::kOptionFastMath);
+  fastMath.basicTest("float   main() { return fa * fb + fc; }", mpsl::kTypeFloat  , makeFVal(7.0f));
+  fastMath.basicTest("double  main() { return db / 2.0; }", mpsl::kTypeDouble , makeDVal(4.5));
+  fastMath.basicTest("float   main() { return fa + fb + fc + fa + fb; }", mpsl::kTypeFloat  , makeFVal(18.0f));
+  test._succeeded &= fastMath._succeeded;
+
+  // Test batched execution.
+  test.batchTest("float   main() { return fa + fb; }", mpsl::kTypeFloat  , makeFVal(10.0f));
+  test.batchTest("double  main() { return da * db; }", mpsl::kTypeDouble , makeDVal(9.0  ));
+
+  // Test parallel execution.
+  test.parallelTest("float   main() { return fa + fb; }", mpsl::kTypeFloat  , makeFVal(10.0f));
+
+  // Test reductions across records.
+  test.reduceTest("void main() { sum = x; top = x; count = 1; }");
+
+  // Test the program cache.
+  test.cacheTest("float main() { return fa + fb; }", "float main() { return fa - fb; }", mpsl::kTypeFloat);
+
+  // Test serialized programs.
+  test.serializeTest("float   main() { return fa * 0.5f + fb; }", 9.5f);
+
+  // Test compile-time profiling.
+  test.profileTest("float   main() { return sqrt(fa * fb); }");
+
+  // Test compile arenas.
+  test.arenaTest("float   main() { float x = fa * fb; return x - fc; }", 11.0f);
+
+  // Test memory statistics and the code limit.
+  test.memoryTest("float   main() { return fa * fb; }");
+
+  // Test numbers typed by float operands.
+  test.preferFloatTest("float   main() { float x = 0.5; return fa * x + fb * 2 + fc * -0.25; }", 19.0f);
+
+  // Test pipelines.
+  test.pipelineTest("float   main() { return fa * fb; }", "float   main() { return x - fc; }", "x", 11.0f);
+  test.pipelineTest("void    main() { x = fa + fb; }", "float   main() { return x * fc; }", nullptr, -20.0f);
+
+  // Test program names.
+  test.nameTest("float   main() { return fa + fb; }");
+
+  // Test execution counters.
+  test.statsTest("float   main() { return fa * fb; }");
+
+  // Test asynchronous compilation.
+  test.asyncTest("float   main() { return fa * fb + fc; }", 7.0f);
+
+  // Test hot-swapped programs.
+  test.swapTest("float   main() { return fa * fb + fc; }", "float   main() { return fa; }", 7.0f);
+
+  // Test multi-versioned programs.
+  test.variantTest("float4  main() { return round(f4a * 0.75f) + f4b; }", makeFVal(10.0f, 10.0f, 9.0f, 9.0f));
+
+  // Test members bound at compile time.
+  test.bindTest("float main() { if (mode == 1) return x * gain; return x; }");
+
+  // Test structure-of-arrays layouts.
+  test.soaTest("float main() { return x + y; }", 3.0f);
+  test.soaTest("float main() { return y - x; }", 1.0f);
+  test.soaTest("float main() { float t = x + x; return t + y; }", 4.0f);
+
+  // Test aligned layouts with padded members.
+  test.paddedTest("float3 main() { return a * b; }", 32.0f);
+  test.paddedTest("float3 main() { return a + b * 2.0f; }", 36.0f);
+
+  // Test streaming batches, aligned results are written by non-temporal stores.
+  Test streamed(options | mpsl::kOptionStreamStores | mpsl::kOptionPrefetch4);
+  streamed.paddedTest("float3 main() { return a * b; }", 32.0f);
+  streamed.batchTest("float   main() { return fa + fb; }", mpsl::kTypeFloat  , makeFVal(10.0f));
+  test._succeeded &= streamed._succeeded;
+
+  // Test indexed arrays, out of range indices are clamped.
+  test.indexTest("float main() { return lut[i] + table[i * 2]; }", 32.0f, 84.0f);
+  test.indexTest("float main() { return lut[2] * table[0]; }", 30.0f, 30.0f);
+  test.indexTest("float main() { return lut[i] + table[i * 2]; }", 32.0f, 84.0f, 16);
+
+  // Test members stored in narrow formats.
+  test.storageTest("float4 main() { h2 = h * 2.0f; w2 = w * 2 - 1; return px * 2.0f; }");
+
+  // Test a frozen context, all compilations share its built-in scope.
+  Test frozen(options);
+  frozen._ctx.freeze();
+  frozen.basicTest("float   main() { return fa + fb; }", mpsl::kTypeFloat  , makeFVal(10.0f));
+  frozen.basicTest("double  main() { return da * M_PI; }", mpsl::kTypeDouble , makeDVal(3.14159265358979323846));
+  test._succeeded &= frozen._succeeded && frozen._ctx.isFrozen();
+
+  // Test the floating-point environment of programs, constant folding has to
+  // give the same results as the code.
+  Test flushed(options | mpsl::kOptionFlushDenormals);
+  flushed.basicTest("float   main() { return fa * 1e-39f; }", mpsl::kTypeFloat, makeFVal(0.0f));
+  flushed.basicTest("float   main() { float x = 1e-20f; return x * 1e-20f; }", mpsl::kTypeFloat, makeFVal(0.0f));
+  test._succeeded &= flushed._succeeded;
+
+  Test roundedDown(options | mpsl::kOptionRoundDown);
+  roundedDown.basicTest("float   main() { return fa / 3.0f; }", mpsl::kTypeFloat, makeFVal(0.33333331f));
+  roundedDown.basicTest("float   main() { float x = 1.0f; return x / 3.0f; }", mpsl::kTypeFloat, makeFVal(0.33333331f));
+  test._succeeded &= roundedDown._succeeded;
+
 /*
   // Test creating and calling functions inside the shader.
   test.basicTest("int dummy(int a, int b) { return a + b; }\n"